@@ -11,6 +11,12 @@
 
 #define UART_NUM UART_NUM_0
 #define BUF_SIZE 1024
+#define UART_EVENT_QUEUE_SIZE 20
+#define UART_READ_CHUNK 128
+
+#ifndef CONFIG_CONSOLE_TASK_CORE
+#define CONFIG_CONSOLE_TASK_CORE 0                                          // Away from the sniffer parse stage
+#endif
 
 #define STATE_INITIAL 0
 #define STATE_AP_SELECTION 1
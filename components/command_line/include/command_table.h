@@ -0,0 +1,91 @@
+/**
+ * @file command_table.h
+ * @brief Registered console commands with argument splitting and prefix lookup.
+ *
+ * Pure logic without ESP-IDF dependencies. A line is split into whitespace separated
+ * arguments (double quotes group words) and its first argument selects the command: an exact
+ * name wins, otherwise any unambiguous prefix is accepted, so `st` runs `stations` as long as
+ * no other command starts with `st`.
+ */
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef CONFIG_CONSOLE_MAX_COMMANDS                                         // CONFIG_CONSOLE_MAX_COMMANDS
+#define CONFIG_CONSOLE_MAX_COMMANDS 32                                      // Registered command slots
+#endif
+
+#define COMMAND_TABLE_MAX_ARGS 16
+
+/**
+ * @brief Command handler.
+ * @param argc Number of arguments, including the command name.
+ * @param argv Arguments; argv[0] is the full command name even if a prefix was typed.
+ * @param ctx Context passed to command_table_dispatch().
+ * @return false to print the command's usage.
+ **/
+typedef bool (*command_handler_t)(int argc, char **argv, void *ctx);
+
+typedef struct {
+    const char *name;
+    const char *usage;                                                      // Arguments, e.g. "[rr] [ch,ch,...]"
+    const char *help;                                                       // One line description
+    command_handler_t handler;
+} command_t;
+
+typedef enum {
+    COMMAND_OK,
+    COMMAND_EMPTY,                                                          // Line had no arguments
+    COMMAND_UNKNOWN,
+    COMMAND_AMBIGUOUS,                                                      // Prefix matches several commands
+    COMMAND_USAGE,                                                          // Handler rejected arguments
+    COMMAND_TOO_MANY_ARGS,
+} command_status_t;
+
+/**
+ * @brief Registers command; the structure must stay valid while registered.
+ * @return false if the name is taken or all CONFIG_CONSOLE_MAX_COMMANDS slots are used.
+ **/
+bool command_table_register(const command_t *command);
+
+/**
+ * @brief Registers an array of commands.
+ * @return false if any of them could not be registered.
+ **/
+bool command_table_register_all(const command_t *commands, size_t count);
+
+/**
+ * @brief Looks up command by exact name or unambiguous prefix.
+ * @param name Command name or prefix.
+ * @param command Set to the match, or to the first candidate if ambiguous.
+ * @return COMMAND_OK, COMMAND_UNKNOWN or COMMAND_AMBIGUOUS.
+ **/
+command_status_t command_table_find(const char *name, const command_t **command);
+
+/**
+ * @brief Splits line in place into arguments.
+ * @return Number of arguments, or -1 if there are more than `max`.
+ **/
+int command_table_split(char *line, char **argv, int max);
+
+/**
+ * @brief Splits line in place, looks up the command and runs it.
+ * @param line Input line, modified.
+ * @param ctx Passed to the handler.
+ * @param command Set to the looked-up command if any, may be NULL.
+ **/
+command_status_t command_table_dispatch(char *line, void *ctx, const command_t **command);
+
+/**
+ * @brief Returns number of registered commands.
+ **/
+size_t command_table_count(void);
+
+/**
+ * @brief Returns registered command by position, in registration order.
+ **/
+const command_t *command_table_get(size_t index);
+
+#endif // COMMAND_TABLE_H
@@ -0,0 +1,59 @@
+/**
+ * @file line_editor.h
+ * @brief Line discipline for the serial console: echo, backspace, line history.
+ *
+ * Pure logic without ESP-IDF dependencies. Input is fed in chunks of any size, so a whole
+ * pasted or scripted batch is handled by one call. CR, LF and CRLF all end a line. Up/down
+ * arrow sequences recall previous lines. Lines longer than the buffer are discarded and
+ * reported instead of being silently cut.
+ */
+#ifndef LINE_EDITOR_H
+#define LINE_EDITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_CONSOLE_MAX_LINE                                             // CONFIG_CONSOLE_MAX_LINE
+#define CONFIG_CONSOLE_MAX_LINE 256                                         // Longest accepted line including terminator
+#endif
+
+#ifndef CONFIG_CONSOLE_HISTORY_DEPTH                                        // CONFIG_CONSOLE_HISTORY_DEPTH
+#define CONFIG_CONSOLE_HISTORY_DEPTH 8                                      // Lines kept for recall
+#endif
+
+typedef void (*line_editor_write_t)(const char *data, size_t len);
+typedef void (*line_editor_line_t)(char *line, void *ctx);
+
+typedef struct {
+    char line[CONFIG_CONSOLE_MAX_LINE];
+    size_t len;
+    char history[CONFIG_CONSOLE_HISTORY_DEPTH][CONFIG_CONSOLE_MAX_LINE];
+    uint8_t history_count;
+    uint8_t history_next;                                                   // Slot written by the next line
+    uint8_t history_browse;                                                 // Steps back while browsing, 0 when editing
+    uint8_t escape;                                                         // Escape sequence parser state
+    bool discarding;                                                        // Line overflowed, skip until end of line
+    bool last_cr;                                                           // Swallow LF of CRLF
+    line_editor_write_t echo;                                               // NULL disables echo
+    line_editor_line_t on_line;
+    void *ctx;
+    uint32_t lines;                                                         // Completed lines
+    uint32_t overflows;                                                     // Discarded long lines
+} line_editor_t;
+
+/**
+ * @brief Initializes editor.
+ * @param ed Editor.
+ * @param echo Writes echo and editing sequences back to the terminal, may be NULL.
+ * @param on_line Called with each completed non-empty line; the line may be modified in place.
+ * @param ctx Passed to `on_line`.
+ **/
+void line_editor_init(line_editor_t *ed, line_editor_write_t echo, line_editor_line_t on_line, void *ctx);
+
+/**
+ * @brief Processes received bytes, calling `on_line` for every completed line.
+ **/
+void line_editor_feed(line_editor_t *ed, const char *data, size_t len);
+
+#endif // LINE_EDITOR_H
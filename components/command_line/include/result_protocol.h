@@ -0,0 +1,93 @@
+/**
+ * @file result_protocol.h
+ * @brief Framed binary records for scan results and counters on the console UART.
+ *
+ * Every record is sent as `0x00 | COBS(payload) | 0x00`, where payload is
+ * `type u8 | version u8 | length u16 | body | crc32 u32` (little endian, CRC-32 as zlib over
+ * everything before it). COBS removes zero bytes from the payload, so a receiver resynchronizes
+ * on the next zero byte after any text or log output mixed into the stream. Bodies are the
+ * in-memory structs below, copied as they are; `tools/result_decoder.py` mirrors their layout.
+ */
+#ifndef RESULT_PROTOCOL_H
+#define RESULT_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ap_table.h"
+#include "station_table.h"
+#include "hop_scheduler.h"
+#include "sniffer.h"
+#include "airtime_meter.h"
+#include "sketch_monitor.h"
+#include "scan_delta.h"
+
+#define RESULT_PROTOCOL_VERSION 2
+
+#define RESULT_MAX_BODY 255
+#define RESULT_MAX_FRAME (2 + 1 + 4 + RESULT_MAX_BODY + 4 + 1)             // Delimiters, COBS overhead, header, body, CRC
+
+typedef enum {
+    RESULT_AP = 0x01,                                                       // result_ap_t
+    RESULT_STATION = 0x02,                                                  // wifictl_station_t
+    RESULT_CHANNEL = 0x03,                                                  // hop_channel_state_t
+    RESULT_SNIFFER_COUNTERS = 0x04,                                         // wifictl_sniffer_stats_t
+    RESULT_SCAN_DONE = 0x05,                                                // result_scan_done_t
+    RESULT_LIST_END = 0x06,                                                 // result_list_end_t
+    RESULT_AIRTIME_CHANNEL = 0x07,                                          // airtime_channel_summary_t
+    RESULT_AIRTIME_BSSID = 0x08,                                            // airtime_bssid_summary_t
+    RESULT_SKETCH_CENSUS = 0x09,                                            // wifictl_sketch_census_t
+    RESULT_SKETCH_TALKER = 0x0A,                                            // sketch_talker_t
+    RESULT_SCAN_DELTA = 0x0B,                                               // scan_delta_event_t
+} result_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t id;                                                            // AP table id
+    wifictl_ap_info_t info;
+    int8_t rssi;                                                            // Latest RSSI
+    uint8_t authmode;                                                       // wifi_auth_mode_t
+    uint8_t pairwise_cipher;                                                // wifi_cipher_type_t
+    uint8_t group_cipher;                                                   // wifi_cipher_type_t
+    uint8_t ssid[33];
+} result_ap_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t first_result_ms;
+    uint32_t total_ms;
+    uint16_t ap_count;                                                      // APs in the table after the scan
+} result_scan_done_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                                           // Record type the list consisted of
+    uint16_t count;
+} result_list_end_t;
+
+// Layouts are part of the protocol: bump RESULT_PROTOCOL_VERSION and update the decoder when they change
+_Static_assert(sizeof(wifictl_ap_info_t) == 20, "wifictl_ap_info_t layout changed");
+_Static_assert(sizeof(result_ap_t) == 59, "result_ap_t layout changed");
+_Static_assert(sizeof(wifictl_station_t) == 28, "wifictl_station_t layout changed");
+_Static_assert(sizeof(hop_channel_state_t) == 28, "hop_channel_state_t layout changed");
+_Static_assert(sizeof(wifictl_sniffer_stats_t) == 20, "wifictl_sniffer_stats_t layout changed");
+_Static_assert(sizeof(airtime_channel_summary_t) == 36, "airtime_channel_summary_t layout changed");
+_Static_assert(sizeof(airtime_bssid_summary_t) == 28, "airtime_bssid_summary_t layout changed");
+_Static_assert(sizeof(wifictl_sketch_census_t) == 16, "wifictl_sketch_census_t layout changed");
+_Static_assert(sizeof(sketch_talker_t) == 16, "sketch_talker_t layout changed");
+_Static_assert(sizeof(scan_delta_event_t) == 14, "scan_delta_event_t layout changed");
+
+/**
+ * @brief Encodes one record into a complete frame.
+ * @param type Record type.
+ * @param body Record body.
+ * @param len Body length, at most RESULT_MAX_BODY.
+ * @param out Destination.
+ * @param out_size Size of `out`, at least RESULT_MAX_FRAME.
+ * @return Frame length, 0 if the body is too long or `out` too small.
+ **/
+size_t result_frame_encode(uint8_t type, const void *body, size_t len, uint8_t *out, size_t out_size);
+
+/**
+ * @brief Computes CRC-32 (IEEE 802.3, as zlib).
+ **/
+uint32_t result_crc32(const uint8_t *data, size_t len);
+
+#endif // RESULT_PROTOCOL_H
@@ -1,14 +1,883 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "command_line.h"
 #include "wifi_controller.h"
 #include "ap_scanner.h"
+#include "scan_monitor.h"
+#include "sniffer.h"
+#include "pcap_export.h"
+#include "channel_hopper.h"
+#include "station_table.h"
+#include "airtime_monitor.h"
+#include "sketch_monitor.h"
+#include "pcap_replay.h"
+#include "sniffer_fanout.h"
+#include "line_editor.h"
+#include "command_table.h"
+#include "result_protocol.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "capture_log.h"
+#include "sd_card.h"
 
 static const char *TAG = "serial_comm";
 
+static bool binary_output = false;                                                   // Framed records instead of text, see result_protocol.h
+static const char *scan_done_prompt = NULL;                                          // Printed after the results of the next scan
+static SemaphoreHandle_t record_mutex = NULL;                                        // Scan callbacks emit from the event task
+
+static void console_write(const char *data, size_t len) {
+    if (!wifictl_pcap_export_owns_port(UART_NUM)) {                                  // Echo would corrupt the PCAP stream
+        uart_write_bytes(UART_NUM, data, len);
+    }
+}
+
+static void emit_record(uint8_t type, const void *body, size_t len) {
+    static uint8_t frame[RESULT_MAX_FRAME];
+    xSemaphoreTake(record_mutex, portMAX_DELAY);
+    size_t n = result_frame_encode(type, body, len, frame, sizeof(frame));
+    if (n > 0 && !wifictl_pcap_export_owns_port(UART_NUM)) {                         // Would corrupt the PCAP stream
+        fflush(stdout);                                                              // Keep order with buffered text output
+        uint32_t started_us = METRIC_NOW_US();
+        uart_write_bytes(UART_NUM, frame, n);
+        METRIC_SINCE_US(METRIC_HIST_UART, started_us);
+        METRIC_ADD(METRIC_UART_BYTES, n);
+    }
+    xSemaphoreGive(record_mutex);
+}
+
+static void emit_list_end(uint8_t type, size_t count) {
+    result_list_end_t end = { .type = type, .count = (uint16_t) count };
+    emit_record(RESULT_LIST_END, &end, sizeof(end));
+}
+
+static bool fill_result_ap(uint16_t id, result_ap_t *ap) {                           // Serializes AP table entry without formatting
+    wifictl_ap_info_t info;                                                          // Packed member may be unaligned
+    wifi_ap_record_t record;
+    if (!wifictl_ap_table_record(id, &record) || !wifictl_ap_table_info(id, &info)) {
+        return false;
+    }
+    ap->id = id;
+    ap->info = info;
+    ap->rssi = record.rssi;
+    ap->authmode = record.authmode;
+    ap->pairwise_cipher = record.pairwise_cipher;
+    ap->group_cipher = record.group_cipher;
+    memcpy(ap->ssid, record.ssid, sizeof(ap->ssid));
+    return true;
+}
+
+static bool emit_ap(uint16_t id) {
+    result_ap_t ap;
+    if (!fill_result_ap(id, &ap)) {
+        return false;
+    }
+    emit_record(RESULT_AP, &ap, sizeof(ap));
+    return true;
+}
+
+static size_t parse_channel_list(const char *text, uint8_t *channels, size_t max) {  // Parses "1,6,11"
+    size_t count = 0;
+    while (*text != '\0' && count < max) {
+        char *end;
+        long channel = strtol(text, &end, 10);
+        if (end == text || channel < 1 || channel > 14) {
+            return 0;
+        }
+        channels[count++] = (uint8_t) channel;
+        text = (*end == ',') ? end + 1 : end;
+        while (*text == ' ') {
+            text++;
+        }
+    }
+    return count;
+}
+
+static void print_scan_progress(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    if (binary_output) {
+        for (uint16_t i = 0; i < count; i++) {
+            emit_ap(ids[i]);
+        }
+        if (done) {
+            wifictl_unregister_scan_callback(print_scan_progress);                    // Background scans report deltas only
+            uint32_t first_result_ms, total_ms;
+            wifictl_scan_get_timing(&first_result_ms, &total_ms);
+            result_scan_done_t summary = {
+                .first_result_ms = first_result_ms,
+                .total_ms = total_ms,
+                .ap_count = (uint16_t) wifictl_ap_table_count(),
+            };
+            emit_record(RESULT_SCAN_DONE, &summary, sizeof(summary));
+        }
+        return;
+    }
+    for (uint16_t i = 0; i < count; i++) {                                            // Numbers are stable AP table ids
+        wifi_ap_record_t record;
+        if (wifictl_ap_table_record(ids[i], &record)) {
+            print_ap_record(ids[i], &record);
+        }
+    }
+    if (done) {
+        wifictl_unregister_scan_callback(print_scan_progress);
+        uint32_t first_result_ms, total_ms;
+        wifictl_scan_get_timing(&first_result_ms, &total_ms);
+        printf("Total APs known: %u (first result after %lu ms, scan took %lu ms)\n\n", (unsigned) wifictl_ap_table_count(),
+               (unsigned long) first_result_ms, (unsigned long) total_ms);
+        if (scan_done_prompt != NULL) {
+            printf("%s", scan_done_prompt);
+            scan_done_prompt = NULL;
+        }
+    }
+}
+
+static void print_scan_delta(const scan_delta_event_t *events, size_t count) {      // Called from the event loop task
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_SCAN_DELTA, &events[i], sizeof(events[i]));
+        }
+        emit_list_end(RESULT_SCAN_DELTA, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const scan_delta_event_t *e = &events[i];
+        printf("%c %02x:%02x:%02x:%02x:%02x:%02x CH %2u RSSI %4d %s", e->kind == SCAN_DELTA_NEW ? '+' :
+               e->kind == SCAN_DELTA_GONE ? '-' : '~', e->ap.bssid[0], e->ap.bssid[1], e->ap.bssid[2], e->ap.bssid[3],
+               e->ap.bssid[4], e->ap.bssid[5], e->ap.channel, e->ap.rssi, get_auth_mode_str(e->ap.authmode));
+        if (e->kind == SCAN_DELTA_NEW) {
+            wifi_ap_record_t record;
+            bool known = wifictl_ap_table_record(wifictl_ap_table_find(e->ap.bssid), &record);
+            printf(" SSID %s", known ? (const char *) record.ssid : "?");
+        }
+        if (e->changed & SCAN_DELTA_RSSI) {
+            printf(", RSSI was %d", e->previous_rssi);
+        }
+        if (e->changed & SCAN_DELTA_CHANNEL) {
+            printf(", CH was %u", e->previous_channel);
+        }
+        if (e->changed & SCAN_DELTA_AUTH) {
+            printf(", was %s", get_auth_mode_str(e->previous_authmode));
+        }
+        printf("\n");
+    }
+}
+
+static void print_scan_watch_stats(void) {
+    wifictl_scan_monitor_stats_t stats;
+    wifictl_scan_monitor_get_stats(&stats);
+    printf("Background scan %s: %lu rounds, %lu skipped, %lu discarded, %lu changes, %lu APs tracked, %lu untracked\n",
+           wifictl_scan_monitor_active() ? "on" : "off", (unsigned long) stats.rounds, (unsigned long) stats.skipped,
+           (unsigned long) stats.discarded, (unsigned long) stats.events, (unsigned long) stats.tracked,
+           (unsigned long) stats.untracked);
+}
+
+static void print_hop_stats(void) {
+    wifictl_channel_hop_stats_t stats;
+    wifictl_channel_hop_get_stats(&stats);
+    if (binary_output) {
+        for (int i = 0; i < stats.scheduler.count; i++) {
+            emit_record(RESULT_CHANNEL, &stats.scheduler.channels[i], sizeof(hop_channel_state_t));
+        }
+        emit_list_end(RESULT_CHANNEL, stats.scheduler.count);
+        wifictl_sniffer_stats_t counters;
+        wifictl_sniffer_get_stats(&counters);
+        emit_record(RESULT_SNIFFER_COUNTERS, &counters, sizeof(counters));
+        return;
+    }
+    printf("Hopping %s, %lu ms, %lu BSSIDs, last discovery at %lu ms\n", wifictl_channel_hop_active() ? "on" : "off",
+           (unsigned long) stats.running_ms, (unsigned long) stats.unique_bssids, (unsigned long) stats.last_discovery_ms);
+    for (int i = 0; i < stats.scheduler.count; i++) {
+        const hop_channel_state_t *ch = &stats.scheduler.channels[i];
+        printf("CH %2d: visits %lu, frames %lu, new %lu, dwell %lu ms, next %u ms\n", ch->channel,
+               (unsigned long) ch->visits, (unsigned long) ch->frames, (unsigned long) ch->new_bssids,
+               (unsigned long) ch->dwell_total_ms, hop_scheduler_dwell(&stats.scheduler, i));
+    }
+}
+
+static void print_q16_percent(uint32_t q16) {
+    uint32_t permille = (uint32_t) (((uint64_t) q16 * 1000 + AIRTIME_Q16_ONE / 2) / AIRTIME_Q16_ONE);
+    printf("%3lu.%lu%%", (unsigned long) (permille / 10), (unsigned long) (permille % 10));
+}
+
+static void print_airtime_channels(void) {
+    airtime_channel_summary_t channels[AIRTIME_CHANNELS];
+    size_t count = wifictl_airtime_channels(channels, AIRTIME_CHANNELS);
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_AIRTIME_CHANNEL, &channels[i], sizeof(channels[i]));
+        }
+        emit_list_end(RESULT_AIRTIME_CHANNEL, count);
+        return;
+    }
+    uint32_t unrated, evicted;
+    wifictl_airtime_get_counters(&unrated, &evicted);
+    printf("Airtime %s, window %d ms, %lu frames without rate\n", wifictl_airtime_active() ? "on" : "off",
+           CONFIG_AIRTIME_BUCKETS * CONFIG_AIRTIME_BUCKET_MS, (unsigned long) unrated);
+    for (size_t i = 0; i < count; i++) {
+        const airtime_channel_summary_t *ch = &channels[i];
+        printf("CH %2u: busy ", ch->channel);
+        print_q16_percent(ch->utilization_q16);
+        printf(" of %6lu ms, mgmt %7lu us/%5lu, ctrl %7lu us/%5lu, data %7lu us/%5lu\n", (unsigned long) ch->listen_ms,
+               (unsigned long) ch->airtime_us[AIRTIME_MGMT], (unsigned long) ch->frames[AIRTIME_MGMT],
+               (unsigned long) ch->airtime_us[AIRTIME_CTRL], (unsigned long) ch->frames[AIRTIME_CTRL],
+               (unsigned long) ch->airtime_us[AIRTIME_DATA], (unsigned long) ch->frames[AIRTIME_DATA]);
+    }
+}
+
+static void print_airtime_bssids(void) {
+    static airtime_bssid_summary_t bssids[CONFIG_AIRTIME_BSSIDS];                    // Too large for the console task stack
+    size_t count = wifictl_airtime_bssids(bssids, CONFIG_AIRTIME_BSSIDS);
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_AIRTIME_BSSID, &bssids[i], sizeof(bssids[i]));
+        }
+        emit_list_end(RESULT_AIRTIME_BSSID, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const airtime_bssid_summary_t *b = &bssids[i];
+        printf("%02x:%02x:%02x:%02x:%02x:%02x CH %2u: ", b->bssid[0], b->bssid[1], b->bssid[2], b->bssid[3],
+               b->bssid[4], b->bssid[5], b->channel);
+        print_q16_percent(b->share_q16);
+        printf(", mgmt %7lu us, data %7lu us, %5lu frames\n", (unsigned long) b->airtime_us[AIRTIME_MGMT],
+               (unsigned long) b->airtime_us[AIRTIME_DATA], (unsigned long) b->frames);
+    }
+}
+
+static void print_sketch_census(const wifictl_sketch_census_t *rows, size_t count, bool bssids) {
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_SKETCH_CENSUS, &rows[i], sizeof(rows[i]));
+        }
+        emit_list_end(RESULT_SKETCH_CENSUS, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_sketch_census_t *row = &rows[i];
+        if (bssids) {
+            printf("%02x:%02x:%02x:%02x:%02x:%02x CH %2u: ", row->bssid[0], row->bssid[1], row->bssid[2],
+                   row->bssid[3], row->bssid[4], row->bssid[5], row->channel);
+        } else if (row->channel == 0) {
+            printf("All:   ");
+        } else {
+            printf("CH %2u: ", row->channel);
+        }
+        printf("~%5lu MACs in window, ~%6lu since start\n", (unsigned long) row->window, (unsigned long) row->total);
+    }
+}
+
+static void print_sketch_channels(void) {
+    wifictl_sketch_census_t rows[SKETCH_CHANNELS + 1];
+    size_t count = wifictl_sketch_channels(rows, SKETCH_CHANNELS + 1);
+    if (!binary_output) {
+        wifictl_sketch_stats_t stats;
+        wifictl_sketch_get_stats(&stats);
+        printf("Sketches %s, %lu frames, %lu bytes, %lu windows of %d s, current %lu s, %lu frames of untracked BSSIDs\n",
+               wifictl_sketch_active() ? "on" : "off", (unsigned long) stats.frames, (unsigned long) stats.bytes,
+               (unsigned long) stats.windows, CONFIG_SKETCH_WINDOW_S, (unsigned long) stats.window_age_s,
+               (unsigned long) stats.bssid_overflow);
+    }
+    print_sketch_census(rows, count, false);
+}
+
+static void print_sketch_bssids(void) {
+    static wifictl_sketch_census_t rows[CONFIG_SKETCH_BSSIDS * 2];                   // Too large for the console task stack
+    print_sketch_census(rows, wifictl_sketch_bssids(rows, CONFIG_SKETCH_BSSIDS * 2), true);
+}
+
+static void print_sketch_talkers(sketch_metric_t metric, bool window_only) {
+    static sketch_talker_t talkers[CONFIG_SKETCH_TOPK];                              // Too large for the console task stack
+    size_t count = wifictl_sketch_talkers(metric, window_only, talkers, CONFIG_SKETCH_TOPK);
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_SKETCH_TALKER, &talkers[i], sizeof(talkers[i]));
+        }
+        emit_list_end(RESULT_SKETCH_TALKER, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {                                             // True count lies in [count - error, count]
+        const sketch_talker_t *t = &talkers[i];
+        printf("%02x:%02x:%02x:%02x:%02x:%02x %10lu %s (+0/-%lu)\n", t->mac[0], t->mac[1], t->mac[2], t->mac[3],
+               t->mac[4], t->mac[5], (unsigned long) t->count, metric == SKETCH_BYTES ? "bytes" : "frames",
+               (unsigned long) t->error);
+    }
+}
+
+static bool parse_mac(const char *text, uint8_t mac[6]) {                            // Parses "aa:bb:cc:dd:ee:ff"
+    unsigned int b[6];
+    if (sscanf(text, "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t) b[i];
+    }
+    return true;
+}
+
+static void print_stations(const uint8_t *bssid) {
+    static wifictl_station_t stations[CONFIG_STATION_TABLE_CAPACITY];              // Too large for the console task stack
+    size_t count = wifictl_station_table_snapshot(stations, CONFIG_STATION_TABLE_CAPACITY, bssid);
+    if (binary_output) {
+        for (size_t i = 0; i < count; i++) {
+            emit_record(RESULT_STATION, &stations[i], sizeof(stations[i]));
+        }
+        emit_list_end(RESULT_STATION, count);
+        return;
+    }
+    uint32_t now_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_station_t *st = &stations[i];
+        printf("%02x:%02x:%02x:%02x:%02x:%02x -> %02x:%02x:%02x:%02x:%02x:%02x CH %2u RSSI %4d frames %lu bytes %lu age %lu ms\n",
+               st->mac[0], st->mac[1], st->mac[2], st->mac[3], st->mac[4], st->mac[5],
+               st->bssid[0], st->bssid[1], st->bssid[2], st->bssid[3], st->bssid[4], st->bssid[5],
+               st->channel, st->rssi, (unsigned long) st->frames, (unsigned long) st->bytes, (unsigned long) (now_ms - st->last_seen_ms));
+    }
+    wifictl_station_table_stats_t stats;
+    wifictl_station_table_get_stats(&stats);
+    printf("Stations: %u shown, %u tracked, %lu ignored frames, %lu evictions\n\n", (unsigned) count,
+           (unsigned) wifictl_station_table_count(), (unsigned long) stats.ignored, (unsigned long) stats.evictions);
+}
+
+static void print_filter_stats(void) {
+    static capture_filter_t filter;                                                // Too large for the console task stack
+    wifictl_sniffer_get_filter(&filter);
+    if (filter.insn_count == 0) {
+        printf("No capture filter set\n");
+        return;
+    }
+    wifictl_sniffer_stats_t stats;
+    wifictl_sniffer_get_stats(&stats);
+    printf("Filter: %lu evaluated, %lu matched, %lu rejected before copy\n", (unsigned long) filter.evaluated,
+           (unsigned long) filter.matched, (unsigned long) stats.filtered);
+    for (size_t pc = 0; pc < filter.insn_count; pc++) {
+        char text[48];
+        capture_filter_format_insn(&filter, pc, text, sizeof(text));
+        printf("%2u: %-32s hits %lu\n", (unsigned) pc, text, (unsigned long) filter.hits[pc]);
+    }
+}
+
+static void print_metrics(void) {
+    if (!metrics_enabled()) {
+        printf("Metrics disabled (CONFIG_METRICS_ENABLED)\n");
+        return;
+    }
+    static metrics_snapshot_t snapshot;                                              // Too large for the console task stack
+    metrics_snapshot(&snapshot);
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        printf("%-18s %lu\n", metrics_counter_name(i), (unsigned long) snapshot.counters[i]);
+    }
+    printf("%-12s %10s %8s %8s %8s %8s\n", "histogram", "count", "p50", "p90", "p99", "max");
+    for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+        const metrics_hist_snapshot_t *hist = &snapshot.hists[h];
+        printf("%-12s %10lu %8lu %8lu %8lu %8lu %s\n", metrics_hist_name(h), (unsigned long) hist->count,
+               (unsigned long) metrics_hist_percentile(hist, 50), (unsigned long) metrics_hist_percentile(hist, 90),
+               (unsigned long) metrics_hist_percentile(hist, 99), (unsigned long) hist->max, metrics_hist_unit(h));
+    }
+}
+
+static void print_deferred_log_stats(void) {
+    deferred_log_stats_t stats;
+    deferred_log_get_stats(&stats);
+    printf("deferred log: written %lu, dropped %lu, formatted %lu\n", (unsigned long) stats.written,
+           (unsigned long) stats.dropped, (unsigned long) stats.formatted);
+}
+
+static void print_fanout_stats(void) {
+    wifictl_fanout_consumer_stats_t consumers[4];
+    size_t count = wifictl_fanout_get_stats(consumers, 4);
+    for (size_t i = 0; i < count && i < 4; i++) {
+        printf("fan-out %-10s delivered %lu, backlog %lu\n", consumers[i].name, (unsigned long) consumers[i].delivered,
+               (unsigned long) consumers[i].backlog);
+    }
+}
+
+static void run_fanout_benchmark(void) {
+    uint32_t ns_per_frame[SNIFFER_FANOUT_BENCH_MAX_CONSUMERS];
+    wifictl_fanout_benchmark(10000, ns_per_frame);
+    for (int i = 0; i < SNIFFER_FANOUT_BENCH_MAX_CONSUMERS; i++) {
+        printf("%d consumers: %lu ns per frame\n", i + 1, (unsigned long) ns_per_frame[i]);
+    }
+}
+
+static void run_log_benchmark(void) {
+    uint32_t deferred_ns, direct_ns;
+    deferred_log_benchmark(1000, &deferred_ns, &direct_ns);
+    printf("per call: DLOGI %lu ns, ESP_LOGI %lu ns (output discarded)\n", (unsigned long) deferred_ns,
+           (unsigned long) direct_ns);
+}
+
+static void print_wifi_lifecycle(void) {
+    static wifictl_lifecycle_stats_t stats;
+    wifictl_get_lifecycle_stats(&stats);
+    printf("Mode: %s, first scan done at %lu ms uptime\n", wifictl_mode_name(stats.mode), (unsigned long) stats.first_scan_ms);
+    printf("%-8s    %-8s %8s %10s %10s\n", "from", "to", "count", "last_us", "max_us");
+    for (int from = 0; from < WIFICTL_MODE_COUNT; from++) {
+        for (int to = 0; to < WIFICTL_MODE_COUNT; to++) {
+            const wifictl_transition_t *t = &stats.transitions[from][to];
+            if (t->count > 0) {
+                printf("%-8s -> %-8s %8lu %10lu %10lu\n", wifictl_mode_name(from), wifictl_mode_name(to),
+                       (unsigned long) t->count, (unsigned long) t->last_us, (unsigned long) t->max_us);
+            }
+        }
+    }
+}
+
+static void log_frames(const wifictl_frame_t *const *frames, size_t count) {        // Sniffer aggregate stage
+    for (size_t i = 0; i < count; i++) {
+        capture_log_append(CAPTURE_LOG_FRAME, &frames[i]->pkt, frames[i]->len);
+    }
+}
+
+static void log_scan_results(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    for (uint16_t i = 0; i < count; i++) {
+        result_ap_t ap;
+        if (fill_result_ap(ids[i], &ap)) {
+            capture_log_append(CAPTURE_LOG_AP, &ap, sizeof(ap));
+        }
+    }
+}
+
+static bool print_log_record(uint8_t type, uint64_t timestamp_ms, const void *data, size_t len, void *ctx) {
+    size_t *count = (size_t *) ctx;
+    (*count)++;
+    if (type == CAPTURE_LOG_AP && len == sizeof(result_ap_t)) {
+        result_ap_t ap;
+        memcpy(&ap, data, sizeof(ap));
+        printf("%llu AP %02x:%02x:%02x:%02x:%02x:%02x CH %2u RSSI %4d SSID %.32s\n", (unsigned long long) timestamp_ms,
+               ap.info.bssid[0], ap.info.bssid[1], ap.info.bssid[2], ap.info.bssid[3], ap.info.bssid[4], ap.info.bssid[5],
+               ap.info.channel, ap.rssi, (const char *) ap.ssid);
+    } else if (type == CAPTURE_LOG_FRAME && len >= sizeof(wifi_promiscuous_pkt_t)) {
+        wifi_pkt_rx_ctrl_t rx;
+        memcpy(&rx, data, sizeof(rx));
+        printf("%llu frame CH %2u RSSI %4d len %u\n", (unsigned long long) timestamp_ms, rx.channel, rx.rssi,
+               (unsigned) (len - sizeof(wifi_promiscuous_pkt_t)));
+    } else {
+        printf("%llu type %u len %u\n", (unsigned long long) timestamp_ms, type, (unsigned) len);
+    }
+    return true;
+}
+
+static void print_log_stats(void) {
+    capture_log_stats_t stats;
+    capture_log_get_stats(&stats);
+    printf("Log %s: %lu segments from %lu, time %llu-%llu ms\n", capture_log_is_open() ? "open" : "closed",
+           (unsigned long) stats.segments, (unsigned long) stats.first_segment, (unsigned long long) stats.first_ms,
+           (unsigned long long) stats.last_ms);
+    printf("records %lu, blocks %lu, dropped %lu, write errors %lu\n", (unsigned long) stats.records,
+           (unsigned long) stats.blocks_written, (unsigned long) stats.dropped, (unsigned long) stats.write_errors);
+    printf("recovery: %lu blocks, %lu bytes truncated, %lu ms\n", (unsigned long) stats.recovered_blocks,
+           (unsigned long) stats.truncated_bytes, (unsigned long) stats.recovery_ms);
+}
+
+static char joined_args[CONFIG_CONSOLE_MAX_LINE];                                    // Commands run on the console task only
+
+static const char *join_args(int argc, char **argv, int first) {                    // Rejoins arguments split by the dispatcher
+    size_t len = 0;
+    joined_args[0] = '\0';
+    for (int i = first; i < argc && len < sizeof(joined_args); i++) {
+        len += snprintf(joined_args + len, sizeof(joined_args) - len, i > first ? " %s" : "%s", argv[i]);
+    }
+    return joined_args;
+}
+
+static bool cmd_help(int argc, char **argv, void *ctx) {
+    printf("Commands :\n");
+    for (size_t i = 0; i < command_table_count(); i++) {
+        const command_t *command = command_table_get(i);
+        printf("[ %s%s%s ] %s\n", command->name, command->usage[0] != '\0' ? " " : "", command->usage, command->help);
+    }
+    printf("Commands may be abbreviated to any unique prefix.\n");
+    return true;
+}
+
+static bool cmd_scan_watch(int argc, char **argv) {                                 // Arguments after "watch"
+    if (argc == 1 && strcmp(argv[0], "stop") == 0) {
+        wifictl_scan_monitor_stop();
+        return true;
+    }
+    if (argc == 1 && strcmp(argv[0], "stats") == 0) {
+        print_scan_watch_stats();
+        return true;
+    }
+    if (argc > 2) {
+        return false;
+    }
+    uint32_t interval_s = CONFIG_SCAN_MONITOR_INTERVAL_S;
+    uint8_t channels[14];
+    size_t count = 0;
+    if (argc >= 1) {
+        char *end;
+        interval_s = (uint32_t) strtoul(argv[0], &end, 10);
+        if (*end != '\0' || interval_s == 0) {
+            return false;
+        }
+    }
+    if (argc == 2 && (count = parse_channel_list(argv[1], channels, sizeof(channels))) == 0) {
+        return false;
+    }
+    esp_err_t err = wifictl_scan_monitor_start(interval_s, count > 0 ? channels : NULL, count, print_scan_delta);
+    if (err != ESP_OK) {
+        printf("Failed to start background scan: %s\n", esp_err_to_name(err));
+    }
+    return true;
+}
+
+static bool cmd_scan(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        ap_scan();
+    } else if (argc >= 2 && strcmp(argv[1], "watch") == 0) {
+        return cmd_scan_watch(argc - 2, argv + 2);
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        wifictl_scan_cancel();
+    } else if (argc == 2 && strcmp(argv[1], "beacon") == 0) {
+        ESP_LOGI(TAG, "User requested to scan beacon");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_aps(int argc, char **argv, void *ctx) {
+    if (argc != 1) {
+        return false;
+    }
+    if (binary_output) {
+        static uint16_t ids[CONFIG_AP_TABLE_CAPACITY];
+        size_t count = wifictl_ap_table_sorted(AP_SORT_RSSI, ids, CONFIG_AP_TABLE_CAPACITY);
+        size_t emitted = 0;
+        for (size_t i = 0; i < count; i++) {
+            emitted += emit_ap(ids[i]);
+        }
+        emit_list_end(RESULT_AP, emitted);
+    } else {
+        print_ap_list();
+    }
+    return true;
+}
+
+static bool cmd_output(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        printf("Output: %s\n", binary_output ? "binary" : "text");
+    } else if (argc == 2 && strcmp(argv[1], "binary") == 0) {
+        binary_output = true;
+    } else if (argc == 2 && strcmp(argv[1], "text") == 0) {
+        binary_output = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_stations(int argc, char **argv, void *ctx) {
+    uint8_t bssid[6];
+    if (argc > 2 || (argc == 2 && !parse_mac(argv[1], bssid))) {
+        return false;
+    }
+    print_stations(argc == 2 ? bssid : NULL);
+    return true;
+}
+
+static bool cmd_filter(int argc, char **argv, void *ctx) {
+    if (argc < 2) {
+        return false;
+    }
+    if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        wifictl_sniffer_set_filter(NULL, NULL);
+    } else if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        print_filter_stats();
+    } else {
+        const char *error = NULL;
+        if (wifictl_sniffer_set_filter(join_args(argc, argv, 1), &error) != ESP_OK) {
+            printf("Invalid filter: %s\n", error);
+        }
+    }
+    return true;
+}
+
+static bool cmd_pcap(int argc, char **argv, void *ctx) {
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        if (wifictl_mode_get() == WIFICTL_MODE_SNIFFING) {
+            wifictl_mode_enter(WIFICTL_MODE_IDLE);                                   // Stops hopper and sniffer
+        }
+        wifictl_pcap_export_stop();                                                  // Restores baud rate, stdout and logging
+        return true;
+    }
+    int channel = argc >= 2 ? atoi(argv[1]) : 0;
+    bool compact = argc == 3 && strcmp(argv[2], "compact") == 0;
+    if (channel < 1 || channel > 14 || argc > (compact ? 3 : 2)) {
+        return false;
+    }
+    if (CONFIG_PCAP_EXPORT_UART_NUM == UART_NUM) {                                   // Console output is muted while streaming
+        printf("Streaming %sPCAP on channel %d at %d baud, send 'pcap stop' at that rate to stop.\n",
+               compact ? "compact " : "", channel, CONFIG_PCAP_EXPORT_BAUD);
+    } else {
+        printf("Streaming %sPCAP on channel %d to UART%d at %d baud.\n", compact ? "compact " : "", channel,
+               CONFIG_PCAP_EXPORT_UART_NUM, CONFIG_PCAP_EXPORT_BAUD);
+    }
+    if (wifictl_pcap_export_start(CONFIG_PCAP_EXPORT_UART_NUM, CONFIG_PCAP_EXPORT_BAUD, compact) == ESP_OK
+        && wifictl_sniffer_start(channel) != ESP_OK) {
+        wifictl_pcap_export_stop();
+    }
+    return true;
+}
+
+static void print_replay_stats(void) {
+    wifictl_replay_stats_t stats;
+    wifictl_replay_get_stats(&stats);
+    if (!stats.installed) {
+        printf("Replay not installed, frames come from the radio\n");
+        return;
+    }
+    wifictl_sniffer_stats_t sniffer;
+    wifictl_sniffer_get_stats(&sniffer);
+    printf("%s, speed %lu%%, %lu loops\n", stats.running ? "running" : stats.finished ? "finished" : "idle",
+           (unsigned long) stats.speed_percent, (unsigned long) stats.loops);
+    printf("frames %lu in %lu ms (%lu/s), masked %lu, skipped %lu, errors %lu, max late %lu us\n",
+           (unsigned long) stats.frames, (unsigned long) stats.elapsed_ms,
+           (unsigned long) (stats.elapsed_ms ? (uint64_t) stats.frames * 1000 / stats.elapsed_ms : 0),
+           (unsigned long) stats.masked, (unsigned long) stats.skipped, (unsigned long) stats.errors,
+           (unsigned long) stats.late_max_us);
+    printf("sniffer captured %lu, filtered %lu, dropped %lu, post failed %lu, fan-out dropped %lu\n",
+           (unsigned long) sniffer.captured, (unsigned long) sniffer.filtered, (unsigned long) sniffer.dropped,
+           (unsigned long) sniffer.post_failed, (unsigned long) sniffer.fanout_dropped);
+}
+
+static bool cmd_replay(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        print_replay_stats();
+        return true;
+    }
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        if (wifictl_mode_get() == WIFICTL_MODE_SNIFFING) {
+            wifictl_mode_enter(WIFICTL_MODE_IDLE);                                   // Stops hopper and sniffer
+        }
+        wifictl_replay_uninstall();
+        return true;
+    }
+    if (argc > 4) {
+        return false;
+    }
+    uint32_t speed = 100;
+    if (argc >= 3) {
+        speed = strcmp(argv[2], "max") == 0 ? PCAP_REPLAY_MAX_SPEED : (uint32_t) atoi(argv[2]);
+        if (speed == 0 && strcmp(argv[2], "max") != 0) {
+            return false;
+        }
+    }
+    uint32_t loops = argc == 4 ? (uint32_t) atoi(argv[3]) : 1;
+
+    char path[64];
+    if (strchr(argv[1], '/') != NULL) {
+        snprintf(path, sizeof(path), "%s", argv[1]);
+    } else if (storage_sd_mount() == ESP_OK) {                                       // Bare 8.3 name: file on the SD card
+        snprintf(path, sizeof(path), "%s/%s", CONFIG_STORAGE_MOUNT_POINT, argv[1]);
+    } else {
+        printf("No SD card\n");
+        return true;
+    }
+    esp_err_t err = wifictl_replay_install(path, speed, loops);
+    if (err != ESP_OK) {
+        printf("Cannot replay %s: %s\n", path, esp_err_to_name(err));
+        return true;
+    }
+    printf("Replay of %s installed, start sniffing (pcap, hop, ...) to feed the pipeline\n", path);
+    return true;
+}
+
+static bool cmd_hop(int argc, char **argv, void *ctx) {
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        wifictl_channel_hop_stop();
+        wifictl_ap_table_track_beacons(false);
+        wifictl_station_table_track(false);
+        wifictl_sniffer_stop();
+        return true;
+    }
+    if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        print_hop_stats();
+        return true;
+    }
+
+    int first = 1;
+    bool adaptive = true;
+    if (argc > 1 && strcmp(argv[1], "rr") == 0) {                                   // Fixed round-robin for comparison
+        adaptive = false;
+        first++;
+    }
+    const char *list = join_args(argc, argv, first);
+    uint8_t channels[HOP_MAX_CHANNELS];
+    size_t count = parse_channel_list(list, channels, HOP_MAX_CHANNELS);
+    if (*list != '\0' && count == 0) {
+        return false;
+    }
+    esp_err_t err = wifictl_sniffer_start(count > 0 ? channels[0] : 1);
+    if (err != ESP_OK) {
+        printf("Failed to start sniffer: %s\n", esp_err_to_name(err));
+        return true;
+    }
+    wifictl_ap_table_track_beacons(true);                                            // Merge passive beacons into AP table
+    wifictl_station_table_track(true);                                               // Attribute data frames to stations
+    if (wifictl_channel_hop_start(count > 0 ? channels : NULL, count, adaptive) != ESP_OK) {
+        printf("Failed to start channel hopping\n");
+    }
+    return true;
+}
+
+static bool cmd_log(int argc, char **argv, void *ctx) {
+    if (argc >= 2 && argc <= 3 && strcmp(argv[1], "start") == 0) {
+        char dir[64];
+        if (argc == 3) {
+            snprintf(dir, sizeof(dir), "%s", argv[2]);
+        } else if (storage_sd_mount() == ESP_OK) {
+            snprintf(dir, sizeof(dir), "%s/SURVEY", CONFIG_STORAGE_MOUNT_POINT);
+        } else {
+            printf("No SD card\n");
+            return true;
+        }
+        if (capture_log_open(dir) != ESP_OK) {
+            printf("Failed to open log in %s\n", dir);
+            return true;
+        }
+        wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, log_frames);
+        wifictl_register_scan_callback(log_scan_results);
+        print_log_stats();
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        wifictl_sniffer_unregister_batch_handler(log_frames);
+        wifictl_unregister_scan_callback(log_scan_results);
+        capture_log_close();
+    } else if (argc == 2 && strcmp(argv[1], "stats") == 0) {
+        print_log_stats();
+    } else if (argc == 4 && strcmp(argv[1], "read") == 0) {
+        size_t count = 0;
+        if (capture_log_read(strtoull(argv[2], NULL, 10), strtoull(argv[3], NULL, 10), print_log_record, &count) != ESP_OK) {
+            printf("Log not open or read error\n");
+        }
+        printf("%u records\n", (unsigned) count);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_airtime(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        print_airtime_channels();
+    } else if (argc == 2 && strcmp(argv[1], "bssids") == 0) {
+        print_airtime_bssids();
+    } else if (argc == 2 && strcmp(argv[1], "start") == 0) {
+        if (wifictl_airtime_start() != ESP_OK) {
+            printf("Failed to start airtime accounting\n");
+        }
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        wifictl_airtime_stop();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_sketch(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        print_sketch_channels();
+    } else if (argc == 2 && strcmp(argv[1], "start") == 0) {
+        if (wifictl_sketch_start() != ESP_OK) {
+            printf("Sketches already running\n");
+        }
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        wifictl_sketch_stop();
+    } else if (argc == 2 && strcmp(argv[1], "bssids") == 0) {
+        print_sketch_bssids();
+    } else if (argc >= 2 && argc <= 4 && strcmp(argv[1], "top") == 0) {
+        sketch_metric_t metric = SKETCH_FRAMES;
+        bool window_only = false;
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "bytes") == 0) {
+                metric = SKETCH_BYTES;
+            } else if (strcmp(argv[i], "window") == 0) {
+                window_only = true;
+            } else {
+                return false;
+            }
+        }
+        print_sketch_talkers(metric, window_only);
+    } else if (argc == 3 && strcmp(argv[1], "mac") == 0) {
+        uint8_t mac[6];
+        uint32_t window[SKETCH_METRICS], total[SKETCH_METRICS];
+        if (!parse_mac(argv[2], mac)) {
+            return false;
+        }
+        wifictl_sketch_lookup(mac, window, total);
+        printf("at most %lu frames, %lu bytes in window; %lu frames, %lu bytes since start\n",
+               (unsigned long) window[SKETCH_FRAMES], (unsigned long) window[SKETCH_BYTES],
+               (unsigned long) total[SKETCH_FRAMES], (unsigned long) total[SKETCH_BYTES]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_stats(int argc, char **argv, void *ctx) {
+    if (argc == 1) {
+        print_metrics();
+        print_deferred_log_stats();
+        print_fanout_stats();
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        metrics_reset();
+    } else if (argc == 2 && strcmp(argv[1], "logbench") == 0) {
+        run_log_benchmark();
+    } else if (argc == 2 && strcmp(argv[1], "fanout") == 0) {
+        run_fanout_benchmark();
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool cmd_wifi(int argc, char **argv, void *ctx) {
+    if (argc == 2 && strcmp(argv[1], "init") == 0) {
+        esp_err_t err = wifictl_init();
+        if (err != ESP_OK) {
+            printf("Wi-Fi initialization failed: %s\n", esp_err_to_name(err));
+        }
+    } else if (argc != 1) {
+        return false;
+    }
+    print_wifi_lifecycle();
+    return true;
+}
+
+static bool cmd_quit(int argc, char **argv, void *ctx) {
+    bool *keep_running = (bool *) ctx;
+    ESP_LOGI(TAG, "User requested to exit");
+    console_write("Exiting...\n", 11);
+    *keep_running = false;                                                           // Set keep_running to false to exit the loop
+    return true;
+}
+
+static const command_t console_commands[] = {
+    { "help",     "",                                  "Show this list",                        cmd_help },
+    { "scan",     "[stop | beacon | watch [seconds [ch,ch,...]] | watch stop | watch stats]", "Scan for APs, or report changes periodically", cmd_scan },
+    { "aps",      "",                                  "List known APs by signal strength",     cmd_aps },
+    { "output",   "[binary | text]",                   "Framed binary records or text results", cmd_output },
+    { "stations", "[bssid]",                           "List clients seen while hopping",       cmd_stations },
+    { "filter",   "<expression> | off | stats",        "Set capture filter",                    cmd_filter },
+    { "pcap",     "<channel> [compact] | stop",        "Stream captured frames as PCAP",        cmd_pcap },
+    { "hop",      "[rr] [ch,ch,...] | stop | stats",   "Sniff while hopping channels",          cmd_hop },
+    { "log",      "start [dir] | stop | stats | read <t0> <t1>", "Persist frames and scan results", cmd_log },
+    { "airtime",  "[start | stop | bssids]",           "Channel utilization while sniffing",    cmd_airtime },
+    { "sketch",   "[start | stop | bssids | top [bytes] [window] | mac <addr>]", "Distinct MACs and top talkers", cmd_sketch },
+    { "replay",   "<file> [percent | max] [loops] | stop", "Sniff frames from a PCAP file",     cmd_replay },
+    { "stats",    "[reset | logbench | fanout]",       "Show or clear runtime metrics",         cmd_stats },
+    { "wifi",     "[init]",                            "Show radio mode and switch timings",    cmd_wifi },
+    { "quit",     "",                                  "Exit console",                          cmd_quit },
+    { "exit",     "",                                  "Exit console",                          cmd_quit },
+};
+
+static QueueHandle_t uart_queue = NULL;
+static line_editor_t editor;                                                         // Holds line history, too large for the task stack
 
 void serial_comm_config(void) {                                                      // UART configuration
     uart_config_t uart_config = {
@@ -20,88 +889,95 @@ void serial_comm_config(void) {
         .rx_flow_ctrl_thresh = 0,                                                    // RX flow control threshold
     };
 
+    if (record_mutex == NULL) {
+        record_mutex = xSemaphoreCreateMutex();
+    }
     ESP_ERROR_CHECK(uart_param_config(UART_NUM, &uart_config));                      // Configure UART parameters
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, BUF_SIZE, BUF_SIZE, 10, NULL, 0)); // Install UART driver
+    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, BUF_SIZE * 2, BUF_SIZE, UART_EVENT_QUEUE_SIZE, &uart_queue, 0)); // Install UART driver with event queue
+    ESP_ERROR_CHECK(uart_enable_pattern_det_baud_intr(UART_NUM, '\n', 1, 9, 0, 0));   // Event on every newline
+    ESP_ERROR_CHECK(uart_pattern_queue_reset(UART_NUM, UART_EVENT_QUEUE_SIZE));
+}
+
+static void handle_line(char *line, void *arg) {                                   // Called by line editor for every line
+    uart_task_args_t *task_args = (uart_task_args_t *)arg;
+    if (!task_args->keep_running) {                                                  // Rest of a pasted batch after "quit"
+        return;
+    }
+    printf("CMD> %s \n", line);                                                      // Print the user input
+
+    if (task_args->state == STATE_AP_SELECTION) {
+        handle_ap_selection(line, &task_args->keep_running);                         // Process AP selection
+    } else if (task_args->state == STATE_COMMAND_MODE) {
+        process_input(line, &task_args->keep_running);                               // Process commands
+    } else {
+        printf("Invalid state: %d\n", task_args->state);                             // Print error message
+    }
 }
 
 void read_uart(void *arg) {
     uart_task_args_t *task_args = (uart_task_args_t *)arg;
     bool *keep_running = &(task_args->keep_running);                                 // Use bool instead of enum
     int *state = &(task_args->state);                                                // Use int instead of enum
-                
-    uint8_t data[1];                                                                 // Store one character
-    char buffer[128] = {0};                                                          // Store full input
-    int index = 0;                                                                   // Buffer index
-                
-    // Print State Message                       
+
+    uint8_t data[UART_READ_CHUNK];                                                   // Bulk read buffer
+    uart_event_t event;
+
+    // Print State Message
     if (*state == STATE_AP_SELECTION) {                                              // Print State Message
+        scan_done_prompt = "Please select an AP: \n";                                // Once the list is complete
         ap_scan();
-        printf("Please select an AP: \n");
-        // ESP_LOGI(TAG, "Please select an AP: \n");
     } else if (*state == STATE_COMMAND_MODE) {
         printf("Enter a command [ help ] to see available commands, [ quit | exit ]: \n");
-        // ESP_LOGI(TAG, "Enter a command [ help ] to see available commands, [ quit | exit ]: \n");
     } else {
         printf("Unknown state: %d\n", *state);
-        // ESP_LOGI(TAG, "Unknown state: %d\n", *state);
-    }
-
-    while (*keep_running) {  // Keep looping until keep_running is false
-        int len = uart_read_bytes(UART_NUM, data, 1, 20 / portTICK_PERIOD_MS);
-        if (len > 0) {                                                              // Check if data was read
-            char ch = data[0];                                                      // Get the character
-
-            if (index >= sizeof(buffer) - 1) {
-                // uart_write_bytes(UART_NUM, "\nBuffer full! Press Enter to process input.\n", 46);
-                printf("Buffer full! Press Enter to process input.\n");
-                buffer[0] = '\0';                                                   // Clear buffer if full
-                index = 0;                                                          // Reset index
-                continue;                       
-            }                       
-
-            if ((ch == 8 || ch == 127) && index > 0) {                              // Handle backspace (8 = ASCII Backspace, 127 = Delete)
-                index--;                                                            // Remove last character from buffer
-                buffer[index] = '\0';                                               // Null-terminate string
-                uart_write_bytes(UART_NUM, "\b \b", 3);                             // Handle backspace on terminal
-            }       
-
-            // Handle Enter (send the message)      
-            else if (ch == '\n' || ch == '\r') {        
-                if (index > 0) {        
-                    buffer[index] = '\0';                                           // Null-terminate string
-                    printf("CMD> %s \n", buffer);                                   // Print the user input
-                    // ESP_LOGI(TAG, "CMD> %s \n", buffer);         
-
-                    if (*state == STATE_AP_SELECTION) {         
-                        handle_ap_selection(buffer, keep_running);                  // Process AP selection
-                    } else if (*state == STATE_COMMAND_MODE) {          
-                        process_input(buffer, keep_running);                        // Process commands
-                    } else {            
-                        printf("Invalid state: %d\n", *state);                      // Print error message
-                        // ESP_LOGI(TAG, "Invalid state: %d", *state);          
-                    }           
-                    index = 0;                                                      // Reset buffer
-                    memset(buffer, 0, sizeof(buffer));                              // Clear buffer
-                }           
-            }           
-            else {          
-                buffer[index++] = ch;                                               // Add character to buffer
-                uart_write_bytes(UART_NUM, &ch, 1);                                 // Echo character to terminal
+    }
+
+    line_editor_init(&editor, console_write, handle_line, task_args);
+    while (*keep_running) {                                                          // Keep looping until keep_running is false
+        if (xQueueReceive(uart_queue, &event, portMAX_DELAY) != pdTRUE) {            // Sleep until the driver reports input
+            continue;
+        }
+        switch (event.type) {
+            case UART_DATA:
+            case UART_PATTERN_DET: {                                                 // Newline received
+                size_t buffered = 0;
+                uart_get_buffered_data_len(UART_NUM, &buffered);
+                while (buffered > 0 && *keep_running) {                              // Drain everything received so far
+                    int len = uart_read_bytes(UART_NUM, data, buffered < sizeof(data) ? buffered : sizeof(data), 0);
+                    if (len <= 0) {
+                        break;
+                    }
+                    line_editor_feed(&editor, (const char *) data, len);
+                    buffered -= len;
+                }
+                if (event.type == UART_PATTERN_DET) {
+                    while (uart_pattern_pop_pos(UART_NUM) != -1) {                  // Positions are not needed, lines are split by the editor
+                    }
+                }
+                break;
             }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                ESP_LOGW(TAG, "UART input overflow, input flushed");
+                uart_flush_input(UART_NUM);
+                xQueueReset(uart_queue);
+                break;
+            default:
+                break;
         }
-
-        vTaskDelay(20 / portTICK_PERIOD_MS);
     }
 
-    if (!*keep_running) {                                                           // If keep_running is false, exit the task
-        ESP_LOGI(TAG, "UART reading task is exiting");
-        vTaskDelete(NULL);
-    }
+    ESP_LOGI(TAG, "UART reading task is exiting");
+    vTaskDelete(NULL);
 }
 
 void read_user_input(int input_state) {
     serial_comm_config();
 
+    if (!command_table_register_all(console_commands, sizeof(console_commands) / sizeof(console_commands[0]))) {
+        ESP_LOGE(TAG, "Failed to register console commands");
+    }
+
     uart_task_args_t *task_args = malloc(sizeof(uart_task_args_t));                // Allocate memory for UART task args
     if (!task_args) {                                                              // Check if memory allocation was successful
         ESP_LOGE(TAG, "Failed to allocate memory for UART task args");
@@ -111,34 +987,42 @@ void read_user_input(int input_state) {
     task_args->keep_running = true;                                                // Initialize keep_running to true
     task_args->state = input_state;                                                // Initialize state
 
-    xTaskCreate(read_uart, "read_uart_task", 4096, task_args, 10, NULL);           // Create UART reading task
+    xTaskCreatePinnedToCore(read_uart, "read_uart_task", 4096, task_args, 10, NULL, CONFIG_CONSOLE_TASK_CORE);  // Create UART reading task
 }
 
 void process_input(const char* input, bool* keep_running) {
-    if (strcmp(input, "help") == 0) {
-        printf("Commands :\n")     ;
-        printf("[ help ]\n")       ;
-        printf("[ scan beacon ]\n");
-        printf("[ quit | exit ]\n");
-        
-        // @deprecated 
-        // ESP_LOGI(TAG, "User requested help");
-        // uart_write_bytes(UART_NUM, "Commands :\n", strlen("Commands :\n"));
-        // uart_write_bytes(UART_NUM, "[ help ]\n", strlen("[ help ]\n"));
-        // uart_write_bytes(UART_NUM, "[ scan beacon ]\n", strlen("[scan beacon]\n"));
-        // uart_write_bytes(UART_NUM, "[ quit | exit ]\n", strlen("[ quit | exit ]\n"));
-
-    } else if (strcmp(input, "scan beacon") == 0) {                                //  Handle "scan beacon"
-        ESP_LOGI(TAG, "User requested to scan beacon");
+    char line[CONFIG_CONSOLE_MAX_LINE];                                            // Dispatcher splits arguments in place
+    snprintf(line, sizeof(line), "%s", input);
 
-    } else if (strcmp(input, "quit") == 0 || strcmp(input, "exit") == 0) {         // Handle "quit" or "exit"
-        ESP_LOGI(TAG, "User requested to exit");
-        uart_write_bytes(UART_NUM, "Exiting...\n", 11);
-        *keep_running = false;                                                     // Set keep_running to false to exit the loop
-    
-    } else {                                                                       // Unknown command
-        ESP_LOGI(TAG, "Unknown command: '%s'", input);                                   
-        uart_write_bytes(UART_NUM, "Unknown command\n", 16);
+    const command_t *command = NULL;
+    switch (command_table_dispatch(line, keep_running, &command)) {
+        case COMMAND_OK:
+        case COMMAND_EMPTY:
+            break;
+        case COMMAND_USAGE:                                                        // Handler rejected arguments
+            printf("Usage: %s %s\n", command->name, command->usage);
+            break;
+        case COMMAND_AMBIGUOUS: {                                                  // Prefix matches several commands
+            const char *prefix = input + strspn(input, " \t");
+            int prefix_len = (int) strcspn(prefix, " \t");
+            printf("Ambiguous command '%.*s':", prefix_len, prefix);
+            for (size_t i = 0; i < command_table_count(); i++) {
+                const char *name = command_table_get(i)->name;
+                if (strncmp(name, prefix, prefix_len) == 0) {
+                    printf(" %s", name);
+                }
+            }
+            printf("\n");
+            break;
+        }
+        case COMMAND_TOO_MANY_ARGS:
+            printf("Too many arguments\n");
+            break;
+        case COMMAND_UNKNOWN:                                                      // Unknown command
+        default:
+            ESP_LOGI(TAG, "Unknown command: '%s'", input);
+            console_write("Unknown command\n", 16);
+            break;
     }
 }
 
@@ -150,10 +1034,10 @@ void handle_ap_selection(const char* input, bool* keep_running) {
     }      
     
     int index = atoi(input) - 1;                                                   // Convert the input to can used as index
-    const wifi_ap_record_t *ap = wifictl_get_ap_record(index);                     // Get the AP record at the specified index
+    wifi_ap_record_t ap;
     
-    if (ap != NULL) {                                                              // If the AP record is valid;                                                             // Create a message to display the selected AP
-        printf("You selected: %s (RSSI: %d dBm)\n", ap->ssid, ap->rssi);
+    if (index >= 0 && wifictl_get_ap_record(index, &ap)) {                         // If the AP record is valid;                                                             // Create a message to display the selected AP
+        printf("You selected: %s (RSSI: %d dBm)\n", ap.ssid, ap.rssi);
         *keep_running = false;
         return;
     }
@@ -166,11 +1050,13 @@ invalid_input:
 }
 
 void ap_scan(){
-    wifictl_scan_nearby_aps();                                                     // Scan for nearby APs
-    const wifictl_ap_records_t *records = wifictl_get_ap_records();                // Get the AP records
-    if (!records) {                                                                // Check if the scan was successful
-        printf("Failed to get WiFi scan results\n");
-        return;
+    wifictl_register_scan_callback(print_scan_progress);                           // Print APs as each channel completes, until done
+    if (wifictl_scan_start_async(NULL, 0) != ESP_OK) {                             // Scan for nearby APs without blocking
+        wifictl_unregister_scan_callback(print_scan_progress);
+        printf("Failed to start WiFi scan\n");
+        if (scan_done_prompt != NULL) {                                            // Known APs can still be selected
+            printf("%s", scan_done_prompt);
+            scan_done_prompt = NULL;
+        }
     }
-    print_ap_list(records);                                                        // Print the AP list
 }
\ No newline at end of file
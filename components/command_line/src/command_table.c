@@ -0,0 +1,126 @@
+/**
+ * @file command_table.c
+ * @brief Implements console command registry and dispatcher.
+ */
+#include "command_table.h"
+
+#include <ctype.h>
+#include <string.h>
+
+static const command_t *commands[CONFIG_CONSOLE_MAX_COMMANDS];
+static size_t command_count = 0;
+
+bool command_table_register(const command_t *command) {
+    if (command->name == NULL || command->handler == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < command_count; i++) {
+        if (strcmp(commands[i]->name, command->name) == 0) {
+            return commands[i] == command;                                  // Registering the same command twice is fine
+        }
+    }
+    if (command_count >= CONFIG_CONSOLE_MAX_COMMANDS) {
+        return false;
+    }
+    commands[command_count++] = command;
+    return true;
+}
+
+bool command_table_register_all(const command_t *list, size_t count) {
+    bool ok = true;
+    for (size_t i = 0; i < count; i++) {
+        ok &= command_table_register(&list[i]);
+    }
+    return ok;
+}
+
+command_status_t command_table_find(const char *name, const command_t **command) {
+    size_t name_len = strlen(name);
+    const command_t *candidate = NULL;
+    bool ambiguous = false;
+
+    for (size_t i = 0; i < command_count; i++) {
+        if (strncmp(commands[i]->name, name, name_len) != 0) {
+            continue;
+        }
+        if (commands[i]->name[name_len] == '\0') {                          // Exact match beats prefixes
+            *command = commands[i];
+            return COMMAND_OK;
+        }
+        if (candidate != NULL) {
+            ambiguous = true;
+        } else {
+            candidate = commands[i];
+        }
+    }
+    *command = candidate;
+    if (candidate == NULL) {
+        return COMMAND_UNKNOWN;
+    }
+    return ambiguous ? COMMAND_AMBIGUOUS : COMMAND_OK;
+}
+
+int command_table_split(char *line, char **argv, int max) {
+    int argc = 0;
+    char *p = line;
+
+    while (true) {
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            return argc;
+        }
+        if (argc == max) {
+            return -1;
+        }
+        char *out = p;                                                      // Quotes are removed by compacting in place
+        argv[argc++] = out;
+        bool quoted = false;
+        while (*p != '\0' && (quoted || !isspace((unsigned char) *p))) {
+            if (*p == '"') {
+                quoted = !quoted;
+            } else {
+                *out++ = *p;
+            }
+            p++;
+        }
+        if (*p != '\0') {
+            p++;
+        }
+        *out = '\0';
+    }
+}
+
+command_status_t command_table_dispatch(char *line, void *ctx, const command_t **command) {
+    char *argv[COMMAND_TABLE_MAX_ARGS];
+    const command_t *found = NULL;
+    command_status_t status;
+
+    int argc = command_table_split(line, argv, COMMAND_TABLE_MAX_ARGS);
+    if (argc < 0) {
+        status = COMMAND_TOO_MANY_ARGS;
+    } else if (argc == 0) {
+        status = COMMAND_EMPTY;
+    } else {
+        status = command_table_find(argv[0], &found);
+        if (status == COMMAND_OK) {
+            argv[0] = (char *) found->name;
+            if (!found->handler(argc, argv, ctx)) {
+                status = COMMAND_USAGE;
+            }
+        }
+    }
+    if (command != NULL) {
+        *command = found;
+    }
+    return status;
+}
+
+size_t command_table_count(void) {
+    return command_count;
+}
+
+const command_t *command_table_get(size_t index) {
+    return index < command_count ? commands[index] : NULL;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file line_editor.c
+ * @brief Implements console line discipline.
+ */
+#include "line_editor.h"
+
+#include <string.h>
+
+#define ECHO_BUFFER_SIZE 64
+
+enum { ESC_NONE, ESC_START, ESC_CSI };
+
+typedef struct {                                                            // Echo collected per feed call, written in chunks
+    line_editor_t *ed;
+    char data[ECHO_BUFFER_SIZE];
+    size_t len;
+} echo_buffer_t;
+
+static void echo_flush(echo_buffer_t *out) {
+    if (out->len > 0 && out->ed->echo != NULL) {
+        out->ed->echo(out->data, out->len);
+    }
+    out->len = 0;
+}
+
+static void echo_put(echo_buffer_t *out, const char *data, size_t len) {
+    if (out->ed->echo == NULL) {
+        return;
+    }
+    while (len > 0) {
+        size_t n = ECHO_BUFFER_SIZE - out->len < len ? ECHO_BUFFER_SIZE - out->len : len;
+        memcpy(&out->data[out->len], data, n);
+        out->len += n;
+        data += n;
+        len -= n;
+        if (out->len == ECHO_BUFFER_SIZE) {
+            echo_flush(out);
+        }
+    }
+}
+
+void line_editor_init(line_editor_t *ed, line_editor_write_t echo, line_editor_line_t on_line, void *ctx) {
+    memset(ed, 0, sizeof(*ed));
+    ed->echo = echo;
+    ed->on_line = on_line;
+    ed->ctx = ctx;
+}
+
+static void history_add(line_editor_t *ed) {
+    if (ed->history_count > 0) {
+        uint8_t last = (ed->history_next + CONFIG_CONSOLE_HISTORY_DEPTH - 1) % CONFIG_CONSOLE_HISTORY_DEPTH;
+        if (strcmp(ed->history[last], ed->line) == 0) {                     // Repeated command is kept once
+            return;
+        }
+    }
+    memcpy(ed->history[ed->history_next], ed->line, ed->len + 1);
+    ed->history_next = (ed->history_next + 1) % CONFIG_CONSOLE_HISTORY_DEPTH;
+    if (ed->history_count < CONFIG_CONSOLE_HISTORY_DEPTH) {
+        ed->history_count++;
+    }
+}
+
+static void history_recall(line_editor_t *ed, echo_buffer_t *out, bool older) {
+    if (older && ed->history_browse < ed->history_count) {
+        ed->history_browse++;
+    } else if (!older && ed->history_browse > 0) {
+        ed->history_browse--;
+    } else {
+        return;
+    }
+    if (ed->history_browse == 0) {                                          // Back below the newest entry: empty line
+        ed->len = 0;
+    } else {
+        uint8_t slot = (ed->history_next + CONFIG_CONSOLE_HISTORY_DEPTH - ed->history_browse) % CONFIG_CONSOLE_HISTORY_DEPTH;
+        ed->len = strlen(ed->history[slot]);
+        memcpy(ed->line, ed->history[slot], ed->len);
+    }
+    ed->line[ed->len] = '\0';
+    echo_put(out, "\r\033[K", 4);                                           // Redraw: carriage return, erase line
+    echo_put(out, ed->line, ed->len);
+}
+
+static void end_line(line_editor_t *ed, echo_buffer_t *out) {
+    echo_put(out, "\r\n", 2);
+    echo_flush(out);                                                        // Echo must precede command output
+    if (ed->discarding) {
+        static const char message[] = "Line too long, discarded\r\n";
+        if (ed->echo != NULL) {
+            ed->echo(message, sizeof(message) - 1);
+        }
+        ed->discarding = false;
+        ed->overflows++;
+    } else if (ed->len > 0) {
+        ed->line[ed->len] = '\0';
+        history_add(ed);
+        ed->lines++;
+        ed->on_line(ed->line, ed->ctx);
+    }
+    ed->len = 0;
+    ed->history_browse = 0;
+}
+
+void line_editor_feed(line_editor_t *ed, const char *data, size_t len) {
+    echo_buffer_t out = { .ed = ed };
+
+    for (size_t i = 0; i < len; i++) {
+        char ch = data[i];
+        bool last_cr = ed->last_cr;
+        ed->last_cr = ch == '\r';
+
+        if (ed->escape == ESC_START) {
+            ed->escape = ch == '[' ? ESC_CSI : ESC_NONE;
+            continue;
+        }
+        if (ed->escape == ESC_CSI) {
+            if (ch >= 0x40 && ch <= 0x7E) {                                 // Final byte ends the sequence
+                ed->escape = ESC_NONE;
+                if ((ch == 'A' || ch == 'B') && !ed->discarding) {
+                    history_recall(ed, &out, ch == 'A');
+                }
+            }
+            continue;
+        }
+
+        if (ch == '\n' && last_cr) {                                        // LF of CRLF
+            continue;
+        }
+        if (ch == '\r' || ch == '\n') {
+            end_line(ed, &out);
+        } else if (ch == 0x1B) {
+            ed->escape = ESC_START;
+        } else if (ch == 8 || ch == 127) {                                  // Backspace, Delete
+            if (ed->len > 0 && !ed->discarding) {
+                ed->len--;
+                echo_put(&out, "\b \b", 3);
+            }
+        } else if ((unsigned char) ch < 0x20 || ed->discarding) {
+            continue;
+        } else if (ed->len >= CONFIG_CONSOLE_MAX_LINE - 1) {
+            ed->discarding = true;
+        } else {
+            ed->line[ed->len++] = ch;
+            echo_put(&out, &ch, 1);
+        }
+    }
+    echo_flush(&out);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file result_protocol.c
+ * @brief Implements result record framing.
+ */
+#include "result_protocol.h"
+
+static const uint32_t crc_nibble_table[16] = {                              // Reflected polynomial 0xEDB88320, 4 bits per step
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_nibble_table[crc & 0xF];
+        crc = (crc >> 4) ^ crc_nibble_table[crc & 0xF];
+    }
+    return crc;
+}
+
+uint32_t result_crc32(const uint8_t *data, size_t len) {
+    return ~crc32_update(0xFFFFFFFF, data, len);
+}
+
+// COBS: every run of non-zero bytes is prefixed by its length + 1, a zero ends the run
+typedef struct {
+    uint8_t *out;
+    size_t n;
+    size_t code_pos;                                                        // Where the length of the current run goes
+    uint8_t code;
+} cobs_encoder_t;
+
+static void cobs_put(cobs_encoder_t *enc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] != 0) {
+            enc->out[enc->n++] = data[i];
+            enc->code++;
+        }
+        if (data[i] == 0 || enc->code == 0xFF) {                            // Zero or maximum run: close the run
+            enc->out[enc->code_pos] = enc->code;
+            enc->code_pos = enc->n++;
+            enc->code = 1;
+        }
+    }
+}
+
+size_t result_frame_encode(uint8_t type, const void *body, size_t len, uint8_t *out, size_t out_size) {
+    if (len > RESULT_MAX_BODY || out_size < RESULT_MAX_FRAME) {
+        return 0;
+    }
+    uint8_t header[4] = { type, RESULT_PROTOCOL_VERSION, (uint8_t) len, (uint8_t) (len >> 8) };
+    uint32_t crc = ~crc32_update(crc32_update(0xFFFFFFFF, header, sizeof(header)), body, len);
+    uint8_t trailer[4] = { (uint8_t) crc, (uint8_t) (crc >> 8), (uint8_t) (crc >> 16), (uint8_t) (crc >> 24) };
+
+    out[0] = 0x00;                                                          // Ends any text before the frame
+    cobs_encoder_t enc = { .out = out, .n = 2, .code_pos = 1, .code = 1 };
+    cobs_put(&enc, header, sizeof(header));
+    cobs_put(&enc, body, len);
+    cobs_put(&enc, trailer, sizeof(trailer));
+    out[enc.code_pos] = enc.code;
+    out[enc.n++] = 0x00;
+    return enc.n;
+}
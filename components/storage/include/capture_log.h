@@ -0,0 +1,133 @@
+/**
+ * @file capture_log.h
+ * @brief Append-only, segment-based log of captured frames and scan results on a FATFS volume.
+ *
+ * Records are packed into fixed-size blocks that are written whole and sealed with a CRC-32, so
+ * every write is block-aligned and a torn write only ever damages the last block. Blocks go into
+ * segment files `SEGnnnnn.LOG` of CONFIG_CAPTURE_LOG_SEGMENT_KB; when CONFIG_CAPTURE_LOG_MAX_SEGMENTS
+ * are in use the oldest one is deleted. `INDEX.IDX` keeps the time range of every closed segment,
+ * and block headers carry the time of their first record, so a time-range read only touches the
+ * blocks it needs.
+ *
+ * Opening the log recovers it: the last segment is scanned block by block and truncated after
+ * the last block with a valid CRC, segments missing from the index are re-indexed.
+ * Timestamps are milliseconds of log time, which continues from the last recovered record after
+ * a reboot and therefore never goes backwards.
+ */
+#ifndef CAPTURE_LOG_H
+#define CAPTURE_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifndef CONFIG_CAPTURE_LOG_SEGMENT_KB                                       // CONFIG_CAPTURE_LOG_SEGMENT_KB
+#define CONFIG_CAPTURE_LOG_SEGMENT_KB 256                                   // Segment size, multiple of the block size
+#endif
+
+#ifndef CONFIG_CAPTURE_LOG_MAX_SEGMENTS                                     // CONFIG_CAPTURE_LOG_MAX_SEGMENTS
+#define CONFIG_CAPTURE_LOG_MAX_SEGMENTS 16                                  // Segments kept before the oldest is deleted
+#endif
+
+#ifndef CONFIG_CAPTURE_LOG_BUFFERS                                          // CONFIG_CAPTURE_LOG_BUFFERS
+#define CONFIG_CAPTURE_LOG_BUFFERS 4                                        // Block buffers between appenders and writer task
+#endif
+
+#ifndef CONFIG_CAPTURE_LOG_SYNC_BLOCKS                                      // CONFIG_CAPTURE_LOG_SYNC_BLOCKS
+#define CONFIG_CAPTURE_LOG_SYNC_BLOCKS 8                                    // Blocks written between two fsync calls
+#endif
+
+#ifndef CONFIG_CAPTURE_LOG_FLUSH_MS                                         // CONFIG_CAPTURE_LOG_FLUSH_MS
+#define CONFIG_CAPTURE_LOG_FLUSH_MS 2000                                    // Partial block is written after this idle time
+#endif
+
+#ifndef CONFIG_CAPTURE_LOG_TASK_PRIORITY                                    // CONFIG_CAPTURE_LOG_TASK_PRIORITY
+#define CONFIG_CAPTURE_LOG_TASK_PRIORITY 3                                  // Below the sniffer pipeline
+#endif
+
+#define CAPTURE_LOG_BLOCK_SIZE 4096                                         // FATFS sector size (CONFIG_FATFS_SECTOR_4096)
+#define CAPTURE_LOG_MAX_RECORD (CAPTURE_LOG_BLOCK_SIZE - 28 - 8)            // Block minus block and record header
+
+typedef enum {
+    CAPTURE_LOG_FRAME = 1,                                                  // wifi_promiscuous_pkt_t with payload
+    CAPTURE_LOG_AP = 2,                                                     // result_ap_t
+} capture_log_type_t;
+
+typedef struct {
+    uint32_t first_segment;                                                 // Sequence number of the oldest segment
+    uint32_t segments;                                                      // Segments on the volume
+    uint64_t first_ms;                                                      // Log time of the oldest record, 0 if empty
+    uint64_t last_ms;                                                       // Log time of the newest record
+    uint32_t records;                                                       // Records appended since open
+    uint32_t blocks_written;
+    uint32_t dropped;                                                       // Records lost: no free block buffer or too long
+    uint32_t write_errors;
+    uint32_t recovered_blocks;                                              // Valid blocks found in the last segment at open
+    uint32_t truncated_bytes;                                               // Torn tail removed at open
+    uint32_t recovery_ms;                                                   // Time taken by recovery at open
+} capture_log_stats_t;
+
+/**
+ * @brief Called for every record of a time-range read.
+ * @return false to stop reading.
+ **/
+typedef bool (*capture_log_visitor_t)(uint8_t type, uint64_t timestamp_ms, const void *data, size_t len, void *ctx);
+
+/**
+ * @brief Opens or creates the log in a directory and starts the writer task.
+ * @param dir Directory on a mounted FATFS volume, created if missing, at most 55 characters.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already open, ESP_ERR_INVALID_ARG if dir is too long,
+ *         ESP_FAIL on file system errors.
+ * @note Recovers a torn last segment and rebuilds missing index entries, see stats.
+ **/
+esp_err_t capture_log_open(const char *dir);
+
+/**
+ * @brief Flushes pending records and closes the log.
+ **/
+void capture_log_close(void);
+
+/**
+ * @brief Returns true while the log is open.
+ **/
+bool capture_log_is_open(void);
+
+/**
+ * @brief Appends one record stamped with the current log time.
+ * @param type Record type, capture_log_type_t or application defined.
+ * @param data Record data.
+ * @param len Data length, at most CAPTURE_LOG_MAX_RECORD.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if closed, ESP_ERR_INVALID_SIZE, ESP_ERR_NO_MEM if all block buffers are waiting
+ *         for the writer (record counted as dropped).
+ * @note Never blocks on file I/O. Blocks are written by the writer task.
+ **/
+esp_err_t capture_log_append(uint8_t type, const void *data, size_t len);
+
+/**
+ * @brief Writes the partial block and waits until everything appended so far is on the volume.
+ **/
+esp_err_t capture_log_flush(void);
+
+/**
+ * @brief Reads records with `from_ms <= timestamp <= to_ms`, oldest first.
+ * @param from_ms Start of range, log time.
+ * @param to_ms End of range, log time.
+ * @param visitor Called for every record.
+ * @param ctx Passed to visitor.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if closed, ESP_FAIL on read errors.
+ * @note Flushes first. Must not be called from the visitor or while holding a block buffer.
+ **/
+esp_err_t capture_log_read(uint64_t from_ms, uint64_t to_ms, capture_log_visitor_t visitor, void *ctx);
+
+/**
+ * @brief Returns current log time in milliseconds.
+ **/
+uint64_t capture_log_now_ms(void);
+
+/**
+ * @brief Copies log counters.
+ **/
+void capture_log_get_stats(capture_log_stats_t *stats);
+
+#endif // CAPTURE_LOG_H
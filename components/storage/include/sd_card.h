@@ -0,0 +1,44 @@
+/**
+ * @file sd_card.h
+ * @brief Mounts an SD card over SPI as a FATFS volume for the capture log.
+ */
+#ifndef SD_CARD_H
+#define SD_CARD_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifndef CONFIG_STORAGE_MOUNT_POINT                                          // CONFIG_STORAGE_MOUNT_POINT
+#define CONFIG_STORAGE_MOUNT_POINT "/sd"
+#endif
+
+#ifndef CONFIG_STORAGE_SD_PIN_MOSI                                          // CONFIG_STORAGE_SD_PIN_MOSI
+#define CONFIG_STORAGE_SD_PIN_MOSI 23                                       // VSPI defaults
+#endif
+#ifndef CONFIG_STORAGE_SD_PIN_MISO                                          // CONFIG_STORAGE_SD_PIN_MISO
+#define CONFIG_STORAGE_SD_PIN_MISO 19
+#endif
+#ifndef CONFIG_STORAGE_SD_PIN_CLK                                           // CONFIG_STORAGE_SD_PIN_CLK
+#define CONFIG_STORAGE_SD_PIN_CLK 18
+#endif
+#ifndef CONFIG_STORAGE_SD_PIN_CS                                            // CONFIG_STORAGE_SD_PIN_CS
+#define CONFIG_STORAGE_SD_PIN_CS 5
+#endif
+
+/**
+ * @brief Mounts the SD card at CONFIG_STORAGE_MOUNT_POINT. No-op if already mounted.
+ * @return ESP_OK or the error of the SPI bus or card initialization.
+ **/
+esp_err_t storage_sd_mount(void);
+
+/**
+ * @brief Unmounts the SD card and releases the SPI bus.
+ **/
+void storage_sd_unmount(void);
+
+/**
+ * @brief Returns true while the SD card is mounted.
+ **/
+bool storage_sd_mounted(void);
+
+#endif // SD_CARD_H
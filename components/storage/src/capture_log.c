@@ -0,0 +1,656 @@
+/**
+ * @file capture_log.c
+ * @brief Implements the segment-based capture log.
+ */
+#include "capture_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "capture_log";
+
+#define BLOCK_MAGIC 0x314B4C43                                              // "CLK1"
+#define SEGMENT_BLOCKS ((CONFIG_CAPTURE_LOG_SEGMENT_KB * 1024) / CAPTURE_LOG_BLOCK_SIZE)
+#define MAX_PATH 80
+
+_Static_assert(SEGMENT_BLOCKS >= 1 && (CONFIG_CAPTURE_LOG_SEGMENT_KB * 1024) % CAPTURE_LOG_BLOCK_SIZE == 0,
+               "CONFIG_CAPTURE_LOG_SEGMENT_KB must be a multiple of the block size");
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t segment;                                                       // Owning segment, rejects stale clusters
+    uint64_t first_ms;                                                      // Log time of the first record
+    uint32_t span_ms;                                                       // Last record minus first record
+    uint16_t used;                                                          // Record bytes following the header
+    uint16_t records;
+    uint32_t crc;                                                           // CRC-32 of header (crc = 0) and record bytes
+} block_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t len;
+    uint32_t offset_ms;                                                     // Relative to block first_ms
+} record_header_t;
+
+_Static_assert(sizeof(block_header_t) + sizeof(record_header_t) + CAPTURE_LOG_MAX_RECORD == CAPTURE_LOG_BLOCK_SIZE,
+               "CAPTURE_LOG_MAX_RECORD does not match the block layout");
+
+typedef struct {
+    uint32_t segment;
+    uint32_t blocks;
+    uint64_t first_ms;
+    uint64_t last_ms;
+    uint32_t records;
+    uint32_t crc;                                                           // CRC-32 of the fields above
+} index_entry_t;
+
+static char log_dir[MAX_PATH - 24];                                         // Room for "/SEG4294967295.LOG"
+static volatile bool log_open = false;
+
+// Owned by the writer task while open, guarded by file_mutex
+static FILE *segment_file = NULL;
+static uint32_t segment_blocks = 0;                                         // Blocks in the current segment
+static uint32_t unsynced_blocks = 0;
+static index_entry_t segments[CONFIG_CAPTURE_LOG_MAX_SEGMENTS];             // Oldest first, last one is being written
+static size_t segment_count = 0;
+
+// Guarded by append_mutex
+static uint8_t *current = NULL;                                             // Block being filled
+static int64_t time_base_ms = 0;                                            // Log time minus uptime
+
+static uint8_t *block_memory = NULL;                                        // Block buffers and read buffer
+static uint8_t *read_buffer = NULL;
+static QueueHandle_t free_queue = NULL;                                     // Empty block buffers
+static QueueHandle_t write_queue = NULL;                                    // Sealed blocks, NULL requests a sync
+static SemaphoreHandle_t append_mutex = NULL;
+static SemaphoreHandle_t file_mutex = NULL;
+static SemaphoreHandle_t flush_mutex = NULL;
+static SemaphoreHandle_t synced_sem = NULL;
+static TaskHandle_t writer_task = NULL;
+static volatile bool closing = false;
+
+static capture_log_stats_t stats;
+
+static uint32_t crc32(const void *data, size_t len) {
+    return esp_rom_crc32_le(0, (const uint8_t *) data, len);
+}
+
+static void segment_path(char *path, uint32_t segment) {
+    snprintf(path, MAX_PATH, "%s/SEG%05lu.LOG", log_dir, (unsigned long) segment);  // 8.3 names, FATFS LFN is off
+}
+
+static uint64_t uptime_ms(void) {
+    return (uint64_t) (esp_timer_get_time() / 1000);
+}
+
+uint64_t capture_log_now_ms(void) {
+    return (uint64_t) ((int64_t) uptime_ms() + time_base_ms);
+}
+
+static bool block_valid(const uint8_t *block, uint32_t segment) {
+    block_header_t hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    if (hdr.magic != BLOCK_MAGIC || hdr.segment != segment || hdr.used > CAPTURE_LOG_BLOCK_SIZE - sizeof(hdr)) {
+        return false;
+    }
+    uint32_t crc = hdr.crc;
+    hdr.crc = 0;
+    uint32_t computed = esp_rom_crc32_le(0, (const uint8_t *) &hdr, sizeof(hdr));
+    computed = esp_rom_crc32_le(computed, block + sizeof(hdr), hdr.used);
+    return computed == crc;
+}
+
+static void index_entry_seal(index_entry_t *entry) {
+    entry->crc = crc32(entry, offsetof(index_entry_t, crc));
+}
+
+static void save_index(void) {
+    char path[MAX_PATH], tmp[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/INDEX.IDX", log_dir);
+    snprintf(tmp, sizeof(tmp), "%s/INDEX.TMP", log_dir);
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        stats.write_errors++;
+        return;
+    }
+    for (size_t i = 0; i < segment_count; i++) {
+        index_entry_seal(&segments[i]);
+    }
+    bool ok = fwrite(segments, sizeof(index_entry_t), segment_count, f) == segment_count;
+    ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+    fclose(f);
+    remove(path);                                                           // FATFS cannot rename over a file; a lost index is rebuilt at open
+    if (!ok || rename(tmp, path) != 0) {
+        stats.write_errors++;
+    }
+}
+
+/**
+ * @brief Scans a segment, optionally truncating it after the last valid block.
+ */
+static bool scan_segment(uint32_t segment, index_entry_t *entry, bool truncate_tail) {
+    char path[MAX_PATH];
+    segment_path(path, segment);
+    memset(entry, 0, sizeof(*entry));
+    entry->segment = segment;
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return false;
+    }
+    while (fread(read_buffer, 1, CAPTURE_LOG_BLOCK_SIZE, f) == CAPTURE_LOG_BLOCK_SIZE && block_valid(read_buffer, segment)) {
+        block_header_t hdr;
+        memcpy(&hdr, read_buffer, sizeof(hdr));
+        if (entry->blocks == 0) {
+            entry->first_ms = hdr.first_ms;
+        }
+        entry->last_ms = hdr.first_ms + hdr.span_ms;
+        entry->records += hdr.records;
+        entry->blocks++;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+
+    long valid = (long) entry->blocks * CAPTURE_LOG_BLOCK_SIZE;
+    if (truncate_tail && size > valid) {
+        if (truncate(path, valid) != 0) {
+            ESP_LOGE(TAG, "Failed to truncate %s: %d", path, errno);
+            return false;
+        }
+        stats.truncated_bytes += (uint32_t) (size - valid);
+    }
+    return true;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Rebuilds the segment list from the directory, the index file and a scan of the last segment.
+ */
+static bool recover(void) {
+    static uint32_t found[CONFIG_CAPTURE_LOG_MAX_SEGMENTS + 8];
+    size_t found_count = 0;
+    char path[MAX_PATH];
+
+    DIR *dir = opendir(log_dir);
+    if (dir == NULL) {
+        return false;
+    }
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        unsigned long segment;
+        char ext[4];
+        if (sscanf(de->d_name, "SEG%5lu.%3s", &segment, ext) != 2 || strcmp(ext, "LOG") != 0) {
+            continue;
+        }
+        if (found_count < sizeof(found) / sizeof(found[0])) {
+            found[found_count++] = (uint32_t) segment;
+            continue;
+        }
+        size_t oldest = 0;                                                  // Too many files: keep the newest ones
+        for (size_t i = 1; i < found_count; i++) {
+            oldest = found[i] < found[oldest] ? i : oldest;
+        }
+        uint32_t drop = (uint32_t) segment;
+        if (drop > found[oldest]) {
+            drop = found[oldest];
+            found[oldest] = (uint32_t) segment;
+        }
+        segment_path(path, drop);
+        remove(path);
+    }
+    closedir(dir);
+    qsort(found, found_count, sizeof(found[0]), compare_u32);
+    while (found_count > CONFIG_CAPTURE_LOG_MAX_SEGMENTS) {                 // Limit was lowered
+        segment_path(path, found[0]);
+        remove(path);
+        memmove(found, found + 1, --found_count * sizeof(found[0]));
+    }
+
+    static index_entry_t indexed[CONFIG_CAPTURE_LOG_MAX_SEGMENTS];
+    size_t indexed_count = 0;
+    snprintf(path, sizeof(path), "%s/INDEX.IDX", log_dir);
+    FILE *f = fopen(path, "rb");
+    if (f != NULL) {
+        indexed_count = fread(indexed, sizeof(index_entry_t), CONFIG_CAPTURE_LOG_MAX_SEGMENTS, f);
+        fclose(f);
+    }
+
+    segment_count = 0;
+    for (size_t i = 0; i < found_count; i++) {
+        index_entry_t *entry = &segments[segment_count];
+        bool last = i + 1 == found_count;
+        bool known = false;
+        for (size_t k = 0; k < indexed_count && !last; k++) {
+            if (indexed[k].segment == found[i] && indexed[k].crc == crc32(&indexed[k], offsetof(index_entry_t, crc))) {
+                *entry = indexed[k];
+                known = true;
+                break;
+            }
+        }
+        if (!known && !scan_segment(found[i], entry, last)) {
+            ESP_LOGW(TAG, "Skipping unreadable segment %lu", (unsigned long) found[i]);
+            continue;
+        }
+        if (last) {
+            stats.recovered_blocks = entry->blocks;
+        }
+        segment_count++;
+    }
+    return true;
+}
+
+static bool open_segment(uint32_t segment, bool append) {
+    char path[MAX_PATH];
+    segment_path(path, segment);
+    segment_file = fopen(path, append ? "r+b" : "wb");
+    if (segment_file == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s: %d", path, errno);
+        return false;
+    }
+    setvbuf(segment_file, NULL, _IONBF, 0);                                 // Whole blocks go straight to FATFS
+    if (append) {
+        fseek(segment_file, (long) segment_blocks * CAPTURE_LOG_BLOCK_SIZE, SEEK_SET);
+    }
+    return true;
+}
+
+static void sync_segment(void) {
+    if (segment_file != NULL && unsynced_blocks > 0) {
+        fflush(segment_file);
+        fsync(fileno(segment_file));
+        unsynced_blocks = 0;
+    }
+}
+
+static bool rotate(void) {
+    sync_segment();
+    fclose(segment_file);
+    segment_file = NULL;
+
+    uint32_t next = segments[segment_count - 1].segment + 1;
+    if (segment_count == CONFIG_CAPTURE_LOG_MAX_SEGMENTS) {                 // Size cap reached: drop oldest
+        char path[MAX_PATH];
+        segment_path(path, segments[0].segment);
+        remove(path);
+        memmove(segments, segments + 1, --segment_count * sizeof(segments[0]));
+    }
+    memset(&segments[segment_count], 0, sizeof(segments[0]));
+    segments[segment_count++].segment = next;
+    segment_blocks = 0;
+    save_index();
+    return open_segment(next, false);
+}
+
+static void write_block(uint8_t *block) {
+    if (segment_blocks >= SEGMENT_BLOCKS && !rotate()) {
+        stats.write_errors++;
+        return;
+    }
+    index_entry_t *entry = &segments[segment_count - 1];
+
+    block_header_t hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    hdr.magic = BLOCK_MAGIC;
+    hdr.segment = entry->segment;
+    hdr.crc = 0;
+    memset(block + sizeof(hdr) + hdr.used, 0, CAPTURE_LOG_BLOCK_SIZE - sizeof(hdr) - hdr.used);
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *) &hdr, sizeof(hdr));
+    hdr.crc = esp_rom_crc32_le(crc, block + sizeof(hdr), hdr.used);
+    memcpy(block, &hdr, sizeof(hdr));
+
+    if (fwrite(block, 1, CAPTURE_LOG_BLOCK_SIZE, segment_file) != CAPTURE_LOG_BLOCK_SIZE) {
+        stats.write_errors++;
+        fseek(segment_file, (long) segment_blocks * CAPTURE_LOG_BLOCK_SIZE, SEEK_SET);  // Retry position for the next block
+        return;
+    }
+    if (entry->blocks == 0) {
+        entry->first_ms = hdr.first_ms;
+    }
+    entry->last_ms = hdr.first_ms + hdr.span_ms;
+    entry->records += hdr.records;
+    entry->blocks = ++segment_blocks;
+    stats.blocks_written++;
+    if (++unsynced_blocks >= CONFIG_CAPTURE_LOG_SYNC_BLOCKS) {
+        sync_segment();
+    }
+}
+
+static void seal_locked(void) {                                             // Hands the current block to the writer
+    xQueueSend(write_queue, &current, portMAX_DELAY);                       // Never full, it holds every buffer plus a sync request
+    current = NULL;
+}
+
+static void writer(void *arg) {
+    uint8_t *block;
+    while (true) {
+        if (xQueueReceive(write_queue, &block, pdMS_TO_TICKS(CONFIG_CAPTURE_LOG_FLUSH_MS)) != pdTRUE) {
+            xSemaphoreTake(append_mutex, portMAX_DELAY);                     // Idle: write a partial block once it is old enough
+            if (current != NULL) {
+                block_header_t hdr;
+                memcpy(&hdr, current, sizeof(hdr));
+                if (capture_log_now_ms() - hdr.first_ms >= CONFIG_CAPTURE_LOG_FLUSH_MS) {
+                    seal_locked();
+                }
+            }
+            xSemaphoreGive(append_mutex);
+            continue;
+        }
+        xSemaphoreTake(file_mutex, portMAX_DELAY);
+        if (block != NULL) {
+            write_block(block);
+        } else {
+            sync_segment();
+        }
+        xSemaphoreGive(file_mutex);
+        if (block != NULL) {
+            xQueueSend(free_queue, &block, 0);
+        } else {
+            bool exit = closing;
+            xSemaphoreGive(synced_sem);
+            if (exit) {
+                vTaskDelete(NULL);
+            }
+        }
+    }
+}
+
+static void release_resources(void) {
+    if (write_queue != NULL) {
+        vQueueDelete(write_queue);
+    }
+    if (free_queue != NULL) {
+        vQueueDelete(free_queue);
+    }
+    write_queue = free_queue = NULL;
+    free(block_memory);
+    block_memory = read_buffer = NULL;
+}
+
+esp_err_t capture_log_open(const char *dir) {
+    if (log_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (append_mutex == NULL) {
+        append_mutex = xSemaphoreCreateMutex();
+        file_mutex = xSemaphoreCreateMutex();
+        flush_mutex = xSemaphoreCreateMutex();
+        synced_sem = xSemaphoreCreateBinary();
+        if (append_mutex == NULL || file_mutex == NULL || flush_mutex == NULL || synced_sem == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (strlen(dir) >= sizeof(log_dir)) {
+        ESP_LOGE(TAG, "Directory name too long: %s", dir);
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(log_dir, sizeof(log_dir), "%s", dir);
+    if (mkdir(log_dir, 0775) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "Failed to create %s: %d", log_dir, errno);
+        return ESP_FAIL;
+    }
+
+    block_memory = malloc((CONFIG_CAPTURE_LOG_BUFFERS + 1) * CAPTURE_LOG_BLOCK_SIZE);
+    free_queue = xQueueCreate(CONFIG_CAPTURE_LOG_BUFFERS, sizeof(uint8_t *));
+    write_queue = xQueueCreate(CONFIG_CAPTURE_LOG_BUFFERS + 1, sizeof(uint8_t *));
+    if (block_memory == NULL || free_queue == NULL || write_queue == NULL) {
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    read_buffer = block_memory + CONFIG_CAPTURE_LOG_BUFFERS * CAPTURE_LOG_BLOCK_SIZE;
+    for (int i = 0; i < CONFIG_CAPTURE_LOG_BUFFERS; i++) {
+        uint8_t *block = block_memory + i * CAPTURE_LOG_BLOCK_SIZE;
+        xQueueSend(free_queue, &block, 0);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    int64_t started_us = esp_timer_get_time();
+    if (!recover()) {
+        ESP_LOGE(TAG, "Failed to read %s", log_dir);
+        release_resources();
+        return ESP_FAIL;
+    }
+    bool fresh = segment_count == 0;
+    if (fresh) {
+        memset(&segments[0], 0, sizeof(segments[0]));
+        segments[0].segment = 1;
+        segment_count = 1;
+    }
+    segment_blocks = segments[segment_count - 1].blocks;
+    unsynced_blocks = 0;
+    if (!open_segment(segments[segment_count - 1].segment, !fresh)) {
+        release_resources();
+        return ESP_FAIL;
+    }
+    save_index();
+    stats.recovery_ms = (uint32_t) ((esp_timer_get_time() - started_us) / 1000);
+
+    uint64_t last_ms = 0;
+    for (size_t i = 0; i < segment_count; i++) {
+        if (segments[i].blocks > 0 && segments[i].last_ms > last_ms) {
+            last_ms = segments[i].last_ms;
+        }
+    }
+    time_base_ms = last_ms > 0 ? (int64_t) (last_ms + 1) - (int64_t) uptime_ms() : 0;  // Log time continues after the last record
+    stats.last_ms = last_ms;
+    current = NULL;
+    closing = false;
+
+    if (xTaskCreate(writer, "capture_log", 3072, NULL, CONFIG_CAPTURE_LOG_TASK_PRIORITY, &writer_task) != pdPASS) {
+        fclose(segment_file);
+        segment_file = NULL;
+        release_resources();
+        return ESP_ERR_NO_MEM;
+    }
+    log_open = true;
+    ESP_LOGI(TAG, "Opened %s: %u segments, recovered %lu blocks, truncated %lu bytes in %lu ms", log_dir,
+             (unsigned) segment_count, (unsigned long) stats.recovered_blocks, (unsigned long) stats.truncated_bytes,
+             (unsigned long) stats.recovery_ms);
+    return ESP_OK;
+}
+
+bool capture_log_is_open(void) {
+    return log_open;
+}
+
+esp_err_t capture_log_append(uint8_t type, const void *data, size_t len) {
+    if (!log_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(append_mutex, portMAX_DELAY);
+    if (!log_open) {                                                        // Closed meanwhile
+        xSemaphoreGive(append_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > CAPTURE_LOG_MAX_RECORD) {
+        stats.dropped++;
+        xSemaphoreGive(append_mutex);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint64_t now = capture_log_now_ms();
+    block_header_t hdr;
+    if (current != NULL) {
+        memcpy(&hdr, current, sizeof(hdr));
+        if (sizeof(hdr) + hdr.used + sizeof(record_header_t) + len > CAPTURE_LOG_BLOCK_SIZE || now - hdr.first_ms > UINT32_MAX) {
+            seal_locked();
+        }
+    }
+    if (current == NULL) {
+        if (xQueueReceive(free_queue, &current, 0) != pdTRUE) {              // Writer is behind, never wait for the volume
+            current = NULL;
+            stats.dropped++;
+            xSemaphoreGive(append_mutex);
+            return ESP_ERR_NO_MEM;
+        }
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.first_ms = now;
+    }
+
+    record_header_t rec = { .type = type, .len = (uint16_t) len, .offset_ms = (uint32_t) (now - hdr.first_ms) };
+    uint8_t *dst = current + sizeof(hdr) + hdr.used;
+    memcpy(dst, &rec, sizeof(rec));
+    memcpy(dst + sizeof(rec), data, len);
+    hdr.used += sizeof(rec) + len;
+    hdr.records++;
+    hdr.span_ms = rec.offset_ms;
+    memcpy(current, &hdr, sizeof(hdr));
+    stats.records++;
+    stats.last_ms = now;
+    xSemaphoreGive(append_mutex);
+    return ESP_OK;
+}
+
+static void request_sync(void) {
+    uint8_t *sync = NULL;
+    xSemaphoreTake(append_mutex, portMAX_DELAY);
+    if (current != NULL) {
+        seal_locked();
+    }
+    xSemaphoreGive(append_mutex);
+    xQueueSend(write_queue, &sync, portMAX_DELAY);
+    xSemaphoreTake(synced_sem, portMAX_DELAY);
+}
+
+esp_err_t capture_log_flush(void) {
+    if (!log_open) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+    request_sync();
+    xSemaphoreGive(flush_mutex);
+    return stats.write_errors == 0 ? ESP_OK : ESP_FAIL;
+}
+
+void capture_log_close(void) {
+    if (!log_open) {
+        return;
+    }
+    xSemaphoreTake(flush_mutex, portMAX_DELAY);
+    xSemaphoreTake(append_mutex, portMAX_DELAY);
+    log_open = false;                                                       // No appends from here on
+    xSemaphoreGive(append_mutex);
+    closing = true;
+    request_sync();                                                         // Writer exits after this sync
+    writer_task = NULL;
+
+    xSemaphoreTake(file_mutex, portMAX_DELAY);
+    fclose(segment_file);
+    segment_file = NULL;
+    save_index();
+    xSemaphoreGive(file_mutex);
+    release_resources();
+    xSemaphoreGive(flush_mutex);
+    ESP_LOGI(TAG, "Closed %s", log_dir);
+}
+
+/**
+ * @brief Returns first block of a segment that may hold records at or after `from_ms`: the last block
+ *        starting before it. Several blocks can start in the same millisecond.
+ */
+static uint32_t find_start_block(FILE *f, uint32_t blocks, uint64_t from_ms) {
+    uint32_t lo = 0, hi = blocks;                                           // Block first_ms is non-decreasing
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        block_header_t hdr;
+        if (fseek(f, (long) mid * CAPTURE_LOG_BLOCK_SIZE, SEEK_SET) != 0 || fread(&hdr, sizeof(hdr), 1, f) != 1) {
+            break;
+        }
+        if (hdr.first_ms < from_ms) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+esp_err_t capture_log_read(uint64_t from_ms, uint64_t to_ms, capture_log_visitor_t visitor, void *ctx) {
+    if (capture_log_flush() == ESP_ERR_INVALID_STATE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_OK;
+    bool keep_going = true;
+    xSemaphoreTake(file_mutex, portMAX_DELAY);                              // Holds off rotation while files are read
+    for (size_t s = 0; s < segment_count && keep_going; s++) {
+        const index_entry_t *entry = &segments[s];
+        if (entry->blocks == 0 || entry->last_ms < from_ms || entry->first_ms > to_ms) {
+            continue;
+        }
+        char path[MAX_PATH];
+        segment_path(path, entry->segment);
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) {
+            err = ESP_FAIL;
+            continue;
+        }
+        uint32_t start = find_start_block(f, entry->blocks, from_ms);
+        fseek(f, (long) start * CAPTURE_LOG_BLOCK_SIZE, SEEK_SET);
+        for (uint32_t b = start; b < entry->blocks && keep_going; b++) {
+            if (fread(read_buffer, 1, CAPTURE_LOG_BLOCK_SIZE, f) != CAPTURE_LOG_BLOCK_SIZE) {
+                err = ESP_FAIL;
+                break;
+            }
+            if (!block_valid(read_buffer, entry->segment)) {
+                err = ESP_FAIL;
+                continue;
+            }
+            block_header_t hdr;
+            memcpy(&hdr, read_buffer, sizeof(hdr));
+            if (hdr.first_ms > to_ms) {
+                keep_going = false;
+                break;
+            }
+            for (size_t pos = sizeof(hdr); pos + sizeof(record_header_t) <= sizeof(hdr) + hdr.used && keep_going; ) {
+                record_header_t rec;
+                memcpy(&rec, read_buffer + pos, sizeof(rec));
+                uint64_t timestamp = hdr.first_ms + rec.offset_ms;
+                if (timestamp > to_ms) {
+                    keep_going = false;
+                } else if (timestamp >= from_ms) {
+                    keep_going = visitor(rec.type, timestamp, read_buffer + pos + sizeof(rec), rec.len, ctx);
+                }
+                pos += sizeof(rec) + rec.len;
+            }
+        }
+        fclose(f);
+    }
+    xSemaphoreGive(file_mutex);
+    return err;
+}
+
+void capture_log_get_stats(capture_log_stats_t *out) {
+    if (file_mutex != NULL) {
+        xSemaphoreTake(file_mutex, portMAX_DELAY);
+    }
+    *out = stats;
+    out->segments = segment_count;
+    out->first_segment = segment_count > 0 ? segments[0].segment : 0;
+    out->first_ms = 0;
+    for (size_t i = 0; i < segment_count; i++) {
+        if (segments[i].blocks > 0) {
+            out->first_ms = segments[i].first_ms;
+            break;
+        }
+    }
+    if (file_mutex != NULL) {
+        xSemaphoreGive(file_mutex);
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file sd_card.c
+ * @brief Implements SD card mounting over SPI.
+ */
+#include "sd_card.h"
+
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdspi_host.h"
+#include "driver/spi_common.h"
+
+static const char *TAG = "sd_card";
+
+static sdmmc_card_t *card = NULL;
+static sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+
+esp_err_t storage_sd_mount(void) {
+    if (card != NULL) {
+        return ESP_OK;
+    }
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = CONFIG_STORAGE_SD_PIN_MOSI,
+        .miso_io_num = CONFIG_STORAGE_SD_PIN_MISO,
+        .sclk_io_num = CONFIG_STORAGE_SD_PIN_CLK,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = 4096,                                            // One capture log block per transaction
+    };
+    esp_err_t err = spi_bus_initialize(host.slot, &bus_config, SDSPI_DEFAULT_DMA);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot_config.gpio_cs = CONFIG_STORAGE_SD_PIN_CS;
+    slot_config.host_id = host.slot;
+    esp_vfs_fat_sdmmc_mount_config_t mount_config = {
+        .format_if_mount_failed = false,                                    // Never wipe a card holding survey data
+        .max_files = 4,                                                     // Segment, index and a reader
+        .allocation_unit_size = 16 * 1024,
+    };
+    err = esp_vfs_fat_sdspi_mount(CONFIG_STORAGE_MOUNT_POINT, &host, &slot_config, &mount_config, &card);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mount SD card: %s", esp_err_to_name(err));
+        card = NULL;
+        spi_bus_free(host.slot);
+        return err;
+    }
+    ESP_LOGI(TAG, "SD card mounted at %s", CONFIG_STORAGE_MOUNT_POINT);
+    return ESP_OK;
+}
+
+void storage_sd_unmount(void) {
+    if (card == NULL) {
+        return;
+    }
+    esp_vfs_fat_sdcard_unmount(CONFIG_STORAGE_MOUNT_POINT, card);
+    card = NULL;
+    spi_bus_free(host.slot);
+}
+
+bool storage_sd_mounted(void) {
+    return card != NULL;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file airtime_meter.h
+ * @brief Airtime and utilization accounting per channel and per BSSID over a sliding window.
+ *
+ * Frame durations are estimated from length and PHY rate (preamble plus payload symbols, see
+ * airtime_frame_us) in integer microseconds. Airtime, frame counts and the time the receiver
+ * listened to each channel are added to the current bucket of a ring of CONFIG_AIRTIME_BUCKETS
+ * buckets of CONFIG_AIRTIME_BUCKET_MS, so memory is fixed and old traffic drops out bucket by
+ * bucket. Utilization is airtime divided by listened time, in Q16 fixed point.
+ * Pure logic without ESP-IDF dependencies.
+ */
+#ifndef AIRTIME_METER_H
+#define AIRTIME_METER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_AIRTIME_BUCKETS                                              // CONFIG_AIRTIME_BUCKETS
+#define CONFIG_AIRTIME_BUCKETS 10                                           // Buckets in the sliding window
+#endif
+
+#ifndef CONFIG_AIRTIME_BUCKET_MS                                            // CONFIG_AIRTIME_BUCKET_MS
+#define CONFIG_AIRTIME_BUCKET_MS 1000                                       // Length of one bucket
+#endif
+
+#ifndef CONFIG_AIRTIME_BSSIDS                                               // CONFIG_AIRTIME_BSSIDS
+#define CONFIG_AIRTIME_BSSIDS 32                                            // BSSIDs tracked, power of two
+#endif
+
+#define AIRTIME_CHANNELS 14
+#define AIRTIME_PROBES 8                                                    // BSSID slots searched before the stalest one is evicted
+#define AIRTIME_Q16_ONE 65536                                               // 100 % utilization
+
+typedef enum {
+    AIRTIME_MGMT,
+    AIRTIME_CTRL,
+    AIRTIME_DATA,
+    AIRTIME_TYPES
+} airtime_type_t;
+
+/**
+ * @brief PHY parameters of a received frame.
+ **/
+typedef struct {
+    uint8_t legacy_rate;                                                    // 500 kbps units, 0 for HT
+    bool short_preamble;                                                    // DSSS/CCK rates only
+    uint8_t mcs;                                                            // HT only, 0-31
+    bool ht40;
+    bool short_gi;
+} airtime_phy_t;
+
+typedef struct {
+    uint32_t airtime_us[AIRTIME_TYPES];
+    uint32_t frames[AIRTIME_TYPES];
+    uint32_t listen_us;
+} airtime_bucket_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;                                                        // Channel of the latest frame
+    bool used;
+    uint32_t last_epoch;                                                    // Bucket of the latest frame, for eviction
+    uint32_t airtime_us[CONFIG_AIRTIME_BUCKETS][AIRTIME_TYPES];
+    uint32_t frames[CONFIG_AIRTIME_BUCKETS];
+} airtime_bssid_entry_t;
+
+typedef struct {
+    airtime_bucket_t channels[AIRTIME_CHANNELS][CONFIG_AIRTIME_BUCKETS];
+    airtime_bssid_entry_t bssids[CONFIG_AIRTIME_BSSIDS];
+    uint32_t epoch;                                                         // Number of the current bucket since start
+    uint32_t start_ms;
+    uint32_t unrated;                                                       // Frames with unknown rate, counted without airtime
+    uint32_t evicted;
+} airtime_meter_t;
+
+/**
+ * @brief Utilization of one channel over the window.
+ **/
+typedef struct {
+    uint8_t channel;
+    uint32_t listen_ms;                                                     // Time the receiver was on this channel
+    uint32_t airtime_us[AIRTIME_TYPES];
+    uint32_t frames[AIRTIME_TYPES];
+    uint32_t utilization_q16;                                               // Busy share of listened time, capped at AIRTIME_Q16_ONE
+} airtime_channel_summary_t;
+
+/**
+ * @brief Airtime of one BSSID over the window.
+ **/
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t airtime_us[AIRTIME_TYPES];
+    uint32_t frames;
+    uint32_t share_q16;                                                     // Share of its channel's listened time
+} airtime_bssid_summary_t;
+
+/**
+ * @brief Estimates on-air duration of a PPDU: preamble and header, payload symbols, 2.4 GHz signal extension for OFDM.
+ * @param phy PHY parameters.
+ * @param len MPDU length including FCS.
+ * @return Duration in microseconds, 0 if the rate is unknown.
+ * @note Only the frame itself; SIFS and the response are counted when the response frame is captured.
+ **/
+uint32_t airtime_frame_us(const airtime_phy_t *phy, uint32_t len);
+
+/**
+ * @brief Clears the meter.
+ * @param meter Meter.
+ * @param now_ms Current time, starts the first bucket.
+ **/
+void airtime_meter_init(airtime_meter_t *meter, uint32_t now_ms);
+
+/**
+ * @brief Adds one frame.
+ * @param meter Meter.
+ * @param now_ms Current time.
+ * @param channel Channel 1-14.
+ * @param type Frame type.
+ * @param bssid BSSID the frame belongs to, NULL if unknown (e.g. ACK, CTS).
+ * @param airtime_us Estimated duration, 0 if unknown.
+ **/
+void airtime_meter_record(airtime_meter_t *meter, uint32_t now_ms, uint8_t channel, airtime_type_t type,
+                          const uint8_t *bssid, uint32_t airtime_us);
+
+/**
+ * @brief Adds time the receiver listened to a channel. Listened time is the denominator of utilization.
+ **/
+void airtime_meter_listen(airtime_meter_t *meter, uint32_t now_ms, uint8_t channel, uint32_t listen_us);
+
+/**
+ * @brief Summarizes channels with listened time or frames in the window, ascending by channel.
+ * @return Number of summaries written.
+ **/
+size_t airtime_meter_channels(airtime_meter_t *meter, uint32_t now_ms, airtime_channel_summary_t *out, size_t max);
+
+/**
+ * @brief Summarizes BSSIDs with frames in the window, by descending airtime.
+ * @return Number of summaries written.
+ **/
+size_t airtime_meter_bssids(airtime_meter_t *meter, uint32_t now_ms, airtime_bssid_summary_t *out, size_t max);
+
+#endif // AIRTIME_METER_H
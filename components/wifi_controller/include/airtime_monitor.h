@@ -0,0 +1,49 @@
+/**
+ * @file airtime_monitor.h
+ * @brief Feeds captured frames into an airtime meter and answers utilization queries.
+ *
+ * A sniffer aggregate-stage handler estimates every frame's airtime from `rx_ctrl` and adds it to
+ * its channel and BSSID (see airtime_meter.h). Listened time per channel comes from the channel
+ * switches made through wifictl_radio_set_channel and only accrues while sniffing, so channels
+ * visited briefly by the hopper are not reported as idle.
+ */
+#ifndef AIRTIME_MONITOR_H
+#define AIRTIME_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "airtime_meter.h"
+
+/**
+ * @brief Clears the meter and starts accounting sniffer batches.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already running, ESP_ERR_NO_MEM if no sniffer handler slot is free.
+ **/
+esp_err_t wifictl_airtime_start(void);
+
+/**
+ * @brief Stops accounting. Collected windows stay queryable.
+ **/
+void wifictl_airtime_stop(void);
+
+/**
+ * @brief Returns true while accounting.
+ **/
+bool wifictl_airtime_active(void);
+
+/**
+ * @brief Summarizes channels over the sliding window, see airtime_meter_channels.
+ **/
+size_t wifictl_airtime_channels(airtime_channel_summary_t *out, size_t max);
+
+/**
+ * @brief Summarizes BSSIDs by descending airtime over the sliding window, see airtime_meter_bssids.
+ **/
+size_t wifictl_airtime_bssids(airtime_bssid_summary_t *out, size_t max);
+
+/**
+ * @brief Returns frames counted without airtime because of an unknown rate, and BSSIDs evicted from the meter.
+ **/
+void wifictl_airtime_get_counters(uint32_t *unrated, uint32_t *evicted);
+
+#endif // AIRTIME_MONITOR_H
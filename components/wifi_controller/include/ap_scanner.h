@@ -3,10 +3,15 @@
 
 #include "esp_wifi.h"
 #include "wifi_controller.h"
+#include "ap_table.h"
 
 
 #ifndef CONFIG_SCAN_MAX_AP                                                  // CONFIG_SCAN_MAX_AP
-#define CONFIG_SCAN_MAX_AP 20                                               // Default value is 20
+#define CONFIG_SCAN_MAX_AP 20                                               // Records fetched per scanned channel
+#endif
+
+#ifndef CONFIG_SCAN_MAX_CALLBACKS                                           // CONFIG_SCAN_MAX_CALLBACKS
+#define CONFIG_SCAN_MAX_CALLBACKS 4                                         // Registered scan result callbacks
 #endif
 
 /** 
@@ -17,44 +22,98 @@
 const char* get_auth_mode_str(wifi_auth_mode_t authmode);
 
 /**
- * @brief Structure to store records of scanned APs.
- * @note This structure contains information about multiple access points.
+ * @brief Callback receiving scan results as each channel completes.
+ * @param channel Channel that was just scanned, 0 for the final call of a cancelled scan.
+ * @param ids AP table ids of the APs seen on this channel (new or refreshed).
+ * @param count Number of ids, may be 0.
+ * @param done True for the last call of the scan (all channels scanned or scan cancelled).
+ * @note Called from the event loop task, must not block.
  **/
-typedef struct {
-    uint16_t count;                                                        // Number of APs found
-    wifi_ap_record_t records[CONFIG_SCAN_MAX_AP];                          // Array of AP records
-} wifictl_ap_records_t;
+typedef void (*wifictl_scan_callback_t)(uint8_t channel, const uint16_t *ids, uint16_t count, bool done);
 
 /**
- * @brief Registers a callback to be called when the scan is complete.
+ * @brief Registers a callback to be called as scan results arrive.
  * @param callback Function pointer to the callback function.
+ * @return true on success, false if all CONFIG_SCAN_MAX_CALLBACKS slots are taken.
+ **/
+bool wifictl_register_scan_callback(wifictl_scan_callback_t callback);
+
+/**
+ * @brief Removes previously registered scan callback.
+ * @param callback Function pointer to the callback function.
+ **/
+void wifictl_unregister_scan_callback(wifictl_scan_callback_t callback);
+
+/**
+ * @brief Starts a non-blocking scan, one channel at a time.
+ * @param channels Channels to scan in order, NULL for channels 1-13.
+ * @param count Number of channels.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if a scan is already running or the driver has yet to report too many
+ *         stopped requests, ESP_ERR_INVALID_ARG for a bad channel list.
+ * @note Results are merged into the AP table and streamed to registered callbacks after every channel.
+ *       Entries older than CONFIG_AP_TABLE_MAX_AGE_S are expired first. Initializes Wi-Fi on first use and
+ *       stops sniffing, see wifictl_mode_enter.
+ **/
+esp_err_t wifictl_scan_start_async(const uint8_t *channels, size_t count);
+
+/**
+ * @brief Cancels running scan. Registered callbacks get a final call with `done` set.
+ **/
+void wifictl_scan_cancel(void);
+
+/**
+ * @brief Stops running scan without calling back. Used by wifictl_mode_enter, which holds the mode lock.
+ * @return true if a scan was stopped; the caller then calls wifictl_scan_report_cancelled.
+ **/
+bool wifictl_scan_abort(void);
+
+/**
+ * @brief Gives registered callbacks the final `done` call for a scan stopped by wifictl_scan_abort.
+ **/
+void wifictl_scan_report_cancelled(void);
+
+/**
+ * @brief Returns true while an asynchronous scan is running or finishing; a new scan cannot start until it returns false.
+ **/
+bool wifictl_scan_in_progress(void);
+
+/**
+ * @brief Returns timing of the latest scan in milliseconds.
+ * @param first_result_ms Time from start to the first channel with at least one AP, 0 if none yet.
+ * @param total_ms Time from start to completion, 0 while running.
+ **/
+void wifictl_scan_get_timing(uint32_t *first_result_ms, uint32_t *total_ms);
+
+/**
+ * @brief Handles WIFI_EVENT_SCAN_DONE. Called by the Wi-Fi event handler.
  **/
-void wifictl_register_scan_callback(void (*callback)(void));
+void wifictl_scan_on_done(void);
 
 /**
- * @brief Starts a scan for nearby access points.
- * @note This function initiates the scanning process, and the callback will be invoked when it is done.
+ * @brief Starts a scan for nearby access points and waits for it to finish.
+ * @note Must not be called from the event loop task, which delivers the scan events.
  **/
 void wifictl_scan_nearby_aps(void);
 
 /**
- * @brief Returns the latest scanned AP records.
- * @return Pointer to the structure containing AP records.
+ * @brief Retrieves a specific AP record by AP table id.
+ * @param id Id of the AP record to retrieve.
+ * @param record Receives a copy of the AP record.
+ * @return false if the id is not in use.
  **/
-const wifictl_ap_records_t *wifictl_get_ap_records(void);
+bool wifictl_get_ap_record(unsigned id, wifi_ap_record_t *record);
 
 /**
- * @brief Retrieves a specific AP record by index.
- * @param index Index of the AP record to retrieve.
- * @return Pointer to the AP record at the specified index.
+ * @brief Prints one AP record.
+ * @param index Zero-based AP table id of the record, printed one-based.
+ * @param record AP record to print.
  **/
-const wifi_ap_record_t *wifictl_get_ap_record(unsigned index);
+void print_ap_record(unsigned index, const wifi_ap_record_t *record);
 
 /**
- * @brief Prints the list of APs found during the scan.
- * @param records Pointer to the structure containing AP records.
- * @note This function prints the list of APs found during the scan, including their SSID, BSSID, channel, RSSI, and authentication mode.
+ * @brief Prints all known APs, strongest smoothed RSSI first.
+ * @note This function prints the APs of the AP table, including their SSID, BSSID, channel, RSSI, and authentication mode.
  **/
-void print_ap_list(const wifictl_ap_records_t *records);
+void print_ap_list(void);
 
 #endif // AP_SCANNER_H
\ No newline at end of file
@@ -0,0 +1,106 @@
+/**
+ * @file ap_table.h
+ * @brief BSSID-indexed table of known APs, merged across scans and passive beacons.
+ *
+ * Open-addressing hash index (linear probing, backward-shift deletion) over a fixed number of
+ * entries. Hot fields used for lookup, aging and sorting live in a compact array separate from
+ * the full `wifi_ap_record_t` records. A recency list makes evicting the least recently seen entry
+ * O(1). Entry ids are stable until the entry is evicted or expires.
+ */
+#ifndef AP_TABLE_H
+#define AP_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_wifi_types.h"
+
+#ifndef CONFIG_AP_TABLE_CAPACITY                                            // CONFIG_AP_TABLE_CAPACITY
+#define CONFIG_AP_TABLE_CAPACITY 128                                        // Number of APs kept
+#endif
+
+#ifndef CONFIG_AP_TABLE_MAX_AGE_S                                           // CONFIG_AP_TABLE_MAX_AGE_S
+#define CONFIG_AP_TABLE_MAX_AGE_S 300                                       // APs not seen for this long expire
+#endif
+
+#define AP_TABLE_INVALID_ID 0xFFFF
+
+#define AP_SOURCE_SCAN   0x01                                               // Seen in a scan result
+#define AP_SOURCE_BEACON 0x02                                               // Seen as a captured beacon/probe response
+
+/**
+ * @brief Hot per-AP state.
+ **/
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t sources;                                                        // AP_SOURCE_* bits
+    int16_t rssi_ewma_q4;                                                   // Smoothed RSSI in 1/16 dBm
+    uint16_t seen_count;                                                    // Saturating number of observations
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+} wifictl_ap_info_t;
+
+typedef enum {
+    AP_SORT_RSSI,                                                           // Strongest smoothed RSSI first
+    AP_SORT_LAST_SEEN,                                                      // Most recently seen first
+    AP_SORT_BSSID,                                                          // Ascending BSSID
+} wifictl_ap_sort_t;
+
+/**
+ * @brief Inserts or merges an AP observation.
+ * @param record Full record; SSID, auth mode etc. overwrite the stored record.
+ * @param now_ms Observation time.
+ * @param source AP_SOURCE_SCAN or AP_SOURCE_BEACON.
+ * @return Entry id. When the table is full the least recently seen entry is evicted.
+ **/
+uint16_t wifictl_ap_table_update(const wifi_ap_record_t *record, uint32_t now_ms, uint8_t source);
+
+/**
+ * @brief Looks up entry id by BSSID in O(1).
+ * @return Entry id or AP_TABLE_INVALID_ID.
+ **/
+uint16_t wifictl_ap_table_find(const uint8_t bssid[6]);
+
+/**
+ * @brief Copies stored record of an entry.
+ * @note Copied under the table lock: captured beacons keep rewriting records while the sniffer runs.
+ * @return false if id is unused.
+ **/
+bool wifictl_ap_table_record(uint16_t id, wifi_ap_record_t *record);
+
+/**
+ * @brief Copies hot state of an entry.
+ * @return false if id is unused.
+ **/
+bool wifictl_ap_table_info(uint16_t id, wifictl_ap_info_t *info);
+
+/**
+ * @brief Writes ids of all entries in requested order.
+ * @return Number of ids written, at most `max`.
+ **/
+size_t wifictl_ap_table_sorted(wifictl_ap_sort_t order, uint16_t *ids, size_t max);
+
+/**
+ * @brief Removes entries not seen for `max_age_ms`.
+ * @return Number of removed entries.
+ **/
+size_t wifictl_ap_table_expire(uint32_t now_ms, uint32_t max_age_ms);
+
+/**
+ * @brief Returns number of entries in use.
+ **/
+size_t wifictl_ap_table_count(void);
+
+/**
+ * @brief Removes all entries.
+ **/
+void wifictl_ap_table_clear(void);
+
+/**
+ * @brief Enables or disables merging of beacons/probe responses captured by the sniffer.
+ * @return false if no sniffer batch handler slot is free.
+ **/
+bool wifictl_ap_table_track_beacons(bool enable);
+
+#endif // AP_TABLE_H
@@ -0,0 +1,104 @@
+/**
+ * @file beacon_dedup.h
+ * @brief Collapses repeated beacons into per-BSSID summaries.
+ *
+ * An AP sends about ten beacons per second that differ only in the timestamp, the TIM element and
+ * the FCS. The table keeps a hash of every BSSID's remaining beacon body (fixed fields and all other
+ * elements); a beacon is passed on in full when the BSSID is new, its hash changed, or the last full
+ * beacon is older than the refresh interval. Other beacons are only counted, together with their
+ * RSSI range and mean, and reported as a summary record every summary interval.
+ * Pure logic without ESP-IDF dependencies.
+ */
+#ifndef BEACON_DEDUP_H
+#define BEACON_DEDUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_BEACON_DEDUP_CAPACITY                                        // CONFIG_BEACON_DEDUP_CAPACITY
+#define CONFIG_BEACON_DEDUP_CAPACITY 64                                     // Tracked BSSIDs, power of two
+#endif
+
+#define BEACON_DEDUP_PROBES 8                                               // Slots searched before the oldest one is evicted
+
+/**
+ * @brief Summary of suppressed beacons of one BSSID. Wire format of the compact PCAP stream, little endian.
+ **/
+typedef struct __attribute__((packed)) {
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi_mean;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    uint16_t count;                                                         // Beacons suppressed since the previous summary
+    uint32_t first_us;                                                      // rx_ctrl timestamp of the first one
+    uint32_t last_us;                                                       // rx_ctrl timestamp of the last one
+    uint32_t ie_hash;                                                       // Body hash shared by all of them
+} beacon_summary_t;
+
+_Static_assert(sizeof(beacon_summary_t) == 24, "beacon_summary_t is a wire format");
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    bool used;
+    uint32_t ie_hash;
+    uint32_t seen_us;                                                       // Last beacon, for eviction
+    uint32_t sent_us;                                                       // Last beacon passed on in full
+    uint32_t first_us;                                                      // First suppressed beacon since the last summary
+    int32_t rssi_sum;
+    uint16_t count;                                                         // Suppressed since the last summary
+    int8_t rssi_min;
+    int8_t rssi_max;
+} beacon_dedup_entry_t;
+
+typedef struct {
+    beacon_dedup_entry_t entries[CONFIG_BEACON_DEDUP_CAPACITY];
+    uint32_t summary_us;
+    uint32_t refresh_us;
+    uint32_t last_summary_us;
+    uint32_t passed;                                                        // Beacons passed on in full
+    uint32_t suppressed;
+    uint32_t summaries;
+    uint32_t evicted;
+} beacon_dedup_t;
+
+/**
+ * @brief Called with every summary record. Summaries of a BSSID are always emitted before its next full beacon.
+ **/
+typedef void (*beacon_summary_cb_t)(const beacon_summary_t *summary, void *ctx);
+
+/**
+ * @brief Clears the table.
+ * @param dedup Table.
+ * @param summary_ms Interval between summaries of a BSSID with suppressed beacons.
+ * @param refresh_ms A full beacon is passed on at least this often per BSSID, 0 for only on changes.
+ **/
+void beacon_dedup_init(beacon_dedup_t *dedup, uint32_t summary_ms, uint32_t refresh_ms);
+
+/**
+ * @brief Classifies one frame.
+ * @param dedup Table.
+ * @param frame 802.11 frame starting with the MAC header, including FCS.
+ * @param len Frame length.
+ * @param rssi Signal strength of the frame.
+ * @param channel Channel the frame was received on.
+ * @param now_us Receive timestamp, wrapping 32-bit microseconds.
+ * @param callback Receives the summary of a BSSID whose beacon changed or that is evicted.
+ * @param ctx Passed to callback.
+ * @return true if the frame must be sent in full: it is not a beacon, or it is a new or changed one.
+ **/
+bool beacon_dedup_observe(beacon_dedup_t *dedup, const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel,
+                          uint32_t now_us, beacon_summary_cb_t callback, void *ctx);
+
+/**
+ * @brief Emits summaries of all BSSIDs with suppressed beacons once the summary interval has elapsed.
+ * @param dedup Table.
+ * @param now_us Current time on the same clock as the receive timestamps.
+ * @param callback Receives the summaries.
+ * @param ctx Passed to callback.
+ **/
+void beacon_dedup_flush(beacon_dedup_t *dedup, uint32_t now_us, beacon_summary_cb_t callback, void *ctx);
+
+#endif // BEACON_DEDUP_H
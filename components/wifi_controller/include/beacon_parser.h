@@ -0,0 +1,30 @@
+/**
+ * @file beacon_parser.h
+ * @brief C interface to the 802.11 parser for turning captured beacons into AP records.
+ */
+#ifndef BEACON_PARSER_H
+#define BEACON_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_wifi_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fills AP record from a beacon or probe response.
+ * @param frame 802.11 frame starting with the MAC header, without FCS.
+ * @param len Frame length.
+ * @param record Output. BSSID, SSID, primary channel (0 if no DS element), auth mode and PHY flags are set; RSSI is left 0.
+ * @return false if the frame is not a well-formed beacon or probe response.
+ **/
+bool wifictl_parse_beacon(const uint8_t *frame, size_t len, wifi_ap_record_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BEACON_PARSER_H
@@ -0,0 +1,93 @@
+/**
+ * @file capture_filter.h
+ * @brief Capture filter expressions compiled into a compact predicate program.
+ *
+ * Pure logic without ESP-IDF dependencies. An expression such as
+ * `mgmt subtype beacon and bssid in {aa:bb:cc:dd:ee:ff, 11:22:33:44:55:66} and rssi > -70`
+ * is compiled once into tests on a single accumulator joined by forward conditional jumps,
+ * so `and`/`or` short-circuit and evaluation never recurses or allocates. MAC lists are kept
+ * as sorted arrays and matched by binary search.
+ *
+ * Grammar (juxtaposed terms are joined by `and`, `and` binds tighter than `or`):
+ *   expr      := term { "or" term }
+ *   term      := factor { ["and"] factor }
+ *   factor    := "not" factor | "(" expr ")" | primitive          (nested at most CAPTURE_FILTER_MAX_DEPTH deep)
+ *   primitive := "mgmt" | "data" | "ctrl"
+ *              | "subtype" (number | beacon | probe-req | probe-resp | assoc-req | assoc-resp
+ *                           | reassoc-req | reassoc-resp | disassoc | auth | deauth | action)
+ *              | ("bssid" | "src" | "dst" | "addr") (mac | "in" "{" mac { "," mac } "}")
+ *              | ("rssi" | "channel" | "len") [ "==" | "!=" | "<" | "<=" | ">" | ">=" ] number
+ */
+#ifndef CAPTURE_FILTER_H
+#define CAPTURE_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_CAPTURE_FILTER_MAX_INSNS                                     // CONFIG_CAPTURE_FILTER_MAX_INSNS
+#define CONFIG_CAPTURE_FILTER_MAX_INSNS 32                                  // Program length, tests and jumps
+#endif
+
+#ifndef CONFIG_CAPTURE_FILTER_MAX_MACS                                      // CONFIG_CAPTURE_FILTER_MAX_MACS
+#define CONFIG_CAPTURE_FILTER_MAX_MACS 32                                   // MAC addresses over all sets
+#endif
+
+#define CAPTURE_FILTER_MAX_SETS 8
+#define CAPTURE_FILTER_MAX_DEPTH 8                                          // Nested "(" and "not"
+
+typedef struct {
+    uint8_t op;                                                             // FILTER_OP_*, see capture_filter.c
+    uint8_t arg;                                                            // Address field, comparison or jump offset
+    int16_t value;                                                          // Operand or MAC set index
+} capture_filter_insn_t;
+
+typedef struct {
+    uint8_t first;                                                          // Index into macs
+    uint8_t count;
+} capture_filter_set_t;
+
+typedef struct {
+    capture_filter_insn_t insns[CONFIG_CAPTURE_FILTER_MAX_INSNS];
+    uint32_t hits[CONFIG_CAPTURE_FILTER_MAX_INSNS];                         // Times each test evaluated true
+    uint64_t macs[CONFIG_CAPTURE_FILTER_MAX_MACS];                          // Sorted within each set
+    capture_filter_set_t sets[CAPTURE_FILTER_MAX_SETS];
+    uint8_t insn_count;                                                     // 0 matches every frame
+    uint8_t mac_count;
+    uint8_t set_count;
+    uint32_t evaluated;                                                     // Frames the program ran on
+    uint32_t matched;                                                       // Frames accepted
+} capture_filter_t;
+
+/**
+ * @brief Compiles expression into filter. An empty expression matches every frame.
+ * @param filter Destination, compiled in place and undefined on error. Too large for small task stacks.
+ * @param expr Filter expression.
+ * @param error Set to a static description of the first error, may be NULL.
+ * @return false on syntax error, when nesting exceeds CAPTURE_FILTER_MAX_DEPTH or when program limits are exceeded.
+ **/
+bool capture_filter_compile(capture_filter_t *filter, const char *expr, const char **error);
+
+/**
+ * @brief Evaluates filter on a frame and updates its counters.
+ * @param filter Compiled filter.
+ * @param frame 802.11 frame starting with the MAC header.
+ * @param len Frame length.
+ * @param rssi RSSI of the frame.
+ * @param channel Channel the frame was captured on.
+ * @return true if the frame is accepted.
+ **/
+bool capture_filter_match(capture_filter_t *filter, const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel);
+
+/**
+ * @brief Writes human readable form of one instruction.
+ * @return Number of characters written, as snprintf.
+ **/
+int capture_filter_format_insn(const capture_filter_t *filter, size_t pc, char *buf, size_t size);
+
+/**
+ * @brief Clears evaluation and hit counters.
+ **/
+void capture_filter_reset_stats(capture_filter_t *filter);
+
+#endif // CAPTURE_FILTER_H
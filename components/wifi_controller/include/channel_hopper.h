@@ -0,0 +1,63 @@
+/**
+ * @file channel_hopper.h
+ * @brief Timer-driven channel hopping for the sniffer.
+ *
+ * Channel switches happen in an esp_timer callback; dwell times come from hop_scheduler
+ * fed with frame and new-BSSID counts observed by a sniffer batch handler.
+ */
+#ifndef CHANNEL_HOPPER_H
+#define CHANNEL_HOPPER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hop_scheduler.h"
+
+#ifndef CONFIG_CHANNEL_HOP_MIN_DWELL_MS                                     // CONFIG_CHANNEL_HOP_MIN_DWELL_MS
+#define CONFIG_CHANNEL_HOP_MIN_DWELL_MS 50
+#endif
+
+#ifndef CONFIG_CHANNEL_HOP_MAX_DWELL_MS                                     // CONFIG_CHANNEL_HOP_MAX_DWELL_MS
+#define CONFIG_CHANNEL_HOP_MAX_DWELL_MS 500
+#endif
+
+#ifndef CONFIG_CHANNEL_HOP_SEEN_BSSIDS                                      // CONFIG_CHANNEL_HOP_SEEN_BSSIDS
+#define CONFIG_CHANNEL_HOP_SEEN_BSSIDS 256                                  // BSSIDs remembered for discovery tracking, power of two
+#endif
+
+/**
+ * @brief Snapshot of hopping progress.
+ **/
+typedef struct {
+    hop_scheduler_t scheduler;                                              // Per-channel history and settings
+    uint32_t unique_bssids;                                                 // BSSIDs discovered since start
+    uint32_t running_ms;                                                    // Time since start
+    uint32_t last_discovery_ms;                                             // Time from start to the latest new BSSID
+} wifictl_channel_hop_stats_t;
+
+/**
+ * @brief Starts hopping over given channels. Promiscuous mode must already be enabled.
+ * @param channels Channel list, NULL for channels 1-13.
+ * @param count Number of channels.
+ * @param adaptive Adapt dwell to traffic, false for fixed round-robin with minimum dwell.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad channel list, ESP_ERR_INVALID_STATE if already hopping.
+ **/
+esp_err_t wifictl_channel_hop_start(const uint8_t *channels, size_t count, bool adaptive);
+
+/**
+ * @brief Stops hopping, radio stays on the current channel.
+ **/
+void wifictl_channel_hop_stop(void);
+
+/**
+ * @brief Returns true while hopping.
+ **/
+bool wifictl_channel_hop_active(void);
+
+/**
+ * @brief Copies hopping progress.
+ **/
+void wifictl_channel_hop_get_stats(wifictl_channel_hop_stats_t *stats);
+
+#endif // CHANNEL_HOPPER_H
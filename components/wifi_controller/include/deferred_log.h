@@ -0,0 +1,98 @@
+/**
+ * @file deferred_log.h
+ * @brief Logging for callbacks and hot paths that records arguments now and formats them later.
+ *
+ * DLOGx stores the format string pointer, which identifies the message, the tag, a timestamp
+ * and up to DEFERRED_LOG_MAX_ARGS raw 32-bit arguments into a ring of the calling core. Rings are
+ * lock-free multi-producer: a slot is reserved with a compare-and-swap and published with a
+ * release store, so DLOGx never takes a lock, never touches the UART and also works in ISRs.
+ * When the ring is full the record is dropped and counted. A low-priority task formats the
+ * records with the usual ESP_LOG prefix, honouring the runtime level of the tag.
+ *
+ * Arguments must be 32-bit: integers, characters and pointers. `%s` only with string literals or
+ * other strings that outlive the record. 64-bit and floating point arguments are not supported.
+ * Each argument is stored as a uintptr_t, which keeps pointers whole on 64-bit hosts.
+ * Levels above CONFIG_DEFERRED_LOG_LEVEL compile to nothing.
+ */
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifndef CONFIG_DEFERRED_LOG_LEVEL                                           // CONFIG_DEFERRED_LOG_LEVEL
+#define CONFIG_DEFERRED_LOG_LEVEL 4                                         // ESP_LOG_DEBUG
+#endif
+
+#ifndef CONFIG_DEFERRED_LOG_SLOTS                                           // CONFIG_DEFERRED_LOG_SLOTS
+#define CONFIG_DEFERRED_LOG_SLOTS 64                                        // Records per core, power of two
+#endif
+
+#ifndef CONFIG_DEFERRED_LOG_FLUSH_MS                                        // CONFIG_DEFERRED_LOG_FLUSH_MS
+#define CONFIG_DEFERRED_LOG_FLUSH_MS 20                                     // Formatter task polling period
+#endif
+
+#define DEFERRED_LOG_MAX_ARGS 4
+
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+
+#define DLOG_ARGS(n, ...) DLOG_ARGS_(n, ##__VA_ARGS__)
+#define DLOG_ARGS_(n, ...) DLOG_ARGS_##n(__VA_ARGS__)
+#define DLOG_ARGS_0()
+#define DLOG_ARGS_1(a) , (uintptr_t) (a)
+#define DLOG_ARGS_2(a, b) , (uintptr_t) (a), (uintptr_t) (b)
+#define DLOG_ARGS_3(a, b, c) , (uintptr_t) (a), (uintptr_t) (b), (uintptr_t) (c)
+#define DLOG_ARGS_4(a, b, c, d) , (uintptr_t) (a), (uintptr_t) (b), (uintptr_t) (c), (uintptr_t) (d)
+
+#define DLOG_LEVEL(level, tag, format, ...) do {                                                \
+        if ((level) <= CONFIG_DEFERRED_LOG_LEVEL) {                                             \
+            _Static_assert(DLOG_NARGS(__VA_ARGS__) <= DEFERRED_LOG_MAX_ARGS, "too many arguments"); \
+            deferred_log_write((level), (tag), (format), DLOG_NARGS(__VA_ARGS__)                \
+                               DLOG_ARGS(DLOG_NARGS(__VA_ARGS__), ##__VA_ARGS__));              \
+        }                                                                                       \
+    } while (0)
+
+#define DLOGE(tag, format, ...) DLOG_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define DLOGD(tag, format, ...) DLOG_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define DLOGV(tag, format, ...) DLOG_LEVEL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+typedef struct {
+    uint32_t written;                                                       // Records stored
+    uint32_t dropped;                                                       // Records lost to a full ring
+    uint32_t formatted;                                                     // Records printed or filtered by the formatter
+} deferred_log_stats_t;
+
+/**
+ * @brief Starts the formatter task. Records written before are kept until it runs.
+ * @return ESP_OK, also if already started; ESP_ERR_NO_MEM if the task cannot be created.
+ **/
+esp_err_t deferred_log_start(void);
+
+/**
+ * @brief Stores one record. Use the DLOGx macros.
+ * @param level esp_log_level_t.
+ * @param tag Tag, must outlive the record.
+ * @param format printf format, must outlive the record.
+ * @param nargs Number of uintptr_t arguments that follow.
+ **/
+void deferred_log_write(uint8_t level, const char *tag, const char *format, unsigned nargs, ...);
+
+/**
+ * @brief Copies counters summed over all cores.
+ **/
+void deferred_log_get_stats(deferred_log_stats_t *stats);
+
+/**
+ * @brief Measures the calling cost of DLOGI and of ESP_LOGI with output discarded.
+ * @param iterations Calls of each kind.
+ * @param deferred_ns Receives average cost of a deferred call.
+ * @param direct_ns Receives average cost of a direct call, formatting and log locking included, UART excluded.
+ * @note Temporarily replaces the log output function; must not run while other tasks log.
+ **/
+void deferred_log_benchmark(unsigned iterations, uint32_t *deferred_ns, uint32_t *direct_ns);
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,59 @@
+/**
+ * @file frame_codec.h
+ * @brief Small-footprint dictionary compressor for single captured frames.
+ *
+ * Output is an LZ4 block whose matches may reference a preset dictionary placed in front of the
+ * input, as with LZ4's external dictionary support. Every frame is compressed on its own, so a
+ * record lost on the link does not affect the next one, and the dictionary supplies the history a
+ * single short frame lacks: radiotap template, MAC headers, LLC/SNAP and common information elements.
+ * The caller writes the input right behind the dictionary, so compressing needs no copy.
+ * Greedy parsing with one hash table for the dictionary, built once, and one for the current frame.
+ * Pure logic without ESP-IDF dependencies.
+ */
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_CODEC_HASH_BITS 10
+#define FRAME_CODEC_MAX_WINDOW 65535                                        // Dictionary plus input, limited by LZ4 offsets
+
+typedef struct {
+    uint8_t *window;                                                        // Dictionary followed by input
+    size_t dict_len;
+    size_t capacity;                                                        // Maximum input length
+    uint16_t dict_table[1 << FRAME_CODEC_HASH_BITS];                        // Positions of dictionary sequences
+    uint16_t table[1 << FRAME_CODEC_HASH_BITS];                             // Positions of input sequences
+} frame_codec_t;
+
+/**
+ * @brief Copies dictionary to the front of the window and indexes it.
+ * @param codec Codec.
+ * @param window Buffer holding dictionary and input, must stay valid while the codec is used.
+ * @param window_size Size of window, at most FRAME_CODEC_MAX_WINDOW.
+ * @param dict Dictionary, may be NULL if dict_len is 0.
+ * @param dict_len Dictionary length.
+ * @return false if the window cannot hold the dictionary.
+ **/
+bool frame_codec_init(frame_codec_t *codec, uint8_t *window, size_t window_size, const uint8_t *dict, size_t dict_len);
+
+/**
+ * @brief Returns where the input of the next frame_codec_compress call has to be written.
+ **/
+static inline uint8_t *frame_codec_input(frame_codec_t *codec) {
+    return codec->window + codec->dict_len;
+}
+
+/**
+ * @brief Compresses input previously written to frame_codec_input().
+ * @param codec Codec.
+ * @param len Input length, at most codec->capacity.
+ * @param dst Output buffer.
+ * @param capacity Output buffer size.
+ * @return Compressed length, 0 if it does not fit into capacity.
+ **/
+size_t frame_codec_compress(frame_codec_t *codec, size_t len, uint8_t *dst, size_t capacity);
+
+#endif // FRAME_CODEC_H
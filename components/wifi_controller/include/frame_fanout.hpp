@@ -0,0 +1,152 @@
+/**
+ * @file frame_fanout.hpp
+ * @brief Zero-copy broadcast of captured frames to consumers listed at compile time.
+ *
+ * Header-only C++17 with the standard library only, so it builds for the ESP32 as well as for a
+ * Linux host. One producer publishes frame handles into a ring; every consumer type in the template
+ * parameter pack reads the ring through its own cursor and is called with the frame in place.
+ * Each slot holds a reference count set to the number of consumers, and the consumer that drops it
+ * to zero hands the frame to the release functor, so the buffer goes back to its pool as soon as
+ * the slowest consumer is done with it. The fan-out never copies a frame; a consumer still may, e.g.
+ * the sniffer's event loop bridge, whose esp_event_post copies every frame once into the event queue
+ * because SNIFFER_EVENTS subscribers receive the packet by value.
+ *
+ * Consumer dispatch is resolved at compile time: `drain<I>()` calls `Consumer<I>::on_frame` directly,
+ * without function pointers. Every consumer is drained from one context (task) at a time, different
+ * consumers may be drained concurrently. When the slowest consumer is `Capacity` frames behind,
+ * `publish` refuses the frame instead of waiting.
+ */
+#ifndef FRAME_FANOUT_HPP
+#define FRAME_FANOUT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+namespace wifictl {
+
+namespace detail {
+
+template <typename T, typename... Ts>
+struct IndexOf;
+
+template <typename T, typename... Ts>
+struct IndexOf<T, T, Ts...> : std::integral_constant<size_t, 0> {};
+
+template <typename T, typename U, typename... Ts>
+struct IndexOf<T, U, Ts...> : std::integral_constant<size_t, 1 + IndexOf<T, Ts...>::value> {};
+
+}  // namespace detail
+
+/**
+ * @brief Broadcast ring of reference-counted frame handles.
+ * @tparam Frame Frame type, consumers receive `const Frame &`.
+ * @tparam Release Functor called with the frame once every consumer has seen it.
+ * @tparam Capacity Ring slots, power of two.
+ * @tparam Consumers Consumer types, each with `void on_frame(const Frame &)`.
+ */
+template <typename Frame, typename Release, size_t Capacity, typename... Consumers>
+class FrameFanout {
+    static_assert(sizeof...(Consumers) > 0, "at least one consumer");
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static constexpr size_t kConsumers = sizeof...(Consumers);
+
+    explicit FrameFanout(Consumers &...consumers) : consumers_(consumers...) {}
+
+    FrameFanout(const FrameFanout &) = delete;
+    FrameFanout &operator=(const FrameFanout &) = delete;
+
+    /**
+     * @brief Hands a frame to every consumer. Single producer.
+     * @return false if the slot is still referenced by the slowest consumer; the frame stays with the caller.
+     */
+    bool publish(Frame *frame) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[head & (Capacity - 1)];
+        if (slot.refs.load(std::memory_order_acquire) != 0) {
+            return false;
+        }
+        slot.frame = frame;
+        slot.refs.store(kConsumers, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);                   // Publishes slot contents to the consumers
+        return true;
+    }
+
+    /**
+     * @brief Calls consumer I with up to `max` frames it has not seen yet, oldest first.
+     * @return Frames delivered.
+     */
+    template <size_t I>
+    size_t drain(size_t max) {
+        static_assert(I < kConsumers, "no such consumer");
+        auto &consumer = std::get<I>(consumers_);
+        size_t cursor = cursors_[I].load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t delivered = 0;
+        while (cursor != head && delivered < max) {
+            Slot &slot = slots_[cursor & (Capacity - 1)];
+            Frame *frame = slot.frame;                                      // Read before the slot can be reused
+            consumer.on_frame(static_cast<const Frame &>(*frame));
+            cursors_[I].store(++cursor, std::memory_order_relaxed);
+            if (slot.refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {   // Last reference: slot and frame are free
+                release_(frame);
+            }
+            delivered++;
+        }
+        return delivered;
+    }
+
+    /** @brief drain() addressed by consumer type. */
+    template <typename Consumer>
+    size_t drain(size_t max) {
+        return drain<detail::IndexOf<Consumer, Consumers...>::value>(max);
+    }
+
+    /** @brief Drains every consumer in turn from one context. @return Frames delivered in total. */
+    size_t drain_all(size_t max) {
+        return drain_all(max, std::index_sequence_for<Consumers...>());
+    }
+
+    /** @brief Frames published but not yet seen by consumer I. */
+    template <size_t I>
+    size_t backlog() const {
+        return head_.load(std::memory_order_acquire) - cursors_[I].load(std::memory_order_relaxed);
+    }
+
+    /** @brief Frames consumer I has seen so far. */
+    template <size_t I>
+    size_t delivered() const {
+        return cursors_[I].load(std::memory_order_relaxed);
+    }
+
+    /** @brief Frames published so far. */
+    size_t published() const { return head_.load(std::memory_order_relaxed); }
+
+    template <size_t I>
+    auto &consumer() { return std::get<I>(consumers_); }
+
+private:
+    struct Slot {
+        Frame *frame = nullptr;
+        std::atomic<uint32_t> refs{0};                                      // Consumers that have not seen the frame yet
+    };
+
+    template <size_t... I>
+    size_t drain_all(size_t max, std::index_sequence<I...>) {
+        return (drain<I>(max) + ...);
+    }
+
+    std::tuple<Consumers &...> consumers_;
+    Release release_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> cursors_[kConsumers] = {};
+    Slot slots_[Capacity];
+};
+
+}  // namespace wifictl
+
+#endif // FRAME_FANOUT_HPP
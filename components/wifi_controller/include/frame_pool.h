@@ -0,0 +1,79 @@
+/**
+ * @file frame_pool.h
+ * @brief Preallocated fixed-memory pool of capture buffers split into size classes.
+ *
+ * Buffers live in static arenas, so capturing never touches the heap. Each class keeps
+ * high-water-mark and exhaustion counters, which is what a fixed RAM budget is sized from.
+ */
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_FRAME_POOL_SMALL_SIZE                                        // CONFIG_FRAME_POOL_SMALL_SIZE
+#define CONFIG_FRAME_POOL_SMALL_SIZE 128                                    // Control frames (RTS/CTS/ACK/BlockAck)
+#endif
+#ifndef CONFIG_FRAME_POOL_SMALL_COUNT                                       // CONFIG_FRAME_POOL_SMALL_COUNT
+#define CONFIG_FRAME_POOL_SMALL_COUNT 32
+#endif
+#ifndef CONFIG_FRAME_POOL_MEDIUM_SIZE                                       // CONFIG_FRAME_POOL_MEDIUM_SIZE
+#define CONFIG_FRAME_POOL_MEDIUM_SIZE 640                                   // Management frames (beacons, probes)
+#endif
+#ifndef CONFIG_FRAME_POOL_MEDIUM_COUNT                                      // CONFIG_FRAME_POOL_MEDIUM_COUNT
+#define CONFIG_FRAME_POOL_MEDIUM_COUNT 32
+#endif
+#ifndef CONFIG_FRAME_POOL_LARGE_SIZE                                        // CONFIG_FRAME_POOL_LARGE_SIZE
+#define CONFIG_FRAME_POOL_LARGE_SIZE 1664                                   // Data frames up to a full MSDU
+#endif
+#ifndef CONFIG_FRAME_POOL_LARGE_COUNT                                       // CONFIG_FRAME_POOL_LARGE_COUNT
+#define CONFIG_FRAME_POOL_LARGE_COUNT 12
+#endif
+
+typedef enum {
+    FRAME_POOL_CLASS_SMALL,
+    FRAME_POOL_CLASS_MEDIUM,
+    FRAME_POOL_CLASS_LARGE,
+    FRAME_POOL_CLASS_COUNT
+} frame_pool_class_t;
+
+/**
+ * @brief Counters of one size class.
+ **/
+typedef struct {
+    uint16_t buffer_size;                                                   // Bytes per buffer
+    uint16_t capacity;                                                      // Number of buffers
+    uint16_t in_use;                                                        // Buffers currently allocated
+    uint16_t high_water;                                                    // Maximum of in_use since last reset
+    uint32_t allocated;                                                     // Successful allocations
+    uint32_t exhausted;                                                     // Allocations that found the class empty
+} frame_pool_class_stats_t;
+
+typedef struct {
+    frame_pool_class_stats_t classes[FRAME_POOL_CLASS_COUNT];
+    uint32_t oversize;                                                      // Requests larger than the largest class
+} frame_pool_stats_t;
+
+/**
+ * @brief Takes a buffer of at least `size` bytes from the smallest fitting class.
+ * @note Safe to call from the Wi-Fi task. Falls through to a larger class when the fitting one is empty.
+ * @return Buffer or NULL if no class can serve the request.
+ **/
+void *frame_pool_alloc(size_t size);
+
+/**
+ * @brief Returns buffer obtained from frame_pool_alloc. NULL is ignored.
+ **/
+void frame_pool_free(void *buf);
+
+/**
+ * @brief Copies pool counters.
+ **/
+void frame_pool_get_stats(frame_pool_stats_t *stats);
+
+/**
+ * @brief Resets high-water marks to current usage and clears allocation/exhaustion counters.
+ **/
+void frame_pool_reset_stats(void);
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,50 @@
+/**
+ * @file frame_ring.h
+ * @brief Bounded lock-free single-producer/single-consumer ring of frame pointers.
+ *
+ * The producer (promiscuous callback running in the Wi-Fi task) only ever writes
+ * `head`, the consumer only ever writes `tail`. Neither side blocks: a push into
+ * a full ring fails and the caller decides what to drop.
+ */
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+typedef struct {
+    void **slots;                                                          // Storage for item pointers
+    uint32_t mask;                                                         // Capacity - 1 (capacity is a power of two)
+    _Atomic uint32_t head;                                                 // Next slot to write (producer owned)
+    _Atomic uint32_t tail;                                                 // Next slot to read (consumer owned)
+} frame_ring_t;
+
+/**
+ * @brief Initializes ring over caller provided storage.
+ * @param ring Ring to initialize.
+ * @param storage Array of `capacity` pointers.
+ * @param capacity Number of slots, must be a power of two.
+ * @return true on success, false if capacity is not a power of two.
+ **/
+bool frame_ring_init(frame_ring_t *ring, void **storage, uint32_t capacity);
+
+/**
+ * @brief Pushes one item. Producer side only, never blocks.
+ * @return true if item was stored, false if the ring is full.
+ **/
+bool frame_ring_push(frame_ring_t *ring, void *item);
+
+/**
+ * @brief Pops up to `max` items in FIFO order. Consumer side only, never blocks.
+ * @return Number of items written to `out`.
+ **/
+size_t frame_ring_pop_batch(frame_ring_t *ring, void **out, size_t max);
+
+/**
+ * @brief Returns number of items currently queued (approximate when called concurrently).
+ **/
+uint32_t frame_ring_count(const frame_ring_t *ring);
+
+#endif // FRAME_RING_H
@@ -0,0 +1,74 @@
+/**
+ * @file hop_scheduler.h
+ * @brief Adaptive dwell-time scheduler for channel hopping.
+ *
+ * Pure logic without ESP-IDF dependencies: the caller reports what it observed during the
+ * visit that just ended and gets the next channel and its dwell time back. Each channel keeps
+ * an EWMA of frame rate and of new-BSSID discoveries per visit; quiet channels get dwell close
+ * to the minimum, busy or still-discovering channels close to the maximum. With `adaptive`
+ * disabled every channel gets the same dwell, which is plain round-robin.
+ */
+#ifndef HOP_SCHEDULER_H
+#define HOP_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOP_MAX_CHANNELS 14
+
+#define HOP_RATE_HALF_FPS 50                                                // Frame rate at which activity score reaches one half
+
+typedef struct {
+    uint8_t channel;
+    uint32_t rate_ewma_q8;                                                  // Frames per second, Q8 fixed point
+    uint32_t new_ewma_q8;                                                   // New BSSIDs per visit, Q8 fixed point
+    uint32_t visits;
+    uint32_t frames;                                                        // Total frames seen on this channel
+    uint32_t new_bssids;                                                    // Total BSSIDs first seen on this channel
+    uint32_t dwell_total_ms;                                                // Total time spent on this channel
+} hop_channel_state_t;
+
+typedef struct {
+    hop_channel_state_t channels[HOP_MAX_CHANNELS];
+    uint8_t count;
+    uint8_t current;                                                        // Index into channels
+    uint16_t min_dwell_ms;
+    uint16_t max_dwell_ms;
+    bool adaptive;
+} hop_scheduler_t;
+
+/**
+ * @brief Initializes scheduler.
+ * @param sched Scheduler.
+ * @param channels Channel list, at most HOP_MAX_CHANNELS entries.
+ * @param count Number of channels.
+ * @param min_dwell_ms Dwell of a channel with no activity (and round-robin dwell when not adaptive).
+ * @param max_dwell_ms Upper bound of dwell.
+ * @param adaptive Adapt dwell to observed traffic.
+ * @return false if channel list is empty or too long.
+ **/
+bool hop_scheduler_init(hop_scheduler_t *sched, const uint8_t *channels, size_t count,
+                        uint16_t min_dwell_ms, uint16_t max_dwell_ms, bool adaptive);
+
+/**
+ * @brief Returns channel of the current visit.
+ **/
+uint8_t hop_scheduler_channel(const hop_scheduler_t *sched);
+
+/**
+ * @brief Returns dwell time for channel at given index, based on its history.
+ **/
+uint16_t hop_scheduler_dwell(const hop_scheduler_t *sched, size_t index);
+
+/**
+ * @brief Closes the current visit and advances to the next channel.
+ * @param sched Scheduler.
+ * @param frames Frames seen during the visit.
+ * @param new_bssids BSSIDs seen for the first time during the visit.
+ * @param elapsed_ms Actual duration of the visit.
+ * @return Dwell time of the visit that starts now.
+ **/
+uint16_t hop_scheduler_next(hop_scheduler_t *sched, uint32_t frames, uint32_t new_bssids, uint32_t elapsed_ms);
+
+#endif // HOP_SCHEDULER_H
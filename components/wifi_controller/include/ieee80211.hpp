@@ -0,0 +1,470 @@
+/**
+ * @file ieee80211.hpp
+ * @brief Zero-copy parser for 802.11 MAC headers and management frame information elements.
+ *
+ * Header-only C++17, no allocation and no copying: every type is a non-owning view over the
+ * captured buffer, which must outlive it. Depends on the standard library only, so it builds
+ * for the ESP32 as well as for a Linux host.
+ *
+ * IE dispatch is resolved at compile time: `dispatch_ies<Ssid, DsParameterSet, ...>(ies, visitor)`
+ * expands to a chain of id comparisons over the listed element types, and the visitor is called
+ * with the parsed typed view.
+ */
+#ifndef IEEE80211_HPP
+#define IEEE80211_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace ieee80211 {
+
+/**
+ * @brief Bounds-checked non-owning byte range.
+ */
+class ByteView {
+public:
+    constexpr ByteView() = default;
+    constexpr ByteView(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+    constexpr const uint8_t *data() const { return data_; }
+    constexpr size_t size() const { return size_; }
+    constexpr bool empty() const { return size_ == 0; }
+    constexpr uint8_t operator[](size_t i) const { return data_[i]; }
+
+    constexpr uint16_t le16(size_t offset) const { return uint16_t(data_[offset] | (data_[offset + 1] << 8)); }
+    constexpr uint32_t le32(size_t offset) const {
+        return uint32_t(data_[offset]) | uint32_t(data_[offset + 1]) << 8 | uint32_t(data_[offset + 2]) << 16 |
+               uint32_t(data_[offset + 3]) << 24;
+    }
+
+    /** @brief Sub-range, empty if out of bounds. */
+    constexpr ByteView sub(size_t offset, size_t length) const {
+        return offset <= size_ && length <= size_ - offset ? ByteView(data_ + offset, length) : ByteView();
+    }
+    constexpr ByteView skip(size_t offset) const { return offset <= size_ ? ByteView(data_ + offset, size_ - offset) : ByteView(); }
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+/** @brief Non-owning view of a 6-byte MAC address. */
+struct MacAddress {
+    const uint8_t *bytes = nullptr;
+
+    constexpr uint8_t operator[](size_t i) const { return bytes[i]; }
+    constexpr bool is_group() const { return bytes[0] & 0x01; }
+    constexpr bool operator==(const MacAddress &other) const {
+        for (size_t i = 0; i < 6; i++) {
+            if (bytes[i] != other.bytes[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+enum class FrameType : uint8_t { Management = 0, Control = 1, Data = 2, Extension = 3 };
+
+namespace subtype {
+constexpr uint8_t AssocRequest = 0;
+constexpr uint8_t AssocResponse = 1;
+constexpr uint8_t ReassocRequest = 2;
+constexpr uint8_t ReassocResponse = 3;
+constexpr uint8_t ProbeRequest = 4;
+constexpr uint8_t ProbeResponse = 5;
+constexpr uint8_t Beacon = 8;
+constexpr uint8_t Disassoc = 10;
+constexpr uint8_t Auth = 11;
+constexpr uint8_t Deauth = 12;
+constexpr uint8_t Action = 13;
+constexpr uint8_t QosData = 8;                                              // Data subtypes with bit 3 set carry QoS control
+}  // namespace subtype
+
+/**
+ * @brief 802.11 MAC header view. Address fields that are absent for the frame type are null.
+ */
+class MacHeader {
+public:
+    static constexpr size_t kMinLength = 10;                                // FC + duration + addr1 (ACK/CTS)
+
+    /** @brief Parses header at the start of `frame`. Returns nullopt when the frame is shorter than its header. */
+    static constexpr std::optional<MacHeader> parse(ByteView frame) {
+        if (frame.size() < kMinLength) {
+            return std::nullopt;
+        }
+        MacHeader h;
+        h.fc_ = frame.le16(0);
+        h.duration_ = frame.le16(2);
+        h.addr1_ = MacAddress{frame.data() + 4};
+
+        size_t length = 10;
+        switch (h.type()) {
+            case FrameType::Management:
+                length = 24;
+                break;
+            case FrameType::Data:
+                length = 24;
+                if (h.to_ds() && h.from_ds()) {
+                    length += 6;
+                }
+                if (h.subtype() & subtype::QosData) {
+                    length += 2;
+                }
+                break;
+            case FrameType::Control:
+                length = control_length(h.subtype());
+                break;
+            case FrameType::Extension:
+                return std::nullopt;
+        }
+        if (h.order() && (h.type() == FrameType::Management || (h.type() == FrameType::Data && (h.subtype() & subtype::QosData)))) {
+            length += 4;                                                    // HT control field
+        }
+        if (frame.size() < length) {
+            return std::nullopt;
+        }
+        if (length >= 16) {
+            h.addr2_ = MacAddress{frame.data() + 10};
+        }
+        if (length >= 24) {
+            h.addr3_ = MacAddress{frame.data() + 16};
+            h.seq_ctrl_ = frame.le16(22);
+        }
+        if (h.type() == FrameType::Data && h.to_ds() && h.from_ds()) {
+            h.addr4_ = MacAddress{frame.data() + 24};
+        }
+        h.length_ = uint8_t(length);
+        return h;
+    }
+
+    constexpr uint16_t frame_control() const { return fc_; }
+    constexpr FrameType type() const { return FrameType((fc_ >> 2) & 0x3); }
+    constexpr uint8_t subtype() const { return uint8_t((fc_ >> 4) & 0xf); }
+    constexpr bool to_ds() const { return fc_ & 0x0100; }
+    constexpr bool from_ds() const { return fc_ & 0x0200; }
+    constexpr bool retry() const { return fc_ & 0x0800; }
+    constexpr bool protected_frame() const { return fc_ & 0x4000; }
+    constexpr bool order() const { return fc_ & 0x8000; }
+    constexpr uint16_t duration() const { return duration_; }
+    constexpr uint16_t sequence_number() const { return seq_ctrl_ >> 4; }
+    constexpr uint8_t fragment_number() const { return seq_ctrl_ & 0xf; }
+    constexpr size_t length() const { return length_; }
+
+    constexpr std::optional<MacAddress> addr1() const { return opt(addr1_); }
+    constexpr std::optional<MacAddress> addr2() const { return opt(addr2_); }
+    constexpr std::optional<MacAddress> addr3() const { return opt(addr3_); }
+    constexpr std::optional<MacAddress> addr4() const { return opt(addr4_); }
+
+    /** @brief BSSID according to the ToDS/FromDS combination, nullopt for WDS and short control frames. */
+    constexpr std::optional<MacAddress> bssid() const {
+        if (type() == FrameType::Management) {
+            return addr3();
+        }
+        if (type() != FrameType::Data) {
+            return std::nullopt;
+        }
+        if (!to_ds() && !from_ds()) {
+            return addr3();
+        }
+        if (to_ds() && !from_ds()) {
+            return addr1();
+        }
+        if (!to_ds() && from_ds()) {
+            return addr2();
+        }
+        return std::nullopt;
+    }
+
+private:
+    static constexpr size_t control_length(uint8_t sub) {
+        switch (sub) {
+            case 12:                                                        // CTS
+            case 13:                                                        // ACK
+                return 10;
+            case 8:                                                         // BlockAckReq
+            case 9:                                                         // BlockAck
+                return 20;
+            default:                                                        // RTS, PS-Poll, CF-End, ...
+                return 16;
+        }
+    }
+    static constexpr std::optional<MacAddress> opt(MacAddress a) {
+        return a.bytes ? std::optional<MacAddress>(a) : std::nullopt;
+    }
+
+    uint16_t fc_ = 0;
+    uint16_t duration_ = 0;
+    uint16_t seq_ctrl_ = 0;
+    uint8_t length_ = 0;
+    MacAddress addr1_{}, addr2_{}, addr3_{}, addr4_{};
+};
+
+/** @brief Raw information element. */
+struct InformationElement {
+    uint8_t id = 0;
+    ByteView body;
+};
+
+/**
+ * @brief Forward range over tagged information elements. Iteration stops at the first truncated element.
+ */
+class IeRange {
+public:
+    class iterator {
+    public:
+        constexpr iterator(ByteView rest) : rest_(rest) { load(); }
+        constexpr const InformationElement &operator*() const { return current_; }
+        constexpr const InformationElement *operator->() const { return &current_; }
+        constexpr iterator &operator++() {
+            rest_ = rest_.skip(2 + current_.body.size());
+            load();
+            return *this;
+        }
+        constexpr bool operator!=(const iterator &other) const { return rest_.data() != other.rest_.data(); }
+
+    private:
+        constexpr void load() {
+            if (rest_.size() < 2 || rest_.size() < size_t(2 + rest_[1])) {
+                rest_ = ByteView();                                         // Truncated or end: becomes end iterator
+                return;
+            }
+            current_ = InformationElement{rest_[0], rest_.sub(2, rest_[1])};
+        }
+
+        ByteView rest_;
+        InformationElement current_{};
+    };
+
+    constexpr explicit IeRange(ByteView ies) : ies_(ies) {}
+    constexpr iterator begin() const { return iterator(ies_); }
+    constexpr iterator end() const { return iterator(ByteView()); }
+
+    /** @brief First element with given id, nullopt if absent. */
+    constexpr std::optional<InformationElement> find(uint8_t id) const {
+        for (const auto &ie : *this) {
+            if (ie.id == id) {
+                return ie;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    ByteView ies_;
+};
+
+// Typed element views. Each declares `kId` and a `parse` returning nullopt for malformed bodies.
+
+struct Ssid {
+    static constexpr uint8_t kId = 0;
+    std::string_view name;
+    static constexpr std::optional<Ssid> parse(ByteView body) {
+        if (body.size() > 32) {
+            return std::nullopt;
+        }
+        return Ssid{std::string_view(reinterpret_cast<const char *>(body.data()), body.size())};
+    }
+    constexpr bool hidden() const {
+        for (char c : name) {
+            if (c != '\0') {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct DsParameterSet {
+    static constexpr uint8_t kId = 3;
+    uint8_t channel = 0;
+    static constexpr std::optional<DsParameterSet> parse(ByteView body) {
+        if (body.size() != 1) {
+            return std::nullopt;
+        }
+        return DsParameterSet{body[0]};
+    }
+};
+
+struct HtCapabilities {
+    static constexpr uint8_t kId = 45;
+    uint16_t info = 0;
+    uint8_t ampdu_params = 0;
+    ByteView mcs_set;                                                       // 16-byte supported MCS set
+    static constexpr std::optional<HtCapabilities> parse(ByteView body) {
+        if (body.size() != 26) {
+            return std::nullopt;
+        }
+        return HtCapabilities{body.le16(0), body[2], body.sub(3, 16)};
+    }
+    constexpr bool supports_40mhz() const { return info & 0x0002; }
+    constexpr bool short_gi_20() const { return info & 0x0020; }
+    constexpr bool short_gi_40() const { return info & 0x0040; }
+    /** @brief Number of spatial streams advertised in the RX MCS bitmask. */
+    constexpr uint8_t spatial_streams() const {
+        uint8_t n = 0;
+        for (size_t i = 0; i < 4; i++) {
+            n += mcs_set[i] != 0;
+        }
+        return n;
+    }
+};
+
+struct VhtCapabilities {
+    static constexpr uint8_t kId = 191;
+    uint32_t info = 0;
+    uint16_t rx_mcs_map = 0;
+    uint16_t tx_mcs_map = 0;
+    static constexpr std::optional<VhtCapabilities> parse(ByteView body) {
+        if (body.size() != 12) {
+            return std::nullopt;
+        }
+        return VhtCapabilities{body.le32(0), body.le16(4), body.le16(8)};
+    }
+    constexpr uint8_t max_mpdu_length_code() const { return info & 0x3; }
+    constexpr uint8_t supported_channel_width() const { return (info >> 2) & 0x3; }
+};
+
+/**
+ * @brief RSN element. Suite lists are views of 4-byte OUI+type selectors.
+ */
+struct Rsn {
+    static constexpr uint8_t kId = 48;
+    uint16_t version = 0;
+    uint32_t group_cipher = 0;                                              // OUI << 8 | type, big-endian as on air
+    ByteView pairwise_ciphers;
+    ByteView akm_suites;
+    uint16_t capabilities = 0;
+
+    static constexpr std::optional<Rsn> parse(ByteView body) {
+        Rsn rsn;
+        if (body.size() < 2) {
+            return std::nullopt;
+        }
+        rsn.version = body.le16(0);
+        size_t offset = 2;
+        if (body.size() < offset + 4) {
+            return rsn;                                                     // Remaining fields are optional
+        }
+        rsn.group_cipher = selector(body, offset);
+        offset += 4;
+        if (!suite_list(body, offset, rsn.pairwise_ciphers) || !suite_list(body, offset, rsn.akm_suites)) {
+            return std::nullopt;
+        }
+        if (body.size() >= offset + 2) {
+            rsn.capabilities = body.le16(offset);
+        }
+        return rsn;
+    }
+
+    constexpr size_t pairwise_count() const { return pairwise_ciphers.size() / 4; }
+    constexpr size_t akm_count() const { return akm_suites.size() / 4; }
+    constexpr uint32_t pairwise(size_t i) const { return selector(pairwise_ciphers, i * 4); }
+    constexpr uint32_t akm(size_t i) const { return selector(akm_suites, i * 4); }
+
+private:
+    static constexpr uint32_t selector(ByteView v, size_t offset) {
+        return uint32_t(v[offset]) << 24 | uint32_t(v[offset + 1]) << 16 | uint32_t(v[offset + 2]) << 8 | v[offset + 3];
+    }
+    static constexpr bool suite_list(ByteView body, size_t &offset, ByteView &out) {
+        if (body.size() < offset + 2) {
+            return true;                                                    // Absent list is allowed at the end
+        }
+        size_t count = body.le16(offset);
+        offset += 2;
+        out = body.sub(offset, count * 4);
+        if (out.size() != count * 4) {
+            return false;
+        }
+        offset += count * 4;
+        return true;
+    }
+};
+
+namespace detail {
+template <typename Visitor>
+constexpr bool dispatch_one(const InformationElement &, Visitor &&) {
+    return false;
+}
+
+template <typename Visitor, typename First, typename... Rest>
+constexpr bool dispatch_one(const InformationElement &ie, Visitor &&visitor, const First *, const Rest *...rest) {
+    if (ie.id == First::kId) {
+        if (auto parsed = First::parse(ie.body)) {
+            visitor(*parsed);
+        }
+        return true;
+    }
+    return dispatch_one(ie, visitor, rest...);
+}
+}  // namespace detail
+
+/**
+ * @brief Calls `visitor` with the typed view of every element whose id matches one of `Elements`.
+ * @return Number of elements that matched a listed type.
+ */
+template <typename... Elements, typename Visitor>
+constexpr size_t dispatch_ies(IeRange ies, Visitor &&visitor) {
+    size_t matched = 0;
+    for (const auto &ie : ies) {
+        matched += detail::dispatch_one(ie, visitor, static_cast<const Elements *>(nullptr)...);
+    }
+    return matched;
+}
+
+/**
+ * @brief Management frame with fixed fields and element list (beacon, probe request/response).
+ */
+class ManagementFrame {
+public:
+    static constexpr size_t kBeaconFixedLength = 12;                        // Timestamp, interval, capability
+
+    /** @brief Parses beacon, probe request or probe response. `frame` must not include the FCS. */
+    static constexpr std::optional<ManagementFrame> parse(ByteView frame) {
+        auto header = MacHeader::parse(frame);
+        if (!header || header->type() != FrameType::Management) {
+            return std::nullopt;
+        }
+        ByteView body = frame.skip(header->length());
+        ManagementFrame mf;
+        mf.header_ = *header;
+        switch (header->subtype()) {
+            case subtype::Beacon:
+            case subtype::ProbeResponse:
+                if (body.size() < kBeaconFixedLength) {
+                    return std::nullopt;
+                }
+                mf.timestamp_ = uint64_t(body.le32(0)) | uint64_t(body.le32(4)) << 32;
+                mf.beacon_interval_ = body.le16(8);
+                mf.capability_ = body.le16(10);
+                mf.ies_ = body.skip(kBeaconFixedLength);
+                return mf;
+            case subtype::ProbeRequest:
+                mf.ies_ = body;
+                return mf;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    constexpr const MacHeader &header() const { return header_; }
+    constexpr uint64_t timestamp() const { return timestamp_; }
+    constexpr uint16_t beacon_interval() const { return beacon_interval_; }
+    constexpr uint16_t capability() const { return capability_; }
+    constexpr bool privacy() const { return capability_ & 0x0010; }
+    constexpr IeRange ies() const { return IeRange(ies_); }
+    constexpr ByteView raw_ies() const { return ies_; }
+
+private:
+    MacHeader header_{};
+    uint64_t timestamp_ = 0;
+    uint16_t beacon_interval_ = 0;
+    uint16_t capability_ = 0;
+    ByteView ies_;
+};
+
+}  // namespace ieee80211
+
+#endif // IEEE80211_HPP
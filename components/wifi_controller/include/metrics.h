@@ -0,0 +1,138 @@
+/**
+ * @file metrics.h
+ * @brief Runtime counters and log2 latency histograms of the capture, scan and output paths.
+ *
+ * Every core updates its own copy of the counters and histogram buckets with relaxed atomic adds,
+ * so recording never takes a lock and never contends with the other core; readers sum the copies.
+ * A histogram bucket `b` holds values in [2^(b-1), 2^b), bucket 0 holds zero and the last bucket
+ * everything larger. With CONFIG_METRICS_ENABLED unset the recording macros compile to nothing.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#define METRICS_HIST_BUCKETS 20                                             // Last bucket starts at 2^18
+
+typedef enum {
+    METRIC_FRAMES_DATA,                                                     // Frames seen by the promiscuous callback, per type
+    METRIC_FRAMES_MGMT,
+    METRIC_FRAMES_CTRL,
+    METRIC_FRAMES_FILTERED,                                                 // Rejected by the capture filter
+    METRIC_POOL_EXHAUSTED,                                                  // No frame buffer of the needed size class
+    METRIC_RING_FULL,                                                       // Capture ring full
+    METRIC_EVENT_POST_FAILED,                                               // esp_event_post timed out or failed
+    METRIC_FANOUT_DROPPED,                                                  // Fan-out full, frame not published
+    METRIC_BATCHES,                                                         // Batches through the capture pipeline
+    METRIC_SCANS,                                                           // Completed or cancelled scans
+    METRIC_CHANNEL_SWITCHES,                                                // Channel changes of the hopper
+    METRIC_UART_BYTES,                                                      // Bytes written by result records and PCAP export
+    METRIC_COUNTER_COUNT
+} metric_counter_t;
+
+typedef enum {
+    METRIC_HIST_CAPTURE,                                                    // Promiscuous callback duration (us)
+    METRIC_HIST_QUEUE_WAIT,                                                 // Capture to parse stage pop (us)
+    METRIC_HIST_PARSE,                                                      // Parse stage time per batch (us)
+    METRIC_HIST_AGGREGATE,                                                  // Aggregate stage time per batch, handlers and posts (us)
+    METRIC_HIST_BACKLOG,                                                    // Frames waiting in the ring when drained
+    METRIC_HIST_SCAN,                                                       // Scan duration (ms)
+    METRIC_HIST_UART,                                                       // Duration of one UART write (us)
+    METRIC_HIST_COUNT
+} metric_hist_t;
+
+typedef struct {
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+} metrics_hist_snapshot_t;
+
+typedef struct {
+    uint32_t counters[METRIC_COUNTER_COUNT];
+    metrics_hist_snapshot_t hists[METRIC_HIST_COUNT];
+} metrics_snapshot_t;
+
+typedef struct {
+    _Atomic uint32_t counters[METRIC_COUNTER_COUNT];
+    _Atomic uint32_t buckets[METRIC_HIST_COUNT][METRICS_HIST_BUCKETS];
+    _Atomic uint32_t max[METRIC_HIST_COUNT];
+} metrics_core_t;
+
+extern metrics_core_t metrics_cores[portNUM_PROCESSORS];
+
+static inline void metrics_add(metric_counter_t counter, uint32_t n) {
+    atomic_fetch_add_explicit(&metrics_cores[xPortGetCoreID()].counters[counter], n, memory_order_relaxed);
+}
+
+static inline void metrics_record(metric_hist_t hist, uint32_t value) {
+    metrics_core_t *core = &metrics_cores[xPortGetCoreID()];
+    int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+    if (bucket >= METRICS_HIST_BUCKETS) {
+        bucket = METRICS_HIST_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&core->buckets[hist][bucket], 1, memory_order_relaxed);
+    uint32_t max = atomic_load_explicit(&core->max[hist], memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&core->max[hist], &max, value,
+                                                                 memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+#ifdef CONFIG_METRICS_ENABLED
+#define METRIC_INC(counter) metrics_add((counter), 1)
+#define METRIC_ADD(counter, n) metrics_add((counter), (n))
+#define METRIC_RECORD(hist, value) metrics_record((hist), (value))
+#define METRIC_NOW_US() ((uint32_t) esp_timer_get_time())                   // Wraps after 71 minutes, differences stay valid
+#define METRIC_SINCE_US(hist, start_us) metrics_record((hist), METRIC_NOW_US() - (start_us))
+#else
+#define METRIC_INC(counter) ((void) 0)
+#define METRIC_ADD(counter, n) ((void) 0)
+#define METRIC_RECORD(hist, value) ((void) 0)
+#define METRIC_NOW_US() ((uint32_t) 0)
+#define METRIC_SINCE_US(hist, start_us) ((void) (start_us))
+#endif
+
+/**
+ * @brief Returns true if metrics are compiled in.
+ **/
+bool metrics_enabled(void);
+
+/**
+ * @brief Sums the per-core copies of all counters and histograms.
+ * @param snapshot Destination.
+ **/
+void metrics_snapshot(metrics_snapshot_t *snapshot);
+
+/**
+ * @brief Clears all counters and histograms.
+ * @note Updates racing with the reset may be lost.
+ **/
+void metrics_reset(void);
+
+/**
+ * @brief Returns name of a counter, e.g. "frames_data".
+ **/
+const char *metrics_counter_name(metric_counter_t counter);
+
+/**
+ * @brief Returns name of a histogram, e.g. "capture".
+ **/
+const char *metrics_hist_name(metric_hist_t hist);
+
+/**
+ * @brief Returns unit of a histogram's values, "us", "ms" or "frames".
+ **/
+const char *metrics_hist_unit(metric_hist_t hist);
+
+/**
+ * @brief Estimates a percentile from histogram buckets.
+ * @param hist Histogram snapshot.
+ * @param percent Percentile, 1-100.
+ * @return Upper bound of the bucket holding the percentile, capped by the maximum; 0 if empty.
+ **/
+uint32_t metrics_hist_percentile(const metrics_hist_snapshot_t *hist, unsigned percent);
+
+#endif // METRICS_H
@@ -0,0 +1,111 @@
+/**
+ * @file pcap_export.h
+ * @brief Streams sniffer captures as a PCAP file (LINKTYPE_IEEE802_11_RADIOTAP) over UART.
+ *
+ * Every record carries a radiotap header built from `rx_ctrl` (TSFT, flags, rate, channel,
+ * signal, noise, MCS) followed by a vendor namespace holding the capture sequence number,
+ * so a receiver can count lost records. Records of one consumer batch are written with a
+ * single UART write.
+ *
+ * In compact mode the stream starts with a "DRCZ" header carrying the compression dictionary,
+ * followed by the PCAP global header. Every record is prefixed with a type and length: a plain
+ * PCAP record, a PCAP record whose radiotap header and frame are LZ4 compressed (see frame_codec.h),
+ * or a beacon summary replacing unchanged beacons (see beacon_dedup.h). `tools/pcap_receiver.py`
+ * expands it back into a PCAP file.
+ */
+#ifndef PCAP_EXPORT_H
+#define PCAP_EXPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/uart.h"
+
+#ifndef CONFIG_PCAP_EXPORT_UART_NUM                                         // CONFIG_PCAP_EXPORT_UART_NUM
+#define CONFIG_PCAP_EXPORT_UART_NUM 0                                       // Console UART by default
+#endif
+
+#ifndef CONFIG_PCAP_EXPORT_TX_PIN                                           // CONFIG_PCAP_EXPORT_TX_PIN
+#define CONFIG_PCAP_EXPORT_TX_PIN 17                                        // TX pin of a dedicated streaming UART
+#endif
+
+#ifndef CONFIG_ESP_CONSOLE_UART_NUM
+#define CONFIG_ESP_CONSOLE_UART_NUM 0
+#endif
+
+#ifndef CONFIG_PCAP_EXPORT_BAUD                                             // CONFIG_PCAP_EXPORT_BAUD
+#define CONFIG_PCAP_EXPORT_BAUD 2000000                                     // Baud rate while streaming
+#endif
+
+#ifndef CONFIG_PCAP_EXPORT_BUFFER_SIZE                                      // CONFIG_PCAP_EXPORT_BUFFER_SIZE
+#define CONFIG_PCAP_EXPORT_BUFFER_SIZE 4096                                 // Staging buffer per UART write
+#endif
+
+#ifndef CONFIG_PCAP_EXPORT_SUMMARY_MS                                       // CONFIG_PCAP_EXPORT_SUMMARY_MS
+#define CONFIG_PCAP_EXPORT_SUMMARY_MS 1000                                  // Compact mode: interval of beacon summaries
+#endif
+
+#ifndef CONFIG_PCAP_EXPORT_BEACON_REFRESH_MS                                // CONFIG_PCAP_EXPORT_BEACON_REFRESH_MS
+#define CONFIG_PCAP_EXPORT_BEACON_REFRESH_MS 10000                          // Compact mode: unchanged beacon resent after this time
+#endif
+
+#define PCAP_EXPORT_VENDOR_OUI {0x44, 0x52, 0x43}                           // Vendor namespace OUI ("DRC")
+#define PCAP_EXPORT_COMPACT_MAGIC 0x5a435244                                // "DRCZ", little endian
+#define PCAP_EXPORT_COMPACT_VERSION 1
+
+/**
+ * @brief Record types of the compact stream.
+ **/
+typedef enum {
+    PCAP_COMPACT_RECORD = 1,                                                // PCAP record as in the plain stream
+    PCAP_COMPACT_RECORD_LZ4 = 2,                                            // PCAP record header, then compressed radiotap header and frame
+    PCAP_COMPACT_BEACON_SUMMARY = 3,                                        // beacon_summary_t
+} wifictl_pcap_compact_type_t;
+
+/**
+ * @brief Export counters.
+ **/
+typedef struct {
+    uint32_t records;                                                       // Records written to UART
+    uint32_t bytes;                                                         // Bytes written to UART
+    uint32_t truncated;                                                     // Frames not fitting the staging buffer
+    uint32_t pcap_bytes;                                                    // Bytes a plain PCAP stream of all frames would take
+    uint32_t compressed;                                                    // Compact mode: records sent compressed
+    uint32_t beacons_suppressed;                                            // Compact mode: beacons only counted in summaries
+    uint32_t summaries;                                                     // Compact mode: summary records written
+} wifictl_pcap_stats_t;
+
+/**
+ * @brief Switches UART to the streaming baud rate, writes the PCAP global header and starts exporting sniffer batches.
+ * @note On the console UART, stdout is routed to /dev/null and logging is turned off until wifictl_pcap_export_stop;
+ *       writes that bypass stdout must check wifictl_pcap_export_owns_port. Any other port gets its driver
+ *       installed on CONFIG_PCAP_EXPORT_TX_PIN if needed.
+ * @param port UART port to stream to.
+ * @param baud_rate Baud rate used while streaming.
+ * @param compact Deduplicate beacons and compress records, see above.
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if already streaming, ESP_ERR_NO_MEM if no sniffer handler slot is free.
+ **/
+esp_err_t wifictl_pcap_export_start(uart_port_t port, uint32_t baud_rate, bool compact);
+
+/**
+ * @brief Stops exporting and restores previous baud rate, stdout and log level.
+ * @note Waits for a batch the sniffer's aggregate stage is exporting, so it must not be called from a batch handler.
+ **/
+void wifictl_pcap_export_stop(void);
+
+/**
+ * @brief Returns true while streaming to `port`, so nothing else may write to it.
+ **/
+bool wifictl_pcap_export_owns_port(uart_port_t port);
+
+/**
+ * @brief Returns true while streaming.
+ **/
+bool wifictl_pcap_export_active(void);
+
+/**
+ * @brief Copies export counters as of the last exported batch.
+ **/
+void wifictl_pcap_export_get_stats(wifictl_pcap_stats_t *stats);
+
+#endif // PCAP_EXPORT_H
@@ -0,0 +1,75 @@
+/**
+ * @file pcap_reader.h
+ * @brief Reads 802.11 frames and their radio metadata from a classic PCAP file.
+ *
+ * Accepts link types 105 (raw 802.11) and 127 (radiotap) in either byte order, with microsecond or
+ * nanosecond timestamps, as written by `pcap` export or Wireshark. From radiotap headers the
+ * standard fields up to MCS of the first presence word are decoded: flags (FCS, short preamble),
+ * rate, channel, antenna signal and noise, MCS. Records too large for the buffer or without a
+ * usable radiotap header are skipped and counted.
+ * Pure logic on stdio without ESP-IDF dependencies, so the same file can be checked on a host.
+ */
+#ifndef PCAP_READER_H
+#define PCAP_READER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PCAP_READER_MAX_RECORD 2560                                         // Radiotap header and largest 802.11 frame
+
+typedef enum {
+    PCAP_READER_FRAME,                                                      // Frame returned
+    PCAP_READER_END,                                                        // End of file
+    PCAP_READER_ERROR,                                                      // Read error or truncated record
+} pcap_reader_result_t;
+
+typedef struct {
+    uint64_t timestamp_us;                                                  // Record time
+    const uint8_t *data;                                                    // 802.11 frame, valid until the next call
+    uint16_t len;                                                           // Frame length, FCS included if has_fcs
+    bool has_fcs;
+    uint8_t channel;                                                        // 0 if not recorded
+    int8_t rssi;                                                            // dBm, 0 if not recorded
+    int8_t noise;                                                           // dBm, 0 if not recorded
+    uint8_t rate;                                                           // Legacy rate in 500 kbps units, 0 if not recorded or HT
+    bool short_preamble;
+    bool ht;
+    uint8_t mcs;
+    bool sgi;
+    bool cwb;                                                               // 40 MHz
+} pcap_reader_frame_t;
+
+typedef struct {
+    FILE *file;
+    bool swapped;                                                           // File byte order differs from ours
+    bool nanoseconds;
+    uint32_t linktype;
+    uint32_t records;                                                       // Records read, skipped ones included
+    uint32_t skipped;
+    uint8_t buffer[PCAP_READER_MAX_RECORD];
+} pcap_reader_t;
+
+/**
+ * @brief Reads and checks the global header.
+ * @param reader Reader.
+ * @param file File opened for binary reading, positioned at the start. Not closed by the reader.
+ * @return false if the file is not a PCAP file or has an unsupported link type.
+ **/
+bool pcap_reader_open(pcap_reader_t *reader, FILE *file);
+
+/**
+ * @brief Reads the next frame, skipping records that cannot be used.
+ * @param reader Reader.
+ * @param frame Receives the frame.
+ * @return PCAP_READER_FRAME, PCAP_READER_END or PCAP_READER_ERROR.
+ **/
+pcap_reader_result_t pcap_reader_next(pcap_reader_t *reader, pcap_reader_frame_t *frame);
+
+/**
+ * @brief Positions the reader at the first record again.
+ * @return false on seek errors.
+ **/
+bool pcap_reader_rewind(pcap_reader_t *reader);
+
+#endif // PCAP_READER_H
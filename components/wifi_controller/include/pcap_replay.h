@@ -0,0 +1,70 @@
+/**
+ * @file pcap_replay.h
+ * @brief Radio operations that feed the sniffer from a recorded PCAP file instead of the air.
+ *
+ * While installed, enabling promiscuous mode starts a replay task that reads the file with
+ * pcap_reader and calls the sniffer's frame callback with a `wifi_promiscuous_pkt_t` rebuilt from
+ * each record, so capture filter, ring, pipeline stages and all batch handlers run exactly as on
+ * live traffic. `rx_ctrl.timestamp` is the record time relative to the first record, so results do
+ * not depend on pacing. Scan operations go to the radio operations that were installed before.
+ *
+ * Pacing follows the record timestamps scaled by a speed factor, with up to one tick of jitter,
+ * or delivers as fast as possible. The replay task runs below the pipeline tasks, so at full speed
+ * it only gets the CPU time the consumers leave and the achieved rate is the sustainable rate.
+ * The file can be on any VFS path: the SD card, or the host through semihosting.
+ * Frames are delivered whatever channel the radio is set to; frames without a recorded channel get
+ * the current one.
+ */
+#ifndef PCAP_REPLAY_H
+#define PCAP_REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifndef CONFIG_PCAP_REPLAY_TASK_PRIORITY                                    // CONFIG_PCAP_REPLAY_TASK_PRIORITY
+#define CONFIG_PCAP_REPLAY_TASK_PRIORITY 4                                  // Below the sniffer pipeline
+#endif
+
+#ifndef CONFIG_PCAP_REPLAY_CORE                                             // CONFIG_PCAP_REPLAY_CORE
+#define CONFIG_PCAP_REPLAY_CORE 0                                           // Core of the Wi-Fi task the replay stands in for
+#endif
+
+#define PCAP_REPLAY_MAX_SPEED 0                                             // speed_percent for as fast as possible
+
+typedef struct {
+    bool installed;
+    bool running;                                                           // Replay task delivering frames
+    bool finished;                                                          // All loops done
+    uint32_t speed_percent;
+    uint32_t frames;                                                        // Frames handed to the sniffer callback
+    uint32_t masked;                                                        // Type disabled by the promiscuous filter, or extension frame
+    uint32_t skipped;                                                       // Records the reader could not use
+    uint32_t loops;                                                         // Completed passes over the file
+    uint32_t elapsed_ms;                                                    // Delivery time of the current or last run
+    uint32_t late_max_us;                                                   // Largest delay behind the paced schedule
+    uint32_t errors;                                                        // File open or read errors
+} wifictl_replay_stats_t;
+
+/**
+ * @brief Installs replay radio operations for a PCAP file. Frames flow once the sniffer is started.
+ * @param path File path, checked to be a PCAP file with a supported link type.
+ * @param speed_percent 100 for recorded timing, 200 for twice as fast, PCAP_REPLAY_MAX_SPEED for no pacing.
+ * @param loops Passes over the file, 0 to repeat until stopped.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already installed or while sniffing, ESP_ERR_NOT_FOUND if the
+ *         file cannot be opened, ESP_ERR_INVALID_ARG if it is not a supported PCAP file.
+ **/
+esp_err_t wifictl_replay_install(const char *path, uint32_t speed_percent, uint32_t loops);
+
+/**
+ * @brief Stops a running replay and restores the previous radio operations.
+ * @note Stop the sniffer first; sniffing restarted afterwards uses the radio again.
+ **/
+void wifictl_replay_uninstall(void);
+
+/**
+ * @brief Copies replay state and counters.
+ **/
+void wifictl_replay_get_stats(wifictl_replay_stats_t *stats);
+
+#endif // PCAP_REPLAY_H
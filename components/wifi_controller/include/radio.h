@@ -0,0 +1,54 @@
+/**
+ * @file radio.h
+ * @brief Radio operations used by the scanner, sniffer and channel hopper.
+ *
+ * The components above never call the esp_wifi scan/channel/promiscuous API directly but go
+ * through this table, so the driver can be replaced by a mock that produces synthetic scan
+ * results and frames at a controlled rate. The default table forwards to esp_wifi. None of
+ * these calls are on the per-frame path: captured frames reach the sniffer through the
+ * callback passed to `set_promiscuous`.
+ */
+#ifndef RADIO_H
+#define RADIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"                                                       // wifi_promiscuous_cb_t
+
+typedef struct {
+    esp_err_t (*scan_start)(const wifi_scan_config_t *config);              // Non-blocking, completion as WIFI_EVENT_SCAN_DONE
+    esp_err_t (*scan_stop)(void);
+    esp_err_t (*scan_get_ap_records)(uint16_t *number, wifi_ap_record_t *records);
+    esp_err_t (*clear_ap_list)(void);
+    esp_err_t (*set_channel)(uint8_t channel);
+    esp_err_t (*set_promiscuous)(bool enable, wifi_promiscuous_cb_t callback);  // Callback is ignored when disabling
+    esp_err_t (*set_promiscuous_filter)(const wifi_promiscuous_filter_t *filter);
+} wifictl_radio_ops_t;
+
+/**
+ * @brief Returns radio operations in use.
+ **/
+const wifictl_radio_ops_t *wifictl_radio(void);
+
+/**
+ * @brief Replaces radio operations, e.g. with a mock.
+ * @param ops Operations, must stay valid while installed; NULL restores the esp_wifi driver.
+ * @note Install before scanning or sniffing starts.
+ **/
+void wifictl_radio_set_ops(const wifictl_radio_ops_t *ops);
+
+/**
+ * @brief Switches channel through the installed operations and remembers channel and time of the switch.
+ * @param channel Channel 1-14.
+ * @return Result of set_channel.
+ **/
+esp_err_t wifictl_radio_set_channel(uint8_t channel);
+
+/**
+ * @brief Returns the channel last set with wifictl_radio_set_channel, 0 if none yet.
+ * @param since_us Receives esp_timer time of that switch, may be NULL.
+ **/
+uint8_t wifictl_radio_channel(int64_t *since_us);
+
+#endif // RADIO_H
@@ -0,0 +1,97 @@
+/**
+ * @file scan_delta.h
+ * @brief Turns successive scan result sets into change events: new, vanished and changed APs.
+ *
+ * Every tracked AP remembers the state it was last reported with. A scan round reports an AP as new
+ * the first time it is seen, as changed when its channel or auth mode differs from the reported state
+ * or its RSSI moved by at least the hysteresis threshold, and as gone after it was missing from
+ * the given number of consecutive rounds that covered its channel. RSSI is compared with the last
+ * reported value rather than the previous round, so jitter below the threshold never reports while a
+ * slow drift eventually does. A round without changes produces no events.
+ * Pure logic without ESP-IDF dependencies.
+ */
+#ifndef SCAN_DELTA_H
+#define SCAN_DELTA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_SCAN_DELTA_CAPACITY                                          // CONFIG_SCAN_DELTA_CAPACITY
+#define CONFIG_SCAN_DELTA_CAPACITY 64                                       // Tracked APs
+#endif
+
+typedef enum {
+    SCAN_DELTA_NEW = 1,
+    SCAN_DELTA_GONE = 2,
+    SCAN_DELTA_CHANGED = 3,
+} scan_delta_kind_t;
+
+#define SCAN_DELTA_RSSI    0x01                                             // Changed fields of SCAN_DELTA_CHANGED
+#define SCAN_DELTA_CHANNEL 0x02
+#define SCAN_DELTA_AUTH    0x04
+
+/**
+ * @brief AP as seen in one scan round.
+ **/
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;                                                       // wifi_auth_mode_t
+    int8_t rssi;
+} scan_delta_ap_t;
+
+/**
+ * @brief One change. All members are bytes, so the layout is the same on every target.
+ **/
+typedef struct {
+    uint8_t kind;                                                           // scan_delta_kind_t
+    uint8_t changed;                                                        // SCAN_DELTA_RSSI | _CHANNEL | _AUTH
+    scan_delta_ap_t ap;                                                     // New state, last reported state for SCAN_DELTA_GONE
+    uint8_t previous_channel;                                               // Previously reported state, SCAN_DELTA_CHANGED only
+    uint8_t previous_authmode;
+    int8_t previous_rssi;
+} scan_delta_event_t;
+
+typedef struct {
+    scan_delta_ap_t reported;                                               // State of the latest event
+    uint8_t misses;                                                         // Consecutive rounds without it
+    bool used;
+} scan_delta_entry_t;
+
+typedef struct {
+    scan_delta_entry_t entries[CONFIG_SCAN_DELTA_CAPACITY];
+    uint8_t rssi_hysteresis_db;
+    uint8_t miss_limit;
+    uint32_t rounds;
+    uint32_t untracked;                                                     // New APs not reported because the table was full
+} scan_delta_t;
+
+/**
+ * @brief Forgets every AP.
+ * @param delta Tracker.
+ * @param rssi_hysteresis_db Smallest RSSI change reported, at least 1.
+ * @param miss_limit Consecutive rounds an AP must be missing to be reported gone, at least 1.
+ **/
+void scan_delta_init(scan_delta_t *delta, uint8_t rssi_hysteresis_db, uint8_t miss_limit);
+
+/**
+ * @brief Compares one complete scan round with the reported state and updates it.
+ * @param delta Tracker.
+ * @param aps APs seen in the round, each BSSID once.
+ * @param count Number of APs.
+ * @param channels Channels the round covered, NULL for all. APs on other channels are not counted as missing.
+ * @param channel_count Number of channels.
+ * @param events Receives the changes, gone APs last.
+ * @param max Capacity of events. Changes that do not fit are left unreported and come again next round.
+ * @return Number of events written.
+ **/
+size_t scan_delta_update(scan_delta_t *delta, const scan_delta_ap_t *aps, size_t count, const uint8_t *channels,
+                         size_t channel_count, scan_delta_event_t *events, size_t max);
+
+/**
+ * @brief Returns the number of tracked APs.
+ **/
+size_t scan_delta_count(const scan_delta_t *delta);
+
+#endif // SCAN_DELTA_H
@@ -0,0 +1,73 @@
+/**
+ * @file scan_monitor.h
+ * @brief Periodic background scans that report only what changed since the previous round.
+ *
+ * An esp_timer starts an asynchronous scan of the configured channels every interval. The results of
+ * each complete round go through a scan_delta tracker (see scan_delta.h), and the callback is called
+ * with the new, vanished and changed APs only; a round without changes calls nothing. Rounds are
+ * skipped while sniffing, so a capture is never interrupted, and while another scan runs. Cancelled
+ * or failed rounds are discarded, so they do not report APs as vanished.
+ */
+#ifndef SCAN_MONITOR_H
+#define SCAN_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "scan_delta.h"
+
+#ifndef CONFIG_SCAN_MONITOR_INTERVAL_S                                      // CONFIG_SCAN_MONITOR_INTERVAL_S
+#define CONFIG_SCAN_MONITOR_INTERVAL_S 30                                   // Default time between rounds
+#endif
+
+#ifndef CONFIG_SCAN_MONITOR_RSSI_HYSTERESIS_DB                              // CONFIG_SCAN_MONITOR_RSSI_HYSTERESIS_DB
+#define CONFIG_SCAN_MONITOR_RSSI_HYSTERESIS_DB 6                            // Smallest RSSI change reported
+#endif
+
+#ifndef CONFIG_SCAN_MONITOR_MISSES                                          // CONFIG_SCAN_MONITOR_MISSES
+#define CONFIG_SCAN_MONITOR_MISSES 2                                        // Rounds missing before an AP is reported gone
+#endif
+
+/**
+ * @brief Receives the changes of one round.
+ * @param events Changes, gone APs last.
+ * @param count Number of changes, at least 1.
+ * @note Called from the event loop task, must not block.
+ **/
+typedef void (*wifictl_scan_delta_callback_t)(const scan_delta_event_t *events, size_t count);
+
+typedef struct {
+    uint32_t rounds;                                                        // Complete rounds compared
+    uint32_t skipped;                                                       // Rounds not started: sniffing or scan running
+    uint32_t discarded;                                                     // Rounds cancelled or failed part way
+    uint32_t events;                                                        // Changes reported
+    uint32_t tracked;                                                       // APs in the reported state
+    uint32_t untracked;                                                     // New APs not reported, tracker full
+} wifictl_scan_monitor_stats_t;
+
+/**
+ * @brief Forgets the reported state and starts scanning in the background. The first round reports every AP as new.
+ * @param interval_s Time between round starts.
+ * @param channels Channels to scan, NULL for channels 1-13.
+ * @param count Number of channels.
+ * @param callback Receives the changes.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad channel list or interval, ESP_ERR_INVALID_STATE if already
+ *         running, ESP_ERR_NO_MEM if no scan callback slot is free, or the error of the timer.
+ **/
+esp_err_t wifictl_scan_monitor_start(uint32_t interval_s, const uint8_t *channels, size_t count,
+                                     wifictl_scan_delta_callback_t callback);
+
+/**
+ * @brief Stops background scanning. A round in progress finishes without reporting.
+ **/
+void wifictl_scan_monitor_stop(void);
+
+/**
+ * @brief Returns true while scanning in the background.
+ **/
+bool wifictl_scan_monitor_active(void);
+
+void wifictl_scan_monitor_get_stats(wifictl_scan_monitor_stats_t *stats);
+
+#endif // SCAN_MONITOR_H
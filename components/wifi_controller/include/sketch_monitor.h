@@ -0,0 +1,107 @@
+/**
+ * @file sketch_monitor.h
+ * @brief Feeds captured management and data frames into traffic sketches and answers census and talker queries.
+ *
+ * A fan-out consumer (see sniffer_fanout.cpp) adds every frame's transmitter to the distinct count of
+ * its channel and to the talkers by frames and bytes, and the client side of the exchange to the
+ * client count of its BSSID (see traffic_sketch.h). Frames go into the current window; every
+ * CONFIG_SKETCH_WINDOW_S a cleared spare takes its place, and the retired window is merged into the
+ * summary of all earlier windows and cleared outside the capture spinlock, so queries report the
+ * latest window and the whole run with fixed memory however long it lasts.
+ * Counts survive channel hops: every channel and BSSID keeps its sketch while the radio is elsewhere.
+ * A BSSID keeps the client sketch slot it first claimed for the whole run.
+ */
+#ifndef SKETCH_MONITOR_H
+#define SKETCH_MONITOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sniffer.h"
+#include "traffic_sketch.h"
+
+#ifndef CONFIG_SKETCH_WINDOW_S                                              // CONFIG_SKETCH_WINDOW_S
+#define CONFIG_SKETCH_WINDOW_S 60                                           // Length of the current window
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Distinct MACs of a channel or clients of a BSSID.
+ **/
+typedef struct {
+    uint8_t bssid[6];                                                       // Zero for channel rows
+    uint8_t channel;                                                        // 0 for the row of all channels
+    uint32_t window;                                                        // Estimate for the current window
+    uint32_t total;                                                         // Estimate since start
+} wifictl_sketch_census_t;
+
+typedef struct {
+    uint32_t frames;                                                        // Since start
+    uint32_t bytes;
+    uint32_t windows;                                                       // Windows closed so far
+    uint32_t window_age_s;                                                  // Age of the current window
+    uint32_t bssid_overflow;                                                // Frames of BSSIDs without a client sketch
+} wifictl_sketch_stats_t;
+
+/**
+ * @brief Clears the sketches and starts adding captured frames.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE if already running.
+ **/
+esp_err_t wifictl_sketch_start(void);
+
+/**
+ * @brief Stops adding frames. Collected sketches stay queryable.
+ **/
+void wifictl_sketch_stop(void);
+
+/**
+ * @brief Returns true while adding frames.
+ **/
+bool wifictl_sketch_active(void);
+
+/**
+ * @brief Adds one captured frame. Called by the fan-out consumer; returns at once while stopped.
+ **/
+void wifictl_sketch_add_frame(const wifictl_frame_t *frame);
+
+/**
+ * @brief Estimates distinct transmitters per channel heard so far, ascending, after a row for all channels.
+ * @return Number of rows written.
+ **/
+size_t wifictl_sketch_channels(wifictl_sketch_census_t *out, size_t max);
+
+/**
+ * @brief Estimates distinct clients of every tracked BSSID.
+ * @return Number of rows written.
+ **/
+size_t wifictl_sketch_bssids(wifictl_sketch_census_t *out, size_t max);
+
+/**
+ * @brief Returns the heaviest talkers by descending count.
+ * @param metric SKETCH_FRAMES or SKETCH_BYTES.
+ * @param window_only Only the current window instead of the whole run.
+ * @param out Destination.
+ * @param max Capacity of out.
+ * @return Number of talkers written.
+ **/
+size_t wifictl_sketch_talkers(sketch_metric_t metric, bool window_only, sketch_talker_t *out, size_t max);
+
+/**
+ * @brief Returns upper bounds of frames and bytes sent by any MAC, from the Count-Min sketches.
+ * @param mac Transmitter.
+ * @param window Receives counts of the current window, indexed by sketch_metric_t.
+ * @param total Receives counts since start.
+ **/
+void wifictl_sketch_lookup(const uint8_t mac[6], uint32_t window[SKETCH_METRICS], uint32_t total[SKETCH_METRICS]);
+
+void wifictl_sketch_get_stats(wifictl_sketch_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SKETCH_MONITOR_H
@@ -10,7 +10,50 @@
 #define SNIFFER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_event.h"
+#include "esp_wifi_types.h"
+
+#include "capture_filter.h"
+
+#ifndef CONFIG_SNIFFER_RING_SIZE                                            // CONFIG_SNIFFER_RING_SIZE
+#define CONFIG_SNIFFER_RING_SIZE 64                                         // Capture ring slots, power of two
+#endif
+
+#ifndef CONFIG_SNIFFER_BATCH_SIZE                                           // CONFIG_SNIFFER_BATCH_SIZE
+#define CONFIG_SNIFFER_BATCH_SIZE 16                                        // Frames drained per consumer wake-up
+#endif
+
+#ifndef CONFIG_SNIFFER_MAX_BATCH_HANDLERS                                   // CONFIG_SNIFFER_MAX_BATCH_HANDLERS
+#define CONFIG_SNIFFER_MAX_BATCH_HANDLERS 4                                 // Consumers of drained batches
+#endif
+
+#ifndef CONFIG_SNIFFER_TASK_PRIORITY                                        // CONFIG_SNIFFER_TASK_PRIORITY
+#define CONFIG_SNIFFER_TASK_PRIORITY 5                                      // Priority of capture pipeline tasks
+#endif
+
+#ifdef CONFIG_FREERTOS_UNICORE
+#define SNIFFER_PIPELINED 0                                                 // Both stages run in one task
+#else
+#define SNIFFER_PIPELINED 1                                                 // Parse and aggregate stages on their own cores
+#endif
+
+#ifndef CONFIG_SNIFFER_PARSE_CORE                                           // CONFIG_SNIFFER_PARSE_CORE
+#define CONFIG_SNIFFER_PARSE_CORE 1                                         // Core of the parse stage
+#endif
+
+#ifndef CONFIG_SNIFFER_AGGREGATE_CORE                                       // CONFIG_SNIFFER_AGGREGATE_CORE
+#define CONFIG_SNIFFER_AGGREGATE_CORE 0                                     // Core of the aggregate/export stage
+#endif
+
+#ifndef CONFIG_SNIFFER_PIPELINE_DEPTH                                       // CONFIG_SNIFFER_PIPELINE_DEPTH
+#define CONFIG_SNIFFER_PIPELINE_DEPTH 4                                     // Batches queued between parse and aggregate stage
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 ESP_EVENT_DECLARE_BASE(SNIFFER_EVENTS);
 
@@ -20,6 +63,50 @@ enum {
     SNIFFER_EVENT_CAPTURED_CTRL
 };
 
+/**
+ * @brief Capture path counters.
+ * @note `dropped` counts frames rejected by the full capture ring or the exhausted frame pool,
+ *       `post_failed` counts frames esp_event_post refused or timed out on, `fanout_dropped` frames
+ *       not published because the slowest fan-out consumer was a full ring behind.
+ **/
+typedef struct {
+    uint32_t captured;                                                      // Frames accepted into the ring
+    uint32_t filtered;                                                      // Frames rejected by the capture filter
+    uint32_t dropped;                                                       // Frames dropped in the callback
+    uint32_t post_failed;                                                   // Frames not posted to SNIFFER_EVENTS
+    uint32_t fanout_dropped;                                                // Frames no fan-out consumer saw
+} wifictl_sniffer_stats_t;
+
+/**
+ * @brief Stages of the capture pipeline. Every batch passes the parse stage, then the aggregate stage,
+ *        which then publishes the frames to the fan-out consumers (see sniffer_fanout.h).
+ **/
+typedef enum {
+    SNIFFER_STAGE_PARSE,                                                    // Header and IE parsing into the AP and station tables
+    SNIFFER_STAGE_AGGREGATE,                                                // Statistics and export
+    SNIFFER_STAGE_COUNT
+} wifictl_sniffer_stage_t;
+
+/**
+ * @brief Captured frame as queued between the promiscuous callback and the pipeline stages.
+ * @note `pkt` keeps the exact layout of `wifi_promiscuous_pkt_t` and must stay the last member
+ *       because of its flexible payload.
+ **/
+typedef struct {
+    uint32_t seq;                                                           // Capture sequence number, dropped frames consume one too
+    uint32_t queued_us;                                                     // Capture time for queue wait metrics, 0 without metrics
+    int32_t event_id;                                                       // SNIFFER_EVENT_CAPTURED_*
+    uint16_t len;                                                           // Size of pkt including payload
+    wifi_promiscuous_pkt_t pkt;
+} wifictl_frame_t;
+
+/**
+ * @brief Handler called from a pipeline stage task with each drained batch, before frames go to the fan-out consumers.
+ * @note Frames are only valid for the duration of the call. Handlers of different stages run concurrently on
+ *       different cores, each on a different batch.
+ **/
+typedef void (*wifictl_sniffer_batch_handler_t)(const wifictl_frame_t *const *frames, size_t count);
+
 /**
  * @brief Sets sniffer filter for specific frame types. 
  * 
@@ -29,12 +116,40 @@ enum {
  */
 void wifictl_sniffer_filter_frame_types(bool data, bool mgmt, bool ctrl);
 
+/**
+ * @brief Sets capture filter evaluated in the promiscuous callback before a frame is copied.
+ *
+ * The new program is built beside the running one and switched in; the callback never waits for a setter.
+ * Returns once no callback still runs the previous program.
+ * 
+ * @param expr filter expression, see capture_filter.h; NULL or empty accepts every frame
+ * @param error set to description of a syntax error, may be NULL
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG if the expression does not compile (current filter is kept)
+ */
+esp_err_t wifictl_sniffer_set_filter(const char *expr, const char **error);
+
+/**
+ * @brief Copies current capture filter including its hit counters
+ * 
+ * @param filter destination
+ */
+void wifictl_sniffer_get_filter(capture_filter_t *filter);
+
+/**
+ * @brief Clears hit counters of current capture filter
+ */
+void wifictl_sniffer_reset_filter_stats(void);
+
 /**
  * @brief Start promiscuous mode on given channel
  * 
  * @param channel channel on which sniffer should operate
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the capture ring cannot be set up, ESP_ERR_NO_MEM if the
+ *         pipeline tasks cannot be created, ESP_ERR_INVALID_STATE if another mode was entered concurrently,
+ *         or the error of Wi-Fi initialization or promiscuous mode
+ * @note Initializes Wi-Fi on first use and cancels a running scan, see wifictl_mode_enter.
  */
-void wifictl_sniffer_start(uint8_t channel);
+esp_err_t wifictl_sniffer_start(uint8_t channel);
 
 /**
  * @brief Stop promisuous mode
@@ -42,4 +157,38 @@ void wifictl_sniffer_start(uint8_t channel);
  */
 void wifictl_sniffer_stop();
 
+/**
+ * @brief Copies current capture path counters
+ * 
+ * @param stats destination
+ */
+void wifictl_sniffer_get_stats(wifictl_sniffer_stats_t *stats);
+
+/**
+ * @brief Registers handler receiving captured batches in a pipeline stage
+ *
+ * @param stage stage the handler runs in
+ * @param handler handler to add
+ * @return true on success, false if all CONFIG_SNIFFER_MAX_BATCH_HANDLERS slots of the stage are taken
+ */
+bool wifictl_sniffer_register_batch_handler(wifictl_sniffer_stage_t stage, wifictl_sniffer_batch_handler_t handler);
+
+/**
+ * @brief Removes previously registered batch handler
+ *
+ * @param handler handler to remove
+ */
+void wifictl_sniffer_unregister_batch_handler(wifictl_sniffer_batch_handler_t handler);
+
+/**
+ * @brief Posts a frame to SNIFFER_EVENTS and counts failures. Called by the event loop consumer of the fan-out.
+ *
+ * @param frame frame to post, copied by the event loop
+ */
+void wifictl_sniffer_post_event(const wifictl_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
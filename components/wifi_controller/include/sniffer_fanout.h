@@ -0,0 +1,78 @@
+/**
+ * @file sniffer_fanout.h
+ * @brief C interface to the fan-out that hands captured frames to consumers after the aggregate stage.
+ *
+ * The aggregate stage publishes every frame once; each consumer listed in sniffer_fanout.cpp reads
+ * it in place from its own task and cursor (see frame_fanout.hpp), and the frame goes back to the
+ * frame pool when the last consumer is done. A slow consumer therefore never delays the pipeline
+ * stages or the other consumers until it is CONFIG_SNIFFER_FANOUT_DEPTH frames behind.
+ * The event loop bridge that posts SNIFFER_EVENTS and the traffic sketches (sketch_monitor.h) are
+ * consumers. New consumers are added to the consumer list at compile time.
+ */
+#ifndef SNIFFER_FANOUT_H
+#define SNIFFER_FANOUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sniffer.h"
+
+#ifndef CONFIG_SNIFFER_FANOUT_DEPTH                                         // CONFIG_SNIFFER_FANOUT_DEPTH
+#define CONFIG_SNIFFER_FANOUT_DEPTH 32                                      // Frames a consumer may lag behind, power of two
+#endif
+
+#ifndef CONFIG_SNIFFER_FANOUT_TASK_PRIORITY                                 // CONFIG_SNIFFER_FANOUT_TASK_PRIORITY
+#define CONFIG_SNIFFER_FANOUT_TASK_PRIORITY 4                               // Consumer tasks, below the pipeline stages
+#endif
+
+#define SNIFFER_FANOUT_BENCH_MAX_CONSUMERS 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;
+    uint32_t delivered;                                                     // Frames the consumer has seen
+    uint32_t backlog;                                                       // Frames published but not seen yet
+} wifictl_fanout_consumer_stats_t;
+
+/**
+ * @brief Creates the consumer tasks. No-op if already started.
+ * @return false if a task cannot be created, the tasks created before it are deleted again.
+ **/
+bool wifictl_fanout_start(void);
+
+/**
+ * @brief Publishes a frame to every consumer. Called by the aggregate stage only.
+ * @param frame Frame from the frame pool; released to the pool by the last consumer.
+ * @return false if the slowest consumer is CONFIG_SNIFFER_FANOUT_DEPTH frames behind; the frame stays with the caller.
+ **/
+bool wifictl_fanout_publish(wifictl_frame_t *frame);
+
+/**
+ * @brief Wakes the consumer tasks, once per published batch.
+ **/
+void wifictl_fanout_notify(void);
+
+/**
+ * @brief Copies counters of every consumer.
+ * @param stats Destination.
+ * @param max Capacity of stats.
+ * @return Number of consumers, may exceed max.
+ **/
+size_t wifictl_fanout_get_stats(wifictl_fanout_consumer_stats_t *stats, size_t max);
+
+/**
+ * @brief Measures fan-out cost per frame with 1 to SNIFFER_FANOUT_BENCH_MAX_CONSUMERS consumers that only touch the frame.
+ * @param frames Frames published per consumer count.
+ * @param ns_per_frame Receives average publish, delivery and release time per frame, indexed by consumer count - 1.
+ * @note Runs in the calling task on a private fan-out; does not disturb capture.
+ **/
+void wifictl_fanout_benchmark(uint32_t frames, uint32_t ns_per_frame[SNIFFER_FANOUT_BENCH_MAX_CONSUMERS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SNIFFER_FANOUT_H
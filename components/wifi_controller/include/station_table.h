@@ -0,0 +1,79 @@
+/**
+ * @file station_table.h
+ * @brief Passive inventory of client stations and the BSSID they talk to, built from captured data frames.
+ *
+ * Fixed-capacity open-addressing index keyed by client MAC with LRU eviction, so memory stays
+ * bounded in crowded environments.
+ */
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_STATION_TABLE_CAPACITY                                       // CONFIG_STATION_TABLE_CAPACITY
+#define CONFIG_STATION_TABLE_CAPACITY 256                                   // Number of stations kept, power of two
+#endif
+
+/**
+ * @brief Per-station state.
+ **/
+typedef struct {
+    uint8_t mac[6];                                                         // Client MAC
+    uint8_t bssid[6];                                                       // BSSID of latest frame
+    uint32_t frames;                                                        // Data frames from or to the client
+    uint32_t bytes;                                                         // Frame bytes from or to the client
+    uint32_t last_seen_ms;
+    int8_t rssi;                                                            // RSSI of latest uplink frame, 0 if none yet
+    uint8_t channel;
+} wifictl_station_t;
+
+typedef struct {
+    uint32_t updates;                                                       // Frames applied to the table
+    uint32_t ignored;                                                       // Data frames without a client (WDS, group, short)
+    uint32_t evictions;                                                     // Stations evicted to make room
+} wifictl_station_table_stats_t;
+
+/**
+ * @brief Applies one captured data frame.
+ * @param frame 802.11 frame starting with the MAC header.
+ * @param len Frame length.
+ * @param rssi RSSI of the frame.
+ * @param channel Channel the frame was captured on.
+ * @param now_ms Capture time.
+ * @return true if the frame was attributed to a client station.
+ **/
+bool wifictl_station_table_update(const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel, uint32_t now_ms);
+
+/**
+ * @brief Copies stations, most recently seen first.
+ * @param out Destination.
+ * @param max Capacity of `out`.
+ * @param bssid Only stations of this BSSID, NULL for all.
+ * @return Number of stations copied.
+ **/
+size_t wifictl_station_table_snapshot(wifictl_station_t *out, size_t max, const uint8_t *bssid);
+
+/**
+ * @brief Returns number of tracked stations.
+ **/
+size_t wifictl_station_table_count(void);
+
+/**
+ * @brief Copies table counters.
+ **/
+void wifictl_station_table_get_stats(wifictl_station_table_stats_t *stats);
+
+/**
+ * @brief Removes all stations and clears counters.
+ **/
+void wifictl_station_table_clear(void);
+
+/**
+ * @brief Enables or disables feeding the table from sniffer data frames.
+ * @return false if no sniffer batch handler slot is free.
+ **/
+bool wifictl_station_table_track(bool enable);
+
+#endif // STATION_TABLE_H
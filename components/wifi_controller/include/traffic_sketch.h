@@ -0,0 +1,169 @@
+/**
+ * @file traffic_sketch.h
+ * @brief Bounded-memory traffic summaries: distinct MAC counts and heaviest talkers.
+ *
+ * HyperLogLog estimates the number of distinct MACs per channel and the clients of each BSSID with
+ * 2^CONFIG_SKETCH_HLL_PRECISION one-byte registers (relative standard error 1.04 / sqrt(registers)).
+ * Space-Saving keeps the CONFIG_SKETCH_TOPK heaviest transmitters by frames and by bytes; every
+ * reported count is an upper bound that exceeds the true count by at most its error field. A
+ * Count-Min sketch answers frame and byte counts of any MAC, overestimating by at most
+ * e / CONFIG_SKETCH_CMS_WIDTH of all traffic with probability 1 - e^-CONFIG_SKETCH_CMS_DEPTH.
+ * Every structure merges with another of the same configuration, so windows and channels can be
+ * summarized separately and combined later.
+ * Pure logic without ESP-IDF dependencies.
+ */
+#ifndef TRAFFIC_SKETCH_H
+#define TRAFFIC_SKETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef CONFIG_SKETCH_HLL_PRECISION                                         // CONFIG_SKETCH_HLL_PRECISION
+#define CONFIG_SKETCH_HLL_PRECISION 8                                       // 256 registers, 6.5 % standard error
+#endif
+
+#ifndef CONFIG_SKETCH_TOPK                                                  // CONFIG_SKETCH_TOPK
+#define CONFIG_SKETCH_TOPK 32                                               // Talkers kept by Space-Saving
+#endif
+
+#ifndef CONFIG_SKETCH_CMS_WIDTH                                             // CONFIG_SKETCH_CMS_WIDTH
+#define CONFIG_SKETCH_CMS_WIDTH 128                                         // Counters per Count-Min row, power of two
+#endif
+
+#ifndef CONFIG_SKETCH_CMS_DEPTH                                             // CONFIG_SKETCH_CMS_DEPTH
+#define CONFIG_SKETCH_CMS_DEPTH 4                                           // Count-Min rows
+#endif
+
+#ifndef CONFIG_SKETCH_BSSIDS                                                // CONFIG_SKETCH_BSSIDS
+#define CONFIG_SKETCH_BSSIDS 16                                             // BSSIDs with a client count
+#endif
+
+#define SKETCH_HLL_REGISTERS (1 << CONFIG_SKETCH_HLL_PRECISION)
+#define SKETCH_CHANNELS 14
+
+typedef enum {
+    SKETCH_FRAMES,
+    SKETCH_BYTES,
+    SKETCH_METRICS
+} sketch_metric_t;
+
+typedef struct {
+    uint8_t registers[SKETCH_HLL_REGISTERS];                                // Highest rank seen per bucket
+} sketch_hll_t;
+
+typedef struct {
+    uint32_t counters[CONFIG_SKETCH_CMS_DEPTH][CONFIG_SKETCH_CMS_WIDTH];
+} sketch_cms_t;
+
+typedef struct {
+    uint8_t mac[6];
+    uint32_t count;                                                         // Upper bound of the true count
+    uint32_t error;                                                         // count - error is a lower bound
+} sketch_talker_t;
+
+typedef struct {
+    uint32_t size;
+    sketch_talker_t entries[CONFIG_SKETCH_TOPK];
+} sketch_topk_t;
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;                                                        // Channel of the latest frame
+    bool used;
+    uint32_t frames;
+    sketch_hll_t clients;
+} sketch_bssid_t;
+
+/**
+ * @brief Summaries of one time window; a window merged into another covers both.
+ **/
+typedef struct {
+    sketch_hll_t channels[SKETCH_CHANNELS];                                 // Distinct transmitters per channel
+    sketch_bssid_t bssids[CONFIG_SKETCH_BSSIDS];                            // First come, first served
+    sketch_topk_t talkers[SKETCH_METRICS];
+    sketch_cms_t counts[SKETCH_METRICS];
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t bssid_overflow;                                                // Frames of BSSIDs without a slot
+} sketch_window_t;
+
+/**
+ * @brief Hashes a MAC address to 64 well-mixed bits (splitmix64 finalizer).
+ **/
+uint64_t sketch_hash_mac(const uint8_t mac[6]);
+
+void sketch_hll_add(sketch_hll_t *hll, uint64_t hash);
+
+/**
+ * @brief Adds every element of src to dst (register-wise maximum).
+ **/
+void sketch_hll_merge(sketch_hll_t *dst, const sketch_hll_t *src);
+
+/**
+ * @brief Estimates distinct elements, with linear counting for small cardinalities.
+ **/
+uint32_t sketch_hll_estimate(const sketch_hll_t *hll);
+
+void sketch_cms_add(sketch_cms_t *cms, uint64_t hash, uint32_t weight);
+
+/**
+ * @brief Adds the counters of src to dst.
+ **/
+void sketch_cms_merge(sketch_cms_t *dst, const sketch_cms_t *src);
+
+/**
+ * @brief Returns an upper bound of the weight added for hash.
+ **/
+uint32_t sketch_cms_estimate(const sketch_cms_t *cms, uint64_t hash);
+
+/**
+ * @brief Adds weight to a MAC. When the summary is full, the smallest entry is replaced and its count
+ *        becomes the error of the new one (Space-Saving).
+ **/
+void sketch_topk_add(sketch_topk_t *topk, const uint8_t mac[6], uint32_t weight);
+
+/**
+ * @brief Merges src into dst. A MAC missing from a full summary is assumed to have that summary's
+ *        smallest count, which keeps counts upper bounds and errors correct; the largest entries are kept.
+ **/
+void sketch_topk_merge(sketch_topk_t *dst, const sketch_topk_t *src);
+
+/**
+ * @brief Copies entries by descending count.
+ * @return Number of entries written.
+ **/
+size_t sketch_topk_sorted(const sketch_topk_t *topk, sketch_talker_t *out, size_t max);
+
+void sketch_window_init(sketch_window_t *window);
+
+/**
+ * @brief Adds one frame.
+ * @param window Window.
+ * @param channel Channel 1-14, 0 if unknown.
+ * @param transmitter Transmitter address, counted per channel and as talker.
+ * @param bssid BSSID, NULL if the frame has none.
+ * @param client Client of bssid in this frame, NULL if none (e.g. beacons, group addressed frames from the AP).
+ * @param bytes Frame length.
+ **/
+void sketch_window_add(sketch_window_t *window, uint8_t channel, const uint8_t transmitter[6], const uint8_t *bssid,
+                       const uint8_t *client, uint32_t bytes);
+
+/**
+ * @brief Merges src into dst. Clients of BSSIDs that find no free slot in dst are dropped and their frames
+ *        counted in bssid_overflow.
+ **/
+void sketch_window_merge(sketch_window_t *dst, const sketch_window_t *src);
+
+/**
+ * @brief Claims the BSSID slots of src, in order and without counts, in a cleared window, so BSSIDs tracked
+ *        in earlier windows keep their slot when the window is merged into them.
+ **/
+void sketch_window_carry_bssids(sketch_window_t *dst, const sketch_window_t *src);
+
+/**
+ * @brief Returns the BSSID slot of bssid, NULL if not tracked.
+ **/
+const sketch_bssid_t *sketch_window_find_bssid(const sketch_window_t *window, const uint8_t bssid[6]);
+
+#endif // TRAFFIC_SKETCH_H
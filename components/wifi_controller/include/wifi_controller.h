@@ -2,12 +2,85 @@
 #define WIFI_CONTROLLER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
 
-extern bool wifi_initialized;
+/**
+ * @brief Radio modes. The driver is initialized once, on the first transition out of WIFICTL_MODE_UNINIT,
+ *        and stays up; switching modes only stops what the previous mode was doing.
+ **/
+typedef enum {
+    WIFICTL_MODE_UNINIT,                                                    // Driver not initialized yet
+    WIFICTL_MODE_IDLE,                                                      // STA started, not connected, radio unused
+    WIFICTL_MODE_SCANNING,                                                  // Asynchronous scan running
+    WIFICTL_MODE_SNIFFING,                                                  // Promiscuous capture, optionally hopping
+    WIFICTL_MODE_COUNT
+} wifictl_mode_t;
 
-/*
- * @brief Initialize WiFi station mode
-**/
-bool wifi_controller_sta_init();
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+} wifictl_transition_t;
+
+typedef struct {
+    wifictl_mode_t mode;
+    uint32_t first_scan_ms;                                                 // Uptime when the first scan finished, 0 if none yet
+    wifictl_transition_t transitions[WIFICTL_MODE_COUNT][WIFICTL_MODE_COUNT];  // [from][to], time spent in wifictl_mode_enter or stopping
+} wifictl_lifecycle_stats_t;
+
+/**
+ * @brief Initializes NVS, netif, default event loop and the Wi-Fi driver in STA mode. Idempotent.
+ * @return ESP_OK if Wi-Fi is up (also when it already was), otherwise the error of the failed step.
+ * @note Does not connect to any AP.
+ **/
+esp_err_t wifictl_init(void);
+
+/**
+ * @brief Switches radio mode, initializing the driver first if needed.
+ *
+ * Leaving SCANNING cancels the running scan; leaving SNIFFING stops channel hopping and promiscuous
+ * mode. Entering the current mode does nothing.
+ *
+ * @param mode Target mode.
+ * @return ESP_OK, or the error of driver initialization.
+ * @note The caller starts the new mode's activity (scan request, promiscuous mode) afterwards.
+ *       Scan callbacks for a cancelled scan run after the mode lock is released.
+ **/
+esp_err_t wifictl_mode_enter(wifictl_mode_t mode);
+
+/**
+ * @brief Returns to IDLE if `mode` is the current mode. Called when a scan finishes or sniffing stops.
+ * @param mode Mode being left.
+ * @param started_us esp_timer_get_time() when stopping began, recorded as the transition's duration.
+ * @note Takes the mode lock, so it may be called from within wifictl_mode_enter.
+ **/
+void wifictl_mode_leave(wifictl_mode_t mode, int64_t started_us);
+
+/**
+ * @brief Takes the recursive mode lock. Held around checking the mode and starting or stopping its activity,
+ *        so no switch runs in between. Must be released with wifictl_mode_unlock.
+ **/
+void wifictl_mode_lock(void);
+
+/**
+ * @brief Releases the mode lock taken by wifictl_mode_lock.
+ **/
+void wifictl_mode_unlock(void);
+
+/**
+ * @brief Returns current radio mode.
+ **/
+wifictl_mode_t wifictl_mode_get(void);
+
+/**
+ * @brief Returns name of a mode, e.g. "scanning".
+ **/
+const char *wifictl_mode_name(wifictl_mode_t mode);
+
+/**
+ * @brief Copies current mode and transition timings.
+ **/
+void wifictl_get_lifecycle_stats(wifictl_lifecycle_stats_t *stats);
 
 #endif
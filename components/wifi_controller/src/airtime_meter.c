@@ -0,0 +1,230 @@
+/**
+ * @file airtime_meter.c
+ * @brief Implements airtime estimation and sliding-window accounting.
+ */
+#include "airtime_meter.h"
+
+#include <string.h>
+
+#define DSSS_LONG_PREAMBLE_US 192
+#define DSSS_SHORT_PREAMBLE_US 96
+#define OFDM_PREAMBLE_US 20                                                 // L-STF, L-LTF, L-SIG
+#define OFDM_SYMBOL_US 4
+#define OFDM_SIGNAL_EXTENSION_US 6
+#define OFDM_SERVICE_TAIL_BITS 22                                           // 16 service bits, 6 tail bits
+#define HT_SIG_STF_US 12                                                    // HT-SIG, HT-STF
+#define HT_LTF_US 4                                                         // Per HT-LTF
+#define HT_BCC_MAX_MBPS 300                                                 // Rate one BCC encoder handles
+
+_Static_assert((CONFIG_AIRTIME_BSSIDS & (CONFIG_AIRTIME_BSSIDS - 1)) == 0, "CONFIG_AIRTIME_BSSIDS must be a power of two");
+
+// Data bits per OFDM symbol of one spatial stream for HT MCS 0-7, 20 and 40 MHz
+static const uint16_t ht_dbps[2][8] = {
+    { 26, 52, 78, 104, 156, 208, 234, 260 },
+    { 54, 108, 162, 216, 324, 432, 486, 540 },
+};
+
+// HT-LTFs sent for 1-4 spatial streams
+static const uint8_t ht_ltfs[4] = { 1, 2, 4, 4 };
+
+static inline uint32_t div_ceil(uint32_t a, uint32_t b) {
+    return (a + b - 1) / b;
+}
+
+uint32_t airtime_frame_us(const airtime_phy_t *phy, uint32_t len) {
+    uint32_t bits = len * 8;
+    if (phy->legacy_rate == 0) {
+        if (phy->mcs > 31) {
+            return 0;
+        }
+        uint32_t streams = phy->mcs / 8 + 1;
+        uint32_t dbps = ht_dbps[phy->ht40][phy->mcs % 8] * streams;
+        uint32_t encoders = dbps * 10 > HT_BCC_MAX_MBPS * (phy->short_gi ? 36 : 40) ? 2 : 1;  // 6 tail bits each
+        uint32_t symbols = div_ceil(bits + OFDM_SERVICE_TAIL_BITS + 6 * (encoders - 1), dbps);
+        uint32_t data_us = phy->short_gi ? OFDM_SYMBOL_US * div_ceil(symbols * 36, 40)  // 3.6 us symbols, padded to 4 us
+                                         : OFDM_SYMBOL_US * symbols;
+        return OFDM_PREAMBLE_US + HT_SIG_STF_US + HT_LTF_US * ht_ltfs[streams - 1] + data_us + OFDM_SIGNAL_EXTENSION_US;
+    }
+    switch (phy->legacy_rate) {
+        case 2: case 4: case 11: case 22:                                   // DSSS/CCK, 1-11 Mbps
+            return (phy->short_preamble && phy->legacy_rate != 2 ? DSSS_SHORT_PREAMBLE_US : DSSS_LONG_PREAMBLE_US) +
+                   div_ceil(bits * 2, phy->legacy_rate);
+        case 12: case 18: case 24: case 36: case 48: case 72: case 96: case 108:  // ERP-OFDM, 6-54 Mbps
+            return OFDM_PREAMBLE_US + OFDM_SYMBOL_US * div_ceil(bits + OFDM_SERVICE_TAIL_BITS, phy->legacy_rate * 2) +
+                   OFDM_SIGNAL_EXTENSION_US;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Moves to the bucket of now_ms, clearing every bucket that is entered again.
+ */
+static unsigned advance(airtime_meter_t *meter, uint32_t now_ms) {
+    uint32_t epoch = (now_ms - meter->start_ms) / CONFIG_AIRTIME_BUCKET_MS;
+    if (epoch - meter->epoch > CONFIG_AIRTIME_BUCKETS) {                    // Idle for longer than the window
+        meter->epoch = epoch - CONFIG_AIRTIME_BUCKETS;
+    }
+    while (meter->epoch != epoch) {
+        unsigned slot = ++meter->epoch % CONFIG_AIRTIME_BUCKETS;
+        for (int c = 0; c < AIRTIME_CHANNELS; c++) {
+            memset(&meter->channels[c][slot], 0, sizeof(airtime_bucket_t));
+        }
+        for (int b = 0; b < CONFIG_AIRTIME_BSSIDS; b++) {
+            memset(meter->bssids[b].airtime_us[slot], 0, sizeof(meter->bssids[b].airtime_us[slot]));
+            meter->bssids[b].frames[slot] = 0;
+        }
+    }
+    return epoch % CONFIG_AIRTIME_BUCKETS;
+}
+
+static airtime_bssid_entry_t *find_bssid(airtime_meter_t *meter, const uint8_t *bssid) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < 6; i++) {
+        hash = (hash ^ bssid[i]) * 16777619u;
+    }
+    airtime_bssid_entry_t *stalest = NULL;
+    for (unsigned probe = 0; probe < AIRTIME_PROBES; probe++) {
+        airtime_bssid_entry_t *entry = &meter->bssids[(hash + probe) & (CONFIG_AIRTIME_BSSIDS - 1)];
+        if (!entry->used) {
+            stalest = entry;
+            break;
+        }
+        if (memcmp(entry->bssid, bssid, 6) == 0) {
+            return entry;
+        }
+        if (stalest == NULL || entry->last_epoch < stalest->last_epoch) {
+            stalest = entry;
+        }
+    }
+    if (stalest->used) {
+        meter->evicted++;
+    }
+    memset(stalest, 0, sizeof(*stalest));
+    memcpy(stalest->bssid, bssid, 6);
+    stalest->used = true;
+    return stalest;
+}
+
+void airtime_meter_init(airtime_meter_t *meter, uint32_t now_ms) {
+    memset(meter, 0, sizeof(*meter));
+    meter->start_ms = now_ms;
+}
+
+void airtime_meter_record(airtime_meter_t *meter, uint32_t now_ms, uint8_t channel, airtime_type_t type,
+                          const uint8_t *bssid, uint32_t airtime_us) {
+    if (channel < 1 || channel > AIRTIME_CHANNELS || type >= AIRTIME_TYPES) {
+        return;
+    }
+    unsigned slot = advance(meter, now_ms);
+    airtime_bucket_t *bucket = &meter->channels[channel - 1][slot];
+    bucket->airtime_us[type] += airtime_us;
+    bucket->frames[type]++;
+    if (airtime_us == 0) {
+        meter->unrated++;
+    }
+    if (bssid != NULL) {
+        airtime_bssid_entry_t *entry = find_bssid(meter, bssid);
+        entry->channel = channel;
+        entry->last_epoch = meter->epoch;
+        entry->airtime_us[slot][type] += airtime_us;
+        entry->frames[slot]++;
+    }
+}
+
+void airtime_meter_listen(airtime_meter_t *meter, uint32_t now_ms, uint8_t channel, uint32_t listen_us) {
+    if (channel < 1 || channel > AIRTIME_CHANNELS) {
+        return;
+    }
+    unsigned slot = advance(meter, now_ms);
+    meter->channels[channel - 1][slot].listen_us += listen_us;
+}
+
+static uint32_t share_q16(uint32_t airtime_us, uint32_t listen_us) {
+    if (listen_us == 0) {
+        return 0;
+    }
+    uint64_t share = ((uint64_t) airtime_us << 16) / listen_us;
+    return share > AIRTIME_Q16_ONE ? AIRTIME_Q16_ONE : (uint32_t) share;
+}
+
+/**
+ * @brief Sums all buckets of a channel. The current bucket is partially filled, which keeps utilization unbiased.
+ */
+static void sum_channel(const airtime_meter_t *meter, int c, airtime_bucket_t *sum) {
+    memset(sum, 0, sizeof(*sum));
+    for (int slot = 0; slot < CONFIG_AIRTIME_BUCKETS; slot++) {
+        const airtime_bucket_t *bucket = &meter->channels[c][slot];
+        for (int t = 0; t < AIRTIME_TYPES; t++) {
+            sum->airtime_us[t] += bucket->airtime_us[t];
+            sum->frames[t] += bucket->frames[t];
+        }
+        sum->listen_us += bucket->listen_us;
+    }
+}
+
+size_t airtime_meter_channels(airtime_meter_t *meter, uint32_t now_ms, airtime_channel_summary_t *out, size_t max) {
+    advance(meter, now_ms);
+    size_t count = 0;
+    for (int c = 0; c < AIRTIME_CHANNELS && count < max; c++) {
+        airtime_bucket_t sum;
+        sum_channel(meter, c, &sum);
+        if (sum.listen_us == 0 && sum.frames[AIRTIME_MGMT] + sum.frames[AIRTIME_CTRL] + sum.frames[AIRTIME_DATA] == 0) {
+            continue;
+        }
+        airtime_channel_summary_t *summary = &out[count++];
+        summary->channel = c + 1;
+        summary->listen_ms = sum.listen_us / 1000;
+        memcpy(summary->airtime_us, sum.airtime_us, sizeof(summary->airtime_us));
+        memcpy(summary->frames, sum.frames, sizeof(summary->frames));
+        summary->utilization_q16 = share_q16(sum.airtime_us[AIRTIME_MGMT] + sum.airtime_us[AIRTIME_CTRL] +
+                                             sum.airtime_us[AIRTIME_DATA], sum.listen_us);
+    }
+    return count;
+}
+
+size_t airtime_meter_bssids(airtime_meter_t *meter, uint32_t now_ms, airtime_bssid_summary_t *out, size_t max) {
+    advance(meter, now_ms);
+    uint32_t listen_us[AIRTIME_CHANNELS];
+    for (int c = 0; c < AIRTIME_CHANNELS; c++) {
+        listen_us[c] = 0;
+        for (int slot = 0; slot < CONFIG_AIRTIME_BUCKETS; slot++) {
+            listen_us[c] += meter->channels[c][slot].listen_us;
+        }
+    }
+
+    size_t count = 0;
+    for (int b = 0; b < CONFIG_AIRTIME_BSSIDS; b++) {
+        const airtime_bssid_entry_t *entry = &meter->bssids[b];
+        if (!entry->used) {
+            continue;
+        }
+        airtime_bssid_summary_t summary = { .channel = entry->channel };
+        memcpy(summary.bssid, entry->bssid, 6);
+        uint32_t total_us = 0;
+        for (int slot = 0; slot < CONFIG_AIRTIME_BUCKETS; slot++) {
+            for (int t = 0; t < AIRTIME_TYPES; t++) {
+                summary.airtime_us[t] += entry->airtime_us[slot][t];
+                total_us += entry->airtime_us[slot][t];
+            }
+            summary.frames += entry->frames[slot];
+        }
+        if (summary.frames == 0) {
+            continue;
+        }
+        summary.share_q16 = share_q16(total_us, listen_us[entry->channel - 1]);
+
+        size_t pos = count < max ? count++ : max;                           // Insertion sort, descending airtime
+        while (pos > 0 && out[pos - 1].airtime_us[AIRTIME_MGMT] + out[pos - 1].airtime_us[AIRTIME_CTRL] +
+                          out[pos - 1].airtime_us[AIRTIME_DATA] < total_us) {
+            if (pos < max) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = summary;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file airtime_monitor.c
+ * @brief Implements airtime accounting of sniffer batches.
+ */
+#include "airtime_monitor.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "sniffer.h"
+#include "radio.h"
+#include "wifi_controller.h"
+
+static const char *TAG = "airtime_monitor";
+
+#define SIG_MODE_HT 1
+
+// Legacy rate index from rx_ctrl.rate to 500 kbps units (indexes 5-7 are short preamble)
+static const uint8_t legacy_rates[16] = { 2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18 };
+
+static airtime_meter_t meter;
+static portMUX_TYPE meter_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool accounting = false;
+static uint8_t listen_channel = 0;                                          // Channel listened time was last accounted to
+static int64_t listen_until_us = 0;                                         // Listened time is accounted up to here
+
+static inline uint32_t now_ms(int64_t now_us) {
+    return (uint32_t) (now_us / 1000);
+}
+
+/**
+ * @brief Returns BSSID of a management or data frame, NULL if it has none (control, WDS, short frames).
+ */
+static const uint8_t *frame_bssid(const uint8_t *frame, uint32_t len, airtime_type_t type) {
+    if (len < 24) {
+        return NULL;
+    }
+    if (type == AIRTIME_MGMT) {
+        return &frame[16];                                                  // Address 3
+    }
+    if (type != AIRTIME_DATA) {
+        return NULL;
+    }
+    switch (frame[1] & 0x03) {                                              // ToDS, FromDS
+        case 0x01: return &frame[4];                                        // To AP: address 1
+        case 0x02: return &frame[10];                                       // From AP: address 2
+        case 0x00: return &frame[16];                                       // IBSS: address 3
+        default:   return NULL;                                             // WDS
+    }
+}
+
+/**
+ * @brief Accounts time since the last call to the channels the radio was on. Call with meter_lock held.
+ */
+static void account_listening(int64_t now_us) {
+    int64_t since_us;
+    uint8_t channel = wifictl_radio_channel(&since_us);
+    if (wifictl_mode_get() != WIFICTL_MODE_SNIFFING) {                      // Radio not capturing, nothing was listened to
+        listen_channel = channel;
+        listen_until_us = now_us;
+        return;
+    }
+    if (channel != listen_channel && since_us > listen_until_us) {          // Switched since last call
+        airtime_meter_listen(&meter, now_ms(now_us), listen_channel, (uint32_t) (since_us - listen_until_us));
+        listen_until_us = since_us;
+    }
+    listen_channel = channel;
+    if (now_us > listen_until_us) {
+        airtime_meter_listen(&meter, now_ms(now_us), channel, (uint32_t) (now_us - listen_until_us));
+        listen_until_us = now_us;
+    }
+}
+
+/**
+ * @brief Sniffer batch handler adding every frame's estimated airtime to its channel and BSSID.
+ */
+static void account_batch(const wifictl_frame_t *const *frames, size_t count) {
+    int64_t now_us = esp_timer_get_time();
+    uint32_t now = now_ms(now_us);
+
+    portENTER_CRITICAL(&meter_lock);
+    if (accounting) {
+        for (size_t i = 0; i < count; i++) {
+            const wifi_pkt_rx_ctrl_t *rx = &frames[i]->pkt.rx_ctrl;
+            airtime_phy_t phy = {
+                .legacy_rate = rx->sig_mode == SIG_MODE_HT ? 0 : legacy_rates[rx->rate & 0x0f],
+                .short_preamble = (rx->rate & 0x0f) >= 5 && (rx->rate & 0x0f) <= 7,
+                .mcs = rx->mcs,
+                .ht40 = rx->cwb,
+                .short_gi = rx->sgi,
+            };
+            airtime_type_t type = frames[i]->event_id == SNIFFER_EVENT_CAPTURED_MGMT ? AIRTIME_MGMT :
+                                  frames[i]->event_id == SNIFFER_EVENT_CAPTURED_CTRL ? AIRTIME_CTRL : AIRTIME_DATA;
+            airtime_meter_record(&meter, now, rx->channel, type, frame_bssid(frames[i]->pkt.payload, rx->sig_len, type),
+                                 airtime_frame_us(&phy, rx->sig_len));
+        }
+        account_listening(now_us);
+    }
+    portEXIT_CRITICAL(&meter_lock);
+}
+
+esp_err_t wifictl_airtime_start(void) {
+    if (accounting) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&meter_lock);
+    airtime_meter_init(&meter, now_ms(now_us));
+    listen_channel = wifictl_radio_channel(NULL);
+    listen_until_us = now_us;
+    accounting = true;
+    portEXIT_CRITICAL(&meter_lock);
+
+    if (!wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, account_batch)) {
+        accounting = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Airtime accounting started, %d x %d ms window", CONFIG_AIRTIME_BUCKETS, CONFIG_AIRTIME_BUCKET_MS);
+    return ESP_OK;
+}
+
+void wifictl_airtime_stop(void) {
+    if (!accounting) {
+        return;
+    }
+    wifictl_sniffer_unregister_batch_handler(account_batch);
+    portENTER_CRITICAL(&meter_lock);
+    account_listening(esp_timer_get_time());
+    accounting = false;
+    portEXIT_CRITICAL(&meter_lock);
+}
+
+bool wifictl_airtime_active(void) {
+    return accounting;
+}
+
+size_t wifictl_airtime_channels(airtime_channel_summary_t *out, size_t max) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&meter_lock);
+    if (accounting) {
+        account_listening(now_us);                                          // Include a quiet channel the radio is on
+    }
+    size_t count = airtime_meter_channels(&meter, now_ms(now_us), out, max);
+    portEXIT_CRITICAL(&meter_lock);
+    return count;
+}
+
+size_t wifictl_airtime_bssids(airtime_bssid_summary_t *out, size_t max) {
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&meter_lock);
+    if (accounting) {
+        account_listening(now_us);
+    }
+    size_t count = airtime_meter_bssids(&meter, now_ms(now_us), out, max);
+    portEXIT_CRITICAL(&meter_lock);
+    return count;
+}
+
+void wifictl_airtime_get_counters(uint32_t *unrated, uint32_t *evicted) {
+    portENTER_CRITICAL(&meter_lock);
+    *unrated = meter.unrated;
+    *evicted = meter.evicted;
+    portEXIT_CRITICAL(&meter_lock);
+}
@@ -1,62 +1,328 @@
 #include "ap_scanner.h"
 #include "esp_log.h"
 #include "esp_err.h"
-#include "esp_wifi.h"
+#include "radio.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
+#include <string.h>
 
-#define LOG_LOCAL_LEVEL ESP_LOG_VERBOSE
 static const char* TAG = "wifi_controller/ap_scanner";
 
-static void (*scan_complete_callback)(void) = NULL;                            // Function pointer to callback
-static wifictl_ap_records_t ap_records;                                        // static variable to store AP records
+typedef enum {
+    SCAN_IDLE,
+    SCAN_RUNNING,
+    SCAN_FINISHING,                                                            // Stopped, leaving SCANNING mode
+} scan_state_t;
 
+#define SCAN_MAX_INFLIGHT 8                                                    // Channel requests awaiting SCAN_DONE
+#define SCAN_STALE_US 1000000                                                  // A stopped request reports long before this
 
-void wifictl_scan_nearby_aps() {
-    if (!wifi_controller_sta_init()){                                          // Initialize WiFi if not already initialized
-        ESP_LOGE(TAG, "Failed to initialize WiFi for scanning.");
-        return;
+/**
+ * @brief Channel request issued to the driver. SCAN_DONE carries nothing to match it with, but requests are
+ *        issued under scan_mutex, so the events arrive in request order.
+ */
+typedef struct {
+    uint32_t generation;                                                       // scan_generation when issued
+    int64_t issued_us;
+} scan_request_t;
+
+static wifictl_scan_callback_t scan_callbacks[CONFIG_SCAN_MAX_CALLBACKS];      // Registered result callbacks
+static wifi_ap_record_t channel_records[CONFIG_SCAN_MAX_AP];                   // Results of the last scanned channel
+static uint16_t channel_ids[CONFIG_SCAN_MAX_AP];                               // AP table ids of the last scanned channel
+
+static const uint8_t all_channels[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+static uint8_t scan_channels[14];                                              // Channels of the running scan
+static size_t scan_channel_count = 0;
+static size_t scan_channel_index = 0;
+static volatile scan_state_t scan_state = SCAN_IDLE;
+static uint32_t scan_generation = 0;                                           // Advanced by every start and stop
+static scan_request_t inflight[SCAN_MAX_INFLIGHT];                             // Oldest first
+static size_t inflight_count = 0;
+static SemaphoreHandle_t scan_mutex = NULL;                                    // Guards state and radio requests
+static StaticSemaphore_t scan_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int64_t scan_started_us = 0;
+static int64_t scan_ended_us = 0;                                              // When end_scan ran, start of leaving SCANNING
+static uint32_t scan_first_result_ms = 0;
+static uint32_t scan_total_ms = 0;
+static SemaphoreHandle_t scan_done_sem = NULL;                                 // Used by the blocking wrapper only
+
+
+static uint32_t now_ms(void) {
+    return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+static void scan_lock(void) {
+    if (scan_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (scan_mutex == NULL) {
+            scan_mutex = xSemaphoreCreateMutexStatic(&scan_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
     }
+    xSemaphoreTake(scan_mutex, portMAX_DELAY);
+}
 
-    ESP_LOGD(TAG, "Scanning nearby APs...");
-    ap_records.count = CONFIG_SCAN_MAX_AP;                                     // Initialize count to CONFIG_SCAN_MAX_AP
+static void scan_unlock(void) {
+    xSemaphoreGive(scan_mutex);
+}
 
+static void notify_callbacks(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    for (int i = 0; i < CONFIG_SCAN_MAX_CALLBACKS; i++) {
+        if (scan_callbacks[i] != NULL) {
+            scan_callbacks[i](channel, ids, count, done);
+        }
+    }
+}
+
+static esp_err_t scan_channel(uint8_t channel) {                               // Starts non-blocking scan of one channel
     wifi_scan_config_t scan_config = {
         .ssid = NULL                               ,                           // NULL to scan all SSIDs
         .bssid = NULL                              ,                           // NULL to scan all BSSIDs
-        .channel = 0                               ,                           // 0 to scan all channels
+        .channel = channel                         ,                           // One channel per scan request
         .show_hidden = false                       ,                           // false to hide hidden APs
         .scan_type = WIFI_SCAN_TYPE_ACTIVE         ,                           // Active scan
         .scan_time.active = {.min = 120, .max = 150}                           // Scan time range in milliseconds
     };
+    return wifictl_radio()->scan_start(&scan_config);                          // Completion arrives as WIFI_EVENT_SCAN_DONE
+}
+
+/**
+ * @brief Requests one channel of the running scan. Called with scan_mutex held, so a cancel either comes
+ *        before the request or stops it.
+ */
+static esp_err_t request_channel(uint8_t channel) {
+    int64_t now = esp_timer_get_time();
+    size_t kept = 0;
+    for (size_t i = 0; i < inflight_count; i++) {                              // Forget stopped requests that never reported
+        if (inflight[i].generation == scan_generation || now - inflight[i].issued_us < SCAN_STALE_US) {
+            inflight[kept++] = inflight[i];
+        }
+    }
+    inflight_count = kept;
+    if (inflight_count == SCAN_MAX_INFLIGHT) {                                 // Dropping a record would pin its SCAN_DONE on this request
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = scan_channel(channel);
+    if (err == ESP_OK) {
+        inflight[inflight_count++] = (scan_request_t) { .generation = scan_generation, .issued_us = now };
+    }
+    return err;
+}
+
+/**
+ * @brief Pops the request a SCAN_DONE answers. Called with scan_mutex held.
+ * @return true if it belongs to the running scan, false for a stopped request or a scan started by someone else.
+ */
+static bool pop_request(void) {
+    if (inflight_count == 0) {
+        return false;
+    }
+    uint32_t generation = inflight[0].generation;
+    memmove(&inflight[0], &inflight[1], --inflight_count * sizeof(inflight[0]));
+    return scan_state == SCAN_RUNNING && generation == scan_generation;
+}
+
+/**
+ * @brief Ends the running scan. Called with scan_mutex held; requests still in flight become stale.
+ *        Only the caller proceeds to leave_scan, so the scan finishes exactly once.
+ */
+static void end_scan(void) {
+    scan_generation++;
+    scan_state = SCAN_FINISHING;
+    scan_ended_us = esp_timer_get_time();
+    scan_total_ms = (uint32_t) ((scan_ended_us - scan_started_us) / 1000);
+}
+
+/**
+ * @brief Leaves SCANNING mode after end_scan. Called without scan_mutex: wifictl_mode_enter takes its locks the other way round.
+ */
+static void leave_scan(void) {
+    wifictl_mode_leave(WIFICTL_MODE_SCANNING, scan_ended_us);
+    scan_lock();
+    scan_state = SCAN_IDLE;                                                    // New scans may start from here
+    scan_unlock();
+    METRIC_INC(METRIC_SCANS);
+    METRIC_RECORD(METRIC_HIST_SCAN, scan_total_ms);
+    DLOGD(TAG, "Scan done in %lu ms, first result after %lu ms.", (unsigned long) scan_total_ms, (unsigned long) scan_first_result_ms);
+}
 
-    esp_err_t err = esp_wifi_scan_start(&scan_config, true);                   // Start scan
+static void report_done(uint8_t channel) {
+    notify_callbacks(channel, NULL, 0, true);
+    if (scan_done_sem != NULL) {
+        xSemaphoreGive(scan_done_sem);
+    }
+}
+
+bool wifictl_register_scan_callback(wifictl_scan_callback_t callback) {
+    for (int i = 0; i < CONFIG_SCAN_MAX_CALLBACKS; i++) {
+        if (scan_callbacks[i] == callback) {
+            return true;
+        }
+    }
+    for (int i = 0; i < CONFIG_SCAN_MAX_CALLBACKS; i++) {
+        if (scan_callbacks[i] == NULL) {
+            scan_callbacks[i] = callback;
+            return true;
+        }
+    }
+    return false;
+}
+
+void wifictl_unregister_scan_callback(wifictl_scan_callback_t callback) {
+    for (int i = 0; i < CONFIG_SCAN_MAX_CALLBACKS; i++) {
+        if (scan_callbacks[i] == callback) {
+            scan_callbacks[i] = NULL;
+        }
+    }
+}
+
+esp_err_t wifictl_scan_start_async(const uint8_t *channels, size_t count) {
+    if (channels == NULL) {
+        channels = all_channels;
+        count = sizeof(all_channels);
+    }
+    if (count == 0 || count > sizeof(scan_channels)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (channels[i] < 1 || channels[i] > 14) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (scan_state != SCAN_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = wifictl_mode_enter(WIFICTL_MODE_SCANNING);               // Initializes Wi-Fi, stops sniffing
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    scan_lock();
+    if (scan_state != SCAN_IDLE || wifictl_mode_get() != WIFICTL_MODE_SCANNING) {  // Lost a race with another start or a mode switch
+        scan_unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+    scan_state = SCAN_RUNNING;
+    scan_generation++;
+    memcpy(scan_channels, channels, count);
+    scan_channel_count = count;
+    scan_channel_index = 0;
+    wifictl_ap_table_expire(now_ms(), CONFIG_AP_TABLE_MAX_AGE_S * 1000);      // Forget APs gone for a while
+    scan_first_result_ms = 0;
+    scan_total_ms = 0;
+    scan_started_us = esp_timer_get_time();
+
+    ESP_LOGD(TAG, "Scanning nearby APs on %u channels...", (unsigned) count);
+    err = request_channel(scan_channels[0]);
+    if (err == ESP_OK) {
+        scan_unlock();
+        return ESP_OK;
+    }
+    ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(err));
+    end_scan();
+    scan_unlock();
+    leave_scan();                                                              // Nothing was reported, no final callback
+    return err;
+}
+
+void wifictl_scan_on_done(void) {
+    scan_lock();
+    if (!pop_request()) {                                                      // Late event of a stopped request
+        scan_unlock();
+        wifictl_radio()->clear_ap_list();                                      // Release driver's result memory
         return;
     }
 
-    err = esp_wifi_scan_get_ap_records(&ap_records.count, ap_records.records); // Get AP records
-    if (err != ESP_OK) {                                                       // Check for errors
+    uint8_t channel = scan_channels[scan_channel_index];
+    uint16_t found = CONFIG_SCAN_MAX_AP;
+    esp_err_t err = wifictl_radio()->scan_get_ap_records(&found, channel_records);  // Get AP records of this channel
+    if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get AP records: %s", esp_err_to_name(err));
-        return;
+        found = 0;
     }
-    ESP_LOGD(TAG, "Scan done.");
 
-    if (scan_complete_callback != NULL) {                                      // If callback is set, call it
-        scan_complete_callback();                                              // Call the callback
-    }          
-}          
-        
-const wifictl_ap_records_t *wifictl_get_ap_records() {                         // Getter for AP records
-    return &ap_records;                                                        // Return pointer to ap_records
+    uint32_t now = now_ms();                                                   // Merge into AP table, same BSSID can show up on adjacent channels
+    for (uint16_t i = 0; i < found; i++) {
+        channel_ids[i] = wifictl_ap_table_update(&channel_records[i], now, AP_SOURCE_SCAN);
+    }
+    if (found > 0 && scan_first_result_ms == 0) {
+        scan_first_result_ms = (uint32_t) ((esp_timer_get_time() - scan_started_us) / 1000);
+    }
+
+    bool last = ++scan_channel_index >= scan_channel_count;
+    if (!last && (err = request_channel(scan_channels[scan_channel_index])) != ESP_OK) {  // Continue with next channel
+        ESP_LOGE(TAG, "WiFi scan failed: %s", esp_err_to_name(err));
+        last = true;
+    }
+    if (last) {
+        end_scan();
+    }
+    scan_unlock();
+
+    notify_callbacks(channel, channel_ids, found, false);                     // Stream this channel's results
+    if (last) {
+        leave_scan();
+        report_done(channel);
+    }
+}
+
+bool wifictl_scan_abort(void) {
+    scan_lock();
+    if (scan_state != SCAN_RUNNING) {                                          // Not running, or finishing on its own
+        scan_unlock();
+        return false;
+    }
+    end_scan();                                                                // Pending SCAN_DONE will be ignored
+    wifictl_radio()->scan_stop();
+    scan_unlock();
+    DLOGD(TAG, "Scan cancelled.");
+    leave_scan();
+    return true;
+}
+
+void wifictl_scan_report_cancelled(void) {
+    report_done(0);
+}
+
+void wifictl_scan_cancel(void) {
+    if (wifictl_scan_abort()) {
+        wifictl_scan_report_cancelled();
+    }
+}
+
+bool wifictl_scan_in_progress(void) {
+    return scan_state != SCAN_IDLE;
+}
+
+void wifictl_scan_get_timing(uint32_t *first_result_ms, uint32_t *total_ms) {
+    *first_result_ms = scan_first_result_ms;
+    *total_ms = scan_total_ms;
+}
+
+void wifictl_scan_nearby_aps() {
+    if (scan_done_sem == NULL) {
+        scan_done_sem = xSemaphoreCreateBinary();
+    }
+    xSemaphoreTake(scan_done_sem, 0);                                          // Drop stale completion
+    if (wifictl_scan_start_async(NULL, 0) != ESP_OK) {
+        return;
+    }
+    xSemaphoreTake(scan_done_sem, portMAX_DELAY);                              // Wait for the last channel
 }          
         
-const wifi_ap_record_t *wifictl_get_ap_record(unsigned index) {                // Getter for a specific AP record
-    if (index >= ap_records.count) {                                           // Check if index is out of bounds
-        ESP_LOGE(TAG, "Index out of bounds! %u records available, but %u requested", ap_records.count, index);
-        return NULL;
+bool wifictl_get_ap_record(unsigned id, wifi_ap_record_t *record) {           // Getter for a specific AP record
+    if (id >= CONFIG_AP_TABLE_CAPACITY || !wifictl_ap_table_record(id, record)) {  // Copy AP table entry if id is in use
+        ESP_LOGE(TAG, "No AP with id %u! %u APs known", id, (unsigned) wifictl_ap_table_count());
+        return false;
     }
-    return &ap_records.records[index];                                         // Return pointer to the AP record at the specified index
+    return true;                                                               // Record holds a copy of the AP with the specified id
 }
 
 const char* get_auth_mode_str(wifi_auth_mode_t auth_mode) {                    // Function to convert auth mode to string
@@ -73,24 +339,29 @@ const char* get_auth_mode_str(wifi_auth_mode_t auth_mode) {                    /
     }
 }
 
-void print_ap_list(const wifictl_ap_records_t *records) {                      // Function to print the list of APs
-    if (!records) {                                                            // Check if records are valid
-        printf("Failed to get WiFi scan results\n");             
-        return;          
-    }            
-
-    printf("Total APs found: %d\n", records->count);                           // Print total number of APs found
-    for (int i = 0; i < records->count; i++) {                                
-        printf("%d. SSID: %s, RSSI: %d dBm, CH: %d, ENC: %s, BSSID: %02x:%02x:%02x:%02x:%02x:%02x\n", 
-        i+1                                                                                         ,
-        records->records[i].ssid                                                                    ,
-        records->records[i].rssi                                                                    ,
-        records->records[i].primary                                                                 ,
-        get_auth_mode_str(records->records[i].authmode)                                             ,
-        records->records[i].bssid[0], records->records[i].bssid[1]                                  , 
-        records->records[i].bssid[2], records->records[i].bssid[3]                                  , 
-        records->records[i].bssid[4], records->records[i].bssid[5]
-        );
+void print_ap_record(unsigned index, const wifi_ap_record_t *record) {         // Function to print one AP
+    printf("%u. SSID: %s, RSSI: %d dBm, CH: %d, ENC: %s, BSSID: %02x:%02x:%02x:%02x:%02x:%02x\n", 
+    index+1                                                                                     ,
+    record->ssid                                                                                ,
+    record->rssi                                                                                ,
+    record->primary                                                                             ,
+    get_auth_mode_str(record->authmode)                                                         ,
+    record->bssid[0], record->bssid[1]                                                          , 
+    record->bssid[2], record->bssid[3]                                                          , 
+    record->bssid[4], record->bssid[5]
+    );
+}
+
+void print_ap_list(void) {                                                     // Function to print the list of APs
+    static uint16_t ids[CONFIG_AP_TABLE_CAPACITY];
+    size_t count = wifictl_ap_table_sorted(AP_SORT_RSSI, ids, CONFIG_AP_TABLE_CAPACITY);
+
+    printf("Total APs found: %u\n", (unsigned) count);                         // Print total number of APs found
+    for (size_t i = 0; i < count; i++) {                                
+        wifi_ap_record_t record;
+        if (wifictl_ap_table_record(ids[i], &record)) {
+            print_ap_record(ids[i], &record);
+        }
     }
     printf("\n");
 }
\ No newline at end of file
@@ -0,0 +1,322 @@
+/**
+ * @file ap_table.c
+ * @brief Implements BSSID-indexed AP table.
+ */
+#include "ap_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "sniffer.h"
+#include "beacon_parser.h"
+
+_Static_assert((CONFIG_AP_TABLE_CAPACITY & (CONFIG_AP_TABLE_CAPACITY - 1)) == 0 && CONFIG_AP_TABLE_CAPACITY < AP_TABLE_INVALID_ID / 2,
+               "CONFIG_AP_TABLE_CAPACITY must be a power of two below 32768");
+
+#define INDEX_SIZE (2 * CONFIG_AP_TABLE_CAPACITY)                           // Load factor stays at or below 0.5
+#define INDEX_MASK (INDEX_SIZE - 1)
+#define RSSI_EWMA_SHIFT 2                                                   // alpha = 1/4
+
+static uint16_t index_slots[INDEX_SIZE];                                    // Entry ids, AP_TABLE_INVALID_ID when empty
+static wifictl_ap_info_t hot[CONFIG_AP_TABLE_CAPACITY];                     // Scanned by lookups, aging and sorting
+static wifi_ap_record_t records[CONFIG_AP_TABLE_CAPACITY];                  // Cold full records
+static uint16_t free_ids[CONFIG_AP_TABLE_CAPACITY];
+static uint16_t free_count = 0;
+static uint16_t lru_prev[CONFIG_AP_TABLE_CAPACITY];                         // Towards most recently seen
+static uint16_t lru_next[CONFIG_AP_TABLE_CAPACITY];                         // Towards least recently seen
+static uint16_t lru_head = AP_TABLE_INVALID_ID;                             // Most recently seen
+static uint16_t lru_tail = AP_TABLE_INVALID_ID;                             // Eviction candidate
+static size_t used_count = 0;
+static bool initialized = false;
+
+static SemaphoreHandle_t table_mutex = NULL;
+static StaticSemaphore_t table_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void table_lock(void) {
+    if (table_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (table_mutex == NULL) {
+            table_mutex = xSemaphoreCreateMutexStatic(&table_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+}
+
+static void table_unlock(void) {
+    xSemaphoreGive(table_mutex);
+}
+
+static void reset_locked(void) {
+    memset(index_slots, 0xFF, sizeof(index_slots));
+    memset(hot, 0, sizeof(hot));
+    for (uint16_t i = 0; i < CONFIG_AP_TABLE_CAPACITY; i++) {
+        free_ids[i] = CONFIG_AP_TABLE_CAPACITY - 1 - i;                     // Lowest id is handed out first
+    }
+    free_count = CONFIG_AP_TABLE_CAPACITY;
+    lru_head = lru_tail = AP_TABLE_INVALID_ID;
+    used_count = 0;
+    initialized = true;
+}
+
+static void lru_unlink(uint16_t id) {
+    if (lru_prev[id] != AP_TABLE_INVALID_ID) {
+        lru_next[lru_prev[id]] = lru_next[id];
+    } else {
+        lru_head = lru_next[id];
+    }
+    if (lru_next[id] != AP_TABLE_INVALID_ID) {
+        lru_prev[lru_next[id]] = lru_prev[id];
+    } else {
+        lru_tail = lru_prev[id];
+    }
+}
+
+static void lru_push_front(uint16_t id) {
+    lru_prev[id] = AP_TABLE_INVALID_ID;
+    lru_next[id] = lru_head;
+    if (lru_head != AP_TABLE_INVALID_ID) {
+        lru_prev[lru_head] = id;
+    }
+    lru_head = id;
+    if (lru_tail == AP_TABLE_INVALID_ID) {
+        lru_tail = id;
+    }
+}
+
+static uint32_t home_slot(const uint8_t bssid[6]) {
+    uint64_t key = 0;
+    memcpy(&key, bssid, 6);
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & INDEX_MASK;
+}
+
+static uint32_t find_slot_locked(const uint8_t bssid[6]) {                  // Returns slot holding bssid or INDEX_SIZE
+    for (uint32_t slot = home_slot(bssid), probe = 0; probe < INDEX_SIZE; slot = (slot + 1) & INDEX_MASK, probe++) {
+        uint16_t id = index_slots[slot];
+        if (id == AP_TABLE_INVALID_ID) {
+            break;
+        }
+        if (memcmp(hot[id].bssid, bssid, 6) == 0) {
+            return slot;
+        }
+    }
+    return INDEX_SIZE;
+}
+
+static void remove_locked(uint16_t id) {
+    uint32_t hole = find_slot_locked(hot[id].bssid);
+    if (hole == INDEX_SIZE) {
+        return;
+    }
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    for (uint32_t next = (hole + 1) & INDEX_MASK; index_slots[next] != AP_TABLE_INVALID_ID; next = (next + 1) & INDEX_MASK) {
+        uint32_t home = home_slot(hot[index_slots[next]].bssid);
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays) {
+            index_slots[hole] = index_slots[next];
+            hole = next;
+        }
+    }
+    index_slots[hole] = AP_TABLE_INVALID_ID;
+
+    lru_unlink(id);
+    hot[id].sources = 0;
+    free_ids[free_count++] = id;
+    used_count--;
+}
+
+/**
+ * @brief Evicts the tail of the recency list in O(1). Updates arrive in time order, so it is the least recently seen.
+ */
+static uint16_t evict_oldest_locked(void) {
+    uint16_t oldest = lru_tail;
+    if (oldest != AP_TABLE_INVALID_ID) {
+        remove_locked(oldest);
+    }
+    return oldest;
+}
+
+uint16_t wifictl_ap_table_update(const wifi_ap_record_t *record, uint32_t now_ms, uint8_t source) {
+    table_lock();
+    if (!initialized) {
+        reset_locked();
+    }
+
+    uint16_t id;
+    uint32_t slot = find_slot_locked(record->bssid);
+    if (slot != INDEX_SIZE) {                                               // Known AP: merge observation
+        id = index_slots[slot];
+        lru_unlink(id);
+        wifictl_ap_info_t *info = &hot[id];
+        int16_t sample = (int16_t) (record->rssi * 16);
+        info->rssi_ewma_q4 += (sample - info->rssi_ewma_q4) / (1 << RSSI_EWMA_SHIFT);
+        if (info->seen_count < UINT16_MAX) {
+            info->seen_count++;
+        }
+    } else {                                                                // New AP: take free entry or evict oldest
+        if (free_count == 0) {
+            evict_oldest_locked();
+        }
+        id = free_ids[--free_count];
+        wifictl_ap_info_t *info = &hot[id];
+        memcpy(info->bssid, record->bssid, 6);
+        info->rssi_ewma_q4 = (int16_t) (record->rssi * 16);
+        info->seen_count = 1;
+        info->first_seen_ms = now_ms;
+        info->sources = 0;
+        used_count++;
+
+        for (slot = home_slot(record->bssid); index_slots[slot] != AP_TABLE_INVALID_ID; slot = (slot + 1) & INDEX_MASK) {
+        }
+        index_slots[slot] = id;
+    }
+    lru_push_front(id);
+
+    wifictl_ap_info_t *info = &hot[id];
+    bool scanned = info->sources & AP_SOURCE_SCAN;
+    info->channel = record->primary;
+    info->sources |= source;
+    info->last_seen_ms = now_ms;
+    if (source == AP_SOURCE_BEACON && scanned) {
+        // Beacons carry less than scan results: refresh only what they know, keep cipher and PHY details
+        memcpy(records[id].ssid, record->ssid, sizeof(records[id].ssid));
+        records[id].primary = record->primary;
+        records[id].rssi = record->rssi;
+        records[id].authmode = record->authmode;
+    } else {
+        records[id] = *record;
+    }
+    table_unlock();
+    return id;
+}
+
+uint16_t wifictl_ap_table_find(const uint8_t bssid[6]) {
+    uint16_t id = AP_TABLE_INVALID_ID;
+    table_lock();
+    if (initialized) {
+        uint32_t slot = find_slot_locked(bssid);
+        if (slot != INDEX_SIZE) {
+            id = index_slots[slot];
+        }
+    }
+    table_unlock();
+    return id;
+}
+
+bool wifictl_ap_table_record(uint16_t id, wifi_ap_record_t *record) {
+    if (id >= CONFIG_AP_TABLE_CAPACITY) {
+        return false;
+    }
+    table_lock();
+    bool used = hot[id].sources != 0;
+    if (used) {
+        *record = records[id];
+    }
+    table_unlock();
+    return used;
+}
+
+bool wifictl_ap_table_info(uint16_t id, wifictl_ap_info_t *info) {
+    if (id >= CONFIG_AP_TABLE_CAPACITY) {
+        return false;
+    }
+    table_lock();
+    bool used = hot[id].sources != 0;
+    if (used) {
+        *info = hot[id];
+    }
+    table_unlock();
+    return used;
+}
+
+static wifictl_ap_sort_t sort_order;                                        // qsort has no context argument
+
+static int compare_ids(const void *a, const void *b) {
+    const wifictl_ap_info_t *x = &hot[*(const uint16_t *) a];
+    const wifictl_ap_info_t *y = &hot[*(const uint16_t *) b];
+    switch (sort_order) {
+        case AP_SORT_RSSI:
+            return y->rssi_ewma_q4 - x->rssi_ewma_q4;
+        case AP_SORT_LAST_SEEN:
+            return (y->last_seen_ms > x->last_seen_ms) - (y->last_seen_ms < x->last_seen_ms);
+        case AP_SORT_BSSID:
+        default:
+            return memcmp(x->bssid, y->bssid, 6);
+    }
+}
+
+size_t wifictl_ap_table_sorted(wifictl_ap_sort_t order, uint16_t *ids, size_t max) {
+    static uint16_t all_ids[CONFIG_AP_TABLE_CAPACITY];
+    size_t n = 0;
+
+    table_lock();
+    for (uint16_t id = 0; id < CONFIG_AP_TABLE_CAPACITY; id++) {
+        if (hot[id].sources != 0) {
+            all_ids[n++] = id;
+        }
+    }
+    sort_order = order;
+    qsort(all_ids, n, sizeof(all_ids[0]), compare_ids);
+    if (n > max) {
+        n = max;
+    }
+    memcpy(ids, all_ids, n * sizeof(ids[0]));
+    table_unlock();
+    return n;
+}
+
+size_t wifictl_ap_table_expire(uint32_t now_ms, uint32_t max_age_ms) {
+    size_t removed = 0;
+    table_lock();
+    for (uint16_t id = 0; id < CONFIG_AP_TABLE_CAPACITY; id++) {
+        if (hot[id].sources != 0 && now_ms - hot[id].last_seen_ms > max_age_ms) {
+            remove_locked(id);
+            removed++;
+        }
+    }
+    table_unlock();
+    return removed;
+}
+
+size_t wifictl_ap_table_count(void) {
+    return used_count;
+}
+
+void wifictl_ap_table_clear(void) {
+    table_lock();
+    reset_locked();
+    table_unlock();
+}
+
+/**
+ * @brief Sniffer batch handler merging captured beacons and probe responses.
+ */
+static void track_beacons(const wifictl_frame_t *const *frames, size_t count) {
+    uint32_t now_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_frame_t *frame = frames[i];
+        if (frame->event_id != SNIFFER_EVENT_CAPTURED_MGMT || frame->pkt.rx_ctrl.sig_len <= 4) {
+            continue;
+        }
+        wifi_ap_record_t record;
+        if (wifictl_parse_beacon(frame->pkt.payload, frame->pkt.rx_ctrl.sig_len - 4, &record)) {  // Strip FCS
+            if (record.primary == 0) {
+                record.primary = frame->pkt.rx_ctrl.channel;
+            }
+            record.rssi = frame->pkt.rx_ctrl.rssi;
+            wifictl_ap_table_update(&record, now_ms, AP_SOURCE_BEACON);
+        }
+    }
+}
+
+bool wifictl_ap_table_track_beacons(bool enable) {
+    if (!enable) {
+        wifictl_sniffer_unregister_batch_handler(track_beacons);
+        return true;
+    }
+    return wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, track_beacons);
+}
@@ -0,0 +1,155 @@
+/**
+ * @file beacon_dedup.c
+ * @brief Implements per-BSSID beacon deduplication.
+ */
+#include "beacon_dedup.h"
+
+#include <string.h>
+
+#define MGMT_HEADER_LEN 24
+#define BEACON_FIXED_LEN 12                                                 // Timestamp, beacon interval, capability
+#define BEACON_TIMESTAMP_LEN 8
+#define FCS_LEN 4
+#define ELEMENT_TIM 5
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+_Static_assert((CONFIG_BEACON_DEDUP_CAPACITY & (CONFIG_BEACON_DEDUP_CAPACITY - 1)) == 0,
+               "CONFIG_BEACON_DEDUP_CAPACITY must be a power of two");
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes beacon interval, capability and all elements except TIM, whose DTIM count changes with every beacon.
+ */
+static uint32_t body_hash(const uint8_t *frame, size_t len) {
+    size_t pos = MGMT_HEADER_LEN + BEACON_TIMESTAMP_LEN;
+    size_t end = len - FCS_LEN;
+    uint32_t hash = fnv1a(FNV_OFFSET, &frame[pos], BEACON_FIXED_LEN - BEACON_TIMESTAMP_LEN);
+    pos = MGMT_HEADER_LEN + BEACON_FIXED_LEN;
+    while (pos + 2 <= end) {
+        size_t element_len = 2 + frame[pos + 1];
+        if (pos + element_len > end) {                                      // Malformed tail is hashed as it is
+            break;
+        }
+        if (frame[pos] != ELEMENT_TIM) {
+            hash = fnv1a(hash, &frame[pos], element_len);
+        }
+        pos += element_len;
+    }
+    return fnv1a(hash, &frame[pos], end - pos);
+}
+
+static unsigned bssid_slot(const uint8_t *bssid) {
+    return fnv1a(FNV_OFFSET, bssid, 6) & (CONFIG_BEACON_DEDUP_CAPACITY - 1);
+}
+
+static void emit_summary(beacon_dedup_t *dedup, beacon_dedup_entry_t *entry, beacon_summary_cb_t callback, void *ctx) {
+    if (entry->count == 0) {
+        return;
+    }
+    beacon_summary_t summary;
+    memcpy(summary.bssid, entry->bssid, sizeof(summary.bssid));
+    summary.channel = entry->channel;
+    int32_t half = entry->rssi_sum < 0 ? -(int32_t) entry->count / 2 : (int32_t) entry->count / 2;
+    summary.rssi_mean = (int8_t) ((entry->rssi_sum + half) / (int32_t) entry->count);  // Rounded
+    summary.rssi_min = entry->rssi_min;
+    summary.rssi_max = entry->rssi_max;
+    summary.count = entry->count;
+    summary.first_us = entry->first_us;
+    summary.last_us = entry->seen_us;
+    summary.ie_hash = entry->ie_hash;
+    entry->count = 0;
+    dedup->summaries++;
+    if (callback != NULL) {
+        callback(&summary, ctx);
+    }
+}
+
+static beacon_dedup_entry_t *find_entry(beacon_dedup_t *dedup, const uint8_t *bssid, uint32_t now_us,
+                                        beacon_summary_cb_t callback, void *ctx) {
+    unsigned slot = bssid_slot(bssid);
+    beacon_dedup_entry_t *oldest = NULL;
+    for (unsigned probe = 0; probe < BEACON_DEDUP_PROBES; probe++) {
+        beacon_dedup_entry_t *entry = &dedup->entries[(slot + probe) & (CONFIG_BEACON_DEDUP_CAPACITY - 1)];
+        if (!entry->used) {
+            oldest = entry;
+            break;
+        }
+        if (memcmp(entry->bssid, bssid, 6) == 0) {
+            return entry;
+        }
+        if (oldest == NULL || now_us - entry->seen_us > now_us - oldest->seen_us) {
+            oldest = entry;
+        }
+    }
+    if (oldest->used) {                                                     // Report what the evicted BSSID still holds
+        emit_summary(dedup, oldest, callback, ctx);
+        dedup->evicted++;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    memcpy(oldest->bssid, bssid, 6);
+    return oldest;
+}
+
+void beacon_dedup_init(beacon_dedup_t *dedup, uint32_t summary_ms, uint32_t refresh_ms) {
+    memset(dedup, 0, sizeof(*dedup));
+    dedup->summary_us = summary_ms * 1000;
+    dedup->refresh_us = refresh_ms * 1000;
+}
+
+bool beacon_dedup_observe(beacon_dedup_t *dedup, const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel,
+                          uint32_t now_us, beacon_summary_cb_t callback, void *ctx) {
+    if (len < MGMT_HEADER_LEN + BEACON_FIXED_LEN + FCS_LEN || frame[0] != 0x80) {  // Beacons only, version 0
+        return true;
+    }
+    const uint8_t *bssid = &frame[16];                                      // Address 3
+    uint32_t hash = body_hash(frame, len);
+    beacon_dedup_entry_t *entry = find_entry(dedup, bssid, now_us, callback, ctx);
+
+    bool refresh = dedup->refresh_us != 0 && now_us - entry->sent_us >= dedup->refresh_us;
+    if (!entry->used || entry->ie_hash != hash || entry->channel != channel || refresh) {
+        emit_summary(dedup, entry, callback, ctx);                          // Counts belong to the previous content
+        entry->used = true;
+        entry->ie_hash = hash;
+        entry->channel = channel;
+        entry->sent_us = now_us;
+        entry->seen_us = now_us;
+        dedup->passed++;
+        return true;
+    }
+
+    if (entry->count == 0) {
+        entry->first_us = now_us;
+        entry->rssi_min = rssi;
+        entry->rssi_max = rssi;
+        entry->rssi_sum = 0;
+    }
+    entry->rssi_min = rssi < entry->rssi_min ? rssi : entry->rssi_min;
+    entry->rssi_max = rssi > entry->rssi_max ? rssi : entry->rssi_max;
+    entry->rssi_sum += rssi;
+    entry->seen_us = now_us;
+    dedup->suppressed++;
+    if (++entry->count == UINT16_MAX) {
+        emit_summary(dedup, entry, callback, ctx);
+    }
+    return false;
+}
+
+void beacon_dedup_flush(beacon_dedup_t *dedup, uint32_t now_us, beacon_summary_cb_t callback, void *ctx) {
+    if (now_us - dedup->last_summary_us < dedup->summary_us) {
+        return;
+    }
+    dedup->last_summary_us = now_us;
+    for (unsigned i = 0; i < CONFIG_BEACON_DEDUP_CAPACITY; i++) {
+        if (dedup->entries[i].used) {
+            emit_summary(dedup, &dedup->entries[i], callback, ctx);
+        }
+    }
+}
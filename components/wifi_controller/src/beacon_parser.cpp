@@ -0,0 +1,88 @@
+/**
+ * @file beacon_parser.cpp
+ * @brief Implements beacon to AP record conversion on top of ieee80211.hpp.
+ */
+#include "beacon_parser.h"
+
+#include <cstring>
+#include <type_traits>
+#include "ieee80211.hpp"
+
+using namespace ieee80211;
+
+namespace {
+
+constexpr uint32_t kAkm8021x = 0x000fac01;
+constexpr uint32_t kAkmPsk = 0x000fac02;
+constexpr uint32_t kAkmSae = 0x000fac08;
+
+/** @brief Vendor specific element, only used to detect the legacy WPA element (00:50:f2 type 1). */
+struct VendorSpecific {
+    static constexpr uint8_t kId = 221;
+    ByteView body;
+    static constexpr std::optional<VendorSpecific> parse(ByteView body) {
+        return body.size() >= 4 ? std::optional<VendorSpecific>(VendorSpecific{body}) : std::nullopt;
+    }
+    constexpr bool is_wpa() const { return body[0] == 0x00 && body[1] == 0x50 && body[2] == 0xf2 && body[3] == 0x01; }
+};
+
+wifi_auth_mode_t auth_mode_from_rsn(const Rsn &rsn) {
+    bool psk = false, sae = false, dot1x = false;
+    for (size_t i = 0; i < rsn.akm_count(); i++) {
+        psk |= rsn.akm(i) == kAkmPsk;
+        sae |= rsn.akm(i) == kAkmSae;
+        dot1x |= rsn.akm(i) == kAkm8021x;
+    }
+    if (psk && sae) {
+        return WIFI_AUTH_WPA2_WPA3_PSK;
+    }
+    if (sae) {
+        return WIFI_AUTH_WPA3_PSK;
+    }
+    if (dot1x && !psk) {
+        return WIFI_AUTH_ENTERPRISE;
+    }
+    return WIFI_AUTH_WPA2_PSK;
+}
+
+}  // namespace
+
+bool wifictl_parse_beacon(const uint8_t *frame, size_t len, wifi_ap_record_t *record) {
+    auto mf = ManagementFrame::parse(ByteView(frame, len));
+    if (!mf || mf->header().subtype() == subtype::ProbeRequest) {
+        return false;
+    }
+    auto bssid = mf->header().bssid();
+    if (!bssid) {
+        return false;
+    }
+
+    std::memset(record, 0, sizeof(*record));
+    std::memcpy(record->bssid, bssid->bytes, sizeof(record->bssid));
+
+    bool rsn_seen = false;
+    bool wpa_seen = false;
+    dispatch_ies<Ssid, DsParameterSet, Rsn, HtCapabilities, VendorSpecific>(mf->ies(), [&](const auto &ie) {
+        using T = std::decay_t<decltype(ie)>;
+        if constexpr (std::is_same_v<T, Ssid>) {
+            std::memcpy(record->ssid, ie.name.data(), ie.name.size());      // Record is zeroed, stays terminated
+        } else if constexpr (std::is_same_v<T, DsParameterSet>) {
+            record->primary = ie.channel;
+        } else if constexpr (std::is_same_v<T, Rsn>) {
+            record->authmode = auth_mode_from_rsn(ie);
+            rsn_seen = true;
+        } else if constexpr (std::is_same_v<T, HtCapabilities>) {
+            record->phy_11n = 1;
+        } else if constexpr (std::is_same_v<T, VendorSpecific>) {
+            wpa_seen |= ie.is_wpa();
+        }
+    });
+
+    if (rsn_seen && wpa_seen && record->authmode == WIFI_AUTH_WPA2_PSK) {
+        record->authmode = WIFI_AUTH_WPA_WPA2_PSK;
+    } else if (!rsn_seen) {
+        record->authmode = wpa_seen ? WIFI_AUTH_WPA_PSK : (mf->privacy() ? WIFI_AUTH_WEP : WIFI_AUTH_OPEN);
+    }
+    record->phy_11g = 1;
+    return true;
+}
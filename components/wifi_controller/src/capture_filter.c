@@ -0,0 +1,499 @@
+/**
+ * @file capture_filter.c
+ * @brief Implements capture filter compiler and evaluator.
+ */
+#include "capture_filter.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    FILTER_OP_TYPE,                                                         // value: frame type
+    FILTER_OP_SUBTYPE,                                                      // value: subtype, arg 1: value is (subtype << 2) | type
+    FILTER_OP_ADDR,                                                         // arg: ADDR_*, value: set index
+    FILTER_OP_RSSI,                                                         // arg: CMP_*, value: dBm
+    FILTER_OP_CHANNEL,                                                      // arg: CMP_*, value: channel
+    FILTER_OP_LEN,                                                          // arg: CMP_*, value: bytes
+    FILTER_OP_NOT,
+    FILTER_OP_JF,                                                           // arg: forward offset taken if accumulator is false
+    FILTER_OP_JT,                                                           // arg: forward offset taken if accumulator is true
+};
+
+enum { ADDR_BSSID, ADDR_SRC, ADDR_DST, ADDR_ANY };
+enum { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE };
+
+#define FC_TYPE_MGMT 0
+#define FC_TYPE_CTRL 1
+#define FC_TYPE_DATA 2
+#define FC_TO_DS   0x01
+#define FC_FROM_DS 0x02
+
+static const char *const type_names[] = { "mgmt", "ctrl", "data" };
+static const char *const addr_names[] = { "bssid", "src", "dst", "addr" };
+static const char *const cmp_names[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+static const struct {
+    const char *name;
+    uint8_t subtype;
+} mgmt_subtypes[] = {
+    { "assoc-req", 0 }, { "assoc-resp", 1 }, { "reassoc-req", 2 }, { "reassoc-resp", 3 },
+    { "probe-req", 4 }, { "probe-resp", 5 }, { "beacon", 8 }, { "disassoc", 10 },
+    { "auth", 11 }, { "deauth", 12 }, { "action", 13 },
+};
+
+// ---------------------------------------------------------------------------------------------
+// Evaluation
+// ---------------------------------------------------------------------------------------------
+
+static bool compare(uint8_t cmp, int32_t a, int32_t b) {
+    switch (cmp) {
+        case CMP_EQ: return a == b;
+        case CMP_NE: return a != b;
+        case CMP_LT: return a < b;
+        case CMP_LE: return a <= b;
+        case CMP_GT: return a > b;
+        case CMP_GE: return a >= b;
+        default: return false;
+    }
+}
+
+static uint64_t mac_key(const uint8_t *mac) {
+    uint64_t key = 0;
+    for (int b = 0; b < 6; b++) {
+        key = (key << 8) | mac[b];
+    }
+    return key;
+}
+
+static bool set_contains(const capture_filter_t *filter, uint8_t set, const uint8_t *mac) {
+    uint64_t key = mac_key(mac);
+    const uint64_t *macs = &filter->macs[filter->sets[set].first];
+    size_t lo = 0;
+    size_t hi = filter->sets[set].count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (macs[mid] == key) {
+            return true;
+        }
+        if (macs[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Collects addresses a field refers to, as pointers into the frame.
+ * @return Number of addresses, 0 if the frame does not carry the field.
+ */
+static size_t frame_addresses(const uint8_t *frame, size_t len, uint8_t field, const uint8_t *out[3]) {
+    if (len < 10) {
+        return 0;
+    }
+    const uint8_t *a1 = &frame[4];
+    const uint8_t *a2 = len >= 16 ? &frame[10] : NULL;
+    if (((frame[0] >> 2) & 0x3) == FC_TYPE_CTRL) {                          // RA and, for most subtypes, TA only
+        switch (field) {
+            case ADDR_DST: out[0] = a1; return 1;
+            case ADDR_SRC: out[0] = a2; return a2 != NULL;
+            case ADDR_ANY: out[0] = a1; out[1] = a2; return a2 != NULL ? 2 : 1;
+            default: return 0;
+        }
+    }
+    if (len < 24) {
+        return 0;
+    }
+    const uint8_t *a3 = &frame[16];
+    const uint8_t *bssid, *src, *dst;
+    switch (frame[1] & (FC_TO_DS | FC_FROM_DS)) {
+        case 0:          dst = a1; src = a2; bssid = a3; break;
+        case FC_TO_DS:   bssid = a1; src = a2; dst = a3; break;
+        case FC_FROM_DS: dst = a1; bssid = a2; src = a3; break;
+        default:                                                            // WDS: SA is addr4, no BSSID
+            dst = a3;
+            src = len >= 30 ? &frame[24] : NULL;
+            bssid = NULL;
+            break;
+    }
+    switch (field) {
+        case ADDR_BSSID: out[0] = bssid; return bssid != NULL;
+        case ADDR_SRC: out[0] = src; return src != NULL;
+        case ADDR_DST: out[0] = dst; return 1;
+        default: out[0] = a1; out[1] = a2; out[2] = a3; return 3;
+    }
+}
+
+bool capture_filter_match(capture_filter_t *filter, const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel) {
+    bool acc = true;
+    uint8_t fc = len > 0 ? frame[0] : 0;
+
+    for (size_t pc = 0; pc < filter->insn_count; pc++) {
+        const capture_filter_insn_t *insn = &filter->insns[pc];
+        switch (insn->op) {
+            case FILTER_OP_TYPE:
+                acc = len >= 2 && ((fc >> 2) & 0x3) == insn->value;
+                break;
+            case FILTER_OP_SUBTYPE:
+                acc = len >= 2 && (insn->arg ? ((fc >> 2) & 0x3F) == insn->value : (fc >> 4) == insn->value);
+                break;
+            case FILTER_OP_ADDR: {
+                const uint8_t *addrs[3];
+                size_t n = frame_addresses(frame, len, insn->arg, addrs);
+                acc = false;
+                for (size_t i = 0; i < n && !acc; i++) {
+                    acc = set_contains(filter, (uint8_t) insn->value, addrs[i]);
+                }
+                break;
+            }
+            case FILTER_OP_RSSI:
+                acc = compare(insn->arg, rssi, insn->value);
+                break;
+            case FILTER_OP_CHANNEL:
+                acc = compare(insn->arg, channel, insn->value);
+                break;
+            case FILTER_OP_LEN:
+                acc = compare(insn->arg, (int32_t) len, insn->value);
+                break;
+            case FILTER_OP_NOT:
+                acc = !acc;
+                continue;
+            case FILTER_OP_JF:
+                if (!acc) {
+                    pc += insn->arg;
+                }
+                continue;
+            case FILTER_OP_JT:
+                if (acc) {
+                    pc += insn->arg;
+                }
+                continue;
+            default:
+                continue;
+        }
+        if (acc) {
+            filter->hits[pc]++;
+        }
+    }
+    filter->evaluated++;
+    if (acc) {
+        filter->matched++;
+    }
+    return acc;
+}
+
+void capture_filter_reset_stats(capture_filter_t *filter) {
+    memset(filter->hits, 0, sizeof(filter->hits));
+    filter->evaluated = 0;
+    filter->matched = 0;
+}
+
+int capture_filter_format_insn(const capture_filter_t *filter, size_t pc, char *buf, size_t size) {
+    if (pc >= filter->insn_count) {
+        return snprintf(buf, size, "?");
+    }
+    const capture_filter_insn_t *insn = &filter->insns[pc];
+    switch (insn->op) {
+        case FILTER_OP_TYPE:
+            return snprintf(buf, size, "%s", type_names[insn->value]);
+        case FILTER_OP_SUBTYPE:
+            if (insn->arg) {
+                return snprintf(buf, size, "subtype %d (%s)", insn->value >> 2, type_names[insn->value & 0x3]);
+            }
+            return snprintf(buf, size, "subtype %d", insn->value);
+        case FILTER_OP_ADDR:
+            return snprintf(buf, size, "%s in set %d (%u MACs)", addr_names[insn->arg], insn->value,
+                            filter->sets[insn->value].count);
+        case FILTER_OP_RSSI:
+            return snprintf(buf, size, "rssi %s %d", cmp_names[insn->arg], insn->value);
+        case FILTER_OP_CHANNEL:
+            return snprintf(buf, size, "channel %s %d", cmp_names[insn->arg], insn->value);
+        case FILTER_OP_LEN:
+            return snprintf(buf, size, "len %s %d", cmp_names[insn->arg], insn->value);
+        case FILTER_OP_NOT:
+            return snprintf(buf, size, "not");
+        case FILTER_OP_JF:
+            return snprintf(buf, size, "if false goto %u", (unsigned) (pc + 1 + insn->arg));
+        case FILTER_OP_JT:
+            return snprintf(buf, size, "if true goto %u", (unsigned) (pc + 1 + insn->arg));
+        default:
+            return snprintf(buf, size, "?");
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Compiler: recursive descent straight into accumulator code
+// ---------------------------------------------------------------------------------------------
+
+typedef struct {
+    const char *next;                                                       // Input after current token
+    char token[24];                                                         // Current token, empty at end of input
+    capture_filter_t *filter;
+    const char *error;
+    uint8_t depth;                                                          // Open "(" and "not"
+    uint8_t jumps[CONFIG_CAPTURE_FILTER_MAX_INSNS];                         // Unpatched jumps of all open terms and exprs
+    size_t jump_count;
+} parser_t;
+
+static void lex(parser_t *ps) {
+    const char *p = ps->next;
+    size_t n = 0;
+    while (isspace((unsigned char) *p)) {
+        p++;
+    }
+    if (strchr("(){},", *p) != NULL && *p != '\0') {
+        ps->token[n++] = *p++;
+    } else if (strchr("=!<>", *p) != NULL && *p != '\0') {
+        ps->token[n++] = *p++;
+        if (*p == '=') {
+            ps->token[n++] = *p++;
+        }
+    } else {
+        while (*p != '\0' && (isalnum((unsigned char) *p) || *p == '-' || *p == ':' || *p == '_')) {
+            if (n < sizeof(ps->token) - 1) {
+                ps->token[n++] = (char) tolower((unsigned char) *p);
+            }
+            p++;
+        }
+        if (n == 0 && *p != '\0') {                                         // Unknown character becomes its own token
+            ps->token[n++] = *p++;
+        }
+    }
+    ps->token[n] = '\0';
+    ps->next = p;
+}
+
+static bool accept(parser_t *ps, const char *word) {
+    if (strcmp(ps->token, word) == 0) {
+        lex(ps);
+        return true;
+    }
+    return false;
+}
+
+static bool fail(parser_t *ps, const char *error) {
+    if (ps->error == NULL) {
+        ps->error = error;
+    }
+    return false;
+}
+
+static bool emit(parser_t *ps, uint8_t op, uint8_t arg, int16_t value) {
+    capture_filter_t *f = ps->filter;
+    if (f->insn_count >= CONFIG_CAPTURE_FILTER_MAX_INSNS) {
+        return fail(ps, "expression too long");
+    }
+    f->insns[f->insn_count++] = (capture_filter_insn_t) { .op = op, .arg = arg, .value = value };
+    return true;
+}
+
+static bool emit_jump(parser_t *ps, uint8_t op) {
+    uint8_t at = ps->filter->insn_count;
+    if (!emit(ps, op, 0, 0)) {
+        return false;
+    }
+    ps->jumps[ps->jump_count++] = at;                                       // Every jump is an instruction, so it fits
+    return true;
+}
+
+/**
+ * @brief Points the jumps pushed since `first` to the next instruction and pops them.
+ */
+static void patch_jumps(parser_t *ps, size_t first) {
+    for (size_t i = first; i < ps->jump_count; i++) {
+        ps->filter->insns[ps->jumps[i]].arg = (uint8_t) (ps->filter->insn_count - ps->jumps[i] - 1);
+    }
+    ps->jump_count = first;
+}
+
+static bool enter(parser_t *ps) {
+    return ++ps->depth <= CAPTURE_FILTER_MAX_DEPTH || fail(ps, "too deeply nested");
+}
+
+static bool parse_number(parser_t *ps, int32_t min, int32_t max, int16_t *value) {
+    char *end;
+    long number = strtol(ps->token, &end, 10);
+    if (ps->token[0] == '\0' || *end != '\0') {
+        return fail(ps, "expected number");
+    }
+    if (number < min || number > max) {
+        return fail(ps, "number out of range");
+    }
+    *value = (int16_t) number;
+    lex(ps);
+    return true;
+}
+
+static bool parse_mac(parser_t *ps, uint64_t *key) {
+    unsigned int b[6];
+    int consumed = 0;
+    if (sscanf(ps->token, "%2x:%2x:%2x:%2x:%2x:%2x%n", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &consumed) != 6
+        || ps->token[consumed] != '\0') {
+        return fail(ps, "expected MAC address aa:bb:cc:dd:ee:ff");
+    }
+    uint8_t mac[6];
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t) b[i];
+    }
+    *key = mac_key(mac);
+    lex(ps);
+    return true;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static bool parse_mac_set(parser_t *ps, uint8_t *set_index) {
+    capture_filter_t *f = ps->filter;
+    if (f->set_count >= CAPTURE_FILTER_MAX_SETS) {
+        return fail(ps, "too many address tests");
+    }
+    capture_filter_set_t *set = &f->sets[f->set_count];
+    set->first = f->mac_count;
+    set->count = 0;
+
+    bool list = accept(ps, "in");
+    if (list && !accept(ps, "{")) {
+        return fail(ps, "expected '{'");
+    }
+    do {
+        if (f->mac_count >= CONFIG_CAPTURE_FILTER_MAX_MACS) {
+            return fail(ps, "too many MAC addresses");
+        }
+        if (!parse_mac(ps, &f->macs[f->mac_count])) {
+            return false;
+        }
+        f->mac_count++;
+        set->count++;
+    } while (list && accept(ps, ","));
+    if (list && !accept(ps, "}")) {
+        return fail(ps, "expected '}'");
+    }
+
+    uint64_t *macs = &f->macs[set->first];
+    qsort(macs, set->count, sizeof(macs[0]), compare_keys);
+    size_t unique = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        if (unique == 0 || macs[unique - 1] != macs[i]) {
+            macs[unique++] = macs[i];
+        }
+    }
+    f->mac_count -= set->count - unique;
+    set->count = (uint8_t) unique;
+    *set_index = f->set_count++;
+    return true;
+}
+
+static bool parse_comparison(parser_t *ps, uint8_t op, int32_t min, int32_t max) {
+    uint8_t cmp = CMP_EQ;
+    for (uint8_t c = 0; c < sizeof(cmp_names) / sizeof(cmp_names[0]); c++) {
+        if (accept(ps, cmp_names[c])) {
+            cmp = c;
+            break;
+        }
+    }
+    int16_t value;
+    return parse_number(ps, min, max, &value) && emit(ps, op, cmp, value);
+}
+
+static bool parse_expr(parser_t *ps);
+
+static bool parse_primitive(parser_t *ps) {
+    for (uint8_t t = 0; t < sizeof(type_names) / sizeof(type_names[0]); t++) {
+        if (accept(ps, type_names[t])) {
+            return emit(ps, FILTER_OP_TYPE, 0, t);
+        }
+    }
+    for (uint8_t a = 0; a < sizeof(addr_names) / sizeof(addr_names[0]); a++) {
+        if (accept(ps, addr_names[a])) {
+            uint8_t set;
+            return parse_mac_set(ps, &set) && emit(ps, FILTER_OP_ADDR, a, set);
+        }
+    }
+    if (accept(ps, "subtype")) {
+        for (size_t s = 0; s < sizeof(mgmt_subtypes) / sizeof(mgmt_subtypes[0]); s++) {
+            if (accept(ps, mgmt_subtypes[s].name)) {                        // Named subtypes imply management type
+                return emit(ps, FILTER_OP_SUBTYPE, 1, (int16_t) (mgmt_subtypes[s].subtype << 2 | FC_TYPE_MGMT));
+            }
+        }
+        int16_t subtype;
+        return parse_number(ps, 0, 15, &subtype) && emit(ps, FILTER_OP_SUBTYPE, 0, subtype);
+    }
+    if (accept(ps, "rssi")) {
+        return parse_comparison(ps, FILTER_OP_RSSI, -128, 127);
+    }
+    if (accept(ps, "channel")) {
+        return parse_comparison(ps, FILTER_OP_CHANNEL, 0, 255);
+    }
+    if (accept(ps, "len")) {
+        return parse_comparison(ps, FILTER_OP_LEN, 0, 32767);
+    }
+    return fail(ps, ps->token[0] == '\0' ? "unexpected end of expression" : "unknown keyword");
+}
+
+static bool parse_factor(parser_t *ps) {
+    bool ok;
+    if (accept(ps, "not")) {                                                // Recursion is bounded by the nesting depth
+        ok = enter(ps) && parse_factor(ps) && emit(ps, FILTER_OP_NOT, 0, 0);
+    } else if (accept(ps, "(")) {
+        ok = enter(ps) && parse_expr(ps) && (accept(ps, ")") || fail(ps, "expected ')'"));
+    } else {
+        return parse_primitive(ps);
+    }
+    ps->depth--;
+    return ok;
+}
+
+static bool ends_term(const parser_t *ps) {
+    return ps->token[0] == '\0' || strcmp(ps->token, "or") == 0 || strcmp(ps->token, ")") == 0;
+}
+
+static bool parse_term(parser_t *ps) {
+    size_t first = ps->jump_count;
+    if (!parse_factor(ps)) {
+        return false;
+    }
+    while (!ends_term(ps)) {
+        accept(ps, "and");                                                  // Optional: "mgmt subtype beacon"
+        if (!emit_jump(ps, FILTER_OP_JF) || !parse_factor(ps)) {
+            return false;
+        }
+    }
+    patch_jumps(ps, first);
+    return true;
+}
+
+static bool parse_expr(parser_t *ps) {
+    size_t first = ps->jump_count;
+    if (!parse_term(ps)) {
+        return false;
+    }
+    while (accept(ps, "or")) {
+        if (!emit_jump(ps, FILTER_OP_JT) || !parse_term(ps)) {
+            return false;
+        }
+    }
+    patch_jumps(ps, first);
+    return true;
+}
+
+bool capture_filter_compile(capture_filter_t *filter, const char *expr, const char **error) {
+    static parser_t ps;                                                     // Compilation runs on the console task only
+    memset(filter, 0, sizeof(*filter));
+    ps = (parser_t) { .next = expr != NULL ? expr : "", .filter = filter };
+
+    lex(&ps);
+    if (ps.token[0] != '\0' && parse_expr(&ps) && ps.token[0] != '\0') {
+        fail(&ps, "unexpected input after expression");
+    }
+    if (error != NULL) {
+        *error = ps.error;
+    }
+    return ps.error == NULL;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file channel_hopper.c
+ * @brief Implements timer-driven adaptive channel hopping.
+ */
+#include "channel_hopper.h"
+
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "sniffer.h"
+#include "radio.h"
+#include "metrics.h"
+
+static const char *TAG = "channel_hopper";
+
+_Static_assert((CONFIG_CHANNEL_HOP_SEEN_BSSIDS & (CONFIG_CHANNEL_HOP_SEEN_BSSIDS - 1)) == 0,
+               "CONFIG_CHANNEL_HOP_SEEN_BSSIDS must be a power of two");
+
+static const uint8_t all_channels[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+
+static hop_scheduler_t scheduler;
+static portMUX_TYPE scheduler_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t hop_timer = NULL;
+static volatile bool hopping = false;
+static _Atomic uint8_t current_channel;
+
+static _Atomic uint32_t visit_frames;                                       // Frames seen during current visit
+static _Atomic uint32_t visit_new_bssids;                                   // New BSSIDs seen during current visit
+static int64_t started_us;
+static int64_t visit_started_us;
+static uint32_t last_discovery_ms;
+
+// Open-addressing set of seen BSSIDs, touched by the sniffer aggregate stage only. 0 marks an empty slot.
+static uint64_t seen_bssids[CONFIG_CHANNEL_HOP_SEEN_BSSIDS];
+static _Atomic uint32_t seen_count;
+
+static bool seen_insert(uint64_t key) {                                     // Returns true if key was not seen before
+    key |= 1ULL << 48;                                                      // Never collides with the empty marker
+    uint32_t slot = (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 40) & (CONFIG_CHANNEL_HOP_SEEN_BSSIDS - 1);
+    for (uint32_t probe = 0; probe < CONFIG_CHANNEL_HOP_SEEN_BSSIDS; probe++) {
+        uint64_t *entry = &seen_bssids[(slot + probe) & (CONFIG_CHANNEL_HOP_SEEN_BSSIDS - 1)];
+        if (*entry == key) {
+            return false;
+        }
+        if (*entry == 0) {
+            if (atomic_load_explicit(&seen_count, memory_order_relaxed) >= CONFIG_CHANNEL_HOP_SEEN_BSSIDS * 3 / 4) {
+                return false;                                               // Set full: stop counting discoveries
+            }
+            *entry = key;
+            atomic_fetch_add_explicit(&seen_count, 1, memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Sniffer batch handler counting frames and BSSID discoveries on the current channel.
+ */
+static void observe_batch(const wifictl_frame_t *const *frames, size_t count) {
+    uint8_t channel = atomic_load_explicit(&current_channel, memory_order_relaxed);
+    uint32_t seen = 0;
+    uint32_t discovered = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_frame_t *frame = frames[i];
+        if (frame->pkt.rx_ctrl.channel != channel) {                        // Queued before the last switch
+            continue;
+        }
+        seen++;
+        if (frame->event_id != SNIFFER_EVENT_CAPTURED_MGMT || frame->pkt.rx_ctrl.sig_len < 24) {
+            continue;
+        }
+        const uint8_t *payload = frame->pkt.payload;
+        uint8_t subtype = payload[0] >> 4;
+        if (subtype != 8 && subtype != 5) {                                 // Beacon or probe response
+            continue;
+        }
+        uint64_t bssid = 0;
+        for (int b = 0; b < 6; b++) {
+            bssid = (bssid << 8) | payload[16 + b];
+        }
+        discovered += seen_insert(bssid);
+    }
+    atomic_fetch_add_explicit(&visit_frames, seen, memory_order_relaxed);
+    atomic_fetch_add_explicit(&visit_new_bssids, discovered, memory_order_relaxed);
+}
+
+/**
+ * @brief esp_timer callback: closes current visit, switches channel and arms timer with the next dwell.
+ */
+static void hop_timer_callback(void *arg) {
+    if (!hopping) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t frames = atomic_exchange_explicit(&visit_frames, 0, memory_order_relaxed);
+    uint32_t discovered = atomic_exchange_explicit(&visit_new_bssids, 0, memory_order_relaxed);
+    uint32_t elapsed_ms = (uint32_t) ((now - visit_started_us) / 1000);
+
+    portENTER_CRITICAL(&scheduler_lock);
+    uint16_t dwell_ms = hop_scheduler_next(&scheduler, frames, discovered, elapsed_ms);
+    uint8_t channel = hop_scheduler_channel(&scheduler);
+    if (discovered > 0) {
+        last_discovery_ms = (uint32_t) ((now - started_us) / 1000);
+    }
+    portEXIT_CRITICAL(&scheduler_lock);
+
+    wifictl_radio_set_channel(channel);
+    METRIC_INC(METRIC_CHANNEL_SWITCHES);
+    atomic_store_explicit(&current_channel, channel, memory_order_relaxed);
+    visit_started_us = esp_timer_get_time();
+    esp_timer_start_once(hop_timer, (uint64_t) dwell_ms * 1000);
+}
+
+esp_err_t wifictl_channel_hop_start(const uint8_t *channels, size_t count, bool adaptive) {
+    if (hopping) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (channels == NULL) {
+        channels = all_channels;
+        count = sizeof(all_channels);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (channels[i] < 1 || channels[i] > 14) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (!hop_scheduler_init(&scheduler, channels, count, CONFIG_CHANNEL_HOP_MIN_DWELL_MS, CONFIG_CHANNEL_HOP_MAX_DWELL_MS, adaptive)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hop_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = hop_timer_callback,
+            .name = "channel_hop",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &hop_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (!wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, observe_batch)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(seen_bssids, 0, sizeof(seen_bssids));
+    atomic_store(&seen_count, 0);
+    atomic_store(&visit_frames, 0);
+    atomic_store(&visit_new_bssids, 0);
+    last_discovery_ms = 0;
+
+    uint8_t channel = hop_scheduler_channel(&scheduler);
+    wifictl_radio_set_channel(channel);
+    atomic_store(&current_channel, channel);
+    started_us = visit_started_us = esp_timer_get_time();
+    hopping = true;
+    ESP_LOGI(TAG, "Hopping over %u channels (%s)", (unsigned) count, adaptive ? "adaptive" : "round-robin");
+    return esp_timer_start_once(hop_timer, (uint64_t) hop_scheduler_dwell(&scheduler, 0) * 1000);
+}
+
+void wifictl_channel_hop_stop(void) {
+    if (!hopping) {
+        return;
+    }
+    hopping = false;
+    esp_timer_stop(hop_timer);
+    wifictl_sniffer_unregister_batch_handler(observe_batch);
+    ESP_LOGI(TAG, "Hopping stopped");
+}
+
+bool wifictl_channel_hop_active(void) {
+    return hopping;
+}
+
+void wifictl_channel_hop_get_stats(wifictl_channel_hop_stats_t *stats) {
+    portENTER_CRITICAL(&scheduler_lock);
+    stats->scheduler = scheduler;
+    stats->last_discovery_ms = last_discovery_ms;
+    portEXIT_CRITICAL(&scheduler_lock);
+    stats->unique_bssids = atomic_load_explicit(&seen_count, memory_order_relaxed);
+    stats->running_ms = hopping ? (uint32_t) ((esp_timer_get_time() - started_us) / 1000) : 0;
+}
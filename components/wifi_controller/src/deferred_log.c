@@ -0,0 +1,161 @@
+/**
+ * @file deferred_log.c
+ * @brief Implements per-core record rings and the formatter task.
+ */
+#include "deferred_log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+_Static_assert((CONFIG_DEFERRED_LOG_SLOTS & (CONFIG_DEFERRED_LOG_SLOTS - 1)) == 0,
+               "CONFIG_DEFERRED_LOG_SLOTS must be a power of two");
+
+#define BENCHMARK_TAG "dlog_bench"
+#define LINE_SIZE 160
+
+typedef struct {
+    _Atomic uint32_t seq;                                                   // Reserved index + 1 once the record is complete
+    const char *format;
+    const char *tag;
+    uint32_t timestamp_ms;
+    uint8_t level;
+    uint8_t nargs;
+    uintptr_t args[DEFERRED_LOG_MAX_ARGS];
+} log_slot_t;
+
+typedef struct {
+    _Atomic uint32_t head;                                                  // Next index to reserve
+    _Atomic uint32_t tail;                                                  // Next index to format, written by the formatter only
+    _Atomic uint32_t written;
+    _Atomic uint32_t dropped;
+    uint32_t formatted;
+    log_slot_t slots[CONFIG_DEFERRED_LOG_SLOTS];
+} log_ring_t;
+
+static log_ring_t rings[portNUM_PROCESSORS];
+static TaskHandle_t formatter_task = NULL;
+
+void deferred_log_write(uint8_t level, const char *tag, const char *format, unsigned nargs, ...) {
+    log_ring_t *ring = &rings[xPortGetCoreID()];                            // Any ring is safe if the task migrates meanwhile
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    do {
+        if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= CONFIG_DEFERRED_LOG_SLOTS) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &head, head + 1, memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    log_slot_t *slot = &ring->slots[head & (CONFIG_DEFERRED_LOG_SLOTS - 1)];
+    slot->format = format;
+    slot->tag = tag;
+    slot->timestamp_ms = esp_log_timestamp();
+    slot->level = level;
+    slot->nargs = nargs > DEFERRED_LOG_MAX_ARGS ? DEFERRED_LOG_MAX_ARGS : nargs;
+    va_list args;
+    va_start(args, nargs);
+    for (unsigned i = 0; i < slot->nargs; i++) {
+        slot->args[i] = va_arg(args, uintptr_t);
+    }
+    va_end(args);
+    atomic_store_explicit(&slot->seq, head + 1, memory_order_release);      // Publish
+    atomic_fetch_add_explicit(&ring->written, 1, memory_order_relaxed);
+}
+
+static void format_record(const log_slot_t *record) {
+    static const char letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    if (record->level > esp_log_level_get(record->tag)) {
+        return;
+    }
+    uintptr_t a[DEFERRED_LOG_MAX_ARGS] = { 0 };
+    memcpy(a, record->args, record->nargs * sizeof(uintptr_t));
+    char line[LINE_SIZE];
+    snprintf(line, sizeof(line), record->format, a[0], a[1], a[2], a[3]);   // Unused arguments are ignored
+    esp_log_write(record->level, record->tag, "%c (%lu) %s: %s\n", letters[record->level < 6 ? record->level : 0],
+                  (unsigned long) record->timestamp_ms, record->tag, line);
+}
+
+/**
+ * @brief Formats every complete record of a ring. Stops at a record still being written.
+ */
+static void drain(log_ring_t *ring) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        log_slot_t *slot = &ring->slots[tail & (CONFIG_DEFERRED_LOG_SLOTS - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != tail + 1) {
+            return;
+        }
+        log_slot_t record = *slot;                                          // Copy out, then free the slot
+        atomic_store_explicit(&ring->tail, ++tail, memory_order_release);
+        ring->formatted++;
+        format_record(&record);
+    }
+}
+
+static void formatter(void *arg) {
+    for (;;) {
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            drain(&rings[core]);
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DEFERRED_LOG_FLUSH_MS));
+    }
+}
+
+esp_err_t deferred_log_start(void) {
+    if (formatter_task != NULL) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(formatter, "deferred_log", 3072, NULL, 1, &formatter_task) != pdPASS) {
+        formatter_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void deferred_log_get_stats(deferred_log_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        stats->written += atomic_load_explicit(&rings[core].written, memory_order_relaxed);
+        stats->dropped += atomic_load_explicit(&rings[core].dropped, memory_order_relaxed);
+        stats->formatted += rings[core].formatted;
+    }
+}
+
+static int discard_vprintf(const char *format, va_list args) {
+    char line[LINE_SIZE];
+    return vsnprintf(line, sizeof(line), format, args);                     // Format as the UART path would, then drop
+}
+
+void deferred_log_benchmark(unsigned iterations, uint32_t *deferred_ns, uint32_t *direct_ns) {
+    esp_log_level_t saved_level = esp_log_level_get(BENCHMARK_TAG);
+    uint64_t deferred_us = 0;
+    unsigned chunk = CONFIG_DEFERRED_LOG_SLOTS / 2;                         // Measure stores, not the drop path
+    for (unsigned done = 0; done < iterations; done += chunk) {
+        unsigned n = iterations - done < chunk ? iterations - done : chunk;
+        esp_log_level_set(BENCHMARK_TAG, ESP_LOG_NONE);                     // Formatter discards the records
+        int64_t started = esp_timer_get_time();
+        for (unsigned i = 0; i < n; i++) {
+            DLOGI(BENCHMARK_TAG, "Frame %u on channel %u, rssi %d", i, 6u, -42);
+        }
+        deferred_us += esp_timer_get_time() - started;
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DEFERRED_LOG_FLUSH_MS * 2));       // Let the formatter drain
+    }
+
+    esp_log_level_set(BENCHMARK_TAG, ESP_LOG_INFO);
+    vprintf_like_t saved_vprintf = esp_log_set_vprintf(discard_vprintf);
+    int64_t started = esp_timer_get_time();
+    for (unsigned i = 0; i < iterations; i++) {
+        ESP_LOGI(BENCHMARK_TAG, "Frame %u on channel %u, rssi %d", i, 6u, -42);
+    }
+    uint64_t direct_us = esp_timer_get_time() - started;
+    esp_log_set_vprintf(saved_vprintf);
+    esp_log_level_set(BENCHMARK_TAG, saved_level);
+
+    *deferred_ns = iterations ? (uint32_t) (deferred_us * 1000 / iterations) : 0;
+    *direct_ns = iterations ? (uint32_t) (direct_us * 1000 / iterations) : 0;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file frame_codec.c
+ * @brief Implements LZ4 block compression with a preset dictionary.
+ */
+#include "frame_codec.h"
+
+#include <string.h>
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5                                                     // LZ4: block ends with at least 5 literals
+#define MF_LIMIT 12                                                         // LZ4: last match starts 12 bytes before the end
+#define RUN_MASK 15
+
+static inline uint32_t read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline unsigned hash_sequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - FRAME_CODEC_HASH_BITS);
+}
+
+/**
+ * @brief Writes the extension bytes of a length whose token nibble is saturated.
+ */
+static uint8_t *write_length(uint8_t *op, const uint8_t *end, size_t len) {
+    for (; len >= 255; len -= 255) {
+        if (op >= end) {
+            return NULL;
+        }
+        *op++ = 255;
+    }
+    if (op >= end) {
+        return NULL;
+    }
+    *op++ = (uint8_t) len;
+    return op;
+}
+
+/**
+ * @brief Writes token, literals and, unless it is the last sequence, offset and match length.
+ */
+static uint8_t *write_sequence(uint8_t *op, const uint8_t *end, const uint8_t *literals, size_t literal_len,
+                               size_t offset, size_t match_len) {
+    if (op >= end) {
+        return NULL;
+    }
+    uint8_t *token = op++;
+    *token = (uint8_t) ((literal_len < RUN_MASK ? literal_len : RUN_MASK) << 4);
+    if (literal_len >= RUN_MASK && (op = write_length(op, end, literal_len - RUN_MASK)) == NULL) {
+        return NULL;
+    }
+    if ((size_t) (end - op) < literal_len) {
+        return NULL;
+    }
+    memcpy(op, literals, literal_len);
+    op += literal_len;
+    if (match_len == 0) {
+        return op;
+    }
+
+    if (end - op < 2) {
+        return NULL;
+    }
+    *op++ = (uint8_t) offset;
+    *op++ = (uint8_t) (offset >> 8);
+    size_t code = match_len - MIN_MATCH;
+    *token |= code < RUN_MASK ? code : RUN_MASK;
+    if (code >= RUN_MASK) {
+        op = write_length(op, end, code - RUN_MASK);
+    }
+    return op;
+}
+
+bool frame_codec_init(frame_codec_t *codec, uint8_t *window, size_t window_size, const uint8_t *dict, size_t dict_len) {
+    if (window_size > FRAME_CODEC_MAX_WINDOW || dict_len >= window_size) {
+        return false;
+    }
+    memset(codec, 0, sizeof(*codec));
+    codec->window = window;
+    codec->dict_len = dict_len;
+    codec->capacity = window_size - dict_len;
+    if (dict_len > 0) {
+        memcpy(window, dict, dict_len);
+    }
+    for (size_t pos = 0; pos + MIN_MATCH <= dict_len; pos++) {              // Later positions win, like during compression
+        codec->dict_table[hash_sequence(read32(&window[pos]))] = (uint16_t) pos;
+    }
+    return true;
+}
+
+size_t frame_codec_compress(frame_codec_t *codec, size_t len, uint8_t *dst, size_t capacity) {
+    if (len > codec->capacity) {
+        return 0;
+    }
+    const uint8_t *base = codec->window;
+    const size_t start = codec->dict_len;
+    const size_t end = start + len;
+    const uint8_t *dst_end = dst + capacity;
+    uint8_t *op = dst;
+    size_t anchor = start;
+
+    if (len >= MF_LIMIT + 1) {
+        const size_t match_start_limit = end - MF_LIMIT;
+        const size_t match_end_limit = end - LAST_LITERALS;
+        size_t ip = start;
+        while (ip <= match_start_limit) {
+            uint32_t sequence = read32(&base[ip]);
+            unsigned h = hash_sequence(sequence);
+            size_t candidate = codec->table[h];
+            codec->table[h] = (uint16_t) ip;
+            if (candidate < start || candidate >= ip || read32(&base[candidate]) != sequence) {  // Stale or no input match
+                candidate = codec->dict_table[h];
+                if (candidate + MIN_MATCH > start || read32(&base[candidate]) != sequence) {
+                    ip++;
+                    continue;
+                }
+            }
+
+            size_t match_len = MIN_MATCH;
+            while (ip + match_len < match_end_limit && base[candidate + match_len] == base[ip + match_len]) {
+                match_len++;
+            }
+            op = write_sequence(op, dst_end, &base[anchor], ip - anchor, ip - candidate, match_len);
+            if (op == NULL) {
+                return 0;
+            }
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+    op = write_sequence(op, dst_end, &base[anchor], end - anchor, 0, 0);
+    return op == NULL ? 0 : (size_t) (op - dst);
+}
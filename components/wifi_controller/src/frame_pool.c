@@ -0,0 +1,128 @@
+/**
+ * @file frame_pool.c
+ * @brief Implements size-class frame pool over static arenas.
+ */
+#include "frame_pool.h"
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define ARENA_ALIGN 4
+#define ALIGN_UP(x) (((x) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+#define SMALL_STRIDE  ALIGN_UP(CONFIG_FRAME_POOL_SMALL_SIZE)
+#define MEDIUM_STRIDE ALIGN_UP(CONFIG_FRAME_POOL_MEDIUM_SIZE)
+#define LARGE_STRIDE  ALIGN_UP(CONFIG_FRAME_POOL_LARGE_SIZE)
+
+_Static_assert(CONFIG_FRAME_POOL_SMALL_SIZE < CONFIG_FRAME_POOL_MEDIUM_SIZE &&
+               CONFIG_FRAME_POOL_MEDIUM_SIZE < CONFIG_FRAME_POOL_LARGE_SIZE,
+               "frame pool size classes must be strictly increasing");
+
+static uint8_t small_arena[CONFIG_FRAME_POOL_SMALL_COUNT * SMALL_STRIDE] __attribute__((aligned(ARENA_ALIGN)));
+static uint8_t medium_arena[CONFIG_FRAME_POOL_MEDIUM_COUNT * MEDIUM_STRIDE] __attribute__((aligned(ARENA_ALIGN)));
+static uint8_t large_arena[CONFIG_FRAME_POOL_LARGE_COUNT * LARGE_STRIDE] __attribute__((aligned(ARENA_ALIGN)));
+
+static uint16_t small_free[CONFIG_FRAME_POOL_SMALL_COUNT];
+static uint16_t medium_free[CONFIG_FRAME_POOL_MEDIUM_COUNT];
+static uint16_t large_free[CONFIG_FRAME_POOL_LARGE_COUNT];
+
+typedef struct {
+    uint8_t *arena;
+    uint16_t *free_stack;                                                   // Indices of free buffers
+    uint16_t stride;
+    uint16_t free_top;                                                      // Number of entries in free_stack
+    frame_pool_class_stats_t stats;
+} pool_class_t;
+
+static pool_class_t classes[FRAME_POOL_CLASS_COUNT] = {
+    [FRAME_POOL_CLASS_SMALL]  = { small_arena,  small_free,  SMALL_STRIDE,  0, { .buffer_size = CONFIG_FRAME_POOL_SMALL_SIZE,  .capacity = CONFIG_FRAME_POOL_SMALL_COUNT  } },
+    [FRAME_POOL_CLASS_MEDIUM] = { medium_arena, medium_free, MEDIUM_STRIDE, 0, { .buffer_size = CONFIG_FRAME_POOL_MEDIUM_SIZE, .capacity = CONFIG_FRAME_POOL_MEDIUM_COUNT } },
+    [FRAME_POOL_CLASS_LARGE]  = { large_arena,  large_free,  LARGE_STRIDE,  0, { .buffer_size = CONFIG_FRAME_POOL_LARGE_SIZE,  .capacity = CONFIG_FRAME_POOL_LARGE_COUNT  } },
+};
+
+static uint32_t oversize;
+static bool initialized = false;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void pool_init_locked(void) {                                        // Fill free stacks on first use
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        pool_class_t *pc = &classes[c];
+        for (uint16_t i = 0; i < pc->stats.capacity; i++) {
+            pc->free_stack[i] = pc->stats.capacity - 1 - i;                 // Lowest index is handed out first
+        }
+        pc->free_top = pc->stats.capacity;
+    }
+    initialized = true;
+}
+
+void *frame_pool_alloc(size_t size) {
+    void *buf = NULL;
+
+    portENTER_CRITICAL_SAFE(&pool_lock);
+    if (!initialized) {
+        pool_init_locked();
+    }
+    if (size > CONFIG_FRAME_POOL_LARGE_SIZE) {
+        oversize++;
+        portEXIT_CRITICAL_SAFE(&pool_lock);
+        return NULL;
+    }
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        pool_class_t *pc = &classes[c];
+        if (size > pc->stats.buffer_size) {
+            continue;
+        }
+        if (pc->free_top == 0) {                                            // Fitting class empty, try next one up
+            pc->stats.exhausted++;
+            continue;
+        }
+        uint16_t index = pc->free_stack[--pc->free_top];
+        buf = pc->arena + (size_t) index * pc->stride;
+        pc->stats.allocated++;
+        if (++pc->stats.in_use > pc->stats.high_water) {
+            pc->stats.high_water = pc->stats.in_use;
+        }
+        break;
+    }
+    portEXIT_CRITICAL_SAFE(&pool_lock);
+    return buf;
+}
+
+void frame_pool_free(void *buf) {
+    if (buf == NULL) {
+        return;
+    }
+    uint8_t *p = (uint8_t *) buf;
+
+    portENTER_CRITICAL_SAFE(&pool_lock);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        pool_class_t *pc = &classes[c];
+        uint8_t *end = pc->arena + (size_t) pc->stats.capacity * pc->stride;
+        if (p >= pc->arena && p < end) {                                    // Class is derived from the arena address
+            pc->free_stack[pc->free_top++] = (uint16_t) ((p - pc->arena) / pc->stride);
+            pc->stats.in_use--;
+            break;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&pool_lock);
+}
+
+void frame_pool_get_stats(frame_pool_stats_t *stats) {
+    portENTER_CRITICAL_SAFE(&pool_lock);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        stats->classes[c] = classes[c].stats;
+    }
+    stats->oversize = oversize;
+    portEXIT_CRITICAL_SAFE(&pool_lock);
+}
+
+void frame_pool_reset_stats(void) {
+    portENTER_CRITICAL_SAFE(&pool_lock);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        classes[c].stats.high_water = classes[c].stats.in_use;
+        classes[c].stats.allocated = 0;
+        classes[c].stats.exhausted = 0;
+    }
+    oversize = 0;
+    portEXIT_CRITICAL_SAFE(&pool_lock);
+}
@@ -0,0 +1,45 @@
+/**
+ * @file frame_ring.c
+ * @brief Implements lock-free SPSC ring.
+ */
+#include "frame_ring.h"
+
+bool frame_ring_init(frame_ring_t *ring, void **storage, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {               // Capacity must be a power of two
+        return false;
+    }
+    ring->slots = storage;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return true;
+}
+
+bool frame_ring_push(frame_ring_t *ring, void *item) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask) {                                        // Ring is full
+        return false;
+    }
+    ring->slots[head & ring->mask] = item;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);   // Publish slot to consumer
+    return true;
+}
+
+size_t frame_ring_pop_batch(frame_ring_t *ring, void **out, size_t max) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t available = head - tail;
+    size_t n = available < max ? available : max;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ring->slots[(tail + i) & ring->mask];
+    }
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);   // Hand slots back to producer
+    return n;
+}
+
+uint32_t frame_ring_count(const frame_ring_t *ring) {
+    uint32_t head = atomic_load_explicit(&((frame_ring_t *) ring)->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&((frame_ring_t *) ring)->tail, memory_order_acquire);
+    return head - tail;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file hop_scheduler.c
+ * @brief Implements adaptive dwell-time scheduler.
+ */
+#include "hop_scheduler.h"
+
+#include <string.h>
+
+#define Q8_ONE 256
+#define EWMA_SHIFT 2                                                        // alpha = 1/4
+
+static void ewma_update(uint32_t *ewma, uint32_t sample) {
+    if (sample >= *ewma) {
+        *ewma += (sample - *ewma) >> EWMA_SHIFT;
+    } else {
+        *ewma -= (*ewma - sample) >> EWMA_SHIFT;
+    }
+}
+
+bool hop_scheduler_init(hop_scheduler_t *sched, const uint8_t *channels, size_t count,
+                        uint16_t min_dwell_ms, uint16_t max_dwell_ms, bool adaptive) {
+    if (count == 0 || count > HOP_MAX_CHANNELS || min_dwell_ms == 0 || max_dwell_ms < min_dwell_ms) {
+        return false;
+    }
+    memset(sched, 0, sizeof(*sched));
+    for (size_t i = 0; i < count; i++) {
+        sched->channels[i].channel = channels[i];
+    }
+    sched->count = (uint8_t) count;
+    sched->min_dwell_ms = min_dwell_ms;
+    sched->max_dwell_ms = max_dwell_ms;
+    sched->adaptive = adaptive;
+    return true;
+}
+
+uint8_t hop_scheduler_channel(const hop_scheduler_t *sched) {
+    return sched->channels[sched->current].channel;
+}
+
+uint16_t hop_scheduler_dwell(const hop_scheduler_t *sched, size_t index) {
+    const hop_channel_state_t *ch = &sched->channels[index];
+    uint32_t span = sched->max_dwell_ms - sched->min_dwell_ms;
+
+    if (!sched->adaptive) {
+        return sched->min_dwell_ms;
+    }
+    if (ch->visits == 0) {                                                  // Unknown channel: middle of the range
+        return sched->min_dwell_ms + span / 2;
+    }
+
+    // Both scores are in [0, 256): x / (x + half) saturates smoothly instead of needing a global maximum
+    uint32_t activity = (uint32_t) (((uint64_t) ch->rate_ewma_q8 * Q8_ONE) / (ch->rate_ewma_q8 + HOP_RATE_HALF_FPS * Q8_ONE));
+    uint32_t discovery = (uint32_t) (((uint64_t) ch->new_ewma_q8 * Q8_ONE) / (ch->new_ewma_q8 + Q8_ONE));
+    uint32_t score = activity > discovery ? activity : discovery;
+
+    return (uint16_t) (sched->min_dwell_ms + (span * score) / Q8_ONE);
+}
+
+uint16_t hop_scheduler_next(hop_scheduler_t *sched, uint32_t frames, uint32_t new_bssids, uint32_t elapsed_ms) {
+    hop_channel_state_t *ch = &sched->channels[sched->current];
+
+    if (elapsed_ms == 0) {
+        elapsed_ms = 1;
+    }
+    uint32_t rate_q8 = (uint32_t) (((uint64_t) frames * 1000 * Q8_ONE) / elapsed_ms);
+    uint32_t new_q8 = new_bssids * Q8_ONE;
+    if (ch->visits == 0) {                                                  // Seed EWMAs with the first sample
+        ch->rate_ewma_q8 = rate_q8;
+        ch->new_ewma_q8 = new_q8;
+    } else {
+        ewma_update(&ch->rate_ewma_q8, rate_q8);
+        ewma_update(&ch->new_ewma_q8, new_q8);
+    }
+    ch->visits++;
+    ch->frames += frames;
+    ch->new_bssids += new_bssids;
+    ch->dwell_total_ms += elapsed_ms;
+
+    sched->current = (uint8_t) ((sched->current + 1) % sched->count);
+    return hop_scheduler_dwell(sched, sched->current);
+}
@@ -0,0 +1,110 @@
+/**
+ * @file metrics.c
+ * @brief Implements aggregation of per-core metrics.
+ */
+#include "metrics.h"
+
+#include <string.h>
+
+metrics_core_t metrics_cores[portNUM_PROCESSORS];
+
+static const char *const counter_names[METRIC_COUNTER_COUNT] = {
+    [METRIC_FRAMES_DATA] = "frames_data",
+    [METRIC_FRAMES_MGMT] = "frames_mgmt",
+    [METRIC_FRAMES_CTRL] = "frames_ctrl",
+    [METRIC_FRAMES_FILTERED] = "frames_filtered",
+    [METRIC_POOL_EXHAUSTED] = "pool_exhausted",
+    [METRIC_RING_FULL] = "ring_full",
+    [METRIC_EVENT_POST_FAILED] = "event_post_failed",
+    [METRIC_FANOUT_DROPPED] = "fanout_dropped",
+    [METRIC_BATCHES] = "batches",
+    [METRIC_SCANS] = "scans",
+    [METRIC_CHANNEL_SWITCHES] = "channel_switches",
+    [METRIC_UART_BYTES] = "uart_bytes",
+};
+
+static const struct {
+    const char *name;
+    const char *unit;
+} hist_info[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_CAPTURE] = { "capture", "us" },
+    [METRIC_HIST_QUEUE_WAIT] = { "queue_wait", "us" },
+    [METRIC_HIST_PARSE] = { "parse", "us" },
+    [METRIC_HIST_AGGREGATE] = { "aggregate", "us" },
+    [METRIC_HIST_BACKLOG] = { "backlog", "frames" },
+    [METRIC_HIST_SCAN] = { "scan", "ms" },
+    [METRIC_HIST_UART] = { "uart_write", "us" },
+};
+
+bool metrics_enabled(void) {
+#ifdef CONFIG_METRICS_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+void metrics_snapshot(metrics_snapshot_t *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        metrics_core_t *c = &metrics_cores[core];
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            snapshot->counters[i] += atomic_load_explicit(&c->counters[i], memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+            metrics_hist_snapshot_t *hist = &snapshot->hists[h];
+            for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+                uint32_t n = atomic_load_explicit(&c->buckets[h][b], memory_order_relaxed);
+                hist->buckets[b] += n;
+                hist->count += n;
+            }
+            uint32_t max = atomic_load_explicit(&c->max[h], memory_order_relaxed);
+            if (max > hist->max) {
+                hist->max = max;
+            }
+        }
+    }
+}
+
+void metrics_reset(void) {
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        metrics_core_t *c = &metrics_cores[core];
+        for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+            atomic_store_explicit(&c->counters[i], 0, memory_order_relaxed);
+        }
+        for (int h = 0; h < METRIC_HIST_COUNT; h++) {
+            for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+                atomic_store_explicit(&c->buckets[h][b], 0, memory_order_relaxed);
+            }
+            atomic_store_explicit(&c->max[h], 0, memory_order_relaxed);
+        }
+    }
+}
+
+const char *metrics_counter_name(metric_counter_t counter) {
+    return counter < METRIC_COUNTER_COUNT ? counter_names[counter] : "?";
+}
+
+const char *metrics_hist_name(metric_hist_t hist) {
+    return hist < METRIC_HIST_COUNT ? hist_info[hist].name : "?";
+}
+
+const char *metrics_hist_unit(metric_hist_t hist) {
+    return hist < METRIC_HIST_COUNT ? hist_info[hist].unit : "";
+}
+
+uint32_t metrics_hist_percentile(const metrics_hist_snapshot_t *hist, unsigned percent) {
+    if (hist->count == 0) {
+        return 0;
+    }
+    uint64_t rank = ((uint64_t) hist->count * percent + 99) / 100;          // 1-based rank of the percentile sample
+    uint64_t seen = 0;
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            uint32_t upper = b == 0 ? 0 : (uint32_t) ((1ULL << b) - 1);
+            return b == METRICS_HIST_BUCKETS - 1 || upper > hist->max ? hist->max : upper;
+        }
+    }
+    return hist->max;
+}
@@ -0,0 +1,474 @@
+/**
+ * @file pcap_export.c
+ * @brief Implements PCAP streaming of sniffer batches over UART.
+ */
+#include "pcap_export.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sniffer.h"
+#include "metrics.h"
+#include "beacon_dedup.h"
+#include "frame_codec.h"
+
+static const char *TAG = "pcap_export";
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_SNAPLEN 65535
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+#define RADIOTAP_TSFT          (1u << 0)
+#define RADIOTAP_FLAGS         (1u << 1)
+#define RADIOTAP_RATE          (1u << 2)
+#define RADIOTAP_CHANNEL       (1u << 3)
+#define RADIOTAP_DBM_ANTSIGNAL (1u << 5)
+#define RADIOTAP_DBM_ANTNOISE  (1u << 6)
+#define RADIOTAP_MCS           (1u << 19)
+#define RADIOTAP_VENDOR_NS     (1u << 30)
+#define RADIOTAP_EXT           (1u << 31)
+
+#define RADIOTAP_F_SHORTPRE 0x02
+#define RADIOTAP_F_FCS      0x10
+#define RADIOTAP_CHAN_CCK   0x0020
+#define RADIOTAP_CHAN_OFDM  0x0040
+#define RADIOTAP_CHAN_2GHZ  0x0080
+#define RADIOTAP_MCS_HAVE_BW  0x01
+#define RADIOTAP_MCS_HAVE_MCS 0x02
+#define RADIOTAP_MCS_HAVE_GI  0x04
+#define RADIOTAP_MCS_BW_40    0x01
+#define RADIOTAP_MCS_SGI      0x04
+
+#define SIG_MODE_HT 1
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} pcap_global_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} pcap_record_hdr_t;
+
+/**
+ * @brief Radiotap header with fixed field set. Field order and padding follow radiotap alignment rules.
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t it_version;
+    uint8_t it_pad;
+    uint16_t it_len;
+    uint32_t it_present[2];                                                 // Default namespace, then vendor namespace
+    uint32_t pad_tsft;                                                      // TSFT is 8-byte aligned
+    uint64_t tsft;
+    uint8_t flags;
+    uint8_t rate;                                                           // 500 kbps units, 0 for HT
+    uint16_t channel_freq;
+    uint16_t channel_flags;
+    int8_t antsignal;
+    int8_t antnoise;
+    uint8_t mcs_known;
+    uint8_t mcs_flags;
+    uint8_t mcs_index;
+    uint8_t pad_vendor;                                                     // Vendor namespace is 2-byte aligned
+    uint8_t vendor_oui[3];
+    uint8_t vendor_sub_ns;
+    uint16_t vendor_skip_len;
+    uint32_t seq;                                                           // Vendor data: capture sequence number
+} radiotap_hdr_t;
+
+_Static_assert(sizeof(radiotap_hdr_t) == 46, "unexpected radiotap header layout");
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;                                                         // PCAP_EXPORT_COMPACT_MAGIC
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t dict_len;                                                      // Dictionary follows, then the PCAP global header
+} compact_stream_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;                                                           // wifictl_pcap_compact_type_t
+    uint8_t reserved;
+    uint16_t len;                                                           // Length of the record body
+} compact_record_hdr_t;
+
+/**
+ * @brief Compression dictionary of compact mode, least frequent patterns first. A radiotap header template is appended at start.
+ */
+static const uint8_t dictionary_patterns[] = {
+    0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a, 0x00, 0x01, 0x10, 0x10, 0x44, 0x00, 0x01, 0x02,  // WPS element body
+    0xdd, 0x07, 0x00, 0x50, 0xf2, 0x02, 0x00, 0x01, 0x00,                   // WMM information element
+    0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x08, 0x06,                         // LLC/SNAP: ARP, IPv6, EAPOL, IPv4
+    0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x86, 0xdd,
+    0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e,
+    0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00, 0x45, 0x00,
+    0x40, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,             // Probe request to broadcast, 11b rates
+    0x01, 0x08, 0x02, 0x04, 0x0b, 0x16, 0x0c, 0x12, 0x18, 0x24,
+    0xdd, 0x18, 0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x80, 0x00, 0x03, 0xa4, 0x00, 0x00, 0x27, 0xa4,  // WMM parameter element
+    0x00, 0x00, 0x42, 0x43, 0x5e, 0x00, 0x62, 0x32, 0x2f, 0x00,
+    0x2d, 0x1a, 0xef, 0x19, 0x1b, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // HT capabilities
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x3d, 0x16, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // HT operation
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x7f, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,             // Extended capabilities
+    0x30, 0x14, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04,  // RSN: CCMP, PSK
+    0x01, 0x00, 0x00, 0x0f, 0xac, 0x02, 0x0c, 0x00,
+    0x01, 0x08, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24, 0x03, 0x01,  // Rates, DS parameter, TIM, ERP, extended rates
+    0x06, 0x05, 0x04, 0x00, 0x01, 0x00, 0x00, 0x2a, 0x01, 0x00, 0x32, 0x04, 0x30, 0x48, 0x60, 0x6c,
+    0x88, 0x41, 0x2c, 0x00, 0x08, 0x42, 0x00, 0x00, 0x88, 0x42, 0x2c, 0x00,  // QoS data and data frame controls
+    0x64, 0x00, 0x11, 0x04, 0x00,                                           // Beacon interval 100 TU, capability, SSID tag
+    0x80, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,             // Beacon to broadcast
+};
+
+/**
+ * @brief State of compact mode, allocated on first use.
+ */
+typedef struct {
+    beacon_dedup_t dedup;
+    frame_codec_t codec;
+    uint8_t dictionary[sizeof(dictionary_patterns) + sizeof(radiotap_hdr_t)];
+    uint8_t window[sizeof(dictionary_patterns) + sizeof(radiotap_hdr_t) + CONFIG_PCAP_EXPORT_BUFFER_SIZE];
+} compact_state_t;
+
+// Legacy rate index from rx_ctrl.rate to 500 kbps units (indexes 5-7 are short preamble)
+static const uint8_t legacy_rates[16] = { 2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18 };
+
+static uint8_t staging[CONFIG_PCAP_EXPORT_BUFFER_SIZE];
+static size_t staged = 0;
+static uart_port_t export_port;
+static uint32_t saved_baud_rate = 0;
+static esp_log_level_t saved_log_level = ESP_LOG_INFO;
+static bool console_muted = false;                                          // Streaming on the console UART
+static _Atomic bool streaming = false;
+static _Atomic bool batch_running = false;                                  // export_batch is between its streaming check and its last write
+static bool compact = false;
+static compact_state_t *compact_state = NULL;
+
+static uint32_t last_timestamp = 0;                                         // For extending the 32-bit rx_ctrl timestamp
+static uint64_t timestamp_high = 0;
+
+static wifictl_pcap_stats_t stats;                                          // Written by the aggregate stage while streaming
+static wifictl_pcap_stats_t published_stats;                                // Copy for readers, updated after every batch
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void publish_stats(void) {
+    portENTER_CRITICAL(&stats_lock);
+    published_stats = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+static void flush_staging(void) {
+    if (staged == 0) {
+        return;
+    }
+    uint32_t started_us = METRIC_NOW_US();
+    uart_write_bytes(export_port, staging, staged);
+    METRIC_SINCE_US(METRIC_HIST_UART, started_us);
+    METRIC_ADD(METRIC_UART_BYTES, staged);
+    stats.bytes += staged;
+    staged = 0;
+}
+
+static uint64_t extend_timestamp(uint32_t timestamp) {
+    if (timestamp < last_timestamp) {                                       // 32-bit microsecond counter wrapped
+        timestamp_high += 1ULL << 32;
+    }
+    last_timestamp = timestamp;
+    return timestamp_high | timestamp;
+}
+
+static void fill_radiotap(radiotap_hdr_t *rt, const wifictl_frame_t *frame, uint64_t tsft) {
+    static const uint8_t oui[3] = PCAP_EXPORT_VENDOR_OUI;
+    const wifi_pkt_rx_ctrl_t *rx = &frame->pkt.rx_ctrl;
+    bool ht = rx->sig_mode == SIG_MODE_HT;
+
+    memset(rt, 0, sizeof(*rt));
+    rt->it_len = sizeof(*rt);
+    rt->it_present[0] = RADIOTAP_TSFT | RADIOTAP_FLAGS | RADIOTAP_RATE | RADIOTAP_CHANNEL | RADIOTAP_DBM_ANTSIGNAL |
+                        RADIOTAP_DBM_ANTNOISE | RADIOTAP_MCS | RADIOTAP_VENDOR_NS | RADIOTAP_EXT;
+    rt->it_present[1] = 0;                                                  // No standard fields in vendor namespace
+    rt->tsft = tsft;
+    rt->flags = RADIOTAP_F_FCS;                                             // sig_len includes FCS
+    rt->channel_freq = rx->channel == 14 ? 2484 : 2407 + 5 * rx->channel;
+    rt->channel_flags = RADIOTAP_CHAN_2GHZ;
+    if (ht) {
+        rt->channel_flags |= RADIOTAP_CHAN_OFDM;
+        rt->mcs_known = RADIOTAP_MCS_HAVE_BW | RADIOTAP_MCS_HAVE_MCS | RADIOTAP_MCS_HAVE_GI;
+        rt->mcs_flags = (rx->cwb ? RADIOTAP_MCS_BW_40 : 0) | (rx->sgi ? RADIOTAP_MCS_SGI : 0);
+        rt->mcs_index = rx->mcs;
+    } else {
+        uint8_t rate = rx->rate & 0x0f;
+        rt->rate = legacy_rates[rate];
+        rt->channel_flags |= rate < 8 ? RADIOTAP_CHAN_CCK : RADIOTAP_CHAN_OFDM;
+        if (rate >= 5 && rate <= 7) {
+            rt->flags |= RADIOTAP_F_SHORTPRE;
+        }
+    }
+    rt->antsignal = rx->rssi;
+    rt->antnoise = rx->noise_floor;
+    memcpy(rt->vendor_oui, oui, sizeof(oui));
+    rt->vendor_skip_len = sizeof(rt->seq);
+    rt->seq = frame->seq;
+}
+
+static void stage_summary(const beacon_summary_t *summary, void *ctx) {
+    compact_record_hdr_t header = {
+        .type = PCAP_COMPACT_BEACON_SUMMARY,
+        .len = sizeof(*summary),
+    };
+    if (staged + sizeof(header) + sizeof(*summary) > sizeof(staging)) {
+        flush_staging();
+    }
+    memcpy(&staging[staged], &header, sizeof(header));
+    memcpy(&staging[staged + sizeof(header)], summary, sizeof(*summary));
+    staged += sizeof(header) + sizeof(*summary);
+    stats.summaries++;
+}
+
+/**
+ * @brief Stages a compact record. Radiotap header and frame are built behind the dictionary and compressed
+ *        straight into the staging buffer; records that do not shrink are staged as they are.
+ */
+static void stage_compact(const wifictl_frame_t *frame, const pcap_record_hdr_t *record, uint64_t tsft) {
+    uint32_t frame_len = frame->pkt.rx_ctrl.sig_len;
+    size_t input_len = sizeof(radiotap_hdr_t) + frame_len;
+    uint8_t *input = frame_codec_input(&compact_state->codec);
+    fill_radiotap((radiotap_hdr_t *) input, frame, tsft);
+    memcpy(input + sizeof(radiotap_hdr_t), frame->pkt.payload, frame_len);
+
+    compact_record_hdr_t header = { .type = PCAP_COMPACT_RECORD_LZ4 };
+    uint8_t *body = &staging[staged + sizeof(header)];
+    memcpy(body, record, sizeof(*record));
+    size_t len = frame_codec_compress(&compact_state->codec, input_len, body + sizeof(*record), input_len - 1);
+    if (len == 0) {
+        header.type = PCAP_COMPACT_RECORD;
+        memcpy(body + sizeof(*record), input, input_len);
+        len = input_len;
+    } else {
+        stats.compressed++;
+    }
+    header.len = sizeof(*record) + len;
+    memcpy(&staging[staged], &header, sizeof(header));
+    staged += sizeof(header) + header.len;
+}
+
+/**
+ * @brief Sniffer batch handler. Appends one PCAP record per frame to the staging buffer and writes it out in one go.
+ *        batch_running is raised before streaming is checked, so stop either sees the batch or the batch sees stop.
+ */
+static void export_batch(const wifictl_frame_t *const *frames, size_t count) {
+    atomic_store(&batch_running, true);
+    if (!streaming) {
+        atomic_store(&batch_running, false);
+        return;
+    }
+    size_t overhead = compact ? sizeof(compact_record_hdr_t) : 0;
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_frame_t *frame = frames[i];
+        const wifi_pkt_rx_ctrl_t *rx = &frame->pkt.rx_ctrl;
+        uint32_t frame_len = rx->sig_len;
+        size_t record_len = sizeof(pcap_record_hdr_t) + sizeof(radiotap_hdr_t) + frame_len;
+
+        if (record_len + overhead > sizeof(staging)) {
+            stats.truncated++;
+            continue;
+        }
+        stats.pcap_bytes += record_len;
+        if (compact && !beacon_dedup_observe(&compact_state->dedup, frame->pkt.payload, frame_len, rx->rssi,
+                                             rx->channel, rx->timestamp, stage_summary, NULL)) {
+            stats.beacons_suppressed++;
+            continue;
+        }
+        if (staged + record_len + overhead > sizeof(staging)) {
+            flush_staging();
+        }
+
+        uint64_t tsft = extend_timestamp(rx->timestamp);
+        pcap_record_hdr_t record = {
+            .ts_sec = (uint32_t) (tsft / 1000000),
+            .ts_usec = (uint32_t) (tsft % 1000000),
+            .incl_len = sizeof(radiotap_hdr_t) + frame_len,
+            .orig_len = sizeof(radiotap_hdr_t) + frame_len,
+        };
+        stats.records++;
+        if (compact) {
+            stage_compact(frame, &record, tsft);
+            continue;
+        }
+        memcpy(&staging[staged], &record, sizeof(record));
+        staged += sizeof(record);
+        fill_radiotap((radiotap_hdr_t *) &staging[staged], frame, tsft);
+        staged += sizeof(radiotap_hdr_t);
+        memcpy(&staging[staged], frame->pkt.payload, frame_len);
+        staged += frame_len;
+    }
+    if (compact && count > 0) {
+        beacon_dedup_flush(&compact_state->dedup, frames[count - 1]->pkt.rx_ctrl.timestamp, stage_summary, NULL);
+    }
+    flush_staging();
+    publish_stats();
+    atomic_store(&batch_running, false);
+}
+
+/**
+ * @brief Allocates compact state on first use and resets it. Writes the compact stream header and dictionary.
+ */
+static esp_err_t start_compact(uart_port_t port) {
+    if (compact_state == NULL) {                                            // Kept for the next stream, a batch may still use it
+        compact_state = calloc(1, sizeof(*compact_state));
+        if (compact_state == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    static const wifictl_frame_t template_frame = { .pkt.rx_ctrl.channel = 1 };
+    uint8_t *dictionary = compact_state->dictionary;
+    memcpy(dictionary, dictionary_patterns, sizeof(dictionary_patterns));
+    fill_radiotap((radiotap_hdr_t *) &dictionary[sizeof(dictionary_patterns)], &template_frame, 0);  // Every record starts with it
+    frame_codec_init(&compact_state->codec, compact_state->window, sizeof(compact_state->window),
+                     dictionary, sizeof(compact_state->dictionary));
+    beacon_dedup_init(&compact_state->dedup, CONFIG_PCAP_EXPORT_SUMMARY_MS, CONFIG_PCAP_EXPORT_BEACON_REFRESH_MS);
+
+    compact_stream_hdr_t header = {
+        .magic = PCAP_EXPORT_COMPACT_MAGIC,
+        .version = PCAP_EXPORT_COMPACT_VERSION,
+        .dict_len = sizeof(compact_state->dictionary),
+    };
+    uart_write_bytes(port, &header, sizeof(header));
+    uart_write_bytes(port, dictionary, sizeof(compact_state->dictionary));
+    stats.bytes += sizeof(header) + sizeof(compact_state->dictionary);
+    return ESP_OK;
+}
+
+/**
+ * @brief Silences everything that writes to the console UART through stdout. The stdout FILE is shared by
+ *        all tasks, so reopening it reaches printf and ESP_LOG output of every task.
+ */
+static void mute_console(void) {
+    saved_log_level = esp_log_level_get("*");
+    esp_log_level_set("*", ESP_LOG_NONE);
+    fflush(stdout);
+    freopen("/dev/null", "w", stdout);
+    console_muted = true;
+}
+
+static void unmute_console(void) {
+    if (!console_muted) {
+        return;
+    }
+    console_muted = false;
+    freopen("/dev/console", "w", stdout);
+    esp_log_level_set("*", saved_log_level);
+}
+
+/**
+ * @brief Installs a driver on a dedicated streaming UART. The console UART's driver is installed by the console.
+ */
+static esp_err_t prepare_port(uart_port_t port) {
+    if (uart_is_driver_installed(port)) {
+        return ESP_OK;
+    }
+    esp_err_t err = uart_driver_install(port, 256, CONFIG_PCAP_EXPORT_BUFFER_SIZE, 0, NULL, 0);  // RX buffer is required
+    if (err == ESP_OK && CONFIG_PCAP_EXPORT_TX_PIN >= 0) {
+        err = uart_set_pin(port, CONFIG_PCAP_EXPORT_TX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    return err;
+}
+
+esp_err_t wifictl_pcap_export_start(uart_port_t port, uint32_t baud_rate, bool compact_mode) {
+    if (streaming) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_LOGI(TAG, "Streaming %sPCAP on UART%d at %lu baud", compact_mode ? "compact " : "", port, (unsigned long) baud_rate);
+
+    export_port = port;
+    esp_err_t err = port == CONFIG_ESP_CONSOLE_UART_NUM ? ESP_OK : prepare_port(port);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uart_wait_tx_done(port, portMAX_DELAY);                                 // Let pending console text out at old rate
+    uart_get_baudrate(port, &saved_baud_rate);
+    err = uart_set_baudrate(port, baud_rate);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (port == CONFIG_ESP_CONSOLE_UART_NUM) {
+        mute_console();
+    }
+
+    pcap_global_hdr_t header = {
+        .magic = PCAP_MAGIC_USEC,
+        .version_major = 2,
+        .version_minor = 4,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = PCAP_SNAPLEN,
+        .linktype = LINKTYPE_IEEE802_11_RADIOTAP,
+    };
+    memset(&stats, 0, sizeof(stats));
+    staged = 0;
+    last_timestamp = 0;
+    timestamp_high = 0;
+    compact = compact_mode;
+    if (compact && (err = start_compact(port)) != ESP_OK) {
+        uart_set_baudrate(port, saved_baud_rate);
+        unmute_console();
+        return err;
+    }
+    uart_write_bytes(port, &header, sizeof(header));
+    stats.bytes += sizeof(header);
+    publish_stats();
+
+    streaming = true;
+    if (!wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, export_batch)) {
+        streaming = false;
+        uart_wait_tx_done(port, portMAX_DELAY);
+        uart_set_baudrate(port, saved_baud_rate);
+        unmute_console();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void wifictl_pcap_export_stop(void) {
+    if (!streaming) {
+        return;
+    }
+    wifictl_sniffer_unregister_batch_handler(export_batch);
+    streaming = false;
+    while (atomic_load(&batch_running)) {                                   // A batch the aggregate stage already started
+        vTaskDelay(1);
+    }
+    uart_wait_tx_done(export_port, portMAX_DELAY);
+    if (saved_baud_rate != 0) {
+        uart_set_baudrate(export_port, saved_baud_rate);
+    }
+    unmute_console();
+    ESP_LOGI(TAG, "PCAP stream stopped: %lu records, %lu bytes for %lu PCAP bytes", (unsigned long) stats.records,
+             (unsigned long) stats.bytes, (unsigned long) stats.pcap_bytes);
+}
+
+bool wifictl_pcap_export_active(void) {
+    return streaming;
+}
+
+bool wifictl_pcap_export_owns_port(uart_port_t port) {
+    return streaming && port == export_port;
+}
+
+void wifictl_pcap_export_get_stats(wifictl_pcap_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = published_stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,200 @@
+/**
+ * @file pcap_reader.c
+ * @brief Implements PCAP record reading and radiotap decoding.
+ */
+#include "pcap_reader.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_GLOBAL_HDR_LEN 24
+#define PCAP_RECORD_HDR_LEN 16
+
+#define LINKTYPE_IEEE802_11 105
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+#define RADIOTAP_TSFT          0
+#define RADIOTAP_FLAGS         1
+#define RADIOTAP_RATE          2
+#define RADIOTAP_CHANNEL       3
+#define RADIOTAP_DBM_ANTSIGNAL 5
+#define RADIOTAP_DBM_ANTNOISE  6
+#define RADIOTAP_MCS           19
+#define RADIOTAP_EXT           (1u << 31)
+
+#define RADIOTAP_F_SHORTPRE 0x02
+#define RADIOTAP_F_FCS      0x10
+#define RADIOTAP_MCS_HAVE_MCS 0x02
+#define RADIOTAP_MCS_BW_MASK  0x03
+#define RADIOTAP_MCS_BW_40    0x01
+#define RADIOTAP_MCS_SGI      0x04
+
+#define MIN_FRAME_LEN 10                                                    // Frame control, duration, one address
+
+// Size and alignment of the standard radiotap fields up to MCS
+static const struct {
+    uint8_t size;
+    uint8_t align;
+} radiotap_fields[RADIOTAP_MCS + 1] = {
+    { 8, 8 }, { 1, 1 }, { 1, 1 }, { 4, 2 }, { 2, 1 }, { 1, 1 }, { 1, 1 }, { 2, 2 }, { 2, 2 }, { 2, 2 },
+    { 1, 1 }, { 1, 1 }, { 1, 1 }, { 1, 1 }, { 2, 2 }, { 2, 2 }, { 1, 1 }, { 1, 1 }, { 8, 4 }, { 3, 1 },
+};
+
+static uint16_t read_le16(const uint8_t *p) {
+    return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint32_t file_u32(const pcap_reader_t *reader, const uint8_t *p) {
+    uint32_t value = read_le32(p);
+    return reader->swapped ? __builtin_bswap32(value) : value;
+}
+
+static uint8_t frequency_channel(uint16_t mhz) {
+    if (mhz == 2484) {
+        return 14;
+    }
+    return mhz >= 2412 && mhz <= 2472 ? (uint8_t) ((mhz - 2407) / 5) : 0;
+}
+
+/**
+ * @brief Decodes the radiotap header in front of a frame. Radiotap is little-endian whatever the file byte order.
+ */
+static bool parse_radiotap(const uint8_t *p, uint32_t caplen, pcap_reader_frame_t *frame) {
+    if (caplen < 8 || p[0] != 0) {
+        return false;
+    }
+    uint16_t it_len = read_le16(p + 2);
+    if (it_len < 8 || it_len > caplen) {
+        return false;
+    }
+    uint32_t present = read_le32(p + 4);
+    size_t offset = 4;
+    for (uint32_t word = present; word & RADIOTAP_EXT; word = read_le32(p + offset)) {  // Skip further presence words
+        offset += 4;
+        if (offset + 4 > it_len) {
+            return false;
+        }
+    }
+    offset += 4;
+
+    for (int bit = 0; bit <= RADIOTAP_MCS; bit++) {
+        if (!(present & (1u << bit))) {
+            continue;
+        }
+        size_t align = radiotap_fields[bit].align;
+        offset = (offset + align - 1) & ~(align - 1);
+        if (offset + radiotap_fields[bit].size > it_len) {
+            break;
+        }
+        const uint8_t *field = p + offset;
+        switch (bit) {
+            case RADIOTAP_FLAGS:
+                frame->has_fcs = (field[0] & RADIOTAP_F_FCS) != 0;
+                frame->short_preamble = (field[0] & RADIOTAP_F_SHORTPRE) != 0;
+                break;
+            case RADIOTAP_RATE:
+                frame->rate = field[0];
+                break;
+            case RADIOTAP_CHANNEL:
+                frame->channel = frequency_channel(read_le16(field));
+                break;
+            case RADIOTAP_DBM_ANTSIGNAL:
+                frame->rssi = (int8_t) field[0];
+                break;
+            case RADIOTAP_DBM_ANTNOISE:
+                frame->noise = (int8_t) field[0];
+                break;
+            case RADIOTAP_MCS:
+                if (field[0] & RADIOTAP_MCS_HAVE_MCS) {
+                    frame->ht = true;
+                    frame->mcs = field[2];
+                    frame->cwb = (field[1] & RADIOTAP_MCS_BW_MASK) == RADIOTAP_MCS_BW_40;
+                    frame->sgi = (field[1] & RADIOTAP_MCS_SGI) != 0;
+                    frame->rate = 0;
+                }
+                break;
+            default:
+                break;
+        }
+        offset += radiotap_fields[bit].size;
+    }
+    frame->data = p + it_len;
+    frame->len = (uint16_t) (caplen - it_len);
+    return true;
+}
+
+bool pcap_reader_open(pcap_reader_t *reader, FILE *file) {
+    memset(reader, 0, offsetof(pcap_reader_t, buffer));
+    reader->file = file;
+    uint8_t header[PCAP_GLOBAL_HDR_LEN];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        return false;
+    }
+    uint32_t magic = read_le32(header);
+    if (magic == PCAP_MAGIC_USEC || magic == PCAP_MAGIC_NSEC) {
+        reader->swapped = false;
+    } else if (magic == __builtin_bswap32(PCAP_MAGIC_USEC) || magic == __builtin_bswap32(PCAP_MAGIC_NSEC)) {
+        reader->swapped = true;
+        magic = __builtin_bswap32(magic);
+    } else {
+        return false;
+    }
+    reader->nanoseconds = magic == PCAP_MAGIC_NSEC;
+    reader->linktype = file_u32(reader, header + 20);
+    return reader->linktype == LINKTYPE_IEEE802_11 || reader->linktype == LINKTYPE_IEEE802_11_RADIOTAP;
+}
+
+pcap_reader_result_t pcap_reader_next(pcap_reader_t *reader, pcap_reader_frame_t *frame) {
+    for (;;) {
+        uint8_t header[PCAP_RECORD_HDR_LEN];
+        size_t got = fread(header, 1, sizeof(header), reader->file);
+        if (got == 0) {
+            return PCAP_READER_END;
+        }
+        if (got != sizeof(header)) {
+            return PCAP_READER_ERROR;
+        }
+        uint32_t seconds = file_u32(reader, header);
+        uint32_t fraction = file_u32(reader, header + 4);
+        uint32_t caplen = file_u32(reader, header + 8);
+        reader->records++;
+
+        if (caplen > sizeof(reader->buffer)) {
+            reader->skipped++;
+            if (fseek(reader->file, caplen, SEEK_CUR) != 0) {
+                return PCAP_READER_ERROR;
+            }
+            continue;
+        }
+        if (fread(reader->buffer, 1, caplen, reader->file) != caplen) {
+            return PCAP_READER_ERROR;
+        }
+
+        memset(frame, 0, sizeof(*frame));
+        frame->timestamp_us = (uint64_t) seconds * 1000000 + (reader->nanoseconds ? fraction / 1000 : fraction);
+        if (reader->linktype == LINKTYPE_IEEE802_11_RADIOTAP) {
+            if (!parse_radiotap(reader->buffer, caplen, frame)) {
+                reader->skipped++;
+                continue;
+            }
+        } else {
+            frame->data = reader->buffer;
+            frame->len = (uint16_t) caplen;
+        }
+        if (frame->len < MIN_FRAME_LEN + (frame->has_fcs ? 4 : 0)) {
+            reader->skipped++;
+            continue;
+        }
+        return PCAP_READER_FRAME;
+    }
+}
+
+bool pcap_reader_rewind(pcap_reader_t *reader) {
+    return fseek(reader->file, PCAP_GLOBAL_HDR_LEN, SEEK_SET) == 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file pcap_replay.c
+ * @brief Implements PCAP replay radio operations and the paced replay task.
+ */
+#include "pcap_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "pcap_reader.h"
+#include "radio.h"
+#include "wifi_controller.h"
+
+static const char *TAG = "pcap_replay";
+
+#define SIG_MODE_LEGACY 0
+#define SIG_MODE_HT 1
+#define UNKNOWN_RATE_INDEX 4
+#define MAX_SPEED_YIELD_US 1000000                                          // Full speed replay sleeps a tick this often
+
+// Legacy rate index of rx_ctrl.rate to 500 kbps units (indexes 5-7 are short preamble)
+static const uint8_t legacy_rates[16] = { 2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18 };
+
+typedef struct {
+    FILE *file;
+    pcap_reader_t reader;
+    union {
+        wifi_promiscuous_pkt_t pkt;
+        uint8_t bytes[sizeof(wifi_promiscuous_pkt_t) + PCAP_READER_MAX_RECORD + 4];  // Room for an appended FCS
+    } out;
+} replay_state_t;
+
+static replay_state_t *state = NULL;
+static const wifictl_radio_ops_t *previous_ops = NULL;
+static TaskHandle_t replay_task = NULL;
+static SemaphoreHandle_t replay_exited = NULL;
+static volatile bool stop_requested = false;
+static wifi_promiscuous_cb_t frame_callback = NULL;
+static uint32_t filter_mask = WIFI_PROMIS_FILTER_MASK_ALL;
+static uint8_t replay_channel = 1;
+static uint32_t speed_percent = 100;
+static uint32_t loop_limit = 0;
+static int64_t started_us = 0;
+
+static wifictl_replay_stats_t stats;
+
+static uint8_t legacy_rate_index(uint8_t rate, bool short_preamble) {
+    if (short_preamble) {
+        for (uint8_t i = 5; i <= 7; i++) {
+            if (legacy_rates[i] == rate) {
+                return i;
+            }
+        }
+    }
+    for (uint8_t i = 0; i < sizeof(legacy_rates); i++) {
+        if (i != UNKNOWN_RATE_INDEX && legacy_rates[i] == rate) {
+            return i;
+        }
+    }
+    return UNKNOWN_RATE_INDEX;
+}
+
+/**
+ * @brief Rebuilds the driver's packet from a record and hands it to the sniffer callback.
+ */
+static void deliver(const pcap_reader_frame_t *frame, uint64_t timestamp_us) {
+    wifi_promiscuous_pkt_type_t type;
+    uint32_t mask;
+    switch ((frame->data[0] >> 2) & 0x03) {                                 // Frame control type
+        case 0: type = WIFI_PKT_MGMT; mask = WIFI_PROMIS_FILTER_MASK_MGMT; break;
+        case 1: type = WIFI_PKT_CTRL; mask = WIFI_PROMIS_FILTER_MASK_CTRL; break;
+        case 2: type = WIFI_PKT_DATA; mask = WIFI_PROMIS_FILTER_MASK_DATA; break;
+        default:                                                            // Extension frames, not reported by the driver
+            stats.masked++;
+            return;
+    }
+    if (!(filter_mask & mask)) {
+        stats.masked++;
+        return;
+    }
+
+    wifi_promiscuous_pkt_t *pkt = &state->out.pkt;
+    memset(&pkt->rx_ctrl, 0, sizeof(pkt->rx_ctrl));
+    pkt->rx_ctrl.rssi = frame->rssi;
+    pkt->rx_ctrl.noise_floor = frame->noise;
+    pkt->rx_ctrl.channel = frame->channel != 0 ? frame->channel : replay_channel;
+    pkt->rx_ctrl.timestamp = (uint32_t) timestamp_us;
+    if (frame->ht) {
+        pkt->rx_ctrl.sig_mode = SIG_MODE_HT;
+        pkt->rx_ctrl.mcs = frame->mcs;
+        pkt->rx_ctrl.cwb = frame->cwb;
+        pkt->rx_ctrl.sgi = frame->sgi;
+    } else {
+        pkt->rx_ctrl.sig_mode = SIG_MODE_LEGACY;
+        pkt->rx_ctrl.rate = legacy_rate_index(frame->rate, frame->short_preamble);
+    }
+    uint16_t len = frame->len;
+    memcpy(pkt->payload, frame->data, len);
+    if (!frame->has_fcs) {                                                  // sig_len counts the FCS, consumers strip it
+        memset(pkt->payload + len, 0, 4);
+        len += 4;
+    }
+    pkt->rx_ctrl.sig_len = len;
+    frame_callback(pkt, type);
+    stats.frames++;
+}
+
+/**
+ * @brief Sleeps until a record is due. Wakes up to one tick early, or at once on a stop request.
+ */
+static void wait_until(int64_t due_us) {
+    int64_t ahead_us = due_us - esp_timer_get_time();
+    if (ahead_us >= 1000) {
+        TickType_t ticks = pdMS_TO_TICKS(ahead_us / 1000);
+        if (ticks > 0) {
+            ulTaskNotifyTake(pdTRUE, ticks);
+        }
+    }
+    int64_t late_us = esp_timer_get_time() - due_us;
+    if (late_us > (int64_t) stats.late_max_us) {
+        stats.late_max_us = late_us > UINT32_MAX ? UINT32_MAX : (uint32_t) late_us;
+    }
+}
+
+static void replay_run(void *arg) {
+    pcap_reader_t *reader = &state->reader;
+    uint64_t loop_base_us = 0;                                              // Timestamp offset of the current pass
+    int64_t yielded_us = started_us;
+
+    while (!stop_requested) {
+        if (!pcap_reader_rewind(reader)) {
+            stats.errors++;
+            break;
+        }
+        int64_t pass_started_us = esp_timer_get_time();
+        uint64_t first_us = 0;
+        uint64_t offset_us = 0;
+        bool empty = true;
+        pcap_reader_frame_t frame;
+        pcap_reader_result_t result = PCAP_READER_END;
+        while (!stop_requested && (result = pcap_reader_next(reader, &frame)) == PCAP_READER_FRAME) {
+            if (empty) {
+                first_us = frame.timestamp_us;
+                empty = false;
+            }
+            if (frame.timestamp_us > first_us + offset_us) {                // Out of order records are not delayed
+                offset_us = frame.timestamp_us - first_us;
+            }
+            if (speed_percent != PCAP_REPLAY_MAX_SPEED) {
+                wait_until(pass_started_us + (int64_t) (offset_us * 100 / speed_percent));
+            } else if (esp_timer_get_time() - yielded_us > MAX_SPEED_YIELD_US) {
+                vTaskDelay(1);                                              // Let the idle task feed the task watchdog
+                yielded_us = esp_timer_get_time();
+            }
+            deliver(&frame, loop_base_us + offset_us);
+        }
+        stats.skipped = reader->skipped;
+        if (stop_requested) {
+            break;
+        }
+        if (result == PCAP_READER_ERROR) {
+            stats.errors++;
+            break;
+        }
+        stats.loops++;
+        loop_base_us += offset_us + 1;
+        if (empty || (loop_limit != 0 && stats.loops >= loop_limit)) {
+            stats.finished = true;
+            break;
+        }
+    }
+    stats.elapsed_ms = (uint32_t) ((esp_timer_get_time() - started_us) / 1000);
+    stats.running = false;
+    ESP_LOGI(TAG, "Replay ended: %lu frames in %lu ms", (unsigned long) stats.frames, (unsigned long) stats.elapsed_ms);
+
+    while (!stop_requested) {                                               // Stay until promiscuous mode is disabled
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    xSemaphoreGive(replay_exited);
+    vTaskDelete(NULL);
+}
+
+static void stop_replay_task(void) {
+    if (replay_task == NULL) {
+        return;
+    }
+    stop_requested = true;
+    xTaskNotifyGive(replay_task);
+    xSemaphoreTake(replay_exited, portMAX_DELAY);
+    replay_task = NULL;
+}
+
+static esp_err_t replay_set_promiscuous(bool enable, wifi_promiscuous_cb_t callback) {
+    if (!enable) {
+        stop_replay_task();
+        return ESP_OK;
+    }
+    stop_replay_task();                                                     // Enabling again restarts from the first record
+    frame_callback = callback;
+    stop_requested = false;
+    uint32_t errors = stats.errors;
+    memset(&stats, 0, sizeof(stats));
+    stats.errors = errors;
+    state->reader.records = 0;
+    state->reader.skipped = 0;
+    started_us = esp_timer_get_time();
+    stats.running = true;
+    if (xTaskCreatePinnedToCore(replay_run, "pcap_replay", 3072, NULL, CONFIG_PCAP_REPLAY_TASK_PRIORITY,
+                                &replay_task, CONFIG_PCAP_REPLAY_CORE) != pdPASS) {
+        replay_task = NULL;
+        stats.running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t replay_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+    filter_mask = filter->filter_mask;
+    return ESP_OK;
+}
+
+static esp_err_t replay_set_channel(uint8_t channel) {
+    replay_channel = channel;                                               // Applied to records without a channel
+    return ESP_OK;
+}
+
+static esp_err_t replay_scan_start(const wifi_scan_config_t *config) {
+    return previous_ops->scan_start(config);
+}
+
+static esp_err_t replay_scan_stop(void) {
+    return previous_ops->scan_stop();
+}
+
+static esp_err_t replay_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records) {
+    return previous_ops->scan_get_ap_records(number, records);
+}
+
+static esp_err_t replay_clear_ap_list(void) {
+    return previous_ops->clear_ap_list();
+}
+
+static const wifictl_radio_ops_t replay_ops = {
+    .scan_start = replay_scan_start,
+    .scan_stop = replay_scan_stop,
+    .scan_get_ap_records = replay_scan_get_ap_records,
+    .clear_ap_list = replay_clear_ap_list,
+    .set_channel = replay_set_channel,
+    .set_promiscuous = replay_set_promiscuous,
+    .set_promiscuous_filter = replay_set_promiscuous_filter,
+};
+
+esp_err_t wifictl_replay_install(const char *path, uint32_t speed, uint32_t loops) {
+    if (state != NULL || wifictl_mode_get() == WIFICTL_MODE_SNIFFING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (replay_exited == NULL) {
+        replay_exited = xSemaphoreCreateBinary();
+        if (replay_exited == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    replay_state_t *new_state = calloc(1, sizeof(*new_state));
+    if (new_state == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    new_state->file = fopen(path, "rb");
+    if (new_state->file == NULL) {
+        free(new_state);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!pcap_reader_open(&new_state->reader, new_state->file)) {
+        fclose(new_state->file);
+        free(new_state);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    speed_percent = speed;
+    loop_limit = loops;
+    filter_mask = WIFI_PROMIS_FILTER_MASK_ALL;
+    state = new_state;
+    previous_ops = wifictl_radio();
+    wifictl_radio_set_ops(&replay_ops);
+    if (speed == PCAP_REPLAY_MAX_SPEED) {
+        ESP_LOGI(TAG, "Replaying %s at maximum speed", path);
+    } else {
+        ESP_LOGI(TAG, "Replaying %s at %lu%% of recorded speed", path, (unsigned long) speed);
+    }
+    return ESP_OK;
+}
+
+void wifictl_replay_uninstall(void) {
+    if (state == NULL) {
+        return;
+    }
+    stop_replay_task();
+    wifictl_radio_set_ops(previous_ops);
+    fclose(state->file);
+    free(state);
+    state = NULL;
+}
+
+void wifictl_replay_get_stats(wifictl_replay_stats_t *out) {
+    *out = stats;
+    out->installed = state != NULL;
+    out->speed_percent = speed_percent;
+    if (out->running) {
+        out->elapsed_ms = (uint32_t) ((esp_timer_get_time() - started_us) / 1000);
+        out->skipped = state->reader.skipped;
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file radio.c
+ * @brief Implements radio operations on top of esp_wifi.
+ */
+#include "radio.h"
+
+#include <stddef.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static esp_err_t driver_scan_start(const wifi_scan_config_t *config) {
+    return esp_wifi_scan_start(config, false);
+}
+
+static esp_err_t driver_set_channel(uint8_t channel) {
+    return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+}
+
+static esp_err_t driver_set_promiscuous(bool enable, wifi_promiscuous_cb_t callback) {
+    if (!enable) {
+        return esp_wifi_set_promiscuous(false);
+    }
+    esp_err_t err = esp_wifi_set_promiscuous_rx_cb(callback);
+    if (err == ESP_OK) {
+        err = esp_wifi_set_promiscuous(true);
+    }
+    return err;
+}
+
+static const wifictl_radio_ops_t driver_ops = {
+    .scan_start = driver_scan_start,
+    .scan_stop = esp_wifi_scan_stop,
+    .scan_get_ap_records = esp_wifi_scan_get_ap_records,
+    .clear_ap_list = esp_wifi_clear_ap_list,
+    .set_channel = driver_set_channel,
+    .set_promiscuous = driver_set_promiscuous,
+    .set_promiscuous_filter = esp_wifi_set_promiscuous_filter,
+};
+
+static const wifictl_radio_ops_t *radio_ops = &driver_ops;
+static portMUX_TYPE channel_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t current_channel = 0;
+static int64_t channel_since_us = 0;
+
+const wifictl_radio_ops_t *wifictl_radio(void) {
+    return radio_ops;
+}
+
+void wifictl_radio_set_ops(const wifictl_radio_ops_t *ops) {
+    radio_ops = ops != NULL ? ops : &driver_ops;
+}
+
+esp_err_t wifictl_radio_set_channel(uint8_t channel) {
+    esp_err_t err = radio_ops->set_channel(channel);
+    if (err == ESP_OK) {
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&channel_lock);
+        current_channel = channel;
+        channel_since_us = now;
+        portEXIT_CRITICAL(&channel_lock);
+    }
+    return err;
+}
+
+uint8_t wifictl_radio_channel(int64_t *since_us) {
+    portENTER_CRITICAL(&channel_lock);
+    uint8_t channel = current_channel;
+    if (since_us != NULL) {
+        *since_us = channel_since_us;
+    }
+    portEXIT_CRITICAL(&channel_lock);
+    return channel;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file scan_delta.c
+ * @brief Implements change detection between scan rounds.
+ */
+#include "scan_delta.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int find_entry(const scan_delta_t *delta, const uint8_t bssid[6]) {
+    for (int i = 0; i < CONFIG_SCAN_DELTA_CAPACITY; i++) {
+        if (delta->entries[i].used && memcmp(delta->entries[i].reported.bssid, bssid, 6) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int free_entry(const scan_delta_t *delta) {
+    for (int i = 0; i < CONFIG_SCAN_DELTA_CAPACITY; i++) {
+        if (!delta->entries[i].used) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool covered(const uint8_t *channels, size_t count, uint8_t channel) {
+    if (channels == NULL) {
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (channels[i] == channel) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void scan_delta_init(scan_delta_t *delta, uint8_t rssi_hysteresis_db, uint8_t miss_limit) {
+    memset(delta, 0, sizeof(*delta));
+    delta->rssi_hysteresis_db = rssi_hysteresis_db > 0 ? rssi_hysteresis_db : 1;
+    delta->miss_limit = miss_limit > 0 ? miss_limit : 1;
+}
+
+size_t scan_delta_update(scan_delta_t *delta, const scan_delta_ap_t *aps, size_t count, const uint8_t *channels,
+                         size_t channel_count, scan_delta_event_t *events, size_t max) {
+    bool seen[CONFIG_SCAN_DELTA_CAPACITY] = { false };
+    size_t written = 0;
+    delta->rounds++;
+
+    for (size_t i = 0; i < count; i++) {
+        const scan_delta_ap_t *ap = &aps[i];
+        int index = find_entry(delta, ap->bssid);
+        if (index < 0) {
+            index = free_entry(delta);
+            if (index < 0) {
+                delta->untracked++;
+                continue;
+            }
+            if (written == max) {
+                continue;                                                   // Stays unknown, reported as new next round
+            }
+            delta->entries[index] = (scan_delta_entry_t) { .reported = *ap, .used = true };
+            events[written++] = (scan_delta_event_t) { .kind = SCAN_DELTA_NEW, .ap = *ap };
+            seen[index] = true;
+            continue;
+        }
+
+        scan_delta_entry_t *entry = &delta->entries[index];
+        seen[index] = true;
+        entry->misses = 0;
+        uint8_t changed = (abs(ap->rssi - entry->reported.rssi) >= delta->rssi_hysteresis_db ? SCAN_DELTA_RSSI : 0) |
+                          (ap->channel != entry->reported.channel ? SCAN_DELTA_CHANNEL : 0) |
+                          (ap->authmode != entry->reported.authmode ? SCAN_DELTA_AUTH : 0);
+        if (changed == 0 || written == max) {
+            continue;
+        }
+        events[written++] = (scan_delta_event_t) {
+            .kind = SCAN_DELTA_CHANGED,
+            .changed = changed,
+            .ap = *ap,
+            .previous_channel = entry->reported.channel,
+            .previous_authmode = entry->reported.authmode,
+            .previous_rssi = entry->reported.rssi,
+        };
+        entry->reported = *ap;
+    }
+
+    for (int i = 0; i < CONFIG_SCAN_DELTA_CAPACITY; i++) {
+        scan_delta_entry_t *entry = &delta->entries[i];
+        if (!entry->used || seen[i] || !covered(channels, channel_count, entry->reported.channel)) {
+            continue;
+        }
+        if (entry->misses < delta->miss_limit) {
+            entry->misses++;
+        }
+        if (entry->misses >= delta->miss_limit && written < max) {
+            events[written++] = (scan_delta_event_t) { .kind = SCAN_DELTA_GONE, .ap = entry->reported };
+            entry->used = false;
+        }
+    }
+    return written;
+}
+
+size_t scan_delta_count(const scan_delta_t *delta) {
+    size_t count = 0;
+    for (int i = 0; i < CONFIG_SCAN_DELTA_CAPACITY; i++) {
+        count += delta->entries[i].used;
+    }
+    return count;
+}
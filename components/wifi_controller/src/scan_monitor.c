@@ -0,0 +1,244 @@
+/**
+ * @file scan_monitor.c
+ * @brief Implements periodic background scans with change reporting.
+ */
+#include "scan_monitor.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "ap_scanner.h"
+#include "wifi_controller.h"
+
+static const char *TAG = "scan_monitor";
+
+static const uint8_t all_channels[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+
+static esp_timer_handle_t round_timer = NULL;
+static SemaphoreHandle_t monitor_mutex = NULL;                              // Orders start, stop and round bookkeeping
+static StaticSemaphore_t monitor_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool monitoring = false;
+static volatile bool round_running = false;                                 // A scan started by the timer is running
+static wifictl_scan_delta_callback_t delta_callback = NULL;
+static uint8_t channels[14];
+static size_t channel_count = 0;
+
+// Touched by the event loop task only while a round runs
+static scan_delta_t tracker;
+static scan_delta_ap_t round_aps[CONFIG_AP_TABLE_CAPACITY];
+static size_t round_count = 0;
+static size_t round_channels = 0;                                           // Channels completed in this round
+static scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];               // Each event is about a different tracked AP
+
+static uint32_t rounds = 0;
+static uint32_t skipped = 0;
+static uint32_t discarded = 0;
+static uint32_t reported = 0;
+
+static void collect_round(uint8_t channel, const uint16_t *ids, uint16_t count, bool done);
+
+static void monitor_lock(void) {
+    if (monitor_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (monitor_mutex == NULL) {
+            monitor_mutex = xSemaphoreCreateMutexStatic(&monitor_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTake(monitor_mutex, portMAX_DELAY);
+}
+
+static void monitor_unlock(void) {
+    xSemaphoreGive(monitor_mutex);
+}
+
+/**
+ * @brief Ends the round under monitor_mutex; unregisters if the monitor was stopped while it ran.
+ * @return true if the monitor is still running.
+ */
+static bool finish_round_locked(void) {
+    round_running = false;
+    if (!monitoring) {                                                      // Stop left unregistering to the round
+        wifictl_unregister_scan_callback(collect_round);
+        discarded++;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds an AP of the round, once per BSSID: adjacent channel scans can return the same AP.
+ */
+static void add_round_ap(const wifi_ap_record_t *record) {
+    scan_delta_ap_t ap = {
+        .channel = record->primary,
+        .authmode = (uint8_t) record->authmode,
+        .rssi = record->rssi,
+    };
+    memcpy(ap.bssid, record->bssid, 6);
+    for (size_t i = 0; i < round_count; i++) {
+        if (memcmp(round_aps[i].bssid, ap.bssid, 6) == 0) {
+            round_aps[i] = ap;
+            return;
+        }
+    }
+    if (round_count < CONFIG_AP_TABLE_CAPACITY) {
+        round_aps[round_count++] = ap;
+    }
+}
+
+/**
+ * @brief Scan callback collecting the round and reporting its changes when the last channel is done.
+ */
+static void collect_round(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    if (!round_running) {                                                   // Someone else's scan
+        return;
+    }
+    if (!done) {
+        round_channels++;
+        for (uint16_t i = 0; i < count; i++) {
+            wifi_ap_record_t record;
+            if (wifictl_ap_table_record(ids[i], &record)) {
+                add_round_ap(&record);
+            }
+        }
+        return;
+    }
+    monitor_lock();
+    if (!finish_round_locked()) {
+        monitor_unlock();
+        return;
+    }
+    if (round_channels < channel_count) {                                   // Cancelled or failed part way
+        discarded++;
+        monitor_unlock();
+        return;
+    }
+    size_t n = scan_delta_update(&tracker, round_aps, round_count, channels, channel_count, events,
+                                 CONFIG_SCAN_DELTA_CAPACITY);
+    rounds++;
+    reported += n;
+    monitor_unlock();
+    if (n > 0) {
+        delta_callback(events, n);
+    }
+}
+
+static void start_round(void *arg) {
+    monitor_lock();
+    if (!monitoring || round_running) {
+        monitor_unlock();
+        return;
+    }
+    if (wifictl_mode_get() == WIFICTL_MODE_SNIFFING || wifictl_scan_in_progress()) {
+        skipped++;
+        monitor_unlock();
+        return;
+    }
+    round_count = 0;
+    round_channels = 0;
+    round_running = true;                                                   // From here a stop leaves the cleanup to the round
+    monitor_unlock();
+    if (wifictl_scan_start_async(channels, channel_count) != ESP_OK) {      // No callback for a scan that did not start
+        monitor_lock();
+        if (finish_round_locked()) {
+            skipped++;
+        }
+        monitor_unlock();
+    }
+}
+
+/**
+ * @brief Registers the round callback, resets the tracker and starts the round timer. Called with monitor_mutex held.
+ */
+static esp_err_t start_locked(uint32_t interval_s, const uint8_t *list, size_t count,
+                              wifictl_scan_delta_callback_t callback) {
+    if (monitoring || round_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (round_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = start_round,
+            .name = "scan_monitor",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &round_timer);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (!wifictl_register_scan_callback(collect_round)) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(channels, list, count);
+    channel_count = count;
+    delta_callback = callback;
+    scan_delta_init(&tracker, CONFIG_SCAN_MONITOR_RSSI_HYSTERESIS_DB, CONFIG_SCAN_MONITOR_MISSES);
+    rounds = skipped = discarded = reported = 0;
+    monitoring = true;
+
+    esp_err_t err = esp_timer_start_periodic(round_timer, (uint64_t) interval_s * 1000000);
+    if (err != ESP_OK) {
+        monitoring = false;
+        wifictl_unregister_scan_callback(collect_round);
+    }
+    return err;
+}
+
+esp_err_t wifictl_scan_monitor_start(uint32_t interval_s, const uint8_t *list, size_t count,
+                                     wifictl_scan_delta_callback_t callback) {
+    if (list == NULL) {
+        list = all_channels;
+        count = sizeof(all_channels);
+    }
+    if (interval_s == 0 || callback == NULL || count == 0 || count > sizeof(channels)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (list[i] < 1 || list[i] > 14) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    monitor_lock();
+    esp_err_t err = start_locked(interval_s, list, count, callback);
+    monitor_unlock();
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "Scanning %u channels every %lu s", (unsigned) count, (unsigned long) interval_s);
+    start_round(NULL);                                                      // First round now, it sets the baseline
+    return ESP_OK;
+}
+
+void wifictl_scan_monitor_stop(void) {
+    monitor_lock();
+    if (!monitoring) {
+        monitor_unlock();
+        return;
+    }
+    monitoring = false;
+    esp_timer_stop(round_timer);
+    if (!round_running) {                                                   // Else the running round unregisters when done
+        wifictl_unregister_scan_callback(collect_round);
+    }
+    monitor_unlock();
+    ESP_LOGI(TAG, "Background scanning stopped");
+}
+
+bool wifictl_scan_monitor_active(void) {
+    return monitoring;
+}
+
+void wifictl_scan_monitor_get_stats(wifictl_scan_monitor_stats_t *stats) {
+    stats->rounds = rounds;
+    stats->skipped = skipped;
+    stats->discarded = discarded;
+    stats->events = reported;
+    stats->tracked = (uint32_t) scan_delta_count(&tracker);
+    stats->untracked = tracker.untracked;
+}
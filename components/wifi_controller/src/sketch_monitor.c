@@ -0,0 +1,281 @@
+/**
+ * @file sketch_monitor.c
+ * @brief Implements traffic sketches of captured frames over rotating windows.
+ */
+#include "sketch_monitor.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "sketch_monitor";
+
+#define FCS_LEN 4
+#define WINDOW_US ((int64_t) CONFIG_SKETCH_WINDOW_S * 1000000)
+
+static sketch_window_t buffers[2];                                          // Current window and a cleared spare
+static sketch_window_t *current = &buffers[0];                              // Frames since window_start_us
+static sketch_window_t closed;                                              // Every earlier window merged
+static portMUX_TYPE sketch_lock = portMUX_INITIALIZER_UNLOCKED;             // Guards current and the window clock, held for copies only
+static SemaphoreHandle_t summary_mutex = NULL;                              // Guards closed and the spare, serializes rotation
+static StaticSemaphore_t summary_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool collecting = false;
+static int64_t window_start_us = 0;
+static uint32_t windows = 0;
+
+static inline bool is_group(const uint8_t *mac) {
+    return mac[0] & 0x01;
+}
+
+/**
+ * @brief Finds BSSID and client of a management or data frame. Both stay NULL for WDS frames, the client
+ *        also for frames the AP sends to a group or to itself (beacons).
+ */
+static void frame_parties(const uint8_t *frame, bool mgmt, const uint8_t **bssid, const uint8_t **client) {
+    const uint8_t *addr1 = &frame[4], *addr2 = &frame[10], *addr3 = &frame[16];
+    *bssid = NULL;
+    *client = NULL;
+    if (mgmt) {
+        *bssid = addr3;
+        *client = memcmp(addr2, addr3, 6) != 0 ? addr2 : !is_group(addr1) ? addr1 : NULL;
+        return;
+    }
+    switch (frame[1] & 0x03) {                                              // ToDS, FromDS
+        case 0x01: *bssid = addr1; *client = addr2; break;                  // To AP
+        case 0x02: *bssid = addr2; *client = is_group(addr1) ? NULL : addr1; break;  // From AP
+        case 0x00: *bssid = addr3; *client = addr2; break;                  // IBSS
+        default:   break;                                                   // WDS
+    }
+}
+
+static void summary_lock(void) {
+    if (summary_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (summary_mutex == NULL) {
+            summary_mutex = xSemaphoreCreateMutexStatic(&summary_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTake(summary_mutex, portMAX_DELAY);
+}
+
+static void summary_unlock(void) {
+    xSemaphoreGive(summary_mutex);
+}
+
+static inline bool window_due(int64_t now_us) {
+    return collecting && now_us - window_start_us >= WINDOW_US;
+}
+
+/**
+ * @brief Closes the current window when it has run its length. Only the buffer swap happens under sketch_lock;
+ *        the retired window is merged into the summary and cleared as the next spare afterwards, keeping the
+ *        summary's BSSID slots so their clients go on being counted. Call with summary_mutex held.
+ */
+static void rotate(int64_t now_us) {
+    sketch_window_t *retired = NULL;
+    portENTER_CRITICAL(&sketch_lock);
+    if (window_due(now_us)) {
+        retired = current;
+        current = current == &buffers[0] ? &buffers[1] : &buffers[0];
+        window_start_us = now_us;
+        windows++;
+    }
+    portEXIT_CRITICAL(&sketch_lock);
+    if (retired != NULL) {
+        sketch_window_merge(&closed, retired);
+        sketch_window_init(retired);
+        sketch_window_carry_bssids(retired, &closed);
+    }
+}
+
+void wifictl_sketch_add_frame(const wifictl_frame_t *frame) {
+    if (!collecting || frame->event_id == SNIFFER_EVENT_CAPTURED_CTRL) {
+        return;
+    }
+    const wifi_pkt_rx_ctrl_t *rx = &frame->pkt.rx_ctrl;
+    if (rx->sig_len < 24 + FCS_LEN) {
+        return;
+    }
+    const uint8_t *bssid, *client;
+    frame_parties(frame->pkt.payload, frame->event_id == SNIFFER_EVENT_CAPTURED_MGMT, &bssid, &client);
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&sketch_lock);
+    if (collecting) {                                                       // Not stopped meanwhile
+        sketch_window_add(current, rx->channel, &frame->pkt.payload[10], bssid, client, rx->sig_len - FCS_LEN);
+    }
+    bool due = window_due(now_us);
+    portEXIT_CRITICAL(&sketch_lock);
+    if (due) {                                                              // Merged on this consumer task, not under the spinlock
+        summary_lock();
+        rotate(now_us);
+        summary_unlock();
+    }
+}
+
+esp_err_t wifictl_sketch_start(void) {
+    if (collecting) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    summary_lock();
+    portENTER_CRITICAL(&sketch_lock);                                       // Waits out an add still in flight
+    portEXIT_CRITICAL(&sketch_lock);
+    sketch_window_init(&buffers[0]);
+    sketch_window_init(&buffers[1]);
+    sketch_window_init(&closed);
+    portENTER_CRITICAL(&sketch_lock);
+    current = &buffers[0];
+    window_start_us = esp_timer_get_time();
+    windows = 0;
+    collecting = true;
+    portEXIT_CRITICAL(&sketch_lock);
+    summary_unlock();
+    ESP_LOGI(TAG, "Sketches started, %d s windows, %u bytes", CONFIG_SKETCH_WINDOW_S, (unsigned) (3 * sizeof(sketch_window_t)));
+    return ESP_OK;
+}
+
+void wifictl_sketch_stop(void) {
+    collecting = false;
+}
+
+bool wifictl_sketch_active(void) {
+    return collecting;
+}
+
+size_t wifictl_sketch_channels(wifictl_sketch_census_t *out, size_t max) {
+    static sketch_hll_t all_window, all_total;                              // Queried from the console task only
+    memset(&all_window, 0, sizeof(all_window));
+    memset(&all_total, 0, sizeof(all_total));
+    size_t count = max > 0 ? 1 : 0;                                         // Row of all channels goes first
+    summary_lock();
+    rotate(esp_timer_get_time());
+    for (int c = 0; c < SKETCH_CHANNELS; c++) {
+        sketch_hll_t window, total = closed.channels[c];
+        portENTER_CRITICAL(&sketch_lock);                                   // Copy only, estimates are too slow to hold the lock
+        window = current->channels[c];
+        portEXIT_CRITICAL(&sketch_lock);
+        sketch_hll_merge(&total, &window);
+        sketch_hll_merge(&all_window, &window);
+        sketch_hll_merge(&all_total, &total);
+        uint32_t estimate = sketch_hll_estimate(&total);
+        if (estimate > 0 && count < max) {
+            out[count++] = (wifictl_sketch_census_t) {
+                .channel = (uint8_t) (c + 1),
+                .window = sketch_hll_estimate(&window),
+                .total = estimate,
+            };
+        }
+    }
+    summary_unlock();
+    if (max > 0) {
+        out[0] = (wifictl_sketch_census_t) {
+            .window = sketch_hll_estimate(&all_window),
+            .total = sketch_hll_estimate(&all_total),
+        };
+    }
+    return count;
+}
+
+/**
+ * @brief Copies slot `index` of the run-wide BSSID list: slots of closed windows, then the ones first heard in the current one.
+ *        Call with summary_mutex held, so no window closes and slots stay put.
+ * @return false past the end of the list. Both copies are unused past the last closed slot and for a current slot
+ *         already listed with the closed windows.
+ */
+static bool copy_bssid(int index, sketch_bssid_t *slot, sketch_bssid_t *recent) {
+    memset(recent, 0, sizeof(*recent));
+    if (index < CONFIG_SKETCH_BSSIDS) {
+        *slot = closed.bssids[index];
+        if (!slot->used) {
+            return true;                                                    // End of closed slots, current ones follow
+        }
+        portENTER_CRITICAL(&sketch_lock);
+        const sketch_bssid_t *found = sketch_window_find_bssid(current, slot->bssid);
+        if (found != NULL) {
+            *recent = *found;
+        }
+        portEXIT_CRITICAL(&sketch_lock);
+        return true;
+    }
+    memset(slot, 0, sizeof(*slot));
+    if (index >= 2 * CONFIG_SKETCH_BSSIDS) {
+        return false;
+    }
+    portENTER_CRITICAL(&sketch_lock);
+    *recent = current->bssids[index - CONFIG_SKETCH_BSSIDS];
+    portEXIT_CRITICAL(&sketch_lock);
+    if (!recent->used) {
+        return false;
+    }
+    if (sketch_window_find_bssid(&closed, recent->bssid) != NULL) {
+        recent->used = false;                                               // Listed with the closed windows
+    }
+    return true;
+}
+
+size_t wifictl_sketch_bssids(wifictl_sketch_census_t *out, size_t max) {
+    static sketch_bssid_t slot, recent;                                     // Queried from the console task only
+    size_t count = 0;
+    summary_lock();
+    rotate(esp_timer_get_time());
+    for (int i = 0; count < max && copy_bssid(i, &slot, &recent); i++) {
+        if (!slot.used && !recent.used) {
+            if (i < CONFIG_SKETCH_BSSIDS) {
+                i = CONFIG_SKETCH_BSSIDS - 1;                               // Skip to the current window's slots
+            }
+            continue;
+        }
+        sketch_hll_merge(&slot.clients, &recent.clients);
+        wifictl_sketch_census_t *row = &out[count++];
+        memcpy(row->bssid, recent.used ? recent.bssid : slot.bssid, 6);
+        row->channel = recent.used ? recent.channel : slot.channel;
+        row->window = recent.used ? sketch_hll_estimate(&recent.clients) : 0;
+        row->total = sketch_hll_estimate(&slot.clients);
+    }
+    summary_unlock();
+    return count;
+}
+
+size_t wifictl_sketch_talkers(sketch_metric_t metric, bool window_only, sketch_talker_t *out, size_t max) {
+    static sketch_topk_t talkers;                                           // Queried from the console task only
+    summary_lock();
+    rotate(esp_timer_get_time());
+    portENTER_CRITICAL(&sketch_lock);
+    talkers = current->talkers[metric];
+    portEXIT_CRITICAL(&sketch_lock);
+    if (!window_only) {
+        sketch_topk_merge(&talkers, &closed.talkers[metric]);               // O(K^2), without the spinlock
+    }
+    summary_unlock();
+    return sketch_topk_sorted(&talkers, out, max);
+}
+
+void wifictl_sketch_lookup(const uint8_t mac[6], uint32_t window[SKETCH_METRICS], uint32_t total[SKETCH_METRICS]) {
+    uint64_t hash = sketch_hash_mac(mac);
+    summary_lock();
+    rotate(esp_timer_get_time());
+    for (int m = 0; m < SKETCH_METRICS; m++) {
+        portENTER_CRITICAL(&sketch_lock);
+        window[m] = sketch_cms_estimate(&current->counts[m], hash);        // CONFIG_SKETCH_CMS_DEPTH reads
+        portEXIT_CRITICAL(&sketch_lock);
+        uint32_t earlier = sketch_cms_estimate(&closed.counts[m], hash);
+        total[m] = window[m] + earlier < window[m] ? UINT32_MAX : window[m] + earlier;
+    }
+    summary_unlock();
+}
+
+void wifictl_sketch_get_stats(wifictl_sketch_stats_t *stats) {
+    summary_lock();
+    portENTER_CRITICAL(&sketch_lock);
+    stats->frames = closed.frames + current->frames;
+    stats->bytes = closed.bytes + current->bytes;
+    stats->windows = windows;
+    stats->window_age_s = (uint32_t) ((esp_timer_get_time() - window_start_us) / 1000000);
+    stats->bssid_overflow = closed.bssid_overflow + current->bssid_overflow;
+    portEXIT_CRITICAL(&sketch_lock);
+    summary_unlock();
+}
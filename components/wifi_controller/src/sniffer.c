@@ -8,49 +8,292 @@
  */
 #include "sniffer.h"
 
-#define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "esp_wifi_types.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "frame_ring.h"
+#include "frame_pool.h"
+#include "sniffer_fanout.h"
+#include "capture_filter.h"
+#include "radio.h"
+#include "metrics.h"
+#include "deferred_log.h"
+#include "wifi_controller.h"
 
 static const char *TAG = "sniffer"; 
 
+_Static_assert((CONFIG_SNIFFER_RING_SIZE & (CONFIG_SNIFFER_RING_SIZE - 1)) == 0,
+               "CONFIG_SNIFFER_RING_SIZE must be a power of two");
+
 ESP_EVENT_DEFINE_BASE(SNIFFER_EVENTS);
 
+static frame_ring_t capture_ring;
+static void *capture_ring_slots[CONFIG_SNIFFER_RING_SIZE];
+static TaskHandle_t parse_task = NULL;                                       // Woken by the promiscuous callback
+static wifictl_sniffer_batch_handler_t batch_handlers[SNIFFER_STAGE_COUNT][CONFIG_SNIFFER_MAX_BATCH_HANDLERS];
+static uint32_t capture_seq = 0;                                             // Written by the promiscuous callback only
+
+// Double-buffered capture filter: setters build the inactive program and switch active_filter. The promiscuous
+// callback takes no lock; it marks the program it runs in filter_users, so a setter can wait before reusing it.
+// Counters inside a program are only written by the callback and are read as whole words.
+static capture_filter_t filters[2];                                          // Empty program accepts every frame
+static _Atomic uint32_t active_filter;
+static _Atomic uint32_t filter_users[2];                                     // Callbacks running each program
+static SemaphoreHandle_t filter_mutex = NULL;                                // Serializes setters and readers
+static StaticSemaphore_t filter_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static _Atomic uint32_t frames_captured;
+static _Atomic uint32_t frames_filtered;
+static _Atomic uint32_t frames_dropped;
+static _Atomic uint32_t frames_post_failed;
+static _Atomic uint32_t frames_fanout_dropped;
+
+typedef struct {
+    size_t count;
+    void *frames[CONFIG_SNIFFER_BATCH_SIZE];
+} frame_batch_t;
+
+#if SNIFFER_PIPELINED
+static QueueHandle_t aggregate_queue = NULL;                                 // Parse stage -> aggregate stage, whole batches
+static TaskHandle_t aggregate_task = NULL;
+#endif
+
+static capture_filter_t *acquire_filter(uint32_t *index) {
+    while (true) {
+        uint32_t i = atomic_load(&active_filter);
+        atomic_fetch_add(&filter_users[i], 1);
+        if (atomic_load(&active_filter) == i) {                             // Else a setter switched in between
+            *index = i;
+            return &filters[i];
+        }
+        atomic_fetch_sub(&filter_users[i], 1);
+    }
+}
+
+static void filter_lock(void) {
+    if (filter_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (filter_mutex == NULL) {
+            filter_mutex = xSemaphoreCreateMutexStatic(&filter_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTake(filter_mutex, portMAX_DELAY);
+}
+
+static void filter_unlock(void) {
+    xSemaphoreGive(filter_mutex);
+}
+
+/**
+ * @brief Makes the inactive program active and waits until no callback still runs the old one. Called with filter_lock.
+ */
+static void switch_filter_locked(void) {
+    uint32_t old = atomic_load(&active_filter);
+    atomic_store(&active_filter, old ^ 1);
+    while (atomic_load(&filter_users[old]) != 0) {
+        vTaskDelay(1);
+    }
+}
+
+static void run_handlers(wifictl_sniffer_stage_t stage, const frame_batch_t *batch) {
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        wifictl_sniffer_batch_handler_t handler = batch_handlers[stage][h];
+        if (handler != NULL) {
+            handler((const wifictl_frame_t *const *) batch->frames, batch->count);
+        }
+    }
+}
+
+/**
+ * @brief Last stage: aggregation/export handlers, then frames are published to the fan-out, whose
+ *        last consumer releases them.
+ */
+static void aggregate_batch(const frame_batch_t *batch) {
+    uint32_t started_us = METRIC_NOW_US();
+    run_handlers(SNIFFER_STAGE_AGGREGATE, batch);
+    for (size_t i = 0; i < batch->count; i++) {
+        wifictl_frame_t *frame = (wifictl_frame_t *) batch->frames[i];
+        if (!wifictl_fanout_publish(frame)) {                              // Slowest consumer a full ring behind
+            atomic_fetch_add_explicit(&frames_fanout_dropped, 1, memory_order_relaxed);
+            METRIC_INC(METRIC_FANOUT_DROPPED);
+            frame_pool_free(frame);
+        }
+    }
+    wifictl_fanout_notify();
+    METRIC_INC(METRIC_BATCHES);
+    METRIC_SINCE_US(METRIC_HIST_AGGREGATE, started_us);
+}
+
+#if SNIFFER_PIPELINED
+static void aggregate_stage(void *arg) {
+    frame_batch_t batch;
+    while (true) {
+        if (xQueueReceive(aggregate_queue, &batch, portMAX_DELAY) == pdTRUE) {
+            aggregate_batch(&batch);
+        }
+    }
+}
+#endif
+
+/**
+ * @brief First stage: drains capture ring in batches and runs parse handlers.
+ *
+ * Batches are then handed to the aggregate stage pinned to the other core. When the aggregate
+ * queue is full this task blocks, the capture ring fills up and the promiscuous callback drops
+ * and counts frames, so the Wi-Fi driver is never delayed. On single-core builds both stages
+ * run back to back in this task.
+ *
+ * @param arg unused
+ */
+static void parse_stage(void *arg) {
+    frame_batch_t batch;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        METRIC_RECORD(METRIC_HIST_BACKLOG, frame_ring_count(&capture_ring));
+        while ((batch.count = frame_ring_pop_batch(&capture_ring, batch.frames, CONFIG_SNIFFER_BATCH_SIZE)) > 0) {
+            uint32_t started_us = METRIC_NOW_US();
+            for (size_t i = 0; i < batch.count; i++) {
+                METRIC_RECORD(METRIC_HIST_QUEUE_WAIT, started_us - ((wifictl_frame_t *) batch.frames[i])->queued_us);
+            }
+            run_handlers(SNIFFER_STAGE_PARSE, &batch);
+            METRIC_SINCE_US(METRIC_HIST_PARSE, started_us);
+#if SNIFFER_PIPELINED
+            xQueueSend(aggregate_queue, &batch, portMAX_DELAY);
+#else
+            aggregate_batch(&batch);
+#endif
+        }
+    }
+}
+
+/**
+ * @brief Creates the fan-out consumers, the stage queue and the stage tasks.
+ * @note After a partial failure the created objects are kept and the next call creates only the missing ones.
+ **/
+static bool start_stages(void) {
+    if (!wifictl_fanout_start()) {
+        return false;
+    }
+#if SNIFFER_PIPELINED
+    if (aggregate_queue == NULL) {
+        aggregate_queue = xQueueCreate(CONFIG_SNIFFER_PIPELINE_DEPTH, sizeof(frame_batch_t));
+        if (aggregate_queue == NULL) {
+            return false;
+        }
+    }
+    if (aggregate_task == NULL
+        && xTaskCreatePinnedToCore(aggregate_stage, "sniffer_aggregate", 4096, NULL, CONFIG_SNIFFER_TASK_PRIORITY,
+                                   &aggregate_task, CONFIG_SNIFFER_AGGREGATE_CORE) != pdPASS) {
+        aggregate_task = NULL;
+        return false;
+    }
+    BaseType_t created = xTaskCreatePinnedToCore(parse_stage, "sniffer_parse", 4096, NULL, CONFIG_SNIFFER_TASK_PRIORITY,
+                                                 &parse_task, CONFIG_SNIFFER_PARSE_CORE);
+#else
+    BaseType_t created = xTaskCreatePinnedToCore(parse_stage, "sniffer_consumer", 4096, NULL, CONFIG_SNIFFER_TASK_PRIORITY,
+                                                 &parse_task, 0);
+#endif
+    if (created != pdPASS) {
+        parse_task = NULL;                                                  // Marks the pipeline as not started
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief Callback for promiscuous reciever. 
  * 
- * It forwards captured frames into event pool and sorts them based on their type
+ * It copies captured frames into capture ring and sorts them based on their type
  * - Data
  * - Management
  * - Control
  * 
+ * Frames rejected by the capture filter are counted and never copied.
+ * Never blocks: if the ring is full the frame is dropped and counted.
+ *
  * @param buf 
  * @param type 
  */
 static void frame_handler(void *buf, wifi_promiscuous_pkt_type_t type) {
-    ESP_LOGV(TAG, "Captured frame %d.", (int) type);
+    DLOGV(TAG, "Captured frame %d.", (int) type);
 
-    wifi_promiscuous_pkt_t *frame = (wifi_promiscuous_pkt_t *) buf;
+    uint32_t started_us = METRIC_NOW_US();
+    wifi_promiscuous_pkt_t *pkt = (wifi_promiscuous_pkt_t *) buf;
 
     int32_t event_id;
     switch (type) {
         case WIFI_PKT_DATA:
             event_id = SNIFFER_EVENT_CAPTURED_DATA;
+            METRIC_INC(METRIC_FRAMES_DATA);
             break;
         case WIFI_PKT_MGMT:
             event_id = SNIFFER_EVENT_CAPTURED_MGMT;
+            METRIC_INC(METRIC_FRAMES_MGMT);
             break;
         case WIFI_PKT_CTRL:
             event_id = SNIFFER_EVENT_CAPTURED_CTRL;
+            METRIC_INC(METRIC_FRAMES_CTRL);
             break;
         default:
             return;
     }
 
-    ESP_ERROR_CHECK(esp_event_post(SNIFFER_EVENTS, event_id, frame, frame->rx_ctrl.sig_len + sizeof(wifi_promiscuous_pkt_t), portMAX_DELAY));
+    uint32_t filter_index;
+    capture_filter_t *filter = acquire_filter(&filter_index);
+    bool accepted = true;
+    if (filter->insn_count > 0) {
+        uint16_t frame_len = pkt->rx_ctrl.sig_len > 4 ? pkt->rx_ctrl.sig_len - 4 : 0;  // Without FCS
+        accepted = capture_filter_match(filter, pkt->payload, frame_len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel);
+    }
+    atomic_fetch_sub(&filter_users[filter_index], 1);
+    if (!accepted) {
+        atomic_fetch_add_explicit(&frames_filtered, 1, memory_order_relaxed);
+        METRIC_INC(METRIC_FRAMES_FILTERED);
+        METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
+        return;
+    }
+
+    uint32_t seq = capture_seq++;
+    uint16_t len = pkt->rx_ctrl.sig_len + sizeof(wifi_promiscuous_pkt_t);
+    wifictl_frame_t *frame = frame_pool_alloc(offsetof(wifictl_frame_t, pkt) + len);
+    if (frame == NULL) {
+        atomic_fetch_add_explicit(&frames_dropped, 1, memory_order_relaxed);
+        METRIC_INC(METRIC_POOL_EXHAUSTED);
+        METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
+        return;
+    }
+    frame->seq = seq;
+    frame->queued_us = started_us;
+    frame->event_id = event_id;
+    frame->len = len;
+    memcpy(&frame->pkt, pkt, len);
+
+    if (!frame_ring_push(&capture_ring, frame)) {
+        frame_pool_free(frame);
+        atomic_fetch_add_explicit(&frames_dropped, 1, memory_order_relaxed);
+        METRIC_INC(METRIC_RING_FULL);
+        METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
+        return;
+    }
+    atomic_fetch_add_explicit(&frames_captured, 1, memory_order_relaxed);
+    xTaskNotifyGive(parse_task);
+    METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
 }
 
 /**
@@ -61,28 +304,125 @@ void wifictl_sniffer_filter_frame_types(bool data, bool mgmt, bool ctrl) {
     if(data) {
         filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
     }
-    else if(mgmt) {
+    if(mgmt) {
         filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
     }
-    else if(ctrl) {
+    if(ctrl) {
         filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
     }
-    esp_wifi_set_promiscuous_filter(&filter);
+    wifictl_radio()->set_promiscuous_filter(&filter);
+}
+
+esp_err_t wifictl_sniffer_set_filter(const char *expr, const char **error) {
+    filter_lock();
+    capture_filter_t *compiled = &filters[atomic_load(&active_filter) ^ 1];  // No callback runs the inactive program
+    if (!capture_filter_compile(compiled, expr, error)) {
+        filter_unlock();
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t insn_count = compiled->insn_count;
+    switch_filter_locked();
+    filter_unlock();
+    ESP_LOGI(TAG, "Capture filter set (%u instructions)", insn_count);
+    return ESP_OK;
+}
+
+void wifictl_sniffer_get_filter(capture_filter_t *filter) {
+    filter_lock();                                                          // Active program cannot change meanwhile
+    *filter = filters[atomic_load(&active_filter)];
+    filter_unlock();
+}
+
+void wifictl_sniffer_reset_filter_stats(void) {
+    filter_lock();                                                          // Counters have one writer: a fresh copy
+    uint32_t active = atomic_load(&active_filter);
+    filters[active ^ 1] = filters[active];
+    capture_filter_reset_stats(&filters[active ^ 1]);
+    switch_filter_locked();
+    filter_unlock();
 }
 
 // Main function from sniffer.c
-void wifictl_sniffer_start(uint8_t channel) {
+esp_err_t wifictl_sniffer_start(uint8_t channel) {
     ESP_LOGI(TAG, "Starting promiscuous mode...");
-    // ESP32 cannot switch port, if there is some STA connected to AP
-    ESP_LOGD(TAG, "Kicking all connected STAs from AP");
-    ESP_ERROR_CHECK(esp_wifi_deauth_sta(0));
-    esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
-    esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(&frame_handler);
+    if (parse_task == NULL) {                                               // Capture ring and stage tasks are created once
+        if (!frame_ring_init(&capture_ring, capture_ring_slots, CONFIG_SNIFFER_RING_SIZE)) {
+            ESP_LOGE(TAG, "Invalid capture ring size %d", CONFIG_SNIFFER_RING_SIZE);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (!start_stages()) {
+            ESP_LOGE(TAG, "Failed to create capture pipeline tasks");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    esp_err_t err = wifictl_mode_enter(WIFICTL_MODE_SNIFFING);             // Initializes Wi-Fi, cancels a running scan
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Wi-Fi not available: %s", esp_err_to_name(err));
+        return err;
+    }
+    wifictl_mode_lock();                                                    // Not entered for the scan callbacks of a cancelled scan
+    if (wifictl_mode_get() != WIFICTL_MODE_SNIFFING) {                      // Switched away meanwhile
+        wifictl_mode_unlock();
+        return ESP_ERR_INVALID_STATE;
+    }
+    wifictl_radio_set_channel(channel);
+    err = wifictl_radio()->set_promiscuous(true, &frame_handler);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable promiscuous mode: %s", esp_err_to_name(err));
+        wifictl_mode_leave(WIFICTL_MODE_SNIFFING, esp_timer_get_time());
+    }
+    wifictl_mode_unlock();
+    return err;
 }
 
 // Stop function for sniffer.c
 void wifictl_sniffer_stop() {
     ESP_LOGI(TAG, "Stopping promiscuous mode...");
-    esp_wifi_set_promiscuous(false);
-}
\ No newline at end of file
+    int64_t started_us = esp_timer_get_time();
+    wifictl_mode_lock();                                                    // A concurrent start cannot re-enable in between
+    wifictl_radio()->set_promiscuous(false, NULL);
+    wifictl_mode_leave(WIFICTL_MODE_SNIFFING, started_us);
+    wifictl_mode_unlock();
+}
+
+void wifictl_sniffer_get_stats(wifictl_sniffer_stats_t *stats) {
+    stats->captured = atomic_load_explicit(&frames_captured, memory_order_relaxed);
+    stats->filtered = atomic_load_explicit(&frames_filtered, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&frames_dropped, memory_order_relaxed);
+    stats->post_failed = atomic_load_explicit(&frames_post_failed, memory_order_relaxed);
+    stats->fanout_dropped = atomic_load_explicit(&frames_fanout_dropped, memory_order_relaxed);
+}
+
+void wifictl_sniffer_post_event(const wifictl_frame_t *frame) {
+    if (esp_event_post(SNIFFER_EVENTS, frame->event_id, &frame->pkt, frame->len, pdMS_TO_TICKS(10)) != ESP_OK) {
+        atomic_fetch_add_explicit(&frames_post_failed, 1, memory_order_relaxed);
+        METRIC_INC(METRIC_EVENT_POST_FAILED);
+    }
+}
+
+bool wifictl_sniffer_register_batch_handler(wifictl_sniffer_stage_t stage, wifictl_sniffer_batch_handler_t handler) {
+    wifictl_sniffer_batch_handler_t *handlers = batch_handlers[stage];
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        if (handlers[h] == handler) {                                       // Already registered
+            return true;
+        }
+    }
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        if (handlers[h] == NULL) {
+            handlers[h] = handler;
+            return true;
+        }
+    }
+    ESP_LOGE(TAG, "No free batch handler slot");
+    return false;
+}
+
+void wifictl_sniffer_unregister_batch_handler(wifictl_sniffer_batch_handler_t handler) {
+    for (int stage = 0; stage < SNIFFER_STAGE_COUNT; stage++) {
+        for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+            if (batch_handlers[stage][h] == handler) {
+                batch_handlers[stage][h] = NULL;
+            }
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/**
+ * @file sniffer_fanout.cpp
+ * @brief Instantiates the frame fan-out with the sniffer's consumers and runs one task per consumer.
+ */
+#include "sniffer_fanout.h"
+
+#include <utility>
+#include "frame_fanout.hpp"
+#include "sketch_monitor.h"
+
+extern "C" {
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "frame_pool.h"
+}
+
+using wifictl::FrameFanout;
+
+namespace {
+
+struct PoolRelease {
+    void operator()(wifictl_frame_t *frame) const { frame_pool_free(frame); }
+};
+
+/** @brief Posts frames to SNIFFER_EVENTS for event loop subscribers; the post copies each frame once. */
+struct EventLoopConsumer {
+    static constexpr const char *kName = "events";
+    void on_frame(const wifictl_frame_t &frame) { wifictl_sniffer_post_event(&frame); }
+};
+
+/** @brief Adds frames to the traffic sketches while they are collecting. */
+struct SketchConsumer {
+    static constexpr const char *kName = "sketch";
+    void on_frame(const wifictl_frame_t &frame) { wifictl_sketch_add_frame(&frame); }
+};
+
+EventLoopConsumer event_loop_consumer;
+SketchConsumer sketch_consumer;
+
+using SnifferFanout =
+    FrameFanout<wifictl_frame_t, PoolRelease, CONFIG_SNIFFER_FANOUT_DEPTH, EventLoopConsumer, SketchConsumer>;
+
+SnifferFanout fanout(event_loop_consumer, sketch_consumer);
+TaskHandle_t consumer_tasks[SnifferFanout::kConsumers] = {};
+
+template <size_t I>
+void consumer_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (fanout.drain<I>(CONFIG_SNIFFER_BATCH_SIZE) > 0) {
+        }
+    }
+}
+
+template <size_t... I>
+bool start_tasks(std::index_sequence<I...>) {
+    const char *names[] = { std::remove_reference_t<decltype(fanout.consumer<I>())>::kName... };
+    return ((xTaskCreatePinnedToCore(consumer_task<I>, names[I], 3072, nullptr, CONFIG_SNIFFER_FANOUT_TASK_PRIORITY,
+                                     &consumer_tasks[I], CONFIG_SNIFFER_AGGREGATE_CORE) == pdPASS) && ...);
+}
+
+template <size_t... I>
+void copy_stats(wifictl_fanout_consumer_stats_t *stats, size_t max, std::index_sequence<I...>) {
+    ((I < max ? (void) (stats[I] = { std::remove_reference_t<decltype(fanout.consumer<I>())>::kName,
+                                     (uint32_t) fanout.delivered<I>(), (uint32_t) fanout.backlog<I>() })
+              : (void) 0), ...);
+}
+
+/** @brief Benchmark consumer: reads the frame like a real consumer would. */
+template <size_t I>
+struct TouchConsumer {
+    uint32_t sum = 0;
+    void on_frame(const wifictl_frame_t &frame) { sum += frame.pkt.payload[frame.pkt.rx_ctrl.sig_len - 1]; }
+};
+
+struct CountRelease {
+    void operator()(wifictl_frame_t *frame) const { frame->seq++; }
+};
+
+template <size_t... I>
+uint32_t benchmark(std::index_sequence<I...>, uint32_t frames, wifictl_frame_t *frame) {
+    static std::tuple<TouchConsumer<I>...> consumers;
+    static FrameFanout<wifictl_frame_t, CountRelease, CONFIG_SNIFFER_FANOUT_DEPTH, TouchConsumer<I>...> bench(
+        std::get<I>(consumers)...);
+    int64_t started_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < frames; i++) {
+        while (!bench.publish(frame)) {
+            bench.drain_all(CONFIG_SNIFFER_BATCH_SIZE);
+        }
+        if (i % CONFIG_SNIFFER_BATCH_SIZE == CONFIG_SNIFFER_BATCH_SIZE - 1) {  // Consumers drain per batch, as in capture
+            bench.drain_all(CONFIG_SNIFFER_BATCH_SIZE);
+        }
+    }
+    while (bench.drain_all(CONFIG_SNIFFER_BATCH_SIZE) > 0) {
+    }
+    return frames ? (uint32_t) ((esp_timer_get_time() - started_us) * 1000 / frames) : 0;
+}
+
+template <size_t... N>
+void benchmark_all(std::index_sequence<N...>, uint32_t frames, wifictl_frame_t *frame, uint32_t *ns_per_frame) {
+    ((ns_per_frame[N] = benchmark(std::make_index_sequence<N + 1>(), frames, frame)), ...);
+}
+
+}  // namespace
+
+bool wifictl_fanout_start(void) {
+    if (consumer_tasks[0] != nullptr) {
+        return true;
+    }
+    if (start_tasks(std::make_index_sequence<SnifferFanout::kConsumers>())) {
+        return true;
+    }
+    for (TaskHandle_t &task : consumer_tasks) {                             // All or none, the next start retries
+        if (task != nullptr) {
+            vTaskDelete(task);
+            task = nullptr;
+        }
+    }
+    return false;
+}
+
+bool wifictl_fanout_publish(wifictl_frame_t *frame) {
+    return fanout.publish(frame);
+}
+
+void wifictl_fanout_notify(void) {
+    for (TaskHandle_t task : consumer_tasks) {
+        if (task != nullptr) {                                              // Not started
+            xTaskNotifyGive(task);
+        }
+    }
+}
+
+size_t wifictl_fanout_get_stats(wifictl_fanout_consumer_stats_t *stats, size_t max) {
+    copy_stats(stats, max, std::make_index_sequence<SnifferFanout::kConsumers>());
+    return SnifferFanout::kConsumers;
+}
+
+void wifictl_fanout_benchmark(uint32_t frames, uint32_t ns_per_frame[SNIFFER_FANOUT_BENCH_MAX_CONSUMERS]) {
+    static struct {
+        wifictl_frame_t frame;
+        uint8_t payload[256];                                               // Typical management frame
+    } sample;
+    sample.frame.pkt.rx_ctrl.sig_len = sizeof(sample.payload);
+    benchmark_all(std::make_index_sequence<SNIFFER_FANOUT_BENCH_MAX_CONSUMERS>(), frames, &sample.frame, ns_per_frame);
+}
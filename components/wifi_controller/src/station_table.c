@@ -0,0 +1,265 @@
+/**
+ * @file station_table.c
+ * @brief Implements station inventory with LRU eviction.
+ */
+#include "station_table.h"
+
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "sniffer.h"
+
+_Static_assert((CONFIG_STATION_TABLE_CAPACITY & (CONFIG_STATION_TABLE_CAPACITY - 1)) == 0 && CONFIG_STATION_TABLE_CAPACITY < 0x8000,
+               "CONFIG_STATION_TABLE_CAPACITY must be a power of two below 32768");
+
+#define INDEX_SIZE (2 * CONFIG_STATION_TABLE_CAPACITY)
+#define INDEX_MASK (INDEX_SIZE - 1)
+#define NIL 0xFFFF
+
+#define FC_TYPE_DATA 2
+#define FC_TO_DS   0x01                                                     // Flag bits in the second FC byte
+#define FC_FROM_DS 0x02
+
+typedef struct {
+    wifictl_station_t station;
+    uint16_t prev;                                                          // Towards most recently seen
+    uint16_t next;                                                          // Towards least recently seen, free list link
+} station_entry_t;
+
+static uint16_t index_slots[INDEX_SIZE];
+static station_entry_t entries[CONFIG_STATION_TABLE_CAPACITY];
+static uint16_t lru_head = NIL;                                             // Most recently seen
+static uint16_t lru_tail = NIL;                                             // Eviction candidate
+static uint16_t free_head = NIL;
+static size_t used_count = 0;
+static bool initialized = false;
+static wifictl_station_table_stats_t stats;
+
+static SemaphoreHandle_t table_mutex = NULL;
+static StaticSemaphore_t table_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void table_lock(void) {
+    if (table_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (table_mutex == NULL) {
+            table_mutex = xSemaphoreCreateMutexStatic(&table_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTake(table_mutex, portMAX_DELAY);
+}
+
+static void table_unlock(void) {
+    xSemaphoreGive(table_mutex);
+}
+
+static void reset_locked(void) {
+    memset(index_slots, 0xFF, sizeof(index_slots));
+    for (uint16_t i = 0; i < CONFIG_STATION_TABLE_CAPACITY; i++) {
+        entries[i].next = i + 1 < CONFIG_STATION_TABLE_CAPACITY ? i + 1 : NIL;
+    }
+    free_head = 0;
+    lru_head = lru_tail = NIL;
+    used_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    initialized = true;
+}
+
+static uint32_t home_slot(const uint8_t mac[6]) {
+    uint64_t key = 0;
+    memcpy(&key, mac, 6);
+    return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 40) & INDEX_MASK;      // High product bits depend on all six bytes
+}
+
+static uint32_t find_slot_locked(const uint8_t mac[6]) {                    // Returns slot holding mac or INDEX_SIZE
+    for (uint32_t slot = home_slot(mac); index_slots[slot] != NIL; slot = (slot + 1) & INDEX_MASK) {
+        if (memcmp(entries[index_slots[slot]].station.mac, mac, 6) == 0) {
+            return slot;
+        }
+    }
+    return INDEX_SIZE;
+}
+
+static void lru_unlink(uint16_t id) {
+    station_entry_t *e = &entries[id];
+    if (e->prev != NIL) {
+        entries[e->prev].next = e->next;
+    } else {
+        lru_head = e->next;
+    }
+    if (e->next != NIL) {
+        entries[e->next].prev = e->prev;
+    } else {
+        lru_tail = e->prev;
+    }
+}
+
+static void lru_push_front(uint16_t id) {
+    entries[id].prev = NIL;
+    entries[id].next = lru_head;
+    if (lru_head != NIL) {
+        entries[lru_head].prev = id;
+    }
+    lru_head = id;
+    if (lru_tail == NIL) {
+        lru_tail = id;
+    }
+}
+
+static void evict_locked(uint16_t id) {
+    uint32_t hole = find_slot_locked(entries[id].station.mac);
+    // Backward-shift deletion keeps probe sequences intact without tombstones
+    for (uint32_t next = (hole + 1) & INDEX_MASK; index_slots[next] != NIL; next = (next + 1) & INDEX_MASK) {
+        uint32_t home = home_slot(entries[index_slots[next]].station.mac);
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays) {
+            index_slots[hole] = index_slots[next];
+            hole = next;
+        }
+    }
+    index_slots[hole] = NIL;
+    lru_unlink(id);
+    entries[id].next = free_head;
+    free_head = id;
+    used_count--;
+    stats.evictions++;
+}
+
+static bool update_locked(const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel, uint32_t now_ms) {
+    if (!initialized) {
+        reset_locked();
+    }
+    if (len < 24 || ((frame[0] >> 2) & 0x3) != FC_TYPE_DATA) {
+        stats.ignored++;
+        return false;
+    }
+
+    const uint8_t *client;
+    const uint8_t *bssid;
+    bool uplink;
+    switch (frame[1] & (FC_TO_DS | FC_FROM_DS)) {
+        case FC_TO_DS:                                                      // Client -> AP: addr1 BSSID, addr2 SA
+            bssid = &frame[4];
+            client = &frame[10];
+            uplink = true;
+            break;
+        case FC_FROM_DS:                                                    // AP -> client: addr1 DA, addr2 BSSID
+            client = &frame[4];
+            bssid = &frame[10];
+            uplink = false;
+            break;
+        case 0:                                                             // Direct/IBSS: addr2 SA, addr3 BSSID
+            client = &frame[10];
+            bssid = &frame[16];
+            uplink = true;
+            if (memcmp(client, bssid, 6) == 0) {
+                stats.ignored++;
+                return false;
+            }
+            break;
+        default:                                                            // WDS: no single BSSID
+            stats.ignored++;
+            return false;
+    }
+    if (client[0] & 0x01) {                                                 // Group address, not a station
+        stats.ignored++;
+        return false;
+    }
+
+    uint16_t id;
+    uint32_t slot = find_slot_locked(client);
+    if (slot != INDEX_SIZE) {
+        id = index_slots[slot];
+        lru_unlink(id);
+    } else {
+        if (free_head == NIL) {
+            evict_locked(lru_tail);
+        }
+        id = free_head;
+        free_head = entries[id].next;
+        memset(&entries[id].station, 0, sizeof(entries[id].station));
+        memcpy(entries[id].station.mac, client, 6);
+        for (slot = home_slot(client); index_slots[slot] != NIL; slot = (slot + 1) & INDEX_MASK) {
+        }
+        index_slots[slot] = id;
+        used_count++;
+    }
+    lru_push_front(id);
+
+    wifictl_station_t *st = &entries[id].station;
+    memcpy(st->bssid, bssid, 6);
+    st->frames++;
+    st->bytes += len;
+    st->last_seen_ms = now_ms;
+    st->channel = channel;
+    if (uplink) {
+        st->rssi = rssi;
+    }
+    stats.updates++;
+    return true;
+}
+
+bool wifictl_station_table_update(const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel, uint32_t now_ms) {
+    table_lock();
+    bool attributed = update_locked(frame, len, rssi, channel, now_ms);
+    table_unlock();
+    return attributed;
+}
+
+size_t wifictl_station_table_snapshot(wifictl_station_t *out, size_t max, const uint8_t *bssid) {
+    size_t n = 0;
+    table_lock();
+    if (initialized) {
+        for (uint16_t id = lru_head; id != NIL && n < max; id = entries[id].next) {
+            if (bssid == NULL || memcmp(entries[id].station.bssid, bssid, 6) == 0) {
+                out[n++] = entries[id].station;
+            }
+        }
+    }
+    table_unlock();
+    return n;
+}
+
+size_t wifictl_station_table_count(void) {
+    return used_count;
+}
+
+void wifictl_station_table_get_stats(wifictl_station_table_stats_t *out) {
+    table_lock();
+    *out = stats;
+    table_unlock();
+}
+
+void wifictl_station_table_clear(void) {
+    table_lock();
+    reset_locked();
+    table_unlock();
+}
+
+/**
+ * @brief Sniffer batch handler applying data frames, one lock per batch.
+ */
+static void track_stations(const wifictl_frame_t *const *frames, size_t count) {
+    uint32_t now_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    table_lock();
+    for (size_t i = 0; i < count; i++) {
+        const wifictl_frame_t *frame = frames[i];
+        if (frame->event_id != SNIFFER_EVENT_CAPTURED_DATA || frame->pkt.rx_ctrl.sig_len <= 4) {
+            continue;
+        }
+        update_locked(frame->pkt.payload, frame->pkt.rx_ctrl.sig_len - 4, frame->pkt.rx_ctrl.rssi,  // Strip FCS
+                      frame->pkt.rx_ctrl.channel, now_ms);
+    }
+    table_unlock();
+}
+
+bool wifictl_station_table_track(bool enable) {
+    if (!enable) {
+        wifictl_sniffer_unregister_batch_handler(track_stations);
+        return true;
+    }
+    return wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, track_stations);
+}
@@ -0,0 +1,281 @@
+/**
+ * @file traffic_sketch.c
+ * @brief Implements HyperLogLog, Count-Min and Space-Saving summaries of captured traffic.
+ */
+#include "traffic_sketch.h"
+
+#include <math.h>
+#include <string.h>
+
+#define CMS_COLUMN_BITS __builtin_ctz(CONFIG_SKETCH_CMS_WIDTH)
+
+_Static_assert(CONFIG_SKETCH_HLL_PRECISION >= 4 && CONFIG_SKETCH_HLL_PRECISION <= 16, "CONFIG_SKETCH_HLL_PRECISION out of range");
+_Static_assert((CONFIG_SKETCH_CMS_WIDTH & (CONFIG_SKETCH_CMS_WIDTH - 1)) == 0, "CONFIG_SKETCH_CMS_WIDTH must be a power of two");
+_Static_assert(CONFIG_SKETCH_CMS_DEPTH * CMS_COLUMN_BITS <= 64, "Count-Min rows need more hash bits than a MAC hash has");
+
+static inline uint32_t add_saturated(uint32_t a, uint32_t b) {
+    return a + b < a ? UINT32_MAX : a + b;
+}
+
+uint64_t sketch_hash_mac(const uint8_t mac[6]) {
+    uint64_t x = 0;
+    for (int i = 0; i < 6; i++) {
+        x = x << 8 | mac[i];
+    }
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+void sketch_hll_add(sketch_hll_t *hll, uint64_t hash) {
+    uint32_t index = (uint32_t) (hash >> (64 - CONFIG_SKETCH_HLL_PRECISION));
+    uint64_t rest = hash << CONFIG_SKETCH_HLL_PRECISION | 1ull << (CONFIG_SKETCH_HLL_PRECISION - 1);  // Guard bit caps the rank
+    uint8_t rank = (uint8_t) (__builtin_clzll(rest) + 1);
+    if (rank > hll->registers[index]) {
+        hll->registers[index] = rank;
+    }
+}
+
+void sketch_hll_merge(sketch_hll_t *dst, const sketch_hll_t *src) {
+    for (int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        if (src->registers[i] > dst->registers[i]) {
+            dst->registers[i] = src->registers[i];
+        }
+    }
+}
+
+uint32_t sketch_hll_estimate(const sketch_hll_t *hll) {
+    const float m = SKETCH_HLL_REGISTERS;
+    float sum = 0;
+    unsigned zeros = 0;
+    for (int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        sum += ldexpf(1.0f, -hll->registers[i]);
+        zeros += hll->registers[i] == 0;
+    }
+    float alpha = SKETCH_HLL_REGISTERS == 16 ? 0.673f : SKETCH_HLL_REGISTERS == 32 ? 0.697f :
+                  SKETCH_HLL_REGISTERS == 64 ? 0.709f : 0.7213f / (1.0f + 1.079f / m);
+    float estimate = alpha * m * m / sum;
+    if (estimate <= 2.5f * m && zeros > 0) {                                // Small range: linear counting is more accurate
+        estimate = m * logf(m / (float) zeros);
+    }
+    return (uint32_t) (estimate + 0.5f);
+}
+
+/**
+ * @brief Counter of row in the Count-Min sketch. Every row takes its own bits of the hash, so rows are
+ *        independent; double hashing would make two MACs that collide in two rows collide in all of them.
+ */
+static inline uint32_t cms_column(uint64_t hash, unsigned row) {
+    return (uint32_t) (hash >> (row * CMS_COLUMN_BITS)) & (CONFIG_SKETCH_CMS_WIDTH - 1);
+}
+
+void sketch_cms_add(sketch_cms_t *cms, uint64_t hash, uint32_t weight) {
+    for (unsigned row = 0; row < CONFIG_SKETCH_CMS_DEPTH; row++) {
+        uint32_t *counter = &cms->counters[row][cms_column(hash, row)];
+        *counter = add_saturated(*counter, weight);
+    }
+}
+
+void sketch_cms_merge(sketch_cms_t *dst, const sketch_cms_t *src) {
+    for (unsigned row = 0; row < CONFIG_SKETCH_CMS_DEPTH; row++) {
+        for (unsigned i = 0; i < CONFIG_SKETCH_CMS_WIDTH; i++) {
+            dst->counters[row][i] = add_saturated(dst->counters[row][i], src->counters[row][i]);
+        }
+    }
+}
+
+uint32_t sketch_cms_estimate(const sketch_cms_t *cms, uint64_t hash) {
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned row = 0; row < CONFIG_SKETCH_CMS_DEPTH; row++) {
+        uint32_t counter = cms->counters[row][cms_column(hash, row)];
+        if (counter < estimate) {
+            estimate = counter;
+        }
+    }
+    return estimate;
+}
+
+void sketch_topk_add(sketch_topk_t *topk, const uint8_t mac[6], uint32_t weight) {
+    size_t smallest = 0;
+    for (size_t i = 0; i < topk->size; i++) {
+        sketch_talker_t *entry = &topk->entries[i];
+        if (memcmp(entry->mac, mac, 6) == 0) {
+            entry->count = add_saturated(entry->count, weight);
+            return;
+        }
+        if (entry->count < topk->entries[smallest].count) {
+            smallest = i;
+        }
+    }
+    sketch_talker_t *entry;
+    if (topk->size < CONFIG_SKETCH_TOPK) {
+        entry = &topk->entries[topk->size++];
+        entry->count = 0;
+    } else {
+        entry = &topk->entries[smallest];                                   // Inherits the evicted count as error
+    }
+    memcpy(entry->mac, mac, 6);
+    entry->error = entry->count;
+    entry->count = add_saturated(entry->count, weight);
+}
+
+static uint32_t topk_floor(const sketch_topk_t *topk) {
+    if (topk->size < CONFIG_SKETCH_TOPK) {
+        return 0;                                                           // Not full: absent MACs were never seen
+    }
+    uint32_t floor = UINT32_MAX;
+    for (size_t i = 0; i < topk->size; i++) {
+        if (topk->entries[i].count < floor) {
+            floor = topk->entries[i].count;
+        }
+    }
+    return floor;
+}
+
+static const sketch_talker_t *topk_find(const sketch_topk_t *topk, const uint8_t mac[6]) {
+    for (size_t i = 0; i < topk->size; i++) {
+        if (memcmp(topk->entries[i].mac, mac, 6) == 0) {
+            return &topk->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static void sort_descending(sketch_talker_t *entries, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        sketch_talker_t entry = entries[i];
+        size_t j = i;
+        for (; j > 0 && entries[j - 1].count < entry.count; j--) {
+            entries[j] = entries[j - 1];
+        }
+        entries[j] = entry;
+    }
+}
+
+void sketch_topk_merge(sketch_topk_t *dst, const sketch_topk_t *src) {
+    sketch_talker_t merged[2 * CONFIG_SKETCH_TOPK];
+    size_t count = 0;
+    uint32_t dst_floor = topk_floor(dst);
+    uint32_t src_floor = topk_floor(src);
+    for (size_t i = 0; i < dst->size; i++) {
+        sketch_talker_t entry = dst->entries[i];
+        const sketch_talker_t *other = topk_find(src, entry.mac);
+        entry.count = add_saturated(entry.count, other ? other->count : src_floor);
+        entry.error = add_saturated(entry.error, other ? other->error : src_floor);
+        merged[count++] = entry;
+    }
+    for (size_t i = 0; i < src->size; i++) {
+        if (topk_find(dst, src->entries[i].mac) != NULL) {
+            continue;                                                       // Merged above
+        }
+        sketch_talker_t entry = src->entries[i];
+        entry.count = add_saturated(entry.count, dst_floor);
+        entry.error = add_saturated(entry.error, dst_floor);
+        merged[count++] = entry;
+    }
+    sort_descending(merged, count);
+    dst->size = count < CONFIG_SKETCH_TOPK ? count : CONFIG_SKETCH_TOPK;
+    memcpy(dst->entries, merged, dst->size * sizeof(sketch_talker_t));
+}
+
+size_t sketch_topk_sorted(const sketch_topk_t *topk, sketch_talker_t *out, size_t max) {
+    sketch_talker_t sorted[CONFIG_SKETCH_TOPK];
+    memcpy(sorted, topk->entries, topk->size * sizeof(sketch_talker_t));
+    sort_descending(sorted, topk->size);
+    size_t count = topk->size < max ? topk->size : max;
+    memcpy(out, sorted, count * sizeof(sketch_talker_t));
+    return count;
+}
+
+void sketch_window_init(sketch_window_t *window) {
+    memset(window, 0, sizeof(*window));
+}
+
+/**
+ * @brief Returns the slot of bssid, claiming a free one for a new BSSID. NULL if every slot is taken.
+ */
+static sketch_bssid_t *claim_bssid(sketch_window_t *window, const uint8_t bssid[6]) {
+    for (int i = 0; i < CONFIG_SKETCH_BSSIDS; i++) {
+        sketch_bssid_t *slot = &window->bssids[i];
+        if (!slot->used) {                                                  // Slots are claimed in order
+            slot->used = true;
+            memcpy(slot->bssid, bssid, 6);
+            return slot;
+        }
+        if (memcmp(slot->bssid, bssid, 6) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void sketch_window_add(sketch_window_t *window, uint8_t channel, const uint8_t transmitter[6], const uint8_t *bssid,
+                       const uint8_t *client, uint32_t bytes) {
+    uint64_t hash = sketch_hash_mac(transmitter);
+    window->frames++;
+    window->bytes = add_saturated(window->bytes, bytes);
+    if (channel >= 1 && channel <= SKETCH_CHANNELS) {
+        sketch_hll_add(&window->channels[channel - 1], hash);
+    }
+    sketch_topk_add(&window->talkers[SKETCH_FRAMES], transmitter, 1);
+    sketch_topk_add(&window->talkers[SKETCH_BYTES], transmitter, bytes);
+    sketch_cms_add(&window->counts[SKETCH_FRAMES], hash, 1);
+    sketch_cms_add(&window->counts[SKETCH_BYTES], hash, bytes);
+
+    if (bssid == NULL) {
+        return;
+    }
+    sketch_bssid_t *slot = claim_bssid(window, bssid);
+    if (slot == NULL) {
+        window->bssid_overflow++;
+        return;
+    }
+    slot->channel = channel;
+    slot->frames++;
+    if (client != NULL) {
+        sketch_hll_add(&slot->clients, client == transmitter ? hash : sketch_hash_mac(client));
+    }
+}
+
+void sketch_window_merge(sketch_window_t *dst, const sketch_window_t *src) {
+    for (int c = 0; c < SKETCH_CHANNELS; c++) {
+        sketch_hll_merge(&dst->channels[c], &src->channels[c]);
+    }
+    for (int i = 0; i < CONFIG_SKETCH_BSSIDS && src->bssids[i].used; i++) {
+        const sketch_bssid_t *from = &src->bssids[i];
+        sketch_bssid_t *to = claim_bssid(dst, from->bssid);
+        if (to == NULL) {
+            dst->bssid_overflow = add_saturated(dst->bssid_overflow, from->frames);
+            continue;
+        }
+        to->channel = from->channel;
+        to->frames = add_saturated(to->frames, from->frames);
+        sketch_hll_merge(&to->clients, &from->clients);
+    }
+    for (int m = 0; m < SKETCH_METRICS; m++) {
+        sketch_topk_merge(&dst->talkers[m], &src->talkers[m]);
+        sketch_cms_merge(&dst->counts[m], &src->counts[m]);
+    }
+    dst->frames = add_saturated(dst->frames, src->frames);
+    dst->bytes = add_saturated(dst->bytes, src->bytes);
+    dst->bssid_overflow = add_saturated(dst->bssid_overflow, src->bssid_overflow);
+}
+
+void sketch_window_carry_bssids(sketch_window_t *dst, const sketch_window_t *src) {
+    for (int i = 0; i < CONFIG_SKETCH_BSSIDS && src->bssids[i].used; i++) {
+        sketch_bssid_t *slot = claim_bssid(dst, src->bssids[i].bssid);
+        if (slot != NULL) {
+            slot->channel = src->bssids[i].channel;
+        }
+    }
+}
+
+const sketch_bssid_t *sketch_window_find_bssid(const sketch_window_t *window, const uint8_t bssid[6]) {
+    for (int i = 0; i < CONFIG_SKETCH_BSSIDS && window->bssids[i].used; i++) {
+        if (memcmp(window->bssids[i].bssid, bssid, 6) == 0) {
+            return &window->bssids[i];
+        }
+    }
+    return NULL;
+}
@@ -1,61 +1,199 @@
 #include "wifi_controller.h"
 
 #include <stdio.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "ap_scanner.h"
+#include "sniffer.h"
+#include "channel_hopper.h"
+#include "deferred_log.h"
 
 
 #define TAG "wifi_controller"
 
-bool wifi_init = false; // Flag to track WiFi initialization status
+static _Atomic int current_mode = WIFICTL_MODE_UNINIT;                // wifictl_mode_t, left without the mutex
+static SemaphoreHandle_t mode_mutex = NULL;                           // Serializes mode changes and lifecycle, recursive
+static StaticSemaphore_t mode_mutex_buffer;
+static portMUX_TYPE init_lock = portMUX_INITIALIZER_UNLOCKED;
+static wifictl_lifecycle_stats_t lifecycle;
+static bool switching = false;                                        // wifictl_mode_enter records the whole transition
 
 
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT) {                                   // Check if the event is from the WiFi subsystem
         switch (event_id) {
-            case WIFI_EVENT_SCAN_DONE:                                // If the scan is done
-                ESP_LOGI(TAG, "Wi-Fi scan completed successfully!");  break;
-            case WIFI_EVENT_STA_START:                                // If the station starts
-                ESP_LOGI(TAG, "Station started.");
-                esp_wifi_connect();                                   break;
+            case WIFI_EVENT_SCAN_DONE:                                // If the scan of one channel is done
+                wifictl_scan_on_done();                               break;
+            case WIFI_EVENT_STA_START:                                // Driver is up, nothing to connect to
+                DLOGI(TAG, "Station started.");                       break;
             case WIFI_EVENT_STA_CONNECTED:                            // If the station connects to an AP
-                ESP_LOGI(TAG, "Station connected to AP.");            break;
+                DLOGI(TAG, "Station connected to AP.");               break;
             case WIFI_EVENT_STA_DISCONNECTED:                         // If the station disconnects from an AP
-                ESP_LOGI(TAG, "Station disconnected from AP.");
-                esp_wifi_connect();                                   break;
+                DLOGI(TAG, "Station disconnected from AP.");          break;
             default:                                                  // Default
-                ESP_LOGI(TAG, "Unhandled WiFi event: %ld", event_id); break;
+                DLOGD(TAG, "Unhandled WiFi event: %ld", event_id);    break;
         }
     }
 }
 
-bool wifi_controller_sta_init() {
-    if (wifi_init) {                                                  // Check if WiFi is already initialized
-        ESP_LOGW("WiFi", "Wi-Fi already initialized.");   
-        return false;     
-    }     
+static esp_err_t init_nvs(void) {
+    esp_err_t err = nvs_flash_init();                                 // Required by the Wi-Fi driver
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_LOGW(TAG, "NVS partition unusable (%s), erasing", esp_err_to_name(err));
+        err = nvs_flash_erase();
+        if (err == ESP_OK) {
+            err = nvs_flash_init();
+        }
+    }
+    return err;
+}
 
-    ESP_LOGI(TAG, "Initializing Wi-Fi...");   
-    ESP_ERROR_CHECK(nvs_flash_init());                                // Initialize NVS (required for WiFi)
-    ESP_ERROR_CHECK(esp_netif_init());                                // Initialize network interface
-    ESP_ERROR_CHECK(esp_event_loop_create_default());                 // Create default event loop
+static esp_err_t init_driver(void) {
+    ESP_LOGI(TAG, "Initializing Wi-Fi...");
+    esp_err_t err = init_nvs();
+    if (err == ESP_OK) {
+        err = esp_netif_init();                                       // Initialize network interface
+    }
+    if (err == ESP_OK) {
+        err = esp_event_loop_create_default();                        // Create default event loop
+        if (err == ESP_ERR_INVALID_STATE) {                           // Already created by someone else
+            err = ESP_OK;
+        }
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
     esp_netif_create_default_wifi_sta();                              // Create default Wi-Fi station interface
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();              // Initialize Wi-Fi configuration
-    esp_wifi_init(&cfg);                                              // Initialize Wi-Fi
-
-    esp_event_handler_instance_t instance;                            // Register event handler
-    esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL, &instance);
-    
-    esp_wifi_set_mode(WIFI_MODE_STA);                                 // Set Wi-Fi mode to station
-    esp_wifi_start();                                                 // Start Wi-Fi
-
-    wifi_init = true;                                                 // Mark as initialized
-    ESP_LOGI("WiFi", "Wi-Fi successfully initialized.");
-    return true;
-}
\ No newline at end of file
+    err = esp_wifi_init(&cfg);
+    if (err == ESP_OK) {
+        err = esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler, NULL, NULL);
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_set_storage(WIFI_STORAGE_RAM);                 // Nothing to persist, saves flash writes
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_set_mode(WIFI_MODE_STA);                       // Set Wi-Fi mode to station
+    }
+    if (err == ESP_OK) {
+        err = esp_wifi_start();                                       // Start Wi-Fi
+    }
+    return err;
+}
+
+static void record_transition(wifictl_mode_t from, wifictl_mode_t to, int64_t started_us) {
+    wifictl_transition_t *t = &lifecycle.transitions[from][to];
+    t->last_us = (uint32_t) (esp_timer_get_time() - started_us);
+    if (t->last_us > t->max_us) {
+        t->max_us = t->last_us;
+    }
+    t->count++;
+}
+
+void wifictl_mode_lock(void) {
+    if (mode_mutex == NULL) {
+        portENTER_CRITICAL(&init_lock);
+        if (mode_mutex == NULL) {
+            mode_mutex = xSemaphoreCreateRecursiveMutexStatic(&mode_mutex_buffer);
+        }
+        portEXIT_CRITICAL(&init_lock);
+    }
+    xSemaphoreTakeRecursive(mode_mutex, portMAX_DELAY);               // Stopping a mode calls wifictl_mode_leave
+}
+
+void wifictl_mode_unlock(void) {
+    xSemaphoreGiveRecursive(mode_mutex);
+}
+
+esp_err_t wifictl_init(void) {
+    if (atomic_load(&current_mode) != WIFICTL_MODE_UNINIT) {
+        return ESP_OK;
+    }
+    return wifictl_mode_enter(WIFICTL_MODE_IDLE);
+}
+
+esp_err_t wifictl_mode_enter(wifictl_mode_t mode) {
+    wifictl_mode_lock();
+    wifictl_mode_t from = (wifictl_mode_t) atomic_load(&current_mode);
+    int64_t started_us = esp_timer_get_time();
+
+    if (from == WIFICTL_MODE_UNINIT) {
+        esp_err_t err = init_driver();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Wi-Fi initialization failed: %s", esp_err_to_name(err));
+            wifictl_mode_unlock();
+            return err;
+        }
+        atomic_store(&current_mode, WIFICTL_MODE_IDLE);
+        record_transition(WIFICTL_MODE_UNINIT, WIFICTL_MODE_IDLE, started_us);
+        ESP_LOGI(TAG, "Wi-Fi initialized in %lu us.", (unsigned long) lifecycle.transitions[WIFICTL_MODE_UNINIT][WIFICTL_MODE_IDLE].last_us);
+        from = WIFICTL_MODE_IDLE;
+        started_us = esp_timer_get_time();
+    }
+    if (mode == from || mode == WIFICTL_MODE_UNINIT) {                // The driver is never torn down
+        wifictl_mode_unlock();
+        return ESP_OK;
+    }
+
+    bool cancelled = false;
+    switching = true;
+    if (from == WIFICTL_MODE_SCANNING) {
+        cancelled = wifictl_scan_abort();                             // Leaves SCANNING via leave_scan
+    } else if (from == WIFICTL_MODE_SNIFFING) {
+        wifictl_channel_hop_stop();
+        wifictl_sniffer_stop();                                       // Leaves SNIFFING
+    }
+    switching = false;
+    atomic_store(&current_mode, mode);
+    record_transition(from, mode, started_us);
+    ESP_LOGD(TAG, "Mode %s -> %s in %lu us.", wifictl_mode_name(from), wifictl_mode_name(mode),
+             (unsigned long) lifecycle.transitions[from][mode].last_us);
+    wifictl_mode_unlock();
+
+    if (cancelled) {
+        wifictl_scan_report_cancelled();                              // Scan callbacks run without mode_mutex
+    }
+    return ESP_OK;
+}
+
+void wifictl_mode_leave(wifictl_mode_t mode, int64_t started_us) {
+    wifictl_mode_lock();
+    if (atomic_load(&current_mode) == mode) {
+        atomic_store(&current_mode, WIFICTL_MODE_IDLE);
+        if (!switching) {
+            record_transition(mode, WIFICTL_MODE_IDLE, started_us);
+        }
+        if (mode == WIFICTL_MODE_SCANNING && lifecycle.first_scan_ms == 0) {
+            lifecycle.first_scan_ms = (uint32_t) (esp_timer_get_time() / 1000);
+        }
+    }
+    wifictl_mode_unlock();
+}
+
+wifictl_mode_t wifictl_mode_get(void) {
+    return (wifictl_mode_t) atomic_load(&current_mode);
+}
+
+const char *wifictl_mode_name(wifictl_mode_t mode) {
+    switch (mode) {
+        case WIFICTL_MODE_UNINIT   :return "uninit"  ;
+        case WIFICTL_MODE_IDLE     :return "idle"    ;
+        case WIFICTL_MODE_SCANNING :return "scanning";
+        case WIFICTL_MODE_SNIFFING :return "sniffing";
+        default                    :return "?"       ;
+    }
+}
+
+void wifictl_get_lifecycle_stats(wifictl_lifecycle_stats_t *stats) {
+    wifictl_mode_lock();
+    *stats = lifecycle;
+    stats->mode = wifictl_mode_get();
+    wifictl_mode_unlock();
+}
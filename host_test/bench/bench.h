@@ -0,0 +1,63 @@
+/**
+ * @file bench.h
+ * @brief Host benchmark helpers. Every benchmark reports "name value unit" lines on stdout.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Benchmark entry point.
+ * @param quick Short run for the ctest smoke pass; sizes shrink, checks stay.
+ * @return false if a result check failed.
+ **/
+typedef bool (*bench_fn_t)(bool quick);
+
+/**
+ * @brief Prints one result line.
+ **/
+void bench_report(const char *name, double value, const char *unit);
+
+/**
+ * @brief Monotonic time in nanoseconds.
+ **/
+uint64_t bench_now_ns(void);
+
+/**
+ * @brief Fails the running benchmark with a message on stderr if `ok` is false.
+ * @return ok
+ **/
+bool bench_check(bool ok, const char *what);
+
+bool bench_ring(bool quick);
+bool bench_pool(bool quick);
+bool bench_parser(bool quick);
+bool bench_hop(bool quick);
+bool bench_ap_table(bool quick);
+bool bench_station_table(bool quick);
+bool bench_capture_filter(bool quick);
+bool bench_command_line(bool quick);
+bool bench_pipeline(bool quick);
+bool bench_capture_log(bool quick);
+bool bench_lifecycle(bool quick);
+bool bench_pcap_compact(bool quick);
+bool bench_airtime(bool quick);
+bool bench_deferred_log(bool quick);
+bool bench_pcap_replay(bool quick);
+bool bench_fanout(bool quick);
+bool bench_sketch(bool quick);
+bool bench_scan_delta(bool quick);
+bool bench_radio_scan(bool quick);
+bool bench_radio_sniffer(bool quick);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_H
@@ -0,0 +1,237 @@
+/**
+ * @file bench_airtime.c
+ * @brief Airtime meter on a long synthetic hopping trace: cost per recorded frame, and utilization
+ *        against ground truth. The trace hops channels 1, 6 and 11 every 200 ms with loads that change
+ *        every 20 s; ground truth is the exact busy share of the trailing 10 s per channel, kept per
+ *        millisecond, while the meter answers from its ring of whole buckets. Listened time is entered
+ *        every few frames and at switches, as the monitor does per batch.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "airtime_meter.h"
+
+#define CHANNELS 3
+#define BSSIDS 10                                                           // Per channel
+#define DWELL_MS 200
+#define WINDOW_MS (CONFIG_AIRTIME_BUCKETS * CONFIG_AIRTIME_BUCKET_MS)
+#define LISTEN 0xff                                                         // Event kind of listened time
+
+typedef struct {
+    uint64_t at_us;
+    uint32_t value;                                                         // Frame length, or listened microseconds
+    airtime_phy_t phy;
+    uint8_t channel;                                                        // Index into channels
+    uint8_t kind;                                                           // airtime_type_t or LISTEN
+    uint8_t bssid;                                                          // Index into bssids, 0xff for none
+} event_t;
+
+static const uint8_t channels[CHANNELS] = { 1, 6, 11 };
+static const double base_load[CHANNELS] = { 0.25, 0.6, 0.05 };
+static uint8_t bssids[CHANNELS * BSSIDS][6];
+static event_t *events;
+static size_t event_count;
+static uint16_t *busy_ms[CHANNELS], *listen_ms[CHANNELS];                   // Ground truth per millisecond
+static uint32_t total_ms;
+static airtime_meter_t meter;
+static uint32_t rng_state = 11;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+/**
+ * @brief Beacons and other management frames at 1 Mbit/s, ACK/RTS/CTS at 24 Mbit/s, data at mixed rates.
+ */
+static void random_frame(event_t *e) {
+    static const uint8_t data_rates[] = { 11, 22, 36, 48, 72, 96, 108 };
+    uint32_t pick = rng() % 10;
+    e->phy = (airtime_phy_t) { 0 };
+    if (pick < 3) {
+        e->kind = AIRTIME_MGMT;
+        e->phy.legacy_rate = 2;
+        e->value = 150 + rng() % 250;
+    } else if (pick < 5) {
+        e->kind = AIRTIME_CTRL;
+        e->phy.legacy_rate = 48;
+        e->value = rng() % 2 ? 14 : 20;
+    } else {
+        e->kind = AIRTIME_DATA;
+        e->value = rng() % 3 == 0 ? 60 + rng() % 100 : 200 + rng() % 1300;
+        if (rng() % 2) {
+            e->phy.legacy_rate = data_rates[rng() % sizeof(data_rates)];
+            e->phy.short_preamble = rng() % 2;
+        } else {
+            e->phy.mcs = (uint8_t) (rng() % 16);
+            e->phy.ht40 = rng() % 4 == 0;
+            e->phy.short_gi = rng() % 2;
+        }
+    }
+}
+
+static event_t *add_event(uint64_t at_us, uint8_t c) {
+    event_t *e = &events[event_count++];
+    e->at_us = at_us;
+    e->channel = c;
+    return e;
+}
+
+/**
+ * @brief Lays out `frames` frames on the hopping timeline and fills the per-millisecond ground truth.
+ */
+static bool build_trace(size_t frames) {
+    size_t capacity = frames + frames / 4 + 1024;
+    events = malloc(capacity * sizeof(*events));
+    total_ms = (uint32_t) (frames / 200 + 1) * 1000;                        // Enough for the lightest mix
+    for (int c = 0; c < CHANNELS; c++) {
+        busy_ms[c] = calloc(total_ms, sizeof(uint16_t));
+        listen_ms[c] = calloc(total_ms, sizeof(uint16_t));
+        if (busy_ms[c] == NULL || listen_ms[c] == NULL) {
+            return false;
+        }
+        for (int b = 0; b < BSSIDS; b++) {
+            uint8_t bssid[6] = { 0x02, 0, 0, 0, (uint8_t) c, (uint8_t) b };
+            memcpy(bssids[c * BSSIDS + b], bssid, 6);
+        }
+    }
+    if (events == NULL) {
+        return false;
+    }
+
+    double load[CHANNELS];
+    size_t recorded = 0;
+    event_count = 0;
+    for (uint32_t dwell = 0; recorded < frames && (dwell + 1) * DWELL_MS < total_ms; dwell++) {
+        uint8_t c = dwell % CHANNELS;
+        uint64_t start_us = (uint64_t) dwell * DWELL_MS * 1000, end_us = start_us + DWELL_MS * 1000;
+        if (dwell % (20000 / DWELL_MS) == 0) {                              // New load every 20 s
+            for (int i = 0; i < CHANNELS; i++) {
+                load[i] = base_load[i] * (0.5 + (rng() % 1000) / 1000.0);
+            }
+        }
+        for (uint32_t ms = (uint32_t) (start_us / 1000); ms < end_us / 1000; ms++) {
+            listen_ms[c][ms] = 1000;
+        }
+        uint64_t at = start_us, listened_to = start_us;
+        for (int since_listen = 1; recorded < frames && event_count < capacity - 2; since_listen++) {
+            event_t frame;
+            random_frame(&frame);
+            uint32_t duration = airtime_frame_us(&frame.phy, frame.value);
+            uint32_t mean_gap = (uint32_t) (duration * (1 - load[c]) / load[c]);
+            at += rng() % (2 * mean_gap + 1);
+            if (at + duration > end_us) {
+                break;
+            }
+            at += duration;                                                 // Captured when it ends
+            event_t *e = add_event(at, c);
+            e->value = frame.value;
+            e->phy = frame.phy;
+            e->kind = frame.kind;
+            e->bssid = frame.kind == AIRTIME_CTRL ? 0xff : (uint8_t) (c * BSSIDS + rng() % BSSIDS);
+            busy_ms[c][at / 1000] += (uint16_t) duration;
+            recorded++;
+            if (since_listen % 10 == 0) {                                   // One batch
+                e = add_event(at, c);
+                e->kind = LISTEN;
+                e->value = (uint32_t) (at - listened_to);
+                listened_to = at;
+            }
+        }
+        event_t *e = add_event(end_us, c);                                  // Switch
+        e->kind = LISTEN;
+        e->value = (uint32_t) (end_us - listened_to);
+    }
+    total_ms = (uint32_t) (events[event_count - 1].at_us / 1000);
+    return recorded == frames;
+}
+
+static void feed(const event_t *e) {
+    uint32_t now_ms = (uint32_t) (e->at_us / 1000);
+    if (e->kind == LISTEN) {
+        airtime_meter_listen(&meter, now_ms, channels[e->channel], e->value);
+        return;
+    }
+    airtime_meter_record(&meter, now_ms, channels[e->channel], e->kind, e->bssid == 0xff ? NULL : bssids[e->bssid],
+                         airtime_frame_us(&e->phy, e->value));
+}
+
+bool bench_airtime(bool quick) {
+    const size_t frames = quick ? 200000 : 2000000;
+    bool ok = bench_check(build_trace(frames), "trace");
+
+    airtime_meter_init(&meter, 0);
+    uint64_t start = bench_now_ns();
+    for (size_t i = 0; i < event_count; i++) {
+        feed(&events[i]);
+    }
+    bench_report("airtime.record_cost", (double) (bench_now_ns() - start) / frames, "ns/frame");
+
+    // Accuracy: sample at a random point of every second once the window is full
+    airtime_meter_init(&meter, 0);
+    uint64_t busy_sum[CHANNELS] = { 0 }, listen_sum[CHANNELS] = { 0 };
+    uint32_t summed_to = 0, samples = 0;                                    // Ground truth sums cover ms < summed_to
+    double error_sum = 0, error_max = 0;
+    uint64_t listened_to = 0;
+    size_t next = 0;
+    for (uint32_t second = 1; (second + 1) * 1000 < total_ms; second++) {
+        uint32_t sample_ms = second * 1000 + rng() % 1000;
+        uint64_t sample_us = (uint64_t) sample_ms * 1000 + 999;
+        for (; next < event_count && events[next].at_us <= sample_us; next++) {
+            const event_t *e = &events[next];
+            if (e->kind != LISTEN) {
+                feed(e);
+                continue;
+            }
+            airtime_meter_listen(&meter, (uint32_t) (e->at_us / 1000), channels[e->channel],
+                                 (uint32_t) (e->at_us - listened_to));
+            listened_to = e->at_us;
+        }
+        uint8_t c = (uint8_t) ((sample_ms / DWELL_MS) % CHANNELS);          // Query accounts the current dwell, like the monitor
+        airtime_meter_listen(&meter, sample_ms, channels[c], (uint32_t) (sample_us - listened_to));
+        listened_to = sample_us;
+
+        for (; summed_to <= sample_ms; summed_to++) {                       // Slide the exact window to (sample - 10 s, sample]
+            for (int i = 0; i < CHANNELS; i++) {
+                busy_sum[i] += busy_ms[i][summed_to];
+                listen_sum[i] += listen_ms[i][summed_to];
+                if (summed_to >= WINDOW_MS) {
+                    busy_sum[i] -= busy_ms[i][summed_to - WINDOW_MS];
+                    listen_sum[i] -= listen_ms[i][summed_to - WINDOW_MS];
+                }
+            }
+        }
+        if (sample_ms < WINDOW_MS) {
+            continue;
+        }
+        airtime_channel_summary_t summaries[AIRTIME_CHANNELS];
+        size_t count = airtime_meter_channels(&meter, sample_ms, summaries, AIRTIME_CHANNELS);
+        ok &= bench_check(count == CHANNELS, "every channel reported");
+        for (size_t s = 0; s < count && s < CHANNELS; s++) {              // Ascending, so in the order of channels
+            double measured = 100.0 * summaries[s].utilization_q16 / AIRTIME_Q16_ONE;
+            double truth = 100.0 * busy_sum[s] / listen_sum[s];
+            double error = fabs(measured - truth);
+            error_sum += error;
+            error_max = error > error_max ? error : error_max;
+            samples++;
+        }
+    }
+    bench_report("airtime.trace_seconds", total_ms / 1000.0, "s");
+    bench_report("airtime.utilization_error_mean", error_sum / samples, "pp");
+    bench_report("airtime.utilization_error_max", error_max, "pp");
+    ok &= bench_check(meter.evicted == 0 && meter.unrated == 0, "no eviction, every rate known");
+    ok &= bench_check(error_sum / samples < 1.0, "mean utilization within 1 pp of ground truth");
+    ok &= bench_check(error_max < 100.0 * CONFIG_AIRTIME_BUCKET_MS / WINDOW_MS,
+                      "utilization within one bucket's share of ground truth");  // Window is 9 to 10 whole buckets
+
+    free(events);
+    for (int c = 0; c < CHANNELS; c++) {
+        free(busy_ms[c]);
+        free(listen_ms[c]);
+    }
+    return ok;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file bench_ap_table.c
+ * @brief AP table insert, lookup, merge, eviction and sorted iteration at 1k and 2k APs.
+ */
+#include <stdio.h>
+
+#include "bench.h"
+
+#include "ap_table.h"
+
+static wifi_ap_record_t make_record(uint32_t n) {
+    wifi_ap_record_t record = { 0 };
+    uint32_t mixed = n * 2654435761u;                                       // BSSIDs of real sites share OUIs, vary at the end
+    record.bssid[0] = 0x02;
+    record.bssid[1] = 0x1a;
+    record.bssid[2] = 0x2b;
+    record.bssid[3] = (uint8_t) (mixed >> 16);
+    record.bssid[4] = (uint8_t) (mixed >> 8);
+    record.bssid[5] = (uint8_t) n;
+    record.rssi = (int8_t) (-30 - (int) (mixed % 60));
+    record.primary = (uint8_t) (1 + n % 13);
+    return record;
+}
+
+static bool run(uint32_t aps, uint32_t rounds) {
+    static uint16_t ids[CONFIG_AP_TABLE_CAPACITY];
+    char name[64];
+    bool ok = true;
+    wifictl_ap_table_clear();
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t n = 0; n < aps; n++) {
+        wifi_ap_record_t record = make_record(n);
+        wifictl_ap_table_update(&record, n, AP_SOURCE_SCAN);
+    }
+    snprintf(name, sizeof(name), "ap_table.%lu.insert", (unsigned long) aps);
+    bench_report(name, (double) (bench_now_ns() - start) / aps, "ns/op");
+    ok &= bench_check(wifictl_ap_table_count() == aps, "all inserted");
+
+    uint32_t hits = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        wifi_ap_record_t record = make_record(i % aps);
+        hits += wifictl_ap_table_find(record.bssid) != AP_TABLE_INVALID_ID;
+    }
+    snprintf(name, sizeof(name), "ap_table.%lu.lookup_hit", (unsigned long) aps);
+    bench_report(name, (double) (bench_now_ns() - start) / rounds, "ns/op");
+    ok &= bench_check(hits == rounds, "every lookup hits");
+
+    hits = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        wifi_ap_record_t record = make_record(aps + i % aps);
+        hits += wifictl_ap_table_find(record.bssid) != AP_TABLE_INVALID_ID;
+    }
+    snprintf(name, sizeof(name), "ap_table.%lu.lookup_miss", (unsigned long) aps);
+    bench_report(name, (double) (bench_now_ns() - start) / rounds, "ns/op");
+    ok &= bench_check(hits == 0, "no lookup hits");
+
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        wifi_ap_record_t record = make_record(i % aps);
+        wifictl_ap_table_update(&record, aps + i, AP_SOURCE_BEACON);
+    }
+    snprintf(name, sizeof(name), "ap_table.%lu.merge", (unsigned long) aps);
+    bench_report(name, (double) (bench_now_ns() - start) / rounds, "ns/op");
+
+    const uint32_t sorts = rounds / aps + 1;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < sorts; i++) {
+        ok &= bench_check(wifictl_ap_table_sorted((wifictl_ap_sort_t) (i % 3), ids, CONFIG_AP_TABLE_CAPACITY) == aps,
+                          "sorted returns all");
+    }
+    snprintf(name, sizeof(name), "ap_table.%lu.sorted", (unsigned long) aps);
+    bench_report(name, (double) (bench_now_ns() - start) / sorts / 1000, "us/op");
+
+    if (aps == CONFIG_AP_TABLE_CAPACITY) {                                  // Full: every new AP evicts the oldest
+        const uint32_t evictions = rounds / 100 + 1;
+        start = bench_now_ns();
+        for (uint32_t i = 0; i < evictions; i++) {
+            wifi_ap_record_t record = make_record(2 * aps + i);
+            wifictl_ap_table_update(&record, 2 * aps + rounds + i, AP_SOURCE_BEACON);
+        }
+        snprintf(name, sizeof(name), "ap_table.%lu.insert_evict", (unsigned long) aps);
+        bench_report(name, (double) (bench_now_ns() - start) / evictions, "ns/op");
+        ok &= bench_check(wifictl_ap_table_count() == aps, "eviction keeps the table full");
+    }
+    return ok;
+}
+
+bool bench_ap_table(bool quick) {
+    const uint32_t rounds = quick ? 100000 : 5000000;
+    bool ok = run(1024, rounds);
+    ok &= run(CONFIG_AP_TABLE_CAPACITY, rounds);
+    bench_report("ap_table.memory", CONFIG_AP_TABLE_CAPACITY * (sizeof(wifictl_ap_info_t) + sizeof(wifi_ap_record_t) +
+                                    5 * sizeof(uint16_t)) / 1024.0, "KB");
+    return ok;
+}
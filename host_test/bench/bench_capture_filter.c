@@ -0,0 +1,84 @@
+/**
+ * @file bench_capture_filter.c
+ * @brief Capture filter evaluation cost per frame on a mixed trace, from the empty program to long
+ *        programs and MAC sets at the size limit.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "capture_filter.h"
+
+#define TRACE_FRAMES 4096
+
+static uint8_t trace[TRACE_FRAMES][24];                                     // Headers only, lengths carry the size
+static uint16_t trace_len[TRACE_FRAMES];
+static int8_t trace_rssi[TRACE_FRAMES];
+static uint8_t trace_channel[TRACE_FRAMES];
+
+static void build_trace(void) {
+    static const uint8_t kinds[4] = { 0x80, 0x40, 0x88, 0xd4 };             // Beacon, probe request, QoS data, ACK
+    uint32_t state = 1;
+    for (size_t i = 0; i < TRACE_FRAMES; i++) {
+        state = state * 1664525 + 1013904223;
+        uint8_t *f = trace[i];
+        uint8_t kind = kinds[(state >> 8) & 3];
+        memset(f, 0, sizeof(trace[i]));
+        f[0] = kind;
+        f[1] = kind == 0x88 ? 0x01 : 0;
+        for (int a = 0; a < 3; a++) {
+            uint8_t mac[6] = { 0x02, 0, 0, 0, (uint8_t) a, (uint8_t) ((state >> (10 + 2 * a)) & 63) };
+            memcpy(&f[4 + 6 * a], mac, 6);
+        }
+        trace_len[i] = kind == 0xd4 ? 10 : (uint16_t) (24 + (state >> 16) % 1500);
+        trace_rssi[i] = (int8_t) (-95 + (int) ((state >> 20) % 70));
+        trace_channel[i] = (uint8_t) (1 + (state >> 4) % 13);
+    }
+}
+
+static bool run(const char *label, const char *expr, uint32_t frames) {
+    static capture_filter_t filter;
+    const char *error = NULL;
+    if (!bench_check(capture_filter_compile(&filter, expr, &error), label)) {
+        printf("  %s\n", error);
+        return false;
+    }
+    uint32_t accepted = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        size_t t = i % TRACE_FRAMES;
+        accepted += capture_filter_match(&filter, trace[t], trace_len[t], trace_rssi[t], trace_channel[t]);
+    }
+    double ns = (double) (bench_now_ns() - start) / frames;
+
+    char name[64];
+    snprintf(name, sizeof(name), "capture_filter.%s", label);
+    bench_report(name, ns, "ns/frame");
+    snprintf(name, sizeof(name), "capture_filter.%s.accepted", label);
+    bench_report(name, 100.0 * accepted / frames, "%");
+    return bench_check(filter.evaluated == frames && filter.matched == accepted, "filter counters");
+}
+
+bool bench_capture_filter(bool quick) {
+    static char set[CONFIG_CAPTURE_FILTER_MAX_MACS * 18 + 32];
+    const uint32_t frames = quick ? 200000 : 20000000;
+    build_trace();
+
+    strcpy(set, "bssid in {");
+    for (int i = 0; i < CONFIG_CAPTURE_FILTER_MAX_MACS; i++) {
+        char mac[20];
+        snprintf(mac, sizeof(mac), "%s02:00:00:00:02:%02x", i > 0 ? "," : "", i * 2);
+        strcat(set, mac);
+    }
+    strcat(set, "}");
+
+    bool ok = run("empty", "", frames);
+    ok &= run("type", "mgmt", frames);
+    ok &= run("beacons_of", "mgmt subtype beacon and bssid in {02:00:00:00:02:01, 02:00:00:00:02:05} "
+                            "and rssi > -70", frames);
+    ok &= run("mac_set_max", set, frames);
+    ok &= run("long", "(mgmt and not subtype beacon or data and len > 200) and rssi > -80 "
+                      "and channel != 6 and (src 02:00:00:00:01:03 or addr 02:00:00:00:00:07)", frames);
+    return ok;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file bench_command_line.c
+ * @brief Console throughput on a scripted batch: bytes through the line editor with echo, split,
+ *        prefix lookup and dispatch to trivial handlers, fed in UART-sized chunks.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "command_table.h"
+#include "line_editor.h"
+
+#define UART_CHUNK 120                                                      // Bytes per driver read, the RX FIFO size
+
+static bool nop(int argc, char **argv, void *ctx) {
+    (*(uint32_t *) ctx)++;
+    return true;
+}
+
+static const command_t commands[] = {
+    { "help", "", "", nop },     { "scan", "", "", nop },     { "aps", "", "", nop },      { "output", "", "", nop },
+    { "stations", "", "", nop }, { "filter", "", "", nop },   { "pcap", "", "", nop },     { "hop", "", "", nop },
+    { "log", "", "", nop },      { "airtime", "", "", nop },  { "sketch", "", "", nop },   { "replay", "", "", nop },
+    { "stats", "", "", nop },    { "wifi", "", "", nop },
+};
+
+static const char *const script[] = {                                      // A typical scripted survey
+    "hop 1,6,11\r\n", "stati\r\n", "filter \"mgmt subtype beacon and rssi > -70\"\r\n", "airtime start\r\n",
+    "sketch top bytes 10\r\n", "stats\r\n", "scan watch 5 1,6,11\r\n", "aps\r\n", "log read 0 1000000\r\n",
+    "hop stop\r\n",
+};
+
+static uint64_t echoed;
+
+static void echo(const char *data, size_t len) {
+    echoed += len;
+}
+
+static void on_line(char *line, void *ctx) {
+    command_table_dispatch(line, ctx, NULL);
+}
+
+bool bench_command_line(bool quick) {
+    static char batch[1 << 20];
+    static line_editor_t ed;
+    const uint32_t passes = quick ? 4 : 100;
+    size_t len = 0, lines = 0;
+    uint32_t handled = 0;
+
+    command_table_register_all(commands, sizeof(commands) / sizeof(commands[0]));
+    while (len + 64 < sizeof(batch)) {
+        const char *line = script[lines++ % (sizeof(script) / sizeof(script[0]))];
+        size_t n = strlen(line);
+        memcpy(&batch[len], line, n);
+        len += n;
+    }
+
+    line_editor_init(&ed, echo, on_line, &handled);
+    echoed = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (size_t off = 0; off < len; off += UART_CHUNK) {
+            line_editor_feed(&ed, &batch[off], len - off < UART_CHUNK ? len - off : UART_CHUNK);
+        }
+    }
+    double s = (double) (bench_now_ns() - start) / 1e9;
+
+    bench_report("console.commands", lines * passes / s, "commands/s");
+    bench_report("console.input", len * passes / s / 1e6, "MB/s");
+    bench_report("console.per_command", s * 1e9 / (lines * passes), "ns");
+    bench_report("console.uart_115200_limit", 11520.0 * lines / len, "commands/s");       // 10 bits per byte on the wire
+    return bench_check(handled == lines * passes && ed.overflows == 0, "every scripted command dispatched") &&
+           bench_check(echoed == len * passes, "input echoed");
+}
@@ -0,0 +1,122 @@
+/**
+ * @file bench_deferred_log.c
+ * @brief Cost of one DLOGI against ESP_LOGI with the output discarded after formatting, as `stats logbench`
+ *        measures on the device; also the drop path of a full ring and four producers sharing the two rings.
+ */
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+#include "deferred_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TAG "dlog_bench"
+#define PRODUCERS 4
+
+static atomic_int producers_done;
+static atomic_uint_fast64_t producers_ns;
+static unsigned producer_calls;
+
+static int discard_vprintf(const char *format, va_list args) {
+    char line[160];
+    return vsnprintf(line, sizeof(line), format, args);
+}
+
+static void drained(void) {
+    deferred_log_stats_t stats;
+    for (deferred_log_get_stats(&stats); stats.formatted != stats.written; deferred_log_get_stats(&stats)) {
+        vTaskDelay(1);
+    }
+}
+
+static void producer(void *arg) {
+    uint64_t start = bench_now_ns();
+    for (unsigned i = 0; i < producer_calls; i++) {
+        DLOGI(TAG, "Frame %u on channel %u, rssi %d", i, 6u, -42);
+    }
+    atomic_fetch_add(&producers_ns, bench_now_ns() - start);
+    atomic_fetch_add(&producers_done, 1);
+    vTaskDelete(NULL);
+}
+
+bool bench_deferred_log(bool quick) {
+    const unsigned calls = quick ? 4096 : 65536;                            // Paced by the formatter, one ring per period
+    const unsigned chunk = CONFIG_DEFERRED_LOG_SLOTS;                       // Fills the drained ring, nothing dropped
+    bool ok = bench_check(deferred_log_start() == ESP_OK, "formatter started");
+    esp_log_level_set(TAG, ESP_LOG_NONE);                                   // Formatter consumes and discards
+    vprintf_like_t saved_vprintf = esp_log_set_vprintf(discard_vprintf);
+    deferred_log_stats_t before, after;
+    drained();
+    deferred_log_get_stats(&before);
+
+    uint64_t deferred_ns = 0;
+    for (unsigned done = 0; done < calls; done += chunk) {
+        uint64_t start = bench_now_ns();
+        for (unsigned i = 0; i < chunk; i++) {
+            DLOGI(TAG, "Frame %u on channel %u, rssi %d", done + i, 6u, -42);
+        }
+        deferred_ns += bench_now_ns() - start;
+        drained();
+    }
+    deferred_log_get_stats(&after);
+    ok &= bench_check(after.dropped == before.dropped, "nothing dropped while the ring had room");
+    bench_report("deferred_log.dlogi", (double) deferred_ns / calls, "ns/call");
+
+    esp_log_level_set(TAG, ESP_LOG_INFO);
+    uint64_t direct_ns = 0;
+    for (unsigned done = 0; done < calls; done += chunk) {                  // Same chunks and pauses, same cache state
+        uint64_t start = bench_now_ns();
+        for (unsigned i = 0; i < chunk; i++) {
+            ESP_LOGI(TAG, "Frame %u on channel %u, rssi %d", done + i, 6u, -42);
+        }
+        direct_ns += bench_now_ns() - start;
+        vTaskDelay(1);
+    }
+    bench_report("deferred_log.esp_logi", (double) direct_ns / calls, "ns/call");
+    bench_report("deferred_log.speedup", (double) direct_ns / deferred_ns, "x");
+    esp_log_level_set(TAG, ESP_LOG_NONE);
+
+    uint64_t dropping_ns = 0;                                               // Chunks finish well within one formatter period
+    unsigned dropping_calls = 0;
+    deferred_log_get_stats(&before);
+    for (unsigned done = 0; done < calls; done += chunk * 4) {
+        drained();
+        for (unsigned i = 0; i < CONFIG_DEFERRED_LOG_SLOTS; i++) {
+            DLOGI(TAG, "fill %u", i);
+        }
+        uint64_t start = bench_now_ns();
+        for (unsigned i = 0; i < chunk * 4; i++) {
+            DLOGI(TAG, "Frame %u on channel %u, rssi %d", done + i, 6u, -42);
+        }
+        dropping_ns += bench_now_ns() - start;
+        dropping_calls += chunk * 4;
+    }
+    deferred_log_get_stats(&after);
+    ok &= bench_check(after.dropped - before.dropped >= dropping_calls - dropping_calls / 100, "full ring drops the calls");
+    bench_report("deferred_log.dlogi_dropped", (double) dropping_ns / dropping_calls, "ns/call");
+
+    drained();
+    deferred_log_get_stats(&before);
+    producer_calls = calls / PRODUCERS;
+    atomic_store(&producers_done, 0);
+    atomic_store(&producers_ns, 0);
+    for (int p = 0; p < PRODUCERS; p++) {                                   // Two per core ring, no pacing
+        ok &= bench_check(xTaskCreatePinnedToCore(producer, "producer", 2048, NULL, 5, NULL, p % 2) == pdPASS,
+                          "producer created");
+    }
+    while (atomic_load(&producers_done) < PRODUCERS) {
+        vTaskDelay(1);
+    }
+    drained();
+    deferred_log_get_stats(&after);
+    uint32_t written = after.written - before.written, dropped = after.dropped - before.dropped;
+    ok &= bench_check(written + dropped == producer_calls * PRODUCERS, "every contended call stored or counted");
+    bench_report("deferred_log.contended", (double) atomic_load(&producers_ns) / (producer_calls * PRODUCERS), "ns/call");
+    bench_report("deferred_log.contended_dropped", 100.0 * dropped / (written + dropped), "%");
+
+    esp_log_set_vprintf(saved_vprintf);
+    return ok;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file bench_fanout.cpp
+ * @brief Frame fan-out cost per frame with 1 to 8 consumers that read the frame, against handing every
+ *        consumer its own malloc'd copy, both drained per batch from one context as wifictl_fanout_benchmark
+ *        does on the device; then the sniffer's layout with one thread per consumer and a producer.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sched.h>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#include "bench.h"
+
+#include "frame_fanout.hpp"
+#include "sniffer_fanout.h"
+
+using wifictl::FrameFanout;
+
+namespace {
+
+constexpr size_t kFrameLen = 256;                                           // Typical management frame
+constexpr size_t kFrames = 64;                                              // Distinct buffers, like a pool class
+constexpr size_t kMaxConsumers = SNIFFER_FANOUT_BENCH_MAX_CONSUMERS;
+
+struct Buffer {
+    wifictl_frame_t frame;
+    uint8_t payload[kFrameLen];
+};
+
+Buffer buffers[kFrames];
+volatile uint32_t sink;
+
+std::atomic<uint64_t> releases{0};
+
+struct CountRelease {
+    void operator()(wifictl_frame_t *frame) const { releases.fetch_add(1, std::memory_order_relaxed); }
+};
+
+/** @brief Reads the frame like a real consumer would. */
+template <size_t I>
+struct TouchConsumer {
+    uint32_t sum = 0;
+    void on_frame(const wifictl_frame_t &frame) { sum += frame.pkt.payload[frame.pkt.rx_ctrl.sig_len - 1] + frame.seq; }
+};
+
+template <size_t... I>
+double fanout_ns(std::index_sequence<I...>, uint32_t frames) {
+    std::tuple<TouchConsumer<I>...> consumers;
+    FrameFanout<wifictl_frame_t, CountRelease, CONFIG_SNIFFER_FANOUT_DEPTH, TouchConsumer<I>...> fanout(
+        std::get<I>(consumers)...);
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        while (!fanout.publish(&buffers[i % kFrames].frame)) {
+            fanout.drain_all(CONFIG_SNIFFER_BATCH_SIZE);
+        }
+        if (i % CONFIG_SNIFFER_BATCH_SIZE == CONFIG_SNIFFER_BATCH_SIZE - 1) {
+            fanout.drain_all(CONFIG_SNIFFER_BATCH_SIZE);
+        }
+    }
+    while (fanout.drain_all(CONFIG_SNIFFER_BATCH_SIZE) > 0) {
+    }
+    double ns = double(bench_now_ns() - start) / frames;
+    sink = (std::get<I>(consumers).sum + ...);
+    return ns;
+}
+
+/**
+ * @brief Baseline: every consumer gets its own copy of each frame in a heap buffer and frees it.
+ */
+template <size_t... I>
+double copy_ns(std::index_sequence<I...>, uint32_t frames) {
+    constexpr size_t kConsumers = sizeof...(I);
+    std::tuple<TouchConsumer<I>...> consumers;
+    wifictl_frame_t *copies[kConsumers][CONFIG_SNIFFER_BATCH_SIZE];
+    size_t size = sizeof(Buffer);
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        size_t slot = i % CONFIG_SNIFFER_BATCH_SIZE;
+        for (size_t c = 0; c < kConsumers; c++) {
+            copies[c][slot] = static_cast<wifictl_frame_t *>(std::malloc(size));
+            std::memcpy(copies[c][slot], &buffers[i % kFrames], size);
+        }
+        if (slot == CONFIG_SNIFFER_BATCH_SIZE - 1 || i == frames - 1) {
+            ((std::for_each_n(copies[I], slot + 1, [&](wifictl_frame_t *copy) {
+                 std::get<I>(consumers).on_frame(*copy);
+                 std::free(copy);
+             })), ...);
+        }
+    }
+    double ns = double(bench_now_ns() - start) / frames;
+    sink = (std::get<I>(consumers).sum + ...);
+    return ns;
+}
+
+template <size_t I, typename Fanout>
+void consume(Fanout &fanout, uint32_t frames) {
+    while (fanout.template delivered<I>() < frames) {
+        if (fanout.template drain<I>(CONFIG_SNIFFER_BATCH_SIZE) == 0) {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * @brief Producer on this thread, each consumer on its own thread as the sniffer's consumer tasks.
+ * @return Frames per second through every consumer.
+ */
+template <size_t... I>
+double threaded_rate(std::index_sequence<I...>, uint32_t frames) {
+    std::tuple<TouchConsumer<I>...> consumers;
+    using Fanout = FrameFanout<wifictl_frame_t, CountRelease, CONFIG_SNIFFER_FANOUT_DEPTH, TouchConsumer<I>...>;
+    Fanout fanout(std::get<I>(consumers)...);
+    uint64_t start = bench_now_ns();
+    std::thread threads[] = { std::thread(consume<I, Fanout>, std::ref(fanout), frames)... };
+    for (uint32_t i = 0; i < frames; i++) {
+        while (!fanout.publish(&buffers[i % kFrames].frame)) {
+            sched_yield();
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return frames * 1e9 / double(bench_now_ns() - start);
+}
+
+template <size_t... N>
+void run_all(std::index_sequence<N...>, uint32_t frames, double *fanout, double *copy) {
+    ((fanout[N] = fanout_ns(std::make_index_sequence<N + 1>(), frames),
+      copy[N] = copy_ns(std::make_index_sequence<N + 1>(), frames)), ...);
+}
+
+}  // namespace
+
+bool bench_fanout(bool quick) {
+    const uint32_t frames = quick ? 100000 : 4000000;
+    for (size_t i = 0; i < kFrames; i++) {
+        buffers[i].frame.seq = uint32_t(i);
+        buffers[i].frame.pkt.rx_ctrl.sig_len = kFrameLen;
+        std::memset(buffers[i].payload, int(i), kFrameLen);
+    }
+    double fanout[kMaxConsumers], copy[kMaxConsumers];
+    releases = 0;
+    run_all(std::make_index_sequence<kMaxConsumers>(), frames, fanout, copy);
+    bool ok = bench_check(releases == uint64_t(frames) * kMaxConsumers, "fan-out: one release per frame");
+
+    char name[48];
+    for (size_t n = 0; n < kMaxConsumers; n++) {
+        std::snprintf(name, sizeof(name), "fanout.consumers_%zu", n + 1);
+        bench_report(name, fanout[n], "ns/frame");
+        std::snprintf(name, sizeof(name), "fanout.copy_%zu", n + 1);
+        bench_report(name, copy[n], "ns/frame");
+    }
+    bench_report("fanout.per_consumer", (fanout[kMaxConsumers - 1] - fanout[0]) / (kMaxConsumers - 1), "ns/frame");
+    bench_report("fanout.copy_per_consumer", (copy[kMaxConsumers - 1] - copy[0]) / (kMaxConsumers - 1), "ns/frame");
+    ok &= bench_check(fanout[kMaxConsumers - 1] < copy[kMaxConsumers - 1], "fan-out cheaper than a copy per consumer");
+
+    for (size_t n : { 2, 4 }) {                                             // 2: events and sketch, as in the sniffer
+        releases = 0;
+        double rate = n == 2 ? threaded_rate(std::make_index_sequence<2>(), frames)
+                             : threaded_rate(std::make_index_sequence<4>(), frames);
+        std::snprintf(name, sizeof(name), "fanout.threaded_%zu", n);
+        bench_report(name, rate, "frames/s");
+        ok &= bench_check(releases == frames, "threaded: one release per frame");
+    }
+    return ok;
+}
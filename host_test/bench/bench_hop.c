@@ -0,0 +1,163 @@
+/**
+ * @file bench_hop.c
+ * @brief Adaptive hopping against fixed round-robin on a simulated site, in simulated time.
+ *
+ * The model has APs beaconing every 102.4 ms with random phase, unevenly spread over channels 1-13
+ * (most on 1, 6 and 11), plus Poisson data traffic per channel. A frame is captured if the radio is on
+ * its channel and not within the settling time after a switch. Reported per policy: coverage (captured
+ * share of all frames on the air), time until every AP was seen at least once, and mean dwell.
+ */
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+#include "channel_hopper.h"
+#include "hop_scheduler.h"
+
+#define SIM_CHANNELS 13
+#define SIM_APS 48
+#define SIM_BEACON_US 102400
+#define SIM_SWITCH_US 2000                                                  // Deaf after a channel switch
+#define SIM_TICK_US 1000
+
+typedef struct {
+    uint8_t channel;
+    uint32_t phase_us;
+} sim_ap_t;
+
+typedef struct {
+    sim_ap_t aps[SIM_APS];
+    double data_fps[SIM_CHANNELS + 1];
+} sim_site_t;
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint32_t poisson(double mean) {                                      // Knuth, mean is small per tick
+    double limit = exp(-mean), p = 1.0;
+    uint32_t k = 0;
+    do {
+        k++;
+        p *= (rng() + 1.0) / 4294967296.0;
+    } while (p > limit);
+    return k - 1;
+}
+
+static void make_site(sim_site_t *site) {
+    static const double data_fps[SIM_CHANNELS + 1] = { 0, 600, 5, 10, 0, 20, 1200, 0, 5, 10, 0, 400, 0, 30 };
+    rng_state = 0x5eed;
+    for (size_t i = 0; i < SIM_APS; i++) {
+        static const uint8_t busy[] = { 1, 6, 11 };
+        site->aps[i].channel = i % 5 < 3 ? busy[rng() % 3] : (uint8_t) (1 + rng() % SIM_CHANNELS);
+        site->aps[i].phase_us = rng() % SIM_BEACON_US;
+    }
+    for (size_t c = 0; c <= SIM_CHANNELS; c++) {
+        site->data_fps[c] = data_fps[c];
+    }
+}
+
+typedef struct {
+    double coverage;
+    double all_found_s;                                                     // -1 if some AP was never seen
+    double mean_dwell_ms;
+} sim_result_t;
+
+static sim_result_t simulate(const sim_site_t *site, uint16_t min_dwell, uint16_t max_dwell, bool adaptive,
+                             uint32_t duration_s) {
+    static const uint8_t channels[SIM_CHANNELS] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 };
+    hop_scheduler_t sched;
+    hop_scheduler_init(&sched, channels, SIM_CHANNELS, min_dwell, max_dwell, adaptive);
+    rng_state = 0xfeed;
+
+    bool found[SIM_APS] = { false };
+    size_t found_count = 0;
+    sim_result_t result = { .all_found_s = -1 };
+    uint64_t captured = 0, on_air = 0;
+    uint32_t visits = 0;
+
+    uint64_t end_us = (uint64_t) duration_s * 1000000;
+    uint64_t visit_start = 0;
+    uint64_t visit_end = hop_scheduler_dwell(&sched, 0) * 1000ULL;
+    uint32_t visit_frames = 0, visit_new = 0;
+    for (uint64_t t = 0; t < end_us; t += SIM_TICK_US) {
+        if (t >= visit_end) {
+            hop_scheduler_next(&sched, visit_frames, visit_new, (uint32_t) ((t - visit_start) / 1000));
+            visits++;
+            visit_start = t;
+            visit_end = t + hop_scheduler_dwell(&sched, sched.current) * 1000ULL;
+            visit_frames = visit_new = 0;
+        }
+        uint8_t tuned = hop_scheduler_channel(&sched);
+        bool deaf = t - visit_start < SIM_SWITCH_US;
+
+        for (size_t c = 1; c <= SIM_CHANNELS; c++) {                        // Data frames, every channel counts as on air
+            uint32_t n = poisson(site->data_fps[c] * SIM_TICK_US / 1e6);
+            on_air += n;
+            if (c == tuned && !deaf) {
+                captured += n;
+                visit_frames += n;
+            }
+        }
+        for (size_t i = 0; i < SIM_APS; i++) {                              // Beacon due within this tick
+            const sim_ap_t *ap = &site->aps[i];
+            if (t + SIM_TICK_US <= ap->phase_us) {
+                continue;
+            }
+            uint64_t since = t + SIM_TICK_US - 1 - ap->phase_us;
+            if (since % SIM_BEACON_US >= SIM_TICK_US) {
+                continue;
+            }
+            on_air++;
+            if (ap->channel != tuned || deaf) {
+                continue;
+            }
+            captured++;
+            visit_frames++;
+            if (!found[i]) {
+                found[i] = true;
+                visit_new++;
+                if (++found_count == SIM_APS) {
+                    result.all_found_s = (t + SIM_TICK_US) / 1e6;
+                }
+            }
+        }
+    }
+    result.coverage = on_air > 0 ? 100.0 * captured / on_air : 0;
+    result.mean_dwell_ms = visits > 0 ? (double) end_us / 1000 / visits : 0;
+    return result;
+}
+
+static void report(const char *policy, sim_result_t r) {
+    char name[64];
+    snprintf(name, sizeof(name), "hop.%s.coverage", policy);
+    bench_report(name, r.coverage, "%");
+    snprintf(name, sizeof(name), "hop.%s.all_aps_found", policy);
+    bench_report(name, r.all_found_s, "s");
+    snprintf(name, sizeof(name), "hop.%s.mean_dwell", policy);
+    bench_report(name, r.mean_dwell_ms, "ms");
+}
+
+bool bench_hop(bool quick) {
+    static sim_site_t site;
+    make_site(&site);
+    const uint32_t duration_s = quick ? 30 : 300;
+    const uint16_t min_dwell = CONFIG_CHANNEL_HOP_MIN_DWELL_MS, max_dwell = CONFIG_CHANNEL_HOP_MAX_DWELL_MS;
+
+    sim_result_t adaptive = simulate(&site, min_dwell, max_dwell, true, duration_s);
+    sim_result_t rr_min = simulate(&site, min_dwell, max_dwell, false, duration_s);
+    sim_result_t rr_mid = simulate(&site, (min_dwell + max_dwell) / 2, max_dwell, false, duration_s);
+    report("adaptive", adaptive);
+    report("round_robin_min", rr_min);
+    report("round_robin_mid", rr_mid);
+
+    return bench_check(adaptive.all_found_s > 0 && rr_min.all_found_s > 0, "every AP found")
+        && bench_check(adaptive.coverage > rr_min.coverage && adaptive.coverage > rr_mid.coverage,
+                       "adaptive dwell captures more of the traffic");
+}
@@ -0,0 +1,95 @@
+/**
+ * @file bench_lifecycle.c
+ * @brief Wi-Fi lifecycle against the radio mock with zero air time: driver bring-up, latency of the first
+ *        and of repeated one-channel scans, and the time a scan/sniff mode switch spends in the controller.
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "ap_scanner.h"
+#include "ap_table.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+static const mock_ap_t bench_ap = {
+    .bssid = { 0x02, 0, 0, 0, 0, 1 }, .ssid = "bench", .channel = 6, .rssi = -40, .authmode = WIFI_AUTH_WPA2_PSK
+};
+
+static atomic_bool scan_done;
+
+static void scan_callback(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    if (done) {
+        atomic_store(&scan_done, true);
+    }
+}
+
+/**
+ * @brief Runs one scan of channel 6 and returns the time from request to the done callback in ns.
+ **/
+static uint64_t timed_scan(void) {
+    static const uint8_t channels[] = { 6 };
+    atomic_store(&scan_done, false);
+    uint64_t start = bench_now_ns();
+    if (wifictl_scan_start_async(channels, 1) != ESP_OK) {
+        return 0;
+    }
+    while (!atomic_load(&scan_done)) {
+        vTaskDelay(0);
+    }
+    return bench_now_ns() - start;
+}
+
+bool bench_lifecycle(bool quick) {
+    const int runs = quick ? 20 : 500;
+    bool ok = true;
+    mock_radio_reset();
+    mock_radio_set_aps(&bench_ap, 1);
+    mock_radio_set_scan_time(0);                                            // Measure the controller, not the air
+    ok &= bench_check(wifictl_register_scan_callback(scan_callback), "callback registered");
+
+    wifictl_lifecycle_stats_t stats;
+    wifictl_get_lifecycle_stats(&stats);
+    bench_report("lifecycle.init", stats.transitions[WIFICTL_MODE_UNINIT][WIFICTL_MODE_IDLE].last_us, "us");
+
+    uint64_t first_ns = timed_scan();
+    ok &= bench_check(first_ns > 0, "first scan accepted");
+    bench_report("lifecycle.first_scan", (double) first_ns / 1000.0, "us");
+
+    uint64_t total_ns = 0;
+    for (int i = 0; i < runs; i++) {
+        uint64_t ns = timed_scan();
+        ok &= bench_check(ns > 0, "repeated scan accepted");
+        total_ns += ns;
+    }
+    bench_report("lifecycle.repeat_scan", (double) total_ns / 1000.0 / runs, "us");
+
+    mock_radio_set_scan_time(1000000);                                      // Long enough to be cancelled
+    uint64_t switch_ns = 0;
+    for (int i = 0; i < runs; i++) {
+        ok &= bench_check(wifictl_scan_start_async(NULL, 0) == ESP_OK, "scan started");
+        uint64_t start = bench_now_ns();
+        ok &= bench_check(wifictl_sniffer_start(6) == ESP_OK, "sniffer started");
+        switch_ns += bench_now_ns() - start;
+        wifictl_sniffer_stop();
+        vTaskDelay(1);                                                      // Let the stopped request report, or the scanner refuses
+    }
+    bench_report("lifecycle.scan_to_sniff", (double) switch_ns / 1000.0 / runs, "us");
+
+    wifictl_get_lifecycle_stats(&stats);
+    const wifictl_transition_t *to_sniff = &stats.transitions[WIFICTL_MODE_SCANNING][WIFICTL_MODE_SNIFFING];
+    const wifictl_transition_t *to_idle = &stats.transitions[WIFICTL_MODE_SNIFFING][WIFICTL_MODE_IDLE];
+    bench_report("lifecycle.scan_to_sniff_max", to_sniff->max_us, "us");
+    bench_report("lifecycle.sniff_to_idle_max", to_idle->max_us, "us");
+    ok &= bench_check(to_sniff->count >= (uint32_t) runs, "every switch recorded");
+    ok &= bench_check(host_wifi_init_count() == 1, "driver initialized once");
+
+    wifictl_unregister_scan_callback(scan_callback);
+    mock_radio_reset();
+    return ok;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file bench_parser.cpp
+ * @brief 802.11 parser over a synthetic beacon corpus: header and element walk with compile-time
+ *        dispatch, and the full beacon to AP record conversion the sniffer's parse stage runs.
+ */
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "beacon_parser.h"
+#include "ieee80211.hpp"
+
+using namespace ieee80211;
+
+namespace {
+
+constexpr size_t kCorpusSize = 256;
+
+struct Corpus {
+    uint8_t frames[kCorpusSize][512];
+    size_t lengths[kCorpusSize];
+    size_t bytes = 0;
+};
+
+void build_corpus(Corpus &corpus) {
+    static const wifi_auth_mode_t modes[] = { WIFI_AUTH_OPEN, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK,
+                                              WIFI_AUTH_WPA3_PSK, WIFI_AUTH_WPA2_WPA3_PSK, WIFI_AUTH_ENTERPRISE };
+    static const uint8_t ht_caps[] = { 45, 26, 0xef, 0x01, 0x1b, 0xff, 0xff };
+    for (size_t i = 0; i < kCorpusSize; i++) {
+        mock_ap_t ap = {};
+        ap.bssid[0] = 0x02;
+        ap.bssid[5] = uint8_t(i);
+        std::snprintf(ap.ssid, sizeof(ap.ssid), i % 7 == 0 ? "%zu" : "corpus-network-%zu", i);
+        ap.channel = uint8_t(1 + i % 13);
+        ap.authmode = modes[i % (sizeof(modes) / sizeof(modes[0]))];
+        size_t len = mock_build_beacon(&ap, uint16_t(i), corpus.frames[i], sizeof(corpus.frames[i]) - 28);
+        if (i % 2 == 0) {                                                   // HT capabilities on half of them
+            std::memset(&corpus.frames[i][len], 0, 28);
+            std::memcpy(&corpus.frames[i][len], ht_caps, sizeof(ht_caps));
+            len += 28;
+        }
+        corpus.lengths[i] = len;
+        corpus.bytes += len;
+    }
+}
+
+}  // namespace
+
+bool bench_parser(bool quick) {
+    static Corpus corpus;
+    build_corpus(corpus);
+    const uint32_t passes = quick ? 200 : 20000;
+
+    size_t channels = 0, elements = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < kCorpusSize; i++) {
+            auto mf = ManagementFrame::parse(ByteView(corpus.frames[i], corpus.lengths[i]));
+            if (!mf) {
+                continue;
+            }
+            elements += dispatch_ies<Ssid, DsParameterSet, Rsn, HtCapabilities>(mf->ies(), [&](const auto &ie) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(ie)>, DsParameterSet>) {
+                    channels += ie.channel;
+                }
+            });
+        }
+    }
+    double frames = double(passes) * kCorpusSize;
+    bench_report("parser.dispatch", double(bench_now_ns() - start) / frames, "ns/frame");
+
+    size_t parsed = 0;
+    wifi_ap_record_t record;
+    start = bench_now_ns();
+    for (uint32_t p = 0; p < passes; p++) {
+        for (size_t i = 0; i < kCorpusSize; i++) {
+            parsed += wifictl_parse_beacon(corpus.frames[i], corpus.lengths[i], &record);
+        }
+    }
+    double ns = double(bench_now_ns() - start) / frames;
+    bench_report("parser.beacon_record", ns, "ns/frame");
+    bench_report("parser.beacon_record_bytes", corpus.bytes / (double(kCorpusSize) * ns) * 1e3, "MB/s");
+
+    return bench_check(parsed == frames, "every corpus beacon parsed")
+        && bench_check(elements % passes == 0 && elements / passes > 2 * kCorpusSize, "SSID, DS and more per beacon")
+        && bench_check(channels > 0, "channels read");
+}
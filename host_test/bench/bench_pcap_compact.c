@@ -0,0 +1,266 @@
+/**
+ * @file bench_pcap_compact.c
+ * @brief Compact PCAP stream on a synthetic dense-site trace: 60 APs on the sniffed channel beaconing
+ *        every 102.4 ms with HT, WMM and RSN elements, encrypted data frames and probe traffic. The
+ *        trace runs through the sniffer and the export on its own clock for the byte ratio against
+ *        plain PCAP; deduplication and compression are then timed on their own for the CPU cost per frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "beacon_dedup.h"
+#include "driver/uart.h"
+#include "frame_codec.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pcap_export.h"
+#include "sniffer.h"
+
+#define SITE_APS 60
+#define BEACON_INTERVAL_US 102400
+#define DATA_PER_S 300
+#define PROBES_PER_S 30
+#define MAX_TRACE 40000
+#define RADIOTAP_LEN 46
+#define STREAM_PORT UART_NUM_1
+
+typedef struct {
+    uint32_t offset;                                                        // Into trace_bytes, frame is followed by a zero FCS
+    uint16_t len;
+    uint32_t timestamp;
+    int8_t rssi;
+    bool data;
+} trace_frame_t;
+
+static trace_frame_t trace[MAX_TRACE];
+static uint8_t trace_bytes[MAX_TRACE * 304];
+static size_t trace_len, trace_used;
+static mock_ap_t site_aps[SITE_APS];
+static uint32_t rng_state = 5;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static size_t put(uint8_t *frame, size_t at, const uint8_t *element, size_t len) {
+    memcpy(&frame[at], element, len);
+    return at + len;
+}
+
+/**
+ * @brief Beacon as APs of a busy site send it: the mock's SSID, rates, DS and RSN elements plus TIM,
+ *        HT capabilities and operation, extended capabilities, WMM parameters and, on some, WPS.
+ */
+static size_t site_beacon(int a, uint16_t seq, uint64_t tsf, uint8_t *frame) {
+    static const uint8_t ht_cap[] = { 0x2d, 0x1a, 0xef, 0x19, 0x1b, 0xff, 0xff, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const uint8_t ext_cap[] = { 0x7f, 0x08, 0x04, 0, 0, 0, 0, 0, 0, 0x40 };
+    static const uint8_t wmm[] = { 0xdd, 0x18, 0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x80, 0x00, 0x03, 0xa4, 0x00,
+                                   0x00, 0x27, 0xa4, 0x00, 0x00, 0x42, 0x43, 0x5e, 0x00, 0x62, 0x32, 0x2f, 0x00 };
+    static const uint8_t wps[] = { 0xdd, 0x0e, 0x00, 0x50, 0xf2, 0x04, 0x10, 0x4a, 0x00, 0x01, 0x10, 0x10, 0x44,
+                                   0x00, 0x01, 0x02 };
+    const mock_ap_t *ap = &site_aps[a];
+    size_t at = mock_build_beacon(ap, seq, frame, 300);
+    for (int i = 0; i < 8; i++) {
+        frame[24 + i] = (uint8_t) (tsf >> (8 * i));
+    }
+    const uint8_t tim[] = { 5, 4, (uint8_t) (seq % 3), 3, 0, (uint8_t) (rng() % 4 == 0 ? 1 << (rng() % 8) : 0) };
+    at = put(frame, at, tim, sizeof(tim));
+    at = put(frame, at, ht_cap, sizeof(ht_cap));
+    uint8_t ht_op[24] = { 0x3d, 0x16, ap->channel, (uint8_t) (a % 4) };
+    at = put(frame, at, ht_op, sizeof(ht_op));
+    at = put(frame, at, ext_cap, sizeof(ext_cap));
+    at = put(frame, at, wmm, sizeof(wmm));
+    if (a % 4 == 0) {
+        at = put(frame, at, wps, sizeof(wps));
+    }
+    return at;
+}
+
+static trace_frame_t *add_frame(uint32_t timestamp, int8_t rssi) {
+    trace_frame_t *f = &trace[trace_len++];
+    *f = (trace_frame_t) { .offset = (uint32_t) trace_used, .timestamp = timestamp, .rssi = rssi };
+    return f;
+}
+
+static void end_frame(trace_frame_t *f) {
+    memset(&trace_bytes[f->offset + f->len], 0, 4);
+    trace_used += f->len + 4;
+}
+
+/**
+ * @brief Builds `seconds` of the site at 100 us resolution. Beacon RSSI jitters by a few dB like on air.
+ */
+static void build_trace(int seconds) {
+    static const uint8_t station[6] = { 0x06, 0, 0, 0, 0, 1 };
+    static const uint8_t probe[] = { 0x40, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x06, 0, 0, 0, 0, 2, 0xff, 0xff,
+                                     0xff, 0xff, 0xff, 0xff, 0x10, 0, 0, 0, 1, 8, 0x02, 0x04, 0x0b, 0x16, 0x0c, 0x12,
+                                     0x18, 0x24, 0x32, 0x04, 0x30, 0x48, 0x60, 0x6c };
+    trace_len = trace_used = 0;
+    for (int a = 0; a < SITE_APS; a++) {
+        site_aps[a] = (mock_ap_t) { .bssid = { 0x02, 0x5e, 0, 0, (uint8_t) (a >> 8), (uint8_t) a }, .channel = 6,
+                                    .rssi = (int8_t) (-45 - a / 2),
+                                    .authmode = a % 5 == 0 ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK };
+        snprintf(site_aps[a].ssid, sizeof(site_aps[a].ssid), "dense-site-%02d", a);
+    }
+    uint32_t next_beacon[SITE_APS];
+    uint16_t beacon_seq[SITE_APS] = { 0 };
+    for (int a = 0; a < SITE_APS; a++) {
+        next_beacon[a] = 1000 + rng() % BEACON_INTERVAL_US;
+    }
+    for (uint32_t t = 1000; t < (uint32_t) seconds * 1000000 && trace_len < MAX_TRACE - 2; t += 100) {
+        for (int a = 0; a < SITE_APS && trace_len < MAX_TRACE - 2; a++) {
+            if (t < next_beacon[a]) {
+                continue;
+            }
+            next_beacon[a] += BEACON_INTERVAL_US;
+            trace_frame_t *f = add_frame(t, (int8_t) (site_aps[a].rssi - (int) (rng() % 5)));
+            f->len = (uint16_t) site_beacon(a, beacon_seq[a]++, t, &trace_bytes[f->offset]);
+            end_frame(f);
+        }
+        if (rng() % (10000 / DATA_PER_S) == 0) {                           // Encrypted data, mostly short
+            trace_frame_t *f = add_frame(t + 50, (int8_t) (-50 - rng() % 30));
+            size_t payload = rng() % 4 == 0 ? 200 + rng() % 100 : 16 + rng() % 100;
+            uint8_t *frame = &trace_bytes[f->offset];
+            f->len = (uint16_t) mock_build_data(site_aps[rng() % SITE_APS].bssid, station, (uint16_t) t, payload, frame, 300);
+            f->data = true;
+            for (size_t i = 24; i < f->len; i++) {
+                frame[i] = (uint8_t) rng();
+            }
+            end_frame(f);
+        }
+        if (rng() % (10000 / PROBES_PER_S) == 0) {
+            trace_frame_t *f = add_frame(t + 70, -75);
+            f->len = sizeof(probe);
+            memcpy(&trace_bytes[f->offset], probe, sizeof(probe));
+            end_frame(f);
+        }
+    }
+}
+
+/**
+ * @brief Frames the export has handled plus frames the sniffer dropped since `dropped_before`.
+ */
+static uint32_t settled(uint32_t dropped_before) {
+    wifictl_pcap_stats_t stats;
+    wifictl_sniffer_stats_t sniffer;
+    wifictl_pcap_export_get_stats(&stats);
+    wifictl_sniffer_get_stats(&sniffer);
+    return stats.records + stats.beacons_suppressed + stats.truncated + sniffer.dropped - dropped_before;
+}
+
+/**
+ * @brief Streams the trace through sniffer and export, paced to a few frames in flight so the frame pool
+ *        never runs dry.
+ * @param stream Receives the stream, freed by the caller.
+ */
+static bool stream_trace(bool compact, wifictl_pcap_stats_t *stats, char **stream, size_t *stream_len) {
+    FILE *out = open_memstream(stream, stream_len);
+    host_uart_set_output(STREAM_PORT, out);
+    wifictl_sniffer_stats_t sniffer;
+    wifictl_sniffer_get_stats(&sniffer);
+    uint32_t dropped_before = sniffer.dropped;
+    bool ok = bench_check(wifictl_sniffer_start(6) == ESP_OK, "sniffer started")
+           && bench_check(wifictl_pcap_export_start(STREAM_PORT, 2000000, compact) == ESP_OK, "export started");
+    for (size_t i = 0; ok && i < trace_len; i++) {
+        const trace_frame_t *f = &trace[i];
+        mock_radio_deliver_at(&trace_bytes[f->offset], f->len, f->data ? WIFI_PKT_DATA : WIFI_PKT_MGMT, f->rssi,
+                              f->timestamp);
+        while ((i % 8 == 7 || i == trace_len - 1) && settled(dropped_before) != i + 1) {
+            vTaskDelay(0);
+        }
+    }
+    wifictl_sniffer_get_stats(&sniffer);
+    ok &= bench_check(sniffer.dropped == dropped_before, "no frame dropped");
+    wifictl_pcap_export_get_stats(stats);
+    wifictl_pcap_export_stop();
+    wifictl_sniffer_stop();
+    host_uart_set_output(STREAM_PORT, NULL);
+    fclose(out);
+    return ok;
+}
+
+static void count_summary(const beacon_summary_t *summary, void *ctx) {
+    (*(uint32_t *) ctx)++;
+}
+
+bool bench_pcap_compact(bool quick) {
+    bool ok = true;
+    mock_radio_reset();
+    build_trace(quick ? 3 : 30);
+    double seconds = trace[trace_len - 1].timestamp / 1e6;
+
+    wifictl_pcap_stats_t plain, compact;
+    char *stream = NULL;
+    size_t stream_len = 0;
+    ok &= stream_trace(false, &plain, &stream, &stream_len);
+    free(stream);
+    ok &= stream_trace(true, &compact, &stream, &stream_len);
+    ok &= bench_check(compact.bytes == stream_len && plain.pcap_bytes == compact.pcap_bytes, "whole trace streamed");
+    bench_report("pcap_compact.trace_rate", trace_len / seconds, "frames/s");
+    bench_report("pcap_compact.plain_rate", plain.bytes / seconds / 1000, "kB/s");
+    bench_report("pcap_compact.compact_rate", compact.bytes / seconds / 1000, "kB/s");
+    bench_report("pcap_compact.ratio", (double) plain.bytes / compact.bytes, "x");
+    bench_report("pcap_compact.beacons_summarised", 100.0 * compact.beacons_suppressed / trace_len, "% of frames");
+    bench_report("pcap_compact.records_compressed", 100.0 * compact.compressed / compact.records, "%");
+
+    // CPU cost on its own, with the dictionary the stream carries and its radiotap template in front of every frame
+    uint16_t dict_len;
+    memcpy(&dict_len, stream + 6, sizeof(dict_len));
+    static uint8_t window[1024 + RADIOTAP_LEN + 400], compressed[RADIOTAP_LEN + 400];
+    frame_codec_t codec;
+    ok &= bench_check(dict_len <= 1024 && frame_codec_init(&codec, window, dict_len + RADIOTAP_LEN + 400,
+                                                           (const uint8_t *) stream + 8, dict_len), "dictionary");
+    free(stream);
+
+    static beacon_dedup_t dedup;
+    static uint8_t passed[MAX_TRACE];
+    const int rounds = quick ? 2 : 10;
+    uint32_t summaries = 0;
+    uint64_t dedup_ns = 0, codec_ns = 0, codec_in = 0, codec_out = 0, codec_frames = 0;
+    for (int r = 0; r < rounds; r++) {
+        beacon_dedup_init(&dedup, CONFIG_PCAP_EXPORT_SUMMARY_MS, CONFIG_PCAP_EXPORT_BEACON_REFRESH_MS);
+        uint64_t start = bench_now_ns();
+        for (size_t i = 0; i < trace_len; i++) {
+            const trace_frame_t *f = &trace[i];
+            passed[i] = beacon_dedup_observe(&dedup, &trace_bytes[f->offset], f->len + 4, f->rssi, 6, f->timestamp,
+                                             count_summary, &summaries);
+            if (i % 32 == 31) {
+                beacon_dedup_flush(&dedup, f->timestamp, count_summary, &summaries);
+            }
+        }
+        dedup_ns += bench_now_ns() - start;
+
+        start = bench_now_ns();
+        for (size_t i = 0; i < trace_len; i++) {
+            if (!passed[i]) {
+                continue;
+            }
+            const trace_frame_t *f = &trace[i];
+            uint8_t *input = frame_codec_input(&codec);
+            memcpy(input, window + dict_len - RADIOTAP_LEN, RADIOTAP_LEN);
+            memcpy(input + 16, &f->timestamp, sizeof(f->timestamp));        // TSFT changes per record
+            uint32_t seq = (uint32_t) i;
+            memcpy(input + 42, &seq, sizeof(seq));                          // Capture sequence number
+            memcpy(input + RADIOTAP_LEN, &trace_bytes[f->offset], f->len);
+            size_t n = frame_codec_compress(&codec, RADIOTAP_LEN + f->len, compressed, RADIOTAP_LEN + f->len - 1);
+            codec_in += RADIOTAP_LEN + f->len;
+            codec_out += n > 0 ? n : RADIOTAP_LEN + f->len;
+            codec_frames++;
+        }
+        codec_ns += bench_now_ns() - start;
+    }
+    bench_report("pcap_compact.dedup_cost", (double) dedup_ns / (rounds * trace_len), "ns/frame");
+    bench_report("pcap_compact.codec_cost", (double) codec_ns / codec_frames, "ns/record");
+    bench_report("pcap_compact.cpu_per_frame", (double) (dedup_ns + codec_ns) / (rounds * trace_len), "ns/frame");
+    bench_report("pcap_compact.codec_ratio", (double) codec_in / codec_out, "x");
+    ok &= bench_check(compact.bytes * 3 < plain.bytes * 2, "compact stream at least 1.5x smaller");
+    ok &= bench_check(summaries > 0 && dedup.suppressed > dedup.passed, "beacons summarised");
+    mock_radio_reset();
+    return ok;
+}
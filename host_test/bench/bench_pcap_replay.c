@@ -0,0 +1,173 @@
+/**
+ * @file bench_pcap_replay.c
+ * @brief PCAP replay on a recorded dense-site trace: reader cost per record, and the rate the sniffer
+ *        consumers sustain when the file is replayed as fast as possible into the staged pipeline with
+ *        the AP and station tables tracking and an export checksum, as in bench_pipeline. The file loops
+ *        for a fixed time. The host port ignores task priorities, so the replay task does not yield to the
+ *        pipeline as on the device; what it delivers beyond the sustained rate is dropped and counted.
+ *        The paced figure is the highest recorded-speed multiple replayed without a drop. Pacing wakes once
+ *        per tick and delivers the frames due as one burst, so it is bounded by the frame pool per tick.
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "ap_table.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pcap_reader.h"
+#include "pcap_replay.h"
+#include "sniffer.h"
+#include "station_table.h"
+
+#define SITE_APS 48
+#define SITE_CLIENTS 8                                                      // Per AP
+#define SPACING_US 50                                                       // 20000 frames per second recorded
+
+static const uint8_t radiotap[] = {                                         // Flags (FCS), rate, channel, signal, noise
+    0, 0, 16, 0, 0x6e, 0, 0, 0, 0x10, 12, 0x85, 0x09, 0xa0, 0x00, 0, (uint8_t) -95,
+};
+
+static atomic_uint processed;
+static atomic_uint checksum;
+
+static void export_batch(const wifictl_frame_t *const *frames, size_t count) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (uint16_t b = 0; b < frames[i]->pkt.rx_ctrl.sig_len; b += 8) {
+            sum = sum * 31 + frames[i]->pkt.payload[b];
+        }
+    }
+    atomic_fetch_add(&checksum, sum);
+    atomic_fetch_add(&processed, count);
+}
+
+static void put32(FILE *file, uint32_t value) {
+    fwrite(&value, 1, 4, file);
+}
+
+/**
+ * @brief Writes `frames` records of one beacon per three data frames from SITE_APS APs.
+ **/
+static bool write_trace(const char *path, uint32_t frames) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    static const uint32_t header[] = { 0xa1b2c3d4, 0x00040002, 0, 0, 65535, 127 };
+    fwrite(header, 1, sizeof(header), file);
+    uint8_t record[sizeof(radiotap) + MOCK_RADIO_MAX_FRAME + 4];
+    memcpy(record, radiotap, sizeof(radiotap));
+    for (uint32_t seq = 0; seq < frames; seq++) {
+        uint8_t ap_index = (uint8_t) ((seq / 4) % SITE_APS);
+        mock_ap_t ap = { .bssid = { 0x02, 0, 0, 0, 0, ap_index }, .channel = 6, .authmode = WIFI_AUTH_WPA2_PSK };
+        snprintf(ap.ssid, sizeof(ap.ssid), "site-%u", ap_index);
+        uint8_t station[6] = { 0x06, 0, 0, 0, ap_index, (uint8_t) (seq % SITE_CLIENTS) };
+        uint8_t *frame = record + sizeof(radiotap);
+        size_t len = seq % 4 == 0 ? mock_build_beacon(&ap, (uint16_t) seq, frame, MOCK_RADIO_MAX_FRAME)
+                                  : mock_build_data(ap.bssid, station, (uint16_t) seq, 64 + seq % 1200, frame,
+                                                    MOCK_RADIO_MAX_FRAME);
+        memset(frame + len, 0, 4);                                          // FCS
+        record[14] = (uint8_t) (-40 - ap_index);                            // Signal
+        uint64_t at_us = (uint64_t) seq * SPACING_US;
+        uint32_t caplen = (uint32_t) (sizeof(radiotap) + len + 4);
+        put32(file, (uint32_t) (at_us / 1000000));
+        put32(file, (uint32_t) (at_us % 1000000));
+        put32(file, caplen);
+        put32(file, caplen);
+        fwrite(record, 1, caplen, file);
+    }
+    return fclose(file) == 0;
+}
+
+typedef struct {
+    uint32_t delivered;                                                     // Handed to the sniffer callback
+    uint32_t consumed;                                                      // Through the stages while the replay ran
+    uint32_t dropped;
+    uint32_t elapsed_ms;
+} replay_run_t;
+
+/**
+ * @brief Replays the looping file for duration_ms and waits for the stages to drain.
+ **/
+static bool run_replay(const char *path, uint32_t speed_percent, uint32_t duration_ms, replay_run_t *run) {
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    atomic_store(&processed, 0);
+    bool ok = bench_check(wifictl_replay_install(path, speed_percent, 0) == ESP_OK, "replay installed");
+    ok &= bench_check(wifictl_sniffer_start(6) == ESP_OK, "sniffer start");
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    wifictl_sniffer_stop();                                                 // Ends the replay task
+    run->consumed = atomic_load(&processed);
+    wifictl_replay_stats_t stats;
+    wifictl_replay_get_stats(&stats);
+    wifictl_replay_uninstall();
+    wifictl_sniffer_get_stats(&after);
+    while (atomic_load(&processed) < after.captured - before.captured) {    // Backlog of the stages
+        vTaskDelay(1);
+    }
+    run->delivered = stats.frames;
+    run->dropped = after.dropped - before.dropped;
+    run->elapsed_ms = stats.elapsed_ms;
+    ok &= bench_check(stats.errors == 0 && stats.skipped == 0, "replay: no skipped records");
+    ok &= bench_check(after.captured - before.captured + run->dropped == stats.frames, "replay: every frame captured or counted");
+    return ok;
+}
+
+bool bench_pcap_replay(bool quick) {
+    const uint32_t frames = quick ? 10000 : 50000;
+    const uint32_t duration_ms = quick ? 300 : 3000;
+    const uint32_t step_ms = quick ? 100 : 1000;                            // Per paced speed tried
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/bench_replay_%d.pcap", (int) getpid());
+    bool ok = bench_check(write_trace(path, frames), "trace written");
+
+    pcap_reader_t *reader = malloc(sizeof(*reader));
+    FILE *file = fopen(path, "rb");
+    ok &= bench_check(file != NULL && pcap_reader_open(reader, file), "reader opened");
+    pcap_reader_frame_t frame;
+    uint32_t read = 0;
+    uint64_t start = bench_now_ns();
+    while (file != NULL && pcap_reader_next(reader, &frame) == PCAP_READER_FRAME) {
+        read++;
+    }
+    bench_report("pcap_replay.reader", (double) (bench_now_ns() - start) / frames, "ns/record");
+    ok &= bench_check(read == frames && reader->skipped == 0, "reader: every record");
+    if (file != NULL) {
+        fclose(file);
+    }
+    free(reader);
+
+    wifictl_ap_table_clear();
+    wifictl_station_table_clear();
+    ok &= bench_check(wifictl_ap_table_track_beacons(true) && wifictl_station_table_track(true)
+                      && wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, export_batch), "handlers");
+    replay_run_t run;
+    ok &= run_replay(path, PCAP_REPLAY_MAX_SPEED, duration_ms, &run);
+    double seconds = run.elapsed_ms > 0 ? run.elapsed_ms / 1000.0 : 1e-3;
+    bench_report("pcap_replay.max_speed.delivered", run.delivered / seconds, "frames/s");
+    bench_report("pcap_replay.max_speed.consumed", run.consumed / seconds, "frames/s");
+    bench_report("pcap_replay.max_speed.dropped", run.delivered > 0 ? 100.0 * run.dropped / run.delivered : 0, "%");
+    ok &= bench_check(wifictl_ap_table_count() == SITE_APS, "replay: every AP parsed");
+
+    uint32_t sustained = 0;                                                 // Highest paced speed without a drop
+    for (uint32_t speed = 10; speed <= 6400; speed = speed * 3 / 2) {
+        ok &= run_replay(path, speed, step_ms, &run);
+        if (run.dropped > 0) {
+            break;
+        }
+        sustained = speed;
+    }
+    bench_report("pcap_replay.paced.sustained", (double) sustained * (1000000 / SPACING_US) / 100, "frames/s");
+
+    wifictl_sniffer_unregister_batch_handler(export_batch);
+    wifictl_ap_table_track_beacons(false);
+    wifictl_station_table_track(false);
+    unlink(path);
+    return ok;
+}
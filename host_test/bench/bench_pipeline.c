@@ -0,0 +1,157 @@
+/**
+ * @file bench_pipeline.c
+ * @brief Sustained capture rate of the staged pipeline against the former design, where the promiscuous
+ *        callback posted every frame to the default event loop and one handler parsed and aggregated it.
+ *        Both run the same per-frame work: beacon parsing into the AP table, station tracking and a
+ *        checksum standing in for export, on a dense-site mix of beacons and data frames. The stages
+ *        only overlap with two or more host CPUs; on one CPU the figures show the pipeline's overhead.
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "ap_table.h"
+#include "beacon_parser.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "radio.h"
+#include "sniffer.h"
+#include "station_table.h"
+
+#define SITE_APS 48
+#define SITE_CLIENTS 8                                                      // Per AP
+#define OFFERED_RATE 1000000                                                // Frames per second, more than either design sustains
+
+static mock_ap_t site_aps[SITE_APS];
+static atomic_uint processed;
+static atomic_uint legacy_post_failed;
+static atomic_uint checksum;
+
+static size_t site_frame(void *ctx, uint8_t channel, uint32_t seq, uint8_t *frame, size_t max,
+                         wifi_promiscuous_pkt_type_t *type, int8_t *rssi) {
+    const mock_ap_t *ap = &site_aps[(seq / 4) % SITE_APS];
+    *rssi = ap->rssi;
+    if (seq % 4 == 0) {                                                     // One beacon per three data frames
+        *type = WIFI_PKT_MGMT;
+        return mock_build_beacon(ap, (uint16_t) seq, frame, max);
+    }
+    uint8_t station[6] = { 0x06, 0, 0, 0, ap->bssid[5], (uint8_t) (seq % SITE_CLIENTS) };
+    *type = WIFI_PKT_DATA;
+    return mock_build_data(ap->bssid, station, (uint16_t) seq, 64 + seq % 1200, frame, max);
+}
+
+static uint32_t export_work(const wifi_promiscuous_pkt_t *pkt) {
+    uint32_t sum = 0;
+    for (uint16_t i = 0; i < pkt->rx_ctrl.sig_len; i += 8) {
+        sum = sum * 31 + pkt->payload[i];
+    }
+    return sum;
+}
+
+static void export_batch(const wifictl_frame_t *const *frames, size_t count) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += export_work(&frames[i]->pkt);
+    }
+    atomic_fetch_add(&checksum, sum);
+    atomic_fetch_add(&processed, count);
+}
+
+static void legacy_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    const wifi_promiscuous_pkt_t *pkt = data;
+    uint32_t now_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    size_t len = pkt->rx_ctrl.sig_len - 4;
+    if (id == SNIFFER_EVENT_CAPTURED_MGMT) {
+        wifi_ap_record_t record;
+        if (wifictl_parse_beacon(pkt->payload, len, &record)) {
+            record.rssi = pkt->rx_ctrl.rssi;
+            wifictl_ap_table_update(&record, now_ms, AP_SOURCE_BEACON);
+        }
+    }
+    wifictl_station_table_update(pkt->payload, len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel, now_ms);
+    atomic_fetch_add(&checksum, export_work(pkt));
+    atomic_fetch_add(&processed, 1);
+}
+
+static void legacy_frame_handler(void *buf, wifi_promiscuous_pkt_type_t type) {
+    const wifi_promiscuous_pkt_t *pkt = buf;
+    int32_t id = type == WIFI_PKT_MGMT ? SNIFFER_EVENT_CAPTURED_MGMT : SNIFFER_EVENT_CAPTURED_DATA;
+    if (esp_event_post(SNIFFER_EVENTS, id, pkt, pkt->rx_ctrl.sig_len + sizeof(*pkt), 0) != ESP_OK) {
+        atomic_fetch_add(&legacy_post_failed, 1);                           // Blocking here would stall the Wi-Fi task
+    }
+}
+
+/**
+ * @brief Offers traffic for duration_ms and waits for the backlog to drain.
+ * @return Frames processed per second of offered traffic.
+ **/
+static double offer(uint32_t duration_ms, uint32_t *delivered) {
+    mock_radio_stats_t before, after;
+    mock_radio_get_stats(&before);
+    atomic_store(&processed, 0);
+    uint64_t start = bench_now_ns();
+    mock_radio_set_traffic(OFFERED_RATE, site_frame, NULL);
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+    mock_radio_set_traffic(0, NULL, NULL);
+    uint32_t done = atomic_load(&processed);
+    double seconds = (double) (bench_now_ns() - start) / 1e9;
+    vTaskDelay(pdMS_TO_TICKS(100));
+    mock_radio_get_stats(&after);
+    *delivered = after.frames_delivered - before.frames_delivered;
+    return done / seconds;
+}
+
+bool bench_pipeline(bool quick) {
+    const uint32_t duration_ms = quick ? 300 : 3000;
+    bool ok = true;
+    uint32_t delivered;
+
+    mock_radio_reset();
+    for (size_t i = 0; i < SITE_APS; i++) {
+        site_aps[i] = (mock_ap_t) { .bssid = { 0x02, 0, 0, 0, 0, (uint8_t) i }, .channel = 6,
+                                    .rssi = (int8_t) (-40 - i), .authmode = WIFI_AUTH_WPA2_PSK };
+        snprintf(site_aps[i].ssid, sizeof(site_aps[i].ssid), "site-%zu", i);
+    }
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    bench_report("pipeline.host_cpus", (double) sysconf(_SC_NPROCESSORS_ONLN), "");
+
+    // Former design: callback -> esp_event_post -> one handler doing everything
+    wifictl_ap_table_clear();
+    wifictl_station_table_clear();
+    atomic_store(&legacy_post_failed, 0);
+    esp_event_handler_register(SNIFFER_EVENTS, ESP_EVENT_ANY_ID, legacy_handler, NULL);
+    wifictl_radio()->set_promiscuous(true, legacy_frame_handler);
+    double legacy = offer(duration_ms, &delivered);
+    wifictl_radio()->set_promiscuous(false, NULL);
+    esp_event_handler_unregister(SNIFFER_EVENTS, ESP_EVENT_ANY_ID, legacy_handler);
+    bench_report("pipeline.event_loop.sustained", legacy, "frames/s");
+    bench_report("pipeline.event_loop.dropped", delivered > 0 ? 100.0 * atomic_load(&legacy_post_failed) / delivered : 0, "%");
+    ok &= bench_check(wifictl_ap_table_count() == SITE_APS, "event loop: every AP parsed");
+
+    // Staged pipeline: parse handlers of the tables, export in the aggregate stage
+    wifictl_ap_table_clear();
+    wifictl_station_table_clear();
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    ok &= bench_check(wifictl_ap_table_track_beacons(true) && wifictl_station_table_track(true)
+                      && wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, export_batch), "handlers");
+    ok &= bench_check(wifictl_sniffer_start(6) == ESP_OK, "sniffer start");
+    double staged = offer(duration_ms, &delivered);
+    wifictl_sniffer_stop();
+    wifictl_sniffer_unregister_batch_handler(export_batch);
+    wifictl_ap_table_track_beacons(false);
+    wifictl_station_table_track(false);
+    wifictl_sniffer_get_stats(&after);
+    bench_report("pipeline.staged.sustained", staged, "frames/s");
+    bench_report("pipeline.staged.dropped", delivered > 0 ? 100.0 * (after.dropped - before.dropped) / delivered : 0, "%");
+    bench_report("pipeline.speedup", legacy > 0 ? staged / legacy : 0, "x");
+    ok &= bench_check(wifictl_ap_table_count() == SITE_APS, "pipeline: every AP parsed");
+    ok &= bench_check(after.captured - before.captured == atomic_load(&processed), "pipeline: every captured frame exported");
+    return ok;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file bench_pool.c
+ * @brief Frame pool against malloc/free for a capture size mix, and the pool and ring together as the
+ *        capture path uses them: allocated in the producer, freed by the consumer.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "bench.h"
+
+#include "frame_pool.h"
+#include "frame_ring.h"
+#include "sniffer.h"
+
+#define IN_FLIGHT 16                                                        // Buffers held at once, like a drained batch
+
+static const uint16_t size_mix[] = { 14, 20, 40, 60, 180, 260, 340, 420, 120, 1500, 1540, 90, 300, 60, 40, 1024 };
+
+#define SIZE_MIX_COUNT (sizeof(size_mix) / sizeof(size_mix[0]))
+
+static double run_alloc_free(uint32_t rounds, void *(*alloc)(size_t), void (*release)(void *)) {
+    void *held[IN_FLIGHT] = { 0 };
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        size_t slot = i % IN_FLIGHT;
+        release(held[slot]);
+        held[slot] = alloc(size_mix[i % SIZE_MIX_COUNT] + sizeof(wifi_promiscuous_pkt_t));
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    for (size_t i = 0; i < IN_FLIGHT; i++) {
+        release(held[i]);
+    }
+    return (double) elapsed / rounds;
+}
+
+static frame_ring_t ring;
+static void *ring_storage[CONFIG_SNIFFER_RING_SIZE];
+static atomic_bool producer_done;
+
+static void *consumer(void *arg) {
+    (void) arg;
+    void *batch[CONFIG_SNIFFER_BATCH_SIZE];
+    for (;;) {
+        size_t n = frame_ring_pop_batch(&ring, batch, CONFIG_SNIFFER_BATCH_SIZE);
+        for (size_t i = 0; i < n; i++) {
+            frame_pool_free(batch[i]);
+        }
+        if (n == 0) {
+            if (atomic_load(&producer_done)) {
+                return NULL;
+            }
+            sched_yield();
+        }
+    }
+}
+
+bool bench_pool(bool quick) {
+    const uint32_t rounds = quick ? 200000 : 10000000;
+    frame_pool_reset_stats();
+    bench_report("pool.alloc_free", run_alloc_free(rounds, frame_pool_alloc, frame_pool_free), "ns/frame");
+    bench_report("pool.malloc_free", run_alloc_free(rounds, malloc, free), "ns/frame");
+
+    frame_pool_stats_t stats;
+    frame_pool_get_stats(&stats);
+    bool ok = true;
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        ok &= bench_check(stats.classes[c].in_use == 0, "every buffer returned");
+    }
+
+    frame_ring_init(&ring, ring_storage, CONFIG_SNIFFER_RING_SIZE);
+    atomic_store(&producer_done, false);
+    frame_pool_reset_stats();
+    pthread_t thread;
+    pthread_create(&thread, NULL, consumer, NULL);
+    uint32_t no_buffer = 0, ring_full = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        void *buf = frame_pool_alloc(size_mix[i % SIZE_MIX_COUNT] + sizeof(wifi_promiscuous_pkt_t));
+        if (buf == NULL) {
+            no_buffer++;
+        } else if (!frame_ring_push(&ring, buf)) {
+            frame_pool_free(buf);
+            ring_full++;
+        }
+        if (i % CONFIG_SNIFFER_BATCH_SIZE == CONFIG_SNIFFER_BATCH_SIZE - 1) {
+            sched_yield();                                                  // Frames arrive in bursts
+        }
+    }
+    atomic_store(&producer_done, true);
+    pthread_join(thread, NULL);
+    double seconds = (double) (bench_now_ns() - start) / 1e9;
+    bench_report("pool.ring.throughput", rounds / seconds, "frames/s");
+    bench_report("pool.ring.no_buffer", 100.0 * no_buffer / rounds, "%");
+    bench_report("pool.ring.ring_full", 100.0 * ring_full / rounds, "%");
+
+    frame_pool_get_stats(&stats);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        static const char *const names[] = { "pool.high_water.small", "pool.high_water.medium", "pool.high_water.large" };
+        bench_report(names[c], stats.classes[c].high_water, "buffers");
+        ok &= bench_check(stats.classes[c].in_use == 0, "every buffer returned by the consumer");
+    }
+    return ok;
+}
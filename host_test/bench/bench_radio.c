@@ -0,0 +1,91 @@
+/**
+ * @file bench_radio.c
+ * @brief Scanner and capture path against the radio mock: scan overhead per channel and callback-to-pipeline
+ *        throughput of the sniffer at increasing offered rates.
+ */
+#include <stdio.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+
+#include "ap_scanner.h"
+#include "ap_table.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sniffer.h"
+
+static mock_ap_t bench_aps[MOCK_RADIO_MAX_APS];
+
+static void make_aps(void) {
+    for (size_t i = 0; i < MOCK_RADIO_MAX_APS; i++) {
+        mock_ap_t *ap = &bench_aps[i];
+        *ap = (mock_ap_t) { .bssid = { 0x02, 0, 0, 0, 0, (uint8_t) i }, .channel = (uint8_t) (1 + i % 13),
+                            .rssi = (int8_t) (-30 - i), .authmode = WIFI_AUTH_WPA2_PSK };
+        snprintf(ap->ssid, sizeof(ap->ssid), "bench-%zu", i);
+    }
+    mock_radio_set_aps(bench_aps, MOCK_RADIO_MAX_APS);
+}
+
+bool bench_radio_scan(bool quick) {
+    const int runs = quick ? 5 : 50;
+    mock_radio_reset();
+    make_aps();
+    mock_radio_set_scan_time(0);                                            // Measure the scanner, not the air
+    wifictl_ap_table_clear();
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < runs; i++) {
+        wifictl_scan_nearby_aps();
+    }
+    double per_channel_us = (double) (bench_now_ns() - start) / 1000.0 / runs / 13;
+    bench_report("radio_scan.overhead_per_channel", per_channel_us, "us");
+
+    mock_radio_stats_t stats;
+    mock_radio_get_stats(&stats);
+    return bench_check(stats.scans_started == (uint32_t) runs * 13, "one request per channel")
+        && bench_check(wifictl_ap_table_count() == MOCK_RADIO_MAX_APS, "every AP in the table");
+}
+
+bool bench_radio_sniffer(bool quick) {
+    static const uint32_t rates[] = { 10000, 50000, 200000 };
+    const uint32_t duration_ms = quick ? 200 : 1000;
+    bool ok = true;
+    mock_radio_reset();
+    make_aps();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        wifictl_sniffer_stats_t before, after;
+        mock_radio_stats_t radio_before, radio;
+        wifictl_sniffer_get_stats(&before);
+        mock_radio_get_stats(&radio_before);
+
+        if (wifictl_sniffer_start(1) != ESP_OK) {
+            return bench_check(false, "sniffer start");
+        }
+        uint64_t start = bench_now_ns();
+        mock_radio_set_traffic(rates[r], NULL, NULL);
+        vTaskDelay(pdMS_TO_TICKS(duration_ms));
+        mock_radio_set_traffic(0, NULL, NULL);
+        double seconds = (double) (bench_now_ns() - start) / 1e9;
+        wifictl_sniffer_stop();
+        vTaskDelay(pdMS_TO_TICKS(50));                                      // Drain the pipeline
+
+        wifictl_sniffer_get_stats(&after);
+        mock_radio_get_stats(&radio);
+        uint32_t delivered = radio.frames_delivered - radio_before.frames_delivered;
+        uint32_t captured = after.captured - before.captured;
+        uint32_t dropped = after.dropped - before.dropped;
+        uint32_t filtered = after.filtered - before.filtered;
+
+        char name[64];
+        snprintf(name, sizeof(name), "radio_sniffer.%lu.delivered", (unsigned long) rates[r]);
+        bench_report(name, delivered / seconds, "frames/s");
+        snprintf(name, sizeof(name), "radio_sniffer.%lu.captured", (unsigned long) rates[r]);
+        bench_report(name, captured / seconds, "frames/s");
+        snprintf(name, sizeof(name), "radio_sniffer.%lu.dropped", (unsigned long) rates[r]);
+        bench_report(name, delivered > 0 ? 100.0 * dropped / delivered : 0, "%");
+        ok &= bench_check(captured + dropped + filtered == delivered, "every delivered frame accounted for");
+    }
+    return ok;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file bench_ring.c
+ * @brief Capture ring against the event-loop path it replaced. The producer copies frames like the
+ *        promiscuous callback and yields after every batch, as frames arrive in bursts; the consumer
+ *        spends a fixed time per frame, so a slow consumer shows up as drops for the ring and as a
+ *        blocked producer for esp_event_post(portMAX_DELAY).
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "esp_event.h"
+#include "frame_ring.h"
+#include "sniffer.h"
+
+#define FRAME_LEN 256
+#define SLOTS CONFIG_SNIFFER_RING_SIZE
+
+ESP_EVENT_DEFINE_BASE(BENCH_RING_EVENTS);
+
+static frame_ring_t ring;
+static void *ring_storage[SLOTS];
+static uint8_t buffers[SLOTS * 2][FRAME_LEN];                               // Ring slots plus the consumer's batch
+static atomic_bool producer_done;
+static atomic_uint consumed;
+static uint32_t work_ns = 0;
+
+static void spin_ns(uint32_t ns) {
+    uint64_t until = bench_now_ns() + ns;
+    while (bench_now_ns() < until) {
+    }
+}
+
+static void consume(const uint8_t *frame) {
+    volatile uint8_t sink = frame[0] ^ frame[FRAME_LEN - 1];
+    (void) sink;
+    if (work_ns > 0) {
+        spin_ns(work_ns);
+    }
+    atomic_fetch_add_explicit(&consumed, 1, memory_order_relaxed);
+}
+
+static void *ring_consumer(void *arg) {
+    (void) arg;
+    void *batch[CONFIG_SNIFFER_BATCH_SIZE];
+    for (;;) {
+        size_t n = frame_ring_pop_batch(&ring, batch, CONFIG_SNIFFER_BATCH_SIZE);
+        if (n == 0) {
+            if (atomic_load(&producer_done)) {
+                return NULL;
+            }
+            sched_yield();
+        }
+        for (size_t i = 0; i < n; i++) {
+            consume(batch[i]);
+        }
+    }
+}
+
+/**
+ * @brief Push and pop cost without contention: batches pushed and drained on one thread.
+ */
+static void run_ring_single(uint32_t frames) {
+    void *batch[CONFIG_SNIFFER_BATCH_SIZE];
+    frame_ring_init(&ring, ring_storage, SLOTS);
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i += CONFIG_SNIFFER_BATCH_SIZE) {
+        for (uint32_t j = 0; j < CONFIG_SNIFFER_BATCH_SIZE; j++) {
+            frame_ring_push(&ring, buffers[j]);
+        }
+        frame_ring_pop_batch(&ring, batch, CONFIG_SNIFFER_BATCH_SIZE);
+    }
+    bench_report("ring.push_pop", (double) (bench_now_ns() - start) / frames, "ns/frame");
+}
+
+/**
+ * @brief Offers `frames` as fast as possible; a push into the full ring drops the frame.
+ * @return Frames dropped.
+ */
+static uint32_t run_ring(const char *label, uint32_t frames) {
+    frame_ring_init(&ring, ring_storage, SLOTS);
+    atomic_store(&producer_done, false);
+    atomic_store(&consumed, 0);
+    pthread_t thread;
+    pthread_create(&thread, NULL, ring_consumer, NULL);
+
+    static uint8_t frame[FRAME_LEN];
+    uint32_t dropped = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        uint8_t *buf = buffers[i % (SLOTS * 2)];                            // Reused round-robin, contents do not matter
+        frame[0] = (uint8_t) i;
+        memcpy(buf, frame, FRAME_LEN);
+        if (!frame_ring_push(&ring, buf)) {
+            dropped++;
+        }
+        if (i % CONFIG_SNIFFER_BATCH_SIZE == CONFIG_SNIFFER_BATCH_SIZE - 1) {
+            sched_yield();
+        }
+    }
+    uint64_t produced_ns = bench_now_ns() - start;
+    atomic_store(&producer_done, true);
+    pthread_join(thread, NULL);
+    uint64_t total_ns = bench_now_ns() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "ring.%s.offered", label);
+    bench_report(name, frames / (produced_ns / 1e9), "frames/s");
+    snprintf(name, sizeof(name), "ring.%s.consumed", label);
+    bench_report(name, atomic_load(&consumed) / (total_ns / 1e9), "frames/s");
+    snprintf(name, sizeof(name), "ring.%s.producer", label);
+    bench_report(name, (double) produced_ns / frames, "ns/frame");
+    snprintf(name, sizeof(name), "ring.%s.dropped", label);
+    bench_report(name, 100.0 * dropped / frames, "%");
+    return dropped;
+}
+
+static void event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    consume(data);
+}
+
+/**
+ * @brief The pre-ring path: every frame copied into the default event loop.
+ */
+static void run_event_loop(const char *label, uint32_t frames, TickType_t wait) {
+    atomic_store(&consumed, 0);
+    static uint8_t frame[FRAME_LEN];
+    uint32_t dropped = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        frame[0] = (uint8_t) i;
+        if (esp_event_post(BENCH_RING_EVENTS, 0, frame, FRAME_LEN, wait) != ESP_OK) {
+            dropped++;
+        }
+    }
+    uint64_t produced_ns = bench_now_ns() - start;
+    while (atomic_load(&consumed) < frames - dropped) {
+        spin_ns(1000);
+    }
+    uint64_t total_ns = bench_now_ns() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "event_loop.%s.consumed", label);
+    bench_report(name, atomic_load(&consumed) / (total_ns / 1e9), "frames/s");
+    snprintf(name, sizeof(name), "event_loop.%s.producer", label);
+    bench_report(name, (double) produced_ns / frames, "ns/frame");
+    snprintf(name, sizeof(name), "event_loop.%s.dropped", label);
+    bench_report(name, 100.0 * dropped / frames, "%");
+}
+
+bool bench_ring(bool quick) {
+    const uint32_t frames = quick ? 200000 : 5000000;
+    const uint32_t slow_frames = quick ? 20000 : 200000;
+
+    run_ring_single(frames);
+    work_ns = 0;
+    uint32_t dropped = run_ring("fast", frames);
+    bool ok = bench_check(atomic_load(&consumed) + dropped == frames, "fast: every frame consumed or dropped");
+    work_ns = 2000;                                                         // Consumer slower than the producer
+    dropped = run_ring("slow", slow_frames);
+    ok &= bench_check(atomic_load(&consumed) + dropped == slow_frames, "slow: every frame consumed or dropped");
+
+    esp_event_handler_register(BENCH_RING_EVENTS, ESP_EVENT_ANY_ID, event_handler, NULL);
+    work_ns = 0;
+    run_event_loop("fast", frames / 10, portMAX_DELAY);
+    work_ns = 2000;
+    run_event_loop("slow", slow_frames, portMAX_DELAY);                     // The old frame_handler: producer blocks
+    run_event_loop("slow_nowait", slow_frames, 0);
+    esp_event_handler_unregister(BENCH_RING_EVENTS, ESP_EVENT_ANY_ID, event_handler);
+    return ok;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file bench_scan_delta.c
+ * @brief Scan deltas over long runs of rounds on a full, stable site: update cost per round with every
+ *        tracker slot in use, and how much of a full listing per round the deltas still report when RSSI
+ *        jitters below the hysteresis and an AP drops out now and then, against no hysteresis at all.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "scan_delta.h"
+
+#define SITE_APS CONFIG_SCAN_DELTA_CAPACITY
+#define JITTER_DB 2                                                         // RSSI within +-2 dB of the AP's mean
+
+typedef struct {
+    uint32_t events;
+    uint32_t rssi_events;                                                   // SCAN_DELTA_CHANGED with SCAN_DELTA_RSSI
+    uint32_t listed;                                                        // APs a full listing would have printed
+    uint32_t untracked;
+    double ns_per_round;
+} site_result_t;
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static site_result_t run_site(uint32_t rounds, uint8_t hysteresis) {
+    static scan_delta_t delta;
+    static scan_delta_ap_t site[SITE_APS], round[SITE_APS];
+    static scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    bool present[SITE_APS];
+    site_result_t result = { 0 };
+    rng_state = 1;
+    scan_delta_init(&delta, hysteresis, 2);
+    for (int i = 0; i < SITE_APS; i++) {
+        site[i] = (scan_delta_ap_t) { .bssid = { 0x02, 0, 0, 0, 0, (uint8_t) i }, .channel = (uint8_t) (1 + i % 13),
+                                      .authmode = 3, .rssi = (int8_t) (-35 - i % 50) };
+        present[i] = true;
+    }
+    uint64_t update_ns = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        if (rng() % 100 == 0) {                                             // An AP drops out or comes back
+            int i = (int) (rng() % SITE_APS);
+            present[i] = !present[i];
+        }
+        size_t count = 0;
+        for (int i = 0; i < SITE_APS; i++) {
+            if (present[i]) {
+                round[count] = site[i];
+                round[count++].rssi += (int8_t) ((int) (rng() % (2 * JITTER_DB + 1)) - JITTER_DB);
+            }
+        }
+        uint64_t start = bench_now_ns();
+        size_t n = scan_delta_update(&delta, round, count, NULL, 0, events, CONFIG_SCAN_DELTA_CAPACITY);
+        update_ns += bench_now_ns() - start;
+        result.events += n;
+        result.listed += count;
+        for (size_t e = 0; e < n; e++) {
+            result.rssi_events += events[e].kind == SCAN_DELTA_CHANGED && (events[e].changed & SCAN_DELTA_RSSI);
+        }
+    }
+    result.untracked = delta.untracked;
+    result.ns_per_round = (double) update_ns / rounds;
+    return result;
+}
+
+bool bench_scan_delta(bool quick) {
+    const uint32_t rounds = quick ? 20000 : 500000;
+    site_result_t damped = run_site(rounds, 6);
+    site_result_t raw = run_site(rounds, 1);
+
+    bench_report("scan_delta.update", damped.ns_per_round / 1000.0, "us/round");
+    bench_report("scan_delta.update_per_ap", damped.ns_per_round * rounds / damped.listed, "ns/AP");
+    bench_report("scan_delta.events_per_round", (double) damped.events / rounds, "events");
+    bench_report("scan_delta.events_per_round_no_hysteresis", (double) raw.events / rounds, "events");
+    bench_report("scan_delta.reported_share", 100.0 * damped.events / damped.listed, "% of listed APs");
+    bench_report("scan_delta.reported_share_no_hysteresis", 100.0 * raw.events / raw.listed, "% of listed APs");
+    bench_report("scan_delta.event_bytes", 100.0 * damped.events * sizeof(scan_delta_event_t) /
+                                               ((double) damped.listed * sizeof(scan_delta_ap_t)), "% of listing bytes");
+
+    bool ok = bench_check(damped.listed == raw.listed && damped.untracked == 0, "same site, every AP tracked");
+    ok &= bench_check(damped.rssi_events == 0, "jitter below the hysteresis never reported");
+    ok &= bench_check(raw.rssi_events > rounds, "jitter reported without hysteresis");
+    ok &= bench_check(damped.events * 100 < damped.listed, "deltas under 1% of a full listing");
+    return ok;
+}
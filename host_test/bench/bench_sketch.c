@@ -0,0 +1,282 @@
+/**
+ * @file bench_sketch.c
+ * @brief Traffic sketches on a synthetic dense-venue trace of millions of frames: update cost per frame for
+ *        the window and through the monitor's fan-out entry point, and the error of the merged windows
+ *        against exact counts: distinct transmitters per channel and clients per BSSID, Count-Min
+ *        overestimates and Space-Saving heavy hitters. The trace is cut into windows merged like the
+ *        monitor closes them; the merge must reproduce the single-window HyperLogLog, Count-Min and BSSID
+ *        slots exactly. The site has more BSSIDs than slots.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "sketch_monitor.h"
+#include "traffic_sketch.h"
+
+#define APS 64
+#define CLIENTS 20000                                                       // Client i associates with AP i % APS
+#define MACS (APS + CLIENTS)                                                // APs first
+#define WINDOWS 10
+#define HLL_SIGMA (1.04 / sqrt(SKETCH_HLL_REGISTERS))
+#define MONITOR_FRAMES 4096                                                 // Prebuilt frames cycled through the monitor
+
+typedef struct {
+    uint16_t client;
+    uint16_t length;
+    bool beacon;                                                            // From the AP, no client
+    bool uplink;                                                            // Sent by the client
+} trace_frame_t;
+
+typedef struct {
+    wifictl_frame_t frame;
+    uint8_t payload[32];                                                    // Header only, sig_len carries the length
+} monitor_frame_t;
+
+static trace_frame_t *trace;
+static uint32_t frame_truth[MACS];
+static uint64_t byte_truth[MACS];
+static uint16_t channels_of[MACS];                                          // Bit per channel the MAC sent on
+static bool client_seen[CLIENTS];
+static double zipf_cdf[CLIENTS];
+static sketch_window_t whole, windows[WINDOWS], merged;
+static monitor_frame_t monitor_frames[MONITOR_FRAMES];
+static uint32_t rng_state = 5;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static void mac_of(uint32_t index, uint8_t mac[6]) {
+    const uint8_t m[6] = { index < APS ? 0x02 : 0x06, 0, 0, (uint8_t) (index >> 16), (uint8_t) (index >> 8), (uint8_t) index };
+    memcpy(mac, m, 6);
+}
+
+static uint32_t index_of(const uint8_t mac[6]) {
+    return (uint32_t) mac[3] << 16 | (uint32_t) mac[4] << 8 | mac[5];
+}
+
+static inline uint32_t ap_of(uint32_t client) {
+    return client % APS;
+}
+
+static inline uint8_t channel_of(uint32_t ap) {
+    return (uint8_t) (1 + ap % 13);
+}
+
+static inline uint32_t transmitter_of(const trace_frame_t *t) {
+    return t->uplink ? APS + t->client : ap_of(t->client);
+}
+
+/**
+ * @brief Beacons take one frame in ten; the rest are data frames between a client drawn with Zipf(1)
+ *        frequencies and its AP, sent by either side.
+ */
+static bool build_trace(uint32_t frames) {
+    trace = malloc(frames * sizeof(*trace));
+    if (trace == NULL) {
+        return false;
+    }
+    double sum = 0;
+    for (int i = 0; i < CLIENTS; i++) {
+        sum += 1.0 / (i + 1);
+        zipf_cdf[i] = sum;
+    }
+    for (uint32_t f = 0; f < frames; f++) {
+        double u = ((double) rng() * (1 << 24) + rng()) / ((double) (1 << 24) * (1 << 24)) * sum;
+        int lo = 0, hi = CLIENTS - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (zipf_cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        trace_frame_t *t = &trace[f];
+        t->client = (uint16_t) ((lo * 7919u) % CLIENTS);                    // Heavy clients spread over the APs
+        t->beacon = rng() % 10 == 0;
+        t->uplink = !t->beacon && rng() % 2;
+        t->length = (uint16_t) (t->beacon ? 200 + rng() % 100 : 60 + rng() % 1440);
+        uint32_t transmitter = transmitter_of(t);
+        frame_truth[transmitter]++;
+        byte_truth[transmitter] += t->length;
+        channels_of[transmitter] |= (uint16_t) (1u << channel_of(ap_of(t->client)));
+        client_seen[t->client] |= !t->beacon;
+    }
+    return true;
+}
+
+static void add(sketch_window_t *window, const trace_frame_t *t) {
+    uint8_t bssid[6], client[6];
+    uint32_t ap = ap_of(t->client);
+    mac_of(ap, bssid);
+    mac_of(APS + t->client, client);
+    sketch_window_add(window, channel_of(ap), t->uplink ? client : bssid, bssid, t->beacon ? NULL : client, t->length);
+}
+
+/**
+ * @brief Builds the 802.11 header of a trace frame as the sniffer hands it to the fan-out consumers.
+ */
+static void build_monitor_frame(monitor_frame_t *m, const trace_frame_t *t) {
+    uint8_t *h = m->payload, bssid[6], client[6];
+    static const uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    mac_of(ap_of(t->client), bssid);
+    mac_of(APS + t->client, client);
+    memset(h, 0, 24);
+    h[0] = t->beacon ? 0x80 : 0x08;
+    h[1] = t->beacon ? 0x00 : t->uplink ? 0x01 : 0x02;                       // ToDS or FromDS
+    memcpy(&h[4], t->beacon ? broadcast : t->uplink ? bssid : client, 6);
+    memcpy(&h[10], t->uplink ? client : bssid, 6);
+    memcpy(&h[16], bssid, 6);
+    m->frame.event_id = t->beacon ? SNIFFER_EVENT_CAPTURED_MGMT : SNIFFER_EVENT_CAPTURED_DATA;
+    m->frame.pkt.rx_ctrl.channel = channel_of(ap_of(t->client));
+    m->frame.pkt.rx_ctrl.sig_len = t->length + 4;                           // With FCS
+}
+
+/**
+ * @brief Checks Space-Saving bounds of `topk` against exact counts and reports the recall of the true top ten.
+ */
+static bool check_talkers(const char *name, const sketch_topk_t *topk, const uint64_t *truth, uint64_t total,
+                          double heavy) {
+    sketch_talker_t sorted[CONFIG_SKETCH_TOPK];
+    size_t size = sketch_topk_sorted(topk, sorted, CONFIG_SKETCH_TOPK);
+    bool listed[MACS] = { false };
+    uint32_t bound_errors = 0;
+    uint64_t max_error = 0;
+    for (size_t i = 0; i < size; i++) {
+        uint32_t index = index_of(sorted[i].mac);
+        listed[index] = true;
+        bound_errors += sorted[i].count < truth[index] || sorted[i].count - sorted[i].error > truth[index];
+        max_error = sorted[i].error > max_error ? sorted[i].error : max_error;
+    }
+    uint32_t missing = 0, found = 0;
+    for (uint32_t m = 0; m < MACS; m++) {
+        missing += truth[m] > heavy * total && !listed[m];
+        uint32_t larger = 0;                                                // Rank among the true counts
+        for (uint32_t other = 0; other < MACS && larger < 10; other++) {
+            larger += truth[other] > truth[m];
+        }
+        found += larger < 10 && listed[m];
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "sketch.%s_top10_recall", name);
+    bench_report(line, found * 10.0, "%");
+    snprintf(line, sizeof(line), "sketch.%s_error_max", name);
+    bench_report(line, 100.0 * max_error / total, "% of total");
+    bool ok = bench_check(size == CONFIG_SKETCH_TOPK && bound_errors == 0, "talker counts bound the true counts");
+    ok &= bench_check(missing == 0, "every heavy hitter listed");
+    return ok;
+}
+
+bool bench_sketch(bool quick) {
+    const uint32_t frames = quick ? 500000 : 4000000;
+    bool ok = bench_check(build_trace(frames), "trace");
+
+    sketch_window_init(&whole);
+    uint64_t start = bench_now_ns();
+    for (uint32_t f = 0; f < frames; f++) {
+        add(&whole, &trace[f]);
+    }
+    bench_report("sketch.window_add", (double) (bench_now_ns() - start) / frames, "ns/frame");
+    bench_report("sketch.window_bytes", sizeof(sketch_window_t), "bytes");
+
+    sketch_window_init(&merged);
+    uint64_t merge_ns = 0;
+    for (int w = 0; w < WINDOWS; w++) {
+        sketch_window_init(&windows[w]);
+        sketch_window_carry_bssids(&windows[w], &merged);                   // As the monitor prepares its spare
+        for (uint32_t f = w * (frames / WINDOWS); f < (w + 1) * (frames / WINDOWS); f++) {
+            add(&windows[w], &trace[f]);
+        }
+        start = bench_now_ns();
+        sketch_window_merge(&merged, &windows[w]);
+        merge_ns += bench_now_ns() - start;
+    }
+    bench_report("sketch.window_merge", merge_ns / 1000.0 / WINDOWS, "us");
+    ok &= bench_check(merged.frames == frames && whole.frames == frames, "every frame counted");
+    ok &= bench_check(memcmp(merged.channels, whole.channels, sizeof(whole.channels)) == 0,
+                      "merged distinct counts equal one window's");
+    ok &= bench_check(memcmp(merged.counts, whole.counts, sizeof(whole.counts)) == 0, "merged Count-Min equals one window's");
+    ok &= bench_check(memcmp(merged.bssids, whole.bssids, sizeof(whole.bssids)) == 0
+                      && merged.bssid_overflow == whole.bssid_overflow, "merged BSSID slots equal one window's");
+
+    double error_sum = 0, error_max = 0;                                    // Distinct transmitters per channel
+    for (int c = 1; c <= 13; c++) {
+        uint32_t truth = 0;
+        for (uint32_t m = 0; m < MACS; m++) {
+            truth += (channels_of[m] >> c) & 1;
+        }
+        double error = fabs((double) sketch_hll_estimate(&merged.channels[c - 1]) - truth) / truth;
+        error_sum += error;
+        error_max = error > error_max ? error : error_max;
+    }
+    bench_report("sketch.channel_distinct_error_mean", 100 * error_sum / 13, "%");
+    bench_report("sketch.channel_distinct_error_max", 100 * error_max, "%");
+    ok &= bench_check(error_sum / 13 < 2 * HLL_SIGMA && error_max < 4 * HLL_SIGMA, "channel counts within HLL error");
+
+    error_sum = error_max = 0;                                              // Clients per tracked BSSID
+    int tracked = 0;
+    for (; tracked < CONFIG_SKETCH_BSSIDS && merged.bssids[tracked].used; tracked++) {
+        uint32_t ap = index_of(merged.bssids[tracked].bssid), truth = 0;
+        for (uint32_t c = ap; c < CLIENTS; c += APS) {
+            truth += client_seen[c];
+        }
+        double error = fabs((double) sketch_hll_estimate(&merged.bssids[tracked].clients) - truth) / truth;
+        error_sum += error;
+        error_max = error > error_max ? error : error_max;
+    }
+    bench_report("sketch.bssid_clients_error_mean", 100 * error_sum / tracked, "%");
+    bench_report("sketch.bssid_clients_error_max", 100 * error_max, "%");
+    ok &= bench_check(tracked == CONFIG_SKETCH_BSSIDS && merged.bssid_overflow > 0, "BSSID slots full, rest counted");
+    ok &= bench_check(error_sum / tracked < 2 * HLL_SIGMA && error_max < 4 * HLL_SIGMA, "client counts within HLL error");
+
+    const double cms_bound = M_E / CONFIG_SKETCH_CMS_WIDTH * frames;        // Count-Min frames per MAC
+    double over_sum = 0;
+    uint32_t under = 0, beyond = 0;
+    for (uint32_t m = 0; m < MACS; m++) {
+        uint8_t mac[6];
+        mac_of(m, mac);
+        uint32_t estimate = sketch_cms_estimate(&merged.counts[SKETCH_FRAMES], sketch_hash_mac(mac));
+        under += estimate < frame_truth[m];
+        over_sum += estimate - frame_truth[m];
+        beyond += estimate - frame_truth[m] > cms_bound;
+    }
+    bench_report("sketch.cms_overestimate_mean", 100 * over_sum / MACS / frames, "% of total");
+    bench_report("sketch.cms_beyond_bound", 100.0 * beyond / MACS, "% of MACs");
+    ok &= bench_check(under == 0, "Count-Min never underestimates");
+    ok &= bench_check(beyond <= MACS * exp(-CONFIG_SKETCH_CMS_DEPTH), "Count-Min within e/w of total");
+
+    static uint64_t frames_truth64[MACS];
+    for (uint32_t m = 0; m < MACS; m++) {
+        frames_truth64[m] = frame_truth[m];
+    }
+    uint64_t bytes_total = 0;
+    for (uint32_t m = 0; m < MACS; m++) {
+        bytes_total += byte_truth[m];
+    }
+    ok &= check_talkers("talkers_frames", &whole.talkers[SKETCH_FRAMES], frames_truth64, frames, 1.0 / CONFIG_SKETCH_TOPK);
+    ok &= check_talkers("talkers_merged", &merged.talkers[SKETCH_FRAMES], frames_truth64, frames, 2.0 / CONFIG_SKETCH_TOPK);
+    ok &= check_talkers("talkers_bytes", &merged.talkers[SKETCH_BYTES], byte_truth, bytes_total, 2.0 / CONFIG_SKETCH_TOPK);
+
+    for (uint32_t i = 0; i < MONITOR_FRAMES; i++) {                         // Fan-out consumer path: parse, clock, spinlock
+        build_monitor_frame(&monitor_frames[i], &trace[i]);
+    }
+    ok &= bench_check(wifictl_sketch_start() == ESP_OK, "monitor started");
+    start = bench_now_ns();
+    for (uint32_t f = 0; f < frames; f++) {
+        wifictl_sketch_add_frame(&monitor_frames[f % MONITOR_FRAMES].frame);
+    }
+    bench_report("sketch.monitor_add", (double) (bench_now_ns() - start) / frames, "ns/frame");
+    wifictl_sketch_stop();
+    wifictl_sketch_stats_t stats;
+    wifictl_sketch_get_stats(&stats);
+    ok &= bench_check(stats.frames == frames, "monitor counted every frame");
+
+    free(trace);
+    return ok;
+}
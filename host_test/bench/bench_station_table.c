@@ -0,0 +1,60 @@
+/**
+ * @file bench_station_table.c
+ * @brief Station inventory update cost per frame on synthetic multi-AP traces, within capacity and
+ *        crowded enough that every few frames evict the least recently seen client.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#include "station_table.h"
+
+#define TRACE_FRAMES 4096
+
+static uint8_t trace[TRACE_FRAMES][32];                                     // Headers only, lengths carry the size
+static uint16_t trace_len[TRACE_FRAMES];
+
+static void build_trace(uint32_t aps, uint32_t clients) {
+    uint32_t state = clients;
+    for (size_t i = 0; i < TRACE_FRAMES; i++) {
+        state = state * 1664525 + 1013904223;
+        uint32_t c = (state >> 8) % clients;
+        uint8_t *f = trace[i];
+        uint8_t ap[6] = { 0x02, 0, 0, 0, 0, (uint8_t) (c % aps) };
+        uint8_t client[6] = { 0x06, 0, 0, (uint8_t) (c >> 16), (uint8_t) (c >> 8), (uint8_t) c };
+        memset(f, 0, sizeof(trace[i]));
+        f[0] = 0x88;                                                        // QoS data
+        f[1] = state & 1 ? 0x01 : 0x02;
+        memcpy(&f[4], state & 1 ? ap : client, 6);
+        memcpy(&f[10], state & 1 ? client : ap, 6);
+        memcpy(&f[16], ap, 6);
+        trace_len[i] = (uint16_t) (26 + (state >> 20) % 1500);
+    }
+}
+
+static bool run(const char *label, uint32_t aps, uint32_t clients, uint32_t frames) {
+    build_trace(aps, clients);
+    wifictl_station_table_clear();
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        wifictl_station_table_update(trace[i % TRACE_FRAMES], trace_len[i % TRACE_FRAMES], -60, 6, i);
+    }
+    double ns = (double) (bench_now_ns() - start) / frames;
+
+    wifictl_station_table_stats_t stats;
+    wifictl_station_table_get_stats(&stats);
+    char name[64];
+    snprintf(name, sizeof(name), "station_table.%s.update", label);
+    bench_report(name, ns, "ns/frame");
+    snprintf(name, sizeof(name), "station_table.%s.evictions", label);
+    bench_report(name, 100.0 * stats.evictions / frames, "%");
+    return bench_check(stats.updates == frames, "every frame attributed");
+}
+
+bool bench_station_table(bool quick) {
+    const uint32_t frames = quick ? 200000 : 10000000;
+    bool ok = run("fits", 16, CONFIG_STATION_TABLE_CAPACITY / 2, frames);
+    ok &= run("crowded", 64, CONFIG_STATION_TABLE_CAPACITY * 4, frames);
+    return ok;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file host_bench.c
+ * @brief Benchmark runner: host_bench [name-filter] [--quick]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "mock_radio.h"
+#include "wifi_controller.h"
+
+typedef struct {
+    const char *name;
+    bench_fn_t run;
+} bench_entry_t;
+
+static const bench_entry_t benches[] = {
+    { "ring", bench_ring },
+    { "pool", bench_pool },
+    { "parser", bench_parser },
+    { "hop", bench_hop },
+    { "ap_table", bench_ap_table },
+    { "station_table", bench_station_table },
+    { "capture_filter", bench_capture_filter },
+    { "command_line", bench_command_line },
+    { "pipeline", bench_pipeline },
+    { "capture_log", bench_capture_log },
+    { "lifecycle", bench_lifecycle },
+    { "pcap_compact", bench_pcap_compact },
+    { "airtime", bench_airtime },
+    { "deferred_log", bench_deferred_log },
+    { "pcap_replay", bench_pcap_replay },
+    { "fanout", bench_fanout },
+    { "sketch", bench_sketch },
+    { "scan_delta", bench_scan_delta },
+    { "radio_scan", bench_radio_scan },
+    { "radio_sniffer", bench_radio_sniffer },
+};
+
+void bench_report(const char *name, double value, const char *unit) {
+    printf("%-40s %14.3f %s\n", name, value, unit);
+    fflush(stdout);
+}
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+bool bench_check(bool ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "check failed: %s\n", what);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    bool quick = false;
+    const char *filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    mock_radio_install();
+    if (wifictl_init() != ESP_OK) {
+        fprintf(stderr, "wifictl_init failed\n");
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (filter != NULL && strstr(benches[i].name, filter) == NULL) {
+            continue;
+        }
+        if (!benches[i].run(quick)) {
+            fprintf(stderr, "FAIL %s\n", benches[i].name);
+            failed++;
+        }
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file host_test.h
+ * @brief Minimal assertions for the host tests. A failed CHECK reports and continues, the test's
+ *        exit status is the number of failures.
+ */
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+        long long a_ = (long long) (actual), e_ = (long long) (expected); \
+        if (a_ != e_) { \
+            fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+            host_test_failures++; \
+        } \
+    } while (0)
+
+#define RUN_TEST(fn) do { \
+        int before_ = host_test_failures; \
+        fn(); \
+        fprintf(stderr, "%s %s\n", host_test_failures == before_ ? "PASS" : "FAIL", #fn); \
+    } while (0)
+
+#define TEST_RESULT() (host_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+/**
+ * @brief Polls `cond` every millisecond for up to `timeout_ms`.
+ * @return true if it became true in time.
+ **/
+#define WAIT_FOR(cond, timeout_ms) ({ \
+        int64_t until_ = esp_timer_get_time() + (int64_t) (timeout_ms) * 1000; \
+        while (!(cond) && esp_timer_get_time() < until_) { \
+            vTaskDelay(1); \
+        } \
+        (bool) (cond); \
+    })
+
+#endif // HOST_TEST_H
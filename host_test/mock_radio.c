@@ -0,0 +1,439 @@
+/**
+ * @file mock_radio.c
+ * @brief Implements the radio mock: scan completion and frame generation on one "air" thread.
+ */
+#include "mock_radio.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "radio.h"
+
+#define MAX_BURST 64                                                        // Frames per wake-up at high rates
+#define IDLE_WAIT_US 1000
+
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mock_changed = PTHREAD_COND_INITIALIZER;
+static pthread_t air_thread;
+static bool air_started = false;
+
+static mock_ap_t aps[MOCK_RADIO_MAX_APS];
+static size_t ap_count = 0;
+static uint32_t scan_time_us = 1000;
+static bool scan_pending = false;
+static int64_t scan_due_us = 0;
+static uint8_t scan_channel = 0;                                            // 0 scans all channels
+static bool results_ready = false;
+static uint8_t results_channel = 0;
+
+static uint8_t channel = 1;
+static bool promiscuous = false;
+static wifi_promiscuous_cb_t rx_callback = NULL;
+static uint32_t filter_mask = WIFI_PROMIS_FILTER_MASK_ALL;
+
+static uint32_t traffic_fps = 0;
+static mock_frame_generator_t traffic_generator = NULL;
+static void *traffic_ctx = NULL;
+static int64_t traffic_start_us = 0;
+static uint64_t traffic_sent = 0;
+static uint32_t generated_seq = 0;
+
+static mock_radio_stats_t stats;
+
+static uint32_t type_mask(wifi_promiscuous_pkt_type_t type) {
+    switch (type) {
+        case WIFI_PKT_MGMT :return WIFI_PROMIS_FILTER_MASK_MGMT;
+        case WIFI_PKT_CTRL :return WIFI_PROMIS_FILTER_MASK_CTRL;
+        case WIFI_PKT_DATA :return WIFI_PROMIS_FILTER_MASK_DATA;
+        default            :return WIFI_PROMIS_FILTER_MASK_MISC;
+    }
+}
+
+static void post_scan_done(uint32_t status) {
+    wifi_event_sta_scan_done_t done = { .status = status };
+    pthread_mutex_lock(&mock_lock);
+    stats.scan_done_posted++;
+    pthread_mutex_unlock(&mock_lock);
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &done, sizeof(done), portMAX_DELAY);
+}
+
+/**
+ * @brief Delivers a frame to the callback. Called without mock_lock: the sniffer may call back into the radio.
+ */
+static bool deliver(wifi_promiscuous_cb_t callback, uint8_t on_channel, const uint8_t *frame, size_t len,
+                    wifi_promiscuous_pkt_type_t type, int8_t rssi, uint32_t timestamp_us) {
+    static _Thread_local union {
+        wifi_promiscuous_pkt_t pkt;
+        uint8_t bytes[sizeof(wifi_promiscuous_pkt_t) + MOCK_RADIO_MAX_FRAME + 4];
+    } buffer;
+    if (callback == NULL || len + 4 > MOCK_RADIO_MAX_FRAME) {
+        return false;
+    }
+    memset(&buffer.pkt.rx_ctrl, 0, sizeof(buffer.pkt.rx_ctrl));
+    buffer.pkt.rx_ctrl.rssi = rssi;
+    buffer.pkt.rx_ctrl.rate = 11;                                           // 6 Mbit/s OFDM
+    buffer.pkt.rx_ctrl.channel = on_channel;
+    buffer.pkt.rx_ctrl.sig_len = len + 4;                                   // Driver length includes the FCS
+    buffer.pkt.rx_ctrl.noise_floor = -95;
+    buffer.pkt.rx_ctrl.timestamp = timestamp_us;
+    memcpy(buffer.pkt.payload, frame, len);
+    memset(buffer.pkt.payload + len, 0, 4);
+    callback(&buffer.pkt, type);
+    return true;
+}
+
+static size_t beacon_generator(void *ctx, uint8_t on_channel, uint32_t seq, uint8_t *frame, size_t max,
+                               wifi_promiscuous_pkt_type_t *type, int8_t *rssi) {
+    (void) ctx;
+    const mock_ap_t *matching[MOCK_RADIO_MAX_APS];
+    size_t count = 0;
+    pthread_mutex_lock(&mock_lock);
+    for (size_t i = 0; i < ap_count; i++) {
+        if (aps[i].channel == on_channel) {
+            matching[count++] = &aps[i];
+        }
+    }
+    mock_ap_t ap;
+    if (count > 0) {
+        ap = *matching[seq % count];
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (count == 0) {
+        return 0;
+    }
+    *type = WIFI_PKT_MGMT;
+    *rssi = ap.rssi;
+    return mock_build_beacon(&ap, (uint16_t) (seq / count), frame, max);
+}
+
+/**
+ * @brief Scan completion and traffic. Sleeps until the next due event; frames owed at the configured rate
+ *        are delivered in bursts, so the rate holds without a timer per frame.
+ */
+static void *air_main(void *arg) {
+    (void) arg;
+    static uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    pthread_mutex_lock(&mock_lock);
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (scan_pending && now >= scan_due_us) {
+            scan_pending = false;
+            results_ready = true;
+            results_channel = scan_channel;
+            pthread_mutex_unlock(&mock_lock);
+            post_scan_done(0);
+            pthread_mutex_lock(&mock_lock);
+            continue;
+        }
+
+        uint64_t owed = 0;
+        if (promiscuous && traffic_fps > 0) {
+            uint64_t due = (uint64_t) (now - traffic_start_us) * traffic_fps / 1000000;
+            owed = due > traffic_sent ? due - traffic_sent : 0;
+        }
+        if (owed > 0) {
+            size_t burst = owed < MAX_BURST ? (size_t) owed : MAX_BURST;
+            mock_frame_generator_t generator = traffic_generator != NULL ? traffic_generator : beacon_generator;
+            void *ctx = traffic_ctx;
+            wifi_promiscuous_cb_t callback = rx_callback;
+            uint8_t on_channel = channel;
+            traffic_sent += burst;
+            pthread_mutex_unlock(&mock_lock);
+            for (size_t i = 0; i < burst; i++) {
+                wifi_promiscuous_pkt_type_t type = WIFI_PKT_MGMT;
+                int8_t rssi = -60;
+                size_t len = generator(ctx, on_channel, generated_seq++, frame, sizeof(frame) - 4, &type, &rssi);
+                if (len == 0) {
+                    continue;
+                }
+                bool masked = (filter_mask & type_mask(type)) == 0;
+                if (!masked) {
+                    deliver(callback, on_channel, frame, len, type, rssi, (uint32_t) esp_timer_get_time());
+                }
+                pthread_mutex_lock(&mock_lock);
+                masked ? stats.frames_masked++ : stats.frames_delivered++;
+                pthread_mutex_unlock(&mock_lock);
+            }
+            pthread_mutex_lock(&mock_lock);
+            continue;
+        }
+
+        int64_t wait_us = IDLE_WAIT_US;
+        if (scan_pending && scan_due_us - now < wait_us) {
+            wait_us = scan_due_us - now;
+        }
+        if (!scan_pending && !(promiscuous && traffic_fps > 0)) {
+            wait_us = 100000;                                               // Nothing scheduled, woken by changes
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        int64_t ns = deadline.tv_nsec + wait_us * 1000;
+        deadline.tv_sec += ns / 1000000000;
+        deadline.tv_nsec = ns % 1000000000;
+        pthread_cond_timedwait(&mock_changed, &mock_lock, &deadline);
+    }
+    return NULL;
+}
+
+static esp_err_t mock_scan_start(const wifi_scan_config_t *config) {
+    pthread_mutex_lock(&mock_lock);
+    if (scan_pending) {
+        stats.scans_refused++;
+        pthread_mutex_unlock(&mock_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    scan_pending = true;
+    scan_channel = config != NULL ? config->channel : 0;
+    scan_due_us = esp_timer_get_time() + scan_time_us * (scan_channel == 0 ? 13 : 1);
+    results_ready = false;
+    stats.scans_started++;
+    pthread_cond_signal(&mock_changed);
+    pthread_mutex_unlock(&mock_lock);
+    return ESP_OK;
+}
+
+static esp_err_t mock_scan_stop(void) {
+    pthread_mutex_lock(&mock_lock);
+    bool was_pending = scan_pending;
+    scan_pending = false;
+    if (was_pending) {
+        stats.scans_stopped++;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (was_pending) {
+        post_scan_done(1);                                                  // The driver reports a stopped scan as done
+    }
+    return ESP_OK;
+}
+
+static esp_err_t mock_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records) {
+    uint16_t found = 0;
+    pthread_mutex_lock(&mock_lock);
+    for (size_t i = 0; results_ready && i < ap_count && found < *number; i++) {
+        if (results_channel != 0 && aps[i].channel != results_channel) {
+            continue;
+        }
+        wifi_ap_record_t *r = &records[found++];
+        memset(r, 0, sizeof(*r));
+        memcpy(r->bssid, aps[i].bssid, 6);
+        memcpy(r->ssid, aps[i].ssid, sizeof(r->ssid));
+        r->primary = aps[i].channel;
+        r->rssi = aps[i].rssi;
+        r->authmode = aps[i].authmode;
+        r->phy_11g = 1;
+        r->phy_11n = 1;
+    }
+    results_ready = false;                                                  // The driver frees its list on read
+    pthread_mutex_unlock(&mock_lock);
+    *number = found;
+    return ESP_OK;
+}
+
+static esp_err_t mock_clear_ap_list(void) {
+    pthread_mutex_lock(&mock_lock);
+    results_ready = false;
+    pthread_mutex_unlock(&mock_lock);
+    return ESP_OK;
+}
+
+static esp_err_t mock_set_channel(uint8_t new_channel) {
+    if (new_channel < 1 || new_channel > 14) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&mock_lock);
+    channel = new_channel;
+    stats.channel_switches++;
+    pthread_mutex_unlock(&mock_lock);
+    return ESP_OK;
+}
+
+static esp_err_t mock_set_promiscuous(bool enable, wifi_promiscuous_cb_t callback) {
+    pthread_mutex_lock(&mock_lock);
+    promiscuous = enable;
+    if (enable) {
+        rx_callback = callback;
+        traffic_start_us = esp_timer_get_time();
+        traffic_sent = 0;
+    }
+    pthread_cond_signal(&mock_changed);
+    pthread_mutex_unlock(&mock_lock);
+    return ESP_OK;
+}
+
+static esp_err_t mock_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+    pthread_mutex_lock(&mock_lock);
+    filter_mask = filter != NULL ? filter->filter_mask : WIFI_PROMIS_FILTER_MASK_ALL;
+    pthread_mutex_unlock(&mock_lock);
+    return ESP_OK;
+}
+
+static const wifictl_radio_ops_t mock_ops = {
+    .scan_start = mock_scan_start,
+    .scan_stop = mock_scan_stop,
+    .scan_get_ap_records = mock_scan_get_ap_records,
+    .clear_ap_list = mock_clear_ap_list,
+    .set_channel = mock_set_channel,
+    .set_promiscuous = mock_set_promiscuous,
+    .set_promiscuous_filter = mock_set_promiscuous_filter,
+};
+
+void mock_radio_install(void) {
+    mock_radio_reset();
+    pthread_mutex_lock(&mock_lock);
+    if (!air_started) {
+        air_started = pthread_create(&air_thread, NULL, air_main, NULL) == 0;
+        pthread_detach(air_thread);
+    }
+    pthread_mutex_unlock(&mock_lock);
+    wifictl_radio_set_ops(&mock_ops);
+}
+
+void mock_radio_reset(void) {
+    pthread_mutex_lock(&mock_lock);
+    ap_count = 0;
+    scan_time_us = 1000;
+    scan_pending = false;
+    results_ready = false;
+    traffic_fps = 0;
+    traffic_generator = NULL;
+    traffic_ctx = NULL;
+    filter_mask = WIFI_PROMIS_FILTER_MASK_ALL;
+    memset(&stats, 0, sizeof(stats));
+    pthread_cond_signal(&mock_changed);
+    pthread_mutex_unlock(&mock_lock);
+}
+
+void mock_radio_set_aps(const mock_ap_t *list, size_t count) {
+    pthread_mutex_lock(&mock_lock);
+    ap_count = count < MOCK_RADIO_MAX_APS ? count : MOCK_RADIO_MAX_APS;
+    memcpy(aps, list, ap_count * sizeof(aps[0]));
+    pthread_mutex_unlock(&mock_lock);
+}
+
+void mock_radio_set_scan_time(uint32_t us) {
+    pthread_mutex_lock(&mock_lock);
+    scan_time_us = us;
+    pthread_mutex_unlock(&mock_lock);
+}
+
+void mock_radio_set_traffic(uint32_t frames_per_s, mock_frame_generator_t generator, void *ctx) {
+    pthread_mutex_lock(&mock_lock);
+    traffic_fps = frames_per_s;
+    traffic_generator = generator;
+    traffic_ctx = ctx;
+    traffic_start_us = esp_timer_get_time();
+    traffic_sent = 0;
+    pthread_cond_signal(&mock_changed);
+    pthread_mutex_unlock(&mock_lock);
+}
+
+bool mock_radio_deliver(const uint8_t *frame, size_t len, wifi_promiscuous_pkt_type_t type, int8_t rssi) {
+    return mock_radio_deliver_at(frame, len, type, rssi, (uint32_t) esp_timer_get_time());
+}
+
+bool mock_radio_deliver_at(const uint8_t *frame, size_t len, wifi_promiscuous_pkt_type_t type, int8_t rssi,
+                           uint32_t timestamp_us) {
+    pthread_mutex_lock(&mock_lock);
+    wifi_promiscuous_cb_t callback = promiscuous ? rx_callback : NULL;
+    uint8_t on_channel = channel;
+    bool masked = (filter_mask & type_mask(type)) == 0;
+    if (callback != NULL) {
+        masked ? stats.frames_masked++ : stats.frames_delivered++;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return !masked && deliver(callback, on_channel, frame, len, type, rssi, timestamp_us);
+}
+
+void mock_radio_get_stats(mock_radio_stats_t *out) {
+    pthread_mutex_lock(&mock_lock);
+    *out = stats;
+    out->channel = channel;
+    out->promiscuous = promiscuous;
+    pthread_mutex_unlock(&mock_lock);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Frame builders
+
+static size_t put(uint8_t *frame, size_t at, size_t max, const void *data, size_t len) {
+    if (at == 0 || at + len > max) {
+        return 0;                                                           // Sticky failure
+    }
+    memcpy(&frame[at], data, len);
+    return at + len;
+}
+
+static size_t put_ie(uint8_t *frame, size_t at, size_t max, uint8_t id, const void *body, uint8_t len) {
+    uint8_t header[2] = { id, len };
+    return put(frame, put(frame, at, max, header, 2), max, body, len);
+}
+
+size_t mock_build_beacon(const mock_ap_t *ap, uint16_t seq, uint8_t *frame, size_t max) {
+    static const uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    static const uint8_t rates[] = { 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24 };
+    if (max < 36) {
+        return 0;
+    }
+    memset(frame, 0, 36);
+    frame[0] = 0x80;                                                        // Beacon
+    memcpy(&frame[4], broadcast, 6);
+    memcpy(&frame[10], ap->bssid, 6);
+    memcpy(&frame[16], ap->bssid, 6);
+    frame[22] = (uint8_t) (seq << 4);
+    frame[23] = (uint8_t) (seq >> 4);
+    frame[32] = 0x64;                                                       // Beacon interval 100 TU
+    uint16_t capability = 0x0001 | (ap->authmode != WIFI_AUTH_OPEN ? 0x0010 : 0);
+    frame[34] = (uint8_t) capability;
+    frame[35] = (uint8_t) (capability >> 8);
+
+    size_t at = 36;
+    at = put_ie(frame, at, max, 0, ap->ssid, (uint8_t) strnlen(ap->ssid, 32));
+    at = put_ie(frame, at, max, 1, rates, sizeof(rates));
+    at = put_ie(frame, at, max, 3, &ap->channel, 1);
+
+    uint8_t akm = 0;
+    bool wpa = ap->authmode == WIFI_AUTH_WPA_PSK || ap->authmode == WIFI_AUTH_WPA_WPA2_PSK;
+    switch (ap->authmode) {
+        case WIFI_AUTH_WPA2_PSK      :
+        case WIFI_AUTH_WPA_WPA2_PSK  :akm = 2; break;
+        case WIFI_AUTH_WPA3_PSK      :akm = 8; break;
+        case WIFI_AUTH_ENTERPRISE    :akm = 1; break;
+        case WIFI_AUTH_WPA2_WPA3_PSK :akm = 2; break;
+        default                      :break;
+    }
+    if (akm != 0) {
+        uint8_t rsn[26] = { 1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, akm };
+        uint8_t len = 20;
+        if (ap->authmode == WIFI_AUTH_WPA2_WPA3_PSK) {                      // Second AKM suite, SAE
+            rsn[12] = 2;
+            rsn[18] = 0x00; rsn[19] = 0x0f; rsn[20] = 0xac; rsn[21] = 8;
+            len = 24;
+        }
+        at = put_ie(frame, at, max, 48, rsn, len);                          // Capabilities stay 0
+    }
+    if (wpa) {
+        static const uint8_t wpa_ie[] = { 0x00, 0x50, 0xf2, 1, 1, 0, 0x00, 0x50, 0xf2, 2, 1, 0, 0x00, 0x50, 0xf2, 2,
+                                          1, 0, 0x00, 0x50, 0xf2, 2 };
+        at = put_ie(frame, at, max, 221, wpa_ie, sizeof(wpa_ie));
+    }
+    return at;
+}
+
+size_t mock_build_data(const uint8_t bssid[6], const uint8_t station[6], uint16_t seq, size_t payload_len,
+                       uint8_t *frame, size_t max) {
+    if (24 + payload_len > max) {
+        return 0;
+    }
+    memset(frame, 0, 24 + payload_len);
+    frame[0] = 0x08;                                                        // Data
+    frame[1] = 0x01;                                                        // ToDS
+    memcpy(&frame[4], bssid, 6);
+    memcpy(&frame[10], station, 6);
+    memcpy(&frame[16], bssid, 6);
+    frame[22] = (uint8_t) (seq << 4);
+    frame[23] = (uint8_t) (seq >> 4);
+    return 24 + payload_len;
+}
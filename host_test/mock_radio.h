@@ -0,0 +1,125 @@
+/**
+ * @file mock_radio.h
+ * @brief Radio mock for the host build, installed through wifictl_radio_set_ops.
+ *
+ * Scans complete after a configurable time per channel with the configured APs of that channel and
+ * post WIFI_EVENT_SCAN_DONE to the default event loop, also when stopped, like the driver. While
+ * promiscuous mode is on, a generator thread delivers synthetic frames to the sniffer's callback at
+ * a controlled rate; tests can also deliver single frames synchronously.
+ */
+#ifndef MOCK_RADIO_H
+#define MOCK_RADIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_wifi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOCK_RADIO_MAX_APS 64
+#define MOCK_RADIO_MAX_FRAME 1600
+
+typedef struct {
+    uint8_t bssid[6];
+    char ssid[33];
+    uint8_t channel;
+    int8_t rssi;
+    wifi_auth_mode_t authmode;
+} mock_ap_t;
+
+typedef struct {
+    uint32_t scans_started;
+    uint32_t scans_stopped;                                                 // Stops of a running scan
+    uint32_t scans_refused;                                                 // Requests made while one was pending
+    uint32_t scan_done_posted;
+    uint32_t channel_switches;
+    uint32_t frames_delivered;
+    uint32_t frames_masked;                                                 // Rejected by the promiscuous filter
+    uint8_t channel;
+    bool promiscuous;
+} mock_radio_stats_t;
+
+/**
+ * @brief Builds one frame for the generator thread.
+ * @param ctx Context given to mock_radio_set_traffic.
+ * @param channel Channel the radio is tuned to.
+ * @param seq Running frame number.
+ * @param frame Destination for the 802.11 frame without FCS.
+ * @param max Capacity of frame.
+ * @param type Receives the promiscuous packet type.
+ * @param rssi Receives the RSSI to report.
+ * @return Frame length, 0 to skip this slot.
+ **/
+typedef size_t (*mock_frame_generator_t)(void *ctx, uint8_t channel, uint32_t seq, uint8_t *frame, size_t max,
+                                         wifi_promiscuous_pkt_type_t *type, int8_t *rssi);
+
+/**
+ * @brief Installs the mock as radio operations and resets it.
+ **/
+void mock_radio_install(void);
+
+/**
+ * @brief Stops traffic and pending scans, forgets APs and counters. Scan time returns to 1 ms per channel.
+ **/
+void mock_radio_reset(void);
+
+/**
+ * @brief Sets the APs scans find, each on its own channel.
+ **/
+void mock_radio_set_aps(const mock_ap_t *aps, size_t count);
+
+/**
+ * @brief Sets how long a one-channel scan takes before SCAN_DONE is posted.
+ **/
+void mock_radio_set_scan_time(uint32_t us);
+
+/**
+ * @brief Sets the synthetic traffic delivered while promiscuous mode is on.
+ * @param frames_per_s Rate, 0 stops traffic.
+ * @param generator Frame builder, NULL for beacons of the configured APs on the current channel.
+ * @param ctx Passed to generator.
+ **/
+void mock_radio_set_traffic(uint32_t frames_per_s, mock_frame_generator_t generator, void *ctx);
+
+/**
+ * @brief Delivers one frame to the promiscuous callback on the calling thread.
+ * @param frame 802.11 frame without FCS.
+ * @param len Frame length.
+ * @param type Promiscuous packet type.
+ * @param rssi RSSI to report.
+ * @return false if promiscuous mode is off or the filter masks the type.
+ **/
+bool mock_radio_deliver(const uint8_t *frame, size_t len, wifi_promiscuous_pkt_type_t type, int8_t rssi);
+
+/**
+ * @brief Like mock_radio_deliver with the given rx_ctrl timestamp, for replaying a trace on its own clock.
+ **/
+bool mock_radio_deliver_at(const uint8_t *frame, size_t len, wifi_promiscuous_pkt_type_t type, int8_t rssi,
+                           uint32_t timestamp_us);
+
+/**
+ * @brief Copies the mock's counters.
+ **/
+void mock_radio_get_stats(mock_radio_stats_t *stats);
+
+/**
+ * @brief Builds a beacon of `ap` with SSID, DS parameter set and RSN/WPA elements matching its authmode.
+ * @return Frame length without FCS, 0 if max is too small.
+ **/
+size_t mock_build_beacon(const mock_ap_t *ap, uint16_t seq, uint8_t *frame, size_t max);
+
+/**
+ * @brief Builds a QoS-less data frame from a station to `bssid` (ToDS) with `payload_len` zero bytes.
+ * @return Frame length without FCS, 0 if max is too small.
+ **/
+size_t mock_build_data(const uint8_t bssid[6], const uint8_t station[6], uint16_t seq, size_t payload_len,
+                       uint8_t *frame, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_RADIO_H
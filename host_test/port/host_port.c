@@ -0,0 +1,955 @@
+/**
+ * @file host_port.c
+ * @brief Implements the host stand-ins in host_test/stubs on POSIX threads.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#define HOST_EVENT_QUEUE_LEN 64
+#define HOST_EVENT_HANDLERS 16
+#define HOST_LOG_TAGS 16
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Time
+
+static int64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int64_t boot_us(void) {
+    static _Atomic int64_t boot = 0;
+    int64_t expected = 0;
+    int64_t now = monotonic_us();
+    if (atomic_compare_exchange_strong(&boot, &expected, now)) {
+        return now;
+    }
+    return expected;
+}
+
+int64_t esp_timer_get_time(void) {
+    return monotonic_us() - boot_us();
+}
+
+/**
+ * @brief Absolute CLOCK_MONOTONIC deadline for pthread_cond_timedwait, ticks from now.
+ */
+static struct timespec deadline_after_us(int64_t us) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t ns = ts.tv_nsec + (us % 1000000) * 1000;
+    ts.tv_sec += us / 1000000 + ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+static void cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief Waits on cond until woken or the deadline; false on timeout. A NULL deadline waits forever.
+ */
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *deadline) {
+    if (deadline == NULL) {
+        pthread_cond_wait(cond, mutex);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+static const struct timespec *ticks_deadline(TickType_t ticks, struct timespec *storage) {
+    if (ticks == portMAX_DELAY) {
+        return NULL;
+    }
+    *storage = deadline_after_us((int64_t) ticks * 1000 * portTICK_PERIOD_MS);
+    return storage;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Tasks
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t function;
+    void *arg;
+    BaseType_t core;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notifications;
+};
+
+static _Thread_local struct host_task *current_task = NULL;
+static atomic_int creates_before_failure = -1;                              // See host_task_fail_create
+
+static struct host_task *task_new(TaskFunction_t function, void *arg, BaseType_t core) {
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return NULL;
+    }
+    task->function = function;
+    task->arg = arg;
+    task->core = core >= 0 && core < portNUM_PROCESSORS ? core : 0;
+    pthread_mutex_init(&task->lock, NULL);
+    cond_init(&task->notified);
+    return task;
+}
+
+static struct host_task *self_task(void) {
+    if (current_task == NULL) {                                             // Main or a foreign thread, e.g. a mock
+        current_task = task_new(NULL, NULL, 0);
+        current_task->thread = pthread_self();
+    }
+    return current_task;
+}
+
+static void *task_entry(void *arg) {
+    current_task = arg;
+    current_task->function(current_task->arg);
+    return NULL;                                                            // FreeRTOS tasks must not return, be lenient
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+    (void) name;
+    (void) priority;
+    if (atomic_load(&creates_before_failure) >= 0 && atomic_fetch_sub(&creates_before_failure, 1) == 0) {
+        return pdFAIL;                                                      // Injected, `created` untouched as on target
+    }
+    struct host_task *task = task_new(function, arg, core);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stack_depth < 65536 ? 262144 : stack_depth * 4);  // Host frames are larger
+    if (created != NULL) {
+        *created = task;                                                    // Visible before the task runs, as on target
+    }
+    int rc = pthread_create(&task->thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        if (created != NULL) {
+            *created = NULL;
+        }
+        free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, created, tskNO_AFFINITY);
+}
+
+void host_task_fail_create(int after) {
+    atomic_store(&creates_before_failure, after);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == current_task) {
+        pthread_exit(NULL);
+    }
+    // Deleting another task is not supported on the host; the components only delete themselves
+}
+
+void vTaskDelay(TickType_t ticks) {
+    uint64_t ms = (uint64_t) ticks * portTICK_PERIOD_MS;
+    struct timespec ts = { .tv_sec = (time_t) (ms / 1000), .tv_nsec = (long) (ms % 1000) * 1000000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t) (esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return self_task();
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return current_task != NULL ? current_task->core : 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    struct host_task *task = self_task();
+    struct timespec storage;
+    const struct timespec *deadline = ticks_deadline(ticks_to_wait, &storage);
+    pthread_mutex_lock(&task->lock);
+    while (task->notifications == 0 && ticks_to_wait != 0) {
+        if (!cond_wait(&task->notified, &task->lock, deadline)) {
+            break;
+        }
+    }
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&task->lock);
+    task->notifications++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Queues
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    size_t length;
+    size_t item_size;
+    size_t head;
+    size_t count;
+    uint8_t *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct host_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL || (queue->items = calloc(length, item_size > 0 ? item_size : 1)) == NULL) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    cond_init(&queue->not_empty);
+    cond_init(&queue->not_full);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue != NULL) {
+        free(queue->items);
+        free(queue);
+    }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    struct timespec storage;
+    const struct timespec *deadline = ticks_deadline(ticks_to_wait, &storage);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (ticks_to_wait == 0 || !cond_wait(&queue->not_full, &queue->lock, deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    memcpy(&queue->items[((queue->head + queue->count) % queue->length) * queue->item_size], item, queue->item_size);
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks_to_wait) {
+    struct timespec storage;
+    const struct timespec *deadline = ticks_deadline(ticks_to_wait, &storage);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (ticks_to_wait == 0 || !cond_wait(&queue->not_empty, &queue->lock, deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFAIL;
+        }
+    }
+    memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = (UBaseType_t) queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->head = queue->count = 0;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Semaphores
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    uint32_t count;
+    uint32_t max;
+    bool recursive;
+    struct host_task *owner;
+    uint32_t depth;
+};
+
+static SemaphoreHandle_t semaphore_new(uint32_t count, uint32_t max, bool recursive) {
+    struct host_semaphore *sem = calloc(1, sizeof(*sem));
+    if (sem == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->lock, NULL);
+    cond_init(&sem->available);
+    sem->count = count;
+    sem->max = max;
+    sem->recursive = recursive;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return semaphore_new(0, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return semaphore_new(1, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+    return semaphore_new(1, 1, true);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    free(semaphore);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    struct timespec storage;
+    const struct timespec *deadline = ticks_deadline(ticks_to_wait, &storage);
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0) {
+        if (ticks_to_wait == 0 || !cond_wait(&sem->available, &sem->lock, deadline)) {
+            pthread_mutex_unlock(&sem->lock);
+            return pdFAIL;
+        }
+    }
+    sem->count--;
+    sem->owner = self_task();
+    pthread_mutex_unlock(&sem->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count == sem->max) {
+        pthread_mutex_unlock(&sem->lock);
+        return pdFAIL;
+    }
+    sem->count++;
+    sem->owner = NULL;
+    pthread_cond_signal(&sem->available);
+    pthread_mutex_unlock(&sem->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    struct host_task *self = self_task();
+    pthread_mutex_lock(&sem->lock);
+    if (sem->owner == self && sem->depth > 0) {
+        sem->depth++;
+        pthread_mutex_unlock(&sem->lock);
+        return pdPASS;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    if (xSemaphoreTake(sem, ticks_to_wait) != pdPASS) {
+        return pdFAIL;
+    }
+    pthread_mutex_lock(&sem->lock);
+    sem->depth = 1;
+    pthread_mutex_unlock(&sem->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) {
+    pthread_mutex_lock(&sem->lock);
+    if (sem->owner != current_task || sem->depth == 0) {
+        pthread_mutex_unlock(&sem->lock);
+        return pdFAIL;
+    }
+    bool release = --sem->depth == 0;
+    pthread_mutex_unlock(&sem->lock);
+    return release ? xSemaphoreGive(sem) : pdPASS;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// esp_timer
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    bool armed;
+    bool deleted;
+    int64_t due_us;
+    uint64_t period_us;                                                     // 0 for one-shot
+};
+
+static void *timer_thread(void *arg) {
+    struct esp_timer *timer = arg;
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->deleted) {
+        if (!timer->armed) {
+            pthread_cond_wait(&timer->changed, &timer->lock);
+            continue;
+        }
+        int64_t wait_us = timer->due_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            struct timespec deadline = deadline_after_us(wait_us);
+            pthread_cond_timedwait(&timer->changed, &timer->lock, &deadline);
+            continue;                                                       // Re-check, the timer may have changed
+        }
+        if (timer->period_us > 0) {
+            timer->due_us += (int64_t) timer->period_us;
+        } else {
+            timer->armed = false;
+        }
+        pthread_mutex_unlock(&timer->lock);
+        timer->args.callback(timer->args.arg);                              // Like the esp_timer task, without the lock
+        pthread_mutex_lock(&timer->lock);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    free(timer);
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle) {
+    if (args == NULL || args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->args = *args;
+    pthread_mutex_init(&timer->lock, NULL);
+    cond_init(&timer->changed);
+    if (pthread_create(&timer->thread, NULL, timer_thread, timer) != 0) {
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_detach(timer->thread);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    pthread_mutex_lock(&timer->lock);
+    if (timer->armed) {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->due_us = esp_timer_get_time() + (int64_t) timeout_us;
+    timer->period_us = period_us;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer->lock);
+    bool was_armed = timer->armed;
+    timer->armed = false;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    return was_armed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer->lock);
+    timer->deleted = true;
+    pthread_cond_signal(&timer->changed);
+    pthread_mutex_unlock(&timer->lock);
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Default event loop
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    void *data;
+} host_event_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} host_handler_t;
+
+static QueueHandle_t event_queue = NULL;
+static host_handler_t event_handlers[HOST_EVENT_HANDLERS];
+static pthread_mutex_t handlers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void event_task(void *arg) {
+    (void) arg;
+    host_event_t event;
+    while (xQueueReceive(event_queue, &event, portMAX_DELAY) == pdPASS) {
+        host_handler_t matching[HOST_EVENT_HANDLERS];
+        size_t count = 0;
+        pthread_mutex_lock(&handlers_lock);
+        for (size_t i = 0; i < HOST_EVENT_HANDLERS; i++) {
+            const host_handler_t *h = &event_handlers[i];
+            if (h->handler != NULL && (h->base == NULL || h->base == event.base) &&
+                (h->id == ESP_EVENT_ANY_ID || h->id == event.id)) {
+                matching[count++] = *h;
+            }
+        }
+        pthread_mutex_unlock(&handlers_lock);
+        for (size_t i = 0; i < count; i++) {
+            matching[i].handler(matching[i].arg, event.base, event.id, event.data);
+        }
+        free(event.data);
+    }
+}
+
+esp_err_t esp_event_loop_create_default(void) {
+    static pthread_mutex_t create_lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_mutex_lock(&create_lock);
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    if (event_queue == NULL) {
+        event_queue = xQueueCreate(HOST_EVENT_QUEUE_LEN, sizeof(host_event_t));
+        err = xTaskCreate(event_task, "sys_evt", 4096, NULL, 20, NULL) == pdPASS ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+    pthread_mutex_unlock(&create_lock);
+    return err;
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks_to_wait) {
+    if (event_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    host_event_t event = { .base = base, .id = id, .data = NULL };
+    if (size > 0) {
+        if ((event.data = malloc(size)) == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(event.data, data, size);
+    }
+    if (xQueueSend(event_queue, &event, ticks_to_wait) != pdPASS) {
+        free(event.data);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg) {
+    pthread_mutex_lock(&handlers_lock);
+    for (size_t i = 0; i < HOST_EVENT_HANDLERS; i++) {
+        if (event_handlers[i].handler == NULL) {
+            event_handlers[i] = (host_handler_t) { base, id, handler, arg };
+            pthread_mutex_unlock(&handlers_lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&handlers_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t handler) {
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    pthread_mutex_lock(&handlers_lock);
+    for (size_t i = 0; i < HOST_EVENT_HANDLERS; i++) {
+        host_handler_t *h = &event_handlers[i];
+        if (h->handler == handler && h->base == base && h->id == id) {
+            memset(h, 0, sizeof(*h));
+            err = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&handlers_lock);
+    return err;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void *arg, esp_event_handler_instance_t *instance) {
+    if (instance != NULL) {
+        *instance = (void *) handler;
+    }
+    return esp_event_handler_register(base, id, handler, arg);
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id, esp_event_handler_instance_t instance) {
+    return esp_event_handler_unregister(base, id, (esp_event_handler_t) instance);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Logging
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static esp_log_level_t default_level = ESP_LOG_WARN;                        // Quiet by default, HOST_LOG_LEVEL overrides
+static struct {
+    const char *tag;
+    esp_log_level_t level;
+} tag_levels[HOST_LOG_TAGS];
+
+static int stderr_vprintf(const char *format, va_list args) {
+    return vfprintf(stderr, format, args);
+}
+
+static _Atomic vprintf_like_t log_vprintf = stderr_vprintf;
+
+static void read_log_env(void) {
+    const char *env = getenv("HOST_LOG_LEVEL");                             // 0 none ... 5 verbose
+    if (env != NULL) {
+        default_level = (esp_log_level_t) atoi(env);
+    }
+}
+
+static void log_init(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, read_log_env);
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    log_init();
+    pthread_mutex_lock(&log_lock);
+    if (strcmp(tag, "*") == 0) {
+        default_level = level;
+        memset(tag_levels, 0, sizeof(tag_levels));
+    } else {
+        for (size_t i = 0; i < HOST_LOG_TAGS; i++) {
+            if (tag_levels[i].tag == NULL || strcmp(tag_levels[i].tag, tag) == 0) {
+                tag_levels[i].tag = tag;
+                tag_levels[i].level = level;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&log_lock);
+}
+
+esp_log_level_t esp_log_level_get(const char *tag) {
+    log_init();
+    pthread_mutex_lock(&log_lock);
+    esp_log_level_t level = default_level;
+    for (size_t i = 0; tag != NULL && i < HOST_LOG_TAGS && tag_levels[i].tag != NULL; i++) {
+        if (strcmp(tag_levels[i].tag, tag) == 0) {
+            level = tag_levels[i].level;
+        }
+    }
+    pthread_mutex_unlock(&log_lock);
+    return level;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func) {
+    return atomic_exchange(&log_vprintf, func);
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    if (level > esp_log_level_get(tag)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    atomic_load(&log_vprintf)(format, args);
+    va_end(args);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Errors, CRC, NVS, netif
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK                :return "ESP_OK"               ;
+        case ESP_FAIL              :return "ESP_FAIL"             ;
+        case ESP_ERR_NO_MEM        :return "ESP_ERR_NO_MEM"       ;
+        case ESP_ERR_INVALID_ARG   :return "ESP_ERR_INVALID_ARG"  ;
+        case ESP_ERR_INVALID_STATE :return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE  :return "ESP_ERR_INVALID_SIZE" ;
+        case ESP_ERR_NOT_FOUND     :return "ESP_ERR_NOT_FOUND"    ;
+        case ESP_ERR_NOT_SUPPORTED :return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT       :return "ESP_ERR_TIMEOUT"      ;
+        case ESP_ERR_INVALID_CRC   :return "ESP_ERR_INVALID_CRC"  ;
+        default                    :return "UNKNOWN ERROR"        ;
+    }
+}
+
+void host_abort_on_error(esp_err_t err, const char *expr, const char *file, int line) {
+    fprintf(stderr, "ESP_ERROR_CHECK failed: %s (0x%x) at %s:%d: %s\n", esp_err_to_name(err), err, file, line, expr);
+    abort();
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t) -(int32_t) (crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void) {
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void) {
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// esp_wifi: bring-up only, the radio itself is mocked through wifictl_radio_set_ops
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+
+static _Atomic uint32_t wifi_init_count;
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_fetch_add(&wifi_init_count, 1);
+    return ESP_OK;
+}
+
+uint32_t host_wifi_init_count(void) {
+    return atomic_load(&wifi_init_count);
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage) {
+    (void) storage;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    (void) mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block) {
+    (void) config;
+    (void) block;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_scan_stop(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records) {
+    (void) records;
+    *number = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_clear_ap_list(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+    (void) primary;
+    (void) second;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool enable) {
+    (void) enable;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t callback) {
+    (void) callback;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+    (void) filter;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// UART
+
+static FILE *uart_outputs[UART_NUM_MAX];
+static uint32_t uart_baud_rates[UART_NUM_MAX] = { 115200, 115200, 115200 };
+static bool uart_installed[UART_NUM_MAX];
+static _Atomic uint32_t uart_write_delays_us[UART_NUM_MAX];
+static pthread_mutex_t uart_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool valid_port(uart_port_t port) {
+    return port >= 0 && port < UART_NUM_MAX;
+}
+
+void host_uart_set_output(uart_port_t port, FILE *out) {
+    if (valid_port(port)) {
+        pthread_mutex_lock(&uart_lock);
+        uart_outputs[port] = out;
+        pthread_mutex_unlock(&uart_lock);
+    }
+}
+
+void host_uart_set_write_delay(uart_port_t port, uint32_t us) {
+    if (valid_port(port)) {
+        uart_write_delays_us[port] = us;
+    }
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *queue, int intr_alloc_flags) {
+    (void) rx_buffer_size;
+    (void) tx_buffer_size;
+    (void) queue_size;
+    (void) queue;
+    (void) intr_alloc_flags;
+    if (!valid_port(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_installed[port] = true;
+    return ESP_OK;
+}
+
+bool uart_is_driver_installed(uart_port_t port) {
+    return valid_port(port) && uart_installed[port];
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) {
+    if (!valid_port(port) || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_baud_rates[port] = (uint32_t) config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) {
+    (void) tx;
+    (void) rx;
+    (void) rts;
+    (void) cts;
+    return valid_port(port) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud_rate) {
+    if (!valid_port(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_baud_rates[port] = baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t *baud_rate) {
+    if (!valid_port(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *baud_rate = uart_baud_rates[port];
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait) {
+    (void) ticks_to_wait;
+    if (!valid_port(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&uart_lock);
+    if (uart_outputs[port] != NULL) {
+        fflush(uart_outputs[port]);
+    }
+    pthread_mutex_unlock(&uart_lock);
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const void *data, size_t size) {
+    if (!valid_port(port)) {
+        return -1;
+    }
+    uint32_t delay_us = uart_write_delays_us[port];
+    if (delay_us > 0) {                                                     // Blocked on a full TX FIFO, data not out yet
+        struct timespec ts = { .tv_sec = (time_t) (delay_us / 1000000), .tv_nsec = (long) (delay_us % 1000000) * 1000 };
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+        }
+    }
+    pthread_mutex_lock(&uart_lock);
+    if (uart_outputs[port] != NULL) {
+        fwrite(data, 1, size, uart_outputs[port]);
+    }
+    pthread_mutex_unlock(&uart_lock);
+    return (int) size;
+}
+
+int uart_read_bytes(uart_port_t port, void *data, uint32_t length, TickType_t ticks_to_wait) {
+    (void) data;
+    (void) length;
+    if (!valid_port(port)) {
+        return -1;
+    }
+    if (ticks_to_wait != portMAX_DELAY) {
+        vTaskDelay(ticks_to_wait);
+    }
+    return 0;
+}
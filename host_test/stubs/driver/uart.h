@@ -0,0 +1,68 @@
+/**
+ * @file uart.h
+ * @brief Host stand-in for the UART driver. Ports are in-memory: writes go to the FILE set with
+ *        host_uart_set_output (discarded by default), reads return nothing.
+ */
+#ifndef HOST_DRIVER_UART_H
+#define HOST_DRIVER_UART_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int uart_port_t;
+
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+#define UART_NUM_MAX 3
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef enum { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5, UART_STOP_BITS_2 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE = 0 } uart_hw_flowcontrol_t;
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+} uart_config_t;
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              QueueHandle_t *queue, int intr_alloc_flags);
+bool uart_is_driver_installed(uart_port_t port);
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config);
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts);
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baud_rate);
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t *baud_rate);
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait);
+int uart_write_bytes(uart_port_t port, const void *data, size_t size);
+int uart_read_bytes(uart_port_t port, void *data, uint32_t length, TickType_t ticks_to_wait);
+
+/**
+ * @brief Sends everything later written to `port` to `out`, NULL discards. Host only.
+ **/
+void host_uart_set_output(uart_port_t port, FILE *out);
+
+/**
+ * @brief Makes every later write to `port` stall `us` microseconds before its data goes out, 0 for none. Host only.
+ **/
+void host_uart_set_write_delay(uart_port_t port, uint32_t us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_DRIVER_UART_H
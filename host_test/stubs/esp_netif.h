@@ -0,0 +1,15 @@
+/**
+ * @file esp_netif.h
+ * @brief Host stand-in for esp_netif; no interfaces exist.
+ */
+#ifndef ESP_NETIF_H
+#define ESP_NETIF_H
+
+#include "esp_err.h"
+
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_sta(void);
+
+#endif // ESP_NETIF_H
@@ -0,0 +1,20 @@
+/**
+ * @file esp_rom_crc.h
+ * @brief Host stand-in for the ROM CRC-32 (zlib polynomial, chainable).
+ */
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESP_ROM_CRC_H
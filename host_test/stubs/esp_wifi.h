@@ -0,0 +1,53 @@
+/**
+ * @file esp_wifi.h
+ * @brief Host stand-in for the esp_wifi driver API. Bring-up calls succeed; scan, channel and
+ *        promiscuous calls fail with ESP_ERR_NOT_SUPPORTED, so tests install a radio mock through
+ *        wifictl_radio_set_ops (see host_test/mock_radio.h).
+ */
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ESP_EVENT_DECLARE_BASE(WIFI_EVENT);
+
+typedef struct {
+    int magic;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { .magic = 0x1F2F3F4F }
+
+typedef void (*wifi_promiscuous_cb_t)(void *buf, wifi_promiscuous_pkt_type_t type);
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block);
+esp_err_t esp_wifi_scan_stop(void);
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *records);
+esp_err_t esp_wifi_clear_ap_list(void);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_set_promiscuous(bool enable);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t callback);
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter);
+
+/**
+ * @brief Returns how often esp_wifi_init succeeded. Host only.
+ **/
+uint32_t host_wifi_init_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESP_WIFI_H
@@ -0,0 +1,39 @@
+/**
+ * @file semphr.h
+ * @brief Host port of FreeRTOS semaphores and mutexes, see FreeRTOS.h. Static variants ignore the
+ *        buffer and allocate; handles live until the process exits.
+ */
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_semaphore *SemaphoreHandle_t;
+
+typedef struct {
+    void *unused;
+} StaticSemaphore_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+
+#define xSemaphoreCreateBinaryStatic(buffer) ((void) (buffer), xSemaphoreCreateBinary())
+#define xSemaphoreCreateMutexStatic(buffer) ((void) (buffer), xSemaphoreCreateMutex())
+#define xSemaphoreCreateRecursiveMutexStatic(buffer) ((void) (buffer), xSemaphoreCreateRecursiveMutex())
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_FREERTOS_SEMPHR_H
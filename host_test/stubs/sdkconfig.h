@@ -0,0 +1,17 @@
+/**
+ * @file sdkconfig.h
+ * @brief Host build configuration, force-included into every translation unit.
+ *
+ * Mostly options without a header default; everything else keeps the `#ifndef CONFIG_X` defaults of
+ * the component headers, so host and target share one layout per module. The AP table is built at its
+ * Kconfig maximum so the benchmarks cover dense sites.
+ */
+#ifndef HOST_SDKCONFIG_H
+#define HOST_SDKCONFIG_H
+
+#define CONFIG_METRICS_ENABLED 1
+#define CONFIG_ESP_CONSOLE_UART_NUM 0
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_AP_TABLE_CAPACITY 2048
+
+#endif // HOST_SDKCONFIG_H
@@ -0,0 +1,328 @@
+/**
+ * @file test_airtime.c
+ * @brief Airtime accounting against ground truth: frame durations match the 802.11 TXTIME formulas for
+ *        every rate, a synthetic hopping trace with known per-frame airtime sums up exactly per channel,
+ *        type and BSSID over the sliding window, BSSID ranking and eviction, and the monitor measures
+ *        captured frames and listened time through the sniffer against the radio mock.
+ */
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "airtime_meter.h"
+#include "airtime_monitor.h"
+#include "radio.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+static uint32_t rng_state = 23;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+/**
+ * @brief TXTIME of IEEE 802.11-2020 clauses 16 (DSSS), 17/18 (ERP-OFDM) and 19 (HT-mixed), 2.4 GHz.
+ **/
+static uint32_t reference_us(const airtime_phy_t *phy, uint32_t len) {
+    if (phy->legacy_rate == 0) {
+        static const uint32_t dbps_20mhz[8] = { 26, 52, 78, 104, 156, 208, 234, 260 };
+        static const uint32_t ltfs[4] = { 1, 2, 4, 4 };
+        uint32_t streams = phy->mcs / 8 + 1;
+        uint32_t dbps = dbps_20mhz[phy->mcs % 8] * (phy->ht40 ? 108 : 52) / 52 * streams;  // Data subcarriers
+        uint32_t n_es = dbps * 10 > 300 * (phy->short_gi ? 36 : 40) ? 2 : 1;
+        uint32_t symbols = (16 + 8 * len + 6 * n_es + dbps - 1) / dbps;
+        uint32_t data_us = phy->short_gi ? 4 * ((symbols * 36 + 39) / 40) : 4 * symbols;
+        return 20 + 8 + 4 + 4 * ltfs[streams - 1] + data_us + 6;           // L-preamble, HT-SIG, HT-STF, HT-LTFs
+    }
+    uint32_t kbps = phy->legacy_rate * 500;
+    switch (phy->legacy_rate) {
+        case 2: case 4: case 11: case 22:
+            return (phy->short_preamble && phy->legacy_rate != 2 ? 96 : 192) + (8000 * len + kbps - 1) / kbps;
+        case 12: case 18: case 24: case 36: case 48: case 72: case 96: case 108:
+            return 20 + 4 * ((16 + 8 * len + 6 + 4 * kbps / 1000 - 1) / (4 * kbps / 1000)) + 6;
+        default:
+            return 0;
+    }
+}
+
+static void random_phy(airtime_phy_t *phy) {
+    static const uint8_t legacy[] = { 2, 4, 11, 22, 12, 18, 24, 36, 48, 72, 96, 108 };
+    *phy = (airtime_phy_t) { 0 };
+    if (rng() % 2 == 0) {
+        phy->legacy_rate = legacy[rng() % sizeof(legacy)];
+        phy->short_preamble = rng() % 2;
+    } else {
+        phy->mcs = (uint8_t) (rng() % 32);
+        phy->ht40 = rng() % 2;
+        phy->short_gi = rng() % 2;
+    }
+}
+
+static void test_frame_durations(void) {
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .legacy_rate = 2 }, 100), 992);
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .legacy_rate = 108 }, 1500), 250);
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .mcs = 7 }, 1500), 230);
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .legacy_rate = 2, .short_preamble = true }, 100), 992);  // 1 Mbps has no short preamble
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .legacy_rate = 3 }, 100), 0);
+    CHECK_EQ(airtime_frame_us(&(airtime_phy_t) { .mcs = 32 }, 100), 0);
+
+    uint32_t mismatches = 0, checked = 0;
+    for (uint32_t len = 14; len <= 4000; len += 1 + len / 64) {
+        for (int rate = 0; rate <= 108; rate++) {
+            for (int variant = 0; variant < 2; variant++) {
+                airtime_phy_t phy = { .legacy_rate = (uint8_t) rate, .short_preamble = variant };
+                if (rate == 0 || reference_us(&phy, len) == 0) {
+                    continue;
+                }
+                mismatches += airtime_frame_us(&phy, len) != reference_us(&phy, len);
+                checked++;
+            }
+        }
+        for (int mcs = 0; mcs < 32; mcs++) {
+            for (int variant = 0; variant < 4; variant++) {
+                airtime_phy_t phy = { .mcs = (uint8_t) mcs, .ht40 = variant & 1, .short_gi = variant >> 1 };
+                mismatches += airtime_frame_us(&phy, len) != reference_us(&phy, len);
+                checked++;
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK(checked > 30000);
+}
+
+#define TRACE_CHANNELS 3
+#define TRACE_BSSIDS 8                                                      // Per channel
+#define TRACE_MAX 60000
+
+typedef struct {
+    uint32_t at_ms;
+    uint8_t channel;
+    uint8_t type;
+    int8_t bssid;                                                           // Index into trace_bssids, -1 for none
+    uint32_t airtime_us;                                                    // Ground truth
+    uint32_t listen_us;                                                     // Listened time entry when nonzero
+} trace_event_t;
+
+static trace_event_t trace[TRACE_MAX];
+static size_t trace_len;
+static uint8_t trace_bssids[TRACE_CHANNELS * TRACE_BSSIDS][6];
+
+/**
+ * @brief Hops channels 1, 6 and 11 every 250 ms for `seconds`, with a different load on each. Control
+ *        frames carry no BSSID. Listened time is entered at every switch, as the monitor does.
+ **/
+static void build_trace(uint32_t start_ms, uint32_t seconds) {
+    static const uint8_t channels[TRACE_CHANNELS] = { 1, 6, 11 };
+    static const uint32_t gap_us[TRACE_CHANNELS] = { 2000, 300, 8000 };     // Mean idle time between frames
+    trace_len = 0;
+    for (int b = 0; b < TRACE_CHANNELS * TRACE_BSSIDS; b++) {
+        uint8_t bssid[6] = { 0x02, 0, 0, 0, (uint8_t) (b / TRACE_BSSIDS), (uint8_t) b };
+        memcpy(trace_bssids[b], bssid, 6);
+    }
+    uint64_t t_us = (uint64_t) start_ms * 1000;
+    for (uint32_t dwell = 0; dwell < seconds * 4; dwell++) {
+        int c = dwell % TRACE_CHANNELS;
+        uint64_t end_us = t_us + 250000;
+        for (uint64_t at = t_us + rng() % gap_us[c]; trace_len < TRACE_MAX - 1; at += rng() % (2 * gap_us[c])) {
+            airtime_phy_t phy;
+            random_phy(&phy);
+            uint32_t len = 14 + rng() % 1500;
+            uint32_t duration = reference_us(&phy, len);
+            if (at + duration > end_us) {
+                break;
+            }
+            at += duration;                                                 // Captured when it ends
+            uint8_t type = (uint8_t) (rng() % AIRTIME_TYPES);
+            trace[trace_len++] = (trace_event_t) {
+                .at_ms = (uint32_t) (at / 1000), .channel = channels[c], .type = type, .airtime_us = duration,
+                .bssid = type == AIRTIME_CTRL ? -1 : (int8_t) (c * TRACE_BSSIDS + rng() % TRACE_BSSIDS),
+            };
+        }
+        t_us = end_us;
+        trace[trace_len++] = (trace_event_t) { .at_ms = (uint32_t) (t_us / 1000), .channel = channels[c],
+                                               .listen_us = 250000 };
+    }
+}
+
+static airtime_meter_t meter;
+
+/**
+ * @brief Checks channel and BSSID summaries at `now_ms` against the trace events in the window.
+ **/
+static void check_window(uint32_t start_ms, uint32_t now_ms) {
+    uint32_t epoch = (now_ms - start_ms) / CONFIG_AIRTIME_BUCKET_MS;
+    uint64_t airtime[AIRTIME_CHANNELS][AIRTIME_TYPES] = { { 0 } }, frames[AIRTIME_CHANNELS][AIRTIME_TYPES] = { { 0 } };
+    uint64_t listen[AIRTIME_CHANNELS] = { 0 }, bssid_airtime[TRACE_CHANNELS * TRACE_BSSIDS] = { 0 };
+    uint32_t bssid_frames[TRACE_CHANNELS * TRACE_BSSIDS] = { 0 };
+    for (size_t i = 0; i < trace_len && trace[i].at_ms <= now_ms; i++) {
+        const trace_event_t *e = &trace[i];
+        uint32_t e_epoch = (e->at_ms - start_ms) / CONFIG_AIRTIME_BUCKET_MS;
+        if (epoch - e_epoch >= CONFIG_AIRTIME_BUCKETS) {
+            continue;
+        }
+        if (e->listen_us > 0) {
+            listen[e->channel - 1] += e->listen_us;
+            continue;
+        }
+        airtime[e->channel - 1][e->type] += e->airtime_us;
+        frames[e->channel - 1][e->type]++;
+        if (e->bssid >= 0) {
+            bssid_airtime[e->bssid] += e->airtime_us;
+            bssid_frames[e->bssid]++;
+        }
+    }
+
+    airtime_channel_summary_t channels[AIRTIME_CHANNELS];
+    size_t count = airtime_meter_channels(&meter, now_ms, channels, AIRTIME_CHANNELS);
+    CHECK_EQ(count, TRACE_CHANNELS);
+    for (size_t i = 0; i < count; i++) {
+        const airtime_channel_summary_t *s = &channels[i];
+        uint64_t busy = 0;
+        for (int t = 0; t < AIRTIME_TYPES; t++) {
+            CHECK_EQ(s->airtime_us[t], airtime[s->channel - 1][t]);
+            CHECK_EQ(s->frames[t], frames[s->channel - 1][t]);
+            busy += airtime[s->channel - 1][t];
+        }
+        CHECK_EQ(s->listen_ms, listen[s->channel - 1] / 1000);
+        uint64_t expected = listen[s->channel - 1] == 0 ? 0 : (busy << 16) / listen[s->channel - 1];
+        CHECK_EQ(s->utilization_q16, expected > AIRTIME_Q16_ONE ? AIRTIME_Q16_ONE : expected);
+    }
+
+    airtime_bssid_summary_t bssids[CONFIG_AIRTIME_BSSIDS];
+    count = airtime_meter_bssids(&meter, now_ms, bssids, CONFIG_AIRTIME_BSSIDS);
+    uint32_t with_frames = 0;
+    for (int b = 0; b < TRACE_CHANNELS * TRACE_BSSIDS; b++) {
+        with_frames += bssid_frames[b] > 0;
+    }
+    CHECK_EQ(count, with_frames);
+    for (size_t i = 0; i < count; i++) {
+        const airtime_bssid_summary_t *s = &bssids[i];
+        int b = s->bssid[5];
+        uint32_t total = s->airtime_us[AIRTIME_MGMT] + s->airtime_us[AIRTIME_CTRL] + s->airtime_us[AIRTIME_DATA];
+        CHECK_EQ(s->frames, bssid_frames[b]);
+        CHECK_EQ(total, bssid_airtime[b]);
+        CHECK_EQ(s->airtime_us[AIRTIME_CTRL], 0);
+        uint64_t share = listen[s->channel - 1] == 0 ? 0 : (bssid_airtime[b] << 16) / listen[s->channel - 1];
+        CHECK_EQ(s->share_q16, share > AIRTIME_Q16_ONE ? AIRTIME_Q16_ONE : share);
+        if (i > 0) {
+            CHECK(total <= bssids[i - 1].airtime_us[AIRTIME_MGMT] + bssids[i - 1].airtime_us[AIRTIME_CTRL] +
+                           bssids[i - 1].airtime_us[AIRTIME_DATA]);
+        }
+    }
+}
+
+static void test_sliding_window_ground_truth(void) {
+    const uint32_t start_ms = 123456;
+    build_trace(start_ms, 25);
+    airtime_meter_init(&meter, start_ms);
+    uint32_t next_check_ms = start_ms + 700;
+    for (size_t i = 0; i < trace_len; i++) {
+        const trace_event_t *e = &trace[i];
+        if (e->at_ms > next_check_ms) {                                     // Mid-bucket and across wraps
+            check_window(start_ms, next_check_ms);
+            next_check_ms += 1700;
+        }
+        if (e->listen_us > 0) {
+            airtime_meter_listen(&meter, e->at_ms, e->channel, e->listen_us);
+        } else {
+            airtime_meter_record(&meter, e->at_ms, e->channel, e->type, e->bssid >= 0 ? trace_bssids[e->bssid] : NULL,
+                                 e->airtime_us);
+        }
+    }
+    check_window(start_ms, trace[trace_len - 1].at_ms);
+    CHECK_EQ(meter.evicted, 0);
+    CHECK_EQ(meter.unrated, 0);
+
+    airtime_channel_summary_t channels[AIRTIME_CHANNELS];                  // Idle past the window forgets everything
+    uint32_t idle_ms = trace[trace_len - 1].at_ms + (CONFIG_AIRTIME_BUCKETS + 1) * CONFIG_AIRTIME_BUCKET_MS;
+    CHECK_EQ(airtime_meter_channels(&meter, idle_ms, channels, AIRTIME_CHANNELS), 0);
+    airtime_meter_record(&meter, idle_ms + 100000, 6, AIRTIME_DATA, trace_bssids[0], 500);
+    CHECK_EQ(airtime_meter_channels(&meter, idle_ms + 100000, channels, AIRTIME_CHANNELS), 1);
+    CHECK_EQ(channels[0].airtime_us[AIRTIME_DATA], 500);
+    CHECK_EQ(channels[0].utilization_q16, 0);                               // Nothing listened
+}
+
+static void test_bssid_ranking_and_eviction(void) {
+    airtime_meter_init(&meter, 0);
+    uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 0 };
+    for (int b = 0; b < 3 * CONFIG_AIRTIME_BSSIDS; b++) {
+        bssid[5] = (uint8_t) b;
+        airtime_meter_record(&meter, (uint32_t) b, 1, AIRTIME_DATA, bssid, 100 + 7 * (uint32_t) b);
+    }
+    airtime_meter_listen(&meter, 200, 1, 1000000);
+    CHECK(meter.evicted >= 2 * CONFIG_AIRTIME_BSSIDS);
+    airtime_bssid_summary_t all[CONFIG_AIRTIME_BSSIDS], top[5];
+    size_t count = airtime_meter_bssids(&meter, 200, all, CONFIG_AIRTIME_BSSIDS);
+    CHECK_EQ(count, 3 * CONFIG_AIRTIME_BSSIDS - meter.evicted);
+    for (size_t i = 1; i < count; i++) {
+        CHECK(all[i].airtime_us[AIRTIME_DATA] <= all[i - 1].airtime_us[AIRTIME_DATA]);
+    }
+    CHECK_EQ(airtime_meter_bssids(&meter, 200, top, 5), 5);
+    for (int i = 0; i < 5; i++) {
+        CHECK(memcmp(top[i].bssid, all[i].bssid, 6) == 0);
+        CHECK_EQ(top[i].share_q16, ((uint64_t) all[i].airtime_us[AIRTIME_DATA] << 16) / 1000000);
+    }
+    CHECK_EQ(top[0].bssid[5], 3 * CONFIG_AIRTIME_BSSIDS - 1);               // Latest survives eviction
+}
+
+static void test_monitor_through_sniffer(void) {
+    static const mock_ap_t ap = { .bssid = { 0x02, 0, 0, 0, 0, 9 }, .ssid = "air", .channel = 3, .rssi = -40 };
+    uint8_t frame[256];
+    size_t len = mock_build_beacon(&ap, 0, frame, sizeof(frame));
+    uint32_t expected_us = reference_us(&(airtime_phy_t) { .legacy_rate = 12 }, len + 4);  // Mock reports 6 Mbit/s, FCS
+
+    CHECK_EQ(wifictl_sniffer_start(3), ESP_OK);
+    CHECK_EQ(wifictl_airtime_start(), ESP_OK);
+    CHECK_EQ(wifictl_airtime_start(), ESP_ERR_INVALID_STATE);
+    int64_t started_us = esp_timer_get_time();
+    for (int i = 0; i < 200; i++) {
+        CHECK(mock_radio_deliver(frame, len, WIFI_PKT_MGMT, -40));
+        if (i % 8 == 7) {
+            vTaskDelay(1);
+        }
+    }
+    airtime_channel_summary_t channels[AIRTIME_CHANNELS];
+    CHECK(WAIT_FOR(wifictl_airtime_channels(channels, AIRTIME_CHANNELS) == 1 && channels[0].frames[AIRTIME_MGMT] == 200,
+                   2000));
+    CHECK_EQ(channels[0].channel, 3);
+    CHECK_EQ(channels[0].airtime_us[AIRTIME_MGMT], 200 * expected_us);
+    vTaskDelay(pdMS_TO_TICKS(300));
+    CHECK_EQ(wifictl_radio_set_channel(8), ESP_OK);                        // Listened time follows the radio
+    int64_t switched_us = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(200));
+    CHECK_EQ(wifictl_airtime_channels(channels, AIRTIME_CHANNELS), 2);
+    int64_t queried_us = esp_timer_get_time();
+    CHECK_EQ(channels[1].channel, 8);
+    CHECK(channels[0].listen_ms + 2 >= (switched_us - started_us) / 1000);
+    CHECK(channels[0].listen_ms <= (queried_us - started_us) / 1000 + 2);
+    CHECK(channels[1].listen_ms + 2 >= 200 && channels[1].listen_ms <= (queried_us - switched_us) / 1000 + 2);
+    CHECK_EQ(channels[1].frames[AIRTIME_MGMT], 0);
+
+    airtime_bssid_summary_t bssids[4];
+    CHECK_EQ(wifictl_airtime_bssids(bssids, 4), 1);
+    CHECK(memcmp(bssids[0].bssid, ap.bssid, 6) == 0);
+    CHECK_EQ(bssids[0].frames, 200);
+
+    wifictl_sniffer_stop();                                                 // Not sniffing: no more listened time
+    uint32_t listen_ms = 0;
+    wifictl_airtime_channels(channels, AIRTIME_CHANNELS);
+    listen_ms = channels[1].listen_ms;
+    vTaskDelay(pdMS_TO_TICKS(100));
+    wifictl_airtime_channels(channels, AIRTIME_CHANNELS);
+    CHECK_EQ(channels[1].listen_ms, listen_ms);
+    wifictl_airtime_stop();
+    CHECK(!wifictl_airtime_active());
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_frame_durations);
+    RUN_TEST(test_sliding_window_ground_truth);
+    RUN_TEST(test_bssid_ranking_and_eviction);
+    RUN_TEST(test_monitor_through_sniffer);
+    return TEST_RESULT();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_ap_table.c
+ * @brief AP table: merging, RSSI smoothing, LRU eviction, expiry, sorted iteration, and a randomized
+ *        run against a reference list that checks deletions keep every probe chain intact.
+ */
+#include <string.h>
+
+#include "host_test.h"
+#include "ap_scanner.h"
+#include "ap_table.h"
+
+static wifi_ap_record_t make_record(uint32_t n, int8_t rssi) {
+    wifi_ap_record_t record = { 0 };
+    record.bssid[0] = 0x02;
+    record.bssid[2] = (uint8_t) (n >> 16);
+    record.bssid[4] = (uint8_t) (n >> 8);
+    record.bssid[5] = (uint8_t) n;
+    record.rssi = rssi;
+    record.primary = (uint8_t) (1 + n % 13);
+    record.authmode = WIFI_AUTH_WPA2_PSK;
+    return record;
+}
+
+static void test_merge_and_smoothing(void) {
+    wifictl_ap_table_clear();
+    wifi_ap_record_t scan = make_record(1, -40);
+    scan.phy_11n = 1;
+    scan.pairwise_cipher = WIFI_CIPHER_TYPE_CCMP;
+    uint16_t id = wifictl_ap_table_update(&scan, 1000, AP_SOURCE_SCAN);
+    CHECK(id != AP_TABLE_INVALID_ID);
+    CHECK_EQ(wifictl_ap_table_find(scan.bssid), id);
+
+    wifi_ap_record_t beacon = make_record(1, -80);                          // Beacon without cipher or PHY details
+    strcpy((char *) beacon.ssid, "renamed");
+    CHECK_EQ(wifictl_ap_table_update(&beacon, 2000, AP_SOURCE_BEACON), id);
+    CHECK_EQ(wifictl_ap_table_count(), 1);
+
+    wifictl_ap_info_t info;
+    wifi_ap_record_t record;
+    CHECK(wifictl_ap_table_info(id, &info) && wifictl_ap_table_record(id, &record));
+    CHECK_EQ(info.rssi_ewma_q4, -50 * 16);                                  // -40 + (-80 - -40) / 4
+    CHECK_EQ(info.seen_count, 2);
+    CHECK_EQ(info.first_seen_ms, 1000);
+    CHECK_EQ(info.last_seen_ms, 2000);
+    CHECK_EQ(info.sources, AP_SOURCE_SCAN | AP_SOURCE_BEACON);
+    CHECK(strcmp((const char *) record.ssid, "renamed") == 0);
+    CHECK_EQ(record.pairwise_cipher, WIFI_CIPHER_TYPE_CCMP);                 // Kept from the scan
+    CHECK_EQ(record.phy_11n, 1);
+    CHECK(!wifictl_ap_table_record(CONFIG_AP_TABLE_CAPACITY, &record));
+    CHECK(wifictl_get_ap_record(id, &record));
+    CHECK(!wifictl_get_ap_record(AP_TABLE_INVALID_ID, &record));
+    CHECK(!wifictl_get_ap_record(0x10000u + id, &record));                 // Not truncated to id
+}
+
+static void test_eviction_and_expiry(void) {
+    wifictl_ap_table_clear();
+    for (uint32_t n = 0; n < CONFIG_AP_TABLE_CAPACITY; n++) {
+        wifi_ap_record_t record = make_record(n, -50);
+        wifictl_ap_table_update(&record, 1000 + n, AP_SOURCE_SCAN);
+    }
+    CHECK_EQ(wifictl_ap_table_count(), CONFIG_AP_TABLE_CAPACITY);
+    wifi_ap_record_t oldest = make_record(0, -50);
+    wifictl_ap_table_update(&oldest, 1000000, AP_SOURCE_SCAN);              // Refreshed, so entry 1 is now the oldest
+    wifi_ap_record_t extra = make_record(CONFIG_AP_TABLE_CAPACITY, -50);
+    CHECK(wifictl_ap_table_update(&extra, 1000001, AP_SOURCE_SCAN) != AP_TABLE_INVALID_ID);
+    CHECK_EQ(wifictl_ap_table_count(), CONFIG_AP_TABLE_CAPACITY);
+    wifi_ap_record_t evicted = make_record(1, -50);
+    CHECK_EQ(wifictl_ap_table_find(evicted.bssid), AP_TABLE_INVALID_ID);
+    CHECK(wifictl_ap_table_find(oldest.bssid) != AP_TABLE_INVALID_ID);
+
+    CHECK_EQ(wifictl_ap_table_expire(1000001, 1000), CONFIG_AP_TABLE_CAPACITY - 2);
+    CHECK_EQ(wifictl_ap_table_count(), 2);
+    CHECK(wifictl_ap_table_find(extra.bssid) != AP_TABLE_INVALID_ID);
+}
+
+static void test_sorted(void) {
+    static const int8_t rssi[] = { -70, -30, -90, -50 };
+    uint16_t ids[8];
+    wifictl_ap_table_clear();
+    for (uint32_t n = 0; n < 4; n++) {
+        wifi_ap_record_t record = make_record(10 - n, rssi[n]);
+        wifictl_ap_table_update(&record, 100 * (n + 1), AP_SOURCE_SCAN);
+    }
+    wifictl_ap_info_t info;
+    CHECK_EQ(wifictl_ap_table_sorted(AP_SORT_RSSI, ids, 8), 4);
+    for (size_t i = 0; i < 4; i++) {
+        static const int8_t expected[] = { -30, -50, -70, -90 };
+        CHECK(wifictl_ap_table_info(ids[i], &info) && info.rssi_ewma_q4 == expected[i] * 16);
+    }
+    CHECK_EQ(wifictl_ap_table_sorted(AP_SORT_LAST_SEEN, ids, 2), 2);        // Truncated to max
+    CHECK(wifictl_ap_table_info(ids[0], &info) && info.last_seen_ms == 400);
+    CHECK_EQ(wifictl_ap_table_sorted(AP_SORT_BSSID, ids, 8), 4);
+    CHECK(wifictl_ap_table_info(ids[0], &info) && info.bssid[5] == 7);
+}
+
+static void test_randomized_against_reference(void) {
+    static bool present[4096];
+    static uint32_t last_seen[4096];
+    uint32_t state = 12345;
+    uint32_t now = 1;
+    bool consistent = true;
+    memset(present, 0, sizeof(present));
+    wifictl_ap_table_clear();
+    for (int step = 0; step < 200000; step++) {
+        state = state * 1103515245 + 12345;
+        uint32_t n = (state >> 8) % 4096;
+        now++;
+        if ((state >> 4) % 64 == 0) {                                       // Expire everything older than a window
+            wifictl_ap_table_expire(now, 3000);
+            for (uint32_t k = 0; k < 4096; k++) {
+                present[k] &= now - last_seen[k] <= 3000;
+            }
+            continue;
+        }
+        wifi_ap_record_t record = make_record(n, -60);
+        if (!present[n] && wifictl_ap_table_count() == CONFIG_AP_TABLE_CAPACITY) {
+            uint32_t oldest = 0;                                            // Reference eviction: least recently seen
+            bool any = false;
+            for (uint32_t k = 0; k < 4096; k++) {
+                if (present[k] && (!any || last_seen[k] < last_seen[oldest])) {
+                    oldest = k;
+                    any = true;
+                }
+            }
+            present[oldest] = false;
+        }
+        wifictl_ap_table_update(&record, now, AP_SOURCE_BEACON);
+        present[n] = true;
+        last_seen[n] = now;
+        if (step % 1000 == 0) {
+            size_t count = 0;
+            for (uint32_t k = 0; k < 4096; k++) {
+                wifi_ap_record_t probe = make_record(k, 0);
+                consistent &= (wifictl_ap_table_find(probe.bssid) != AP_TABLE_INVALID_ID) == present[k];
+                count += present[k];
+            }
+            consistent &= count == wifictl_ap_table_count();
+        }
+    }
+    CHECK(consistent);
+}
+
+int main(void) {
+    RUN_TEST(test_merge_and_smoothing);
+    RUN_TEST(test_eviction_and_expiry);
+    RUN_TEST(test_sorted);
+    RUN_TEST(test_randomized_against_reference);
+    return TEST_RESULT();
+}
@@ -0,0 +1,313 @@
+/**
+ * @file test_capture_filter.c
+ * @brief Capture filter: compile errors and limits, compiled programs checked against hand-written
+ *        reference predicates over random management, data and control frames, and the sniffer's
+ *        filter replaced and reset while the radio mock delivers frames.
+ */
+#include <stdatomic.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "capture_filter.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+#define MAC_A "02:00:00:00:00:0a"
+#define MAC_B "02:00:00:00:00:0b"
+#define MAC_C "02:00:00:00:00:0c"
+
+static const uint8_t macs[6][6] = {
+    { 0x02, 0, 0, 0, 0, 0x0a }, { 0x02, 0, 0, 0, 0, 0x0b }, { 0x02, 0, 0, 0, 0, 0x0c },
+    { 0x02, 0, 0, 0, 0, 0x0d }, { 0x02, 0, 0, 0, 0, 0x0e }, { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff },
+};
+
+typedef struct {
+    uint8_t frame[1200];
+    size_t len;
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t type, subtype;
+    const uint8_t *bssid, *src, *dst, *a1, *a2, *a3;                         // NULL when the frame has none
+} sample_t;
+
+static uint32_t rng_state = 9;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static void random_sample(sample_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->type = (uint8_t) (rng() % 3);
+    s->subtype = (uint8_t) (rng() % 16);
+    s->rssi = (int8_t) (-95 + (int) (rng() % 70));
+    s->channel = (uint8_t) (1 + rng() % 13);
+    s->frame[0] = (uint8_t) (s->type << 2 | s->subtype << 4);
+    const uint8_t *a1 = macs[rng() % 6], *a2 = macs[rng() % 5], *a3 = macs[rng() % 5];
+    if (s->type == 1) {                                                     // Control: RA and TA only
+        s->len = rng() % 2 ? 10 : 16;
+        memcpy(&s->frame[4], a1, 6);
+        s->a1 = s->dst = a1;
+        if (s->len == 16) {
+            memcpy(&s->frame[10], a2, 6);
+            s->a2 = s->src = a2;
+        }
+        return;
+    }
+    uint8_t ds = s->type == 2 ? (uint8_t) (rng() % 3) : 0;                  // No WDS
+    s->frame[1] = ds;
+    s->len = 24 + rng() % 1100;
+    memcpy(&s->frame[4], a1, 6);
+    memcpy(&s->frame[10], a2, 6);
+    memcpy(&s->frame[16], a3, 6);
+    s->a1 = a1;
+    s->a2 = a2;
+    s->a3 = a3;
+    switch (ds) {
+        case 0: s->dst = a1; s->src = a2; s->bssid = a3; break;
+        case 1: s->bssid = a1; s->src = a2; s->dst = a3; break;
+        default: s->dst = a1; s->bssid = a2; s->src = a3; break;
+    }
+}
+
+static bool is(const uint8_t *addr, int index) {
+    return addr != NULL && memcmp(addr, macs[index], 6) == 0;
+}
+
+static bool ref_beacons_of(const sample_t *s) {
+    return s->type == 0 && s->subtype == 8 && (is(s->bssid, 0) || is(s->bssid, 1)) && s->rssi > -70;
+}
+
+static bool ref_data_from_to(const sample_t *s) {
+    return s->type == 2 && (is(s->src, 0) || is(s->dst, 1)) && !(s->channel == 6);
+}
+
+static bool ref_ctrl_or_long(const sample_t *s) {
+    return s->type == 1 || s->len >= 1000;
+}
+
+static bool ref_precedence(const sample_t *s) {
+    return !(s->type == 0 || s->type == 2) || (s->rssi <= -80 && s->channel != 1);
+}
+
+static bool ref_any_addr(const sample_t *s) {
+    const uint8_t *all[3] = { s->a1, s->a2, s->a3 };
+    for (int i = 0; i < 3; i++) {
+        if (is(all[i], 0) || is(all[i], 1) || is(all[i], 2)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ref_numeric_subtype(const sample_t *s) {
+    return s->subtype == 8 && s->type == 0 && s->len < 500;
+}
+
+static bool ref_nested_not(const sample_t *s) {
+    return !(!(s->type == 2) || !(s->channel >= 6 && s->channel <= 11));
+}
+
+static const struct {
+    const char *expr;
+    bool (*reference)(const sample_t *s);
+} cases[] = {
+    { "mgmt subtype beacon and bssid in {" MAC_B ", " MAC_A "} and rssi > -70", ref_beacons_of },
+    { "data and (src " MAC_A " or dst " MAC_B ") and not channel == 6", ref_data_from_to },
+    { "ctrl or len >= 1000", ref_ctrl_or_long },
+    { "not (mgmt or data) or rssi <= -80 and channel != 1", ref_precedence },
+    { "addr in {" MAC_C "," MAC_A "," MAC_B "}", ref_any_addr },
+    { "subtype 8 mgmt len < 500", ref_numeric_subtype },
+    { "not (not data or not (channel >= 6 and channel <= 11))", ref_nested_not },
+};
+
+static void test_matches_reference(void) {
+    static capture_filter_t filter;
+    static sample_t s;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const char *error = NULL;
+        CHECK(capture_filter_compile(&filter, cases[c].expr, &error));
+        uint32_t expected_matches = 0, mismatches = 0;
+        for (int i = 0; i < 100000; i++) {
+            random_sample(&s);
+            bool expected = cases[c].reference(&s);
+            expected_matches += expected;
+            mismatches += capture_filter_match(&filter, s.frame, s.len, s.rssi, s.channel) != expected;
+        }
+        if (mismatches != 0) {
+            fprintf(stderr, "  \"%s\": %lu mismatches\n", cases[c].expr, (unsigned long) mismatches);
+        }
+        CHECK_EQ(mismatches, 0);
+        CHECK_EQ(filter.evaluated, 100000);
+        CHECK_EQ(filter.matched, expected_matches);
+        CHECK(expected_matches > 0 && expected_matches < 100000);          // The case exercises both outcomes
+    }
+}
+
+static void test_hit_counters(void) {
+    static capture_filter_t filter;
+    static sample_t s;
+    CHECK(capture_filter_compile(&filter, "mgmt and rssi > -70", NULL));
+    uint32_t mgmt = 0;
+    for (int i = 0; i < 1000; i++) {
+        random_sample(&s);
+        mgmt += s.type == 0;
+        capture_filter_match(&filter, s.frame, s.len, s.rssi, s.channel);
+    }
+    CHECK_EQ(filter.hits[0], mgmt);
+    CHECK_EQ(filter.hits[filter.insn_count - 1], filter.matched);
+    char text[64];
+    CHECK(capture_filter_format_insn(&filter, 0, text, sizeof(text)) > 0 && strcmp(text, "mgmt") == 0);
+    capture_filter_reset_stats(&filter);
+    CHECK_EQ(filter.evaluated, 0);
+    CHECK_EQ(filter.hits[0], 0);
+}
+
+static void test_empty_and_errors(void) {
+    static capture_filter_t filter;
+    static char expr[1024];
+    const char *error = NULL;
+    uint8_t frame[24] = { 0 };
+    CHECK(capture_filter_compile(&filter, "", &error));
+    CHECK(capture_filter_match(&filter, frame, sizeof(frame), -50, 1));
+
+    static const char *const invalid[] = {
+        "mgmt and", "(data", "data)", "subtype teapot", "bssid 02:00:00", "rssi >", "channel == x",
+        "bssid in {" MAC_A ",}", "or data", "mgmt data or",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        error = NULL;
+        CHECK(!capture_filter_compile(&filter, invalid[i], &error));
+        CHECK(error != NULL);
+    }
+
+    strcpy(expr, "");
+    for (int i = 0; i < CAPTURE_FILTER_MAX_DEPTH; i++) {
+        strcat(expr, "(");
+    }
+    strcat(expr, "data");
+    for (int i = 0; i < CAPTURE_FILTER_MAX_DEPTH; i++) {
+        strcat(expr, ")");
+    }
+    CHECK(capture_filter_compile(&filter, expr, NULL));
+    memmove(expr + 1, expr, strlen(expr) + 1);
+    expr[0] = '(';
+    strcat(expr, ")");
+    CHECK(!capture_filter_compile(&filter, expr, &error));                  // One level too deep
+
+    strcpy(expr, "data");
+    for (int i = 0; i < CONFIG_CAPTURE_FILTER_MAX_INSNS; i++) {
+        strcat(expr, " or ctrl");
+    }
+    CHECK(!capture_filter_compile(&filter, expr, &error));                  // Program too long
+
+    strcpy(expr, "addr in {");
+    for (int i = 0; i <= CONFIG_CAPTURE_FILTER_MAX_MACS; i++) {
+        char mac[24];
+        snprintf(mac, sizeof(mac), "%s02:00:00:00:%02x:%02x", i > 0 ? "," : "", i >> 8, i & 0xff);
+        strcat(expr, mac);
+    }
+    strcat(expr, "}");
+    CHECK(!capture_filter_compile(&filter, expr, &error));                  // Too many MACs
+}
+
+static const mock_ap_t filter_ap = { .bssid = { 0x02, 0, 0, 0, 0, 0x0a }, .ssid = "filtered", .channel = 6, .rssi = -50 };
+static const uint8_t filter_station[6] = { 0x06, 0, 0, 0, 0, 0x0a };
+static atomic_bool delivering;
+static atomic_uint delivered;
+
+static void deliver(uint32_t n) {
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    bool beacon = n % 2 == 0;
+    size_t len = beacon ? mock_build_beacon(&filter_ap, (uint16_t) n, frame, sizeof(frame))
+                        : mock_build_data(filter_ap.bssid, filter_station, (uint16_t) n, 64, frame, sizeof(frame));
+    mock_radio_deliver(frame, len, beacon ? WIFI_PKT_MGMT : WIFI_PKT_DATA, -50);
+}
+
+static void delivery_task(void *arg) {
+    for (uint32_t n = 0; atomic_load(&delivering); n++) {
+        deliver(n);
+        atomic_fetch_add(&delivered, 1);
+        if (n % 8 == 7) {
+            vTaskDelay(1);                                                  // Keep within the pool
+        }
+    }
+    atomic_store(&delivered, atomic_load(&delivered) | 0x80000000u);        // Done
+    vTaskDelete(NULL);
+}
+
+static uint32_t handled(const wifictl_sniffer_stats_t *before) {
+    wifictl_sniffer_stats_t now;
+    wifictl_sniffer_get_stats(&now);
+    return (now.captured - before->captured) + (now.filtered - before->filtered) + (now.dropped - before->dropped);
+}
+
+/**
+ * @brief The sniffer's filter runs in the promiscuous callback without a lock: it is replaced and its counters
+ *        reset while another task delivers frames, and every frame is still either captured, filtered or dropped.
+ */
+static void test_sniffer_filter_swap(void) {
+    static capture_filter_t filter;
+    wifictl_sniffer_stats_t before, after;
+    mock_radio_reset();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    CHECK_EQ(wifictl_sniffer_set_filter("data", NULL), ESP_OK);
+    wifictl_sniffer_get_stats(&before);
+    for (uint32_t n = 0; n < 200; n++) {
+        deliver(n);
+        if (n % 8 == 7) {
+            vTaskDelay(1);
+        }
+    }
+    wifictl_sniffer_get_stats(&after);
+    CHECK_EQ(after.filtered - before.filtered, 100);                        // Every beacon
+    CHECK_EQ(after.captured - before.captured + after.dropped - before.dropped, 100);
+    wifictl_sniffer_get_filter(&filter);
+    CHECK_EQ(filter.insn_count, 1);
+    CHECK_EQ(filter.evaluated, 200);
+    CHECK_EQ(filter.matched, 100);
+    CHECK_EQ(filter.hits[0], 100);
+    wifictl_sniffer_reset_filter_stats();
+    wifictl_sniffer_get_filter(&filter);
+    CHECK_EQ(filter.insn_count, 1);                                         // Program kept
+    CHECK_EQ(filter.evaluated, 0);
+    const char *error = NULL;
+    CHECK_EQ(wifictl_sniffer_set_filter("data and", &error), ESP_ERR_INVALID_ARG);
+    CHECK(error != NULL);
+    wifictl_sniffer_get_filter(&filter);
+    CHECK_EQ(filter.insn_count, 1);                                         // Failed compile keeps the active program
+
+    wifictl_sniffer_get_stats(&before);
+    atomic_store(&delivered, 0);
+    atomic_store(&delivering, true);
+    CHECK_EQ(xTaskCreate(delivery_task, "deliver", 4096, NULL, 5, NULL), pdPASS);
+    static const char *const programs[] = { "mgmt", "data", "", "mgmt and rssi > -70 or data", "not mgmt" };
+    for (int i = 0; i < 200; i++) {
+        CHECK_EQ(wifictl_sniffer_set_filter(programs[i % 5], NULL), ESP_OK);
+        if (i % 7 == 0) {
+            wifictl_sniffer_reset_filter_stats();
+        }
+        vTaskDelay(1);
+    }
+    atomic_store(&delivering, false);
+    CHECK(WAIT_FOR(atomic_load(&delivered) & 0x80000000u, 2000));
+    uint32_t total = atomic_load(&delivered) & 0x7fffffffu;
+    CHECK(total > 200);
+    CHECK_EQ(handled(&before), total);
+    wifictl_sniffer_stop();
+    CHECK_EQ(wifictl_sniffer_set_filter(NULL, NULL), ESP_OK);
+}
+
+int main(void) {
+    RUN_TEST(test_matches_reference);
+    RUN_TEST(test_hit_counters);
+    RUN_TEST(test_empty_and_errors);
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_sniffer_filter_swap);
+    return TEST_RESULT();
+}
@@ -0,0 +1,291 @@
+/**
+ * @file test_capture_log.c
+ * @brief Capture log on a file-backed volume (a temporary directory): round trip, time-range reads,
+ *        rotation under the size cap, and recovery from torn and corrupted tails and a lost index.
+ */
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+
+#include "capture_log.h"
+
+#define SEGMENT_BYTES (CONFIG_CAPTURE_LOG_SEGMENT_KB * 1024)
+
+static char dir[64];
+static uint32_t next_number;                                               // Number of the next appended record
+static uint32_t refused;                                                    // Appends retried because all buffers were queued
+
+typedef struct {
+    uint32_t count;
+    uint32_t first;
+    uint32_t last;
+    uint32_t errors;                                                        // Bad content, gaps or time going backwards
+    uint64_t last_ms;
+    uint32_t *numbers;                                                      // Optional, record numbers in read order
+    uint64_t *stamps;
+} read_result_t;
+
+static size_t record_len(uint32_t n) {
+    return 16 + (n * 37) % 600;
+}
+
+static void append_record(void) {
+    static uint8_t data[CAPTURE_LOG_MAX_RECORD];
+    uint32_t n = next_number;
+    size_t len = record_len(n);
+    memcpy(data, &n, sizeof(n));
+    for (size_t k = sizeof(n); k < len; k++) {
+        data[k] = (uint8_t) (n + k);
+    }
+    while (capture_log_append((uint8_t) (1 + n % 2), data, len) == ESP_ERR_NO_MEM) {
+        refused++;
+        sched_yield();                                                      // Writer is behind, the test wants every record
+    }
+    next_number++;
+}
+
+static bool visit(uint8_t type, uint64_t timestamp_ms, const void *data, size_t len, void *ctx) {
+    read_result_t *result = ctx;
+    const uint8_t *bytes = data;
+    uint32_t n;
+    memcpy(&n, data, sizeof(n));
+    bool ok = len == record_len(n) && type == 1 + n % 2 && timestamp_ms >= result->last_ms;
+    for (size_t k = sizeof(n); k < len && ok; k++) {
+        ok = bytes[k] == (uint8_t) (n + k);
+    }
+    if (result->count > 0 && n != result->last + 1) {
+        ok = false;
+    }
+    if (result->count == 0) {
+        result->first = n;
+    }
+    if (result->numbers != NULL) {
+        result->numbers[result->count] = n;
+        result->stamps[result->count] = timestamp_ms;
+    }
+    result->errors += !ok;
+    result->last = n;
+    result->last_ms = timestamp_ms;
+    result->count++;
+    return true;
+}
+
+static read_result_t read_all(void) {
+    read_result_t result = { 0 };
+    CHECK_EQ(capture_log_read(0, UINT64_MAX, visit, &result), ESP_OK);
+    return result;
+}
+
+static void remove_dir(void) {
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        char path[sizeof(dir) + sizeof(de->d_name) + 1];
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        if (de->d_name[0] != '.') {
+            remove(path);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+static void fresh_dir(void) {
+    strcpy(dir, "/tmp/capture_log_XXXXXX");
+    CHECK(mkdtemp(dir) != NULL);
+    next_number = 0;
+    refused = 0;
+}
+
+static long last_segment_size(char *path, size_t size) {
+    capture_log_stats_t stats;
+    capture_log_get_stats(&stats);
+    snprintf(path, size, "%s/SEG%05lu.LOG", dir, (unsigned long) (stats.first_segment + stats.segments - 1));
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fclose(f);
+    return len;
+}
+
+static void test_round_trip_and_ranges(void) {
+    static uint32_t numbers[8000];
+    static uint64_t stamps[8000];
+    fresh_dir();
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    CHECK_EQ(capture_log_open(dir), ESP_ERR_INVALID_STATE);
+    for (int i = 0; i < 8000; i++) {
+        append_record();
+        if (i % 500 == 499) {
+            vTaskDelay(2);                                                  // Spread records over log time
+        }
+    }
+    uint8_t big[CAPTURE_LOG_MAX_RECORD + 1] = { 0 };
+    CHECK_EQ(capture_log_append(1, big, sizeof(big)), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(capture_log_flush(), ESP_OK);
+
+    read_result_t all = { .numbers = numbers, .stamps = stamps };
+    CHECK_EQ(capture_log_read(0, UINT64_MAX, visit, &all), ESP_OK);
+    CHECK_EQ(all.count, 8000);
+    CHECK_EQ(all.first, 0);
+    CHECK_EQ(all.errors, 0);
+
+    capture_log_stats_t stats;
+    capture_log_get_stats(&stats);
+    CHECK_EQ(stats.records, 8000);
+    CHECK_EQ(stats.dropped, refused + 1);                                    // Refused appends and the oversized record
+    CHECK_EQ(stats.write_errors, 0);
+    CHECK_EQ(stats.first_ms, stamps[0]);
+    CHECK_EQ(stats.last_ms, stamps[7999]);
+    CHECK(stamps[7999] > stamps[0]);
+
+    static const uint32_t ranges[][2] = { { 0, 0 }, { 1000, 5000 }, { 4321, 4321 }, { 7500, 7999 } };
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        uint64_t from = stamps[ranges[r][0]], to = stamps[ranges[r][1]];
+        uint32_t expected = 0, expected_first = UINT32_MAX;
+        for (uint32_t i = 0; i < 8000; i++) {
+            if (stamps[i] >= from && stamps[i] <= to) {
+                expected++;
+                expected_first = expected_first < i ? expected_first : i;
+            }
+        }
+        read_result_t part = { 0 };
+        CHECK_EQ(capture_log_read(from, to, visit, &part), ESP_OK);
+        CHECK_EQ(part.count, expected);
+        CHECK_EQ(part.first, expected_first);
+        CHECK_EQ(part.errors, 0);
+    }
+    read_result_t none = { 0 };
+    CHECK_EQ(capture_log_read(stamps[7999] + 1, UINT64_MAX, visit, &none), ESP_OK);
+    CHECK_EQ(none.count, 0);
+
+    capture_log_close();
+    CHECK(!capture_log_is_open());
+    CHECK_EQ(capture_log_append(1, big, 4), ESP_ERR_INVALID_STATE);
+    remove_dir();
+}
+
+static void test_rotation_under_cap(void) {
+    fresh_dir();
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    size_t bytes = 0;
+    while (bytes < (size_t) SEGMENT_BYTES * (CONFIG_CAPTURE_LOG_MAX_SEGMENTS + 4)) {
+        bytes += record_len(next_number) + 8;
+        append_record();
+    }
+    CHECK_EQ(capture_log_flush(), ESP_OK);
+
+    capture_log_stats_t stats;
+    capture_log_get_stats(&stats);
+    CHECK_EQ(stats.segments, CONFIG_CAPTURE_LOG_MAX_SEGMENTS);
+    CHECK(stats.first_segment > 4);
+    read_result_t all = read_all();
+    CHECK_EQ(all.errors, 0);                                                // Oldest records gone, the rest contiguous
+    CHECK_EQ(all.last, next_number - 1);
+    CHECK(all.first > 0);
+    CHECK(all.count > next_number * 2 / 3);
+
+    uint32_t files = 0;
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        files += strncmp(de->d_name, "SEG", 3) == 0;
+    }
+    closedir(d);
+    CHECK_EQ(files, CONFIG_CAPTURE_LOG_MAX_SEGMENTS);
+    capture_log_close();
+    remove_dir();
+}
+
+static void test_recovery(void) {
+    char path[128];
+    fresh_dir();
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    while (next_number < 3000) {
+        append_record();
+    }
+    capture_log_close();
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    long clean_size = last_segment_size(path, sizeof(path));
+    capture_log_stats_t stats;
+    capture_log_get_stats(&stats);
+    uint64_t last_ms = stats.last_ms;
+    CHECK_EQ(stats.truncated_bytes, 0);
+    CHECK_EQ(stats.recovered_blocks, clean_size / CAPTURE_LOG_BLOCK_SIZE);
+    CHECK(capture_log_now_ms() > last_ms);                                  // Log time continues after a reboot
+    capture_log_close();
+
+    // Power loss in the middle of a block write: torn tail
+    FILE *f = fopen(path, "ab");
+    for (int i = 0; i < 1000; i++) {
+        fputc(i * 7, f);
+    }
+    fclose(f);
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    capture_log_get_stats(&stats);
+    CHECK_EQ(stats.truncated_bytes, 1000);
+    CHECK_EQ(last_segment_size(path, sizeof(path)), clean_size);
+    read_result_t all = read_all();
+    CHECK_EQ(all.count, 3000);
+    CHECK_EQ(all.errors, 0);
+    capture_log_close();
+
+    // Damaged last block: it and everything after it is dropped
+    f = fopen(path, "r+b");
+    fseek(f, clean_size - CAPTURE_LOG_BLOCK_SIZE + 100, SEEK_SET);
+    fputc(0x5a ^ fgetc(f), f);
+    fclose(f);
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    capture_log_get_stats(&stats);
+    CHECK_EQ(stats.truncated_bytes, CAPTURE_LOG_BLOCK_SIZE);
+    all = read_all();
+    CHECK(all.count < 3000 && all.count > 2900);
+    CHECK_EQ(all.first, 0);
+    CHECK_EQ(all.errors, 0);
+    uint32_t survivors = all.count;
+
+    next_number = survivors;                                                // Appending continues the log
+    for (int i = 0; i < 100; i++) {
+        append_record();
+    }
+    capture_log_close();
+
+    // Lost index: every closed segment is rescanned
+    snprintf(path, sizeof(path), "%s/INDEX.IDX", dir);
+    CHECK_EQ(remove(path), 0);
+    CHECK_EQ(capture_log_open(dir), ESP_OK);
+    all = read_all();
+    CHECK_EQ(all.count, survivors + 100);
+    CHECK_EQ(all.errors, 0);
+    CHECK(access(path, F_OK) == 0);
+    capture_log_close();
+    remove_dir();
+}
+
+static void test_invalid_dir(void) {
+    char long_dir[96];
+    memset(long_dir, 'd', sizeof(long_dir) - 1);
+    long_dir[0] = '/';
+    long_dir[sizeof(long_dir) - 1] = '\0';
+    CHECK_EQ(capture_log_open(long_dir), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(capture_log_open("/proc/no/such/dir"), ESP_FAIL);
+    CHECK(!capture_log_is_open());
+}
+
+int main(void) {
+    RUN_TEST(test_round_trip_and_ranges);
+    RUN_TEST(test_rotation_under_cap);
+    RUN_TEST(test_recovery);
+    RUN_TEST(test_invalid_dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,239 @@
+/**
+ * @file test_command_line.c
+ * @brief Console line discipline and command table: prefix lookup, argument splitting, history and
+ *        a large scripted session fed in chunks of random size with exact per-command accounting.
+ */
+#include <string.h>
+
+#include "host_test.h"
+
+#include "command_table.h"
+#include "line_editor.h"
+
+typedef struct {
+    uint32_t calls[16];
+    uint32_t statuses[COMMAND_TOO_MANY_ARGS + 1];
+    uint32_t bad_args;                                                      // Handler saw unexpected arguments
+    char last[CONFIG_CONSOLE_MAX_LINE];
+} session_t;
+
+static bool count(int argc, char **argv, void *ctx);
+
+static const command_t commands[] = {                                      // Same names as the firmware console
+    { "help", "", "", count },     { "scan", "", "", count },     { "aps", "", "", count },
+    { "output", "", "", count },   { "stations", "", "", count }, { "filter", "", "", count },
+    { "pcap", "", "", count },     { "hop", "", "", count },      { "log", "", "", count },
+    { "airtime", "", "", count },  { "sketch", "", "", count },   { "replay", "", "", count },
+    { "stats", "", "", count },    { "wifi", "", "", count },     { "quit", "", "", count },
+    { "exit", "", "", count },
+};
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static bool count(int argc, char **argv, void *ctx) {
+    session_t *session = ctx;
+    const command_t *command = NULL;
+    command_table_find(argv[0], &command);
+    session->calls[command - commands]++;
+    for (int i = 1; i < argc; i++) {                                        // Scripted arguments are "a<i>" or "x y"
+        char expected[12];
+        snprintf(expected, sizeof(expected), "a%d", i);
+        if (strcmp(argv[i], expected) != 0 && strcmp(argv[i], "x y") != 0) {
+            session->bad_args++;
+        }
+    }
+    return argc < 4;                                                        // Three arguments or more: usage error
+}
+
+static void on_line(char *line, void *ctx) {
+    session_t *session = ctx;
+    strcpy(session->last, line);
+    session->statuses[command_table_dispatch(line, ctx, NULL)]++;
+}
+
+static char echoed[4096];
+static size_t echoed_len;
+
+static void echo(const char *data, size_t len) {
+    if (echoed_len + len < sizeof(echoed)) {
+        memcpy(&echoed[echoed_len], data, len);
+        echoed_len += len;
+        echoed[echoed_len] = '\0';
+    }
+}
+
+static uint32_t rng_state = 3;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static void test_lookup(void) {
+    CHECK(command_table_register_all(commands, COMMAND_COUNT));
+    CHECK(command_table_register(&commands[0]));                           // Same command again
+    command_t impostor = { "help", "", "", count };
+    CHECK(!command_table_register(&impostor));
+    CHECK_EQ(command_table_count(), COMMAND_COUNT);
+
+    const command_t *command = NULL;
+    CHECK_EQ(command_table_find("stations", &command), COMMAND_OK);
+    CHECK(command == &commands[4]);
+    CHECK_EQ(command_table_find("sta", &command), COMMAND_AMBIGUOUS);      // stations, stats
+    CHECK_EQ(command_table_find("stati", &command), COMMAND_OK);
+    CHECK(command == &commands[4]);
+    CHECK_EQ(command_table_find("sk", &command), COMMAND_OK);
+    CHECK(command == &commands[10]);
+    CHECK_EQ(command_table_find("s", &command), COMMAND_AMBIGUOUS);
+    CHECK_EQ(command_table_find("x", &command), COMMAND_UNKNOWN);
+    CHECK(command == NULL);
+    CHECK_EQ(command_table_find("helpme", &command), COMMAND_UNKNOWN);
+}
+
+static void test_split(void) {
+    char line[] = "  filter  \"bssid in {a, b}\"\tand\"  x\"  ";
+    char *argv[4];
+    CHECK_EQ(command_table_split(line, argv, 4), 3);
+    CHECK(strcmp(argv[0], "filter") == 0);
+    CHECK(strcmp(argv[1], "bssid in {a, b}") == 0);
+    CHECK(strcmp(argv[2], "and  x") == 0);
+
+    char many[] = "a b c d e";
+    CHECK_EQ(command_table_split(many, argv, 4), -1);
+    char blank[] = " \t ";
+    CHECK_EQ(command_table_split(blank, argv, 4), 0);
+}
+
+static void test_editing_and_history(void) {
+    static line_editor_t ed;
+    static session_t session;
+    memset(&session, 0, sizeof(session));
+    echoed_len = 0;
+    line_editor_init(&ed, echo, on_line, &session);
+
+    static const char input[] = "apz\bs\r\nhop a1\n\rstats\r\033[A\033[A\033[A\033[B\r";
+    line_editor_feed(&ed, input, sizeof(input) - 1);
+    CHECK_EQ(ed.lines, 4);                                                  // The lone \r after \n ends an empty line
+    CHECK_EQ(session.calls[2], 1);
+    CHECK_EQ(session.calls[7], 2);                                          // Up three times, down once: "hop a1"
+    CHECK_EQ(session.calls[12], 1);
+    CHECK(strcmp(session.last, "hop a1") == 0);
+    CHECK(strstr(echoed, "apz\b \bs\r\n") == echoed);
+    CHECK(strstr(echoed, "\r\033[Kstats\r\033[Khop a1\r\033[Kaps\r\033[Khop a1\r\n") != NULL);
+
+    line_editor_feed(&ed, "\033[A\r", 4);
+    line_editor_feed(&ed, "\033[A\033[A\r", 7);                              // The repeated "hop a1" was stored once
+    CHECK_EQ(session.calls[7], 3);
+    CHECK_EQ(session.calls[12], 2);
+
+    for (int i = 0; i < CONFIG_CONSOLE_HISTORY_DEPTH + 4; i++) {            // Oldest entries fall out
+        char line[16];
+        int n = snprintf(line, sizeof(line), "log a%d\r", i % 2 + 1);
+        line_editor_feed(&ed, line, n);
+    }
+    for (int i = 0; i < CONFIG_CONSOLE_HISTORY_DEPTH + 4; i++) {
+        line_editor_feed(&ed, "\033[A", 3);
+    }
+    CHECK_EQ(ed.history_browse, CONFIG_CONSOLE_HISTORY_DEPTH);
+    line_editor_feed(&ed, "\r", 1);
+    CHECK_EQ(session.calls[8], CONFIG_CONSOLE_HISTORY_DEPTH + 5);           // Everything left is "log a1" or "log a2"
+}
+
+static void test_scripted_session(void) {
+    static line_editor_t ed;
+    static session_t session;
+    static char script[1 << 22];
+    static const char *const endings[] = { "\r\n", "\n", "\r" };
+    uint32_t expected_calls[COMMAND_COUNT] = { 0 };
+    uint32_t expected_statuses[COMMAND_TOO_MANY_ARGS + 1] = { 0 };
+    uint32_t expected_overflows = 0;
+    size_t prefix_len[COMMAND_COUNT];
+    size_t len = 0;
+
+    for (size_t c = 0; c < COMMAND_COUNT; c++) {                            // Shortest unambiguous prefixes
+        const command_t *found = NULL;
+        char prefix[16] = "";
+        command_status_t status = COMMAND_UNKNOWN;
+        for (prefix_len[c] = 0; status != COMMAND_OK || found != &commands[c];) {
+            prefix[prefix_len[c]] = commands[c].name[prefix_len[c]];
+            prefix_len[c]++;
+            status = command_table_find(prefix, &found);
+        }
+    }
+    while (len < sizeof(script) - 2 * CONFIG_CONSOLE_MAX_LINE) {
+        uint32_t kind = rng() % 100;
+        const command_t *command = &commands[rng() % COMMAND_COUNT];
+        if (kind < 2) {                                                     // Too long: discarded, not cut
+            memset(&script[len], 'z', CONFIG_CONSOLE_MAX_LINE);
+            len += CONFIG_CONSOLE_MAX_LINE;
+            expected_overflows++;
+        } else if (kind < 4) {
+            len += (size_t) sprintf(&script[len], "nosuch a1");
+            expected_statuses[COMMAND_UNKNOWN]++;
+        } else if (kind < 6) {
+            len += (size_t) sprintf(&script[len], "st a1");
+            expected_statuses[COMMAND_AMBIGUOUS]++;
+        } else if (kind < 7) {
+            len += (size_t) sprintf(&script[len], "%s a1 a2 a3 a4 a5 a6 a7 a8 a9 a10 a11 a12 a13 a14 a15 a16",
+                                    command->name);
+            expected_statuses[COMMAND_TOO_MANY_ARGS]++;
+        } else {
+            size_t name_len = kind < 40 ? prefix_len[command - commands] : strlen(command->name);
+            uint32_t argc = rng() % 5;
+            len += (size_t) sprintf(&script[len], "%.*s", (int) name_len, command->name);
+            for (uint32_t i = 1; i < argc; i++) {
+                len += (size_t) (rng() % 8 == 0 ? sprintf(&script[len], " \"x y\"")
+                                                : sprintf(&script[len], "  a%u", (unsigned) i));
+            }
+            expected_calls[command - commands]++;
+            expected_statuses[argc < 4 ? COMMAND_OK : COMMAND_USAGE]++;
+        }
+        const char *ending = endings[rng() % 3];
+        len += (size_t) sprintf(&script[len], "%s", ending);
+    }
+
+    memset(&session, 0, sizeof(session));
+    line_editor_init(&ed, NULL, on_line, &session);
+    for (size_t off = 0; off < len;) {                                      // UART reads hand over arbitrary chunks
+        size_t n = 1 + rng() % 512;
+        n = n < len - off ? n : len - off;
+        line_editor_feed(&ed, &script[off], n);
+        off += n;
+    }
+
+    uint32_t lines = 0;
+    for (int s = 0; s <= COMMAND_TOO_MANY_ARGS; s++) {
+        CHECK_EQ(session.statuses[s], expected_statuses[s]);
+        lines += expected_statuses[s];
+    }
+    for (size_t c = 0; c < COMMAND_COUNT; c++) {
+        CHECK_EQ(session.calls[c], expected_calls[c]);
+    }
+    CHECK_EQ(session.bad_args, 0);
+    CHECK_EQ(ed.lines, lines);
+    CHECK_EQ(ed.overflows, expected_overflows);
+    CHECK(lines > 100000);
+}
+
+static void test_capacity(void) {
+    static command_t extra[CONFIG_CONSOLE_MAX_COMMANDS];
+    static char names[CONFIG_CONSOLE_MAX_COMMANDS][8];
+    size_t registered = 0;
+    for (size_t i = 0; i < CONFIG_CONSOLE_MAX_COMMANDS; i++) {
+        snprintf(names[i], sizeof(names[i]), "zz%u", (unsigned) i);
+        extra[i] = (command_t) { names[i], "", "", count };
+        registered += command_table_register(&extra[i]);
+    }
+    CHECK_EQ(registered, CONFIG_CONSOLE_MAX_COMMANDS - COMMAND_COUNT);
+    CHECK_EQ(command_table_count(), CONFIG_CONSOLE_MAX_COMMANDS);
+    CHECK(command_table_get(0) == &commands[0]);
+    CHECK(command_table_get(CONFIG_CONSOLE_MAX_COMMANDS) == NULL);
+}
+
+int main(void) {
+    RUN_TEST(test_lookup);
+    RUN_TEST(test_split);
+    RUN_TEST(test_editing_and_history);
+    RUN_TEST(test_scripted_session);
+    RUN_TEST(test_capacity);
+    return TEST_RESULT();
+}
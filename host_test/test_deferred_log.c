@@ -0,0 +1,156 @@
+/**
+ * @file test_deferred_log.c
+ * @brief Deferred log: records kept until the formatter starts, drops counted on a full ring,
+ *        formatting and level filtering through esp_log_write, and concurrent producers on both
+ *        cores with every formatted record intact and in order per producer.
+ */
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "host_test.h"
+
+#include "deferred_log.h"
+
+#define TAG "dlog_test"
+#define QUIET_TAG "dlog_quiet"
+#define RACE_TAG "dlog_race"
+#define PRODUCERS 4
+#define PER_PRODUCER 50000
+
+static pthread_mutex_t captured_lock = PTHREAD_MUTEX_INITIALIZER;
+static char captured[64 * 1024];
+static size_t captured_len;
+static uint32_t race_lines, race_errors;                                    // Formatter thread only until the test reads them
+static int32_t race_last[PRODUCERS];
+static atomic_int producers_done;
+
+/**
+ * @brief Output of the formatter: race records are checked on the fly, everything else is kept.
+ */
+static int capture_vprintf(const char *format, va_list args) {
+    char line[256];
+    int len = vsnprintf(line, sizeof(line), format, args);
+    unsigned producer, n, check;
+    const char *message = strstr(line, RACE_TAG ": ");
+    if (message != NULL) {
+        if (sscanf(message, RACE_TAG ": p%u n%u c%u", &producer, &n, &check) != 3 || producer >= PRODUCERS ||
+            check != (producer * 2654435761u ^ n) || (int32_t) n <= race_last[producer]) {
+            race_errors++;
+        } else {
+            race_last[producer] = (int32_t) n;
+        }
+        race_lines++;
+        return len;
+    }
+    pthread_mutex_lock(&captured_lock);
+    if (len > 0 && captured_len + (size_t) len < sizeof(captured)) {
+        memcpy(captured + captured_len, line, (size_t) len + 1);
+        captured_len += (size_t) len;
+    }
+    pthread_mutex_unlock(&captured_lock);
+    return len;
+}
+
+static bool captured_has(const char *text) {
+    pthread_mutex_lock(&captured_lock);
+    bool found = strstr(captured, text) != NULL;
+    pthread_mutex_unlock(&captured_lock);
+    return found;
+}
+
+static deferred_log_stats_t stats(void) {
+    deferred_log_stats_t s;
+    deferred_log_get_stats(&s);
+    return s;
+}
+
+static void test_full_ring_drops_before_start(void) {
+    deferred_log_stats_t before = stats();
+    for (unsigned i = 0; i < CONFIG_DEFERRED_LOG_SLOTS + 5; i++) {
+        DLOGI(TAG, "fill %u", i);
+    }
+    deferred_log_stats_t after = stats();
+    CHECK_EQ(after.written - before.written, CONFIG_DEFERRED_LOG_SLOTS);
+    CHECK_EQ(after.dropped - before.dropped, 5);
+    CHECK_EQ(after.formatted, 0);
+
+    DLOGV(TAG, "above CONFIG_DEFERRED_LOG_LEVEL");                          // Compiled out, not even dropped
+    CHECK_EQ(stats().written, after.written);
+    CHECK_EQ(stats().dropped, after.dropped);
+}
+
+static void test_formatter_prints_kept_records(void) {
+    CHECK_EQ(deferred_log_start(), ESP_OK);
+    CHECK_EQ(deferred_log_start(), ESP_OK);
+    CHECK(WAIT_FOR(stats().formatted == stats().written, 1000));
+    CHECK(captured_has("I ("));
+    CHECK(captured_has(") " TAG ": fill 0\n"));
+    CHECK(captured_has(TAG ": fill 63\n"));
+    CHECK(!captured_has(TAG ": fill 64\n"));                                // Dropped
+    const char *first = strstr(captured, TAG ": fill 0\n"), *last = strstr(captured, TAG ": fill 63\n");
+    CHECK(first != NULL && last != NULL && first < last);
+
+    DLOGW(TAG, "args %d %u %s %c", -42, 7u, "literal", 'z');
+    DLOGW(TAG, "hex %x", 0xbeefu);
+    CHECK(WAIT_FOR(captured_has(TAG ": hex beef\n"), 1000));
+    CHECK(captured_has("W ("));
+    CHECK(captured_has(TAG ": args -42 7 literal z\n"));
+}
+
+static void test_runtime_level_filters(void) {
+    esp_log_level_set(QUIET_TAG, ESP_LOG_WARN);
+    deferred_log_stats_t before = stats();
+    DLOGD(QUIET_TAG, "debug %u", 1u);
+    DLOGI(QUIET_TAG, "info %u", 2u);
+    DLOGE(QUIET_TAG, "error %u", 3u);
+    CHECK(WAIT_FOR(stats().formatted == before.formatted + 3, 1000));       // Filtered records are consumed too
+    CHECK(!captured_has(QUIET_TAG ": debug 1"));
+    CHECK(!captured_has(QUIET_TAG ": info 2"));
+    CHECK(captured_has("E ("));
+    CHECK(captured_has(QUIET_TAG ": error 3\n"));
+}
+
+static void producer(void *arg) {
+    unsigned id = (unsigned) (uintptr_t) arg;
+    for (unsigned n = 0; n < PER_PRODUCER; n++) {
+        DLOGI(RACE_TAG, "p%u n%u c%u", id, n, id * 2654435761u ^ n);
+        if (n % 64 == 63) {
+            vTaskDelay(1);                                                  // Bursts, so some get through
+        }
+    }
+    atomic_fetch_add(&producers_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void test_concurrent_producers(void) {
+    for (int p = 0; p < PRODUCERS; p++) {
+        race_last[p] = -1;
+    }
+    deferred_log_stats_t before = stats();
+    for (int p = 0; p < PRODUCERS; p++) {                                   // Two producers per core ring
+        CHECK_EQ(xTaskCreatePinnedToCore(producer, "producer", 2048, (void *) (uintptr_t) p, 5, NULL, p % 2), pdPASS);
+    }
+    CHECK(WAIT_FOR(atomic_load(&producers_done) == PRODUCERS, 60000));
+    CHECK(WAIT_FOR(stats().formatted == stats().written, 1000));
+    deferred_log_stats_t after = stats();
+    uint32_t written = after.written - before.written, dropped = after.dropped - before.dropped;
+    CHECK_EQ(written + dropped, PRODUCERS * PER_PRODUCER);
+    CHECK(written > CONFIG_DEFERRED_LOG_SLOTS * 2);
+    CHECK(dropped > 0);
+    CHECK_EQ(race_lines, written);
+    CHECK_EQ(race_errors, 0);
+    fprintf(stderr, "  %u written, %u dropped\n", (unsigned) written, (unsigned) dropped);
+}
+
+int main(void) {
+    esp_log_level_set(TAG, ESP_LOG_VERBOSE);
+    esp_log_level_set(RACE_TAG, ESP_LOG_INFO);
+    esp_log_set_vprintf(capture_vprintf);
+    RUN_TEST(test_full_ring_drops_before_start);
+    RUN_TEST(test_formatter_prints_kept_records);
+    RUN_TEST(test_runtime_level_filters);
+    RUN_TEST(test_concurrent_producers);
+    return TEST_RESULT();
+}
@@ -0,0 +1,253 @@
+/**
+ * @file test_frame_fanout.cpp
+ * @brief Frame fan-out: every consumer sees every frame in order, each frame is released exactly once
+ *        and only after its last consumer, publish refuses while the slowest consumer is a full ring
+ *        behind, a concurrent run with one thread per consumer, and the sniffer's consumers against
+ *        the radio mock.
+ */
+#include <atomic>
+#include <cstring>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "frame_fanout.hpp"
+#include "sniffer.h"
+#include "sniffer_fanout.h"
+
+extern "C" {
+#include "frame_pool.h"
+#include "wifi_controller.h"
+}
+
+using wifictl::FrameFanout;
+
+namespace {
+
+constexpr size_t kCapacity = 8;
+constexpr size_t kConcurrentFrames = 400000;
+
+struct TestFrame {
+    uint32_t seq = 0;
+    mutable std::atomic<uint32_t> seen{0};                                  // Consumers that were called with it
+    std::atomic<uint32_t> released{0};
+};
+
+std::atomic<uint32_t> releases{0};
+std::atomic<uint32_t> early_releases{0};                                    // Released before every consumer saw it
+uint32_t consumers_expected = 0;
+
+struct CountRelease {
+    void operator()(TestFrame *frame) const {
+        if (frame->seen.load() != consumers_expected) {
+            early_releases++;
+        }
+        frame->released++;
+        releases++;
+    }
+};
+
+/** @brief Checks that frames arrive in publish order. */
+template <size_t I>
+struct OrderConsumer {
+    uint32_t next = 0;
+    uint32_t errors = 0;
+    void on_frame(const TestFrame &frame) {
+        if (frame.seq != next || frame.released.load() != 0) {
+            errors++;
+        }
+        next = frame.seq + 1;
+        frame.seen++;
+    }
+};
+
+void reset(std::vector<TestFrame> &frames, uint32_t consumers) {
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].seq = uint32_t(i);
+        frames[i].seen = 0;
+        frames[i].released = 0;
+    }
+    releases = 0;
+    early_releases = 0;
+    consumers_expected = consumers;
+}
+
+void test_release_after_last_consumer() {
+    std::vector<TestFrame> frames(kCapacity);
+    reset(frames, 3);
+    OrderConsumer<0> a;
+    OrderConsumer<1> b;
+    OrderConsumer<2> c;
+    FrameFanout<TestFrame, CountRelease, kCapacity, OrderConsumer<0>, OrderConsumer<1>, OrderConsumer<2>> fanout(a, b, c);
+    for (auto &frame : frames) {
+        CHECK(fanout.publish(&frame));
+    }
+    CHECK_EQ(fanout.published(), kCapacity);
+    CHECK_EQ(fanout.backlog<0>(), kCapacity);
+
+    CHECK_EQ(fanout.drain<0>(3), 3);                                        // Partial drain
+    CHECK_EQ(fanout.backlog<0>(), kCapacity - 3);
+    CHECK_EQ(fanout.delivered<0>(), 3);
+    CHECK_EQ(fanout.drain<0>(100), kCapacity - 3);
+    CHECK_EQ(fanout.drain<0>(100), 0);
+    CHECK_EQ(releases.load(), 0);                                           // Still referenced by b and c
+    CHECK_EQ(fanout.drain<OrderConsumer<2>>(100), kCapacity);              // By type
+    CHECK_EQ(releases.load(), 0);
+    CHECK_EQ(fanout.drain<1>(5), 5);
+    CHECK_EQ(releases.load(), 5);                                           // b was the last consumer of the first five
+    CHECK_EQ(fanout.drain_all(100), kCapacity - 5);
+    CHECK_EQ(releases.load(), kCapacity);
+    for (auto &frame : frames) {
+        CHECK_EQ(frame.released.load(), 1);
+        CHECK_EQ(frame.seen.load(), 3);
+    }
+    CHECK_EQ(early_releases.load(), 0);
+    CHECK_EQ(a.errors + b.errors + c.errors, 0);
+    CHECK_EQ(a.next, kCapacity);
+    CHECK_EQ(fanout.backlog<1>(), 0);
+}
+
+void test_publish_refuses_behind_slowest() {
+    std::vector<TestFrame> frames(kCapacity * 4);
+    reset(frames, 2);
+    OrderConsumer<0> fast;
+    OrderConsumer<1> slow;
+    FrameFanout<TestFrame, CountRelease, kCapacity, OrderConsumer<0>, OrderConsumer<1>> fanout(fast, slow);
+    size_t published = 0;
+    while (published < frames.size() && fanout.publish(&frames[published])) {
+        published++;
+        fanout.drain<0>(100);                                               // Fast consumer keeps up
+    }
+    CHECK_EQ(published, kCapacity);                                         // The slow one holds every slot
+    CHECK_EQ(fanout.backlog<0>(), 0);
+    CHECK_EQ(fanout.backlog<1>(), kCapacity);
+    CHECK_EQ(releases.load(), 0);
+    CHECK(!fanout.publish(&frames[published]));
+    CHECK_EQ(fanout.published(), kCapacity);                                // Refused frame not counted
+
+    CHECK_EQ(fanout.drain<1>(1), 1);                                        // One slot free again
+    CHECK(fanout.publish(&frames[published++]));
+    CHECK(!fanout.publish(&frames[published]));
+    while (published < frames.size()) {                                     // Wrap the ring several times
+        fanout.drain_all(3);
+        while (published < frames.size() && fanout.publish(&frames[published])) {
+            published++;
+        }
+    }
+    while (fanout.drain_all(100) > 0) {
+    }
+    CHECK_EQ(releases.load(), frames.size());
+    CHECK_EQ(early_releases.load(), 0);
+    CHECK_EQ(fast.errors + slow.errors, 0);
+    CHECK_EQ(slow.next, frames.size());
+}
+
+template <size_t I, typename Fanout>
+void consume(Fanout &fanout, size_t frames) {
+    while (fanout.template delivered<I>() < frames) {
+        if (fanout.template drain<I>(16) == 0) {
+            sched_yield();
+        }
+    }
+}
+
+void test_concurrent_consumers() {
+    std::vector<TestFrame> frames(kConcurrentFrames);
+    reset(frames, 4);
+    OrderConsumer<0> c0;
+    OrderConsumer<1> c1;
+    OrderConsumer<2> c2;
+    OrderConsumer<3> c3;
+    FrameFanout<TestFrame, CountRelease, 32, OrderConsumer<0>, OrderConsumer<1>, OrderConsumer<2>, OrderConsumer<3>> fanout(c0, c1, c2, c3);
+    std::thread threads[] = {
+        std::thread(consume<0, decltype(fanout)>, std::ref(fanout), frames.size()),
+        std::thread(consume<1, decltype(fanout)>, std::ref(fanout), frames.size()),
+        std::thread(consume<2, decltype(fanout)>, std::ref(fanout), frames.size()),
+        std::thread(consume<3, decltype(fanout)>, std::ref(fanout), frames.size()),
+    };
+    uint32_t refused = 0;
+    for (auto &frame : frames) {
+        while (!fanout.publish(&frame)) {
+            refused++;
+            sched_yield();
+        }
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(releases.load(), frames.size());
+    CHECK_EQ(early_releases.load(), 0);
+    CHECK_EQ(c0.errors + c1.errors + c2.errors + c3.errors, 0);
+    uint32_t wrong = 0;
+    for (auto &frame : frames) {
+        wrong += frame.released.load() != 1 || frame.seen.load() != 4;
+    }
+    CHECK_EQ(wrong, 0);
+    fprintf(stderr, "  %zu frames, publish refused %u times\n", frames.size(), (unsigned) refused);
+}
+
+std::atomic<uint32_t> events_seen{0};
+
+void count_event(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    events_seen++;
+}
+
+void test_sniffer_consumers() {
+    mock_radio_reset();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK_EQ(esp_event_handler_register(SNIFFER_EVENTS, ESP_EVENT_ANY_ID, count_event, nullptr), ESP_OK);
+    wifictl_fanout_consumer_stats_t consumers[4], consumers_after[4];
+    size_t count = wifictl_fanout_get_stats(consumers, 4);
+    CHECK_EQ(count, 2);
+    CHECK(std::strcmp(consumers[0].name, "events") == 0);
+    CHECK(std::strcmp(consumers[1].name, "sketch") == 0);
+
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    static const uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 }, station[6] = { 0x06, 0, 0, 0, 0, 1 };
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    uint32_t delivered = 0;
+    for (uint32_t n = 0; n < 5000; n++) {
+        size_t len = mock_build_data(bssid, station, uint16_t(n), 32 + n % 600, frame, sizeof(frame));
+        delivered += mock_radio_deliver(frame, len, WIFI_PKT_DATA, -50);
+        if (n % 8 == 7) {
+            vTaskDelay(1);                                                  // Keep within the pool and the event queue
+        }
+    }
+    wifictl_sniffer_get_stats(&after);
+    uint32_t published = (after.captured - before.captured) - (after.fanout_dropped - before.fanout_dropped);
+    CHECK(WAIT_FOR(wifictl_fanout_get_stats(consumers_after, 4) == 2 && consumers_after[0].backlog == 0
+                   && consumers_after[1].backlog == 0 && consumers_after[0].delivered - consumers[0].delivered == published
+                   && consumers_after[1].delivered - consumers[1].delivered == published, 2000));
+    wifictl_sniffer_get_stats(&after);
+    uint32_t posted = published - (after.post_failed - before.post_failed);
+    CHECK(WAIT_FOR(events_seen.load() == posted, 2000));
+    wifictl_sniffer_stop();
+
+    CHECK_EQ(delivered, 5000);
+    CHECK_EQ(after.captured - before.captured + after.dropped - before.dropped, delivered);
+    CHECK(published > delivered / 2);
+    CHECK_EQ(events_seen.load(), posted);
+    frame_pool_stats_t pool;
+    frame_pool_get_stats(&pool);
+    for (auto &pool_class : pool.classes) {                                 // Every frame went back to the pool
+        CHECK_EQ(pool_class.in_use, 0);
+    }
+    esp_event_handler_unregister(SNIFFER_EVENTS, ESP_EVENT_ANY_ID, count_event);
+}
+
+}  // namespace
+
+int main() {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_release_after_last_consumer);
+    RUN_TEST(test_publish_refuses_behind_slowest);
+    RUN_TEST(test_concurrent_consumers);
+    RUN_TEST(test_sniffer_consumers);
+    return TEST_RESULT();
+}
@@ -0,0 +1,92 @@
+/**
+ * @file test_frame_pool.c
+ * @brief Frame pool: size class selection, fall-through, exhaustion and high-water counters.
+ */
+#include <string.h>
+
+#include "host_test.h"
+#include "frame_pool.h"
+
+#define TOTAL_BUFFERS (CONFIG_FRAME_POOL_SMALL_COUNT + CONFIG_FRAME_POOL_MEDIUM_COUNT + CONFIG_FRAME_POOL_LARGE_COUNT)
+
+static void test_class_selection(void) {
+    frame_pool_stats_t stats;
+    frame_pool_reset_stats();
+    void *small = frame_pool_alloc(CONFIG_FRAME_POOL_SMALL_SIZE);
+    void *medium = frame_pool_alloc(CONFIG_FRAME_POOL_SMALL_SIZE + 1);
+    void *large = frame_pool_alloc(CONFIG_FRAME_POOL_LARGE_SIZE);
+    CHECK(small != NULL && medium != NULL && large != NULL);
+    CHECK(frame_pool_alloc(CONFIG_FRAME_POOL_LARGE_SIZE + 1) == NULL);
+
+    frame_pool_get_stats(&stats);
+    CHECK_EQ(stats.classes[FRAME_POOL_CLASS_SMALL].in_use, 1);
+    CHECK_EQ(stats.classes[FRAME_POOL_CLASS_MEDIUM].in_use, 1);
+    CHECK_EQ(stats.classes[FRAME_POOL_CLASS_LARGE].in_use, 1);
+    CHECK_EQ(stats.oversize, 1);
+
+    frame_pool_free(small);
+    frame_pool_free(medium);
+    frame_pool_free(large);
+    frame_pool_free(NULL);
+    frame_pool_get_stats(&stats);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        CHECK_EQ(stats.classes[c].in_use, 0);
+        CHECK_EQ(stats.classes[c].high_water, 1);
+        CHECK_EQ(stats.classes[c].allocated, 1);
+    }
+}
+
+static void test_exhaustion_falls_through(void) {
+    static void *held[TOTAL_BUFFERS + 1];
+    frame_pool_stats_t stats;
+    frame_pool_reset_stats();
+    size_t count = 0;
+    while (count <= TOTAL_BUFFERS && (held[count] = frame_pool_alloc(1)) != NULL) {
+        memset(held[count], (int) count, CONFIG_FRAME_POOL_SMALL_SIZE);     // Overlapping buffers would corrupt each other
+        count++;
+    }
+    CHECK_EQ(count, TOTAL_BUFFERS);                                         // Small requests end up in every class
+
+    frame_pool_get_stats(&stats);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        CHECK_EQ(stats.classes[c].in_use, stats.classes[c].capacity);
+        CHECK_EQ(stats.classes[c].high_water, stats.classes[c].capacity);
+    }
+    CHECK(stats.classes[FRAME_POOL_CLASS_SMALL].exhausted > 0);
+    CHECK(stats.classes[FRAME_POOL_CLASS_LARGE].exhausted == 1);            // The failed request
+
+    bool intact = true;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *buf = held[i];
+        for (size_t b = 0; b < CONFIG_FRAME_POOL_SMALL_SIZE; b++) {
+            intact &= buf[b] == (uint8_t) i;
+        }
+    }
+    CHECK(intact);
+
+    for (size_t i = 0; i < count; i++) {
+        frame_pool_free(held[i]);
+    }
+    frame_pool_reset_stats();
+    frame_pool_get_stats(&stats);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        CHECK_EQ(stats.classes[c].in_use, 0);
+        CHECK_EQ(stats.classes[c].high_water, 0);
+        CHECK_EQ(stats.classes[c].exhausted, 0);
+    }
+}
+
+static void test_freed_buffer_is_reused(void) {
+    void *first = frame_pool_alloc(CONFIG_FRAME_POOL_MEDIUM_SIZE);
+    frame_pool_free(first);
+    void *second = frame_pool_alloc(CONFIG_FRAME_POOL_SMALL_SIZE + 1);
+    CHECK(first == second);
+    frame_pool_free(second);
+}
+
+int main(void) {
+    RUN_TEST(test_class_selection);
+    RUN_TEST(test_exhaustion_falls_through);
+    RUN_TEST(test_freed_buffer_is_reused);
+    return TEST_RESULT();
+}
@@ -0,0 +1,105 @@
+/**
+ * @file test_frame_ring.c
+ * @brief SPSC capture ring: capacity checks, FIFO order, overflow, index wrap-around and a concurrent run.
+ */
+#include <pthread.h>
+#include <sched.h>
+
+#include "host_test.h"
+#include "frame_ring.h"
+
+#define CAPACITY 64
+#define CONCURRENT_ITEMS 1000000
+
+static void test_init_rejects_bad_capacity(void) {
+    static void *storage[CAPACITY];
+    frame_ring_t ring;
+    CHECK(!frame_ring_init(&ring, storage, 0));
+    CHECK(!frame_ring_init(&ring, storage, 48));
+    CHECK(frame_ring_init(&ring, storage, 1));
+    CHECK(frame_ring_init(&ring, storage, CAPACITY));
+}
+
+static void test_fifo_and_overflow(void) {
+    static void *storage[CAPACITY];
+    void *out[CAPACITY];
+    frame_ring_t ring;
+    frame_ring_init(&ring, storage, CAPACITY);
+    for (uintptr_t i = 0; i < CAPACITY; i++) {
+        CHECK(frame_ring_push(&ring, (void *) (i + 1)));
+    }
+    CHECK(!frame_ring_push(&ring, (void *) 1000));                            // Full
+    CHECK_EQ(frame_ring_count(&ring), CAPACITY);
+
+    CHECK_EQ(frame_ring_pop_batch(&ring, out, 10), 10);
+    for (uintptr_t i = 0; i < 10; i++) {
+        CHECK_EQ((uintptr_t) out[i], i + 1);
+    }
+    CHECK(frame_ring_push(&ring, (void *) 1001));
+    CHECK_EQ(frame_ring_pop_batch(&ring, out, CAPACITY), CAPACITY - 9);
+    CHECK_EQ((uintptr_t) out[0], 11);
+    CHECK_EQ((uintptr_t) out[CAPACITY - 10], 1001);
+    CHECK_EQ(frame_ring_pop_batch(&ring, out, CAPACITY), 0);
+}
+
+static void test_index_wrap_around(void) {
+    static void *storage[4];
+    void *out[4];
+    frame_ring_t ring;
+    frame_ring_init(&ring, storage, 4);
+    atomic_store(&ring.head, UINT32_MAX - 1);                               // Indices overflow while items are queued
+    atomic_store(&ring.tail, UINT32_MAX - 1);
+    for (uintptr_t i = 0; i < 4; i++) {
+        CHECK(frame_ring_push(&ring, (void *) (i + 1)));
+    }
+    CHECK(!frame_ring_push(&ring, (void *) 5));
+    CHECK_EQ(frame_ring_count(&ring), 4);
+    CHECK_EQ(frame_ring_pop_batch(&ring, out, 4), 4);
+    for (uintptr_t i = 0; i < 4; i++) {
+        CHECK_EQ((uintptr_t) out[i], i + 1);
+    }
+}
+
+static frame_ring_t concurrent_ring;
+static void *concurrent_storage[CAPACITY];
+static uint32_t producer_drops = 0;
+
+static void *producer(void *arg) {
+    (void) arg;
+    for (uintptr_t i = 1; i <= CONCURRENT_ITEMS; i++) {
+        while (!frame_ring_push(&concurrent_ring, (void *) i)) {
+            producer_drops++;                                               // Retry, every item must arrive
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_order(void) {
+    frame_ring_init(&concurrent_ring, concurrent_storage, CAPACITY);
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, NULL);
+    void *out[16];
+    uintptr_t expected = 1;
+    bool in_order = true;
+    while (expected <= CONCURRENT_ITEMS) {
+        size_t n = frame_ring_pop_batch(&concurrent_ring, out, 16);
+        if (n == 0) {
+            sched_yield();                                                  // Hosts with a single core
+        }
+        for (size_t i = 0; i < n; i++) {
+            in_order &= (uintptr_t) out[i] == expected++;
+        }
+    }
+    pthread_join(thread, NULL);
+    CHECK(in_order);
+    CHECK_EQ(frame_ring_count(&concurrent_ring), 0);
+}
+
+int main(void) {
+    RUN_TEST(test_init_rejects_bad_capacity);
+    RUN_TEST(test_fifo_and_overflow);
+    RUN_TEST(test_index_wrap_around);
+    RUN_TEST(test_concurrent_order);
+    return TEST_RESULT();
+}
@@ -0,0 +1,60 @@
+/**
+ * @file test_hop_scheduler.c
+ * @brief Hop scheduler: argument checks, round-robin order, dwell bounds and adaptation to traffic and discovery.
+ */
+#include "host_test.h"
+#include "hop_scheduler.h"
+
+static const uint8_t channels[] = { 1, 6, 11 };
+
+static void test_init_rejects_bad_arguments(void) {
+    hop_scheduler_t sched;
+    uint8_t too_many[HOP_MAX_CHANNELS + 1] = { 0 };
+    CHECK(!hop_scheduler_init(&sched, channels, 0, 50, 400, true));
+    CHECK(!hop_scheduler_init(&sched, too_many, sizeof(too_many), 50, 400, true));
+    CHECK(!hop_scheduler_init(&sched, channels, 3, 0, 400, true));
+    CHECK(!hop_scheduler_init(&sched, channels, 3, 500, 400, true));
+    CHECK(hop_scheduler_init(&sched, channels, 3, 400, 400, true));
+}
+
+static void test_round_robin(void) {
+    hop_scheduler_t sched;
+    hop_scheduler_init(&sched, channels, 3, 100, 400, false);
+    for (int visit = 0; visit < 9; visit++) {
+        CHECK_EQ(hop_scheduler_channel(&sched), channels[visit % 3]);
+        CHECK_EQ(hop_scheduler_next(&sched, visit == 0 ? 5000 : 0, 3, 100), 100);  // Traffic is ignored
+    }
+    CHECK_EQ(sched.channels[0].visits, 3);
+    CHECK_EQ(sched.channels[0].frames, 5000);
+    CHECK_EQ(sched.channels[2].new_bssids, 9);
+}
+
+static void test_adaptive_dwell(void) {
+    hop_scheduler_t sched;
+    hop_scheduler_init(&sched, channels, 3, 50, 400, true);
+    CHECK_EQ(hop_scheduler_dwell(&sched, 0), 225);                          // Unvisited: middle of the range
+    for (int round = 0; round < 20; round++) {
+        hop_scheduler_next(&sched, 0, 0, 100);                              // Channel 1 quiet
+        hop_scheduler_next(&sched, 1000, 0, 100);                           // Channel 6 busy, 10k frames/s
+        hop_scheduler_next(&sched, 0, round < 10 ? 0 : 4, 100);             // Channel 11 starts discovering
+    }
+    uint16_t quiet = hop_scheduler_dwell(&sched, 0);
+    uint16_t busy = hop_scheduler_dwell(&sched, 1);
+    uint16_t discovering = hop_scheduler_dwell(&sched, 2);
+    CHECK_EQ(quiet, 50);
+    CHECK(busy > 350 && busy <= 400);
+    CHECK(discovering > 250 && discovering <= 400);
+    CHECK_EQ(hop_scheduler_next(&sched, 0, 0, 0), busy);                    // Zero elapsed time is tolerated
+
+    for (int visit = 0; visit < 40 * 3; visit++) {                          // Traffic stops: dwell decays to the minimum
+        hop_scheduler_next(&sched, 0, 0, 100);
+    }
+    CHECK(hop_scheduler_dwell(&sched, 1) < 60);
+}
+
+int main(void) {
+    RUN_TEST(test_init_rejects_bad_arguments);
+    RUN_TEST(test_round_robin);
+    RUN_TEST(test_adaptive_dwell);
+    return TEST_RESULT();
+}
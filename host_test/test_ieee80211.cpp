@@ -0,0 +1,150 @@
+/**
+ * @file test_ieee80211.cpp
+ * @brief 802.11 parser: header layouts, BSSID selection, element iteration, RSN, beacon to AP record,
+ *        and a fuzz pass over mutated and truncated beacons where every view must stay inside the buffer.
+ */
+#include <cstring>
+#include <random>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "beacon_parser.h"
+#include "ieee80211.hpp"
+
+using namespace ieee80211;
+
+static void test_header_lengths() {
+    uint8_t frame[40] = {};
+    frame[0] = 0xd4;                                                        // ACK
+    auto ack = MacHeader::parse(ByteView(frame, 10));
+    CHECK(ack && ack->length() == 10 && !ack->addr2());
+    frame[0] = 0xb4;                                                        // RTS
+    CHECK(!MacHeader::parse(ByteView(frame, 10)));
+    CHECK(MacHeader::parse(ByteView(frame, 16))->length() == 16);
+    frame[0] = 0x88;                                                        // QoS data
+    frame[1] = 0x03;                                                        // ToDS and FromDS: four addresses
+    auto wds = MacHeader::parse(ByteView(frame, 32));
+    CHECK(wds && wds->length() == 32 && wds->addr4() && !wds->bssid());
+    CHECK(!MacHeader::parse(ByteView(frame, 31)));
+    frame[0] = 0x0c;                                                        // Extension frames are not parsed
+    CHECK(!MacHeader::parse(ByteView(frame, 40)));
+}
+
+static void test_bssid_by_direction() {
+    uint8_t frame[24] = { 0x08, 0x00 };
+    for (int i = 0; i < 6; i++) {
+        frame[4 + i] = 0xa1;
+        frame[10 + i] = 0xa2;
+        frame[16 + i] = 0xa3;
+    }
+    const uint8_t expected[4] = { 0xa3, 0xa1, 0xa2, 0 };                     // No DS, ToDS, FromDS, WDS
+    for (uint8_t ds = 0; ds < 3; ds++) {
+        frame[1] = ds;
+        auto bssid = MacHeader::parse(ByteView(frame, sizeof(frame)))->bssid();
+        CHECK(bssid && (*bssid)[0] == expected[ds]);
+    }
+}
+
+static void test_ie_iteration_stops_at_truncation() {
+    const uint8_t ies[] = { 0, 3, 'a', 'b', 'c', 3, 1, 6, 221, 10, 1, 2 };
+    size_t count = 0;
+    for (const auto &ie : IeRange(ByteView(ies, sizeof(ies)))) {
+        CHECK(ie.body.data() + ie.body.size() <= ies + sizeof(ies));
+        count++;
+    }
+    CHECK_EQ(count, 2);
+    auto ds = IeRange(ByteView(ies, sizeof(ies))).find(DsParameterSet::kId);
+    CHECK(ds && DsParameterSet::parse(ds->body)->channel == 6);
+    CHECK(!IeRange(ByteView(ies, sizeof(ies))).find(48));
+}
+
+static void test_rsn() {
+    const uint8_t body[] = { 1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, 4, 2, 0, 0x00, 0x0f, 0xac, 2,
+                             0x00, 0x0f, 0xac, 8, 0x0c, 0x00 };
+    auto rsn = Rsn::parse(ByteView(body, sizeof(body)));
+    CHECK(rsn && rsn->version == 1 && rsn->group_cipher == 0x000fac04);
+    CHECK(rsn->pairwise_count() == 1 && rsn->akm_count() == 2 && rsn->akm(1) == 0x000fac08);
+    CHECK_EQ(rsn->capabilities, 0x000c);
+    CHECK(!Rsn::parse(ByteView(body, 16)));                                 // AKM list cut short
+    CHECK(Rsn::parse(ByteView(body, 2)));                                   // Version only
+}
+
+static void test_beacon_to_record() {
+    static const wifi_auth_mode_t modes[] = { WIFI_AUTH_OPEN, WIFI_AUTH_WPA_PSK, WIFI_AUTH_WPA2_PSK, WIFI_AUTH_WPA_WPA2_PSK,
+                                              WIFI_AUTH_ENTERPRISE, WIFI_AUTH_WPA3_PSK, WIFI_AUTH_WPA2_WPA3_PSK };
+    for (wifi_auth_mode_t mode : modes) {
+        mock_ap_t ap = { { 0x02, 1, 2, 3, 4, 5 }, "parser", 9, -50, mode };
+        uint8_t frame[MOCK_RADIO_MAX_FRAME];
+        size_t len = mock_build_beacon(&ap, 7, frame, sizeof(frame));
+        wifi_ap_record_t record;
+        CHECK(wifictl_parse_beacon(frame, len, &record));
+        CHECK_EQ(record.authmode, mode);
+        CHECK_EQ(record.primary, 9);
+        CHECK(std::strcmp(reinterpret_cast<const char *>(record.ssid), "parser") == 0);
+        CHECK(std::memcmp(record.bssid, ap.bssid, 6) == 0);
+        CHECK(!wifictl_parse_beacon(frame, 24 + ManagementFrame::kBeaconFixedLength - 1, &record));
+    }
+}
+
+/**
+ * @brief Parses `frame` with every element type and checks all views stay within it.
+ */
+static bool parse_inside(const uint8_t *frame, size_t len) {
+    const uint8_t *end = frame + len;
+    bool inside = true;
+    auto check = [&](ByteView v) { inside &= v.empty() || (v.data() >= frame && v.data() + v.size() <= end); };
+    if (auto mf = ManagementFrame::parse(ByteView(frame, len))) {
+        check(mf->raw_ies());
+        dispatch_ies<Ssid, DsParameterSet, HtCapabilities, VhtCapabilities, Rsn>(mf->ies(), [&](const auto &ie) {
+            using T = std::decay_t<decltype(ie)>;
+            if constexpr (std::is_same_v<T, Rsn>) {
+                check(ie.pairwise_ciphers);
+                check(ie.akm_suites);
+                for (size_t i = 0; i < ie.akm_count(); i++) {
+                    (void) ie.akm(i);
+                }
+            } else if constexpr (std::is_same_v<T, HtCapabilities>) {
+                check(ie.mcs_set);
+                (void) ie.spatial_streams();
+            } else if constexpr (std::is_same_v<T, Ssid>) {
+                inside &= ie.name.size() <= 32;
+            }
+        });
+    }
+    wifi_ap_record_t record;
+    wifictl_parse_beacon(frame, len, &record);
+    return inside;
+}
+
+static void test_fuzz() {
+    std::mt19937 rng(80211);
+    mock_ap_t ap = { { 0x02, 0, 0, 0, 0, 1 }, "fuzz", 6, -40, WIFI_AUTH_WPA2_WPA3_PSK };
+    uint8_t seed[MOCK_RADIO_MAX_FRAME];
+    size_t seed_len = mock_build_beacon(&ap, 1, seed, sizeof(seed));
+    bool inside = true;
+    for (int iteration = 0; iteration < 200000; iteration++) {
+        size_t len = rng() % (seed_len + 8);
+        uint8_t *frame = new uint8_t[len];                                  // Exact size, so ASan sees any overread
+        std::memcpy(frame, seed, len < seed_len ? len : seed_len);
+        for (size_t i = seed_len; i < len; i++) {
+            frame[i] = uint8_t(rng());
+        }
+        for (int flips = rng() % 6; flips > 0 && len > 0; flips--) {
+            frame[rng() % len] = uint8_t(rng());
+        }
+        inside &= parse_inside(frame, len);
+        delete[] frame;
+    }
+    CHECK(inside);
+}
+
+int main() {
+    RUN_TEST(test_header_lengths);
+    RUN_TEST(test_bssid_by_direction);
+    RUN_TEST(test_ie_iteration_stops_at_truncation);
+    RUN_TEST(test_rsn);
+    RUN_TEST(test_beacon_to_record);
+    RUN_TEST(test_fuzz);
+    return TEST_RESULT();
+}
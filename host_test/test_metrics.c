@@ -0,0 +1,158 @@
+/**
+ * @file test_metrics.c
+ * @brief Metrics: histogram bucket boundaries up to UINT32_MAX in the last bucket, percentile ranks
+ *        capped by the maximum, snapshots summing the copies of both cores, reset, and the recording
+ *        macros compiling away with CONFIG_METRICS_ENABLED unset (test_metrics_disabled.c).
+ */
+#include <stdatomic.h>
+#include <string.h>
+
+#include "host_test.h"
+
+#include "metrics.h"
+
+int metrics_disabled_record_all(void);
+
+static metrics_hist_snapshot_t hist_snapshot(metric_hist_t hist) {
+    metrics_snapshot_t snapshot;
+    metrics_snapshot(&snapshot);
+    return snapshot.hists[hist];
+}
+
+/**
+ * @brief Records one value into a cleared histogram and returns the bucket it landed in, -1 if not exactly one.
+ **/
+static int bucket_of(uint32_t value) {
+    metrics_reset();
+    metrics_record(METRIC_HIST_PARSE, value);
+    metrics_hist_snapshot_t hist = hist_snapshot(METRIC_HIST_PARSE);
+    int found = -1;
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        if (hist.buckets[b] == 1 && found < 0) {
+            found = b;
+        } else if (hist.buckets[b] != 0) {
+            return -1;
+        }
+    }
+    return hist.count == 1 && hist.max == value ? found : -1;
+}
+
+static void test_bucket_boundaries(void) {
+    CHECK_EQ(bucket_of(0), 0);
+    CHECK_EQ(bucket_of(1), 1);
+    CHECK_EQ(bucket_of(2), 2);
+    CHECK_EQ(bucket_of(3), 2);
+    CHECK_EQ(bucket_of(4), 3);
+    CHECK_EQ(bucket_of((1u << 17) - 1), 17);
+    CHECK_EQ(bucket_of(1u << 17), 18);
+    CHECK_EQ(bucket_of((1u << 18) - 1), 18);
+    CHECK_EQ(bucket_of(1u << 18), METRICS_HIST_BUCKETS - 1);                // Last bucket starts at 2^18
+    CHECK_EQ(bucket_of(1u << 31), METRICS_HIST_BUCKETS - 1);
+    CHECK_EQ(bucket_of(UINT32_MAX), METRICS_HIST_BUCKETS - 1);
+    metrics_reset();
+}
+
+static void test_percentile(void) {
+    metrics_hist_snapshot_t hist = { 0 };
+    CHECK_EQ(metrics_hist_percentile(&hist, 50), 0);                        // Empty
+
+    hist.buckets[3] = 90;                                                   // 90 values in [4, 8), 10 in [512, 1024)
+    hist.buckets[10] = 10;
+    hist.count = 100;
+    hist.max = 1000;
+    CHECK_EQ(metrics_hist_percentile(&hist, 1), 7);
+    CHECK_EQ(metrics_hist_percentile(&hist, 50), 7);
+    CHECK_EQ(metrics_hist_percentile(&hist, 90), 7);                        // Rank 90 is the last of bucket 3
+    CHECK_EQ(metrics_hist_percentile(&hist, 91), 1000);                     // Bucket bound 1023 capped by the max
+    CHECK_EQ(metrics_hist_percentile(&hist, 100), 1000);
+
+    memset(&hist, 0, sizeof(hist));                                         // Rank rounds up: 1 of 3 is the 34th percentile
+    hist.buckets[0] = 1;
+    hist.buckets[5] = 2;
+    hist.count = 3;
+    hist.max = 20;
+    CHECK_EQ(metrics_hist_percentile(&hist, 33), 0);
+    CHECK_EQ(metrics_hist_percentile(&hist, 34), 20);                       // Bucket bound 31 capped by the max
+
+    memset(&hist, 0, sizeof(hist));                                         // The last bucket has no bound but the max
+    hist.buckets[METRICS_HIST_BUCKETS - 1] = 1;
+    hist.count = 1;
+    hist.max = UINT32_MAX;
+    CHECK_EQ(metrics_hist_percentile(&hist, 50), UINT32_MAX);
+}
+
+static atomic_bool core1_done;
+
+static void core1_task(void *arg) {
+    CHECK_EQ(xPortGetCoreID(), 1);
+    metrics_add(METRIC_BATCHES, 4);
+    metrics_record(METRIC_HIST_AGGREGATE, 5000);
+    metrics_record(METRIC_HIST_AGGREGATE, 6);
+    atomic_store(&core1_done, true);
+    vTaskDelete(NULL);
+}
+
+static void test_snapshot_sums_cores(void) {
+    metrics_reset();
+    CHECK_EQ(xPortGetCoreID(), 0);
+    metrics_add(METRIC_BATCHES, 3);
+    metrics_record(METRIC_HIST_AGGREGATE, 6);
+    CHECK_EQ(xTaskCreatePinnedToCore(core1_task, "metrics_core1", 2048, NULL, 5, NULL, 1), pdPASS);
+    CHECK(WAIT_FOR(atomic_load(&core1_done), 1000));
+
+    CHECK_EQ(atomic_load(&metrics_cores[0].counters[METRIC_BATCHES]), 3);   // Each core wrote its own copy
+    CHECK_EQ(atomic_load(&metrics_cores[1].counters[METRIC_BATCHES]), 4);
+    CHECK_EQ(atomic_load(&metrics_cores[0].max[METRIC_HIST_AGGREGATE]), 6);
+    CHECK_EQ(atomic_load(&metrics_cores[1].max[METRIC_HIST_AGGREGATE]), 5000);
+
+    metrics_snapshot_t snapshot;
+    metrics_snapshot(&snapshot);
+    CHECK_EQ(snapshot.counters[METRIC_BATCHES], 7);
+    metrics_hist_snapshot_t *hist = &snapshot.hists[METRIC_HIST_AGGREGATE];
+    CHECK_EQ(hist->count, 3);
+    CHECK_EQ(hist->buckets[3], 2);
+    CHECK_EQ(hist->buckets[13], 1);
+    CHECK_EQ(hist->max, 5000);
+    CHECK_EQ(metrics_hist_percentile(hist, 50), 7);
+    CHECK_EQ(metrics_hist_percentile(hist, 100), 5000);
+}
+
+static void test_reset(void) {
+    metrics_add(METRIC_SCANS, 2);
+    metrics_record(METRIC_HIST_SCAN, 1234);
+    metrics_reset();
+    metrics_snapshot_t snapshot, zero;
+    metrics_snapshot(&snapshot);
+    memset(&zero, 0, sizeof(zero));
+    CHECK(memcmp(&snapshot, &zero, sizeof(snapshot)) == 0);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        CHECK_EQ(atomic_load(&metrics_cores[core].counters[METRIC_BATCHES]), 0);
+        CHECK_EQ(atomic_load(&metrics_cores[core].max[METRIC_HIST_AGGREGATE]), 0);
+    }
+}
+
+static void test_macros_compile_away(void) {
+    metrics_reset();
+    CHECK(metrics_enabled());
+    CHECK_EQ(metrics_disabled_record_all(), 0);                             // Nothing evaluated, METRIC_NOW_US() is 0
+    metrics_snapshot_t snapshot, zero;
+    metrics_snapshot(&snapshot);
+    memset(&zero, 0, sizeof(zero));
+    CHECK(memcmp(&snapshot, &zero, sizeof(snapshot)) == 0);
+
+    uint32_t started_us = METRIC_NOW_US();                                  // Enabled here, for contrast
+    METRIC_INC(METRIC_SCANS);
+    METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
+    metrics_snapshot(&snapshot);
+    CHECK_EQ(snapshot.counters[METRIC_SCANS], 1);
+    CHECK_EQ(snapshot.hists[METRIC_HIST_CAPTURE].count, 1);
+}
+
+int main(void) {
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_percentile);
+    RUN_TEST(test_snapshot_sums_cores);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_macros_compile_away);
+    return TEST_RESULT();
+}
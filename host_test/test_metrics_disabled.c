@@ -0,0 +1,25 @@
+/**
+ * @file test_metrics_disabled.c
+ * @brief Part of test_metrics built with CONFIG_METRICS_ENABLED unset: the recording macros must
+ *        compile to nothing, neither touching the counters nor evaluating their value arguments.
+ */
+#undef CONFIG_METRICS_ENABLED
+
+#include "metrics.h"
+
+static int evaluations;
+
+uint32_t metrics_disabled_value(uint32_t value) {
+    evaluations++;
+    return value;
+}
+
+int metrics_disabled_record_all(void) {
+    evaluations = 0;
+    METRIC_INC(METRIC_SCANS);
+    METRIC_ADD(METRIC_UART_BYTES, metrics_disabled_value(100));
+    METRIC_RECORD(METRIC_HIST_SCAN, metrics_disabled_value(5));
+    uint32_t started_us = METRIC_NOW_US();
+    METRIC_SINCE_US(METRIC_HIST_CAPTURE, started_us);
+    return evaluations + (int) started_us;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_mock_radio.c
+ * @brief Scanner, mode lifecycle and sniffer running against the radio mock.
+ */
+#include <stdatomic.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "ap_scanner.h"
+#include "ap_table.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+static const mock_ap_t test_aps[] = {
+    { .bssid = { 0x02, 0, 0, 0, 0, 1 }, .ssid = "one", .channel = 1, .rssi = -40, .authmode = WIFI_AUTH_WPA2_PSK },
+    { .bssid = { 0x02, 0, 0, 0, 0, 2 }, .ssid = "six", .channel = 6, .rssi = -50, .authmode = WIFI_AUTH_OPEN },
+    { .bssid = { 0x02, 0, 0, 0, 0, 3 }, .ssid = "six-b", .channel = 6, .rssi = -70, .authmode = WIFI_AUTH_WPA3_PSK },
+    { .bssid = { 0x02, 0, 0, 0, 0, 4 }, .ssid = "eleven", .channel = 11, .rssi = -80, .authmode = WIFI_AUTH_WPA2_WPA3_PSK },
+};
+
+static atomic_uint callback_calls;
+static atomic_uint callback_ids;
+static atomic_uint done_calls;
+static atomic_uint last_done_channel;
+
+static void scan_callback(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    (void) ids;
+    atomic_fetch_add(&callback_calls, 1);
+    atomic_fetch_add(&callback_ids, count);
+    if (done) {
+        atomic_store(&last_done_channel, channel);
+        atomic_fetch_add(&done_calls, 1);
+    }
+}
+
+static void reset_callbacks(void) {
+    atomic_store(&callback_calls, 0);
+    atomic_store(&callback_ids, 0);
+    atomic_store(&done_calls, 0);
+    atomic_store(&last_done_channel, 0xff);
+}
+
+static void test_scan_reports_each_channel(void) {
+    static const uint8_t channels[] = { 1, 6, 11 };
+    mock_radio_reset();
+    mock_radio_set_aps(test_aps, sizeof(test_aps) / sizeof(test_aps[0]));
+    wifictl_ap_table_clear();
+    reset_callbacks();
+
+    CHECK_EQ(wifictl_scan_start_async(channels, 3), ESP_OK);
+    CHECK(WAIT_FOR(atomic_load(&done_calls) == 1 && wifictl_mode_get() == WIFICTL_MODE_IDLE, 2000));
+    CHECK_EQ(atomic_load(&callback_calls), 4);                               // One per channel, then the final done call
+    CHECK_EQ(atomic_load(&callback_ids), 4);
+    CHECK_EQ(atomic_load(&last_done_channel), 11);
+    CHECK_EQ(wifictl_ap_table_count(), 4);
+
+    wifi_ap_record_t record;
+    uint16_t id = wifictl_ap_table_find(test_aps[2].bssid);
+    CHECK(wifictl_ap_table_record(id, &record));
+    CHECK_EQ(record.primary, 6);
+    CHECK(strcmp((const char *) record.ssid, "six-b") == 0);
+
+    mock_radio_stats_t stats;
+    mock_radio_get_stats(&stats);
+    CHECK_EQ(stats.scans_started, 3);
+    CHECK_EQ(stats.scan_done_posted, 3);
+
+    uint32_t first_ms, total_ms;
+    wifictl_scan_get_timing(&first_ms, &total_ms);
+    CHECK(total_ms >= first_ms);
+}
+
+static void test_scan_cancel_calls_back_once(void) {
+    mock_radio_reset();
+    mock_radio_set_aps(test_aps, sizeof(test_aps) / sizeof(test_aps[0]));
+    mock_radio_set_scan_time(50000);
+    reset_callbacks();
+
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_OK);
+    CHECK(wifictl_scan_in_progress());
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_ERR_INVALID_STATE);
+    wifictl_scan_cancel();
+    CHECK(WAIT_FOR(!wifictl_scan_in_progress() && wifictl_mode_get() == WIFICTL_MODE_IDLE, 2000));
+    vTaskDelay(pdMS_TO_TICKS(20));                                          // Let the stopped request's SCAN_DONE arrive
+    CHECK_EQ(atomic_load(&done_calls), 1);
+    CHECK_EQ(atomic_load(&last_done_channel), 0);
+
+    mock_radio_stats_t stats;
+    mock_radio_get_stats(&stats);
+    CHECK_EQ(stats.scans_stopped, 1);
+}
+
+static void test_sniffer_start_cancels_scan(void) {
+    mock_radio_reset();
+    mock_radio_set_scan_time(50000);
+    reset_callbacks();
+
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_OK);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_SNIFFING);
+    CHECK(WAIT_FOR(atomic_load(&done_calls) == 1, 1000));
+    CHECK(!wifictl_scan_in_progress());
+    wifictl_sniffer_stop();
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_IDLE);
+
+    wifictl_lifecycle_stats_t lifecycle;
+    wifictl_get_lifecycle_stats(&lifecycle);
+    CHECK(lifecycle.transitions[WIFICTL_MODE_SCANNING][WIFICTL_MODE_SNIFFING].count >= 1);
+    CHECK(lifecycle.transitions[WIFICTL_MODE_SNIFFING][WIFICTL_MODE_IDLE].count >= 1);
+}
+
+static void test_sniffer_captures_traffic(void) {
+    mock_radio_reset();
+    mock_radio_set_aps(test_aps, sizeof(test_aps) / sizeof(test_aps[0]));
+    wifictl_sniffer_filter_frame_types(true, true, false);
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+
+    mock_radio_set_traffic(2000, NULL, NULL);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    mock_radio_set_traffic(0, NULL, NULL);
+
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    static const uint8_t station[6] = { 0x02, 0, 0, 0, 1, 1 };
+    size_t len = mock_build_data(test_aps[1].bssid, station, 1, 100, frame, sizeof(frame));
+    CHECK(mock_radio_deliver(frame, len, WIFI_PKT_DATA, -55));
+    CHECK(!mock_radio_deliver(frame, len, WIFI_PKT_CTRL, -55));               // Masked by the type filter
+    wifictl_sniffer_stop();
+    CHECK(!mock_radio_deliver(frame, len, WIFI_PKT_DATA, -55));
+
+    mock_radio_stats_t radio;
+    mock_radio_get_stats(&radio);
+    wifictl_sniffer_get_stats(&after);
+    CHECK(radio.frames_delivered >= 100);
+    CHECK(!radio.promiscuous);
+    CHECK_EQ(radio.channel, 6);
+    CHECK_EQ(after.captured + after.dropped + after.filtered - before.captured - before.dropped - before.filtered,
+             radio.frames_delivered);
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    CHECK(wifictl_register_scan_callback(scan_callback));
+
+    RUN_TEST(test_scan_reports_each_channel);
+    RUN_TEST(test_scan_cancel_calls_back_once);
+    RUN_TEST(test_sniffer_start_cancels_scan);
+    RUN_TEST(test_sniffer_captures_traffic);
+    return TEST_RESULT();
+}
@@ -0,0 +1,528 @@
+/**
+ * @file test_pcap_compact.c
+ * @brief Compact PCAP stream: frame_codec output decodes back to its input with a reference LZ4 decoder,
+ *        beacon_dedup passes, counts and summarises by its rules, and a site trace streamed through the
+ *        sniffer and the export expands back into exactly the delivered frames plus summaries that
+ *        account for every suppressed beacon before the BSSID's next full one. Stopping while batches are
+ *        being exported leaves nothing written after stop returns.
+ */
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "beacon_dedup.h"
+#include "driver/uart.h"
+#include "frame_codec.h"
+#include "pcap_export.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+#define RADIOTAP_LEN 46
+#define RADIOTAP_SEQ_OFFSET 42
+#define PCAP_RECORD_LEN 16
+#define STREAM_PORT UART_NUM_1
+
+static uint32_t rng_state = 17;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+/**
+ * @brief Reference LZ4 block decoder. Output is written to window + dict_len, matches may reach into the dictionary.
+ * @return Decoded length, -1 if the block is malformed or breaks the LZ4 end-of-block rules.
+ **/
+static long lz4_decode(const uint8_t *src, size_t len, uint8_t *window, size_t dict_len, size_t capacity) {
+    const uint8_t *ip = src, *end = src + len;
+    size_t op = dict_len, limit = dict_len + capacity;
+    size_t last_match_start = 0, last_match_end = 0;
+    bool matched = false;
+    while (ip < end) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return -1;
+                }
+                literals += b = *ip++;
+            } while (b == 255);
+        }
+        if ((size_t) (end - ip) < literals || limit - op < literals) {
+            return -1;
+        }
+        memcpy(&window[op], ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == end) {                                                    // Last sequence has no match
+            break;
+        }
+        if (end - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (size_t) ip[1] << 8;
+        ip += 2;
+        size_t match = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            uint8_t b;
+            do {
+                if (ip >= end) {
+                    return -1;
+                }
+                match += b = *ip++;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > op || limit - op < match) {
+            return -1;
+        }
+        last_match_start = op;
+        for (size_t i = 0; i < match; i++, op++) {                          // Byte by byte, matches may overlap
+            window[op] = window[op - offset];
+        }
+        last_match_end = op;
+        matched = true;
+    }
+    size_t out = op - dict_len;
+    if (matched && (op - last_match_end < 5 || op - last_match_start < 12)) {
+        return -1;
+    }
+    return (long) out;
+}
+
+static const uint8_t dictionary[] = {
+    0x30, 0x14, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x02,
+    0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00, 0x45, 0x00, 0x80, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0x01, 0x08, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24, 0x64, 0x00, 0x11, 0x04, 0x00, 0x2d, 0x1a, 0xef, 0x19, 0x1b,
+};
+
+static void test_codec_round_trip(void) {
+    static uint8_t window[sizeof(dictionary) + 1600];
+    static uint8_t input[1600], compressed[1700], decoded[sizeof(dictionary) + 1600];
+    frame_codec_t codec;
+    CHECK(!frame_codec_init(&codec, window, sizeof(dictionary), dictionary, sizeof(dictionary)));
+    CHECK(frame_codec_init(&codec, window, sizeof(window), dictionary, sizeof(dictionary)));
+    CHECK_EQ(codec.capacity, 1600);
+    CHECK_EQ(frame_codec_compress(&codec, 1601, compressed, sizeof(compressed)), 0);
+
+    size_t total_in = 0, total_dict_out = 0, failures = 0, short_fails = 0;
+    for (int i = 0; i < 20000; i++) {
+        size_t len = rng() % (i < 2000 ? 40 : 1601);                        // Many inputs around the end-of-block limits
+        switch (rng() % 4) {
+            case 0:                                                         // Incompressible
+                for (size_t j = 0; j < len; j++) {
+                    input[j] = (uint8_t) rng();
+                }
+                break;
+            case 1:                                                         // Long runs, length extension bytes
+                memset(input, (int) (rng() % 3), len);
+                break;
+            case 2:                                                         // Dictionary pieces with edits
+                for (size_t j = 0; j < len; j++) {
+                    input[j] = rng() % 16 == 0 ? (uint8_t) rng() : dictionary[(j + i) % sizeof(dictionary)];
+                }
+                break;
+            default:                                                        // Repeats of its own earlier content
+                for (size_t j = 0; j < len; j++) {
+                    input[j] = j < 32 || rng() % 8 == 0 ? (uint8_t) rng() : input[j - 1 - rng() % 32];
+                }
+                break;
+        }
+        memcpy(frame_codec_input(&codec), input, len);
+        size_t n = frame_codec_compress(&codec, len, compressed, len + len / 255 + 16);  // LZ4 worst case
+        memcpy(decoded, dictionary, sizeof(dictionary));
+        long out = lz4_decode(compressed, n, decoded, sizeof(dictionary), 1600);
+        if (n == 0 || out != (long) len || memcmp(&decoded[sizeof(dictionary)], input, len) != 0) {
+            failures++;
+            continue;
+        }
+        if (n > 1) {                                                        // Less room: fails cleanly or still decodes
+            memcpy(frame_codec_input(&codec), input, len);
+            size_t capacity = n - 1 - rng() % (n - 1);
+            size_t m = frame_codec_compress(&codec, len, compressed, capacity);
+            memcpy(decoded, dictionary, sizeof(dictionary));
+            failures += m > capacity || (m != 0 && (lz4_decode(compressed, m, decoded, sizeof(dictionary), 1600) != (long) len ||
+                                                    memcmp(&decoded[sizeof(dictionary)], input, len) != 0));
+            short_fails += m == 0;
+        }
+    }
+    CHECK_EQ(failures, 0);
+    CHECK(short_fails > 15000);
+
+    for (size_t len = 13; len <= sizeof(dictionary); len++) {               // Dictionary content shrinks to a few bytes
+        memcpy(frame_codec_input(&codec), dictionary, len);
+        total_in += len;
+        total_dict_out += frame_codec_compress(&codec, len, compressed, sizeof(compressed));
+    }
+    CHECK(total_dict_out * 3 < total_in);
+}
+
+/**
+ * @brief Builds a beacon of `ap` with TSF timestamp and a TIM element whose DTIM count and bitmap change per beacon.
+ **/
+static size_t build_beacon(const mock_ap_t *ap, uint16_t seq, uint64_t tsf, uint8_t *frame, size_t max) {
+    size_t len = mock_build_beacon(ap, seq, frame, max - 6);
+    for (int i = 0; i < 8; i++) {
+        frame[24 + i] = (uint8_t) (tsf >> (8 * i));
+    }
+    const uint8_t tim[] = { 5, 4, (uint8_t) (seq % 3), 3, 0, (uint8_t) (seq * 7) };
+    memcpy(&frame[len], tim, sizeof(tim));
+    return len + sizeof(tim);
+}
+
+static beacon_summary_t summaries[300];
+static size_t summary_count;
+
+static void collect_summary(const beacon_summary_t *summary, void *ctx) {
+    if (summary_count < sizeof(summaries) / sizeof(summaries[0])) {
+        summaries[summary_count] = *summary;
+    }
+    summary_count++;
+}
+
+/**
+ * @brief Observes a frame as received, with FCS.
+ **/
+static bool observe(beacon_dedup_t *dedup, const uint8_t *frame, size_t len, int8_t rssi, uint8_t channel,
+                    uint32_t now_us) {
+    static uint8_t with_fcs[MOCK_RADIO_MAX_FRAME + 4];
+    memcpy(with_fcs, frame, len);
+    memset(&with_fcs[len], 0, 4);
+    return beacon_dedup_observe(dedup, with_fcs, len + 4, rssi, channel, now_us, collect_summary, NULL);
+}
+
+static void test_dedup_rules(void) {
+    static beacon_dedup_t dedup;
+    uint8_t frame[512];
+    mock_ap_t ap = { .bssid = { 0x02, 0, 0, 0, 0, 7 }, .ssid = "dedup", .channel = 6, .authmode = WIFI_AUTH_WPA2_PSK };
+    beacon_dedup_init(&dedup, 1000, 10000);
+    summary_count = 0;
+
+    uint32_t t = 100;
+    CHECK(observe(&dedup, frame, build_beacon(&ap, 0, t, frame, sizeof(frame)), -50, 6, t));  // New BSSID
+    static const int8_t rssi[] = { -60, -41, -55, -47, -52, -58, -44, -49, -51 };
+    for (int i = 0; i < 9; i++) {                                           // Only timestamp and TIM change
+        t += 102400;
+        CHECK(!observe(&dedup, frame, build_beacon(&ap, (uint16_t) (i + 1), t, frame, sizeof(frame)), rssi[i], 6, t));
+    }
+    CHECK_EQ(dedup.suppressed, 9);
+    beacon_dedup_flush(&dedup, 900000, collect_summary, NULL);              // Interval not over yet
+    CHECK_EQ(summary_count, 0);
+    beacon_dedup_flush(&dedup, 1000000, collect_summary, NULL);
+    CHECK_EQ(summary_count, 1);
+    CHECK(memcmp(summaries[0].bssid, ap.bssid, 6) == 0);
+    CHECK_EQ(summaries[0].channel, 6);
+    CHECK_EQ(summaries[0].count, 9);
+    CHECK_EQ(summaries[0].rssi_min, -60);
+    CHECK_EQ(summaries[0].rssi_max, -41);
+    CHECK_EQ(summaries[0].rssi_mean, -51);                                  // -457 / 9 rounded
+    CHECK_EQ(summaries[0].first_us, 100 + 102400);
+    CHECK_EQ(summaries[0].last_us, t);
+    beacon_dedup_flush(&dedup, 2000000, collect_summary, NULL);             // Nothing suppressed since
+    CHECK_EQ(summary_count, 1);
+
+    t += 102400;                                                            // Changed element: summary first, then full beacon
+    CHECK(!observe(&dedup, frame, build_beacon(&ap, 10, t, frame, sizeof(frame)), -50, 6, t));
+    strcpy(ap.ssid, "renamed");
+    t += 102400;
+    CHECK(observe(&dedup, frame, build_beacon(&ap, 11, t, frame, sizeof(frame)), -50, 6, t));
+    CHECK_EQ(summary_count, 2);
+    CHECK_EQ(summaries[1].count, 1);
+    CHECK_EQ(summaries[1].ie_hash, summaries[0].ie_hash);
+    t += 102400;                                                            // Same beacon on another channel
+    CHECK(observe(&dedup, frame, build_beacon(&ap, 12, t, frame, sizeof(frame)), -50, 7, t));
+    t += 10000000;                                                          // Refresh interval over
+    CHECK(observe(&dedup, frame, build_beacon(&ap, 13, t, frame, sizeof(frame)), -50, 7, t));
+    t += 102400;
+    CHECK(!observe(&dedup, frame, build_beacon(&ap, 14, t, frame, sizeof(frame)), -50, 7, t));
+
+    size_t len = build_beacon(&ap, 15, t, frame, sizeof(frame));            // Not beacons: always passed
+    frame[0] = 0x50;
+    CHECK(observe(&dedup, frame, len, -50, 7, t));
+    len = mock_build_data(ap.bssid, ap.bssid, 1, 100, frame, sizeof(frame));
+    CHECK(observe(&dedup, frame, len, -50, 7, t));
+    CHECK(observe(&dedup, frame, 20, -50, 7, t));
+
+    beacon_dedup_init(&dedup, 1000, 0);                                     // Eviction reports what the entry held
+    summary_count = 0;
+    for (uint32_t i = 0; i < 200; i++) {
+        ap.bssid[4] = (uint8_t) (i >> 8);
+        ap.bssid[5] = (uint8_t) i;
+        t += 1000;
+        CHECK(observe(&dedup, frame, build_beacon(&ap, 0, t, frame, sizeof(frame)), -50, 7, t));
+        t += 1000;
+        CHECK(!observe(&dedup, frame, build_beacon(&ap, 1, t, frame, sizeof(frame)), -50, 7, t));
+    }
+    CHECK(dedup.evicted >= 200 - CONFIG_BEACON_DEDUP_CAPACITY);
+    CHECK_EQ(summary_count, dedup.evicted);
+    for (size_t i = 0; i < summary_count && i < 300; i++) {
+        CHECK_EQ(summaries[i].count, 1);
+    }
+
+    beacon_dedup_init(&dedup, 1000000, 0);                                  // Counter saturation emits a summary
+    summary_count = 0;
+    len = build_beacon(&ap, 0, 0, frame, sizeof(frame));
+    for (uint32_t i = 0; i <= UINT16_MAX; i++) {
+        observe(&dedup, frame, len, -50, 7, i);
+    }
+    CHECK_EQ(summary_count, 1);
+    CHECK_EQ(summaries[0].count, UINT16_MAX);
+}
+
+typedef struct {
+    uint8_t frame[320];
+    uint16_t len;
+    uint32_t timestamp;
+    int8_t rssi;
+    int8_t ap;                                                              // Beacon of this AP, -1 for other frames
+    bool covered;                                                           // Seen in full or in a summary
+} trace_frame_t;
+
+#define TRACE_APS 12
+#define TRACE_MAX 2000
+
+static trace_frame_t trace[TRACE_MAX];
+static size_t trace_len;
+static mock_ap_t trace_aps[TRACE_APS];
+
+/**
+ * @brief Four seconds of a site: beacons every 102.4 ms per AP, data frames with encrypted payloads and
+ *        probe requests in between, one AP renamed halfway. A data frame well after the last beacon
+ *        makes the export flush the remaining summaries.
+ **/
+static void build_trace(void) {
+    static const uint8_t station[6] = { 0x06, 0, 0, 0, 0, 1 };
+    trace_len = 0;
+    for (int a = 0; a < TRACE_APS; a++) {
+        trace_aps[a] = (mock_ap_t) { .bssid = { 0x02, 0, 0, 0, 1, (uint8_t) a }, .channel = 1,
+                                     .authmode = a % 3 == 0 ? WIFI_AUTH_OPEN : WIFI_AUTH_WPA2_PSK };
+        snprintf(trace_aps[a].ssid, sizeof(trace_aps[a].ssid), "site-%d", a);
+    }
+    uint16_t beacons[TRACE_APS] = { 0 };
+    for (uint32_t t = 1000; t < 4000000; t += 1000) {
+        for (int a = 0; a < TRACE_APS; a++) {
+            if ((t + a * 8000) % 102000 != 0) {
+                continue;
+            }
+            if (a == 3 && t > 2000000) {
+                strcpy(trace_aps[a].ssid, "site-3-renamed");
+            }
+            trace_frame_t *f = &trace[trace_len++];
+            *f = (trace_frame_t) { .timestamp = t + a, .rssi = (int8_t) (-40 - a - rng() % 8), .ap = (int8_t) a };
+            f->len = (uint16_t) build_beacon(&trace_aps[a], beacons[a]++, t, f->frame, sizeof(f->frame));
+        }
+        if (t % 7000 == 0) {
+            trace_frame_t *f = &trace[trace_len++];
+            *f = (trace_frame_t) { .timestamp = t + 500, .rssi = -60, .ap = -1 };
+            size_t payload = 40 + rng() % 200;
+            f->len = (uint16_t) mock_build_data(trace_aps[rng() % TRACE_APS].bssid, station, (uint16_t) t, payload,
+                                                f->frame, sizeof(f->frame));
+            for (size_t i = 24; i < f->len; i++) {
+                f->frame[i] = (uint8_t) rng();
+            }
+        }
+        if (t % 50000 == 0) {                                               // Probe request to broadcast
+            static const uint8_t probe[] = { 0x40, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x06, 0, 0, 0, 0, 2,
+                                             0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x10, 0, 0, 0, 1, 4, 0x02, 0x04, 0x0b, 0x16 };
+            trace_frame_t *f = &trace[trace_len++];
+            *f = (trace_frame_t) { .timestamp = t + 700, .rssi = -70, .ap = -1, .len = sizeof(probe) };
+            memcpy(f->frame, probe, sizeof(probe));
+        }
+    }
+    trace_frame_t *f = &trace[trace_len++];
+    *f = (trace_frame_t) { .timestamp = 6000000, .rssi = -60, .ap = -1 };
+    f->len = (uint16_t) mock_build_data(trace_aps[0].bssid, station, 0, 50, f->frame, sizeof(f->frame));
+}
+
+static uint32_t exported(void) {
+    wifictl_pcap_stats_t stats;
+    wifictl_pcap_export_get_stats(&stats);
+    return stats.records + stats.beacons_suppressed + stats.truncated;
+}
+
+/**
+ * @brief Marks the beacons a summary stands for. They must all be unreported so far.
+ **/
+static void account_summary(const beacon_summary_t *summary) {
+    uint32_t count = 0, again = 0;
+    int32_t rssi_sum = 0;
+    int8_t rssi_min = 127, rssi_max = -128;
+    for (size_t i = 0; i < trace_len; i++) {
+        trace_frame_t *f = &trace[i];
+        if (f->ap < 0 || memcmp(trace_aps[f->ap].bssid, summary->bssid, 6) != 0 ||
+            f->timestamp < summary->first_us || f->timestamp > summary->last_us) {
+            continue;
+        }
+        again += f->covered;
+        f->covered = true;
+        count++;
+        rssi_sum += f->rssi;
+        rssi_min = f->rssi < rssi_min ? f->rssi : rssi_min;
+        rssi_max = f->rssi > rssi_max ? f->rssi : rssi_max;
+    }
+    CHECK_EQ(again, 0);
+    CHECK_EQ(count, summary->count);
+    CHECK_EQ(rssi_min, summary->rssi_min);
+    CHECK_EQ(rssi_max, summary->rssi_max);
+    CHECK(count > 0 && abs(rssi_sum - summary->rssi_mean * (int32_t) count) <= (int32_t) count);
+}
+
+static void test_compact_stream(void) {
+    build_trace();
+    char *stream = NULL;
+    size_t stream_len = 0;
+    FILE *out = open_memstream(&stream, &stream_len);
+    host_uart_set_output(STREAM_PORT, out);
+    CHECK_EQ(wifictl_sniffer_start(1), ESP_OK);
+    CHECK_EQ(wifictl_pcap_export_start(STREAM_PORT, 2000000, true), ESP_OK);
+
+    for (size_t i = 0; i < trace_len; i++) {                                // Paced so the capture ring never overflows
+        const trace_frame_t *f = &trace[i];
+        CHECK(mock_radio_deliver_at(f->frame, f->len, f->ap >= 0 || f->frame[0] == 0x40 ? WIFI_PKT_MGMT : WIFI_PKT_DATA,
+                                    f->rssi, f->timestamp));
+        if (i % 8 == 7 || i == trace_len - 2) {
+            CHECK(WAIT_FOR(exported() == i + 1, 2000));
+        }
+    }
+    CHECK(WAIT_FOR(exported() == trace_len, 2000));
+    wifictl_pcap_stats_t stats;
+    wifictl_pcap_export_get_stats(&stats);
+    wifictl_pcap_export_stop();
+    wifictl_sniffer_stop();
+    host_uart_set_output(STREAM_PORT, NULL);
+    fclose(out);
+    CHECK_EQ(stream_len, stats.bytes);
+
+    const uint8_t *p = (const uint8_t *) stream, *end = p + stream_len;
+    uint32_t magic;
+    uint16_t dict_len;
+    memcpy(&magic, p, 4);
+    memcpy(&dict_len, p + 6, 2);
+    CHECK_EQ(magic, PCAP_EXPORT_COMPACT_MAGIC);
+    CHECK_EQ(p[4], PCAP_EXPORT_COMPACT_VERSION);
+    static uint8_t window[4096 + MOCK_RADIO_MAX_FRAME];
+    memcpy(window, p + 8, dict_len);
+    p += 8 + dict_len + 24;                                                 // Stream header, dictionary, PCAP global header
+
+    size_t next = 0, records = 0, compressed = 0, summary_records = 0, suppressed = 0, pcap_bytes = 0;
+    uint32_t last_seq = 0;
+    while (p + 4 <= end) {
+        uint8_t type = p[0];
+        uint16_t len;
+        memcpy(&len, p + 2, 2);
+        const uint8_t *body = p + 4;
+        p = body + len;
+        CHECK(p <= end);
+        if (p > end) {
+            break;
+        }
+        if (type == PCAP_COMPACT_BEACON_SUMMARY) {
+            beacon_summary_t summary;
+            CHECK_EQ(len, sizeof(summary));
+            memcpy(&summary, body, sizeof(summary));
+            account_summary(&summary);
+            summary_records++;
+            suppressed += summary.count;
+            continue;
+        }
+        uint32_t incl_len;
+        memcpy(&incl_len, body + 8, 4);
+        const uint8_t *record = body + PCAP_RECORD_LEN;
+        if (type == PCAP_COMPACT_RECORD_LZ4) {
+            long decoded = lz4_decode(record, len - PCAP_RECORD_LEN, window, dict_len, MOCK_RADIO_MAX_FRAME + RADIOTAP_LEN);
+            CHECK_EQ(decoded, incl_len);
+            record = &window[dict_len];
+            compressed++;
+        } else {
+            CHECK_EQ(type, PCAP_COMPACT_RECORD);
+            CHECK_EQ(len, PCAP_RECORD_LEN + incl_len);
+        }
+        records++;
+        pcap_bytes += PCAP_RECORD_LEN + incl_len;
+        uint32_t seq;
+        memcpy(&seq, record + RADIOTAP_SEQ_OFFSET, 4);
+        CHECK(records == 1 || seq > last_seq);
+        last_seq = seq;
+
+        while (next < trace_len && (trace[next].len + 4 != incl_len - RADIOTAP_LEN ||
+                                    memcmp(trace[next].frame, record + RADIOTAP_LEN, trace[next].len) != 0)) {
+            CHECK(trace[next].ap >= 0);                                     // Only beacons may be left out
+            next++;
+        }
+        CHECK(next < trace_len);
+        if (next == trace_len) {
+            break;
+        }
+        trace_frame_t *f = &trace[next++];
+        CHECK(!f->covered);
+        f->covered = true;
+        for (size_t i = 0; f->ap >= 0 && i < next; i++) {                  // Summaries of this BSSID came first
+            CHECK(trace[i].ap != f->ap || trace[i].covered);
+        }
+    }
+    CHECK(p == end);
+    for (size_t i = 0; i < trace_len; i++) {
+        CHECK(trace[i].covered);
+    }
+    CHECK_EQ(records, stats.records);
+    CHECK_EQ(compressed, stats.compressed);
+    CHECK_EQ(summary_records, stats.summaries);
+    CHECK_EQ(suppressed, stats.beacons_suppressed);
+    CHECK(suppressed > trace_len / 3);
+    CHECK(stats.pcap_bytes > pcap_bytes);
+    free(stream);
+}
+
+/**
+ * @brief Stops right after a burst, while the aggregate stage is still exporting. Everything written must be
+ *        counted by the time stop returns, the baud rate restored, and nothing may follow.
+ **/
+static void test_stop_during_batches(void) {
+    static const uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 9 }, station[6] = { 0x06, 0, 0, 0, 0, 9 };
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    uint32_t baud_rate = 0, restored = 0;
+    uart_get_baudrate(STREAM_PORT, &baud_rate);
+    host_uart_set_write_delay(STREAM_PORT, 500);                            // Batches take long enough to stop inside one
+    CHECK_EQ(wifictl_sniffer_start(1), ESP_OK);
+    for (int cycle = 0; cycle < 20; cycle++) {
+        char *stream = NULL;
+        size_t stream_len = 0;
+        FILE *out = open_memstream(&stream, &stream_len);
+        host_uart_set_output(STREAM_PORT, out);
+        CHECK_EQ(wifictl_pcap_export_start(STREAM_PORT, 2000000, cycle % 2 == 1), ESP_OK);
+        for (int i = 0; i < 64; i++) {                                      // Stop lands inside the first batch's write
+            size_t len = mock_build_data(bssid, station, (uint16_t) i, 200 + i * 8, frame, sizeof(frame));
+            mock_radio_deliver(frame, len, WIFI_PKT_DATA, -50);
+        }
+        vTaskDelay(1);
+        wifictl_pcap_export_stop();
+        wifictl_pcap_stats_t stats;
+        wifictl_pcap_export_get_stats(&stats);
+        fflush(out);
+        size_t at_stop = stream_len;
+        vTaskDelay(pdMS_TO_TICKS(5));                                       // Time for a straggling batch to write
+        host_uart_set_output(STREAM_PORT, NULL);
+        fclose(out);
+        CHECK_EQ(at_stop, stats.bytes);
+        CHECK_EQ(stream_len, at_stop);
+        uart_get_baudrate(STREAM_PORT, &restored);
+        CHECK_EQ(restored, baud_rate);
+        free(stream);
+    }
+    wifictl_sniffer_stop();
+    host_uart_set_write_delay(STREAM_PORT, 0);
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_codec_round_trip);
+    RUN_TEST(test_dedup_rules);
+    RUN_TEST(test_compact_stream);
+    RUN_TEST(test_stop_during_batches);
+    return TEST_RESULT();
+}
@@ -0,0 +1,429 @@
+/**
+ * @file test_pcap_replay.c
+ * @brief PCAP reader on hand-built files (byte orders, timestamp resolutions, radiotap fields, skipped
+ *        and truncated records), replay install rules, and a regression round trip: traffic captured
+ *        from the radio mock and exported as PCAP reaches the pipeline consumers with the same bytes
+ *        and metadata when the file is replayed, pass after pass. Pacing against the recorded timing.
+ */
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "driver/uart.h"
+#include "frame_pool.h"
+#include "pcap_export.h"
+#include "pcap_reader.h"
+#include "pcap_replay.h"
+#include "radio.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+#define STREAM_PORT UART_NUM_1
+#define TRACE_FRAMES 600
+#define TRACE_START_US 1000000
+#define TRACE_SPACING_US 5000
+#define PACED_FRAMES 21
+#define PACED_SPACING_US 25000
+
+typedef struct {
+    uint32_t hash;                                                          // FNV-1a of the frame, FCS included
+    uint16_t sig_len;
+    int8_t rssi;
+    int8_t noise;
+    uint8_t channel;
+    uint8_t rate;
+    uint32_t timestamp;
+} seen_frame_t;
+
+typedef struct {
+    seen_frame_t frames[2 * TRACE_FRAMES];
+    atomic_uint count;
+} seen_t;
+
+static const uint8_t station[6] = { 0x06, 0, 0, 0, 0, 1 };
+static const mock_ap_t trace_aps[] = {
+    { .bssid = { 0x02, 0, 0, 0, 0, 1 }, .ssid = "alpha", .channel = 6, .authmode = WIFI_AUTH_WPA2_PSK },
+    { .bssid = { 0x02, 0, 0, 0, 0, 2 }, .ssid = "bravo", .channel = 6, .authmode = WIFI_AUTH_OPEN },
+    { .bssid = { 0x02, 0, 0, 0, 0, 3 }, .ssid = "charlie-with-a-longer-name", .channel = 6, .authmode = WIFI_AUTH_WPA2_PSK },
+};
+
+static seen_t live, replayed;
+static seen_t *_Atomic recording = NULL;
+static char trace_path[64], paced_path[64], text_path[64];
+static uint32_t trace_data_frames;
+
+static uint32_t fnv1a(const uint8_t *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void record_handler(const wifictl_frame_t *const *frames, size_t count) {
+    seen_t *seen = atomic_load(&recording);
+    for (size_t i = 0; seen != NULL && i < count; i++) {
+        unsigned n = atomic_load(&seen->count);
+        if (n < 2 * TRACE_FRAMES) {
+            const wifi_pkt_rx_ctrl_t *rx = &frames[i]->pkt.rx_ctrl;
+            seen->frames[n] = (seen_frame_t) {
+                .hash = fnv1a(frames[i]->pkt.payload, rx->sig_len), .sig_len = rx->sig_len, .rssi = rx->rssi,
+                .noise = rx->noise_floor, .channel = rx->channel, .rate = rx->rate, .timestamp = rx->timestamp
+            };
+        }
+        atomic_store(&seen->count, n + 1);
+    }
+}
+
+static void start_recording(seen_t *seen) {
+    atomic_store(&seen->count, 0);
+    atomic_store(&recording, seen);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Hand-built files
+
+static void put32(FILE *file, bool big_endian, uint32_t value) {
+    uint8_t b[4] = { value, value >> 8, value >> 16, value >> 24 };
+    if (big_endian) {
+        b[0] = value >> 24, b[1] = value >> 16, b[2] = value >> 8, b[3] = value;
+    }
+    fwrite(b, 1, 4, file);
+}
+
+static FILE *create_pcap(const char *path, uint32_t magic, uint32_t linktype, bool big_endian) {
+    FILE *file = fopen(path, "wb");
+    put32(file, big_endian, magic);
+    put32(file, big_endian, big_endian ? 0x00020004 : 0x00040002);          // Version 2.4 as two 16-bit fields
+    put32(file, big_endian, 0);
+    put32(file, big_endian, 0);
+    put32(file, big_endian, 65535);
+    put32(file, big_endian, linktype);
+    return file;
+}
+
+static void put_record(FILE *file, bool big_endian, uint32_t seconds, uint32_t fraction, const void *head,
+                       uint32_t head_len, const void *data, uint32_t len) {
+    put32(file, big_endian, seconds);
+    put32(file, big_endian, fraction);
+    put32(file, big_endian, head_len + len);
+    put32(file, big_endian, head_len + len);
+    fwrite(head, 1, head_len, file);
+    fwrite(data, 1, len, file);
+}
+
+static FILE *open_reader(pcap_reader_t *reader, const char *path) {
+    FILE *file = fopen(path, "rb");
+    CHECK(file != NULL);
+    CHECK(file != NULL && pcap_reader_open(reader, file));
+    return file;
+}
+
+static void test_reader_byte_orders_and_resolutions(void) {
+    static const uint32_t seconds[] = { 1, 2, 3 }, micros[] = { 1, 500000, 999 };
+    uint8_t frames[3][80];
+    size_t lens[3];
+    for (int i = 0; i < 3; i++) {
+        lens[i] = i == 0 ? mock_build_beacon(&trace_aps[i], 7, frames[i], sizeof(frames[i]))
+                         : mock_build_data(trace_aps[i].bssid, station, 7, 20 * i, frames[i], sizeof(frames[i]));
+    }
+    for (int variant = 0; variant < 4; variant++) {
+        bool big_endian = variant & 1, nanoseconds = variant & 2;
+        FILE *file = create_pcap(paced_path, nanoseconds ? 0xa1b23c4d : 0xa1b2c3d4, 105, big_endian);
+        for (int i = 0; i < 3; i++) {
+            put_record(file, big_endian, seconds[i], nanoseconds ? micros[i] * 1000 + 999 : micros[i], NULL, 0,
+                       frames[i], (uint32_t) lens[i]);
+        }
+        fclose(file);
+
+        pcap_reader_t reader;
+        pcap_reader_frame_t frame;
+        file = open_reader(&reader, paced_path);
+        CHECK_EQ(reader.swapped, big_endian);
+        CHECK_EQ(reader.nanoseconds, nanoseconds);
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < 3; i++) {
+                CHECK_EQ(pcap_reader_next(&reader, &frame), PCAP_READER_FRAME);
+                CHECK_EQ(frame.timestamp_us, seconds[i] * 1000000ULL + micros[i]);
+                CHECK_EQ(frame.len, lens[i]);
+                CHECK(memcmp(frame.data, frames[i], lens[i]) == 0);
+                CHECK(!frame.has_fcs && frame.channel == 0 && frame.rssi == 0 && !frame.ht);
+            }
+            CHECK_EQ(pcap_reader_next(&reader, &frame), PCAP_READER_END);
+            CHECK(pcap_reader_rewind(&reader));
+        }
+        CHECK_EQ(reader.records, 6);
+        CHECK_EQ(reader.skipped, 0);
+        fclose(file);
+    }
+}
+
+static void test_reader_radiotap_and_skips(void) {
+    uint8_t frame[64];
+    size_t len = mock_build_data(trace_aps[0].bssid, station, 9, 30, frame, sizeof(frame) - 4);
+    memset(frame + len, 0xab, 4);                                           // FCS
+
+    static const uint8_t legacy[] = {                                       // Flags, rate, channel, signal, noise
+        0, 0, 16, 0, 0x6e, 0, 0, 0,
+        0x12, 22, 0x85, 0x09, 0xa0, 0x00, (uint8_t) -61, (uint8_t) -93,
+    };
+    static const uint8_t ht[] = {                                           // TSFT, flags, MCS, one more presence word
+        0, 0, 28, 0, 0x03, 0, 0x08, 0x80, 0x00, 0x00, 0x00, 0x40, 0, 0, 0, 0,
+        1, 2, 3, 4, 5, 6, 7, 8, 0x00, 0x02, 0x05, 7,
+    };
+    static const uint8_t bad_version[] = { 1, 0, 8, 0, 0, 0, 0, 0 };
+    static const uint8_t bare[] = { 0, 0, 8, 0, 0, 0, 0, 0 };
+    static uint8_t huge[PCAP_READER_MAX_RECORD + 1];
+
+    FILE *file = create_pcap(paced_path, 0xa1b2c3d4, 127, false);
+    put_record(file, false, 10, 1, legacy, sizeof(legacy), frame, (uint32_t) len + 4);
+    put_record(file, false, 10, 2, ht, sizeof(ht), frame, (uint32_t) len);
+    put_record(file, false, 10, 3, bad_version, sizeof(bad_version), frame, (uint32_t) len);
+    put_record(file, false, 10, 4, bare, sizeof(bare), frame, 9);          // Shorter than any frame
+    put_record(file, false, 10, 5, bare, sizeof(bare), huge, sizeof(huge));
+    put_record(file, false, 10, 6, bare, sizeof(bare), frame, (uint32_t) len);
+    put32(file, false, 10);                                                 // Truncated record header
+    put32(file, false, 7);
+    fclose(file);
+
+    pcap_reader_t reader;
+    pcap_reader_frame_t out;
+    file = open_reader(&reader, paced_path);
+    CHECK_EQ(pcap_reader_next(&reader, &out), PCAP_READER_FRAME);
+    CHECK(out.has_fcs && out.short_preamble && !out.ht);
+    CHECK_EQ(out.len, len + 4);
+    CHECK(memcmp(out.data, frame, len + 4) == 0);
+    CHECK_EQ(out.rate, 22);
+    CHECK_EQ(out.channel, 6);
+    CHECK_EQ(out.rssi, -61);
+    CHECK_EQ(out.noise, -93);
+
+    CHECK_EQ(pcap_reader_next(&reader, &out), PCAP_READER_FRAME);
+    CHECK(out.ht && out.cwb && out.sgi && !out.has_fcs);
+    CHECK_EQ(out.mcs, 7);
+    CHECK_EQ(out.rate, 0);
+    CHECK_EQ(out.len, len);
+    CHECK(memcmp(out.data, frame, len) == 0);
+
+    CHECK_EQ(pcap_reader_next(&reader, &out), PCAP_READER_FRAME);          // Three records skipped on the way
+    CHECK_EQ(out.timestamp_us, 10000006);
+    CHECK_EQ(reader.skipped, 3);
+    CHECK_EQ(pcap_reader_next(&reader, &out), PCAP_READER_ERROR);
+    CHECK_EQ(reader.records, 6);
+    fclose(file);
+}
+
+static void test_reader_rejects_other_files(void) {
+    pcap_reader_t reader;
+    FILE *file = create_pcap(paced_path, 0xa1b2c3d4, 1, false);             // Ethernet
+    fclose(file);
+    file = fopen(paced_path, "rb");
+    CHECK(!pcap_reader_open(&reader, file));
+    fclose(file);
+    file = fopen(text_path, "rb");
+    CHECK(!pcap_reader_open(&reader, file));
+    fclose(file);
+    file = create_pcap(paced_path, 0xa1b2c3d4, 105, false);
+    fclose(file);
+    CHECK_EQ(truncate(paced_path, 20), 0);
+    file = fopen(paced_path, "rb");
+    CHECK(!pcap_reader_open(&reader, file));
+    fclose(file);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Replay
+
+static void test_install_rules(void) {
+    const wifictl_radio_ops_t *radio = wifictl_radio();
+    CHECK_EQ(wifictl_replay_install("/nonexistent/trace.pcap", 100, 1), ESP_ERR_NOT_FOUND);
+    CHECK_EQ(wifictl_replay_install(text_path, 100, 1), ESP_ERR_INVALID_ARG);
+    CHECK(wifictl_radio() == radio);
+
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);                             // On the radio
+    CHECK_EQ(wifictl_replay_install(trace_path, 100, 1), ESP_ERR_INVALID_STATE);
+    wifictl_sniffer_stop();
+
+    CHECK_EQ(wifictl_replay_install(trace_path, 100, 1), ESP_OK);
+    CHECK(wifictl_radio() != radio);
+    CHECK_EQ(wifictl_replay_install(trace_path, 100, 1), ESP_ERR_INVALID_STATE);
+    wifictl_replay_stats_t stats;
+    wifictl_replay_get_stats(&stats);
+    CHECK(stats.installed && !stats.running && stats.frames == 0);
+    wifictl_replay_uninstall();
+    CHECK(wifictl_radio() == radio);
+    wifictl_replay_get_stats(&stats);
+    CHECK(!stats.installed);
+}
+
+static uint32_t exported(void) {
+    wifictl_pcap_stats_t stats;
+    wifictl_pcap_export_get_stats(&stats);
+    return stats.records;
+}
+
+static bool pool_idle(void) {                                               // Fan-out consumers released every frame
+    frame_pool_stats_t pool;
+    frame_pool_get_stats(&pool);
+    for (int c = 0; c < FRAME_POOL_CLASS_COUNT; c++) {
+        if (pool.classes[c].in_use != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Captures the trace from the radio mock into `live` while exporting it to trace_path.
+ **/
+static void record_trace(void) {
+    char *stream = NULL;
+    size_t stream_len = 0;
+    FILE *out = open_memstream(&stream, &stream_len);
+    host_uart_set_output(STREAM_PORT, out);
+    start_recording(&live);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    CHECK_EQ(wifictl_pcap_export_start(STREAM_PORT, 2000000, false), ESP_OK);
+
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    trace_data_frames = 0;
+    for (uint32_t i = 0; i < TRACE_FRAMES; i++) {                           // Paced so neither the ring nor the pool overflows
+        bool beacon = i % 3 == 0;
+        const mock_ap_t *ap = &trace_aps[i % 4 % 3];
+        size_t len = beacon ? mock_build_beacon(ap, (uint16_t) i, frame, sizeof(frame))
+                            : mock_build_data(ap->bssid, station, (uint16_t) i, (i * 37) % 1400, frame, sizeof(frame));
+        trace_data_frames += !beacon;
+        CHECK(mock_radio_deliver_at(frame, len, beacon ? WIFI_PKT_MGMT : WIFI_PKT_DATA, (int8_t) (-30 - (int) (i % 61)),
+                                    TRACE_START_US + i * TRACE_SPACING_US));
+        if (i % 8 == 7) {
+            CHECK(WAIT_FOR(exported() == i + 1 && atomic_load(&live.count) == i + 1 && pool_idle(), 2000));
+        }
+    }
+    CHECK(WAIT_FOR(exported() == TRACE_FRAMES && atomic_load(&live.count) == TRACE_FRAMES, 2000));
+    wifictl_pcap_export_stop();
+    wifictl_sniffer_stop();
+    atomic_store(&recording, NULL);
+    host_uart_set_output(STREAM_PORT, NULL);
+    fclose(out);
+
+    FILE *file = fopen(trace_path, "wb");
+    CHECK_EQ(fwrite(stream, 1, stream_len, file), stream_len);
+    fclose(file);
+    free(stream);
+}
+
+/**
+ * @brief Replays trace_path with `loops` passes into `replayed` and waits for the end.
+ **/
+static wifictl_replay_stats_t replay(uint32_t speed_percent, uint32_t loops, uint32_t expected_frames) {
+    wifictl_replay_stats_t stats = { 0 };
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    start_recording(&replayed);
+    CHECK_EQ(wifictl_replay_install(trace_path, speed_percent, loops), ESP_OK);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    CHECK(WAIT_FOR((wifictl_replay_get_stats(&stats), stats.finished), 10000));
+    CHECK(WAIT_FOR(atomic_load(&replayed.count) == expected_frames, 2000));
+    wifictl_sniffer_stop();
+    wifictl_replay_uninstall();
+    atomic_store(&recording, NULL);
+    wifictl_sniffer_get_stats(&after);
+    CHECK_EQ(after.dropped, before.dropped);
+    return stats;
+}
+
+static void test_replay_matches_live_capture(void) {
+    record_trace();
+    CHECK_EQ(atomic_load(&live.count), TRACE_FRAMES);
+
+    wifictl_replay_stats_t stats = replay(1000, 2, 2 * TRACE_FRAMES);       // 3 s of traffic per pass
+    CHECK_EQ(stats.frames, 2 * TRACE_FRAMES);
+    CHECK_EQ(stats.loops, 2);
+    CHECK_EQ(stats.skipped + stats.masked + stats.errors, 0);
+    CHECK_EQ(atomic_load(&replayed.count), 2 * TRACE_FRAMES);
+
+    uint32_t span = (TRACE_FRAMES - 1) * TRACE_SPACING_US, mismatches = 0;
+    for (uint32_t i = 0; i < 2 * TRACE_FRAMES; i++) {
+        const seen_frame_t *l = &live.frames[i % TRACE_FRAMES], *r = &replayed.frames[i];
+        uint32_t timestamp = l->timestamp - TRACE_START_US + (i < TRACE_FRAMES ? 0 : span + 1);  // Passes follow each other
+        mismatches += l->hash != r->hash || l->sig_len != r->sig_len || l->rssi != r->rssi || l->noise != r->noise ||
+                      l->channel != r->channel || l->rate != r->rate || r->timestamp != timestamp;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_replay_respects_promiscuous_filter(void) {
+    wifictl_replay_stats_t stats = { 0 };
+    start_recording(&replayed);
+    CHECK_EQ(wifictl_replay_install(trace_path, 1000, 1), ESP_OK);
+    wifictl_sniffer_filter_frame_types(false, true, true);                  // Goes to the replay operations
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    CHECK(WAIT_FOR((wifictl_replay_get_stats(&stats), stats.finished), 10000));
+    CHECK(WAIT_FOR(atomic_load(&replayed.count) == TRACE_FRAMES - trace_data_frames, 2000));
+    wifictl_sniffer_stop();
+    wifictl_replay_uninstall();
+    atomic_store(&recording, NULL);
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK_EQ(stats.masked, trace_data_frames);
+    CHECK_EQ(stats.frames, TRACE_FRAMES - trace_data_frames);
+}
+
+static void test_pacing(void) {
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    size_t len = mock_build_beacon(&trace_aps[0], 1, frame, sizeof(frame));
+    FILE *file = create_pcap(paced_path, 0xa1b2c3d4, 105, false);
+    for (uint32_t i = 0; i < PACED_FRAMES; i++) {
+        uint64_t at = 5000000 + (uint64_t) i * PACED_SPACING_US;
+        put_record(file, false, (uint32_t) (at / 1000000), (uint32_t) (at % 1000000), NULL, 0, frame, (uint32_t) len);
+    }
+    fclose(file);
+
+    static const uint32_t speeds[] = { 100, 250, PCAP_REPLAY_MAX_SPEED };
+    const uint32_t recorded_ms = (PACED_FRAMES - 1) * PACED_SPACING_US / 1000;
+    for (size_t s = 0; s < sizeof(speeds) / sizeof(speeds[0]); s++) {
+        wifictl_replay_stats_t stats = { 0 };
+        CHECK_EQ(wifictl_replay_install(paced_path, speeds[s], 1), ESP_OK);
+        CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+        CHECK(WAIT_FOR((wifictl_replay_get_stats(&stats), stats.finished), 5000));
+        wifictl_sniffer_stop();
+        wifictl_replay_uninstall();
+        CHECK_EQ(stats.frames, PACED_FRAMES);
+        if (speeds[s] == PCAP_REPLAY_MAX_SPEED) {
+            CHECK(stats.elapsed_ms < recorded_ms / 10);
+            continue;
+        }
+        uint32_t expected_ms = recorded_ms * 100 / speeds[s];
+        CHECK(stats.elapsed_ms + 1 >= expected_ms);                         // Up to one tick early
+        CHECK(stats.elapsed_ms <= expected_ms + 50);
+        CHECK(stats.late_max_us < 20000);
+    }
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, record_handler));
+    pid_t pid = getpid();
+    snprintf(trace_path, sizeof(trace_path), "/tmp/replay_trace_%d.pcap", (int) pid);
+    snprintf(paced_path, sizeof(paced_path), "/tmp/replay_paced_%d.pcap", (int) pid);
+    snprintf(text_path, sizeof(text_path), "/tmp/replay_text_%d.txt", (int) pid);
+    FILE *text = fopen(text_path, "w");
+    fputs("not a capture, but long enough to hold a PCAP global header\n", text);
+    fclose(text);
+
+    RUN_TEST(test_reader_byte_orders_and_resolutions);
+    RUN_TEST(test_reader_radiotap_and_skips);
+    RUN_TEST(test_reader_rejects_other_files);
+    RUN_TEST(test_replay_matches_live_capture);
+    RUN_TEST(test_install_rules);
+    RUN_TEST(test_replay_respects_promiscuous_filter);
+    RUN_TEST(test_pacing);
+
+    unlink(trace_path);
+    unlink(paced_path);
+    unlink(text_path);
+    return TEST_RESULT();
+}
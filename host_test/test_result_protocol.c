@@ -0,0 +1,127 @@
+/**
+ * @file test_result_protocol.c
+ * @brief Result record framing: frames decode back through a reference COBS decoder to the header, body
+ *        and CRC, for bodies without zeros, all zeros, non-zero runs around the 254-byte COBS block and
+ *        random bodies up to RESULT_MAX_BODY, which must fit RESULT_MAX_FRAME; oversize bodies and short
+ *        buffers are refused, and the CRC matches zlib's crc32.
+ */
+#include <string.h>
+
+#include "host_test.h"
+
+#include "result_protocol.h"
+
+static uint32_t rng_state = 5;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+/**
+ * @brief Reference COBS decoder for the bytes between the delimiters.
+ * @return Decoded length, -1 if a code points past the end or a zero appears inside.
+ **/
+static long cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t i = 0, n = 0;
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) {
+            return -1;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            if (in[i] == 0) {
+                return -1;
+            }
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < len) {                                      // A shorter run ended at a zero
+            out[n++] = 0;
+        }
+    }
+    return (long) n;
+}
+
+/**
+ * @brief Encodes body, checks the frame's shape and decodes it back.
+ **/
+static void round_trip(uint8_t type, const uint8_t *body, size_t len) {
+    uint8_t frame[RESULT_MAX_FRAME], payload[RESULT_MAX_FRAME];
+    size_t n = result_frame_encode(type, body, len, frame, sizeof(frame));
+    CHECK(n > 0 && n <= RESULT_MAX_FRAME);
+    if (n == 0) {
+        return;
+    }
+    CHECK_EQ(frame[0], 0);
+    CHECK_EQ(frame[n - 1], 0);
+    CHECK(memchr(frame + 1, 0, n - 2) == NULL);                             // Delimiters are the only zeros
+    CHECK(n <= 2 + 4 + len + 4 + 1 + (4 + len + 4) / 254);                  // One code byte per started 254-byte block
+
+    long decoded = cobs_decode(frame + 1, n - 2, payload);
+    CHECK_EQ(decoded, (long) (4 + len + 4));
+    if (decoded != (long) (4 + len + 4)) {
+        return;
+    }
+    CHECK_EQ(payload[0], type);
+    CHECK_EQ(payload[1], RESULT_PROTOCOL_VERSION);
+    CHECK_EQ(payload[2] | payload[3] << 8, len);
+    CHECK(memcmp(payload + 4, body, len) == 0);
+    uint32_t crc = payload[4 + len] | payload[5 + len] << 8 | payload[6 + len] << 16 | (uint32_t) payload[7 + len] << 24;
+    CHECK_EQ(crc, result_crc32(payload, 4 + len));
+}
+
+static void test_crc_matches_zlib(void) {
+    static const uint8_t check[] = "123456789";
+    CHECK_EQ(result_crc32(check, 9), 0xCBF43926u);                          // zlib.crc32(b"123456789")
+    CHECK_EQ(result_crc32(NULL, 0), 0);
+    static const uint8_t fox[] = "The quick brown fox jumps over the lazy dog";
+    CHECK_EQ(result_crc32(fox, sizeof(fox) - 1), 0x414FA339u);
+}
+
+static void test_round_trips(void) {
+    static uint8_t body[RESULT_MAX_BODY];
+    round_trip(RESULT_LIST_END, NULL, 0);
+
+    for (size_t i = 0; i < sizeof(body); i++) {                             // No zeros
+        body[i] = (uint8_t) (1 + i % 255);
+    }
+    round_trip(RESULT_AP, body, 59);
+    memset(body, 0, sizeof(body));                                          // All zeros
+    round_trip(RESULT_STATION, body, RESULT_MAX_BODY);
+    round_trip(RESULT_STATION, body, 1);
+
+    memset(body, 0xA5, sizeof(body));                                       // Non-zero runs at the COBS block size
+    for (size_t len = 245; len <= RESULT_MAX_BODY; len++) {
+        round_trip(RESULT_CHANNEL, body, len);
+    }
+    body[0] = 0;                                                            // Runs of exactly 254 and 255 after a zero
+    round_trip(RESULT_CHANNEL, body, 1 + 254);
+    body[RESULT_MAX_BODY - 1] = 0;
+    round_trip(RESULT_CHANNEL, body, RESULT_MAX_BODY);
+
+    for (int trial = 0; trial < 2000; trial++) {                            // Random bodies, sparse and dense zeros
+        size_t len = rng() % (RESULT_MAX_BODY + 1);
+        uint32_t zero_every = 1 + rng() % 300;
+        for (size_t i = 0; i < len; i++) {
+            body[i] = rng() % zero_every == 0 ? 0 : (uint8_t) (1 + rng() % 255);
+        }
+        round_trip((uint8_t) (1 + rng() % RESULT_SCAN_DELTA), body, len);
+    }
+}
+
+static void test_max_body_fits(void) {
+    static uint8_t body[RESULT_MAX_BODY + 1];
+    uint8_t frame[RESULT_MAX_FRAME + 16];
+    memset(body, 0xFF, sizeof(body));
+    size_t n = result_frame_encode(RESULT_AP, body, RESULT_MAX_BODY, frame, RESULT_MAX_FRAME);
+    CHECK(n > 0 && n <= RESULT_MAX_FRAME);
+    CHECK_EQ(result_frame_encode(RESULT_AP, body, RESULT_MAX_BODY + 1, frame, sizeof(frame)), 0);  // Oversize
+    CHECK_EQ(result_frame_encode(RESULT_AP, body, 1, frame, RESULT_MAX_FRAME - 1), 0);  // Short buffer
+}
+
+int main(void) {
+    RUN_TEST(test_crc_matches_zlib);
+    RUN_TEST(test_round_trips);
+    RUN_TEST(test_max_body_fits);
+    return TEST_RESULT();
+}
@@ -0,0 +1,421 @@
+/**
+ * @file test_scan_delta.c
+ * @brief Scan deltas over sequences of synthetic scan rounds: new, changed and gone APs with hysteresis
+ *        and miss limits, channel subsets, a full tracker and truncated event lists, a long random
+ *        site whose events replayed onto a mirror must always match what the rounds showed, and the
+ *        background scan monitor against the radio mock, including stops racing the start of a round.
+ */
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "ap_scanner.h"
+#include "scan_delta.h"
+#include "scan_monitor.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+#define SITE_APS 48
+#define SITE_ROUNDS 20000
+
+static uint32_t rng_state = 17;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static scan_delta_ap_t ap(uint8_t id, uint8_t channel, uint8_t authmode, int8_t rssi) {
+    return (scan_delta_ap_t) { .bssid = { 0x02, 0, 0, 0, 0, id }, .channel = channel, .authmode = authmode, .rssi = rssi };
+}
+
+static size_t update(scan_delta_t *delta, const scan_delta_ap_t *aps, size_t count, scan_delta_event_t *events) {
+    return scan_delta_update(delta, aps, count, NULL, 0, events, CONFIG_SCAN_DELTA_CAPACITY);
+}
+
+static void test_new_changed_and_silence(void) {
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_init(&delta, 6, 2);
+    scan_delta_ap_t aps[3] = { ap(1, 1, 3, -40), ap(2, 6, 0, -70), ap(3, 11, 4, -55) };
+    CHECK_EQ(update(&delta, aps, 3, events), 3);                            // First round: everything is new
+    for (int i = 0; i < 3; i++) {
+        CHECK_EQ(events[i].kind, SCAN_DELTA_NEW);
+        CHECK(memcmp(&events[i].ap, &aps[i], sizeof(aps[i])) == 0);
+    }
+    CHECK_EQ(scan_delta_count(&delta), 3);
+    CHECK_EQ(update(&delta, aps, 3, events), 0);                            // Same round again: silence
+
+    aps[0].rssi = -45;                                                      // Jitter below the threshold
+    aps[1].rssi = -65;
+    CHECK_EQ(update(&delta, aps, 3, events), 0);
+    aps[0].rssi = -46;                                                      // 6 dB from the reported -40
+    CHECK_EQ(update(&delta, aps, 3, events), 1);
+    CHECK_EQ(events[0].kind, SCAN_DELTA_CHANGED);
+    CHECK_EQ(events[0].changed, SCAN_DELTA_RSSI);
+    CHECK_EQ(events[0].ap.rssi, -46);
+    CHECK_EQ(events[0].previous_rssi, -40);
+
+    aps[2].channel = 9;                                                     // Channel and auth at once
+    aps[2].authmode = 3;
+    CHECK_EQ(update(&delta, aps, 3, events), 1);
+    CHECK_EQ(events[0].changed, SCAN_DELTA_CHANNEL | SCAN_DELTA_AUTH);
+    CHECK_EQ(events[0].previous_channel, 11);
+    CHECK_EQ(events[0].previous_authmode, 4);
+    CHECK_EQ(events[0].previous_rssi, -55);
+    CHECK_EQ(update(&delta, aps, 3, events), 0);
+    CHECK_EQ(delta.rounds, 6);
+}
+
+static void test_slow_drift_reports_once(void) {
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_init(&delta, 6, 2);
+    scan_delta_ap_t a = ap(1, 6, 3, -50);
+    update(&delta, &a, 1, events);
+    size_t reports = 0;
+    for (int step = 1; step <= 30; step++) {                                // 1 dB per round: reported every 6 rounds
+        a.rssi = (int8_t) (-50 - step);
+        size_t n = update(&delta, &a, 1, events);
+        if (n > 0) {
+            CHECK_EQ(step % 6, 0);
+            CHECK_EQ(events[0].previous_rssi, -50 - (step - 6));
+            reports++;
+        }
+    }
+    CHECK_EQ(reports, 5);
+
+    scan_delta_init(&delta, 0, 0);                                          // Clamped to 1 dB and one round
+    update(&delta, &a, 1, events);
+    a.rssi++;
+    CHECK_EQ(update(&delta, &a, 1, events), 1);
+    CHECK_EQ(update(&delta, NULL, 0, events), 1);
+    CHECK_EQ(events[0].kind, SCAN_DELTA_GONE);
+}
+
+static void test_gone_after_misses(void) {
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_init(&delta, 6, 3);
+    scan_delta_ap_t aps[3] = { ap(1, 1, 3, -40), ap(2, 6, 0, -70), ap(3, 11, 4, -55) };
+    update(&delta, aps, 3, events);
+    CHECK_EQ(update(&delta, aps, 2, events), 0);                            // AP 3 missing once, twice
+    CHECK_EQ(update(&delta, aps, 2, events), 0);
+    CHECK_EQ(update(&delta, aps, 3, events), 0);                            // Back: misses start over
+    CHECK_EQ(update(&delta, aps, 2, events), 0);
+    CHECK_EQ(update(&delta, aps, 2, events), 0);
+    aps[0].rssi = -20;
+    CHECK_EQ(update(&delta, aps, 2, events), 2);                            // Third miss; gone comes last
+    CHECK_EQ(events[0].kind, SCAN_DELTA_CHANGED);
+    CHECK_EQ(events[1].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(events[1].ap.bssid[5], 3);
+    CHECK_EQ(events[1].ap.rssi, -55);                                       // Last reported state
+    CHECK_EQ(scan_delta_count(&delta), 2);
+    CHECK_EQ(update(&delta, aps, 2, events), 0);                            // Gone is reported once
+    CHECK_EQ(update(&delta, aps, 3, events), 1);                            // Then new again
+    CHECK_EQ(events[0].kind, SCAN_DELTA_NEW);
+}
+
+static void test_channel_subset(void) {
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_init(&delta, 6, 1);
+    scan_delta_ap_t aps[3] = { ap(1, 1, 3, -40), ap(2, 6, 0, -70), ap(3, 11, 4, -55) };
+    update(&delta, aps, 3, events);
+    static const uint8_t only_one[] = { 1 }, six_eleven[] = { 6, 11 };
+    for (int i = 0; i < 5; i++) {                                           // Rounds of channel 1 do not miss the others
+        CHECK_EQ(scan_delta_update(&delta, aps, 1, only_one, 1, events, CONFIG_SCAN_DELTA_CAPACITY), 0);
+    }
+    CHECK_EQ(scan_delta_count(&delta), 3);
+    CHECK_EQ(scan_delta_update(&delta, &aps[2], 1, six_eleven, 2, events, CONFIG_SCAN_DELTA_CAPACITY), 1);
+    CHECK_EQ(events[0].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(events[0].ap.bssid[5], 2);
+
+    aps[2].channel = 3;                                                     // Moved out of the scanned channels
+    CHECK_EQ(scan_delta_update(&delta, aps, 1, six_eleven, 2, events, CONFIG_SCAN_DELTA_CAPACITY), 1);
+    CHECK_EQ(events[0].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(events[0].ap.channel, 11);
+}
+
+static void test_full_tracker_and_truncation(void) {
+    static scan_delta_ap_t aps[CONFIG_SCAN_DELTA_CAPACITY + 8];
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_init(&delta, 6, 1);
+    for (int i = 0; i < CONFIG_SCAN_DELTA_CAPACITY + 8; i++) {
+        aps[i] = ap((uint8_t) i, (uint8_t) (1 + i % 13), 3, -60);
+    }
+    CHECK_EQ(update(&delta, aps, CONFIG_SCAN_DELTA_CAPACITY + 8, events), CONFIG_SCAN_DELTA_CAPACITY);
+    CHECK_EQ(delta.untracked, 8);
+    CHECK_EQ(update(&delta, aps, CONFIG_SCAN_DELTA_CAPACITY + 8, events), 0);
+    CHECK_EQ(delta.untracked, 16);
+    CHECK_EQ(update(&delta, &aps[1], CONFIG_SCAN_DELTA_CAPACITY + 7, events), 1);  // AP 0 gone frees a slot
+    CHECK_EQ(events[0].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(events[0].ap.bssid[5], 0);
+    CHECK_EQ(delta.untracked, 24);
+    CHECK_EQ(update(&delta, &aps[1], CONFIG_SCAN_DELTA_CAPACITY + 7, events), 1);  // Taken by AP 64 next round
+    CHECK_EQ(events[0].kind, SCAN_DELTA_NEW);
+    CHECK_EQ(events[0].ap.bssid[5], CONFIG_SCAN_DELTA_CAPACITY);
+    CHECK_EQ(delta.untracked, 31);
+
+    scan_delta_init(&delta, 6, 1);                                          // Events that do not fit come next round
+    CHECK_EQ(scan_delta_update(&delta, aps, 10, NULL, 0, events, 4), 4);
+    CHECK_EQ(scan_delta_count(&delta), 4);
+    CHECK_EQ(scan_delta_update(&delta, aps, 10, NULL, 0, events, 4), 4);
+    CHECK_EQ(events[0].ap.bssid[5], 4);
+    CHECK_EQ(scan_delta_update(&delta, aps, 10, NULL, 0, events, 4), 2);
+    CHECK_EQ(scan_delta_update(&delta, aps, 10, NULL, 0, events, 4), 0);
+    for (int i = 0; i < 6; i++) {
+        aps[i].rssi = -30;
+    }
+    CHECK_EQ(scan_delta_update(&delta, &aps[2], 8, NULL, 0, events, 3), 3); // Changes of APs 2-5, gone 0 and 1
+    CHECK_EQ(scan_delta_update(&delta, &aps[2], 8, NULL, 0, events, 3), 3);
+    CHECK_EQ(events[0].kind, SCAN_DELTA_CHANGED);
+    CHECK_EQ(events[0].ap.bssid[5], 5);
+    CHECK_EQ(events[1].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(events[2].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(scan_delta_update(&delta, &aps[2], 8, NULL, 0, events, 3), 0);
+    CHECK_EQ(scan_delta_count(&delta), 8);
+}
+
+typedef struct {
+    scan_delta_ap_t ap;
+    bool present;                                                           // In range this round
+    bool reported;                                                          // Known to the mirror
+    scan_delta_ap_t mirror;                                                 // State rebuilt from the events
+    uint8_t misses;                                                         // Consecutive covered rounds absent
+} site_ap_t;
+
+/**
+ * @brief Random site: APs come and go, RSSI jitters and drifts, channels and auth modes change now and then.
+ *        Every round's events are applied to a mirror that must then agree with the round within hysteresis.
+ */
+static void test_random_site_sequence(void) {
+    static const uint8_t subset[] = { 1, 6, 11 };
+    const uint8_t hysteresis = 6, miss_limit = 2;
+    static site_ap_t site[SITE_APS];
+    scan_delta_t delta;
+    scan_delta_event_t events[CONFIG_SCAN_DELTA_CAPACITY];
+    scan_delta_ap_t round[SITE_APS];
+    scan_delta_init(&delta, hysteresis, miss_limit);
+    for (int i = 0; i < SITE_APS; i++) {
+        site[i] = (site_ap_t) { .ap = ap((uint8_t) i, (uint8_t) (1 + i % 13), (uint8_t) (i % 5), (int8_t) -(40 + i)) };
+    }
+    uint32_t errors = 0, total_events = 0, total_listed = 0, silent_rounds = 0;
+    for (uint32_t r = 0; r < SITE_ROUNDS; r++) {
+        bool partial = r % 2 == 1;                                          // Every other round scans channels 1, 6 and 11
+        size_t count = 0;
+        for (int i = 0; i < SITE_APS; i++) {
+            site_ap_t *s = &site[i];
+            if (rng() % 100 < (s->present ? 2 : 5)) {                       // Churn
+                s->present = !s->present;
+            }
+            int rssi = s->ap.rssi + (int) (rng() % 5) - 2;                  // Random walk within -90 to -20 dBm
+            s->ap.rssi = (int8_t) (rssi < -90 ? -90 : rssi > -20 ? -20 : rssi);
+            if (rng() % 500 == 0) {
+                s->ap.channel = (uint8_t) (1 + rng() % 13);
+            }
+            if (rng() % 1000 == 0) {
+                s->ap.authmode = (uint8_t) (rng() % 8);
+            }
+            if (s->present && (!partial || memchr(subset, s->ap.channel, sizeof(subset)) != NULL)) {
+                round[count++] = s->ap;
+            }
+        }
+        size_t n = scan_delta_update(&delta, round, count, partial ? subset : NULL, partial ? sizeof(subset) : 0,
+                                     events, CONFIG_SCAN_DELTA_CAPACITY);
+        total_events += n;
+        total_listed += count;
+        silent_rounds += n == 0;
+        bool gone_seen = false;
+        for (size_t e = 0; e < n; e++) {                                    // Replay onto the mirror
+            site_ap_t *s = &site[events[e].ap.bssid[5]];
+            const scan_delta_event_t *ev = &events[e];
+            errors += gone_seen && ev->kind != SCAN_DELTA_GONE;             // Gone APs come last
+            switch (ev->kind) {
+                case SCAN_DELTA_NEW:
+                    errors += s->reported;
+                    s->reported = true;
+                    s->mirror = ev->ap;
+                    break;
+                case SCAN_DELTA_CHANGED: {
+                    uint8_t expect = (abs(ev->ap.rssi - s->mirror.rssi) >= hysteresis ? SCAN_DELTA_RSSI : 0) |
+                                     (ev->ap.channel != s->mirror.channel ? SCAN_DELTA_CHANNEL : 0) |
+                                     (ev->ap.authmode != s->mirror.authmode ? SCAN_DELTA_AUTH : 0);
+                    errors += !s->reported || ev->changed == 0 || ev->changed != expect ||
+                              ev->previous_rssi != s->mirror.rssi || ev->previous_channel != s->mirror.channel ||
+                              ev->previous_authmode != s->mirror.authmode;
+                    s->mirror = ev->ap;
+                    break;
+                }
+                case SCAN_DELTA_GONE:
+                    gone_seen = true;
+                    errors += !s->reported || memcmp(&ev->ap, &s->mirror, sizeof(s->mirror)) != 0 ||
+                              s->misses + 1 < miss_limit;
+                    s->reported = false;
+                    break;
+                default:
+                    errors++;
+            }
+        }
+        size_t mirrored = 0;
+        for (int i = 0; i < SITE_APS; i++) {                                // Mirror against the round
+            site_ap_t *s = &site[i];
+            bool seen = false;
+            for (size_t k = 0; k < count && !seen; k++) {
+                seen = round[k].bssid[5] == i;
+            }
+            if (seen) {
+                s->misses = 0;
+                errors += !s->reported || s->mirror.channel != s->ap.channel || s->mirror.authmode != s->ap.authmode ||
+                          abs(s->mirror.rssi - s->ap.rssi) >= hysteresis;
+            } else if (s->reported && (!partial || memchr(subset, s->mirror.channel, sizeof(subset)) != NULL)) {
+                errors += ++s->misses >= miss_limit;                        // Should have been reported gone
+            } else if (!s->reported) {
+                s->misses = 0;
+            }
+            mirrored += s->reported;
+        }
+        errors += mirrored != scan_delta_count(&delta);
+    }
+    fprintf(stderr, "  %u rounds, %u events for %u APs listed, %u silent rounds\n", SITE_ROUNDS,
+            (unsigned) total_events, (unsigned) total_listed, (unsigned) silent_rounds);
+    CHECK_EQ(errors, 0);
+    CHECK_EQ(delta.untracked, 0);
+    CHECK(total_events < total_listed / 4);                                 // Far below a full table per round
+    CHECK(silent_rounds > 0);
+}
+
+static scan_delta_event_t monitor_events[256];
+static atomic_uint monitor_event_count;
+static atomic_uint monitor_callbacks;
+
+static void on_deltas(const scan_delta_event_t *events, size_t count) {
+    unsigned at = atomic_load(&monitor_event_count);
+    for (size_t i = 0; i < count && at + i < sizeof(monitor_events) / sizeof(monitor_events[0]); i++) {
+        monitor_events[at + i] = events[i];
+    }
+    atomic_store(&monitor_event_count, at + (unsigned) count);
+    atomic_fetch_add(&monitor_callbacks, 1);
+}
+
+static uint32_t monitor_rounds(void) {
+    wifictl_scan_monitor_stats_t stats;
+    wifictl_scan_monitor_get_stats(&stats);
+    return stats.rounds;
+}
+
+static void test_monitor_rounds(void) {
+    static const uint8_t channels[] = { 1, 6, 11 };
+    mock_ap_t aps[] = {
+        { .bssid = { 0x02, 0, 0, 0, 1, 1 }, .ssid = "one", .channel = 1, .rssi = -40, .authmode = WIFI_AUTH_WPA2_PSK },
+        { .bssid = { 0x02, 0, 0, 0, 1, 6 }, .ssid = "six", .channel = 6, .rssi = -60, .authmode = WIFI_AUTH_OPEN },
+        { .bssid = { 0x02, 0, 0, 0, 1, 9 }, .ssid = "nine", .channel = 9, .rssi = -50, .authmode = WIFI_AUTH_OPEN },
+    };
+    mock_radio_reset();
+    mock_radio_set_scan_time(2000);
+    mock_radio_set_aps(aps, 3);
+    CHECK_EQ(wifictl_scan_monitor_start(0, channels, 3, on_deltas), ESP_ERR_INVALID_ARG);
+    static const uint8_t bad[] = { 15 };
+    CHECK_EQ(wifictl_scan_monitor_start(1, bad, 1, on_deltas), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(wifictl_scan_monitor_start(1, channels, 3, on_deltas), ESP_OK);
+    CHECK_EQ(wifictl_scan_monitor_start(1, channels, 3, on_deltas), ESP_ERR_INVALID_STATE);
+    CHECK(wifictl_scan_monitor_active());
+
+    CHECK(WAIT_FOR(atomic_load(&monitor_callbacks) == 1, 1000));            // First round right away: baseline
+    CHECK_EQ(monitor_rounds(), 1);
+    CHECK_EQ(atomic_load(&monitor_event_count), 2);                         // Channel 9 is not scanned
+    CHECK(monitor_events[0].kind == SCAN_DELTA_NEW && monitor_events[1].kind == SCAN_DELTA_NEW);
+    CHECK_EQ(monitor_events[0].ap.bssid[5] + monitor_events[1].ap.bssid[5], 7);
+
+    CHECK(WAIT_FOR(monitor_rounds() == 2, 2000));                           // Unchanged: no callback
+    CHECK_EQ(atomic_load(&monitor_callbacks), 1);
+
+    aps[0].rssi = -70;                                                      // Applies to the next round
+    aps[1].authmode = WIFI_AUTH_WPA3_PSK;
+    mock_radio_set_aps(aps, 3);
+    CHECK(WAIT_FOR(monitor_rounds() == 3, 2000));
+    CHECK(WAIT_FOR(atomic_load(&monitor_callbacks) == 2, 500));
+    CHECK_EQ(atomic_load(&monitor_event_count), 4);
+    for (int i = 2; i < 4; i++) {
+        const scan_delta_event_t *e = &monitor_events[i];
+        CHECK_EQ(e->kind, SCAN_DELTA_CHANGED);
+        CHECK_EQ(e->changed, e->ap.bssid[5] == 1 ? SCAN_DELTA_RSSI : SCAN_DELTA_AUTH);
+    }
+
+    mock_radio_set_aps(&aps[1], 2);                                         // AP one vanishes: gone after two rounds
+    CHECK(WAIT_FOR(monitor_rounds() == 5, 3000));
+    CHECK(WAIT_FOR(atomic_load(&monitor_callbacks) == 3, 500));
+    CHECK_EQ(atomic_load(&monitor_event_count), 5);
+    CHECK_EQ(monitor_events[4].kind, SCAN_DELTA_GONE);
+    CHECK_EQ(monitor_events[4].ap.bssid[5], 1);
+
+    CHECK(WAIT_FOR(wifictl_sniffer_start(6) == ESP_OK, 1000));              // Rounds are skipped while sniffing
+    wifictl_scan_monitor_stats_t stats;
+    CHECK(WAIT_FOR((wifictl_scan_monitor_get_stats(&stats), stats.skipped > 0), 2000));
+    wifictl_sniffer_stop();
+    uint32_t rounds = monitor_rounds();
+    CHECK(WAIT_FOR(monitor_rounds() > rounds, 2000));
+    CHECK_EQ(atomic_load(&monitor_callbacks), 3);
+
+    wifictl_scan_monitor_stop();
+    CHECK(!wifictl_scan_monitor_active());
+    wifictl_scan_monitor_get_stats(&stats);
+    CHECK_EQ(stats.events, 5);
+    CHECK_EQ(stats.tracked, 1);
+    CHECK_EQ(stats.discarded, 0);
+}
+
+static atomic_bool stopper_running;
+
+static void stopper_task(void *arg) {
+    while (atomic_load(&stopper_running)) {
+        if (wifictl_scan_monitor_active()) {
+            wifictl_scan_monitor_stop();
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Retries starting the monitor until the round of the previous start has ended.
+ **/
+static bool monitor_restart(const uint8_t *channels, size_t count) {
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    return WAIT_FOR(err == ESP_OK || (err = wifictl_scan_monitor_start(60, channels, count, on_deltas)) == ESP_OK, 1000);
+}
+
+static void test_monitor_stop_races_round(void) {
+    static const uint8_t channels[] = { 1 };
+    mock_radio_reset();
+    mock_radio_set_scan_time(50);
+    atomic_store(&stopper_running, true);
+    CHECK_EQ(xTaskCreatePinnedToCore(stopper_task, "stopper", 2048, NULL, 5, NULL, 1), pdPASS);
+    uint32_t started = 0;
+    while (started < 2000 && monitor_restart(channels, 1)) {                // Each round start raced by a stop
+        started++;
+    }
+    atomic_store(&stopper_running, false);
+    CHECK_EQ(started, 2000);                                                // A round left running would refuse starts
+    wifictl_scan_monitor_stop();
+    CHECK(monitor_restart(channels, 1));
+    wifictl_scan_monitor_stop();
+    CHECK(WAIT_FOR(!wifictl_scan_in_progress(), 1000));
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_new_changed_and_silence);
+    RUN_TEST(test_slow_drift_reports_once);
+    RUN_TEST(test_gone_after_misses);
+    RUN_TEST(test_channel_subset);
+    RUN_TEST(test_full_tracker_and_truncation);
+    RUN_TEST(test_random_site_sequence);
+    RUN_TEST(test_monitor_rounds);
+    RUN_TEST(test_monitor_stop_races_round);
+    return TEST_RESULT();
+}
@@ -0,0 +1,231 @@
+/**
+ * @file test_sniffer_pipeline.c
+ * @brief Staged capture pipeline against the radio mock: a start failing to create a stage task is
+ *        retried by the next one, which creates only what is missing and all fan-out consumers; every captured frame passes the parse stage,
+ *        then the aggregate stage, exactly once and in capture order; a slow stage makes the callback
+ *        drop and count frames instead of blocking, with every callback in the capture histogram; batch
+ *        handler registration.
+ */
+#include <sched.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "metrics.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+static const uint8_t bssid[6] = { 0x02, 0, 0, 0, 0, 1 };
+static const uint8_t station[6] = { 0x06, 0, 0, 0, 0, 1 };
+
+typedef struct {
+    atomic_uint frames;
+    atomic_uint batches;
+    atomic_uint errors;                                                     // Out of order, oversized batch, not parsed yet
+    uint32_t last_seq;
+    uint32_t last_number;
+    bool started;
+} stage_seen_t;
+
+static stage_seen_t parsed, aggregated;
+static atomic_uint parsed_number;                                           // Highest frame number the parse stage released
+static atomic_uint aggregate_delay_us;
+
+static uint32_t frame_number(const wifictl_frame_t *frame) {
+    uint32_t number;
+    memcpy(&number, &frame->pkt.payload[24], sizeof(number));
+    return number;
+}
+
+static void check_batch(stage_seen_t *seen, const wifictl_frame_t *const *frames, size_t count) {
+    if (count == 0 || count > CONFIG_SNIFFER_BATCH_SIZE) {
+        atomic_fetch_add(&seen->errors, 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t number = frame_number(frames[i]);
+        if (seen->started && (frames[i]->seq <= seen->last_seq || number <= seen->last_number)) {
+            atomic_fetch_add(&seen->errors, 1);
+        }
+        seen->started = true;
+        seen->last_seq = frames[i]->seq;
+        seen->last_number = number;
+    }
+    atomic_fetch_add(&seen->batches, 1);
+    atomic_fetch_add(&seen->frames, count);
+}
+
+static void parse_handler(const wifictl_frame_t *const *frames, size_t count) {
+    check_batch(&parsed, frames, count);
+    atomic_store(&parsed_number, frame_number(frames[count - 1]));
+}
+
+static void aggregate_handler(const wifictl_frame_t *const *frames, size_t count) {
+    if (frame_number(frames[count - 1]) > atomic_load(&parsed_number)) {   // Parse stage must be done with the batch
+        atomic_fetch_add(&aggregated.errors, 1);
+    }
+    check_batch(&aggregated, frames, count);
+    uint32_t delay = atomic_load(&aggregate_delay_us);
+    if (delay > 0) {
+        usleep(delay);
+    }
+}
+
+static void reset_seen(void) {
+    memset(&parsed, 0, sizeof(parsed));
+    memset(&aggregated, 0, sizeof(aggregated));
+    atomic_store(&parsed_number, 0);
+}
+
+/**
+ * @brief Delivers `count` numbered data frames, yielding every `yield_every` frames.
+ * @return Frames the mock handed to the callback.
+ **/
+static uint32_t deliver(uint32_t first, uint32_t count, uint32_t yield_every) {
+    uint8_t frame[64];
+    uint32_t delivered = 0;
+    for (uint32_t n = first; n < first + count; n++) {
+        size_t len = mock_build_data(bssid, station, (uint16_t) n, 4, frame, sizeof(frame));
+        memcpy(&frame[24], &n, sizeof(n));
+        delivered += mock_radio_deliver(frame, len, WIFI_PKT_DATA, -50);
+        if (n % yield_every == 0) {
+            sched_yield();
+        }
+    }
+    return delivered;
+}
+
+static void test_start_retries_missing_stages(void) {
+    // Creation order: fan-out consumers (2), aggregate stage, parse stage
+    host_task_fail_create(1);                                               // Second fan-out consumer fails
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_ERR_NO_MEM);
+    host_task_fail_create(2);                                               // Aggregate stage fails
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_ERR_NO_MEM);
+    host_task_fail_create(1);                                               // Aggregate created, parse stage fails
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_ERR_NO_MEM);
+    host_task_fail_create(1);                                               // Only the parse stage is still missing
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    host_task_fail_create(-1);
+
+    mock_radio_reset();
+    reset_seen();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, parse_handler));
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, aggregate_handler));
+    wifictl_sniffer_stats_t stats;
+    uint32_t delivered = deliver(1, 2000, 8);
+    wifictl_sniffer_get_stats(&stats);
+    CHECK(WAIT_FOR(atomic_load(&aggregated.frames) == stats.captured, 2000));
+    wifictl_sniffer_stop();
+    CHECK_EQ(delivered, 2000);
+    CHECK(stats.captured > delivered / 2);
+    CHECK_EQ(atomic_load(&parsed.frames), stats.captured);
+    CHECK_EQ(atomic_load(&parsed.errors), 0);
+    CHECK_EQ(atomic_load(&aggregated.errors), 0);
+    wifictl_sniffer_unregister_batch_handler(parse_handler);
+    wifictl_sniffer_unregister_batch_handler(aggregate_handler);
+}
+
+static void test_stages_in_order(void) {
+    mock_radio_reset();
+    reset_seen();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, parse_handler));
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, aggregate_handler));
+
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    uint32_t delivered = deliver(1, 200000, 8);
+    wifictl_sniffer_get_stats(&after);
+    uint32_t captured = after.captured - before.captured;
+    CHECK(WAIT_FOR(atomic_load(&aggregated.frames) == captured, 2000));
+    wifictl_sniffer_stop();
+
+    wifictl_sniffer_get_stats(&after);
+    CHECK_EQ(delivered, 200000);
+    CHECK_EQ(captured + after.dropped - before.dropped, delivered);
+    CHECK(captured > delivered / 2);
+    CHECK_EQ(atomic_load(&parsed.frames), captured);
+    CHECK_EQ(atomic_load(&aggregated.frames), captured);
+    CHECK(atomic_load(&parsed.batches) < captured);                         // Frames were batched
+    CHECK_EQ(atomic_load(&parsed.errors), 0);
+    CHECK_EQ(atomic_load(&aggregated.errors), 0);
+    wifictl_sniffer_unregister_batch_handler(parse_handler);
+    wifictl_sniffer_unregister_batch_handler(aggregate_handler);
+}
+
+static void test_slow_stage_drops_in_callback(void) {
+    mock_radio_reset();
+    reset_seen();
+    atomic_store(&aggregate_delay_us, 2000);
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, parse_handler));
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, aggregate_handler));
+
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    metrics_reset();
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+    int64_t started_us = esp_timer_get_time();
+    uint32_t delivered = deliver(1, 20000, 64);
+    metrics_snapshot_t metrics;
+    metrics_snapshot(&metrics);
+    int64_t elapsed_us = esp_timer_get_time() - started_us;
+    wifictl_sniffer_get_stats(&after);
+    uint32_t captured = after.captured - before.captured;
+    CHECK(WAIT_FOR(atomic_load(&aggregated.frames) == captured, 5000));
+    wifictl_sniffer_stop();
+    atomic_store(&aggregate_delay_us, 0);
+
+    // 20000 frames through a stage taking 2 ms per batch would take seconds if the callback waited
+    CHECK(elapsed_us < 1000000);
+    CHECK(after.dropped - before.dropped > delivered / 2);
+    CHECK_EQ(captured + after.dropped - before.dropped, delivered);
+    CHECK_EQ(metrics.counters[METRIC_POOL_EXHAUSTED] + metrics.counters[METRIC_RING_FULL], after.dropped - before.dropped);
+    CHECK_EQ(metrics.hists[METRIC_HIST_CAPTURE].count, delivered);          // Dropping callbacks timed too
+    CHECK_EQ(atomic_load(&parsed.frames), captured);
+    CHECK_EQ(atomic_load(&parsed.errors), 0);
+    CHECK_EQ(atomic_load(&aggregated.errors), 0);
+    wifictl_sniffer_unregister_batch_handler(parse_handler);
+    wifictl_sniffer_unregister_batch_handler(aggregate_handler);
+}
+
+static void h0(const wifictl_frame_t *const *frames, size_t count) {}
+static void h1(const wifictl_frame_t *const *frames, size_t count) {}
+static void h2(const wifictl_frame_t *const *frames, size_t count) {}
+static void h3(const wifictl_frame_t *const *frames, size_t count) {}
+
+static void test_handler_registration(void) {
+    static const wifictl_sniffer_batch_handler_t handlers[] = { h0, h1, h2, h3 };
+    _Static_assert(sizeof(handlers) / sizeof(handlers[0]) == CONFIG_SNIFFER_MAX_BATCH_HANDLERS, "one per slot");
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, handlers[h]));
+    }
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, h2));            // Already registered
+    CHECK(!wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, parse_handler));
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, h2));        // Other stage has its own slots
+    wifictl_sniffer_unregister_batch_handler(h2);                                      // From both stages
+    CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_PARSE, parse_handler));
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        wifictl_sniffer_unregister_batch_handler(handlers[h]);
+    }
+    wifictl_sniffer_unregister_batch_handler(parse_handler);
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        CHECK(wifictl_sniffer_register_batch_handler(SNIFFER_STAGE_AGGREGATE, handlers[h]));
+    }
+    for (int h = 0; h < CONFIG_SNIFFER_MAX_BATCH_HANDLERS; h++) {
+        wifictl_sniffer_unregister_batch_handler(handlers[h]);
+    }
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    RUN_TEST(test_start_retries_missing_stages);                            // First, the stages are created once
+    RUN_TEST(test_stages_in_order);
+    RUN_TEST(test_slow_stage_drops_in_callback);
+    RUN_TEST(test_handler_registration);
+    return TEST_RESULT();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_station_table.c
+ * @brief Station inventory: frame direction handling, ignored frames, LRU eviction, a synthetic
+ *        multi-AP multi-client trace with exact per-client counters, and the sniffer feeding it.
+ */
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "sniffer.h"
+#include "station_table.h"
+
+#define TRACE_APS 8
+#define TRACE_CLIENTS_PER_AP 24
+
+static void make_mac(uint8_t mac[6], uint8_t kind, uint32_t n) {
+    mac[0] = kind;                                                          // 0x02 APs, 0x06 clients: both unicast
+    mac[1] = 0;
+    mac[2] = 0;
+    mac[3] = (uint8_t) (n >> 16);
+    mac[4] = (uint8_t) (n >> 8);
+    mac[5] = (uint8_t) n;
+}
+
+static size_t data_frame(uint8_t *frame, uint8_t ds, const uint8_t a1[6], const uint8_t a2[6], const uint8_t a3[6],
+                         size_t len) {
+    memset(frame, 0, len);
+    frame[0] = 0x08;
+    frame[1] = ds;
+    memcpy(&frame[4], a1, 6);
+    memcpy(&frame[10], a2, 6);
+    memcpy(&frame[16], a3, 6);
+    return len;
+}
+
+static void test_directions(void) {
+    uint8_t ap[6], client[6], frame[64];
+    static const uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    make_mac(ap, 0x02, 1);
+    make_mac(client, 0x06, 1);
+    wifictl_station_table_clear();
+
+    CHECK(wifictl_station_table_update(frame, data_frame(frame, 0x01, ap, client, ap, 60), -40, 6, 10));   // Uplink
+    CHECK(wifictl_station_table_update(frame, data_frame(frame, 0x02, client, ap, ap, 40), -90, 6, 20));   // Downlink
+    CHECK(!wifictl_station_table_update(frame, data_frame(frame, 0x02, broadcast, ap, ap, 40), -50, 6, 30));
+    CHECK(!wifictl_station_table_update(frame, data_frame(frame, 0x03, ap, client, ap, 40), -50, 6, 30));  // WDS
+    CHECK(!wifictl_station_table_update(frame, data_frame(frame, 0x00, ap, ap, ap, 40), -50, 6, 30));      // AP itself
+    CHECK(!wifictl_station_table_update(frame, 23, -50, 6, 30));            // Short
+    frame[0] = 0x80;                                                        // Beacon
+    CHECK(!wifictl_station_table_update(frame, 40, -50, 6, 30));
+
+    wifictl_station_t st;
+    CHECK_EQ(wifictl_station_table_snapshot(&st, 1, NULL), 1);
+    CHECK(memcmp(st.mac, client, 6) == 0 && memcmp(st.bssid, ap, 6) == 0);
+    CHECK_EQ(st.frames, 2);
+    CHECK_EQ(st.bytes, 100);
+    CHECK_EQ(st.rssi, -40);                                                 // Only uplink frames carry the client's RSSI
+    CHECK_EQ(st.last_seen_ms, 20);
+    wifictl_station_table_stats_t stats;
+    wifictl_station_table_get_stats(&stats);
+    CHECK_EQ(stats.updates, 2);
+    CHECK_EQ(stats.ignored, 5);
+}
+
+static void test_lru_eviction(void) {
+    uint8_t ap[6], client[6], frame[32];
+    make_mac(ap, 0x02, 1);
+    wifictl_station_table_clear();
+    for (uint32_t n = 0; n < CONFIG_STATION_TABLE_CAPACITY; n++) {
+        make_mac(client, 0x06, n);
+        wifictl_station_table_update(frame, data_frame(frame, 0x01, ap, client, ap, 30), -50, 1, n);
+    }
+    make_mac(client, 0x06, 0);                                              // Refresh the oldest, station 1 becomes LRU
+    wifictl_station_table_update(frame, data_frame(frame, 0x01, ap, client, ap, 30), -50, 1, 5000);
+    make_mac(client, 0x06, 100000);
+    wifictl_station_table_update(frame, data_frame(frame, 0x01, ap, client, ap, 30), -50, 1, 5001);
+
+    static wifictl_station_t all[CONFIG_STATION_TABLE_CAPACITY];
+    CHECK_EQ(wifictl_station_table_snapshot(all, CONFIG_STATION_TABLE_CAPACITY, NULL), CONFIG_STATION_TABLE_CAPACITY);
+    CHECK_EQ(all[0].mac[5], 100000 & 0xff);                                 // Most recently seen first
+    CHECK_EQ(all[1].mac[5], 0);
+    bool evicted = true;
+    for (size_t i = 0; i < CONFIG_STATION_TABLE_CAPACITY; i++) {
+        evicted &= !(all[i].mac[3] == 0 && all[i].mac[4] == 0 && all[i].mac[5] == 1);
+    }
+    CHECK(evicted);
+    wifictl_station_table_stats_t stats;
+    wifictl_station_table_get_stats(&stats);
+    CHECK_EQ(stats.evictions, 1);
+}
+
+static void test_synthetic_trace(void) {
+    static uint32_t expected_frames[TRACE_APS * TRACE_CLIENTS_PER_AP];
+    static uint32_t expected_bytes[TRACE_APS * TRACE_CLIENTS_PER_AP];
+    uint8_t ap[6], client[6], frame[1600];
+    uint32_t state = 8;
+    memset(expected_frames, 0, sizeof(expected_frames));
+    memset(expected_bytes, 0, sizeof(expected_bytes));
+    wifictl_station_table_clear();
+
+    for (uint32_t i = 0; i < 500000; i++) {
+        state = state * 1664525 + 1013904223;
+        uint32_t c = (state >> 8) % (TRACE_APS * TRACE_CLIENTS_PER_AP);
+        size_t len = 24 + (state >> 20) % 1500;
+        make_mac(ap, 0x02, c / TRACE_CLIENTS_PER_AP);
+        make_mac(client, 0x06, c);
+        if (state & 1) {
+            data_frame(frame, 0x01, ap, client, ap, len);
+        } else {
+            data_frame(frame, 0x02, client, ap, ap, len);
+        }
+        wifictl_station_table_update(frame, len, -60, 6, i);
+        expected_frames[c]++;
+        expected_bytes[c] += len;
+    }
+
+    static wifictl_station_t all[CONFIG_STATION_TABLE_CAPACITY];
+    size_t n = wifictl_station_table_snapshot(all, CONFIG_STATION_TABLE_CAPACITY, NULL);
+    CHECK_EQ(n, TRACE_APS * TRACE_CLIENTS_PER_AP);
+    bool exact = true;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t c = (uint32_t) all[i].mac[3] << 16 | (uint32_t) all[i].mac[4] << 8 | all[i].mac[5];
+        exact &= all[i].frames == expected_frames[c] && all[i].bytes == expected_bytes[c];
+        exact &= all[i].bssid[5] == c / TRACE_CLIENTS_PER_AP;
+    }
+    CHECK(exact);
+
+    make_mac(ap, 0x02, 3);
+    CHECK_EQ(wifictl_station_table_snapshot(all, CONFIG_STATION_TABLE_CAPACITY, ap), TRACE_CLIENTS_PER_AP);
+}
+
+static void test_fed_by_sniffer(void) {
+    uint8_t ap[6], client[6], frame[128];
+    make_mac(ap, 0x02, 7);
+    mock_radio_reset();
+    wifictl_station_table_clear();
+    CHECK(wifictl_station_table_track(true));
+    CHECK_EQ(wifictl_sniffer_start(11), ESP_OK);
+    for (uint32_t n = 0; n < 10; n++) {
+        make_mac(client, 0x06, n);
+        size_t len = data_frame(frame, 0x01, ap, client, ap, 100);
+        mock_radio_deliver(frame, len, WIFI_PKT_DATA, -45);
+        vTaskDelay(1);                                                      // Stay below the capture ring's depth
+    }
+    CHECK(WAIT_FOR(wifictl_station_table_count() == 10, 1000));
+    wifictl_sniffer_stop();
+    wifictl_station_table_track(false);
+
+    wifictl_station_t st;
+    CHECK_EQ(wifictl_station_table_snapshot(&st, 1, ap), 1);
+    CHECK_EQ(st.bytes, 100);                                                // FCS stripped
+    CHECK_EQ(st.channel, 11);
+    CHECK_EQ(st.rssi, -45);
+}
+
+int main(void) {
+    mock_radio_install();
+    RUN_TEST(test_directions);
+    RUN_TEST(test_lru_eviction);
+    RUN_TEST(test_synthetic_trace);
+    RUN_TEST(test_fed_by_sniffer);
+    return TEST_RESULT();
+}
@@ -0,0 +1,374 @@
+/**
+ * @file test_traffic_sketch.c
+ * @brief Traffic sketches against their error bounds: HyperLogLog relative error over cardinalities up to
+ *        half a million, Count-Min overestimates over a Zipf stream of a million frames, Space-Saving
+ *        count bounds and heavy hitters before and after merging windows, BSSID slots kept across
+ *        windows, and the monitor fed by the sniffer's fan-out against the radio mock.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "sketch_monitor.h"
+#include "sniffer.h"
+#include "sniffer_fanout.h"
+#include "traffic_sketch.h"
+#include "wifi_controller.h"
+
+#define HLL_SIGMA (1.04 / sqrt(SKETCH_HLL_REGISTERS))
+#define STREAM_MACS 10000
+#define STREAM_FRAMES 1000000
+#define STREAM_WINDOWS 8
+
+static uint32_t rng_state = 41;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1664525 + 1013904223;
+    return rng_state >> 8;
+}
+
+static void make_mac(uint32_t trial, uint32_t n, uint8_t mac[6]) {
+    mac[0] = 0x02;
+    mac[1] = (uint8_t) trial;
+    mac[2] = (uint8_t) (n >> 24);
+    mac[3] = (uint8_t) (n >> 16);
+    mac[4] = (uint8_t) (n >> 8);
+    mac[5] = (uint8_t) n;
+}
+
+static void test_hll_error_bound(void) {
+    static const uint32_t cardinalities[] = { 50, 500, 5000, 50000, 500000 };
+    const int trials = 16;
+    sketch_hll_t hll;
+    memset(&hll, 0, sizeof(hll));
+    CHECK_EQ(sketch_hll_estimate(&hll), 0);
+    for (size_t c = 0; c < sizeof(cardinalities) / sizeof(cardinalities[0]); c++) {
+        uint32_t n = cardinalities[c];
+        double square_sum = 0, worst = 0;
+        for (int t = 0; t < trials; t++) {
+            memset(&hll, 0, sizeof(hll));
+            uint8_t mac[6];
+            for (uint32_t i = 0; i < n; i++) {
+                make_mac((uint32_t) (c * trials + t), i, mac);
+                sketch_hll_add(&hll, sketch_hash_mac(mac));
+                if (i % 4 == 0) {
+                    sketch_hll_add(&hll, sketch_hash_mac(mac));             // Repeats do not count
+                }
+            }
+            double error = ((double) sketch_hll_estimate(&hll) - n) / n;
+            square_sum += error * error;
+            worst = fabs(error) > worst ? fabs(error) : worst;
+        }
+        double rms = sqrt(square_sum / trials);
+        fprintf(stderr, "  %6u distinct: rms %.3f, worst %.3f, sigma %.3f\n", (unsigned) n, rms, worst, HLL_SIGMA);
+        CHECK(rms < 1.5 * HLL_SIGMA);
+        CHECK(worst < 4 * HLL_SIGMA);
+        if (n <= SKETCH_HLL_REGISTERS / 4) {                                // Linear counting: 3 of its standard errors
+            double load = (double) n / SKETCH_HLL_REGISTERS;
+            CHECK(worst * n <= 3 * sqrt(SKETCH_HLL_REGISTERS * (exp(load) - load - 1)));
+        }
+    }
+}
+
+static void test_hll_merge_is_union(void) {
+    sketch_hll_t a, b, all;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&all, 0, sizeof(all));
+    uint8_t mac[6];
+    for (uint32_t i = 0; i < 50000; i++) {
+        make_mac(0xaa, i, mac);
+        uint64_t hash = sketch_hash_mac(mac);
+        sketch_hll_add(&all, hash);
+        if (i < 30000) {
+            sketch_hll_add(&a, hash);
+        }
+        if (i >= 20000) {                                                   // Overlaps a by 10000
+            sketch_hll_add(&b, hash);
+        }
+    }
+    sketch_hll_merge(&a, &b);
+    CHECK(memcmp(a.registers, all.registers, sizeof(all.registers)) == 0);
+    CHECK(fabs(sketch_hll_estimate(&a) - 50000.0) < 4 * HLL_SIGMA * 50000);
+}
+
+static double zipf_cdf[STREAM_MACS];
+static uint16_t *stream;                                                    // MAC index per frame
+static uint32_t truth[STREAM_MACS];
+
+/**
+ * @brief Draws STREAM_FRAMES frames from STREAM_MACS transmitters with Zipf(1) frequencies.
+ */
+static void build_stream(void) {
+    double sum = 0;
+    for (int i = 0; i < STREAM_MACS; i++) {
+        sum += 1.0 / (i + 1);
+        zipf_cdf[i] = sum;
+    }
+    stream = malloc(STREAM_FRAMES * sizeof(*stream));
+    memset(truth, 0, sizeof(truth));
+    for (uint32_t f = 0; f < STREAM_FRAMES; f++) {
+        double u = ((double) rng() * (1 << 24) + rng()) / ((double) (1 << 24) * (1 << 24)) * sum;
+        int lo = 0, hi = STREAM_MACS - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (zipf_cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        stream[f] = (uint16_t) lo;
+        truth[lo]++;
+    }
+}
+
+static void test_cms_error_bound(void) {
+    static sketch_cms_t cms, halves[2];
+    memset(&cms, 0, sizeof(cms));
+    memset(halves, 0, sizeof(halves));
+    uint8_t mac[6];
+    for (uint32_t f = 0; f < STREAM_FRAMES; f++) {
+        make_mac(0, stream[f], mac);
+        uint64_t hash = sketch_hash_mac(mac);
+        sketch_cms_add(&cms, hash, 1);
+        sketch_cms_add(&halves[f % 2], hash, 1);
+    }
+    const double bound = M_E / CONFIG_SKETCH_CMS_WIDTH * STREAM_FRAMES;
+    uint32_t under = 0, over_bound = 0;
+    for (uint32_t i = 0; i < STREAM_MACS; i++) {
+        make_mac(0, i, mac);
+        uint32_t estimate = sketch_cms_estimate(&cms, sketch_hash_mac(mac));
+        under += estimate < truth[i];
+        over_bound += estimate - truth[i] > bound;
+    }
+    fprintf(stderr, "  %u of %u MACs beyond e/w * N\n", (unsigned) over_bound, STREAM_MACS);
+    CHECK_EQ(under, 0);
+    CHECK(over_bound <= STREAM_MACS * exp(-CONFIG_SKETCH_CMS_DEPTH));
+
+    sketch_cms_merge(&halves[0], &halves[1]);
+    CHECK(memcmp(&halves[0], &cms, sizeof(cms)) == 0);
+
+    sketch_cms_t saturated;
+    memset(&saturated, 0, sizeof(saturated));
+    sketch_cms_add(&saturated, 1, UINT32_MAX - 1);
+    sketch_cms_add(&saturated, 1, 5);
+    CHECK_EQ(sketch_cms_estimate(&saturated, 1), UINT32_MAX);
+}
+
+/**
+ * @brief Checks Space-Saving guarantees of a summary of `frames` frames whose true counts are `counts`.
+ * @param heavy Share of frames above which a MAC must be in the summary.
+ */
+static void check_topk(const sketch_topk_t *topk, const uint32_t *counts, uint32_t frames, double heavy) {
+    sketch_talker_t sorted[CONFIG_SKETCH_TOPK];
+    size_t size = sketch_topk_sorted(topk, sorted, CONFIG_SKETCH_TOPK);
+    CHECK_EQ(size, CONFIG_SKETCH_TOPK);
+    uint32_t bound_errors = 0, order_errors = 0, max_error = 0;
+    bool listed[STREAM_MACS] = { false };
+    for (size_t i = 0; i < size; i++) {
+        uint32_t index = (uint32_t) sorted[i].mac[2] << 24 | (uint32_t) sorted[i].mac[3] << 16 |
+                         (uint32_t) sorted[i].mac[4] << 8 | sorted[i].mac[5];
+        if (index >= STREAM_MACS) {
+            bound_errors++;
+            continue;
+        }
+        listed[index] = true;
+        bound_errors += sorted[i].count < counts[index] || sorted[i].count - sorted[i].error > counts[index];
+        order_errors += i > 0 && sorted[i].count > sorted[i - 1].count;
+        max_error = sorted[i].error > max_error ? sorted[i].error : max_error;
+    }
+    uint32_t missing = 0;
+    for (uint32_t i = 0; i < STREAM_MACS; i++) {
+        missing += counts[i] > heavy * frames && !listed[i];
+    }
+    CHECK_EQ(bound_errors, 0);
+    CHECK_EQ(order_errors, 0);
+    CHECK_EQ(missing, 0);
+    CHECK(max_error <= heavy * frames);
+}
+
+static void test_topk_bounds_and_merge(void) {
+    static sketch_topk_t whole, windows[STREAM_WINDOWS], merged;
+    static uint32_t bytes_truth[STREAM_MACS];
+    static sketch_topk_t bytes;
+    memset(&whole, 0, sizeof(whole));
+    memset(windows, 0, sizeof(windows));
+    memset(&merged, 0, sizeof(merged));
+    memset(&bytes, 0, sizeof(bytes));
+    memset(bytes_truth, 0, sizeof(bytes_truth));
+    uint64_t bytes_total = 0;
+    uint8_t mac[6];
+    for (uint32_t f = 0; f < STREAM_FRAMES; f++) {
+        make_mac(0, stream[f], mac);
+        sketch_topk_add(&whole, mac, 1);
+        sketch_topk_add(&windows[f / (STREAM_FRAMES / STREAM_WINDOWS)], mac, 1);
+        uint32_t length = 60 + (stream[f] * 37 + f) % 1400;
+        sketch_topk_add(&bytes, mac, length);
+        bytes_truth[stream[f]] += length;
+        bytes_total += length;
+    }
+    check_topk(&whole, truth, STREAM_FRAMES, 1.0 / CONFIG_SKETCH_TOPK);
+    check_topk(&bytes, bytes_truth, (uint32_t) bytes_total, 1.0 / CONFIG_SKETCH_TOPK);
+
+    for (int w = 0; w < STREAM_WINDOWS; w++) {                              // As the monitor closes windows
+        sketch_topk_merge(&merged, &windows[w]);
+    }
+    check_topk(&merged, truth, STREAM_FRAMES, 2.0 / CONFIG_SKETCH_TOPK);
+    sketch_talker_t top[3];
+    CHECK_EQ(sketch_topk_sorted(&merged, top, 3), 3);
+    for (int i = 0; i < 3; i++) {                                           // Zipf ranks stand out by far
+        CHECK_EQ(top[i].mac[5], i);
+    }
+}
+
+static void test_window_bssids(void) {
+    static sketch_window_t a, b;
+    sketch_window_init(&a);
+    sketch_window_init(&b);
+    uint8_t bssid[6], client[6];
+    for (uint32_t n = 0; n < CONFIG_SKETCH_BSSIDS + 4; n++) {               // Four BSSIDs too many
+        make_mac(0xb0, n, bssid);
+        for (uint32_t c = 0; c < 10; c++) {
+            make_mac(0xc0 + n, c, client);
+            sketch_window_add(&a, (uint8_t) (1 + n % 13), client, bssid, client, 100);
+            sketch_window_add(&a, (uint8_t) (1 + n % 13), bssid, bssid, client, 200);
+        }
+    }
+    CHECK_EQ(a.frames, (CONFIG_SKETCH_BSSIDS + 4) * 20);
+    CHECK_EQ(a.bytes, (CONFIG_SKETCH_BSSIDS + 4) * 3000);
+    CHECK_EQ(a.bssid_overflow, 4 * 20);
+    make_mac(0xb0, 3, bssid);
+    const sketch_bssid_t *slot = sketch_window_find_bssid(&a, bssid);
+    CHECK(slot != NULL && slot->frames == 20 && slot->channel == 4);
+    CHECK(slot != NULL && abs((int) sketch_hll_estimate(&slot->clients) - 10) <= 1);
+    make_mac(0xb0, CONFIG_SKETCH_BSSIDS, bssid);
+    CHECK(sketch_window_find_bssid(&a, bssid) == NULL);
+    CHECK(abs((int) sketch_hll_estimate(&a.channels[3]) - 2 * 11) <= 1);    // BSSIDs 3 and 16 with 10 clients each
+
+    make_mac(0xb0, 3, bssid);                                               // Known BSSID, 10 new clients, on another channel
+    for (uint32_t c = 10; c < 20; c++) {
+        make_mac(0xc3, c, client);
+        sketch_window_add(&b, 9, client, bssid, client, 100);
+    }
+    make_mac(0xb0, 99, bssid);
+    sketch_window_add(&b, 9, bssid, bssid, NULL, 100);                      // No room for it in a
+    sketch_window_merge(&a, &b);
+    make_mac(0xb0, 3, bssid);
+    slot = sketch_window_find_bssid(&a, bssid);
+    CHECK(slot != NULL && slot->frames == 30 && slot->channel == 9);
+    CHECK(slot != NULL && abs((int) sketch_hll_estimate(&slot->clients) - 20) <= 1);
+    CHECK_EQ(a.bssid_overflow, 4 * 20 + 1);
+    CHECK_EQ(a.frames, (CONFIG_SKETCH_BSSIDS + 4) * 20 + 11);
+    CHECK(abs((int) sketch_hll_estimate(&a.channels[8]) - 2 * 11) <= 1);    // BSSID 8 with its clients, then b
+
+    sketch_window_init(&b);                                                 // Next window keeps a's slots
+    sketch_window_carry_bssids(&b, &a);
+    make_mac(0xb0, 3, bssid);
+    slot = sketch_window_find_bssid(&b, bssid);
+    CHECK(slot != NULL && slot->frames == 0 && slot->channel == 9 && sketch_hll_estimate(&slot->clients) == 0);
+    CHECK(memcmp(b.bssids[CONFIG_SKETCH_BSSIDS - 1].bssid, a.bssids[CONFIG_SKETCH_BSSIDS - 1].bssid, 6) == 0);
+    make_mac(0xb0, 99, bssid);
+    sketch_window_add(&b, 9, bssid, bssid, NULL, 100);
+    CHECK_EQ(b.bssid_overflow, 1);
+    CHECK_EQ(b.frames, 1);
+}
+
+static void test_monitor_through_sniffer(void) {
+    static const uint8_t ap_bssid[4][6] = {
+        { 0x02, 0, 0, 0, 0x10, 0 }, { 0x02, 0, 0, 0, 0x10, 1 }, { 0x02, 0, 0, 0, 0x10, 2 }, { 0x02, 0, 0, 0, 0x10, 3 },
+    };
+    const uint32_t stations = 40, frames = 4000;
+    mock_radio_reset();
+    wifictl_sniffer_filter_frame_types(true, true, true);
+    CHECK_EQ(wifictl_sketch_start(), ESP_OK);
+    CHECK_EQ(wifictl_sketch_start(), ESP_ERR_INVALID_STATE);
+    wifictl_fanout_consumer_stats_t fanout_before[2], fanout_after[2];
+    wifictl_fanout_get_stats(fanout_before, 2);
+    wifictl_sniffer_stats_t before, after;
+    wifictl_sniffer_get_stats(&before);
+    CHECK_EQ(wifictl_sniffer_start(6), ESP_OK);
+
+    static uint32_t sent[64];
+    memset(sent, 0, sizeof(sent));
+    uint8_t frame[MOCK_RADIO_MAX_FRAME];
+    for (uint32_t n = 0; n < frames; n++) {
+        uint8_t station[6] = { 0x06, 0, 0, 0, 0, 0 };
+        uint32_t s = n % 3 == 0 ? 0 : n % 5 == 0 ? 1 : rng() % stations;   // Stations 0 and 1 talk the most
+        station[5] = (uint8_t) s;
+        size_t len = mock_build_data(ap_bssid[s % 4], station, (uint16_t) n, 100, frame, sizeof(frame));
+        CHECK(mock_radio_deliver(frame, len, WIFI_PKT_DATA, -50));
+        sent[s]++;
+        if (n % 8 == 7) {
+            vTaskDelay(1);
+        }
+    }
+    wifictl_sniffer_get_stats(&after);
+    CHECK_EQ(after.dropped - before.dropped, 0);
+    CHECK_EQ(after.fanout_dropped - before.fanout_dropped, 0);
+    wifictl_sketch_stats_t stats;
+    CHECK(WAIT_FOR((wifictl_sketch_get_stats(&stats), stats.frames == frames), 2000));
+    wifictl_fanout_get_stats(fanout_after, 2);
+    CHECK_EQ(fanout_after[1].delivered - fanout_before[1].delivered, frames);
+    CHECK_EQ(stats.bytes, frames * 124);                                    // Header and payload, without the FCS
+    CHECK_EQ(stats.windows, 0);
+    CHECK_EQ(stats.bssid_overflow, 0);
+
+    wifictl_sketch_census_t census[SKETCH_CHANNELS + 1];
+    CHECK_EQ(wifictl_sketch_channels(census, SKETCH_CHANNELS + 1), 2);     // All channels, then channel 6
+    CHECK_EQ(census[1].channel, 6);
+    CHECK(abs((int) census[1].total - (int) stations) <= 2);
+    CHECK_EQ(census[1].window, census[1].total);
+    CHECK_EQ(census[0].total, census[1].total);
+
+    wifictl_sketch_census_t rows[CONFIG_SKETCH_BSSIDS];
+    CHECK_EQ(wifictl_sketch_bssids(rows, CONFIG_SKETCH_BSSIDS), 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK_EQ(rows[i].channel, 6);
+        CHECK(abs((int) rows[i].total - (int) stations / 4) <= 1);
+    }
+
+    sketch_talker_t talkers[4];
+    CHECK_EQ(wifictl_sketch_talkers(SKETCH_FRAMES, false, talkers, 4), 4);
+    CHECK_EQ(talkers[0].mac[5], 0);
+    CHECK_EQ(talkers[1].mac[5], 1);
+    CHECK(talkers[0].count >= sent[0] && talkers[0].count - talkers[0].error <= sent[0]);
+    CHECK_EQ(wifictl_sketch_talkers(SKETCH_BYTES, true, talkers, 1), 1);
+    CHECK_EQ(talkers[0].mac[5], 0);
+    uint8_t station[6] = { 0x06, 0, 0, 0, 0, 7 };
+    uint32_t window[SKETCH_METRICS], total[SKETCH_METRICS];
+    wifictl_sketch_lookup(station, window, total);
+    CHECK(window[SKETCH_FRAMES] >= sent[7] && total[SKETCH_FRAMES] == window[SKETCH_FRAMES]);
+    CHECK(window[SKETCH_BYTES] >= sent[7] * 124);
+
+    wifictl_sketch_stop();                                                  // Queries keep the collected sketches
+    CHECK(!wifictl_sketch_active());
+    size_t len = mock_build_data(ap_bssid[0], station, 1, 100, frame, sizeof(frame));
+    CHECK(mock_radio_deliver(frame, len, WIFI_PKT_DATA, -50));
+    vTaskDelay(pdMS_TO_TICKS(50));
+    wifictl_sketch_get_stats(&stats);
+    CHECK_EQ(stats.frames, frames);
+    wifictl_sniffer_stop();
+    CHECK_EQ(wifictl_sketch_start(), ESP_OK);                               // Restart clears
+    wifictl_sketch_get_stats(&stats);
+    CHECK_EQ(stats.frames, 0);
+    CHECK_EQ(wifictl_sketch_channels(census, SKETCH_CHANNELS + 1), 1);
+    wifictl_sketch_stop();
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    build_stream();
+    RUN_TEST(test_hll_error_bound);
+    RUN_TEST(test_hll_merge_is_union);
+    RUN_TEST(test_cms_error_bound);
+    RUN_TEST(test_topk_bounds_and_merge);
+    RUN_TEST(test_window_bssids);
+    RUN_TEST(test_monitor_through_sniffer);
+    free(stream);
+    return TEST_RESULT();
+}
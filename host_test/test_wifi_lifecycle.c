@@ -0,0 +1,166 @@
+/**
+ * @file test_wifi_lifecycle.c
+ * @brief Wi-Fi lifecycle against the radio mock: lazy one-time initialization, repeated scans, every
+ *        mode switch with its recorded timing, and concurrent scan/sniff requests settling consistently.
+ */
+#include <stdatomic.h>
+#include <string.h>
+
+#include "host_test.h"
+#include "mock_radio.h"
+
+#include "ap_scanner.h"
+#include "ap_table.h"
+#include "esp_wifi.h"
+#include "sniffer.h"
+#include "wifi_controller.h"
+
+static const mock_ap_t test_aps[] = {
+    { .bssid = { 0x02, 0, 0, 0, 0, 1 }, .ssid = "one", .channel = 1, .rssi = -40, .authmode = WIFI_AUTH_WPA2_PSK },
+    { .bssid = { 0x02, 0, 0, 0, 0, 2 }, .ssid = "nine", .channel = 9, .rssi = -60, .authmode = WIFI_AUTH_OPEN },
+};
+
+static atomic_uint done_calls;
+
+static void scan_callback(uint8_t channel, const uint16_t *ids, uint16_t count, bool done) {
+    if (done) {
+        atomic_fetch_add(&done_calls, 1);
+    }
+}
+
+static void test_lazy_init_and_rescans(void) {
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_UNINIT);
+    CHECK_EQ(host_wifi_init_count(), 0);
+    mock_radio_set_aps(test_aps, sizeof(test_aps) / sizeof(test_aps[0]));
+
+    wifictl_scan_nearby_aps();                                              // First use brings the driver up
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_IDLE);
+    CHECK_EQ(wifictl_ap_table_count(), 2);
+    wifictl_lifecycle_stats_t stats;
+    wifictl_get_lifecycle_stats(&stats);
+    CHECK_EQ(stats.transitions[WIFICTL_MODE_UNINIT][WIFICTL_MODE_IDLE].count, 1);
+    CHECK(stats.first_scan_ms > 0);
+    uint32_t first_scan_ms = stats.first_scan_ms;
+
+    for (int i = 0; i < 20; i++) {                                          // Every later scan works too
+        wifictl_ap_table_clear();
+        wifictl_scan_nearby_aps();
+        CHECK_EQ(wifictl_ap_table_count(), 2);
+    }
+    CHECK_EQ(wifictl_init(), ESP_OK);
+    CHECK_EQ(host_wifi_init_count(), 1);
+    wifictl_get_lifecycle_stats(&stats);
+    CHECK_EQ(stats.transitions[WIFICTL_MODE_IDLE][WIFICTL_MODE_SCANNING].count, 21);
+    CHECK_EQ(stats.transitions[WIFICTL_MODE_SCANNING][WIFICTL_MODE_IDLE].count, 21);
+    CHECK_EQ(stats.first_scan_ms, first_scan_ms);
+    CHECK_EQ(atomic_load(&done_calls), 21);
+    mock_radio_stats_t radio;
+    mock_radio_get_stats(&radio);
+    CHECK_EQ(radio.scans_started, 21 * 13);
+}
+
+static void test_mode_switches(void) {
+    wifictl_lifecycle_stats_t before, after;
+    mock_radio_stats_t radio;
+    mock_radio_set_scan_time(100000);
+    atomic_store(&done_calls, 0);
+    wifictl_get_lifecycle_stats(&before);
+
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_OK);                    // idle -> scanning -> sniffing
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_SCANNING);
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(wifictl_sniffer_start(11), ESP_OK);
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_SNIFFING);
+    CHECK_EQ(atomic_load(&done_calls), 1);                                  // Cancelled scan called back once
+    CHECK(!wifictl_scan_in_progress());
+    mock_radio_get_stats(&radio);
+    CHECK(radio.promiscuous);
+    CHECK_EQ(radio.channel, 11);
+    CHECK_EQ(radio.scans_stopped, 1);
+
+    CHECK_EQ(wifictl_sniffer_start(11), ESP_OK);                            // Same mode: nothing to switch
+    CHECK_EQ(wifictl_scan_start_async(NULL, 0), ESP_OK);                    // sniffing -> scanning
+    mock_radio_get_stats(&radio);
+    CHECK(!radio.promiscuous);
+    CHECK_EQ(wifictl_mode_enter(WIFICTL_MODE_UNINIT), ESP_OK);              // Never torn down
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_SCANNING);
+    wifictl_scan_cancel();                                                  // scanning -> idle
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_IDLE);
+    CHECK_EQ(atomic_load(&done_calls), 2);
+
+    CHECK_EQ(wifictl_sniffer_start(1), ESP_OK);                             // idle -> sniffing -> idle
+    wifictl_sniffer_stop();
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_IDLE);
+    wifictl_sniffer_stop();                                                 // Stopping twice is harmless
+
+    wifictl_get_lifecycle_stats(&after);
+    static const wifictl_mode_t path[][2] = {
+        { WIFICTL_MODE_IDLE, WIFICTL_MODE_SCANNING }, { WIFICTL_MODE_SCANNING, WIFICTL_MODE_SNIFFING },
+        { WIFICTL_MODE_SNIFFING, WIFICTL_MODE_SCANNING }, { WIFICTL_MODE_SCANNING, WIFICTL_MODE_IDLE },
+        { WIFICTL_MODE_IDLE, WIFICTL_MODE_SNIFFING }, { WIFICTL_MODE_SNIFFING, WIFICTL_MODE_IDLE },
+    };
+    for (size_t i = 0; i < sizeof(path) / sizeof(path[0]); i++) {
+        const wifictl_transition_t *a = &after.transitions[path[i][0]][path[i][1]];
+        CHECK_EQ(a->count - before.transitions[path[i][0]][path[i][1]].count, 1);
+        CHECK(a->max_us >= a->last_us);
+    }
+    CHECK_EQ(after.transitions[WIFICTL_MODE_SNIFFING][WIFICTL_MODE_SNIFFING].count, 0);
+    CHECK_EQ(after.mode, WIFICTL_MODE_IDLE);
+    CHECK(strcmp(wifictl_mode_name(WIFICTL_MODE_SNIFFING), "sniffing") == 0);
+    mock_radio_set_scan_time(1000);
+}
+
+static atomic_uint scans_started;
+static atomic_uint workers_done;
+
+static void worker(void *arg) {
+    uint32_t state = (uint32_t) (uintptr_t) arg;
+    for (int i = 0; i < 2000; i++) {
+        state = state * 1664525 + 1013904223;
+        switch ((state >> 8) % 5) {
+            case 0:
+                if (wifictl_scan_start_async(NULL, 0) == ESP_OK) {
+                    atomic_fetch_add(&scans_started, 1);
+                }
+                break;
+            case 1: wifictl_sniffer_start((uint8_t) (1 + (state >> 16) % 13)); break;
+            case 2: wifictl_sniffer_stop(); break;
+            case 3: wifictl_scan_cancel(); break;
+            default: wifictl_mode_enter(WIFICTL_MODE_IDLE); break;
+        }
+        if (i % 8 == 0) {
+            vTaskDelay(1);
+        }
+    }
+    atomic_fetch_add(&workers_done, 1);
+    vTaskDelete(NULL);
+}
+
+static void test_concurrent_requests(void) {
+    mock_radio_set_scan_time(200);
+    atomic_store(&done_calls, 0);
+    for (uintptr_t w = 0; w < 4; w++) {
+        xTaskCreate(worker, "lifecycle", 4096, (void *) (w + 1), 5, NULL);
+    }
+    CHECK(WAIT_FOR(atomic_load(&workers_done) == 4, 60000));
+    CHECK_EQ(wifictl_mode_enter(WIFICTL_MODE_IDLE), ESP_OK);
+    CHECK(WAIT_FOR(!wifictl_scan_in_progress() && atomic_load(&done_calls) == atomic_load(&scans_started), 2000));
+
+    mock_radio_stats_t radio;
+    mock_radio_get_stats(&radio);
+    CHECK_EQ(wifictl_mode_get(), WIFICTL_MODE_IDLE);
+    CHECK(!radio.promiscuous);                                              // Promiscuous mode only ever on while sniffing
+    CHECK_EQ(atomic_load(&done_calls), atomic_load(&scans_started));        // Every scan finished exactly once
+    CHECK_EQ(radio.scans_refused, 0);                                       // No late SCAN_DONE taken for a live request
+    CHECK(atomic_load(&scans_started) > 0);
+    CHECK_EQ(host_wifi_init_count(), 1);
+}
+
+int main(void) {
+    mock_radio_install();
+    CHECK(wifictl_register_scan_callback(scan_callback));
+    RUN_TEST(test_lazy_init_and_rescans);
+    RUN_TEST(test_mode_switches);
+    RUN_TEST(test_concurrent_requests);
+    return TEST_RESULT();
+}
@@ -4,12 +4,14 @@
 extern "C" {
     #include "ap_scanner.h"   // Handle AP scanning
     #include "command_line.h" // Handle command line input
+    #include "deferred_log.h" // Format hot path logs off the capture path
 
     #include "sniffer.h"      // Handle sniffer : TO BE IMPLEMENTED
 }
 
 
 void app_main() {             // Start of main function
+    deferred_log_start();     // Start the deferred log formatter
     read_user_input(1);       // Call the function to read user input
     
     // wifictl_sniffer_start(11);
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Receives the sniffer PCAP stream from the device UART and writes it to a .pcap file.
+
+Start streaming on the device with `pcap <channel>` or `pcap <channel> compact`, then run:
+
+    python tools/pcap_receiver.py COM3 capture.pcap --baud 2000000
+
+Text printed before the stream starts is skipped until the PCAP or compact stream magic is found.
+On exit the receiver sends `pcap stop` at the streaming rate, which restores the console.
+Lost records are counted from gaps in the capture sequence number carried in the
+radiotap vendor namespace; they include frames dropped on the device and records
+lost on the serial link.
+
+A compact stream is expanded back into plain PCAP records. Beacons the device replaced by
+summaries are not in the output; they are subtracted from the lost count and the summaries
+can be written to a CSV file with --summaries.
+"""
+import argparse
+import struct
+import sys
+import time
+
+import serial  # pyserial
+
+PCAP_MAGIC = struct.pack("<I", 0xA1B2C3D4)
+COMPACT_MAGIC = b"DRCZ"
+COMPACT_VERSION = 1
+GLOBAL_HDR_LEN = 24
+RECORD_HDR_LEN = 16
+RADIOTAP_LEN = 46
+SEQ_OFFSET = 42                       # Offset of the sequence number inside the radiotap header
+MAX_RECORD_LEN = 65535
+
+COMPACT_RECORD = 1                    # wifictl_pcap_compact_type_t
+COMPACT_RECORD_LZ4 = 2
+COMPACT_BEACON_SUMMARY = 3
+SUMMARY_FORMAT = "<6sBbbbHIII"        # beacon_summary_t
+
+
+def read_exact(port, n):
+    data = bytearray()
+    while len(data) < n:
+        chunk = port.read(n - len(data))
+        if chunk:
+            data += chunk
+    return bytes(data)
+
+
+def sync_to_header(port):
+    """Returns (dictionary or None, PCAP global header)."""
+    window = bytearray()
+    while True:
+        byte = port.read(1)
+        if not byte:
+            continue
+        window += byte
+        if window[-4:] == PCAP_MAGIC:
+            return None, PCAP_MAGIC + read_exact(port, GLOBAL_HDR_LEN - 4)
+        if window[-4:] == COMPACT_MAGIC:
+            version, _, dict_len = struct.unpack("<BBH", read_exact(port, 4))
+            if version != COMPACT_VERSION:
+                raise SystemExit(f"Unsupported compact stream version {version}")
+            dictionary = read_exact(port, dict_len)
+            return dictionary, read_exact(port, GLOBAL_HDR_LEN)
+        if len(window) > 4096:
+            del window[:-4]
+
+
+def lz4_decompress(block, dictionary, size):
+    """Decodes an LZ4 block whose matches may reach back into the dictionary."""
+    out = bytearray(dictionary)
+    pos = 0
+    while pos < len(block):
+        token = block[pos]
+        pos += 1
+        literal_len = token >> 4
+        if literal_len == 15:
+            while True:
+                extra = block[pos]
+                pos += 1
+                literal_len += extra
+                if extra != 255:
+                    break
+        out += block[pos:pos + literal_len]
+        pos += literal_len
+        if pos >= len(block):
+            break
+        offset = block[pos] | block[pos + 1] << 8
+        pos += 2
+        match_len = token & 15
+        if match_len == 15:
+            while True:
+                extra = block[pos]
+                pos += 1
+                match_len += extra
+                if extra != 255:
+                    break
+        match_len += 4
+        start = len(out) - offset
+        if offset == 0 or start < 0:
+            raise ValueError("invalid match offset")
+        for i in range(match_len):                     # Matches may overlap their own output
+            out.append(out[start + i])
+    data = bytes(out[len(dictionary):])
+    if len(data) != size:
+        raise ValueError(f"decompressed {len(data)} bytes, expected {size}")
+    return data
+
+
+def read_compact_record(port, dictionary, summaries):
+    """Returns (record header, body, wire length), or None for a summary."""
+    record_type, _, length = struct.unpack("<BBH", read_exact(port, 4))
+    payload = read_exact(port, length)
+    if record_type == COMPACT_BEACON_SUMMARY:
+        summaries.append(struct.unpack(SUMMARY_FORMAT, payload))
+        return None, 4 + length
+    if record_type not in (COMPACT_RECORD, COMPACT_RECORD_LZ4) or length < RECORD_HDR_LEN:
+        raise ValueError(f"record type {record_type} length {length}")
+    record_hdr = payload[:RECORD_HDR_LEN]
+    _, _, incl_len, _ = struct.unpack("<IIII", record_hdr)
+    body = payload[RECORD_HDR_LEN:]
+    if record_type == COMPACT_RECORD_LZ4:
+        body = lz4_decompress(body, dictionary, incl_len)
+    return (record_hdr, body), 4 + length
+
+
+def write_summaries(path, summaries):
+    with open(path, "w") as out:
+        out.write("bssid,channel,count,rssi_mean,rssi_min,rssi_max,first_us,last_us,ie_hash\n")
+        for bssid, channel, mean, low, high, count, first_us, last_us, ie_hash in summaries:
+            out.write(f"{bssid.hex(':')},{channel},{count},{mean},{low},{high},{first_us},{last_us},{ie_hash:08x}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port, e.g. COM3 or /dev/ttyUSB0")
+    parser.add_argument("output", help="output .pcap file")
+    parser.add_argument("--baud", type=int, default=2000000, help="streaming baud rate (CONFIG_PCAP_EXPORT_BAUD)")
+    parser.add_argument("--interval", type=float, default=1.0, help="seconds between throughput reports")
+    parser.add_argument("--summaries", help="compact stream: write beacon summaries to this CSV file")
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port, open(args.output, "wb") as out:
+        print(f"Waiting for PCAP header on {args.port} @ {args.baud} baud...", file=sys.stderr)
+        dictionary, header = sync_to_header(port)
+        out.write(header)
+        if dictionary is not None:
+            print(f"Compact stream, {len(dictionary)} byte dictionary", file=sys.stderr)
+
+        records = lost = total_bytes = pcap_bytes = 0
+        summaries = []
+        expected_seq = None
+        started = last_report = time.monotonic()
+        window_records = window_bytes = 0
+        try:
+            while True:
+                if dictionary is None:
+                    record_hdr = read_exact(port, RECORD_HDR_LEN)
+                    _, _, incl_len, _ = struct.unpack("<IIII", record_hdr)
+                    if incl_len < RADIOTAP_LEN or incl_len > MAX_RECORD_LEN:
+                        print(f"Stream corrupted (record length {incl_len}), resynchronising is not possible", file=sys.stderr)
+                        break
+                    body = read_exact(port, incl_len)
+                    wire_len = RECORD_HDR_LEN + incl_len
+                else:
+                    try:
+                        record, wire_len = read_compact_record(port, dictionary, summaries)
+                    except (ValueError, IndexError) as err:
+                        print(f"Stream corrupted ({err}), resynchronising is not possible", file=sys.stderr)
+                        break
+                    total_bytes += wire_len
+                    window_bytes += wire_len
+                    if record is None:
+                        continue
+                    record_hdr, body = record
+                    wire_len = 0
+                out.write(record_hdr)
+                out.write(body)
+
+                (seq,) = struct.unpack_from("<I", body, SEQ_OFFSET)
+                if expected_seq is not None and seq != expected_seq:
+                    lost += (seq - expected_seq) & 0xFFFFFFFF
+                expected_seq = (seq + 1) & 0xFFFFFFFF
+
+                records += 1
+                total_bytes += wire_len
+                pcap_bytes += RECORD_HDR_LEN + len(body)
+                window_records += 1
+                window_bytes += wire_len
+
+                now = time.monotonic()
+                if now - last_report >= args.interval:
+                    elapsed = now - last_report
+                    print(f"{window_records / elapsed:8.1f} rec/s {window_bytes / elapsed / 1024:8.1f} KiB/s "
+                          f"total {records} lost {lost}", file=sys.stderr)
+                    window_records = window_bytes = 0
+                    last_report = now
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(b"\npcap stop\n")                       # Device listens at the streaming rate
+            port.flush()
+
+        suppressed = sum(summary[5] for summary in summaries)
+        lost = max(lost - suppressed, 0)                       # Summarised beacons consumed sequence numbers too
+        elapsed = max(time.monotonic() - started, 1e-9)
+        print(f"records {records} lost {lost} ({100.0 * lost / max(records + lost, 1):.2f}%) "
+              f"sustained {records / elapsed:.1f} rec/s {total_bytes / elapsed / 1024:.1f} KiB/s", file=sys.stderr)
+        if dictionary is not None:
+            print(f"beacons summarised {suppressed} in {len(summaries)} summaries, "
+                  f"{total_bytes} wire bytes for {pcap_bytes} PCAP bytes of forwarded records "
+                  f"(ratio {pcap_bytes / max(total_bytes, 1):.2f})", file=sys.stderr)
+            if args.summaries:
+                write_summaries(args.summaries, summaries)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Decodes framed binary result records from the device console UART.
+
+Switch the console to binary records with `output binary`, then run:
+
+    python tools/result_decoder.py COM3 --baud 115200
+
+Every record is printed as one JSON line. Echo, logs and other text mixed into the stream
+are skipped: frames are delimited by zero bytes and checked with CRC-32. Record layouts
+mirror components/command_line/include/result_protocol.h.
+
+    python tools/result_decoder.py --benchmark 200
+
+compares size, link time and host decode rate of a synthetic 200-AP scan in binary and in
+the text format printed by `print_ap_record`.
+"""
+import argparse
+import json
+import re
+import struct
+import sys
+import time
+import zlib
+
+PROTOCOL_VERSION = 2
+HEADER = struct.Struct("<BBH")        # type, version, body length
+
+AP_INFO = "6sBBhHII"                  # wifictl_ap_info_t
+RECORDS = {
+    0x01: ("ap", struct.Struct("<H" + AP_INFO + "bBBB33s"),
+           ("id", "bssid", "channel", "sources", "rssi_ewma_q4", "seen_count", "first_seen_ms", "last_seen_ms",
+            "rssi", "authmode", "pairwise_cipher", "group_cipher", "ssid")),
+    0x02: ("station", struct.Struct("<6s6sIIIbB2x"),
+           ("mac", "bssid", "frames", "bytes", "last_seen_ms", "rssi", "channel")),
+    0x03: ("channel", struct.Struct("<B3xIIIIII"),
+           ("channel", "rate_ewma_q8", "new_ewma_q8", "visits", "frames", "new_bssids", "dwell_total_ms")),
+    0x04: ("sniffer_counters", struct.Struct("<IIIII"),
+           ("captured", "filtered", "dropped", "post_failed", "fanout_dropped")),
+    0x05: ("scan_done", struct.Struct("<IIH"), ("first_result_ms", "total_ms", "ap_count")),
+    0x06: ("list_end", struct.Struct("<BH"), ("type", "count")),
+    0x07: ("airtime_channel", struct.Struct("<B3xIIIIIIII"),
+           ("channel", "listen_ms", "mgmt_us", "ctrl_us", "data_us", "mgmt_frames", "ctrl_frames", "data_frames",
+            "utilization_q16")),
+    0x08: ("airtime_bssid", struct.Struct("<6sBxIIIII"),
+           ("bssid", "channel", "mgmt_us", "ctrl_us", "data_us", "frames", "share_q16")),
+    0x09: ("sketch_census", struct.Struct("<6sBxII"), ("bssid", "channel", "window", "total")),
+    0x0A: ("sketch_talker", struct.Struct("<6s2xII"), ("mac", "count", "error")),
+    0x0B: ("scan_delta", struct.Struct("<BB6sBBbBBb"),
+           ("kind", "changed", "bssid", "channel", "authmode", "rssi", "previous_channel", "previous_authmode",
+            "previous_rssi")),
+}
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos, code = 0, 1
+    for byte in data:
+        if byte:
+            out.append(byte)
+            code += 1
+        if not byte or code == 0xFF:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def encode_frame(record_type, body):
+    payload = HEADER.pack(record_type, PROTOCOL_VERSION, len(body)) + body
+    payload += struct.pack("<I", zlib.crc32(payload))
+    return b"\x00" + cobs_encode(payload) + b"\x00"
+
+
+def decode_frame(chunk):
+    """Returns (name, dict) for a valid frame, None for text or corrupted data."""
+    try:
+        payload = cobs_decode(chunk)
+    except ValueError:
+        return None
+    if len(payload) < HEADER.size + 4:
+        return None
+    record_type, version, length = HEADER.unpack_from(payload)
+    if version != PROTOCOL_VERSION or HEADER.size + length + 4 != len(payload):
+        return None
+    (crc,) = struct.unpack_from("<I", payload, len(payload) - 4)
+    if zlib.crc32(payload[:-4]) != crc:
+        return None
+    name, layout, fields = RECORDS.get(record_type, (f"type_{record_type}", None, ()))
+    body = payload[HEADER.size:-4]
+    if layout is None or layout.size != length:
+        return name, {"raw": body.hex()}
+    record = {}
+    for field, value in zip(fields, layout.unpack(body)):
+        if field in ("bssid", "mac"):
+            value = ":".join(f"{b:02x}" for b in value)
+        elif field == "ssid":
+            value = value.split(b"\x00", 1)[0].decode("utf-8", "replace")
+        record[field] = value
+    return name, record
+
+
+def split_frames(buffer):
+    """Splits on zero bytes; returns (complete chunks, unterminated rest)."""
+    parts = buffer.split(b"\x00")
+    return [p for p in parts[:-1] if p], parts[-1]
+
+
+def run_port(args):
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=0.2) as port:
+        pending = b""
+        records = rejected = 0
+        try:
+            while True:
+                pending += port.read(4096)
+                chunks, pending = split_frames(pending)
+                for chunk in chunks:
+                    decoded = decode_frame(chunk)
+                    if decoded is None:
+                        rejected += 1
+                        continue
+                    records += 1
+                    name, record = decoded
+                    print(json.dumps({"record": name, **record}), flush=True)
+        except KeyboardInterrupt:
+            pass
+        print(f"records {records}, skipped chunks {rejected}", file=sys.stderr)
+
+
+TEXT_LINE = re.compile(r"(\d+)\. SSID: (.*), RSSI: (-?\d+) dBm, CH: (\d+), ENC: (\S+), BSSID: ([0-9a-f:]{17})")
+
+
+def run_benchmark(count, baud):
+    layout = RECORDS[0x01][1]
+    binary = bytearray()
+    text = bytearray()
+    for i in range(count):
+        bssid = bytes([0x02, 0x00, 0x00, 0x00, i >> 8, i & 0xFF])
+        ssid = f"Network-{i:04d}".encode()
+        rssi = -30 - i % 60
+        binary += encode_frame(0x01, layout.pack(i, bssid, 1 + i % 13, 1, rssi * 16, 3, 1000, 2000,
+                                                 rssi, 3, 4, 4, ssid.ljust(33, b"\x00")))
+        text += (f"{i + 1}. SSID: {ssid.decode()}, RSSI: {rssi} dBm, CH: {1 + i % 13}, ENC: WPA2_PSK, "
+                 f"BSSID: {':'.join(f'{b:02x}' for b in bssid)}\n").encode()
+    binary += encode_frame(0x06, RECORDS[0x06][1].pack(0x01, count))
+
+    rounds = max(1, 200000 // count)
+    started = time.perf_counter()
+    for _ in range(rounds):
+        decoded = [decode_frame(c) for c in split_frames(bytes(binary))[0]]
+    binary_rate = rounds * count / (time.perf_counter() - started)
+    assert sum(1 for d in decoded if d and d[0] == "ap") == count
+
+    started = time.perf_counter()
+    for _ in range(rounds):
+        parsed = [TEXT_LINE.match(line) for line in text.decode().splitlines()]
+    text_rate = rounds * count / (time.perf_counter() - started)
+    assert all(parsed)
+
+    link = baud / 10.0                                          # 8N1: ten bit times per byte
+    print(f"{count} APs at {baud} baud")
+    print(f"  binary: {len(binary):7d} bytes, {len(binary) / link * 1000:7.1f} ms on the link, "
+          f"{binary_rate:10.0f} records/s host decode")
+    print(f"  text:   {len(text):7d} bytes, {len(text) / link * 1000:7.1f} ms on the link, "
+          f"{text_rate:10.0f} records/s host parse (name, RSSI, channel, auth, BSSID only)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", nargs="?", help="serial port, e.g. COM3 or /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=115200, help="console baud rate")
+    parser.add_argument("--benchmark", type=int, metavar="APS", help="compare binary and text output for APS synthetic APs")
+    args = parser.parse_args()
+
+    if args.benchmark:
+        run_benchmark(args.benchmark, args.baud)
+    elif args.port:
+        run_port(args)
+    else:
+        parser.error("serial port or --benchmark required")
+
+
+if __name__ == "__main__":
+    main()